@@ -0,0 +1,1287 @@
+/**
+ * @file editor_bench.c
+ * @brief Headless latency benchmark for the Professional Text Editor
+ *
+ * Replays input traces against the document core without any user
+ * interface: typing, pasting, opening and saving files, searching,
+ * scrolling, word completion, undo and redo. Every operation is timed on
+ * its own, and each scenario reports per-operation latency percentiles,
+ * throughput, allocations, peak resident memory and peak memory by
+ * subsystem as JSON, so results of two builds can be compared. Built-in
+ * synthetic traces run when no trace file is given.
+ *
+ * A trace is a text file with one command per line; lines starting with
+ * '#' are comments:
+ *
+ *   generate <size>      Replace the document with generated source text (not timed)
+ *   open <path>          Map a file and index it, as opening it in the editor does
+ *   save <path>          Write the document through a temporary file and rename it
+ *   goto <where>         Place the caret at start, middle, end or a byte offset (not timed)
+ *   type <text>          One keystroke per byte; \n, \t and \\ are escapes
+ *   backspace <count>    One keystroke per deleted character
+ *   paste <size>         Insert generated text of the given size
+ *   search <pattern>     Count every occurrence of a pattern in the document
+ *   scroll <pages>       Read one screen per page, moving down from the caret
+ *   jump <count>         Read screens at pseudo-random lines
+ *   complete <prefix>    Ask the identifier index for completions
+ *   undo <count>         Undo edit batches one at a time
+ *   redo <count>         Redo edit batches one at a time
+ *
+ * Sizes accept K, M and G suffixes (powers of 1024).
+ */
+
+#define _POSIX_C_SOURCE 200809L // For clock_gettime and getrusage
+
+#include "../include/cursors.h"
+#include "../include/document.h"
+#include "../include/filewriter.h"
+#include "../include/memory.h"
+#include "../include/search.h"
+#include "../include/structure.h"
+#include "../include/thread.h"
+#include "../include/wordindex.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define BENCH_SCREEN_LINES 50           // Lines read per screen
+#define BENCH_SCREEN_COLUMNS 240        // Bytes read per line of a screen
+#define BENCH_MAX_OPERATIONS 16         // Distinct commands timed per scenario
+#define BENCH_MAX_LINE 8192             // Longest trace line
+#define BENCH_MAX_COMPLETIONS 10        // Completions asked for per query
+#define BENCH_DEFAULT_SIZES "1M,64M"    // File sizes of the built-in open and save scenarios
+#define BENCH_COMMANDS_WITHOUT_DOCUMENT 2   // Leading entries of g_commands that create the document
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+
+// The build links with --wrap, so allocations anywhere in the program come here first
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* block, size_t size);
+void* __wrap_malloc(size_t size);
+void* __wrap_calloc(size_t count, size_t size);
+void* __wrap_realloc(void* block, size_t size);
+
+static unsigned long long g_allocations = 0;
+static unsigned long long g_allocatedBytes = 0;
+
+/**
+ * @brief Counts one allocation; worker threads of the core allocate too.
+ *
+ * @param size Bytes requested.
+ */
+static void CountAllocation(size_t size) {
+    __atomic_fetch_add(&g_allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_allocatedBytes, (unsigned long long)size, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Counts an allocation and forwards it to malloc.
+ */
+void* __wrap_malloc(size_t size) {
+    CountAllocation(size);
+    return __real_malloc(size);
+}
+
+/**
+ * @brief Counts an allocation and forwards it to calloc.
+ */
+void* __wrap_calloc(size_t count, size_t size) {
+    CountAllocation(count * size);
+    return __real_calloc(count, size);
+}
+
+/**
+ * @brief Counts an allocation and forwards it to realloc.
+ */
+void* __wrap_realloc(void* block, size_t size) {
+    CountAllocation(size);
+    return __real_realloc(block, size);
+}
+
+#endif /* BENCH_COUNT_ALLOCATIONS */
+
+// Latencies and totals of one command within a scenario
+typedef struct {
+    char name[16];
+    uint64_t* samples;                  // Latency of each operation in nanoseconds
+    size_t count;
+    size_t capacity;
+    uint64_t totalNs;
+    uint64_t bytes;                     // Bytes typed, pasted, read, written or scanned
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+} OperationStats;
+
+// Results of replaying one trace
+typedef struct {
+    char name[64];
+    OperationStats operations[BENCH_MAX_OPERATIONS];
+    size_t operationCount;
+    double seconds;                     // Wall time of the whole replay, setup included
+    unsigned long long peakMemoryKb;    // Peak resident size while the trace ran
+    MemoryStats memoryStart;            // Usage by subsystem before the trace
+    MemoryStats memoryEnd;              // Usage by subsystem after it, with peaks since its start
+    bool failed;
+} Scenario;
+
+// Editor state a trace is replayed against
+typedef struct {
+    Scenario* scenario;
+    Document* document;
+    CursorSet cursors;
+    StructureIndex* structure;
+    WordIndex* words;
+    uint64_t topLine;                   // First line of the screen read by scroll
+    uint32_t random;                    // State of the text and position generator
+    char* text;                         // Generated text for paste
+    size_t textCapacity;
+} Replay;
+
+// Start of a timed operation
+typedef struct {
+    uint64_t start;
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+} Measurement;
+
+/**
+ * @brief Reads the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+static uint64_t BenchNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Reads the allocation counters.
+ *
+ * @param[out] allocations Receives the number of allocations so far.
+ * @param[out] allocatedBytes Receives the bytes requested so far.
+ */
+static void ReadAllocations(unsigned long long* allocations, unsigned long long* allocatedBytes) {
+#ifdef BENCH_COUNT_ALLOCATIONS
+    *allocations = __atomic_load_n(&g_allocations, __ATOMIC_RELAXED);
+    *allocatedBytes = __atomic_load_n(&g_allocatedBytes, __ATOMIC_RELAXED);
+#else
+    *allocations = 0;
+    *allocatedBytes = 0;
+#endif
+}
+
+/**
+ * @brief Resets the peak resident size of the process, where the system allows it.
+ */
+static void ResetPeakMemory(void) {
+#ifdef __linux__
+    // Writing 5 resets VmHWM (Linux 4.0 and later)
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file) {
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+/**
+ * @brief Gets the peak resident size of the process.
+ *
+ * @return The peak in kilobytes.
+ */
+static unsigned long long PeakMemoryKb(void) {
+#ifdef __linux__
+    // VmHWM follows ResetPeakMemory; ru_maxrss never goes down
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file) {
+        char line[256];
+        unsigned long long peak = 0;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "VmHWM: %llu kB", &peak) == 1) {
+                break;
+            }
+        }
+        fclose(file);
+        if (peak > 0) {
+            return peak;
+        }
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (unsigned long long)usage.ru_maxrss / 1024;
+#else
+    return (unsigned long long)usage.ru_maxrss;
+#endif
+}
+
+/**
+ * @brief Starts timing an operation.
+ *
+ * @param[out] measurement Receives the start time and allocation counters.
+ */
+static void MeasureBegin(Measurement* measurement) {
+    ReadAllocations(&measurement->allocations, &measurement->allocatedBytes);
+    measurement->start = BenchNow();
+}
+
+/**
+ * @brief Finishes timing an operation and records it under a command name.
+ *
+ * The clock and the counters are read before the sample is stored, so
+ * growing the sample array is not charged to the operation.
+ *
+ * @param scenario The scenario receiving the sample.
+ * @param name The command.
+ * @param measurement The start of the operation.
+ * @param bytes Bytes the operation processed.
+ * @return true if successful, false on allocation failure.
+ */
+static bool MeasureEnd(Scenario* scenario, const char* name, const Measurement* measurement, uint64_t bytes) {
+    uint64_t elapsed = BenchNow() - measurement->start;
+    unsigned long long allocations, allocatedBytes;
+    ReadAllocations(&allocations, &allocatedBytes);
+
+    OperationStats* stats = NULL;
+    for (size_t i = 0; i < scenario->operationCount && !stats; i++) {
+        if (strcmp(scenario->operations[i].name, name) == 0) {
+            stats = &scenario->operations[i];
+        }
+    }
+    if (!stats) {
+        if (scenario->operationCount == BENCH_MAX_OPERATIONS) {
+            return false;
+        }
+        stats = &scenario->operations[scenario->operationCount++];
+        snprintf(stats->name, sizeof(stats->name), "%s", name);
+    }
+
+    if (stats->count == stats->capacity) {
+        size_t capacity = stats->capacity ? stats->capacity * 2 : 256;
+        uint64_t* samples = (uint64_t*)realloc(stats->samples, capacity * sizeof(uint64_t));
+        if (!samples) {
+            return false;
+        }
+        stats->samples = samples;
+        stats->capacity = capacity;
+    }
+    stats->samples[stats->count++] = elapsed;
+    stats->totalNs += elapsed;
+    stats->bytes += bytes;
+    stats->allocations += allocations - measurement->allocations;
+    stats->allocatedBytes += allocatedBytes - measurement->allocatedBytes;
+    return true;
+}
+
+/**
+ * @brief Advances the pseudo-random generator (xorshift32).
+ *
+ * @param state The generator state; never zero.
+ * @return The next value.
+ */
+static uint32_t NextRandom(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Writes one line of generated source text.
+ *
+ * Lines look like C code, with nested braces and repeated identifiers, so
+ * that the structure and identifier indexes have realistic work.
+ *
+ * @param state The generator state.
+ * @param[out] line Receives the line; at least 128 bytes.
+ * @return Length of the line, including its line break.
+ */
+static size_t GenerateLine(uint32_t* state, char* line) {
+    uint32_t r = NextRandom(state);
+    int indent = 4 * (int)(r % 3);
+    int length;
+    switch ((r >> 8) % 8) {
+        case 0:
+            length = snprintf(line, 128, "%*sif (ready_%u) {\n", indent, "", (r >> 12) % 64);
+            break;
+        case 1:
+            length = snprintf(line, 128, "%*s}\n", indent, "");
+            break;
+        case 2:
+            length = snprintf(line, 128, "\n");
+            break;
+        case 3:
+            length = snprintf(line, 128, "%*s// step %u of the %s pass\n", indent, "", (r >> 12) % 1000,
+                              (r & 0x10) ? "first" : "second");
+            break;
+        default:
+            length = snprintf(line, 128, "%*svalue_%u = compute(item_%u, %u);\n", indent, "", (r >> 12) % 512,
+                              (r >> 4) % 97, r % 10000);
+            break;
+    }
+    return (size_t)length;
+}
+
+/**
+ * @brief Fills a buffer with generated source text.
+ *
+ * @param state The generator state.
+ * @param[out] buffer Receives the text.
+ * @param size Number of bytes to generate.
+ */
+static void GenerateText(uint32_t* state, char* buffer, size_t size) {
+    char line[128];
+    size_t filled = 0;
+    while (filled < size) {
+        size_t length = GenerateLine(state, line);
+        size_t part = length < size - filled ? length : size - filled;
+        memcpy(buffer + filled, line, part);
+        filled += part;
+    }
+}
+
+/**
+ * @brief Parses a size with an optional K, M or G suffix.
+ *
+ * @param text The size.
+ * @param[out] size Receives the size in bytes.
+ * @return true if the text is a size, false otherwise.
+ */
+static bool ParseSize(const char* text, uint64_t* size) {
+    char* end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) {
+        return false;
+    }
+    switch (*end) {
+        case 'K': case 'k': value <<= 10; end++; break;
+        case 'M': case 'm': value <<= 20; end++; break;
+        case 'G': case 'g': value <<= 30; end++; break;
+        default: break;
+    }
+    while (*end == ' ' || *end == '\t') {
+        end++;
+    }
+    *size = value;
+    return *end == '\0';
+}
+
+/**
+ * @brief Writes a file of generated source text.
+ *
+ * @param filePath Path to the file.
+ * @param size Size of the file in bytes.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteGeneratedFile(const char* filePath, uint64_t size) {
+    char* buffer = (char*)malloc(FILE_WRITER_BUFFER_SIZE);
+    FileWriter* writer = buffer ? FileWriterOpen(filePath) : NULL;
+    if (!writer) {
+        free(buffer);
+        return false;
+    }
+
+    uint32_t state = 0x2545F491u;
+    bool written = true;
+    for (uint64_t offset = 0; written && offset < size; offset += FILE_WRITER_BUFFER_SIZE) {
+        size_t length = size - offset < FILE_WRITER_BUFFER_SIZE ? (size_t)(size - offset) : FILE_WRITER_BUFFER_SIZE;
+        GenerateText(&state, buffer, length);
+        written = FileWriterWrite(writer, buffer, length);
+    }
+    written = FileWriterClose(writer) && written;
+    free(buffer);
+    return written;
+}
+
+/**
+ * @brief Releases the document of a replay and its indexes.
+ *
+ * @param replay The replay.
+ */
+static void ReplayCloseDocument(Replay* replay) {
+    WordIndexDestroy(replay->words);
+    StructureIndexDestroy(replay->structure);
+    DocumentDestroy(replay->document);
+    replay->words = NULL;
+    replay->structure = NULL;
+    replay->document = NULL;
+}
+
+/**
+ * @brief Makes a document the one being edited, as the edit control does.
+ *
+ * @param replay The replay.
+ * @param document The document; the replay takes ownership.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ReplaySetDocument(Replay* replay, Document* document) {
+    ReplayCloseDocument(replay);
+    if (!document) {
+        return false;
+    }
+    replay->document = document;
+    replay->structure = StructureIndexCreate(document);
+    replay->words = WordIndexCreate(document);
+    if (!replay->structure || !replay->words || !WordIndexBuild(replay->words, 0)) {
+        return false;
+    }
+    CursorSetReset(&replay->cursors, 0, 0);
+    replay->topLine = 0;
+    return true;
+}
+
+/**
+ * @brief Reads the lines of one screen, as painting it does.
+ *
+ * @param document The document.
+ * @param topLine First line of the screen.
+ * @return Bytes read.
+ */
+static uint64_t ReadScreen(const Document* document, uint64_t topLine) {
+    char line[BENCH_SCREEN_COLUMNS];
+    uint64_t lineCount = DocumentLineCount(document);
+    uint64_t bytes = 0;
+    for (uint64_t i = topLine; i < topLine + BENCH_SCREEN_LINES && i < lineCount; i++) {
+        uint64_t start = DocumentLineStart(document, i);
+        uint64_t end = DocumentLineEnd(document, i);
+        size_t length = end - start < BENCH_SCREEN_COLUMNS ? (size_t)(end - start) : BENCH_SCREEN_COLUMNS;
+        bytes += DocumentRead(document, start, line, length);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Counts a match reported by SearchFindAll.
+ *
+ * @param offset Offset of the match.
+ * @param context Pointer to the count.
+ * @return true to continue.
+ */
+static bool CountMatch(uint64_t offset, void* context) {
+    (void)offset;
+    (*(uint64_t*)context)++;
+    return true;
+}
+
+/**
+ * @brief Parses the count argument of a command.
+ *
+ * @param argument The argument.
+ * @param[out] count Receives the count.
+ * @return true if the argument is a positive count, false otherwise.
+ */
+static bool ParseCount(const char* argument, uint64_t* count) {
+    return ParseSize(argument, count) && *count > 0;
+}
+
+/**
+ * @brief Replaces the document with generated source text.
+ *
+ * @param replay The replay.
+ * @param argument Size of the text.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandGenerate(Replay* replay, const char* argument) {
+    uint64_t size;
+    if (!ParseSize(argument, &size) || size > (uint64_t)SIZE_MAX) {
+        return false;
+    }
+    char* text = (char*)malloc(size ? (size_t)size : 1);
+    if (!text) {
+        return false;
+    }
+    GenerateText(&replay->random, text, (size_t)size);
+    bool created = ReplaySetDocument(replay, DocumentCreateFromText(text, (size_t)size));
+    free(text);
+    return created;
+}
+
+/**
+ * @brief Opens a file: maps it, indexes its lines and builds its identifier index.
+ *
+ * @param replay The replay.
+ * @param argument Path to the file.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandOpen(Replay* replay, const char* argument) {
+    Measurement measurement;
+    MeasureBegin(&measurement);
+    MappedFile mappedFile;
+    if (!MapFileOpen(argument, &mappedFile)) {
+        return false;
+    }
+    uint64_t size = mappedFile.size;
+    if (!ReplaySetDocument(replay, DocumentCreateFromMapping(&mappedFile, NULL))) {
+        return false;
+    }
+    return MeasureEnd(replay->scenario, "open", &measurement, size);
+}
+
+/**
+ * @brief Saves the document to a file.
+ *
+ * @param replay The replay.
+ * @param argument Path to the file.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandSave(Replay* replay, const char* argument) {
+    char tempPath[4096];
+    if (!replay->document || snprintf(tempPath, sizeof(tempPath), "%s.tmp", argument) >= (int)sizeof(tempPath)) {
+        return false;
+    }
+
+    // Written beside the target and renamed, so a file still mapped by the document stays intact
+    Measurement measurement;
+    MeasureBegin(&measurement);
+    DocumentSnapshot* snapshot = DocumentSnapshotCreate(replay->document);
+    FileWriter* writer = snapshot ? FileWriterOpen(tempPath) : NULL;
+    if (!writer) {
+        DocumentSnapshotRelease(snapshot);
+        return false;
+    }
+    DocumentIterator iterator;
+    DocumentSnapshotIterInit(snapshot, 0, &iterator);
+    const char* data;
+    size_t length;
+    bool written = true;
+    while (written && DocumentIterNext(&iterator, &data, &length)) {
+        written = FileWriterWrite(writer, data, length);
+    }
+    written = FileWriterClose(writer) && written && rename(tempPath, argument) == 0;
+    uint64_t size = DocumentSnapshotLength(snapshot);
+    if (written) {
+        DocumentMarkSnapshotSaved(replay->document, snapshot);
+    }
+    DocumentSnapshotRelease(snapshot);
+    if (!written) {
+        remove(tempPath);
+        return false;
+    }
+    return MeasureEnd(replay->scenario, "save", &measurement, size);
+}
+
+/**
+ * @brief Places the caret and the top of the screen.
+ *
+ * @param replay The replay.
+ * @param argument start, middle, end or a byte offset.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandGoto(Replay* replay, const char* argument) {
+    uint64_t length = DocumentLength(replay->document);
+    uint64_t offset;
+    if (strcmp(argument, "start") == 0) {
+        offset = 0;
+    } else if (strcmp(argument, "middle") == 0) {
+        offset = DocumentLineStart(replay->document, DocumentLineFromOffset(replay->document, length / 2));
+    } else if (strcmp(argument, "end") == 0) {
+        offset = length;
+    } else if (!ParseSize(argument, &offset) || offset > length) {
+        return false;
+    }
+    CursorSetReset(&replay->cursors, offset, offset);
+    replay->topLine = DocumentLineFromOffset(replay->document, offset);
+    return true;
+}
+
+/**
+ * @brief Types text one keystroke at a time.
+ *
+ * @param replay The replay.
+ * @param argument The text, with \n, \t and \\ escapes.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandType(Replay* replay, const char* argument) {
+    for (const char* p = argument; *p; p++) {
+        char c = *p;
+        if (c == '\\' && p[1]) {
+            p++;
+            c = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+        }
+        Measurement measurement;
+        MeasureBegin(&measurement);
+        if (!CursorSetInsert(&replay->cursors, replay->document, &c, 1) ||
+            !MeasureEnd(replay->scenario, "type", &measurement, 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Deletes characters before the caret one keystroke at a time.
+ *
+ * @param replay The replay.
+ * @param argument Number of keystrokes.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandBackspace(Replay* replay, const char* argument) {
+    uint64_t count;
+    if (!ParseCount(argument, &count)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        Measurement measurement;
+        MeasureBegin(&measurement);
+        CursorSetDeleteBackward(&replay->cursors, replay->document);
+        if (!MeasureEnd(replay->scenario, "backspace", &measurement, 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Pastes generated text at the caret.
+ *
+ * @param replay The replay.
+ * @param argument Size of the text.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandPaste(Replay* replay, const char* argument) {
+    uint64_t size;
+    if (!ParseCount(argument, &size) || size > (uint64_t)SIZE_MAX) {
+        return false;
+    }
+    if (size > replay->textCapacity) {
+        char* text = (char*)realloc(replay->text, (size_t)size);
+        if (!text) {
+            return false;
+        }
+        replay->text = text;
+        replay->textCapacity = (size_t)size;
+    }
+    GenerateText(&replay->random, replay->text, (size_t)size);
+
+    Measurement measurement;
+    MeasureBegin(&measurement);
+    return CursorSetInsert(&replay->cursors, replay->document, replay->text, (size_t)size) &&
+           MeasureEnd(replay->scenario, "paste", &measurement, size);
+}
+
+/**
+ * @brief Counts every occurrence of a pattern in the document.
+ *
+ * @param replay The replay.
+ * @param argument The pattern.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandSearch(Replay* replay, const char* argument) {
+    size_t length = strlen(argument);
+    if (length == 0 || length > SEARCH_MAX_PATTERN) {
+        return false;
+    }
+    uint64_t matches = 0;
+    Measurement measurement;
+    MeasureBegin(&measurement);
+    SearchFindAll(replay->document, argument, length, 0, DocumentLength(replay->document), true, CountMatch,
+                  &matches);
+    return MeasureEnd(replay->scenario, "search", &measurement, DocumentLength(replay->document));
+}
+
+/**
+ * @brief Pages down from the top of the screen, reading each screen.
+ *
+ * @param replay The replay.
+ * @param argument Number of pages.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandScroll(Replay* replay, const char* argument) {
+    uint64_t pages;
+    if (!ParseCount(argument, &pages)) {
+        return false;
+    }
+    uint64_t lineCount = DocumentLineCount(replay->document);
+    for (uint64_t i = 0; i < pages; i++) {
+        Measurement measurement;
+        MeasureBegin(&measurement);
+        uint64_t bytes = ReadScreen(replay->document, replay->topLine);
+        if (!MeasureEnd(replay->scenario, "scroll", &measurement, bytes)) {
+            return false;
+        }
+        replay->topLine += BENCH_SCREEN_LINES;
+        if (replay->topLine >= lineCount) {
+            replay->topLine = 0;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads screens at pseudo-random lines.
+ *
+ * @param replay The replay.
+ * @param argument Number of screens.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandJump(Replay* replay, const char* argument) {
+    uint64_t count;
+    if (!ParseCount(argument, &count)) {
+        return false;
+    }
+    uint64_t lineCount = DocumentLineCount(replay->document);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t line = (((uint64_t)NextRandom(&replay->random) << 32) | NextRandom(&replay->random)) % lineCount;
+        Measurement measurement;
+        MeasureBegin(&measurement);
+        uint64_t bytes = ReadScreen(replay->document, line);
+        if (!MeasureEnd(replay->scenario, "jump", &measurement, bytes)) {
+            return false;
+        }
+        replay->topLine = line;
+    }
+    return true;
+}
+
+/**
+ * @brief Asks the identifier index for the completions of a prefix.
+ *
+ * @param replay The replay.
+ * @param argument The prefix.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandComplete(Replay* replay, const char* argument) {
+    WordCompletion results[BENCH_MAX_COMPLETIONS];
+    Measurement measurement;
+    MeasureBegin(&measurement);
+    WordIndexComplete(replay->words, argument, strlen(argument), results, BENCH_MAX_COMPLETIONS);
+    return MeasureEnd(replay->scenario, "complete", &measurement, 0);
+}
+
+/**
+ * @brief Undoes or redoes edit batches one at a time.
+ *
+ * @param replay The replay.
+ * @param argument Number of batches.
+ * @param redo true to redo, false to undo.
+ * @return true if successful, false otherwise. Running out of history is not an error.
+ */
+static bool ReplayHistory(Replay* replay, const char* argument, bool redo) {
+    uint64_t count;
+    if (!ParseCount(argument, &count)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        size_t changeCount;
+        Measurement measurement;
+        MeasureBegin(&measurement);
+        const DocumentChange* changes = redo ? DocumentRedo(replay->document, &changeCount)
+                                             : DocumentUndo(replay->document, &changeCount);
+        if (!changes) {
+            break;
+        }
+        CursorSetPlaceAfterChanges(&replay->cursors, changes, changeCount);
+        if (!MeasureEnd(replay->scenario, redo ? "redo" : "undo", &measurement, 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Undoes edit batches one at a time.
+ *
+ * @param replay The replay.
+ * @param argument Number of batches.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandUndo(Replay* replay, const char* argument) {
+    return ReplayHistory(replay, argument, false);
+}
+
+/**
+ * @brief Redoes edit batches one at a time.
+ *
+ * @param replay The replay.
+ * @param argument Number of batches.
+ * @return true if successful, false otherwise.
+ */
+static bool CommandRedo(Replay* replay, const char* argument) {
+    return ReplayHistory(replay, argument, true);
+}
+
+// Trace commands; all but the first BENCH_COMMANDS_WITHOUT_DOCUMENT need a document
+static const struct {
+    const char* name;
+    bool (*run)(Replay* replay, const char* argument);
+} g_commands[] = {
+    { "generate", CommandGenerate },
+    { "open", CommandOpen },
+    { "save", CommandSave },
+    { "goto", CommandGoto },
+    { "type", CommandType },
+    { "backspace", CommandBackspace },
+    { "paste", CommandPaste },
+    { "search", CommandSearch },
+    { "scroll", CommandScroll },
+    { "jump", CommandJump },
+    { "complete", CommandComplete },
+    { "undo", CommandUndo },
+    { "redo", CommandRedo },
+};
+
+/**
+ * @brief Replays a trace and records its operations in a scenario.
+ *
+ * @param scenario The scenario; its name identifies the trace in messages.
+ * @param trace The trace text.
+ * @return true if every command ran, false otherwise.
+ */
+static bool RunScenario(Scenario* scenario, const char* trace) {
+    Replay replay;
+    memset(&replay, 0, sizeof(replay));
+    replay.scenario = scenario;
+    replay.random = 0x9E3779B9u;
+    if (!CursorSetInit(&replay.cursors)) {
+        return false;
+    }
+
+    ResetPeakMemory();
+    MemoryResetPeaks();
+    MemoryGetStats(&scenario->memoryStart);
+    uint64_t start = BenchNow();
+    bool succeeded = true;
+    unsigned lineNumber = 0;
+    const char* next = trace;
+    while (succeeded && *next) {
+        char line[BENCH_MAX_LINE];
+        const char* end = strchr(next, '\n');
+        size_t length = end ? (size_t)(end - next) : strlen(next);
+        lineNumber++;
+        if (length >= sizeof(line)) {
+            fprintf(stderr, "editor_bench: %s:%u: line too long\n", scenario->name, lineNumber);
+            succeeded = false;
+            break;
+        }
+        memcpy(line, next, length);
+        line[length] = '\0';
+        next += end ? length + 1 : length;
+        if (length > 0 && line[length - 1] == '\r') {
+            line[--length] = '\0';
+        }
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+
+        char* argument = strchr(line, ' ');
+        if (argument) {
+            *argument++ = '\0';
+        } else {
+            argument = line + length;
+        }
+
+        size_t command = 0;
+        size_t commandCount = sizeof(g_commands) / sizeof(g_commands[0]);
+        while (command < commandCount && strcmp(g_commands[command].name, line) != 0) {
+            command++;
+        }
+        if (command == commandCount) {
+            fprintf(stderr, "editor_bench: %s:%u: unknown command '%s'\n", scenario->name, lineNumber, line);
+            succeeded = false;
+        } else if (command >= BENCH_COMMANDS_WITHOUT_DOCUMENT && !replay.document) {
+            fprintf(stderr, "editor_bench: %s:%u: '%s' needs a document\n", scenario->name, lineNumber, line);
+            succeeded = false;
+        } else if (!g_commands[command].run(&replay, argument)) {
+            fprintf(stderr, "editor_bench: %s:%u: '%s %s' failed\n", scenario->name, lineNumber, line, argument);
+            succeeded = false;
+        }
+    }
+    scenario->seconds = (double)(BenchNow() - start) / 1e9;
+    scenario->peakMemoryKb = PeakMemoryKb();
+    MemoryGetStats(&scenario->memoryEnd);
+    scenario->failed = !succeeded;
+
+    ReplayCloseDocument(&replay);
+    CursorSetFree(&replay.cursors);
+    free(replay.text);
+    return succeeded;
+}
+
+/**
+ * @brief Appends formatted text to a growing trace.
+ *
+ * @param trace The trace; freed and set to NULL on allocation failure.
+ * @param length Length of the trace.
+ * @param format printf format.
+ */
+static void TraceAppend(char** trace, size_t* length, const char* format, ...) {
+    if (!*trace) {
+        return;
+    }
+    va_list arguments;
+    va_start(arguments, format);
+    int added = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+
+    char* grown = (char*)realloc(*trace, *length + (size_t)added + 1);
+    if (!grown) {
+        free(*trace);
+        *trace = NULL;
+        return;
+    }
+    va_start(arguments, format);
+    vsnprintf(grown + *length, (size_t)added + 1, format, arguments);
+    va_end(arguments);
+    *trace = grown;
+    *length += (size_t)added;
+}
+
+/**
+ * @brief Builds the trace typing code into the middle of a 1 MB document.
+ *
+ * @return The trace, or NULL on allocation failure.
+ */
+static char* BuildTypingTrace(void) {
+    static const char* const prefixes[] = { "v", "va", "val", "item", "comp" };
+    size_t length = 0;
+    char* trace = (char*)calloc(1, 1);
+    TraceAppend(&trace, &length, "generate 1M\ngoto middle\n");
+    for (unsigned i = 0; i < 100; i++) {
+        if (i % 10 == 0) {
+            TraceAppend(&trace, &length, "type if (ready_%u) {\\n\n", i);
+        }
+        TraceAppend(&trace, &length, "type     total_%u = compute(value_%u, item_%u);\\n\n", i, i * 7 % 512, i % 97);
+        if (i % 10 == 9) {
+            TraceAppend(&trace, &length, "type }\\n\n");
+        }
+    }
+    TraceAppend(&trace, &length, "backspace 1000\n");
+    for (unsigned i = 0; i < 200; i++) {
+        TraceAppend(&trace, &length, "complete %s\n", prefixes[i % 5]);
+    }
+    TraceAppend(&trace, &length, "undo 300\nredo 300\n");
+    return trace;
+}
+
+/**
+ * @brief Builds a trace pasting blocks of one size.
+ *
+ * @param size Size of each paste, with its suffix.
+ * @param count Number of pastes.
+ * @return The trace, or NULL on allocation failure.
+ */
+static char* BuildPasteTrace(const char* size, unsigned count) {
+    size_t length = 0;
+    char* trace = (char*)calloc(1, 1);
+    TraceAppend(&trace, &length, "generate 1M\ngoto middle\n");
+    for (unsigned i = 0; i < count; i++) {
+        TraceAppend(&trace, &length, "paste %s\n", size);
+    }
+    TraceAppend(&trace, &length, "undo %u\n", count);
+    return trace;
+}
+
+/**
+ * @brief Builds the trace opening, browsing, editing and saving a file.
+ *
+ * Smaller files are opened and saved more often, so that every size
+ * gives a few samples in about the same time.
+ *
+ * @param filePath The file to open.
+ * @param savePath The file to save to.
+ * @param size Size of the file.
+ * @return The trace, or NULL on allocation failure.
+ */
+static char* BuildFileTrace(const char* filePath, const char* savePath, uint64_t size) {
+    unsigned repeats = size < (16u << 20) ? 10 : size < (1u << 30) ? 3 : 1;
+    unsigned searches = size < (1u << 30) ? 10 : 2;
+    size_t length = 0;
+    char* trace = (char*)calloc(1, 1);
+    for (unsigned i = 0; i < repeats; i++) {
+        TraceAppend(&trace, &length, "open %s\n", filePath);
+    }
+    TraceAppend(&trace, &length, "scroll 500\njump 200\ngoto middle\ntype // edited\\n\n");
+    for (unsigned i = 0; i < searches; i++) {
+        TraceAppend(&trace, &length, "search compute(item_%u,\n", i);
+    }
+    for (unsigned i = 0; i < repeats; i++) {
+        TraceAppend(&trace, &length, "save %s\n", savePath);
+    }
+    return trace;
+}
+
+/**
+ * @brief Reads a trace file.
+ *
+ * @param filePath Path to the file.
+ * @return The null-terminated content, or NULL on failure.
+ */
+static char* ReadTraceFile(const char* filePath) {
+    FILE* file = fopen(filePath, "rb");
+    if (!file) {
+        return NULL;
+    }
+    char* trace = NULL;
+    long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        trace = (char*)malloc((size_t)size + 1);
+        if (trace && fread(trace, 1, (size_t)size, file) == (size_t)size) {
+            trace[size] = '\0';
+        } else {
+            free(trace);
+            trace = NULL;
+        }
+    }
+    fclose(file);
+    return trace;
+}
+
+/**
+ * @brief Writes a string as a JSON string literal.
+ *
+ * @param out The output.
+ * @param text The string.
+ */
+static void WriteJsonString(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Orders latency samples.
+ *
+ * @param a First sample.
+ * @param b Second sample.
+ * @return Negative, zero or positive as a is less than, equal to or greater than b.
+ */
+static int CompareSamples(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Gets a percentile of sorted samples (nearest rank).
+ *
+ * @param samples The sorted samples.
+ * @param count Number of samples; at least one.
+ * @param perTenThousand The percentile in hundredths of a percent.
+ * @return The sample in microseconds.
+ */
+static double Percentile(const uint64_t* samples, size_t count, unsigned perTenThousand) {
+    size_t rank = (size_t)(((unsigned long long)count * perTenThousand + 9999) / 10000);
+    return (double)samples[rank > 0 ? rank - 1 : 0] / 1000.0;
+}
+
+/**
+ * @brief Writes the results of the scenarios as JSON.
+ *
+ * @param out The output.
+ * @param scenarios The scenarios.
+ * @param scenarioCount Number of scenarios.
+ */
+static void WriteResults(FILE* out, Scenario* scenarios, size_t scenarioCount) {
+#ifdef BENCH_COUNT_ALLOCATIONS
+    const char* counted = "true";
+#else
+    const char* counted = "false";
+#endif
+    fprintf(out, "{\n  \"benchmark\": \"editor_bench\",\n  \"format\": 1,\n");
+    fprintf(out, "  \"processors\": %u,\n  \"allocations_counted\": %s,\n  \"scenarios\": [", ThreadProcessorCount(),
+            counted);
+    for (size_t i = 0; i < scenarioCount; i++) {
+        Scenario* scenario = &scenarios[i];
+        fprintf(out, "%s\n    {\n      \"name\": ", i > 0 ? "," : "");
+        WriteJsonString(out, scenario->name);
+        fprintf(out, ",\n      \"failed\": %s,\n      \"seconds\": %.3f,\n      \"peak_rss_kb\": %llu,\n",
+                scenario->failed ? "true" : "false", scenario->seconds, scenario->peakMemoryKb);
+        fprintf(out, "      \"operations\": [");
+        for (size_t j = 0; j < scenario->operationCount; j++) {
+            OperationStats* stats = &scenario->operations[j];
+            qsort(stats->samples, stats->count, sizeof(uint64_t), CompareSamples);
+            double seconds = (double)stats->totalNs / 1e9;
+            fprintf(out, "%s\n        {\"name\": \"%s\", \"count\": %zu, \"total_ms\": %.3f, \"mean_us\": %.3f, ",
+                    j > 0 ? "," : "", stats->name, stats->count, seconds * 1e3,
+                    (double)stats->totalNs / 1000.0 / (double)stats->count);
+            fprintf(out, "\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f, ",
+                    Percentile(stats->samples, stats->count, 5000), Percentile(stats->samples, stats->count, 9900),
+                    Percentile(stats->samples, stats->count, 9990),
+                    (double)stats->samples[stats->count - 1] / 1000.0);
+            fprintf(out, "\"ops_per_second\": %.1f, \"bytes\": %llu, \"mb_per_second\": %.1f, ",
+                    seconds > 0 ? (double)stats->count / seconds : 0.0, (unsigned long long)stats->bytes,
+                    seconds > 0 ? (double)stats->bytes / 1048576.0 / seconds : 0.0);
+            fprintf(out, "\"allocations\": %llu, \"allocated_bytes\": %llu}", stats->allocations,
+                    stats->allocatedBytes);
+        }
+        fprintf(out, "\n      ],\n      \"memory\": {");
+        const MemoryStats* before = &scenario->memoryStart;
+        const MemoryStats* after = &scenario->memoryEnd;
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+            fprintf(out, "%s\n        \"%s\": {\"peak_bytes\": %llu, \"allocations\": %llu}", tag > 0 ? "," : "",
+                    MemoryTagName((MemoryTag)tag), (unsigned long long)after->tags[tag].peakBytes,
+                    (unsigned long long)(after->tags[tag].allocations - before->tags[tag].allocations));
+        }
+        fprintf(out, ",\n        \"pooled_allocations\": %llu\n      }\n    }",
+                (unsigned long long)(after->pooledAllocations - before->pooledAllocations));
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+/**
+ * @brief Prints the command line options.
+ */
+static void PrintUsage(void) {
+    fprintf(stderr,
+            "Usage: editor_bench [options]\n"
+            "  --trace FILE    Replay a trace file (may be repeated); no built-in traces run\n"
+            "  --sizes LIST    File sizes of the built-in open and save scenarios (default %s)\n"
+            "  --dir DIR       Directory for generated files (default $TMPDIR or /tmp)\n"
+            "  --output FILE   Write the JSON results to a file instead of standard output\n"
+            "  --keep-files    Keep the generated files\n",
+            BENCH_DEFAULT_SIZES);
+}
+
+/**
+ * @brief Runs the benchmark.
+ *
+ * @param argc Number of arguments.
+ * @param argv The arguments.
+ * @return 0 if every scenario ran, 1 otherwise.
+ */
+int main(int argc, char** argv) {
+    const char* sizes = BENCH_DEFAULT_SIZES;
+    const char* directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    const char* outputPath = NULL;
+    bool keepFiles = false;
+    const char** traces = (const char**)calloc((size_t)argc, sizeof(char*));
+    size_t traceCount = 0;
+    if (!traces) {
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+            traces[traceCount++] = argv[++i];
+        } else if (strcmp(argv[i], "--sizes") == 0 && hasValue) {
+            sizes = argv[++i];
+        } else if (strcmp(argv[i], "--dir") == 0 && hasValue) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--keep-files") == 0) {
+            keepFiles = true;
+        } else {
+            PrintUsage();
+            free(traces);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    size_t sizeCount = 1;
+    for (const char* p = sizes; *p; p++) {
+        sizeCount += *p == ',';
+    }
+    Scenario* scenarios = (Scenario*)calloc(traceCount + sizeCount + 3, sizeof(Scenario));
+    if (!scenarios) {
+        free(traces);
+        return 1;
+    }
+    size_t scenarioCount = 0;
+    bool succeeded = true;
+
+    if (traceCount > 0) {
+        for (size_t i = 0; i < traceCount; i++) {
+            Scenario* scenario = &scenarios[scenarioCount++];
+            const char* name = strrchr(traces[i], '/');
+            snprintf(scenario->name, sizeof(scenario->name), "%s", name ? name + 1 : traces[i]);
+            char* trace = ReadTraceFile(traces[i]);
+            if (!trace) {
+                fprintf(stderr, "editor_bench: cannot read %s\n", traces[i]);
+            }
+            succeeded = trace && RunScenario(scenario, trace) && succeeded;
+            scenario->failed = scenario->failed || !trace;
+            free(trace);
+        }
+    } else {
+        static const struct {
+            const char* name;
+            const char* pasteSize;
+            unsigned pasteCount;
+        } builtIns[] = {
+            { "typing", NULL, 0 },
+            { "paste-4K", "4K", 500 },
+            { "paste-1M", "1M", 20 },
+        };
+        for (size_t i = 0; i < sizeof(builtIns) / sizeof(builtIns[0]); i++) {
+            Scenario* scenario = &scenarios[scenarioCount++];
+            snprintf(scenario->name, sizeof(scenario->name), "%s", builtIns[i].name);
+            char* trace = builtIns[i].pasteSize ? BuildPasteTrace(builtIns[i].pasteSize, builtIns[i].pasteCount)
+                                                : BuildTypingTrace();
+            succeeded = trace && RunScenario(scenario, trace) && succeeded;
+            scenario->failed = scenario->failed || !trace;
+            free(trace);
+        }
+
+        char list[256];
+        snprintf(list, sizeof(list), "%s", sizes);
+        for (char* token = strtok(list, ","); token; token = strtok(NULL, ",")) {
+            Scenario* scenario = &scenarios[scenarioCount++];
+            snprintf(scenario->name, sizeof(scenario->name), "file-%s", token);
+            uint64_t size;
+            char filePath[4096];
+            char savePath[sizeof(filePath) + 8];
+            snprintf(filePath, sizeof(filePath), "%s/editor_bench_%ld_%s.txt", directory, (long)getpid(), token);
+            snprintf(savePath, sizeof(savePath), "%s.saved", filePath);
+            if (!ParseSize(token, &size) || size == 0) {
+                fprintf(stderr, "editor_bench: bad size '%s'\n", token);
+                scenario->failed = true;
+                succeeded = false;
+                continue;
+            }
+
+            fprintf(stderr, "editor_bench: writing %s test file\n", token);
+            char* trace = WriteGeneratedFile(filePath, size) ? BuildFileTrace(filePath, savePath, size) : NULL;
+            if (!trace) {
+                fprintf(stderr, "editor_bench: cannot write %s\n", filePath);
+            }
+            succeeded = trace && RunScenario(scenario, trace) && succeeded;
+            scenario->failed = scenario->failed || !trace;
+            free(trace);
+            if (!keepFiles) {
+                remove(filePath);
+                remove(savePath);
+            }
+        }
+    }
+
+    FILE* out = outputPath ? fopen(outputPath, "w") : stdout;
+    if (out) {
+        WriteResults(out, scenarios, scenarioCount);
+        if (out != stdout) {
+            fclose(out);
+        }
+    } else {
+        fprintf(stderr, "editor_bench: cannot write %s\n", outputPath);
+        succeeded = false;
+    }
+
+    for (size_t i = 0; i < scenarioCount; i++) {
+        for (size_t j = 0; j < scenarios[i].operationCount; j++) {
+            free(scenarios[i].operations[j].samples);
+        }
+    }
+    free(scenarios);
+    free(traces);
+    return succeeded ? 0 : 1;
+}
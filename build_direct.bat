@@ -28,7 +28,7 @@ REM Set compiler options
 set COMPILE_OPTIONS=/nologo /W4 /WX- /sdl /GS /Gy /O2 /std:c11 /D "_CRT_SECURE_NO_WARNINGS"
 
 REM List all source files
-set SOURCE_FILES=src\main.c src\window.c src\control.c src\fileops.c
+set SOURCE_FILES=src\main.c src\frame.c src\window.c src\control.c src\fileops.c src\filewriter.c src\hash.c src\mapfile.c src\lineindex.c src\session.c src\document.c src\cursors.c src\boundary.c src\boundarytables.c src\macro.c src\markers.c src\layout.c src\search.c src\linefilter.c src\timeindex.c src\textformat.c src\diff.c src\diffview.c src\clipboard.c src\structure.c src\folds.c src\spelldict.c src\spellcheck.c src\wordindex.c src\thread.c src\memory.c src\hexfile.c src\hexview.c src\linesort.c src\csvindex.c src\tableview.c src\jsonindex.c src\jsonoutline.c
 
 REM Compile
 echo Compiling source files...
@@ -0,0 +1,113 @@
+/**
+ * @file bitscan.h
+ * @brief Word-parallel byte classification for the Professional Text Editor
+ *
+ * Contains the helpers shared by the structural indexes: a 64-byte block is
+ * read as eight machine words and the bytes equal to a given byte become
+ * one bit each of a 64-bit mask, without a branch per byte and without
+ * processor-specific instructions.
+ */
+
+#ifndef BITSCAN_H
+#define BITSCAN_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Bytes classified into one mask
+#define BITSCAN_BLOCK_BYTES 64
+
+// Repeats a byte in every byte of a word
+#define BITSCAN_REPEAT(b) ((uint64_t)(b) * 0x0101010101010101ULL)
+
+/**
+ * @brief Reads eight bytes as a little-endian word.
+ *
+ * @param data The bytes.
+ * @return The word, with the first byte in the low bits.
+ */
+static inline uint64_t BitScanLoadWord(const unsigned char* data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+/**
+ * @brief Marks the bytes of a word equal to a byte.
+ *
+ * @param word Eight bytes.
+ * @param pattern The byte repeated in every byte.
+ * @return Bit i set when byte i of the word matched.
+ */
+static inline uint64_t BitScanMatchWord(uint64_t word, uint64_t pattern) {
+    uint64_t x = word ^ pattern;
+    uint64_t t = ((x & BITSCAN_REPEAT(0x7F)) + BITSCAN_REPEAT(0x7F)) | x;
+    uint64_t marks = ~t & BITSCAN_REPEAT(0x80);
+    return ((marks >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/**
+ * @brief Marks the bytes of a word above the space character.
+ *
+ * Bytes of 0x80 and above count as above the space, so every byte of a
+ * UTF-8 sequence is marked.
+ *
+ * @param word Eight bytes.
+ * @return Bit i set when byte i of the word is above 0x20.
+ */
+static inline uint64_t BitScanAboveSpace(uint64_t word) {
+    uint64_t marks = (((word & BITSCAN_REPEAT(0x7F)) + BITSCAN_REPEAT(0x5F)) | word) & BITSCAN_REPEAT(0x80);
+    return ((marks >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/**
+ * @brief Computes, for every bit, the XOR of it and all lower bits.
+ *
+ * Applied to a quote mask, a bit is set inside quoted text.
+ *
+ * @param mask The mask.
+ * @return The prefix XOR.
+ */
+static inline uint64_t BitScanPrefixXor(uint64_t mask) {
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+/**
+ * @brief Counts the set bits of a mask.
+ *
+ * @param mask The mask.
+ * @return The number of set bits.
+ */
+static inline unsigned BitScanCount(uint64_t mask) {
+    mask = mask - ((mask >> 1) & 0x5555555555555555ULL);
+    mask = (mask & 0x3333333333333333ULL) + ((mask >> 2) & 0x3333333333333333ULL);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned)((mask * 0x0101010101010101ULL) >> 56);
+}
+
+/**
+ * @brief Finds the lowest set bit of a mask.
+ *
+ * @param mask The mask; not zero.
+ * @return The index of the lowest set bit.
+ */
+static inline unsigned BitScanLowest(uint64_t mask) {
+    static const unsigned char positions[64] = {
+        0, 1, 2, 53, 3, 7, 54, 27, 4, 38, 41, 8, 34, 55, 48, 28,
+        62, 5, 39, 46, 44, 42, 22, 9, 24, 35, 59, 56, 49, 18, 29, 11,
+        63, 52, 6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+        51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12
+    };
+    return positions[((mask & (0 - mask)) * 0x022FDD63CC95386DULL) >> 58];
+}
+
+#endif /* BITSCAN_H */
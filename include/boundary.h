@@ -0,0 +1,154 @@
+/**
+ * @file boundary.h
+ * @brief Grapheme, word and line break boundaries for the Professional Text Editor
+ *
+ * Contains the text segmentation behind caret movement, word selection and
+ * word deletion. Boundaries are found by reading outwards from an offset,
+ * never from the start of its line, so a query costs the same in a short
+ * line and in a line of many megabytes.
+ *
+ * Grapheme clusters follow the extended grapheme cluster rules of Unicode
+ * (UAX #29): "\r\n", a character with its combining marks, a Hangul
+ * syllable, an emoji sequence joined by ZWJ and a flag are each one
+ * cluster. Words are runs of characters of the same BoundaryClass, with
+ * combining marks belonging to their base character, an apostrophe
+ * between letters kept inside a word ("don't") and '.' or ',' between
+ * ASCII digits kept inside a number ("3.14"). Line break opportunities
+ * follow a subset of UAX #14: after spaces and hyphens and around
+ * ideographs, never before closing punctuation or after opening
+ * punctuation.
+ *
+ * Properties come from a two-level table generated from the Unicode
+ * Character Database by tools/boundarytables.pl, and runs of ASCII are
+ * classified eight bytes at a time.
+ */
+
+#ifndef BOUNDARY_H
+#define BOUNDARY_H
+
+#include "document.h"
+
+// Classes of characters for word movement and selection
+typedef enum {
+    BOUNDARY_CLASS_SPACE,           // White space, line breaks included
+    BOUNDARY_CLASS_WORD,            // Letters, digits, marks and connectors such as '_'
+    BOUNDARY_CLASS_IDEOGRAPH,       // Han ideographs and kana
+    BOUNDARY_CLASS_PUNCTUATION      // Everything else
+} BoundaryClass;
+
+/**
+ * @brief Gets the end of the grapheme cluster starting at an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The next grapheme boundary, or the document length at the end.
+ */
+uint64_t BoundaryNextGrapheme(const Document* document, uint64_t offset);
+
+/**
+ * @brief Gets the start of the grapheme cluster ending at an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The previous grapheme boundary, or 0 at the start.
+ */
+uint64_t BoundaryPreviousGrapheme(const Document* document, uint64_t offset);
+
+/**
+ * @brief Gets the start of the next word.
+ *
+ * Skips the run of characters of the class found at the offset, unless it
+ * is white space, and then the white space after it.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The start of the next word, or the document length.
+ */
+uint64_t BoundaryNextWord(const Document* document, uint64_t offset);
+
+/**
+ * @brief Gets the start of the word before an offset.
+ *
+ * Skips the white space before the offset and then the run of characters
+ * of one class before it.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The start of the previous word, or 0.
+ */
+uint64_t BoundaryPreviousWord(const Document* document, uint64_t offset);
+
+/**
+ * @brief Finds the word or ideograph run touching an offset.
+ *
+ * The run starting at the offset is preferred to the one ending there.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @param[out] start Receives the start of the word.
+ * @param[out] end Receives the end of the word.
+ * @return true if a word was found, false if the offset touches only space and punctuation.
+ */
+bool BoundaryWordAt(const Document* document, uint64_t offset, uint64_t* start, uint64_t* end);
+
+/**
+ * @brief Gets the first line break opportunity after an offset.
+ *
+ * Hard line breaks count as opportunities.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The offset at which a line may be broken, or the document length.
+ */
+uint64_t BoundaryNextLineBreak(const Document* document, uint64_t offset);
+
+/**
+ * @brief Gets the last line break opportunity before an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The offset at which a line may be broken, or 0.
+ */
+uint64_t BoundaryPreviousLineBreak(const Document* document, uint64_t offset);
+
+/**
+ * @brief Gets the end of the grapheme cluster starting at an offset of a text.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The next grapheme boundary, or the length at the end.
+ */
+size_t BoundaryTextNextGrapheme(const char* text, size_t length, size_t offset);
+
+/**
+ * @brief Gets the start of the grapheme cluster ending at an offset of a text.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The previous grapheme boundary, or 0 at the start.
+ */
+size_t BoundaryTextPreviousGrapheme(const char* text, size_t length, size_t offset);
+
+/**
+ * @brief Gets the start of the next word of a text, as BoundaryNextWord does.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The start of the next word, or the length.
+ */
+size_t BoundaryTextNextWord(const char* text, size_t length, size_t offset);
+
+/**
+ * @brief Gets the start of the word before an offset of a text, as BoundaryPreviousWord does.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The start of the previous word, or 0.
+ */
+size_t BoundaryTextPreviousWord(const char* text, size_t length, size_t offset);
+
+#endif /* BOUNDARY_H */
@@ -0,0 +1,85 @@
+/**
+ * @file clipboard.h
+ * @brief Clipboard access for the Professional Text Editor
+ *
+ * Contains a small platform layer over the system clipboard. Copying from
+ * a document only stores a slice of its pieces; the text is produced when
+ * another application asks for it (delayed rendering on Windows) or never,
+ * when it is pasted back into the editor. Other platforms use an in-process
+ * clipboard with the same behavior.
+ */
+
+#ifndef CLIPBOARD_H
+#define CLIPBOARD_H
+
+#include "document.h"
+
+/**
+ * @brief Callback receiving the text held by the clipboard.
+ *
+ * @param text The text; only valid during the call.
+ * @param length Length of the text.
+ * @param context The context pointer given to ClipboardReadText.
+ * @return The result passed back by ClipboardReadText.
+ */
+typedef bool (*ClipboardTextCallback)(const char* text, size_t length, void* context);
+
+/**
+ * @brief Places a slice on the clipboard without rendering its text.
+ *
+ * @param owner Window that renders the text on request (HWND on Windows).
+ * @param slice The slice; ownership is transferred to the clipboard.
+ * @return true if successful, false otherwise (the slice is then released).
+ */
+bool ClipboardSetSlice(void* owner, DocumentSlice* slice);
+
+/**
+ * @brief Places a copy of a text on the clipboard.
+ *
+ * @param owner Window that owns the clipboard (HWND on Windows).
+ * @param text The text (may be NULL if length is 0).
+ * @param length Length of the text.
+ * @return true if successful, false otherwise.
+ */
+bool ClipboardSetText(void* owner, const char* text, size_t length);
+
+/**
+ * @brief Gets the slice placed on the clipboard by this process.
+ *
+ * @return The slice, owned by the clipboard, or NULL if the clipboard holds
+ *         no slice (for example because another application replaced it).
+ */
+DocumentSlice* ClipboardGetSlice(void);
+
+/**
+ * @brief Passes the clipboard text to a callback without copying it.
+ *
+ * @param owner Window opening the clipboard (HWND on Windows).
+ * @param callback Invoked once with the text.
+ * @param context Pointer passed to the callback.
+ * @return The result of the callback, or false if the clipboard holds no text.
+ */
+bool ClipboardReadText(void* owner, ClipboardTextCallback callback, void* context);
+
+/**
+ * @brief Renders the slice as text while the system clipboard is open (WM_RENDERFORMAT).
+ *
+ * @return true if the text was rendered, false otherwise.
+ */
+bool ClipboardRender(void);
+
+/**
+ * @brief Renders the slice before its owner goes away (WM_RENDERALLFORMATS).
+ *
+ * The slice is released afterwards, since the rendered text outlives it.
+ *
+ * @param owner Window that owns the clipboard (HWND on Windows).
+ */
+void ClipboardRenderAll(void* owner);
+
+/**
+ * @brief Releases the slice once the clipboard no longer holds it (WM_DESTROYCLIPBOARD).
+ */
+void ClipboardRelease(void);
+
+#endif /* CLIPBOARD_H */
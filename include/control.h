@@ -3,12 +3,61 @@
  * @brief Editor control functionality for the Professional Text Editor
  *
  * Contains functions for creating and managing the text editor control.
+ * The control is a custom view over a Document that supports multiple
+ * carets; every command is applied to all carets as one edit batch.
+ * Long-running commands report their progress to the parent window with
+ * WM_EDITOR_PROGRESS, and macro recording is announced with
+ * WM_EDITOR_MACRO_RECORDING.
  */
 
 #ifndef CONTROL_H
 #define CONTROL_H
 
 #include "editor.h"
+#include "document.h"
+#include "folds.h"
+#include "spelldict.h"
+
+// Window class of the editor view
+#define EDITOR_VIEW_CLASS_NAME "PROFESSIONAL_TEXTEDITOR_VIEW"
+
+// Commands understood by ExecuteEditorCommand
+typedef enum {
+    EDITOR_COMMAND_UNDO,
+    EDITOR_COMMAND_REDO,
+    EDITOR_COMMAND_CUT,
+    EDITOR_COMMAND_COPY,
+    EDITOR_COMMAND_PASTE,
+    EDITOR_COMMAND_SELECT_ALL,
+    EDITOR_COMMAND_ADD_CURSOR_ABOVE,
+    EDITOR_COMMAND_ADD_CURSOR_BELOW,
+    EDITOR_COMMAND_ADD_NEXT_OCCURRENCE,
+    EDITOR_COMMAND_SELECT_ALL_OCCURRENCES,
+    EDITOR_COMMAND_TOGGLE_FOLD,
+    EDITOR_COMMAND_UNFOLD_ALL,
+    EDITOR_COMMAND_NEXT_FOLD,
+    EDITOR_COMMAND_PREVIOUS_FOLD,
+    EDITOR_COMMAND_MATCH_BRACKET,
+    EDITOR_COMMAND_TOGGLE_BOOKMARK,     // Bookmarks the line of the primary caret, or removes its bookmark
+    EDITOR_COMMAND_NEXT_BOOKMARK,
+    EDITOR_COMMAND_PREVIOUS_BOOKMARK,
+    EDITOR_COMMAND_CLEAR_BOOKMARKS,
+    EDITOR_COMMAND_COMPLETE_WORD,
+    EDITOR_COMMAND_SORT_LINES,          // Sorts the selected lines in the background
+    EDITOR_COMMAND_UNIQUE_LINES,        // Sorts the selected lines and drops repeated ones
+    EDITOR_COMMAND_CANCEL_SORT,
+    EDITOR_COMMAND_RECORD_MACRO,        // Starts or stops recording typing, deleting and caret movement
+    EDITOR_COMMAND_PLAY_MACRO,          // Plays the macro once at the carets
+    EDITOR_COMMAND_PLAY_MACRO_TO_END,   // Plays the macro until the carets reach the end of the document
+    EDITOR_COMMAND_PLAY_MACRO_ON_LINES, // Plays the macro on each selected line, or every line
+    EDITOR_COMMAND_PLAY_MACRO_ON_MATCHES, // Plays the macro on each line containing the selected text
+    EDITOR_COMMAND_FILTER_LINES,        // Shows only the lines containing the selected text
+    EDITOR_COMMAND_SHOW_ALL_LINES,      // Shows every line again, keeping the caret
+    EDITOR_COMMAND_GO_TO_TIME,          // Moves to the first log line at or after the selected time
+    EDITOR_COMMAND_TRIM_TRAILING_WHITESPACE, // Removes the spaces and tabs ending each line
+    EDITOR_COMMAND_EXPAND_TABS,         // Replaces each tab with spaces up to the next tab stop
+    EDITOR_COMMAND_ADD_FINAL_NEWLINE    // Ends the document with a line break if it has none
+} EditorCommand;
 
 /**
  * @brief Creates the text editor control within the parent window.
@@ -44,4 +93,103 @@ BOOL SetEditorText(HWND hEdit, const char* text);
  */
 void ClearEditorText(HWND hEdit);
 
+/**
+ * @brief Gets the selection and scroll position of the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param[out] viewState Receives the caret, anchor and first visible line.
+ */
+void GetEditorViewState(HWND hEdit, DocumentViewState* viewState);
+
+/**
+ * @brief Restores the selection and scroll position of the editor control.
+ *
+ * Positions beyond the end of the current text are clamped by the control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param viewState The caret, anchor and first visible line to restore.
+ */
+void SetEditorViewState(HWND hEdit, const DocumentViewState* viewState);
+
+/**
+ * @brief Gets the folds of the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param[out] folds Receives the folds, sorted by hideStart; valid until the folds or the document change.
+ * @return The number of folds.
+ */
+size_t GetEditorFolds(HWND hEdit, const Fold** folds);
+
+/**
+ * @brief Replaces the folds of the editor control.
+ *
+ * Folds that do not hide whole lines of the current document are dropped.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param folds The folds, as returned by GetEditorFolds for the same content.
+ * @param count Number of folds.
+ */
+void SetEditorFolds(HWND hEdit, const Fold* folds, size_t count);
+
+/**
+ * @brief Replaces the document shown by the editor control.
+ *
+ * The caret is moved to the start of the document and the view scrolled
+ * to the top.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param document The new document; ownership is transferred to the control.
+ * @return TRUE if successful, FALSE otherwise (the document is then destroyed).
+ */
+BOOL SetEditorDocument(HWND hEdit, Document* document);
+
+/**
+ * @brief Gets the document shown by the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @return The document, owned by the control, or NULL on failure.
+ */
+Document* GetEditorDocument(HWND hEdit);
+
+/**
+ * @brief Executes an editing command on every caret of the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param command The command to execute.
+ * @return TRUE if the command changed the document or the selection, FALSE otherwise.
+ */
+BOOL ExecuteEditorCommand(HWND hEdit, EditorCommand command);
+
+/**
+ * @brief Applies edits made outside the editor control as one undoable step.
+ *
+ * The carets move with the text, as for any change made by someone else.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param edits The edits, sorted, in the coordinates of the current content.
+ * @param editCount Number of edits.
+ * @return TRUE if the document changed, FALSE if the control is read-only, sorting, or the edits failed.
+ */
+BOOL ApplyEditorEdits(HWND hEdit, const DocumentEdit* edits, size_t editCount);
+
+/**
+ * @brief Allows or refuses edits made through the editor control.
+ *
+ * A read-only control still supports selection, copying and scrolling.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param readOnly TRUE to refuse edits, FALSE to allow them.
+ */
+void SetEditorReadOnly(HWND hEdit, BOOL readOnly);
+
+/**
+ * @brief Starts or stops background spell checking in the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param dictionary The dictionary, or NULL to stop spell checking. It must
+ *        stay open until spell checking is stopped or the control destroyed.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL SetEditorSpellChecking(HWND hEdit, const SpellDict* dictionary);
+
 #endif /* CONTROL_H */
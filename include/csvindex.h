@@ -0,0 +1,146 @@
+/**
+ * @file csvindex.h
+ * @brief Structural index of delimited text for the Professional Text Editor
+ *
+ * Contains the row index behind the table view of CSV and TSV files. One
+ * pass classifies 64 bytes at a time, eight per machine word, into quote
+ * and line feed bit masks, tracks quoted regions with a prefix XOR of the
+ * quote mask, and records the start of every CSV_INDEX_ROW_STRIDE-th row,
+ * so row N is found by a lookup and a short scan while the index stays a
+ * small fraction of the file. Fields are only parsed for the rows shown, the
+ * sampled rows that size the columns, and the column being sorted.
+ */
+
+#ifndef CSVINDEX_H
+#define CSVINDEX_H
+
+#include "document.h"
+
+// Rows between two recorded row starts
+#define CSV_INDEX_ROW_STRIDE 64
+
+// Rows sampled to size the columns
+#define CSV_INDEX_SAMPLE_ROWS 1024
+
+// Widest column, in characters, sized from the samples
+#define CSV_INDEX_MAX_WIDTH 40
+
+// Index of the rows of a document
+typedef struct CsvIndex CsvIndex;
+
+// One field of a row, as stored in the document
+typedef struct {
+    uint64_t offset;            // Start of the field, including its opening quote
+    uint64_t length;            // Length of the field, including its quotes
+    bool quoted;                // The field is enclosed in quotes; doubled quotes inside stand for one
+} CsvField;
+
+/**
+ * @brief Guesses the delimiter of a document from its first lines.
+ *
+ * Comma, tab, semicolon and vertical bar are tried; the one found the same
+ * number of times on the most lines wins.
+ *
+ * @param document The document.
+ * @return The delimiter; a comma when nothing fits better.
+ */
+char CsvSniffDelimiter(const Document* document);
+
+/**
+ * @brief Builds the row index of a document.
+ *
+ * Line feeds inside quoted fields do not end a row. The document must not
+ * change while the index is in use.
+ *
+ * @param document The document.
+ * @param delimiter Field delimiter, or 0 to guess it with CsvSniffDelimiter.
+ * @return The index, or NULL on failure.
+ */
+CsvIndex* CsvIndexBuild(const Document* document, char delimiter);
+
+/**
+ * @brief Releases a row index.
+ *
+ * @param index The index, or NULL.
+ */
+void CsvIndexDestroy(CsvIndex* index);
+
+/**
+ * @brief Gets the field delimiter of an index.
+ *
+ * @param index The index.
+ * @return The delimiter.
+ */
+char CsvIndexDelimiter(const CsvIndex* index);
+
+/**
+ * @brief Gets the number of rows of an index.
+ *
+ * @param index The index.
+ * @return The row count; a final line feed does not start another row.
+ */
+uint64_t CsvIndexRowCount(const CsvIndex* index);
+
+/**
+ * @brief Gets the offset where a row starts.
+ *
+ * @param index The index.
+ * @param row The row; clamped to the last row.
+ * @return The offset of the row's first byte.
+ */
+uint64_t CsvIndexRowStart(const CsvIndex* index, uint64_t row);
+
+/**
+ * @brief Splits the row starting at an offset into fields.
+ *
+ * @param index The index.
+ * @param offset Start of the row.
+ * @param[out] fields Receives the first fields of the row; may be NULL when maxFields is 0.
+ * @param maxFields Capacity of fields.
+ * @param[out] next Receives the start of the following row; may be NULL.
+ * @return Number of fields in the row, which may exceed maxFields.
+ */
+size_t CsvIndexParseRow(const CsvIndex* index, uint64_t offset, CsvField* fields, size_t maxFields,
+                        uint64_t* next);
+
+/**
+ * @brief Copies the text of a field without its quotes.
+ *
+ * Doubled quotes are copied as one, and the text is cut to the buffer.
+ *
+ * @param index The index.
+ * @param field The field.
+ * @param[out] buffer Receives the text, NUL-terminated.
+ * @param size Size of the buffer; at least 1.
+ * @return Length of the copied text.
+ */
+size_t CsvIndexFieldText(const CsvIndex* index, const CsvField* field, char* buffer, size_t size);
+
+/**
+ * @brief Sizes the columns from rows sampled across the document.
+ *
+ * @param index The index.
+ * @param[out] widths Receives the width of each column, at most CSV_INDEX_MAX_WIDTH.
+ * @param maxColumns Capacity of widths.
+ * @return Number of columns found, at most maxColumns.
+ */
+size_t CsvIndexSampleWidths(const CsvIndex* index, uint32_t* widths, size_t maxColumns);
+
+/**
+ * @brief Orders the rows by one column.
+ *
+ * Columns whose sampled values are nearly all numbers are compared as
+ * numbers, with other values last; other columns by their bytes. Equal
+ * values keep the file order. The fields of the column are read now, not
+ * when the index was built.
+ *
+ * @param index The index.
+ * @param column The column.
+ * @param firstRow First row sorted; rows before it (a header) are left out.
+ * @param descending true for the largest value first.
+ * @return The starts of rows firstRow and later in sorted order, to be freed
+ *         with free(), or NULL on failure or when there are no such rows.
+ */
+uint64_t* CsvIndexSortRows(const CsvIndex* index, size_t column, uint64_t firstRow, bool descending);
+
+#endif /* CSVINDEX_H */
@@ -0,0 +1,257 @@
+/**
+ * @file cursors.h
+ * @brief Multiple carets and selections for the Professional Text Editor
+ *
+ * Contains the cursor set that turns one keystroke into one batch of edits
+ * over every caret. Selections are kept sorted and non-overlapping so a
+ * batch can be built, applied and the carets adjusted in a single pass.
+ */
+
+#ifndef CURSORS_H
+#define CURSORS_H
+
+#include "document.h"
+
+// Marks a selection that has no remembered column for vertical movement
+#define CURSOR_NO_COLUMN UINT64_MAX
+
+// One caret with an optional selection
+typedef struct {
+    uint64_t anchor;            // Fixed end of the selection
+    uint64_t caret;             // Moving end of the selection
+    uint64_t preferredColumn;   // Column kept across vertical moves, or CURSOR_NO_COLUMN
+} Selection;
+
+// Sorted, non-overlapping selections
+typedef struct {
+    Selection* items;
+    size_t count;
+    size_t capacity;
+    size_t primary;             // Index of the selection that scrolls into view
+} CursorSet;
+
+// Caret movements understood by CursorSetMove
+typedef enum {
+    CURSOR_MOVE_LEFT,
+    CURSOR_MOVE_RIGHT,
+    CURSOR_MOVE_UP,
+    CURSOR_MOVE_DOWN,
+    CURSOR_MOVE_WORD_LEFT,
+    CURSOR_MOVE_WORD_RIGHT,
+    CURSOR_MOVE_LINE_START,
+    CURSOR_MOVE_LINE_END,
+    CURSOR_MOVE_PAGE_UP,
+    CURSOR_MOVE_PAGE_DOWN,
+    CURSOR_MOVE_DOCUMENT_START,
+    CURSOR_MOVE_DOCUMENT_END
+} CursorMovement;
+
+/**
+ * @brief Gets the lower end of a selection.
+ *
+ * @param selection The selection.
+ * @return The smaller of anchor and caret.
+ */
+static inline uint64_t SelectionStart(const Selection* selection) {
+    return selection->anchor < selection->caret ? selection->anchor : selection->caret;
+}
+
+/**
+ * @brief Gets the upper end of a selection.
+ *
+ * @param selection The selection.
+ * @return The larger of anchor and caret.
+ */
+static inline uint64_t SelectionEnd(const Selection* selection) {
+    return selection->anchor > selection->caret ? selection->anchor : selection->caret;
+}
+
+/**
+ * @brief Initializes a cursor set with a single caret at offset 0.
+ *
+ * @param cursors The cursor set.
+ * @return true if successful, false on allocation failure.
+ */
+bool CursorSetInit(CursorSet* cursors);
+
+/**
+ * @brief Releases the memory held by a cursor set.
+ *
+ * @param cursors The cursor set.
+ */
+void CursorSetFree(CursorSet* cursors);
+
+/**
+ * @brief Replaces all selections with one selection.
+ *
+ * @param cursors The cursor set.
+ * @param anchor Anchor of the selection.
+ * @param caret Caret of the selection.
+ */
+void CursorSetReset(CursorSet* cursors, uint64_t anchor, uint64_t caret);
+
+/**
+ * @brief Adds a selection and makes it primary.
+ *
+ * Overlapping selections are merged.
+ *
+ * @param cursors The cursor set.
+ * @param anchor Anchor of the new selection.
+ * @param caret Caret of the new selection.
+ * @return true if successful, false on allocation failure.
+ */
+bool CursorSetAdd(CursorSet* cursors, uint64_t anchor, uint64_t caret);
+
+/**
+ * @brief Sorts the selections and merges the ones that overlap.
+ *
+ * @param cursors The cursor set.
+ */
+void CursorSetNormalize(CursorSet* cursors);
+
+/**
+ * @brief Finds the first selection that ends at or after an offset.
+ *
+ * @param cursors The cursor set (normalized).
+ * @param offset The offset.
+ * @return Index of the selection, or cursors->count if none.
+ */
+size_t CursorSetFindFirst(const CursorSet* cursors, uint64_t offset);
+
+/**
+ * @brief Moves every caret.
+ *
+ * @param cursors The cursor set.
+ * @param document The document the carets are in.
+ * @param movement The movement to apply.
+ * @param extend true to extend the selections, false to collapse them.
+ * @param pageLines Number of lines moved by page movements.
+ */
+void CursorSetMove(CursorSet* cursors, const Document* document, CursorMovement movement, bool extend,
+                   uint64_t pageLines);
+
+/**
+ * @brief Replaces every selection with the same text as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param text The text to insert.
+ * @param textLength Length of the text.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetInsert(CursorSet* cursors, Document* document, const char* text, size_t textLength);
+
+/**
+ * @brief Replaces each selection with its own text as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param texts One text per selection, in selection order.
+ * @param textLengths Length of each text.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetInsertEach(CursorSet* cursors, Document* document, const char* const* texts,
+                         const size_t* textLengths);
+
+/**
+ * @brief Replaces each selection with a slice of the document as one batch.
+ *
+ * The pieces of the slices are shared, so no text is copied however large
+ * the slices are.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param slices One slice of the document per selection, in selection order.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetInsertSlices(CursorSet* cursors, Document* document, const DocumentSlice* const* slices);
+
+/**
+ * @brief Deletes the selections, or the grapheme cluster before each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteBackward(CursorSet* cursors, Document* document);
+
+/**
+ * @brief Deletes the selections, or the grapheme cluster after each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteForward(CursorSet* cursors, Document* document);
+
+/**
+ * @brief Deletes the selections, or back to the start of the word before each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteWordBackward(CursorSet* cursors, Document* document);
+
+/**
+ * @brief Deletes the selections, or up to the start of the next word after each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteWordForward(CursorSet* cursors, Document* document);
+
+/**
+ * @brief Adds a caret on the line above the first caret or below the last one.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @param below true to add below the last caret, false to add above the first.
+ * @return true if a caret was added, false otherwise.
+ */
+bool CursorSetAddVertical(CursorSet* cursors, const Document* document, bool below);
+
+/**
+ * @brief Selects the next occurrence of the primary selection.
+ *
+ * With an empty primary selection, the word around the caret is selected
+ * instead.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @return true if the selection changed, false otherwise.
+ */
+bool CursorSetAddNextOccurrence(CursorSet* cursors, const Document* document);
+
+/**
+ * @brief Selects every occurrence of the primary selection.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @return true if the selection changed, false otherwise.
+ */
+bool CursorSetSelectAllOccurrences(CursorSet* cursors, const Document* document);
+
+/**
+ * @brief Places a caret at the end of every change (used after undo and redo).
+ *
+ * @param cursors The cursor set.
+ * @param changes The changes that were applied.
+ * @param changeCount Number of changes.
+ */
+void CursorSetPlaceAfterChanges(CursorSet* cursors, const DocumentChange* changes, size_t changeCount);
+
+/**
+ * @brief Moves the selections through changes made outside the cursor set.
+ *
+ * Offsets after a change shift by its size; offsets inside a removed range
+ * move to the end of the text that replaced it.
+ *
+ * @param cursors The cursor set.
+ * @param changes The changes, sorted and in pre-change coordinates.
+ * @param changeCount Number of changes.
+ */
+void CursorSetMapChanges(CursorSet* cursors, const DocumentChange* changes, size_t changeCount);
+
+#endif /* CURSORS_H */
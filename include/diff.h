@@ -0,0 +1,74 @@
+/**
+ * @file diff.h
+ * @brief Line diff between a document and a text for the Professional Text Editor
+ *
+ * Contains the line diff used to compare the document being edited with
+ * the file on disk. Lines are compared by 64-bit hash, the common prefix
+ * and suffix are trimmed before the Myers algorithm runs, and runs of the
+ * document that still reference the loaded file are skipped entirely.
+ */
+
+#ifndef DIFF_H
+#define DIFF_H
+
+#include "document.h"
+
+// Lines of unchanged context shown around each hunk by DiffFormatUnified
+#define DIFF_CONTEXT_LINES 3
+
+// One block of changed lines; a count of 0 marks a pure insertion or deletion
+typedef struct {
+    uint64_t oldLine;       // First line in the old text (zero-based)
+    uint64_t oldCount;      // Number of old lines removed
+    uint64_t newLine;       // First line in the document (zero-based)
+    uint64_t newCount;      // Number of document lines inserted
+} DiffHunk;
+
+// Ordered list of hunks
+typedef struct {
+    DiffHunk* hunks;
+    size_t count;
+    size_t capacity;
+} DiffResult;
+
+/**
+ * @brief Computes the line differences between a text and a document.
+ *
+ * @param document The new side of the comparison.
+ * @param oldText The old side of the comparison (may be NULL if oldLength is 0).
+ * @param oldLength Length of the old text.
+ * @param oldLines Line index of the old text, or NULL to build one.
+ * @param sharesOriginal true if oldText is the original content of the
+ *        document, so that runs still referencing it are known to be equal.
+ * @param[out] result Receives the hunks; free with DiffResultFree.
+ * @return true if successful, false on allocation failure.
+ */
+bool DiffDocumentAgainstText(const Document* document, const char* oldText, uint64_t oldLength,
+                             const LineIndex* oldLines, bool sharesOriginal, DiffResult* result);
+
+/**
+ * @brief Formats a diff result as unified diff text.
+ *
+ * @param document The new side of the comparison.
+ * @param oldText The old side of the comparison.
+ * @param oldLength Length of the old text.
+ * @param oldLines Line index of the old text, or NULL to build one.
+ * @param result The hunks computed by DiffDocumentAgainstText.
+ * @param oldName Name shown for the old side.
+ * @param newName Name shown for the new side.
+ * @param[out] textLength Receives the length of the returned text.
+ * @return A newly allocated NUL-terminated string, or NULL on failure.
+ *         The caller is responsible for freeing this memory.
+ */
+char* DiffFormatUnified(const Document* document, const char* oldText, uint64_t oldLength,
+                        const LineIndex* oldLines, const DiffResult* result, const char* oldName,
+                        const char* newName, size_t* textLength);
+
+/**
+ * @brief Releases the memory held by a diff result.
+ *
+ * @param result The diff result.
+ */
+void DiffResultFree(DiffResult* result);
+
+#endif /* DIFF_H */
@@ -0,0 +1,29 @@
+/**
+ * @file diffview.h
+ * @brief Diff window for the Professional Text Editor
+ *
+ * Contains the window that shows the unified diff between the document
+ * being edited and the file on disk in a read-only editor view.
+ */
+
+#ifndef DIFFVIEW_H
+#define DIFFVIEW_H
+
+#include "editor.h"
+#include "document.h"
+
+// Window class of the diff window
+#define DIFF_WINDOW_CLASS_NAME "PROFESSIONAL_TEXTEDITOR_DIFF"
+
+/**
+ * @brief Opens a window showing a document read-only.
+ *
+ * @param hOwner Handle to the owner window.
+ * @param hInstance Handle to the application instance.
+ * @param title Caption of the window.
+ * @param document The document to show; ownership is transferred to the window.
+ * @return Handle to the window, or NULL if it could not be created (the document is then destroyed).
+ */
+HWND ShowDiffWindow(HWND hOwner, HINSTANCE hInstance, const char* title, Document* document);
+
+#endif /* DIFFVIEW_H */
@@ -0,0 +1,503 @@
+/**
+ * @file document.h
+ * @brief Document storage for the Professional Text Editor
+ *
+ * Contains the piece table that holds the text being edited. The original
+ * file stays memory-mapped and every insertion is appended to add buffers,
+ * so opening a file costs a mapping and an edit costs work proportional to
+ * the edit, not to the document size.
+ *
+ * Pieces are grouped into reference-counted chunks, and each edit batch
+ * produces a new immutable version that shares the chunks it did not touch.
+ * Undo and redo switch between versions. A snapshot pins one version so
+ * that another thread can read it while editing goes on.
+ */
+
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include "lineindex.h"
+#include "mapfile.h"
+
+// Maximum number of batches kept for undo
+#define DOCUMENT_MAX_HISTORY 1000
+
+typedef struct Document Document;
+typedef struct DocumentVersion DocumentVersion;
+typedef struct DocumentSlice DocumentSlice;
+typedef struct DocumentSnapshot DocumentSnapshot;
+
+// One replacement inside an edit batch, in pre-edit coordinates
+typedef struct {
+    uint64_t offset;            // Start of the replaced range
+    uint64_t removeLength;      // Number of bytes removed
+    const char* text;           // Inserted text (may be NULL if textLength is 0)
+    size_t textLength;          // Number of bytes inserted
+    const DocumentSlice* slice; // Inserted content shared from a slice instead of text, or NULL
+} DocumentEdit;
+
+// A byte range of a document
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+} DocumentRange;
+
+// Summary of one replacement reported to listeners, in pre-change coordinates
+typedef struct {
+    uint64_t offset;          // Start of the replaced range
+    uint64_t removedLength;   // Number of bytes removed
+    uint64_t insertedLength;  // Number of bytes inserted
+} DocumentChange;
+
+/**
+ * @brief Callback invoked after the document content changed.
+ *
+ * Changes are sorted, do not overlap, and are expressed in the
+ * coordinates of the document before the change.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes.
+ * @param changeCount Number of changes.
+ * @param context The context pointer given at registration.
+ */
+typedef void (*DocumentListener)(Document* document, const DocumentChange* changes, size_t changeCount,
+                                 void* context);
+
+/**
+ * @brief Callback receiving a run of the document that still shows original content.
+ *
+ * @param offset Offset of the run in the document.
+ * @param originalOffset Offset of the same bytes in the original content.
+ * @param length Length of the run.
+ * @param context The context pointer given to DocumentForEachOriginalRun.
+ * @return true to continue, false to stop.
+ */
+typedef bool (*DocumentOriginalRunCallback)(uint64_t offset, uint64_t originalOffset, uint64_t length,
+                                            void* context);
+
+// Read position inside a document, used to stream its content span by span
+typedef struct {
+    const struct DocumentBuffer* buffers;   // Buffer table the pieces point into
+    const DocumentVersion* version;
+    const struct PieceChunk* chunk;         // Current chunk, NULL at the end
+    uint64_t chunkEnd;      // Offset just past the current chunk
+    uint32_t piece;         // Current piece within the chunk
+    uint64_t skip;          // Bytes to skip at the start of the current piece
+} DocumentIterator;
+
+/**
+ * @brief Creates a document holding a copy of the given text.
+ *
+ * @param text The initial text (may be NULL if length is 0).
+ * @param length Length of the text in bytes.
+ * @return The new document, or NULL on allocation failure.
+ */
+Document* DocumentCreateFromText(const char* text, size_t length);
+
+/**
+ * @brief Creates a document backed by a memory-mapped file.
+ *
+ * @param mappedFile The mapping; ownership is transferred to the document.
+ * @param lineIndex Line index of the mapping, or NULL to build one. When not
+ *        NULL, ownership of its storage is transferred to the document.
+ * @return The new document, or NULL on failure (the mapping is then closed).
+ */
+Document* DocumentCreateFromMapping(MappedFile* mappedFile, LineIndex* lineIndex);
+
+/**
+ * @brief Destroys a document and releases all of its memory and mappings.
+ *
+ * @param document The document to destroy. NULL is ignored.
+ */
+void DocumentDestroy(Document* document);
+
+/**
+ * @brief Gets the document length in bytes.
+ *
+ * @param document The document.
+ * @return The length in bytes.
+ */
+uint64_t DocumentLength(const Document* document);
+
+/**
+ * @brief Gets the number of lines (line feeds plus one).
+ *
+ * @param document The document.
+ * @return The line count, at least 1.
+ */
+uint64_t DocumentLineCount(const Document* document);
+
+/**
+ * @brief Gets the offset at which a line starts.
+ *
+ * @param document The document.
+ * @param line Zero-based line number; clamped to the last line.
+ * @return Byte offset of the first character of the line.
+ */
+uint64_t DocumentLineStart(const Document* document, uint64_t line);
+
+/**
+ * @brief Gets the offset at which the content of a line ends.
+ *
+ * The line terminator ("\n" or "\r\n") is not part of the content.
+ *
+ * @param document The document.
+ * @param line Zero-based line number; clamped to the last line.
+ * @return Byte offset just past the last content character of the line.
+ */
+uint64_t DocumentLineEnd(const Document* document, uint64_t line);
+
+/**
+ * @brief Finds the line containing a byte offset.
+ *
+ * @param document The document.
+ * @param offset Byte offset; clamped to the document length.
+ * @return Zero-based line number.
+ */
+uint64_t DocumentLineFromOffset(const Document* document, uint64_t offset);
+
+/**
+ * @brief Copies a range of the document into a buffer.
+ *
+ * @param document The document.
+ * @param offset Start of the range.
+ * @param[out] buffer Receives the bytes (not NUL-terminated).
+ * @param length Number of bytes requested.
+ * @return Number of bytes copied (less than length at the end of the document).
+ */
+size_t DocumentRead(const Document* document, uint64_t offset, char* buffer, size_t length);
+
+/**
+ * @brief Gets the byte at an offset.
+ *
+ * @param document The document.
+ * @param offset Byte offset.
+ * @return The byte, or '\0' if the offset is past the end.
+ */
+char DocumentCharAt(const Document* document, uint64_t offset);
+
+/**
+ * @brief Copies a range of the document into a new NUL-terminated string.
+ *
+ * @param document The document.
+ * @param offset Start of the range.
+ * @param length Number of bytes to copy; clamped to the document end.
+ * @return A newly allocated string, or NULL on failure.
+ *         The caller is responsible for freeing this memory.
+ */
+char* DocumentCopyRange(const Document* document, uint64_t offset, uint64_t length);
+
+/**
+ * @brief Positions an iterator at a byte offset.
+ *
+ * @param document The document.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize.
+ */
+void DocumentIterInit(const Document* document, uint64_t offset, DocumentIterator* iterator);
+
+/**
+ * @brief Returns the next contiguous span of the document.
+ *
+ * Spans point directly into the document storage and stay valid until the
+ * document is destroyed.
+ *
+ * @param iterator The iterator.
+ * @param[out] data Receives a pointer to the span.
+ * @param[out] length Receives the span length.
+ * @return true if a span was returned, false at the end of the document.
+ */
+bool DocumentIterNext(DocumentIterator* iterator, const char** data, size_t* length);
+
+/**
+ * @brief Applies a batch of edits as one undoable step.
+ *
+ * Edits must be sorted by offset and must not overlap; they are applied in
+ * a single pass over the piece table and notified to listeners once. An
+ * edit that inserts a slice must use a slice of this document and set
+ * textLength to the slice length; its pieces are shared, not copied.
+ *
+ * @param document The document.
+ * @param edits The edits, in pre-edit coordinates.
+ * @param editCount Number of edits.
+ * @return true if successful, false if the edits are invalid or memory ran out.
+ */
+bool DocumentApplyEdits(Document* document, const DocumentEdit* edits, size_t editCount);
+
+/**
+ * @brief Reverts the most recent edit batch.
+ *
+ * @param document The document.
+ * @param[out] changeCount Receives the number of changes applied.
+ * @return The changes that were applied (valid until the next modification),
+ *         or NULL if there is nothing to undo.
+ */
+const DocumentChange* DocumentUndo(Document* document, size_t* changeCount);
+
+/**
+ * @brief Reapplies the most recently undone edit batch.
+ *
+ * @param document The document.
+ * @param[out] changeCount Receives the number of changes applied.
+ * @return The changes that were applied (valid until the next modification),
+ *         or NULL if there is nothing to redo.
+ */
+const DocumentChange* DocumentRedo(Document* document, size_t* changeCount);
+
+/**
+ * @brief Starts merging the following edit batches into one undo step.
+ *
+ * Until the matching DocumentEndGroup, every batch after the first replaces
+ * the history entry of the group instead of adding one, so a long run of
+ * scripted edits is undone at once and holds a single history entry. The
+ * entry records one change spanning everything the group touched.
+ * Listeners are still notified of every batch with its exact changes.
+ * Groups nest; undo or redo inside a group ends the merging.
+ *
+ * @param document The document.
+ */
+void DocumentBeginGroup(Document* document);
+
+/**
+ * @brief Ends a group started by DocumentBeginGroup.
+ *
+ * @param document The document.
+ */
+void DocumentEndGroup(Document* document);
+
+/**
+ * @brief Checks whether the document changed since it was loaded or last saved.
+ *
+ * @param document The document.
+ * @return true if modified, false otherwise.
+ */
+bool DocumentIsModified(const Document* document);
+
+/**
+ * @brief Records the current content as the saved state.
+ *
+ * @param document The document.
+ */
+void DocumentMarkSaved(Document* document);
+
+/**
+ * @brief Records that the content of a snapshot has been saved.
+ *
+ * Edits made after the snapshot was taken keep the document modified.
+ *
+ * @param document The document.
+ * @param snapshot A snapshot of the document.
+ */
+void DocumentMarkSnapshotSaved(Document* document, const DocumentSnapshot* snapshot);
+
+/**
+ * @brief Registers a callback invoked after every content change.
+ *
+ * @param document The document.
+ * @param listener The callback.
+ * @param context Pointer passed back to the callback.
+ * @return true if successful, false on allocation failure.
+ */
+bool DocumentAddListener(Document* document, DocumentListener listener, void* context);
+
+/**
+ * @brief Removes a callback registered with DocumentAddListener.
+ *
+ * @param document The document.
+ * @param listener The callback.
+ * @param context The context it was registered with.
+ */
+void DocumentRemoveListener(Document* document, DocumentListener listener, void* context);
+
+/**
+ * @brief Gets the line index of the file the document was loaded from.
+ *
+ * @param document The document.
+ * @return The line index of the original content (empty for new documents).
+ */
+const LineIndex* DocumentOriginalLineIndex(const Document* document);
+
+/**
+ * @brief Gets the content the document was loaded from.
+ *
+ * @param document The document.
+ * @param[out] length Receives the length of the original content.
+ * @return Pointer to the original content (valid until the document is destroyed).
+ */
+const char* DocumentOriginalText(const Document* document, uint64_t* length);
+
+/**
+ * @brief Reports, in document order, every run that still references the original content.
+ *
+ * Bytes outside the reported runs were inserted after loading.
+ *
+ * @param document The document.
+ * @param callback Invoked once per run.
+ * @param context Pointer passed to the callback.
+ */
+void DocumentForEachOriginalRun(const Document* document, DocumentOriginalRunCallback callback, void* context);
+
+/**
+ * @brief Captures ranges of the current content without copying their bytes.
+ *
+ * The slice shares the pieces of the ranges and stays valid after later
+ * edits and after the document is destroyed. The ranges are joined with
+ * the separator and each range is remembered as one part.
+ *
+ * @param document The document.
+ * @param ranges The ranges to capture, each within the document.
+ * @param rangeCount Number of ranges (at least 1).
+ * @param separator Text placed between ranges (may be NULL if separatorLength is 0).
+ * @param separatorLength Length of the separator.
+ * @return The slice, or NULL on failure. Release with DocumentSliceRelease.
+ */
+DocumentSlice* DocumentSliceCreate(Document* document, const DocumentRange* ranges, size_t rangeCount,
+                                   const char* separator, size_t separatorLength);
+
+/**
+ * @brief Copies text into the storage of a document and returns it as a slice.
+ *
+ * The text is streamed into the add buffers one block at a time, so a large
+ * paste needs no allocation of its full size and is copied exactly once.
+ *
+ * @param document The document that will receive the text.
+ * @param text The text (may be NULL if length is 0).
+ * @param length Length of the text.
+ * @return The slice, or NULL on failure. Release with DocumentSliceRelease.
+ */
+DocumentSlice* DocumentSliceFromText(Document* document, const char* text, size_t length);
+
+/**
+ * @brief Makes a slice usable for edits of a document.
+ *
+ * A slice of the same document is shared; a slice of another document is
+ * streamed into the storage of this one.
+ *
+ * @param document The document that will receive the slice.
+ * @param slice The slice.
+ * @return A new reference to a slice of the document, or NULL on failure.
+ */
+DocumentSlice* DocumentSliceImport(Document* document, DocumentSlice* slice);
+
+/**
+ * @brief Drops a reference to a slice.
+ *
+ * @param slice The slice. NULL is ignored.
+ */
+void DocumentSliceRelease(DocumentSlice* slice);
+
+/**
+ * @brief Gets the length of a slice.
+ *
+ * @param slice The slice.
+ * @return The length in bytes.
+ */
+uint64_t DocumentSliceLength(const DocumentSlice* slice);
+
+/**
+ * @brief Gets the number of ranges a slice was captured from.
+ *
+ * @param slice The slice.
+ * @return The number of parts, at least 1.
+ */
+size_t DocumentSlicePartCount(const DocumentSlice* slice);
+
+/**
+ * @brief Creates a slice holding one part of another slice, without the separators.
+ *
+ * @param slice The slice.
+ * @param part Index of the part.
+ * @return The slice, or NULL on failure. Release with DocumentSliceRelease.
+ */
+DocumentSlice* DocumentSlicePart(const DocumentSlice* slice, size_t part);
+
+/**
+ * @brief Positions an iterator at a byte offset of a slice.
+ *
+ * @param slice The slice.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize; use DocumentIterNext to read.
+ */
+void DocumentSliceIterInit(const DocumentSlice* slice, uint64_t offset, DocumentIterator* iterator);
+
+/**
+ * @brief Copies a range of a slice into a buffer.
+ *
+ * @param slice The slice.
+ * @param offset Start of the range.
+ * @param[out] buffer Receives the bytes (not NUL-terminated).
+ * @param length Number of bytes requested.
+ * @return Number of bytes copied (less than length at the end of the slice).
+ */
+size_t DocumentSliceRead(const DocumentSlice* slice, uint64_t offset, char* buffer, size_t length);
+
+/**
+ * @brief Pins the current content for reading on another thread.
+ *
+ * Takes a reference to the current version without copying anything, so
+ * it costs the same for any document size. Edits, undo and destroying the
+ * document do not affect the snapshot; the storage it reads stays alive
+ * until it is released. Only the snapshot functions below, except
+ * DocumentSnapshotIsCurrent, may be used on other threads, and each
+ * snapshot by one thread at a time.
+ *
+ * @param document The document; used on its own thread.
+ * @return The snapshot, or NULL on allocation failure. Release with DocumentSnapshotRelease.
+ */
+DocumentSnapshot* DocumentSnapshotCreate(Document* document);
+
+/**
+ * @brief Releases a snapshot, on any thread.
+ *
+ * @param snapshot The snapshot. NULL is ignored.
+ */
+void DocumentSnapshotRelease(DocumentSnapshot* snapshot);
+
+/**
+ * @brief Gets the length of a snapshot.
+ *
+ * @param snapshot The snapshot.
+ * @return The length in bytes.
+ */
+uint64_t DocumentSnapshotLength(const DocumentSnapshot* snapshot);
+
+/**
+ * @brief Checks whether a snapshot still holds the content of its document.
+ *
+ * Unlike the other snapshot functions this reads the document, so it must
+ * be called on the document's own thread and only while the document exists.
+ *
+ * @param snapshot The snapshot.
+ * @return true if the document is at the version the snapshot was taken from, false otherwise.
+ */
+bool DocumentSnapshotIsCurrent(const DocumentSnapshot* snapshot);
+
+/**
+ * @brief Gets the number of lines of a snapshot (line feeds plus one).
+ *
+ * @param snapshot The snapshot.
+ * @return The line count, at least 1.
+ */
+uint64_t DocumentSnapshotLineCount(const DocumentSnapshot* snapshot);
+
+/**
+ * @brief Positions an iterator at a byte offset of a snapshot.
+ *
+ * @param snapshot The snapshot.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize; use DocumentIterNext to read.
+ */
+void DocumentSnapshotIterInit(const DocumentSnapshot* snapshot, uint64_t offset, DocumentIterator* iterator);
+
+/**
+ * @brief Copies a range of a snapshot into a buffer.
+ *
+ * @param snapshot The snapshot.
+ * @param offset Start of the range.
+ * @param[out] buffer Receives the bytes (not NUL-terminated).
+ * @param length Number of bytes requested.
+ * @return Number of bytes copied (less than length at the end of the snapshot).
+ */
+size_t DocumentSnapshotRead(const DocumentSnapshot* snapshot, uint64_t offset, char* buffer, size_t length);
+
+#endif /* DOCUMENT_H */
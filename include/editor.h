@@ -14,6 +14,7 @@
 #include <stdio.h>   // For file operations
 #include <stdlib.h>  // For memory allocation
 #include <stdbool.h> // For boolean values
+#include "session.h" // For the cached document indexes
 
 // Global constants
 #define EDITOR_CLASS_NAME "PROFESSIONAL_TEXTEDITOR"
@@ -23,6 +24,55 @@
 // Control IDs
 #define ID_STATUSBAR 101
 
+// Menu command IDs (1-8 are the original File, Edit and Help items)
+#define IDM_EDIT_UNDO 9
+#define IDM_EDIT_REDO 10
+#define IDM_EDIT_SELECT_ALL 11
+#define IDM_EDIT_ADD_CURSOR_ABOVE 12
+#define IDM_EDIT_ADD_CURSOR_BELOW 13
+#define IDM_EDIT_ADD_NEXT_OCCURRENCE 14
+#define IDM_EDIT_SELECT_ALL_OCCURRENCES 15
+#define IDM_FILE_COMPARE_SAVED 16
+#define IDM_VIEW_TOGGLE_FOLD 17
+#define IDM_VIEW_UNFOLD_ALL 18
+#define IDM_VIEW_NEXT_FOLD 19
+#define IDM_VIEW_PREVIOUS_FOLD 20
+#define IDM_VIEW_MATCH_BRACKET 21
+#define IDM_VIEW_SPELL_CHECK 22
+#define IDM_EDIT_COMPLETE_WORD 23
+#define IDM_EDIT_SORT_LINES 24
+#define IDM_EDIT_UNIQUE_LINES 25
+#define IDM_VIEW_TABLE 26
+#define IDM_VIEW_JSON_OUTLINE 27
+#define IDM_FILE_SAVE_AS 28
+#define IDM_HELP_FRAME_STATS 29
+#define IDM_EDIT_RECORD_MACRO 30
+#define IDM_EDIT_PLAY_MACRO 31
+#define IDM_EDIT_PLAY_MACRO_TO_END 32
+#define IDM_EDIT_PLAY_MACRO_ON_LINES 33
+#define IDM_EDIT_PLAY_MACRO_ON_MATCHES 34
+#define IDM_HELP_MEMORY_USAGE 35
+#define IDM_VIEW_TOGGLE_BOOKMARK 36
+#define IDM_VIEW_NEXT_BOOKMARK 37
+#define IDM_VIEW_PREVIOUS_BOOKMARK 38
+#define IDM_VIEW_CLEAR_BOOKMARKS 39
+#define IDM_VIEW_FILTER_LINES 40
+#define IDM_VIEW_SHOW_ALL_LINES 41
+#define IDM_VIEW_GO_TO_TIME 42
+#define IDM_FILE_FORMAT_TRIM_TRAILING 43
+#define IDM_FILE_FORMAT_EXPAND_TABS 44
+#define IDM_FILE_FORMAT_FINAL_NEWLINE 45
+#define IDM_EDIT_TRIM_TRAILING_WHITESPACE 46
+#define IDM_EDIT_EXPAND_TABS 47
+#define IDM_EDIT_ADD_FINAL_NEWLINE 48
+
+// Private window messages
+#define WM_EDITOR_RESTORE_SESSION (WM_APP + 1) // Posted once the main window is laid out
+#define WM_EDITOR_PROGRESS (WM_APP + 2)        // Sent by the editor view: wParam percent or -1 when done, lParam task name
+#define WM_EDITOR_SAVE_PROGRESS (WM_APP + 3)   // Posted by the save worker: wParam percent written
+#define WM_EDITOR_SAVE_DONE (WM_APP + 4)       // Posted by the save worker once the file is written or has failed
+#define WM_EDITOR_MACRO_RECORDING (WM_APP + 5) // Sent by the editor view: wParam TRUE while a macro is recorded
+
 // Error handling macro
 #define EDITOR_CHECK_ERROR(condition, message, title) \
     if (!(condition)) { \
@@ -34,11 +84,23 @@
 #define EDITOR_SUCCESS 0
 #define EDITOR_ERROR 1
 
+// Application data folder holding the session manifest and index sidecars
+#define EDITOR_SESSION_FOLDER "ProfessionalTextEditor"
+
+// Spelling dictionary next to the executable: compiled, or a word list compiled on first use
+#define EDITOR_DICTIONARY_FILE "dictionary.dawg"
+#define EDITOR_WORD_LIST_FILE "dictionary.txt"
+
 // Structure to hold editor state (e.g., current file info)
 typedef struct {
     char currentFilePath[MAX_PATH];
-    long currentFileSize;
+    uint64_t currentFileSize;
     // BOOL isModified; // Future enhancement
+    BOOL hexMode;               // The file is shown in the hex view instead of the editor view
+    BOOL tableMode;             // The document is shown in the table view instead of the editor view
+    DocumentKey documentKey;    // Key of the file content the document was loaded from
+    BOOL hasDocumentKey;        // TRUE when documentKey describes the file on disk
+    unsigned formatOnSave;      // TEXT_FORMAT_ stages applied to the text as it is saved
 } EditorState;
 
 #endif /* EDITOR_H */
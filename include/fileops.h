@@ -9,6 +9,10 @@
 #define FILEOPS_H
 
 #include "editor.h"
+#include "document.h"
+#include "hexfile.h"
+#include "spelldict.h"
+#include "textformat.h"
 
 /**
  * @brief Displays an Open file dialog and loads the selected file into the editor.
@@ -20,14 +24,67 @@
 BOOL EditorOpenFile(HWND hWnd, HWND hEdit);
 
 /**
- * @brief Displays a Save As dialog and saves the editor content to the selected file.
+ * @brief Saves the editor content to the file it was loaded from or last saved to.
  *
- * @param hWnd Handle to the parent window for the dialog.
+ * Untitled documents get the Save As dialog. The text is written on a
+ * worker thread from a snapshot, so editing can go on; progress and the
+ * result arrive as WM_EDITOR_SAVE_PROGRESS and WM_EDITOR_SAVE_DONE.
+ *
+ * @param hWnd Handle to the parent window, which receives the save messages.
  * @param hEdit Handle to the edit control containing the text to save.
- * @return TRUE if a file was successfully saved, FALSE otherwise.
+ * @return TRUE if the file was saved or its save started, FALSE otherwise.
  */
 BOOL EditorSaveFile(HWND hWnd, HWND hEdit);
 
+/**
+ * @brief Displays a Save As dialog and saves the editor content to the selected file.
+ *
+ * @param hWnd Handle to the parent window for the dialog, which receives the save messages.
+ * @param hEdit Handle to the edit control containing the text to save.
+ * @return TRUE if the file was saved or its save started, FALSE otherwise.
+ */
+BOOL EditorSaveFileAs(HWND hWnd, HWND hEdit);
+
+/**
+ * @brief Completes the background save after its worker has finished.
+ *
+ * Called on WM_EDITOR_SAVE_DONE. Marks the saved version of the document,
+ * or reports the failure, and starts a save requested in the meantime.
+ *
+ * @param hWnd Handle to the main window.
+ * @param hEdit Handle to the edit control holding the document.
+ */
+void EditorFinishSave(HWND hWnd, HWND hEdit);
+
+/**
+ * @brief Waits for the background save, and any save queued behind it, to finish.
+ *
+ * @param hWnd Handle to the main window.
+ * @param hEdit Handle to the edit control holding the document.
+ */
+void EditorWaitForSave(HWND hWnd, HWND hEdit);
+
+/**
+ * @brief Loads a file into the editor without showing any dialog.
+ *
+ * Derived indexes are taken from the session cache when it matches the
+ * file on disk and rebuilt otherwise.
+ *
+ * @param hEdit Handle to the edit control where the file will be loaded.
+ * @param filePath Path to the file to load.
+ * @return TRUE if the file was loaded, FALSE otherwise.
+ */
+BOOL EditorLoadFile(HWND hEdit, const char* filePath);
+
+/**
+ * @brief Shows the changes between the editor content and the file on disk.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hEdit Handle to the edit control holding the document.
+ * @return TRUE if a comparison was shown, FALSE otherwise.
+ */
+BOOL EditorCompareWithSaved(HWND hWnd, HWND hEdit);
+
 /**
  * @brief Creates a new empty document in the editor.
  *
@@ -56,4 +113,51 @@ char* ReadFileToBuffer(const char* filePath, long* fileSize);
  */
 BOOL WriteBufferToFile(const char* filePath, const char* buffer, long bufferSize);
 
+/**
+ * @brief Writes the content of a document snapshot to a file.
+ *
+ * The pieces are written as they are stored, without building the text in
+ * memory, so the file receives every byte including NULs. A formatter, if
+ * given, rewrites them on their way to the file. Safe to call on any thread.
+ *
+ * @param filePath Path to the file to write.
+ * @param snapshot The snapshot.
+ * @param formatter Formatter started without a sink, or NULL to write the text unchanged; the file becomes its sink.
+ * @param hNotify Window receiving WM_EDITOR_SAVE_PROGRESS, or NULL.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL WriteSnapshotToFile(const char* filePath, const DocumentSnapshot* snapshot, TextFormatter* formatter,
+                         HWND hNotify);
+
+/**
+ * @brief Writes the content of a hex view file, with its overwritten bytes, to another file.
+ *
+ * @param filePath Path to the file to write.
+ * @param hexFile The file.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL WriteHexFileToFile(const char* filePath, HexFile* hexFile);
+
+/**
+ * @brief Gets the folder holding the session manifest and index sidecars.
+ *
+ * The folder is created under the user's local application data if it
+ * does not exist yet.
+ *
+ * @param[out] buffer Receives the folder path.
+ * @param bufferSize Size of the buffer in bytes.
+ * @return TRUE if the folder is available, FALSE otherwise.
+ */
+BOOL GetSessionDirectory(char* buffer, DWORD bufferSize);
+
+/**
+ * @brief Opens the spelling dictionary installed next to the executable.
+ *
+ * A compiled dictionary is used as is. Otherwise the word list is compiled
+ * into the session folder, once per change of the list.
+ *
+ * @return The dictionary, or NULL if none is installed. Close it with SpellDictClose.
+ */
+SpellDict* EditorLoadSpellDictionary(void);
+
 #endif /* FILEOPS_H */
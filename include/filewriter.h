@@ -0,0 +1,61 @@
+/**
+ * @file filewriter.h
+ * @brief Write-behind file output for the Professional Text Editor
+ *
+ * Contains a writer that copies output into a ring of aligned buffers and
+ * hands each full buffer to a background thread, which writes it while the
+ * caller fills the next one. Saving a document then reads its pieces (and
+ * faults in its mapped file) at the same time as the disk writes the bytes
+ * before them, instead of alternating between the two.
+ */
+
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bytes handed to the writing thread at a time
+#define FILE_WRITER_BUFFER_SIZE (1u << 20)
+
+// Buffers in the ring; all but the one being filled can be waiting to be written
+#define FILE_WRITER_BUFFER_COUNT 4
+
+// Alignment of each buffer, a multiple of the sector and page sizes
+#define FILE_WRITER_ALIGNMENT 4096
+
+// A file being written
+typedef struct FileWriter FileWriter;
+
+/**
+ * @brief Creates or truncates a file and starts writing it.
+ *
+ * When no thread can be started the writer works synchronously.
+ *
+ * @param filePath Path to the file.
+ * @return The writer, or NULL on failure.
+ */
+FileWriter* FileWriterOpen(const char* filePath);
+
+/**
+ * @brief Appends bytes to the file.
+ *
+ * Returns once the bytes are copied; waits only while every buffer is
+ * waiting to be written.
+ *
+ * @param writer The writer.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if successful, false once any write has failed.
+ */
+bool FileWriterWrite(FileWriter* writer, const void* data, size_t length);
+
+/**
+ * @brief Writes the remaining bytes, closes the file and releases the writer.
+ *
+ * @param writer The writer. NULL is ignored.
+ * @return true if every byte was written and the file closed, false otherwise.
+ */
+bool FileWriterClose(FileWriter* writer);
+
+#endif /* FILEWRITER_H */
@@ -0,0 +1,166 @@
+/**
+ * @file folds.h
+ * @brief Folded line ranges for the Professional Text Editor
+ *
+ * Contains the set of folds of a view. A fold hides whole lines below a
+ * header line without touching the text; the view maps its rows to
+ * document lines through the set. Folds are stored as offsets so that
+ * edits elsewhere only shift them, and the row mapping is rebuilt lazily
+ * from the few folded runs instead of from the lines.
+ */
+
+#ifndef FOLDS_H
+#define FOLDS_H
+
+#include "document.h"
+
+// One folded region, kept as line start offsets
+typedef struct {
+    uint64_t hideStart;     // Start of the first hidden line
+    uint64_t hideLast;      // Start of the last hidden line
+} Fold;
+
+// Run of consecutive hidden lines after merging nested and adjacent folds
+typedef struct {
+    uint64_t firstLine;     // First hidden line
+    uint64_t lastLine;      // Last hidden line
+    uint64_t hiddenBefore;  // Lines hidden by earlier runs
+} FoldRun;
+
+// Folds of one view
+typedef struct {
+    Fold* items;            // Sorted by hideStart
+    size_t count;
+    size_t capacity;
+    FoldRun* runs;          // Hidden line runs in line order
+    size_t runCount;
+    size_t runCapacity;
+    bool runsValid;         // false after any change to items or the document
+} FoldSet;
+
+/**
+ * @brief Initializes an empty fold set.
+ *
+ * @param folds The fold set.
+ */
+void FoldSetInit(FoldSet* folds);
+
+/**
+ * @brief Releases the memory held by a fold set.
+ *
+ * @param folds The fold set.
+ */
+void FoldSetFree(FoldSet* folds);
+
+/**
+ * @brief Removes every fold.
+ *
+ * @param folds The fold set.
+ */
+void FoldSetClear(FoldSet* folds);
+
+/**
+ * @brief Hides a range of lines below a header line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param firstLine First line to hide; the line above it stays visible.
+ * @param lastLine Last line to hide.
+ * @return true if successful, false if the range is invalid or memory ran out.
+ */
+bool FoldSetAdd(FoldSet* folds, const Document* document, uint64_t firstLine, uint64_t lastLine);
+
+/**
+ * @brief Removes the folds whose header is a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param headerLine The header line.
+ * @return true if a fold was removed, false otherwise.
+ */
+bool FoldSetRemoveHeader(FoldSet* folds, const Document* document, uint64_t headerLine);
+
+/**
+ * @brief Removes the folds that hide a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line.
+ * @return true if a fold was removed, false otherwise.
+ */
+bool FoldSetRevealLine(FoldSet* folds, const Document* document, uint64_t line);
+
+/**
+ * @brief Updates the folds after the document changed.
+ *
+ * Folds touched by a change are removed; the others move with the text.
+ *
+ * @param folds The fold set.
+ * @param changes The changes reported to the document listener, or NULL if unknown.
+ * @param changeCount Number of changes.
+ */
+void FoldSetMapChanges(FoldSet* folds, const DocumentChange* changes, size_t changeCount);
+
+/**
+ * @brief Gets the number of visible lines.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @return The line count minus the hidden lines.
+ */
+uint64_t FoldSetVisibleLineCount(FoldSet* folds, const Document* document);
+
+/**
+ * @brief Gets the document line shown in a row.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param row Zero-based row.
+ * @return The line.
+ */
+uint64_t FoldSetLineFromRow(FoldSet* folds, const Document* document, uint64_t row);
+
+/**
+ * @brief Gets the row showing a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line; a hidden line maps to the row of its header.
+ * @return The row.
+ */
+uint64_t FoldSetRowFromLine(FoldSet* folds, const Document* document, uint64_t line);
+
+/**
+ * @brief Checks whether a line is hidden.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line.
+ * @return true if a fold hides the line, false otherwise.
+ */
+bool FoldSetIsHidden(FoldSet* folds, const Document* document, uint64_t line);
+
+/**
+ * @brief Checks whether a visible line is the header of a fold.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line.
+ * @return true if the lines below it are folded, false otherwise.
+ */
+bool FoldSetIsHeader(FoldSet* folds, const Document* document, uint64_t line);
+
+/**
+ * @brief Finds the nearest fold header after or before a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line to start from (not itself a candidate).
+ * @param forward true to search downwards, false to search upwards.
+ * @param[out] header Receives the header line.
+ * @return true if found, false otherwise.
+ */
+bool FoldSetFindHeader(FoldSet* folds, const Document* document, uint64_t line, bool forward,
+                       uint64_t* header);
+
+#endif /* FOLDS_H */
@@ -0,0 +1,86 @@
+/**
+ * @file frame.h
+ * @brief Frame scheduler for the Professional Text Editor
+ *
+ * Contains the message loop of the application and the scheduler that runs
+ * deferred user interface work. Code that changes state marks the work it
+ * makes necessary (layout, status bar) instead of doing it, and marked work
+ * runs at most once per display frame, after the queued messages have been
+ * handled. The loop also measures the time from an input message to the
+ * paint that follows it.
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "editor.h"
+
+// Work that can be marked for the next frame
+#define FRAME_WORK_LAYOUT 0x1   // Place the child windows in the client area
+#define FRAME_WORK_STATUS 0x2   // Refresh the status bar text
+
+// Frame interval used when the display does not report its refresh rate
+#define FRAME_DEFAULT_INTERVAL_MS 16
+
+// Timer that runs marked work while a modal loop (menus, sizing, dialogs) owns the queue
+#define FRAME_TIMER_ID 0x4652
+
+/**
+ * @brief Runs the work marked for a frame.
+ *
+ * @param work The FRAME_WORK_ flags marked since the last frame.
+ */
+typedef void (*FrameWorkProc)(unsigned work);
+
+// Input-to-paint latency measured by the message loop
+typedef struct {
+    unsigned long long frames;      // Frames that ran marked work
+    unsigned long long samples;     // Input messages followed by a paint
+    double lastLatencyMs;
+    double averageLatencyMs;
+    double maxLatencyMs;
+} FrameStats;
+
+/**
+ * @brief Starts scheduling frames for a window.
+ *
+ * @param hWnd Handle to the main window, which owns the frame timer.
+ * @param run Function running the marked work.
+ */
+void FrameSchedulerInit(HWND hWnd, FrameWorkProc run);
+
+/**
+ * @brief Stops scheduling frames; marked work is dropped.
+ */
+void FrameSchedulerShutdown(void);
+
+/**
+ * @brief Marks work for the next frame.
+ *
+ * @param work FRAME_WORK_ flags.
+ */
+void FrameRequest(unsigned work);
+
+/**
+ * @brief Runs marked work now instead of at the next frame.
+ */
+void FrameFlush(void);
+
+/**
+ * @brief Gets the latency measured so far.
+ *
+ * @param[out] stats Receives the statistics.
+ */
+void FrameGetStats(FrameStats* stats);
+
+/**
+ * @brief Runs the message loop until WM_QUIT.
+ *
+ * Between messages the loop waits with MsgWaitForMultipleObjectsEx until
+ * the next message or the next frame with marked work, whichever is first.
+ *
+ * @return The exit code carried by WM_QUIT.
+ */
+int FrameRunMessageLoop(void);
+
+#endif /* FRAME_H */
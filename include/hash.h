@@ -0,0 +1,36 @@
+/**
+ * @file hash.h
+ * @brief Fast non-cryptographic hashing for the Professional Text Editor
+ *
+ * Contains the 64-bit hash used to key cached indexes, intern strings and
+ * compare lines. The functions are platform independent.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Computes a 64-bit hash of a byte range.
+ *
+ * The hash consumes eight bytes per step and is suitable for hash tables
+ * and change detection, not for security purposes.
+ *
+ * @param data Pointer to the bytes to hash (may be NULL if length is 0).
+ * @param length Number of bytes to hash.
+ * @param seed Initial seed; use 0 unless chaining hashes.
+ * @return The 64-bit hash value.
+ */
+uint64_t HashBytes64(const void* data, size_t length, uint64_t seed);
+
+/**
+ * @brief Mixes a 64-bit value into a well-distributed hash.
+ *
+ * @param value The value to mix.
+ * @return The mixed value.
+ */
+uint64_t HashMix64(uint64_t value);
+
+#endif /* HASH_H */
@@ -0,0 +1,121 @@
+/**
+ * @file hexfile.h
+ * @brief Paged binary file access for the hex view of the Professional Text Editor
+ *
+ * Contains a binary file opened for byte-level editing. The file is never
+ * mapped as a whole: fixed-size windows are mapped on demand and the most
+ * recently used ones are kept, so files larger than the address space open
+ * instantly. Overwritten bytes are kept in a sorted overlay on top of the
+ * file and written back in place, one write per run of changed bytes.
+ */
+
+#ifndef HEXFILE_H
+#define HEXFILE_H
+
+#include "mapfile.h"
+
+// Number of leading bytes examined by HexFileIsBinary
+#define HEX_FILE_SNIFF_BYTES 8192
+
+typedef struct HexFile HexFile;
+
+/**
+ * @brief Opens a file for the hex view.
+ *
+ * Only the file is opened; windows of it are mapped when they are read.
+ *
+ * @param filePath Path to the file.
+ * @return The file, or NULL on failure. Close it with HexFileClose.
+ */
+HexFile* HexFileOpen(const char* filePath);
+
+/**
+ * @brief Closes a file and discards its unsaved changes.
+ *
+ * @param file The file. NULL is ignored.
+ */
+void HexFileClose(HexFile* file);
+
+/**
+ * @brief Gets the size of a file.
+ *
+ * @param file The file.
+ * @return Size in bytes; overwriting never changes it.
+ */
+uint64_t HexFileSize(const HexFile* file);
+
+/**
+ * @brief Checks whether text looks like binary data.
+ *
+ * Text never contains NUL bytes and rarely control characters other than
+ * tabs, line breaks, form feeds and escapes.
+ *
+ * @param data The bytes to examine.
+ * @param length Number of bytes.
+ * @return true for binary data, false for text.
+ */
+bool HexLooksBinary(const char* data, size_t length);
+
+/**
+ * @brief Checks whether the start of a file looks like binary data.
+ *
+ * @param file The file.
+ * @return true if the first HEX_FILE_SNIFF_BYTES bytes look binary, false otherwise.
+ */
+bool HexFileIsBinary(HexFile* file);
+
+/**
+ * @brief Reads bytes of a file with the overwritten bytes applied.
+ *
+ * @param file The file.
+ * @param offset Offset of the first byte.
+ * @param[out] buffer Receives the bytes.
+ * @param[out] modified Receives true for every overwritten byte, or NULL.
+ * @param length Number of bytes to read.
+ * @return Number of bytes read; less than length at the end of the file or if a window cannot be mapped.
+ */
+size_t HexFileRead(HexFile* file, uint64_t offset, uint8_t* buffer, bool* modified, size_t length);
+
+/**
+ * @brief Overwrites one byte.
+ *
+ * Writing the byte that is on disk removes the byte from the overlay.
+ *
+ * @param file The file.
+ * @param offset Offset of the byte; must be less than the file size.
+ * @param value The new value.
+ * @return true if successful, false on allocation failure or if the byte cannot be read.
+ */
+bool HexFileSetByte(HexFile* file, uint64_t offset, uint8_t value);
+
+/**
+ * @brief Reverts the most recent overwrite.
+ *
+ * @param file The file.
+ * @param[out] offset Receives the offset of the reverted byte, or NULL.
+ * @return true if an overwrite was reverted, false if there is none or on allocation failure.
+ */
+bool HexFileUndo(HexFile* file, uint64_t* offset);
+
+/**
+ * @brief Checks whether a file has bytes that differ from the disk.
+ *
+ * @param file The file.
+ * @return true if there are unsaved changes, false otherwise.
+ */
+bool HexFileIsModified(const HexFile* file);
+
+/**
+ * @brief Writes the overwritten bytes back into the file in place.
+ *
+ * Every run of adjacent changed bytes is written with one write at its
+ * offset; the rest of the file is not touched. The save is refused when the
+ * file changed on disk since it was opened. The overlay and undo history
+ * are cleared afterwards.
+ *
+ * @param file The file.
+ * @return true if successful, false otherwise.
+ */
+bool HexFileSave(HexFile* file);
+
+#endif /* HEXFILE_H */
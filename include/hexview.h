@@ -0,0 +1,49 @@
+/**
+ * @file hexview.h
+ * @brief Hex view for binary files in the Professional Text Editor
+ *
+ * Contains the view that shows a binary file as rows of offset, hex bytes
+ * and ASCII characters. Only the visible rows are read from the file, and
+ * typing overwrites bytes in place: hex digits in the hex column, printable
+ * characters in the ASCII column.
+ */
+
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include "editor.h"
+#include "hexfile.h"
+
+// Window class of the hex view
+#define HEX_VIEW_CLASS_NAME "PROFESSIONAL_TEXTEDITOR_HEXVIEW"
+
+/**
+ * @brief Creates the hex view within the parent window.
+ *
+ * The view is created hidden and without a file.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hInstance Handle to the application instance.
+ * @return Handle to the view, or NULL if creation failed.
+ */
+HWND CreateHexView(HWND hWnd, HINSTANCE hInstance);
+
+/**
+ * @brief Replaces the file shown in the hex view.
+ *
+ * The previous file is closed and its unsaved changes are discarded.
+ *
+ * @param hHex Handle to the hex view.
+ * @param file The file to show; ownership is transferred to the view. NULL closes the current file.
+ */
+void SetHexViewFile(HWND hHex, HexFile* file);
+
+/**
+ * @brief Gets the file shown in the hex view.
+ *
+ * @param hHex Handle to the hex view.
+ * @return The file, owned by the view, or NULL if none is shown.
+ */
+HexFile* GetHexViewFile(HWND hHex);
+
+#endif /* HEXVIEW_H */
@@ -0,0 +1,112 @@
+/**
+ * @file jsonindex.h
+ * @brief Structural index of JSON text for the Professional Text Editor
+ *
+ * Contains the index behind the JSON outline. The first stage classifies
+ * 64 bytes at a time into masks of quotes, backslashes, brackets and
+ * commas and drops the ones inside strings; the second walks the remaining
+ * structural bits and records every object and array of at least
+ * JSON_INDEX_MIN_SPAN bytes with its end and member count. Listing the
+ * members of a node then skips over recorded children instead of reading
+ * them, so a node of a multi-gigabyte document expands in time proportional
+ * to the members listed. Smaller values are read when they are listed.
+ */
+
+#ifndef JSONINDEX_H
+#define JSONINDEX_H
+
+#include "document.h"
+
+// Objects and arrays shorter than this are not recorded
+#define JSON_INDEX_MIN_SPAN 4096
+
+// Members between two recorded member offsets of a large object or array
+#define JSON_INDEX_GROUP 1000
+
+// Index of the objects and arrays of a document
+typedef struct JsonIndex JsonIndex;
+
+// Kind of a value
+typedef enum {
+    JSON_VALUE_OBJECT,
+    JSON_VALUE_ARRAY,
+    JSON_VALUE_STRING,
+    JSON_VALUE_NUMBER,
+    JSON_VALUE_LITERAL,         // true, false or null
+    JSON_VALUE_SEQUENCE,        // The whole document when it holds several top-level values (JSON Lines)
+    JSON_VALUE_INVALID          // Text that starts no value; listed so nothing is hidden
+} JsonValueKind;
+
+// One value of the document, with the member name it is stored under
+typedef struct {
+    JsonValueKind kind;
+    uint64_t keyOffset;         // Start of the member name including its quote
+    uint64_t keyLength;         // Length of the name including its quotes, or 0 outside objects
+    uint64_t offset;            // Start of the value
+    uint64_t length;            // Length of the value; an unclosed object or array runs to the end
+    uint64_t childCount;        // Members of an object, elements of an array or values of a sequence
+} JsonNode;
+
+// Receives formatted text; returns false to stop
+typedef bool (*JsonWriteCallback)(const char* text, size_t length, void* context);
+
+/**
+ * @brief Builds the structural index of a document.
+ *
+ * Malformed text is indexed as far as it goes: unclosed objects and arrays
+ * run to the end of the document and stray closing brackets are ignored.
+ * The document must not change while the index is in use.
+ *
+ * @param document The document.
+ * @return The index, or NULL on failure.
+ */
+JsonIndex* JsonIndexBuild(const Document* document);
+
+/**
+ * @brief Releases a structural index.
+ *
+ * @param index The index, or NULL.
+ */
+void JsonIndexDestroy(JsonIndex* index);
+
+/**
+ * @brief Gets the top-level value of the document.
+ *
+ * A document of several top-level values gives a JSON_VALUE_SEQUENCE node
+ * covering the whole document, whose children are those values.
+ *
+ * @param index The index.
+ * @param[out] root Receives the value.
+ * @return true if the document holds a value, false if it is empty or blank.
+ */
+bool JsonIndexRoot(const JsonIndex* index, JsonNode* root);
+
+/**
+ * @brief Lists children of an object, array or sequence.
+ *
+ * @param index The index.
+ * @param parent The parent node.
+ * @param first Position of the first child listed.
+ * @param[out] children Receives the children.
+ * @param maxChildren Capacity of children.
+ * @return Number of children listed; fewer than maxChildren at the end of the parent.
+ */
+size_t JsonIndexChildren(const JsonIndex* index, const JsonNode* parent, uint64_t first, JsonNode* children,
+                         size_t maxChildren);
+
+/**
+ * @brief Writes a value indented, one member or element per line.
+ *
+ * Only the bytes of the value are read; strings are copied unchanged.
+ *
+ * @param index The index.
+ * @param node The value.
+ * @param indent Spaces per nesting level.
+ * @param write Receives the text in pieces.
+ * @param context Passed to write.
+ * @return true if the whole value was written, false if write stopped it.
+ */
+bool JsonIndexFormat(const JsonIndex* index, const JsonNode* node, unsigned indent, JsonWriteCallback write,
+                     void* context);
+
+#endif /* JSONINDEX_H */
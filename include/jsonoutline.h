@@ -0,0 +1,35 @@
+/**
+ * @file jsonoutline.h
+ * @brief JSON outline window for the Professional Text Editor
+ *
+ * Contains the window that shows the objects and arrays of a JSON document
+ * as a tree. Members are listed from the structural index only when their
+ * parent is expanded, and large objects and arrays are split into groups
+ * of members, so the outline of a multi-gigabyte document opens after one
+ * scan. Selecting a member moves the caret of the editor view to it, and
+ * Enter opens the selected value formatted in a window of its own.
+ */
+
+#ifndef JSONOUTLINE_H
+#define JSONOUTLINE_H
+
+#include "editor.h"
+
+// Window class of the outline window
+#define JSON_OUTLINE_CLASS_NAME "PROFESSIONAL_TEXTEDITOR_OUTLINE"
+
+/**
+ * @brief Opens a window with the outline of the document of an editor view.
+ *
+ * The outline stops following the document when it changes; F5 builds it
+ * again. The window must be destroyed before the editor view replaces or
+ * destroys its document.
+ *
+ * @param hOwner Handle to the owner window.
+ * @param hInstance Handle to the application instance.
+ * @param hEdit Handle to the editor view.
+ * @return Handle to the window, or NULL if it could not be created.
+ */
+HWND ShowJsonOutline(HWND hOwner, HINSTANCE hInstance, HWND hEdit);
+
+#endif /* JSONOUTLINE_H */
@@ -0,0 +1,99 @@
+/**
+ * @file layout.h
+ * @brief Column layout of document lines for the Professional Text Editor
+ *
+ * Contains the conversions between byte offsets and display columns used
+ * by the view and by vertical caret movement. Text is laid out in a fixed
+ * pitch font with tab stops every LAYOUT_TAB_WIDTH columns.
+ *
+ * A line of a document is measured from its start, which makes every
+ * query on a very long line (a minified file of one 200 MB line) as slow
+ * as reading the line. A document with a layout cache keeps such lines
+ * split into segments of a few kilobytes, each summarized by the columns
+ * it spans, so a query reads the summaries and one segment. Segments are
+ * measured from the line start only as far as a query reaches, and an
+ * edit measures again only the segments it touched.
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "document.h"
+
+// Distance between tab stops, in columns
+#define LAYOUT_TAB_WIDTH 4
+
+typedef struct LayoutCache LayoutCache;
+
+/**
+ * @brief Creates the layout cache of a document.
+ *
+ * The cache registers itself as a document listener; it has to be created
+ * before any listener that lays out text when the document changes. The
+ * layout functions use it for the long lines of the document. Layout runs
+ * on the thread owning the views of the document.
+ *
+ * @param document The document; it must outlive the cache.
+ * @return The cache, or NULL on allocation failure.
+ */
+LayoutCache* LayoutCacheCreate(Document* document);
+
+/**
+ * @brief Destroys a layout cache and unregisters it from its document.
+ *
+ * @param cache The cache. NULL is ignored.
+ */
+void LayoutCacheDestroy(LayoutCache* cache);
+
+/**
+ * @brief Gets the display column of an offset within its line.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param offset Offset within the line.
+ * @return Zero-based display column.
+ */
+uint64_t LayoutColumnFromOffset(const Document* document, uint64_t lineStart, uint64_t offset);
+
+/**
+ * @brief Gets the offset displayed at or just before a column.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @param column Zero-based display column.
+ * @return Offset of the character covering the column, or lineEnd past the end.
+ */
+uint64_t LayoutOffsetFromColumn(const Document* document, uint64_t lineStart, uint64_t lineEnd, uint64_t column);
+
+/**
+ * @brief Renders the visible columns of a line into display cells.
+ *
+ * Tabs are expanded to spaces and control characters are shown as '?'.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @param firstColumn First display column to render.
+ * @param[out] cells Receives one character per column.
+ * @param maxCells Capacity of cells.
+ * @return Number of cells filled.
+ */
+size_t LayoutVisibleText(const Document* document, uint64_t lineStart, uint64_t lineEnd,
+                         uint64_t firstColumn, char* cells, size_t maxCells);
+
+/**
+ * @brief Gets the width of a line for sizing a scroll range.
+ *
+ * A long line is not measured for this: the part of it no query reached
+ * yet counts one column per byte, so the width may grow as the view
+ * scrolls to the right.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @return The width in columns, exact unless the line is long and not measured to its end.
+ */
+uint64_t LayoutLineWidth(const Document* document, uint64_t lineStart, uint64_t lineEnd);
+
+#endif /* LAYOUT_H */
@@ -0,0 +1,96 @@
+/**
+ * @file linefilter.h
+ * @brief Matching-line filter for the Professional Text Editor
+ *
+ * Contains the sorted list of the lines that contain a pattern, behind the
+ * view that shows only those lines of a large log. Rows of the filtered
+ * view map to document lines through the list, so scrolling it reads only
+ * the visible lines, and the caret and every edit stay in the document.
+ *
+ * Lines are kept as their start offsets, four bytes each, in chunks of up
+ * to 1024 relative to the start of the chunk. An edit rescans only
+ * the lines it touches and moves the chunks after it, so the list follows
+ * typing, pasting and text appended at the end without another scan of the
+ * file. A list over an unmodified file is built by scanning parts of the
+ * mapping on one thread per processor.
+ */
+
+#ifndef LINEFILTER_H
+#define LINEFILTER_H
+
+#include "document.h"
+
+typedef struct LineFilter LineFilter;
+
+/**
+ * @brief Finds the lines of a document that contain a pattern.
+ *
+ * While the document still holds the unmodified file it was opened from,
+ * the file is split at line breaks and the parts are scanned in parallel.
+ *
+ * @param document The document; it must outlive the filter.
+ * @param pattern The text to find, without line breaks.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param threadCount Maximum number of threads, or 0 for one per processor.
+ * @return The filter, or NULL if the pattern is invalid or memory ran out.
+ */
+LineFilter* LineFilterCreate(const Document* document, const char* pattern, size_t patternLength, bool matchCase,
+                             unsigned threadCount);
+
+/**
+ * @brief Destroys a filter.
+ *
+ * @param filter The filter. NULL is ignored.
+ */
+void LineFilterDestroy(LineFilter* filter);
+
+/**
+ * @brief Updates the filter after the document changed.
+ *
+ * Only the lines touched by the changes are scanned again; unknown changes
+ * scan the whole document.
+ *
+ * @param filter The filter. NULL is ignored.
+ * @param changes The changes reported to the document listener, or NULL if unknown.
+ * @param changeCount Number of changes.
+ */
+void LineFilterMapChanges(LineFilter* filter, const DocumentChange* changes, size_t changeCount);
+
+/**
+ * @brief Gets the number of lines that contain the pattern.
+ *
+ * @param filter The filter.
+ * @return The number of matching lines, which is the number of rows of the filtered view.
+ */
+uint64_t LineFilterCount(const LineFilter* filter);
+
+/**
+ * @brief Gets the document line shown in a row of the filtered view.
+ *
+ * @param filter The filter.
+ * @param row Zero-based row; rows past the end show the last matching line.
+ * @return The line, or 0 if no line matches.
+ */
+uint64_t LineFilterLineFromRow(const LineFilter* filter, uint64_t row);
+
+/**
+ * @brief Gets the row of the filtered view showing a line.
+ *
+ * @param filter The filter.
+ * @param line The line; a line that does not match maps to the row of the
+ *             matching line above it, or to row 0 before the first one.
+ * @return The row.
+ */
+uint64_t LineFilterRowFromLine(const LineFilter* filter, uint64_t line);
+
+/**
+ * @brief Checks whether a line contains the pattern.
+ *
+ * @param filter The filter.
+ * @param line The line.
+ * @return true if the line is shown by the filtered view, false otherwise.
+ */
+bool LineFilterIsMatch(const LineFilter* filter, uint64_t line);
+
+#endif /* LINEFILTER_H */
@@ -0,0 +1,90 @@
+/**
+ * @file lineindex.h
+ * @brief Line-start index for the Professional Text Editor
+ *
+ * Contains the sorted table of line start offsets used to translate
+ * between byte offsets and line numbers without rescanning the text.
+ */
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sorted byte offsets at which each line starts; starts[0] is always 0
+typedef struct {
+    uint64_t* starts;   // Line start offsets
+    size_t count;       // Number of lines (at least 1 once built)
+    size_t capacity;    // Allocated entries in starts
+} LineIndex;
+
+/**
+ * @brief Starts an index holding the first line of a buffer yet to be scanned.
+ *
+ * The buffer is then scanned in parts with LineIndexAppend.
+ *
+ * @param index The index to fill; any previous contents are released.
+ * @param expectedLength Length of the whole buffer, used to size the index.
+ * @return true if successful, false on allocation failure.
+ */
+bool LineIndexBegin(LineIndex* index, uint64_t expectedLength);
+
+/**
+ * @brief Builds a line index by scanning a buffer for line feeds.
+ *
+ * @param index The index to fill; any previous contents are released.
+ * @param text The text to scan.
+ * @param length Length of the text in bytes.
+ * @return true if successful, false on allocation failure.
+ */
+bool LineIndexBuild(LineIndex* index, const char* text, uint64_t length);
+
+/**
+ * @brief Extends a line index with text appended after the indexed range.
+ *
+ * @param index The index to extend (must already contain at least one line).
+ * @param text The appended text.
+ * @param length Length of the appended text in bytes.
+ * @param baseOffset Offset of the first appended byte in the indexed buffer.
+ * @return true if successful, false on allocation failure.
+ */
+bool LineIndexAppend(LineIndex* index, const char* text, uint64_t length, uint64_t baseOffset);
+
+/**
+ * @brief Adopts an existing array of line starts (e.g. loaded from a cache).
+ *
+ * @param index The index to fill; any previous contents are released.
+ * @param starts Array of line starts from MemoryAlloc; ownership is transferred.
+ * @param count Number of entries in starts.
+ */
+void LineIndexAdopt(LineIndex* index, uint64_t* starts, size_t count);
+
+/**
+ * @brief Finds the line containing a byte offset.
+ *
+ * @param index The line index.
+ * @param offset The byte offset.
+ * @return Zero-based line number.
+ */
+size_t LineIndexLineFromOffset(const LineIndex* index, uint64_t offset);
+
+/**
+ * @brief Counts line feeds in a half-open byte range using the index.
+ *
+ * @param index The line index.
+ * @param start Start of the range.
+ * @param end End of the range (exclusive).
+ * @return Number of line feeds in [start, end).
+ */
+size_t LineIndexCountBreaks(const LineIndex* index, uint64_t start, uint64_t end);
+
+/**
+ * @brief Releases the memory held by a line index.
+ *
+ * @param index The index to free. Safe to call on a zeroed index.
+ */
+void LineIndexFree(LineIndex* index);
+
+#endif /* LINEINDEX_H */
@@ -0,0 +1,79 @@
+/**
+ * @file linesort.h
+ * @brief Sorting and de-duplicating lines for the Professional Text Editor
+ *
+ * Contains the line sorter behind Sort Lines and Unique Lines. Lines are
+ * never copied: the sorter orders small records holding the position and
+ * the first eight bytes of every line, and the result is the list of
+ * document ranges that spell the sorted text, so it can be applied as one
+ * slice sharing the document's own pieces.
+ *
+ * Records that fit in the memory budget are sorted in parallel, each part
+ * with a radix sort on the line prefixes followed by a merge sort of equal
+ * prefixes, and the parts are merged. Larger inputs are sorted one budget
+ * at a time into run files that are merged with a k-way merge.
+ */
+
+#ifndef LINESORT_H
+#define LINESORT_H
+
+#include "document.h"
+
+/**
+ * @brief Callback reporting the progress of a sort.
+ *
+ * Called from the thread running the sort.
+ *
+ * @param done Work done so far.
+ * @param total Total work.
+ * @param context The context pointer given in the options.
+ * @return true to continue, false to cancel the sort.
+ */
+typedef bool (*LineSortProgress)(uint64_t done, uint64_t total, void* context);
+
+// Parameters of a sort
+typedef struct {
+    bool unique;                // Keep only the first of equal lines
+    unsigned threadCount;       // Maximum number of threads, or 0 for one per processor
+    size_t memoryBudget;        // Bytes of records sorted in memory; larger inputs are sorted in run files
+    const char* tempPrefix;     // Run files are created as <tempPrefix>.<number>; NULL sorts in memory whatever the size
+    LineSortProgress progress;  // Progress callback, or NULL
+    void* progressContext;      // Pointer passed to the progress callback
+} LineSortOptions;
+
+// Result of a sort
+typedef struct {
+    DocumentRange* ranges;      // Document ranges that form the sorted text, adjacent ranges joined
+    size_t count;               // Number of ranges
+    uint64_t length;            // Total length of the ranges
+    uint64_t inputLines;        // Lines in the sorted range
+    uint64_t outputLines;       // Lines in the result
+    bool cancelled;             // The progress callback cancelled the sort
+} LineSortResult;
+
+/**
+ * @brief Sorts the lines of a range of a document by their bytes.
+ *
+ * The range is extended to whole lines by the caller. Lines are compared
+ * without their terminators; equal lines keep their order. A range that
+ * ends with a line break keeps it at the end, and one that does not ends
+ * without one. The document must not change until the sort returns.
+ *
+ * @param document The document.
+ * @param offset Start of the range.
+ * @param length Length of the range.
+ * @param options Parameters of the sort.
+ * @param[out] result Receives the sorted ranges; free it with LineSortResultFree.
+ * @return true if successful, false on failure or cancellation (result->cancelled tells which).
+ */
+bool LineSortRun(const Document* document, uint64_t offset, uint64_t length, const LineSortOptions* options,
+                 LineSortResult* result);
+
+/**
+ * @brief Releases the ranges of a sort result.
+ *
+ * @param result The result. Safe to call on a zeroed result.
+ */
+void LineSortResultFree(LineSortResult* result);
+
+#endif /* LINESORT_H */
@@ -0,0 +1,156 @@
+/**
+ * @file macro.h
+ * @brief Keyboard macros for the Professional Text Editor
+ *
+ * Contains a recorder that turns the semantic operations of an editing
+ * session (caret movements, typed text, deletions) into a compact bytecode,
+ * and two ways of playing it back. MacroRun replays the operations at the
+ * carets a number of times as one undo step. MacroRunOnLines runs the
+ * macro over the text of every target line in memory, with each line
+ * standing for a whole document, and applies the results as a single edit
+ * batch: one history entry, one change notification and one repaint
+ * however many lines were edited.
+ *
+ * Each instruction is an operation byte followed by its operands, with
+ * counts and lengths as variable-length integers. Repeated movements and
+ * deletions are recorded as one instruction with a count, and consecutive
+ * typed text as one insertion.
+ */
+
+#ifndef MACRO_H
+#define MACRO_H
+
+#include "cursors.h"
+
+// Repeat count that plays a macro until the carets reach the end of the document
+#define MACRO_UNTIL_END UINT64_MAX
+
+// Recorded bytecode
+typedef struct {
+    uint8_t* code;
+    size_t length;
+    size_t capacity;
+    size_t last;                // Offset of the last instruction, or SIZE_MAX if none
+} Macro;
+
+/**
+ * @brief Initializes an empty macro.
+ *
+ * @param macro The macro.
+ */
+void MacroInit(Macro* macro);
+
+/**
+ * @brief Releases the memory held by a macro.
+ *
+ * @param macro The macro.
+ */
+void MacroFree(Macro* macro);
+
+/**
+ * @brief Removes every instruction of a macro.
+ *
+ * @param macro The macro.
+ */
+void MacroClear(Macro* macro);
+
+/**
+ * @brief Checks whether a macro has no instructions.
+ *
+ * @param macro The macro.
+ * @return true if empty, false otherwise.
+ */
+bool MacroIsEmpty(const Macro* macro);
+
+/**
+ * @brief Records a caret movement.
+ *
+ * @param macro The macro.
+ * @param movement The movement.
+ * @param extend true if the movement extended the selections.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordMove(Macro* macro, CursorMovement movement, bool extend);
+
+/**
+ * @brief Records text typed or inserted at the carets.
+ *
+ * @param macro The macro.
+ * @param text The text.
+ * @param length Length of the text.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordInsert(Macro* macro, const char* text, size_t length);
+
+/**
+ * @brief Records a deletion at the carets.
+ *
+ * @param macro The macro.
+ * @param forward true for a forward delete, false for backspace.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordDelete(Macro* macro, bool forward);
+
+/**
+ * @brief Records a deletion of words at the carets.
+ *
+ * @param macro The macro.
+ * @param forward true to delete to the next word, false to the start of the previous one.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordDeleteWord(Macro* macro, bool forward);
+
+/**
+ * @brief Checks whether a macro can run on single lines.
+ *
+ * Macros that move the carets up or down depend on the lines around them
+ * and cannot be run by MacroRunOnLines.
+ *
+ * @param macro The macro.
+ * @return true if the macro has no vertical movement, false otherwise.
+ */
+bool MacroIsLineLocal(const Macro* macro);
+
+/**
+ * @brief Plays a macro at the carets a number of times as one undo step.
+ *
+ * With MACRO_UNTIL_END, the macro is played until the text after the
+ * primary caret stops shrinking, which ends at the end of the document and
+ * stops macros that make no progress. Listeners are notified of every edit
+ * batch.
+ *
+ * @param macro The macro.
+ * @param cursors The carets to play at.
+ * @param document The document to edit.
+ * @param count Number of times to play, or MACRO_UNTIL_END.
+ * @param pageLines Number of lines moved by page movements.
+ * @param[out] runs Receives the number of complete plays; may be NULL.
+ * @return true if successful, false if an edit failed.
+ */
+bool MacroRun(const Macro* macro, CursorSet* cursors, Document* document, uint64_t count, uint64_t pageLines,
+              uint64_t* runs);
+
+/**
+ * @brief Plays a macro once on each line of a range as one edit batch.
+ *
+ * Every target line is copied into a buffer with the caret at its start
+ * and the macro runs there, with movements stopping at the ends of the
+ * line. Lines the macro changed are replaced, trimmed to the bytes that
+ * differ, in a single DocumentApplyEdits call.
+ *
+ * @param macro The macro; must be line-local.
+ * @param document The document to edit.
+ * @param cursors Carets moved through the edit, or NULL if a document listener moves them.
+ * @param firstLine First line of the range.
+ * @param lastLine Last line of the range.
+ * @param pattern Only lines containing this text are targets; NULL for every line.
+ * @param patternLength Length of the pattern.
+ * @param matchCase false to match the pattern ignoring ASCII case.
+ * @param[out] changedLines Receives the number of lines changed; may be NULL.
+ * @return true if successful, false if the macro is not line-local or memory ran out.
+ */
+bool MacroRunOnLines(const Macro* macro, Document* document, CursorSet* cursors, uint64_t firstLine,
+                     uint64_t lastLine, const char* pattern, size_t patternLength, bool matchCase,
+                     uint64_t* changedLines);
+
+#endif /* MACRO_H */
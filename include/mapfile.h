@@ -0,0 +1,75 @@
+/**
+ * @file mapfile.h
+ * @brief Read-only memory-mapped file access for the Professional Text Editor
+ *
+ * Contains a small platform layer that maps whole files into memory so
+ * large documents can be opened without reading them up front.
+ */
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes requested at a time when a mapping is read ahead of a scan
+#define MAPFILE_READ_AHEAD_WINDOW (8u << 20)
+
+// Windows requested ahead of the one being scanned
+#define MAPFILE_READ_AHEAD_DEPTH 4
+
+// Identity of a file on disk, used to detect changes between sessions
+typedef struct {
+    uint64_t size;      // File size in bytes
+    uint64_t mtime;     // Last write time in platform ticks
+} FileIdentity;
+
+// A read-only view of a whole file
+typedef struct {
+    const char* data;       // Start of the mapped bytes (never NULL once opened)
+    uint64_t size;          // Number of mapped bytes
+    FileIdentity identity;  // Identity of the file at the time it was mapped
+    void* fileHandle;       // Platform file handle
+    void* mappingHandle;    // Platform mapping handle (Windows only)
+} MappedFile;
+
+/**
+ * @brief Maps a file read-only into memory.
+ *
+ * @param filePath Path to the file to map.
+ * @param[out] mappedFile Receives the mapping; zeroed on failure.
+ * @return true if successful, false otherwise.
+ */
+bool MapFileOpen(const char* filePath, MappedFile* mappedFile);
+
+/**
+ * @brief Asks the system to start reading part of a mapping from disk.
+ *
+ * Returns without waiting for the reads, so a caller scanning the mapping
+ * can request the windows ahead of it and keep several reads in flight.
+ * Ranges that are already resident cost nothing.
+ *
+ * @param mappedFile The mapping.
+ * @param offset Start of the range.
+ * @param length Length of the range; clipped to the mapping.
+ */
+void MapFileReadAhead(const MappedFile* mappedFile, uint64_t offset, uint64_t length);
+
+/**
+ * @brief Unmaps a file previously mapped with MapFileOpen.
+ *
+ * @param mappedFile The mapping to release. Safe to call on a zeroed mapping.
+ */
+void MapFileClose(MappedFile* mappedFile);
+
+/**
+ * @brief Queries the size and last write time of a file without opening it.
+ *
+ * @param filePath Path to the file.
+ * @param[out] identity Receives the file identity.
+ * @return true if successful, false otherwise.
+ */
+bool GetFileIdentity(const char* filePath, FileIdentity* identity);
+
+#endif /* MAPFILE_H */
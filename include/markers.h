@@ -0,0 +1,194 @@
+/**
+ * @file markers.h
+ * @brief Edit-stable markers for the Professional Text Editor
+ *
+ * Contains the marker tree that remembers positions in a document across
+ * edits: bookmarks, search hits and diagnostics. A marker is a point or a
+ * range of offsets that moves with the text around it.
+ *
+ * Markers are kept in a balanced tree ordered by their start. A shift is
+ * recorded at the root of the subtree it applies to and passed down only
+ * when a query or edit descends there, so every position is relative to
+ * the shifts pending above it. An edit therefore costs O(log n) plus the
+ * markers that touch the edited range, whatever the number of markers
+ * after it, and a document with a million search hits types as fast as one
+ * with none. Each subtree also keeps the largest end and the kinds of its
+ * markers, so the markers of the visible rows, or the next bookmark among
+ * a million search hits, are found without visiting the others.
+ */
+
+#ifndef MARKERS_H
+#define MARKERS_H
+
+#include "document.h"
+
+// Identifier of a marker; 0 is never a valid marker
+typedef uint64_t MarkerId;
+
+// What a marker stands for; kinds are combined in masks as 1 << kind
+typedef enum {
+    MARKER_KIND_BOOKMARK,       // A line remembered by the user
+    MARKER_KIND_SEARCH_HIT,     // An occurrence of the search text
+    MARKER_KIND_DIAGNOSTIC,     // An error or warning location
+    MARKER_KIND_COUNT
+} MarkerKind;
+
+// Mask selecting markers of every kind
+#define MARKER_ALL_KINDS ((1u << MARKER_KIND_COUNT) - 1)
+
+// Where the edges of a marker go when text is inserted exactly at them
+typedef enum {
+    MARKER_GROWS_NEVER,         // Text inserted at either edge stays outside; a point stays before it
+    MARKER_GROWS_ALWAYS,        // Text inserted at either edge is taken in; a point becomes a range
+    MARKER_GROWS_AT_START,      // Only text inserted at the start is taken in; a point stays before it
+    MARKER_GROWS_AT_END         // Only text inserted at the end is taken in; a point moves after it
+} MarkerStickiness;
+
+// A marker as reported by queries
+typedef struct {
+    MarkerId id;
+    uint64_t start;
+    uint64_t end;               // Equal to start for a point marker
+    MarkerKind kind;
+    MarkerStickiness stickiness;
+    uint32_t value;             // Data chosen by the owner, such as a diagnostic severity
+} Marker;
+
+/**
+ * @brief Callback invoked for each marker found by MarkerTreeQuery.
+ *
+ * The tree must not be changed from the callback.
+ *
+ * @param marker The marker.
+ * @param context The context pointer given to MarkerTreeQuery.
+ * @return true to continue, false to stop.
+ */
+typedef bool (*MarkerCallback)(const Marker* marker, void* context);
+
+typedef struct MarkerTree MarkerTree;
+
+/**
+ * @brief Creates the empty marker tree of a document.
+ *
+ * The tree registers itself as a document listener and moves its markers
+ * with every change. Text removed around a marker collapses it to the
+ * position of the removal; markers are never removed by edits.
+ *
+ * @param document The document; it must outlive the tree.
+ * @return The tree, or NULL on allocation failure.
+ */
+MarkerTree* MarkerTreeCreate(Document* document);
+
+/**
+ * @brief Destroys a marker tree and unregisters it from its document.
+ *
+ * @param tree The tree. NULL is ignored.
+ */
+void MarkerTreeDestroy(MarkerTree* tree);
+
+/**
+ * @brief Adds a marker.
+ *
+ * @param tree The tree.
+ * @param start Start of the marker.
+ * @param end End of the marker; equal to start for a point.
+ * @param kind What the marker stands for.
+ * @param stickiness How the marker takes in text inserted at its edges.
+ * @param value Data returned with the marker.
+ * @return The identifier of the marker, or 0 if the range is invalid or memory ran out.
+ */
+MarkerId MarkerTreeAdd(MarkerTree* tree, uint64_t start, uint64_t end, MarkerKind kind,
+                       MarkerStickiness stickiness, uint32_t value);
+
+/**
+ * @brief Removes a marker.
+ *
+ * @param tree The tree.
+ * @param id The marker.
+ * @return true if the marker was removed, false if it no longer exists.
+ */
+bool MarkerTreeRemove(MarkerTree* tree, MarkerId id);
+
+/**
+ * @brief Removes every marker of the kinds in a mask.
+ *
+ * @param tree The tree.
+ * @param kinds Mask of kinds, 1 << kind for each.
+ * @return Number of markers removed.
+ */
+size_t MarkerTreeRemoveKinds(MarkerTree* tree, uint32_t kinds);
+
+/**
+ * @brief Gets the current position of a marker.
+ *
+ * @param tree The tree.
+ * @param id The marker.
+ * @param[out] marker Receives the marker.
+ * @return true if the marker exists, false otherwise.
+ */
+bool MarkerTreeGet(const MarkerTree* tree, MarkerId id, Marker* marker);
+
+/**
+ * @brief Gets the number of markers of the kinds in a mask.
+ *
+ * @param tree The tree.
+ * @param kinds Mask of kinds.
+ * @return The number of markers.
+ */
+size_t MarkerTreeCount(const MarkerTree* tree, uint32_t kinds);
+
+/**
+ * @brief Reports the markers that overlap or touch a range, in order of their start.
+ *
+ * A marker is reported when it starts at or before the end of the range
+ * and ends at or after its start, so the markers of the visible rows are
+ * found with one query.
+ *
+ * @param tree The tree.
+ * @param from Start of the range.
+ * @param to End of the range.
+ * @param kinds Mask of the kinds to report.
+ * @param callback Invoked for each marker.
+ * @param context Pointer passed to the callback.
+ * @return Number of markers reported.
+ */
+size_t MarkerTreeQuery(const MarkerTree* tree, uint64_t from, uint64_t to, uint32_t kinds,
+                       MarkerCallback callback, void* context);
+
+/**
+ * @brief Finds the first marker of some kinds starting at or after an offset.
+ *
+ * @param tree The tree.
+ * @param offset The offset.
+ * @param kinds Mask of kinds.
+ * @param[out] marker Receives the marker.
+ * @return true if one was found, false otherwise.
+ */
+bool MarkerTreeNext(const MarkerTree* tree, uint64_t offset, uint32_t kinds, Marker* marker);
+
+/**
+ * @brief Finds the last marker of some kinds starting before an offset.
+ *
+ * @param tree The tree.
+ * @param offset The offset.
+ * @param kinds Mask of kinds.
+ * @param[out] marker Receives the marker.
+ * @return true if one was found, false otherwise.
+ */
+bool MarkerTreePrevious(const MarkerTree* tree, uint64_t offset, uint32_t kinds, Marker* marker);
+
+/**
+ * @brief Marks a line, or removes the marks of a line that has some.
+ *
+ * A line is marked with a point at its start that moves after text
+ * inserted there, so a line break typed at the start of the line keeps
+ * the mark with the line's text.
+ *
+ * @param tree The tree.
+ * @param line The line.
+ * @param kind The kind of the mark, such as MARKER_KIND_BOOKMARK.
+ * @return true if the line is now marked, false if its marks were removed or memory ran out.
+ */
+bool MarkerTreeToggleLine(MarkerTree* tree, uint64_t line, MarkerKind kind);
+
+#endif /* MARKERS_H */
@@ -0,0 +1,193 @@
+/**
+ * @file memory.h
+ * @brief Tagged memory allocation for the Professional Text Editor
+ *
+ * Contains the allocator used by the editor core. Every allocation names
+ * the subsystem that owns it, and live bytes, peak bytes and allocation
+ * counts are kept per subsystem for the diagnostics report.
+ *
+ * Small blocks come from size-class pools: each thread keeps free lists of
+ * recently freed blocks that it reuses without locking, and exchanges
+ * batches of blocks with a shared depot when a list runs empty or grows
+ * long. Pool memory is carved from large slabs and kept for reuse rather
+ * than returned to the system. Larger blocks go to the system allocator.
+ * Arenas hand out scratch memory for a single operation and release it
+ * all at once.
+ *
+ * Memory from MemoryAlloc must be released with MemoryFree, never free().
+ * Buffers handed to callers through public interfaces that document
+ * free() keep using the system allocator.
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Subsystem owning an allocation
+typedef enum {
+    MEMORY_TAG_DOCUMENT,        // Piece chunks, line indexes, versions, history and slices
+    MEMORY_TAG_EDITING,         // Caret sets, edit batches and macros
+    MEMORY_TAG_LAYOUT,          // Wrapped line layout
+    MEMORY_TAG_STRUCTURE,       // Bracket and indentation structure, folds
+    MEMORY_TAG_WORDS,           // Word index used by completion
+    MEMORY_TAG_SPELLING,        // Spelling dictionary and checker
+    MEMORY_TAG_DIFF,            // Document comparison
+    MEMORY_TAG_SORT,            // Line sorting
+    MEMORY_TAG_TABLE,           // Delimited table index
+    MEMORY_TAG_JSON,            // JSON structure index
+    MEMORY_TAG_SCREEN,          // Terminal screen grids
+    MEMORY_TAG_HEX,             // Hex view overlay and undo
+    MEMORY_TAG_SESSION,         // Session file encoding
+    MEMORY_TAG_WRITER,          // Background file writers
+    MEMORY_TAG_THREADS,         // Threads, locks and condition variables
+    MEMORY_TAG_MARKERS,         // Bookmarks, search hits and other markers
+    MEMORY_TAG_FILTER,          // Matching-line filters
+    MEMORY_TAG_TIMES,           // Timestamp indexes
+    MEMORY_TAG_COUNT
+} MemoryTag;
+
+// Usage of one subsystem
+typedef struct {
+    uint64_t liveBytes;         // Bytes currently allocated
+    uint64_t peakBytes;         // Highest value of liveBytes so far
+    uint64_t allocations;       // Allocations made so far
+} MemoryTagStats;
+
+// Usage of every subsystem and of the pools
+typedef struct {
+    MemoryTagStats tags[MEMORY_TAG_COUNT];
+    uint64_t poolBytes;         // Bytes of slabs carved into pool blocks
+    uint64_t pooledAllocations; // Allocations served from the pools
+} MemoryStats;
+
+// Layout of a usage report
+typedef enum {
+    MEMORY_REPORT_TEXT,         // Aligned table for people
+    MEMORY_REPORT_JSON          // JSON object for tools
+} MemoryReportFormat;
+
+// Chunked scratch memory released all at once
+typedef struct MemoryArenaChunk MemoryArenaChunk;
+
+typedef struct {
+    MemoryArenaChunk* chunks;   // Newest chunk first
+    size_t used;                // Bytes used in the newest chunk
+    MemoryTag tag;
+} MemoryArena;
+
+/**
+ * @brief Allocates memory owned by a subsystem.
+ *
+ * @param tag The owning subsystem.
+ * @param size Number of bytes; 0 allocates a minimal block.
+ * @return The memory, aligned to 16 bytes, or NULL on failure.
+ */
+void* MemoryAlloc(MemoryTag tag, size_t size);
+
+/**
+ * @brief Allocates zeroed memory owned by a subsystem.
+ *
+ * @param tag The owning subsystem.
+ * @param count Number of elements.
+ * @param size Size of each element.
+ * @return The memory, or NULL on failure or overflow.
+ */
+void* MemoryCalloc(MemoryTag tag, size_t count, size_t size);
+
+/**
+ * @brief Resizes memory, moving it if needed.
+ *
+ * @param tag The owning subsystem; the block is retagged if it differs.
+ * @param memory Memory from MemoryAlloc, or NULL to allocate.
+ * @param size The new size in bytes.
+ * @return The resized memory, or NULL on failure (the old block is then untouched).
+ */
+void* MemoryRealloc(MemoryTag tag, void* memory, size_t size);
+
+/**
+ * @brief Releases memory from MemoryAlloc on any thread.
+ *
+ * @param memory The memory. NULL is ignored.
+ */
+void MemoryFree(void* memory);
+
+/**
+ * @brief Returns the pool blocks cached by the calling thread to the shared depot.
+ *
+ * Called by threads started with ThreadStart before they end, so that
+ * blocks they freed can be reused by other threads.
+ */
+void MemoryReleaseThreadCache(void);
+
+/**
+ * @brief Initializes an empty arena.
+ *
+ * @param arena The arena.
+ * @param tag The subsystem charged for its chunks.
+ */
+void MemoryArenaInit(MemoryArena* arena, MemoryTag tag);
+
+/**
+ * @brief Allocates scratch memory from an arena.
+ *
+ * @param arena The arena.
+ * @param size Number of bytes.
+ * @return The memory, aligned to 16 bytes, or NULL on failure.
+ */
+void* MemoryArenaAlloc(MemoryArena* arena, size_t size);
+
+/**
+ * @brief Releases every allocation of an arena at once.
+ *
+ * The newest chunk is kept for the next operation unless it is large.
+ *
+ * @param arena The arena.
+ */
+void MemoryArenaReset(MemoryArena* arena);
+
+/**
+ * @brief Releases an arena and all of its chunks.
+ *
+ * @param arena The arena.
+ */
+void MemoryArenaFree(MemoryArena* arena);
+
+/**
+ * @brief Gets the display name of a subsystem.
+ *
+ * @param tag The subsystem.
+ * @return The name.
+ */
+const char* MemoryTagName(MemoryTag tag);
+
+/**
+ * @brief Takes a snapshot of the memory usage.
+ *
+ * Threads publish their counts in batches, so live bytes may trail the
+ * true value by a few tens of kilobytes per thread.
+ *
+ * @param[out] stats Receives the usage.
+ */
+void MemoryGetStats(MemoryStats* stats);
+
+/**
+ * @brief Lowers the peak of every subsystem to its live bytes.
+ *
+ * Lets the peaks of a single task be measured.
+ */
+void MemoryResetPeaks(void);
+
+/**
+ * @brief Formats the memory usage as a report.
+ *
+ * @param format The layout of the report.
+ * @param buffer Receives the NUL-terminated report; may be NULL if capacity is 0.
+ * @param capacity Size of the buffer.
+ * @return The length of the full report, which was truncated if not less than capacity.
+ */
+size_t MemoryFormatReport(MemoryReportFormat format, char* buffer, size_t capacity);
+
+#endif /* MEMORY_H */
@@ -0,0 +1,185 @@
+/**
+ * @file screen.h
+ * @brief Character cell screen for the terminal frontend of the Professional Text Editor
+ *
+ * Contains a double-buffered grid of character cells. The front grid holds
+ * what the terminal shows and the back grid what the next frame should
+ * show; the frontend draws every frame into the back grid and
+ * ScreenFlush emits only the escape sequences for the cells that differ.
+ * When the rows of the scroll region moved as a block, the terminal is told
+ * to scroll them instead, so scrolling by a line costs a few bytes plus the
+ * new line instead of a full repaint. The module does no I/O and is
+ * platform independent.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cell attributes
+#define SCREEN_ATTRIBUTE_BOLD 0x1
+#define SCREEN_ATTRIBUTE_UNDERLINE 0x2
+#define SCREEN_ATTRIBUTE_REVERSE 0x4
+
+// Unchanged cells rewritten rather than skipped with a cursor move, which costs about as many bytes
+#define SCREEN_MAX_REWRITE_GAP 4
+
+// One character cell
+typedef struct {
+    uint32_t codepoint;         // Unicode code point shown in the cell
+    uint8_t attributes;         // SCREEN_ATTRIBUTE_ flags
+} ScreenCell;
+
+// Work done by the flushes so far
+typedef struct {
+    unsigned long long frames;          // Flushes that emitted anything
+    unsigned long long cellsWritten;
+    unsigned long long bytesWritten;
+    unsigned long long scrolls;         // Scroll region moves used instead of repainting
+} ScreenStats;
+
+typedef struct Screen Screen;
+
+/**
+ * @brief Creates a screen; the first flush redraws every cell.
+ *
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ * @return The screen, or NULL on allocation failure.
+ */
+Screen* ScreenCreate(unsigned rows, unsigned columns);
+
+/**
+ * @brief Destroys a screen.
+ *
+ * @param screen The screen. NULL is ignored.
+ */
+void ScreenDestroy(Screen* screen);
+
+/**
+ * @brief Changes the size of a screen; the next flush redraws every cell.
+ *
+ * @param screen The screen.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ * @return true if successful, false on allocation failure (the screen keeps its size).
+ */
+bool ScreenResize(Screen* screen, unsigned rows, unsigned columns);
+
+/**
+ * @brief Gets the number of rows of a screen.
+ *
+ * @param screen The screen.
+ * @return The number of rows.
+ */
+unsigned ScreenRows(const Screen* screen);
+
+/**
+ * @brief Gets the number of columns of a screen.
+ *
+ * @param screen The screen.
+ * @return The number of columns.
+ */
+unsigned ScreenColumns(const Screen* screen);
+
+/**
+ * @brief Sets the rows in which block moves are looked for.
+ *
+ * Rows outside the region (a status line) are never scrolled. By default
+ * the region is the whole screen.
+ *
+ * @param screen The screen.
+ * @param top First row of the region.
+ * @param bottom Last row of the region.
+ */
+void ScreenSetScrollRegion(Screen* screen, unsigned top, unsigned bottom);
+
+/**
+ * @brief Makes the next flush redraw every cell, as after the terminal lost its content.
+ *
+ * @param screen The screen.
+ */
+void ScreenInvalidate(Screen* screen);
+
+/**
+ * @brief Fills a row of the back grid from a column to its end.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column First column to fill.
+ * @param codepoint Code point of every cell.
+ * @param attributes Attributes of every cell.
+ */
+void ScreenFill(Screen* screen, unsigned row, unsigned column, uint32_t codepoint, uint8_t attributes);
+
+/**
+ * @brief Sets one cell of the back grid; cells outside the screen are ignored.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column The column.
+ * @param codepoint Code point shown in the cell.
+ * @param attributes SCREEN_ATTRIBUTE_ flags.
+ */
+void ScreenPut(Screen* screen, unsigned row, unsigned column, uint32_t codepoint, uint8_t attributes);
+
+/**
+ * @brief Writes ASCII text into the back grid, one cell per byte, clipped at the row end.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column First column.
+ * @param text The text.
+ * @param length Length of the text.
+ * @param attributes Attributes of the cells.
+ * @return Column just past the text.
+ */
+unsigned ScreenPutText(Screen* screen, unsigned row, unsigned column, const char* text, size_t length,
+                       uint8_t attributes);
+
+/**
+ * @brief Sets the attributes of cells of the back grid, keeping their code points.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column First column.
+ * @param count Number of cells; clipped at the row end.
+ * @param attributes The attributes.
+ */
+void ScreenSetAttributes(Screen* screen, unsigned row, unsigned column, unsigned count, uint8_t attributes);
+
+/**
+ * @brief Sets where the terminal cursor is left after the next flush.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column The column.
+ * @param visible false to hide the cursor.
+ */
+void ScreenSetCursor(Screen* screen, unsigned row, unsigned column, bool visible);
+
+/**
+ * @brief Makes the terminal show the back grid.
+ *
+ * Emits the escape sequences turning the front grid into the back grid
+ * and updates the front grid. The back grid keeps its content, so a frame
+ * may redraw only part of it.
+ *
+ * @param screen The screen.
+ * @param[out] length Receives the number of bytes to write to the terminal.
+ * @return The bytes, valid until the next call; NULL on allocation failure.
+ */
+const char* ScreenFlush(Screen* screen, size_t* length);
+
+/**
+ * @brief Gets the work done by the flushes so far.
+ *
+ * @param screen The screen.
+ * @param[out] stats Receives the statistics.
+ */
+void ScreenGetStats(const Screen* screen, ScreenStats* stats);
+
+#endif /* SCREEN_H */
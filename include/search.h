@@ -0,0 +1,70 @@
+/**
+ * @file search.h
+ * @brief Literal text search over documents for the Professional Text Editor
+ *
+ * Contains the streaming matcher used by find, occurrence selection and
+ * other features that need to locate text without copying the document.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "document.h"
+
+// Longest pattern accepted by the search functions
+#define SEARCH_MAX_PATTERN 1024
+
+/**
+ * @brief Callback invoked for each match found by SearchFindAll.
+ *
+ * @param offset Offset of the match.
+ * @param context The context pointer given to SearchFindAll.
+ * @return true to continue searching, false to stop.
+ */
+typedef bool (*SearchMatchCallback)(uint64_t offset, void* context);
+
+/**
+ * @brief Finds the first occurrence of a pattern at or after an offset.
+ *
+ * @param document The document to search.
+ * @param pattern The text to find.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param from Offset at which the search starts.
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param[out] matchOffset Receives the offset of the match.
+ * @return true if a match was found, false otherwise.
+ */
+bool SearchFindNext(const Document* document, const char* pattern, size_t patternLength, uint64_t from,
+                    bool matchCase, uint64_t* matchOffset);
+
+/**
+ * @brief Reports every non-overlapping occurrence of a pattern in a range.
+ *
+ * @param document The document to search.
+ * @param pattern The text to find.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param from Start of the searched range.
+ * @param to End of the searched range (matches must end at or before it).
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param callback Invoked for each match in ascending order.
+ * @param context Pointer passed to the callback.
+ * @return Number of matches reported.
+ */
+uint64_t SearchFindAll(const Document* document, const char* pattern, size_t patternLength, uint64_t from,
+                       uint64_t to, bool matchCase, SearchMatchCallback callback, void* context);
+
+/**
+ * @brief Finds the first occurrence of a pattern in a buffer.
+ *
+ * @param text The buffer, such as a part of a mapped file.
+ * @param length Length of the buffer.
+ * @param pattern The text to find.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param[out] matchOffset Receives the offset of the match in the buffer.
+ * @return true if a match was found, false otherwise.
+ */
+bool SearchFindInText(const char* text, size_t length, const char* pattern, size_t patternLength, bool matchCase,
+                      size_t* matchOffset);
+
+#endif /* SEARCH_H */
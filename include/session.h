@@ -0,0 +1,115 @@
+/**
+ * @file session.h
+ * @brief Session snapshot and index cache for the Professional Text Editor
+ *
+ * Contains the functions that persist the open documents with their caret
+ * and scroll positions, and the binary sidecar files that cache derived
+ * indexes and fold state so large files reopen without being rescanned.
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "folds.h"
+#include "lineindex.h"
+#include "mapfile.h"
+
+// Limits of the session manifest
+#define SESSION_MAX_DOCUMENTS 16
+#define SESSION_PATH_MAX 260
+
+// File names inside the session directory
+#define SESSION_MANIFEST_NAME "session.dat"
+#define SESSION_INDEX_EXTENSION ".idx"
+
+// Caret and scroll position of a document view
+typedef struct {
+    uint64_t selectionStart;    // Anchor of the selection (byte offset)
+    uint64_t selectionEnd;      // Caret position (byte offset)
+    uint64_t firstVisibleLine;  // Topmost visible line
+} DocumentViewState;
+
+// One document recorded in the session manifest
+typedef struct {
+    char filePath[SESSION_PATH_MAX];
+    DocumentViewState view;
+} SessionDocument;
+
+// The set of documents open when the editor last exited
+typedef struct {
+    SessionDocument documents[SESSION_MAX_DOCUMENTS];
+    size_t documentCount;
+    size_t activeDocument;      // Index into documents of the focused document
+} Session;
+
+// Key that decides whether a cached index still matches the file on disk
+typedef struct {
+    FileIdentity identity;      // Size and last write time
+    uint64_t contentHash;       // Sampled hash of the file content
+} DocumentKey;
+
+/**
+ * @brief Writes the session manifest to the session directory.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param session The session to persist.
+ * @return true if successful, false otherwise.
+ */
+bool SessionSave(const char* sessionDir, const Session* session);
+
+/**
+ * @brief Reads the session manifest from the session directory.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param[out] session Receives the session; empty if none was saved.
+ * @return true if a session was loaded, false otherwise.
+ */
+bool SessionLoad(const char* sessionDir, Session* session);
+
+/**
+ * @brief Computes the cache key for file content.
+ *
+ * Small files are hashed completely. Large files are hashed from their
+ * head, tail and evenly spaced samples so the key costs a few hundred
+ * kilobytes of reads regardless of file size.
+ *
+ * @param data The file content.
+ * @param size Size of the content in bytes.
+ * @param identity Size and last write time of the file.
+ * @param[out] key Receives the key.
+ */
+void SessionComputeDocumentKey(const char* data, uint64_t size, const FileIdentity* identity, DocumentKey* key);
+
+/**
+ * @brief Writes the derived indexes of a file to its sidecar.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param filePath Path of the document the indexes belong to.
+ * @param key Key of the document content the indexes were built from.
+ * @param lineIndex Line-start index of the content.
+ * @param folds Folds of the view over the same content, sorted by hideStart; may be NULL if foldCount is 0.
+ * @param foldCount Number of folds.
+ * @return true if successful, false otherwise.
+ */
+bool SessionStoreIndexes(const char* sessionDir, const char* filePath, const DocumentKey* key,
+                         const LineIndex* lineIndex, const Fold* folds, size_t foldCount);
+
+/**
+ * @brief Loads the derived indexes of a file from its sidecar.
+ *
+ * Fails without touching the outputs when the sidecar is missing, corrupt
+ * or was written for different file content.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param filePath Path of the document.
+ * @param key Key of the current file content.
+ * @param[out] lineIndex Receives the line-start index.
+ * @param[out] folds Receives the saved folds, to be released with MemoryFree, or NULL if there are none;
+ *                   may be NULL to skip them.
+ * @param[out] foldCount Receives the number of folds; may be NULL if folds is.
+ * @return true if the cached indexes match the file, false otherwise.
+ */
+bool SessionLoadIndexes(const char* sessionDir, const char* filePath, const DocumentKey* key,
+                        LineIndex* lineIndex, Fold** folds, size_t* foldCount);
+
+#endif /* SESSION_H */
@@ -0,0 +1,113 @@
+/**
+ * @file spellcheck.h
+ * @brief Background spell checker for the Professional Text Editor
+ *
+ * Contains the spell checker of a view. The checker keeps the ranges of the
+ * document that still need checking and the misspelled words found so far.
+ * The UI thread hands out chunks of text to a worker thread, visible text
+ * first; after an edit only the changed ranges are checked again. Results
+ * are merged back on the UI thread, so the renderer reads them without locks.
+ */
+
+#ifndef SPELLCHECK_H
+#define SPELLCHECK_H
+
+#include "document.h"
+#include "spelldict.h"
+
+// One misspelled word
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+} SpellRange;
+
+/**
+ * @brief Callback invoked on the worker thread when a chunk has been checked.
+ *
+ * The owner is expected to call SpellCheckerCollect on its own thread.
+ *
+ * @param context The context pointer given at creation.
+ */
+typedef void (*SpellCheckerNotify)(void* context);
+
+typedef struct SpellChecker SpellChecker;
+
+/**
+ * @brief Creates a spell checker and starts its worker thread.
+ *
+ * @param dictionary The dictionary; must outlive the checker.
+ * @param notify Callback invoked when results are ready.
+ * @param context Context pointer passed to the callback.
+ * @return The checker, or NULL on failure.
+ */
+SpellChecker* SpellCheckerCreate(const SpellDict* dictionary, SpellCheckerNotify notify, void* context);
+
+/**
+ * @brief Stops the worker thread and destroys a spell checker.
+ *
+ * @param checker The checker. NULL is ignored.
+ */
+void SpellCheckerDestroy(SpellChecker* checker);
+
+/**
+ * @brief Forgets all results and marks the whole document as unchecked.
+ *
+ * @param checker The checker.
+ * @param document The document.
+ */
+void SpellCheckerReset(SpellChecker* checker, const Document* document);
+
+/**
+ * @brief Updates the checker after the document changed.
+ *
+ * Results touched by a change are dropped and the changed text is marked
+ * as unchecked; everything else moves with the text.
+ *
+ * @param checker The checker.
+ * @param document The document after the change.
+ * @param changes The changes reported to the document listener, or NULL if unknown.
+ * @param changeCount Number of changes.
+ */
+void SpellCheckerMapChanges(SpellChecker* checker, const Document* document, const DocumentChange* changes,
+                            size_t changeCount);
+
+/**
+ * @brief Hands unchecked text to the worker thread.
+ *
+ * Unchecked text between the visible offsets goes first.
+ *
+ * @param checker The checker.
+ * @param document The document.
+ * @param visibleStart Start of the visible text.
+ * @param visibleEnd End of the visible text.
+ */
+void SpellCheckerSchedule(SpellChecker* checker, const Document* document, uint64_t visibleStart,
+                          uint64_t visibleEnd);
+
+/**
+ * @brief Merges the results of the chunks the worker has finished.
+ *
+ * @param checker The checker.
+ * @return true if the misspelled ranges changed, false otherwise.
+ */
+bool SpellCheckerCollect(SpellChecker* checker);
+
+/**
+ * @brief Gets the misspelled words found so far.
+ *
+ * @param checker The checker.
+ * @param[out] count Receives the number of ranges.
+ * @return The ranges, sorted by offset.
+ */
+const SpellRange* SpellCheckerRanges(const SpellChecker* checker, size_t* count);
+
+/**
+ * @brief Finds the first misspelled word ending after an offset.
+ *
+ * @param checker The checker.
+ * @param offset The offset.
+ * @return Index of the range, or the range count if there is none.
+ */
+size_t SpellCheckerFindFirst(const SpellChecker* checker, uint64_t offset);
+
+#endif /* SPELLCHECK_H */
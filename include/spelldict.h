@@ -0,0 +1,93 @@
+/**
+ * @file spelldict.h
+ * @brief Compiled spelling dictionary for the Professional Text Editor
+ *
+ * Contains the dictionary used by the spell checker. A word list is
+ * compiled once into a minimal acyclic automaton (DAWG) whose edges are
+ * stored as a flat array of 32-bit words. The compiled file is memory-mapped
+ * and used in place, so opening it does not depend on the number of words.
+ */
+
+#ifndef SPELLDICT_H
+#define SPELLDICT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest word looked up or suggested, in bytes
+#define SPELL_MAX_WORD 64
+
+// Largest edit distance of a suggestion
+#define SPELL_MAX_DISTANCE 2
+
+typedef struct SpellDict SpellDict;
+
+/**
+ * @brief Compiles a word list into a dictionary file.
+ *
+ * The list holds one word per line in any order. Text after a '/' (affix
+ * flags of Hunspell word lists) is ignored, as is a leading line holding
+ * only the word count. Words are folded to lowercase.
+ *
+ * @param words The word list.
+ * @param length Length of the word list.
+ * @param outputPath Path of the compiled dictionary.
+ * @return true if successful, false otherwise.
+ */
+bool SpellDictCompile(const char* words, size_t length, const char* outputPath);
+
+/**
+ * @brief Opens a compiled dictionary.
+ *
+ * @param path Path of the compiled dictionary.
+ * @return The dictionary, or NULL if the file is missing or invalid.
+ */
+SpellDict* SpellDictOpen(const char* path);
+
+/**
+ * @brief Closes a dictionary.
+ *
+ * @param dictionary The dictionary. NULL is ignored.
+ */
+void SpellDictClose(SpellDict* dictionary);
+
+/**
+ * @brief Gets the number of words in a dictionary.
+ *
+ * @param dictionary The dictionary.
+ * @return The word count.
+ */
+uint32_t SpellDictWordCount(const SpellDict* dictionary);
+
+/**
+ * @brief Checks whether a word is in the dictionary.
+ *
+ * ASCII letters are compared without regard to case, and a possessive
+ * "'s" is accepted after a known word.
+ *
+ * @param dictionary The dictionary.
+ * @param word The word.
+ * @param length Length of the word.
+ * @return true if the word is known, false otherwise.
+ */
+bool SpellDictContains(const SpellDict* dictionary, const char* word, size_t length);
+
+/**
+ * @brief Finds the known words closest to a word.
+ *
+ * Walks the automaton with a bounded edit distance (insertions, deletions,
+ * substitutions and transpositions), pruning every branch that cannot get
+ * within SPELL_MAX_DISTANCE. Suggestions take the capitalization of the word.
+ *
+ * @param dictionary The dictionary.
+ * @param word The word.
+ * @param length Length of the word.
+ * @param[out] suggestions Receives NUL-terminated suggestions, closest first.
+ * @param maxSuggestions Capacity of the suggestions array.
+ * @return Number of suggestions stored.
+ */
+size_t SpellDictSuggest(const SpellDict* dictionary, const char* word, size_t length,
+                        char suggestions[][SPELL_MAX_WORD + 1], size_t maxSuggestions);
+
+#endif /* SPELLDICT_H */
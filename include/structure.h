@@ -0,0 +1,90 @@
+/**
+ * @file structure.h
+ * @brief Bracket and indentation structure index for the Professional Text Editor
+ *
+ * Contains an index that summarizes the bracket nesting and indentation of
+ * the document per block of lines. Blocks are the leaves of a balanced
+ * tree whose nodes combine the summaries of their children, so matching
+ * brackets and fold ranges are found by descending the tree instead of
+ * scanning the text. Edits rescan only the blocks they touch.
+ *
+ * Brackets inside double-quoted strings and after "//" on the same line are
+ * ignored. Strings and comments do not span lines, so every block can be
+ * scanned on its own.
+ */
+
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include "document.h"
+
+typedef struct StructureIndex StructureIndex;
+
+/**
+ * @brief Creates the structure index of a document.
+ *
+ * The index registers itself as a document listener and is built the first
+ * time it is queried.
+ *
+ * @param document The document; it must outlive the index.
+ * @return The index, or NULL on allocation failure.
+ */
+StructureIndex* StructureIndexCreate(Document* document);
+
+/**
+ * @brief Destroys a structure index and unregisters it from its document.
+ *
+ * @param index The index. NULL is ignored.
+ */
+void StructureIndexDestroy(StructureIndex* index);
+
+/**
+ * @brief Finds the bracket matching the bracket at an offset.
+ *
+ * @param index The index.
+ * @param offset Offset of a bracket character.
+ * @param[out] match Receives the offset of the matching bracket.
+ * @return true if the offset holds a bracket with a partner of the same kind, false otherwise.
+ */
+bool StructureFindMatchingBracket(StructureIndex* index, uint64_t offset, uint64_t* match);
+
+/**
+ * @brief Finds the innermost bracket pair around an offset.
+ *
+ * @param index The index.
+ * @param offset The offset.
+ * @param[out] open Receives the offset of the opening bracket (before offset).
+ * @param[out] close Receives the offset of the closing bracket (at or after offset).
+ * @return true if the offset is enclosed by a pair of the same kind, false otherwise.
+ */
+bool StructureFindEnclosingBrackets(StructureIndex* index, uint64_t offset, uint64_t* open, uint64_t* close);
+
+/**
+ * @brief Finds the lines indented deeper than a line and following it.
+ *
+ * Trailing blank lines are not part of the block.
+ *
+ * @param index The index.
+ * @param line The header line.
+ * @param[out] lastLine Receives the last line of the block.
+ * @return true if at least one line follows with a deeper indentation, false otherwise.
+ */
+bool StructureFindIndentBlock(StructureIndex* index, uint64_t line, uint64_t* lastLine);
+
+/**
+ * @brief Finds the region that folds at a line.
+ *
+ * A bracket pair opened on the line is preferred, then an indentation
+ * block below the line, then the innermost bracket pair around the line.
+ * The header line stays visible; for bracket pairs so does the line of the
+ * closing bracket.
+ *
+ * @param index The index.
+ * @param line The line.
+ * @param[out] headerLine Receives the line that stays visible above the region.
+ * @param[out] lastLine Receives the last line hidden by the region.
+ * @return true if a region with at least one hidden line was found, false otherwise.
+ */
+bool StructureFindFoldRange(StructureIndex* index, uint64_t line, uint64_t* headerLine, uint64_t* lastLine);
+
+#endif /* STRUCTURE_H */
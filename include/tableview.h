@@ -0,0 +1,45 @@
+/**
+ * @file tableview.h
+ * @brief Table view for delimited files in the Professional Text Editor
+ *
+ * Contains the read-only view that shows a CSV or TSV document as aligned
+ * columns under its first row. Rows are located through the structural
+ * row index, so opening, scrolling and jumping to a row cost the same in
+ * a file of any size; clicking a column header sorts the rows by it.
+ */
+
+#ifndef TABLEVIEW_H
+#define TABLEVIEW_H
+
+#include "editor.h"
+#include "document.h"
+
+// Window class of the table view
+#define TABLE_VIEW_CLASS_NAME "PROFESSIONAL_TEXTEDITOR_TABLEVIEW"
+
+/**
+ * @brief Creates the table view within the parent window.
+ *
+ * The view is created hidden and without a document.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hInstance Handle to the application instance.
+ * @return Handle to the view, or NULL if creation failed.
+ */
+HWND CreateTableView(HWND hWnd, HINSTANCE hInstance);
+
+/**
+ * @brief Shows a document in the table view.
+ *
+ * The rows are indexed now and again after every change of the document.
+ * The document stays owned by the caller and must be detached with a NULL
+ * document before it is destroyed.
+ *
+ * @param hTable Handle to the table view.
+ * @param document The document, or NULL to detach the current one.
+ * @param delimiter Field delimiter, or 0 to guess it from the first lines.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL SetTableViewDocument(HWND hTable, Document* document, char delimiter);
+
+#endif /* TABLEVIEW_H */
@@ -0,0 +1,146 @@
+/**
+ * @file textformat.h
+ * @brief Whitespace formatting for the Professional Text Editor
+ *
+ * Contains the formatter that trims trailing whitespace, expands tabs and
+ * ends the text with a line break. Its stages run together in one pass
+ * over the text as it streams through, span by span: a save passes the
+ * document's pieces through it on their way to the file writer, so the
+ * formatted text is never built in memory. Unchanged runs are passed on
+ * as they are; lines that need no change are skipped a block at a time,
+ * and tabs are found with memchr.
+ *
+ * While it writes, the formatter can record what it changed as a sorted
+ * list of document edits: spaces removed before a line break, tabs
+ * replaced by spaces, a line break added. Applied to the document, the
+ * list makes it equal to the saved file, and the same list is what the
+ * formatting commands apply, so each is one small undoable step.
+ */
+
+#ifndef TEXTFORMAT_H
+#define TEXTFORMAT_H
+
+#include "document.h"
+
+// Stages of the format pass, combined in TextFormatOptions.stages
+#define TEXT_FORMAT_TRIM_TRAILING 0x1u      // Removes spaces and tabs before each line break and at the end
+#define TEXT_FORMAT_EXPAND_TABS 0x2u        // Replaces each tab with spaces up to the next tab stop
+#define TEXT_FORMAT_FINAL_NEWLINE 0x4u      // Ends text that is not empty with a line break
+#define TEXT_FORMAT_ALL_STAGES 0x7u
+
+// Widest tab stop distance, in columns
+#define TEXT_FORMAT_MAX_TAB_WIDTH 64
+
+// Edits a save records at most before it leaves the document as it is
+#define TEXT_FORMAT_SAVE_MAX_EDITS (1u << 20)
+
+// What a formatter changes
+typedef struct {
+    unsigned stages;            // TEXT_FORMAT_ stages, or 0 to pass the text through unchanged
+    unsigned tabWidth;          // Columns between tab stops, 1 to TEXT_FORMAT_MAX_TAB_WIDTH
+    size_t maxEdits;            // Edits recorded at most, or 0 for no limit
+} TextFormatOptions;
+
+/**
+ * @brief Callback receiving the formatted text.
+ *
+ * @param data The bytes; valid only during the call.
+ * @param length Number of bytes.
+ * @param context The context pointer given to TextFormatterInit.
+ * @return true to continue, false to fail the pass.
+ */
+typedef bool (*TextFormatSink)(const char* data, size_t length, void* context);
+
+// A format pass in progress
+typedef struct {
+    TextFormatOptions options;
+    TextFormatSink sink;        // Receiver of the formatted text, or NULL to only record edits
+    void* context;
+    bool recording;             // Edits are recorded
+    bool editsLost;             // An edit could not be recorded: too many of them, or out of memory
+    bool failed;                // The sink failed
+    DocumentEdit* edits;
+    size_t editCount;
+    size_t editCapacity;
+    uint64_t inputLength;       // Bytes formatted so far
+    uint64_t outputLength;      // Bytes passed to the sink so far
+    uint64_t column;            // Column reached by the output of the current line
+    char* held;                 // Spaces and tabs ending the input so far, maybe with a carriage return;
+                                // written or dropped once the next byte tells whether they end a line
+    size_t heldLength;
+    size_t heldCapacity;
+    char lastByte;              // Last byte passed to the sink, or 0 before the first
+    char lastInputByte;         // Last byte of the text so far, or 0 before the first
+    bool crlf;                  // The last line break seen was a CR LF pair
+} TextFormatter;
+
+/**
+ * @brief Starts a format pass.
+ *
+ * @param formatter The formatter.
+ * @param options The stages; copied.
+ * @param sink Receiver of the formatted text, or NULL.
+ * @param context Pointer passed to the sink.
+ * @param recordEdits true to record the changes as document edits.
+ */
+void TextFormatterInit(TextFormatter* formatter, const TextFormatOptions* options, TextFormatSink sink, void* context,
+                       bool recordEdits);
+
+/**
+ * @brief Formats the next span of the text.
+ *
+ * Whitespace at the end of the span may be held back until the next span
+ * or the end of the text shows whether it ends a line.
+ *
+ * @param formatter The formatter.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if successful, false once the sink has failed.
+ */
+bool TextFormatterWrite(TextFormatter* formatter, const char* data, size_t length);
+
+/**
+ * @brief Ends the text: drops its trailing whitespace and adds the final line break.
+ *
+ * The final line break is a CR LF pair when the last line break of the
+ * text was one.
+ *
+ * @param formatter The formatter.
+ * @return true if successful, false if the sink failed.
+ */
+bool TextFormatterFinish(TextFormatter* formatter);
+
+/**
+ * @brief Gets the changes made by a finished pass.
+ *
+ * The edits are sorted, in the coordinates of the input, and insert only
+ * static text, so they stay valid until the formatter is freed.
+ *
+ * @param formatter The formatter.
+ * @param[out] edits Receives the edits.
+ * @param[out] editCount Receives the number of edits.
+ * @return true if every change was recorded, false otherwise.
+ */
+bool TextFormatterGetEdits(const TextFormatter* formatter, const DocumentEdit** edits, size_t* editCount);
+
+/**
+ * @brief Releases the memory held by a formatter.
+ *
+ * @param formatter The formatter.
+ */
+void TextFormatterFree(TextFormatter* formatter);
+
+/**
+ * @brief Formats a document in place as one undoable edit.
+ *
+ * Only the changed bytes are edited, so the rest of the document keeps
+ * sharing the pieces of its file.
+ *
+ * @param document The document.
+ * @param options The stages.
+ * @param[out] changeCount Receives the number of edits applied; may be NULL.
+ * @return true if successful, false on allocation failure.
+ */
+bool TextFormatDocument(Document* document, const TextFormatOptions* options, size_t* changeCount);
+
+#endif /* TEXTFORMAT_H */
@@ -0,0 +1,156 @@
+/**
+ * @file thread.h
+ * @brief Worker threads and locks for the Professional Text Editor
+ *
+ * Contains a thin portable layer over Win32 threads, critical sections and
+ * condition variables, with a POSIX threads implementation for other
+ * platforms, so that the document core can use worker threads without
+ * depending on Win32.
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Storage class of variables with one instance per thread
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct Thread Thread;
+typedef struct ThreadLock ThreadLock;
+typedef struct ThreadCondition ThreadCondition;
+
+/**
+ * @brief Function run by a thread.
+ *
+ * @param context The context pointer given to ThreadStart.
+ */
+typedef void (*ThreadProc)(void* context);
+
+/**
+ * @brief Starts a thread.
+ *
+ * @param proc The function to run.
+ * @param context Pointer passed to the function.
+ * @return The thread, or NULL on failure. Release it with ThreadJoin.
+ */
+Thread* ThreadStart(ThreadProc proc, void* context);
+
+/**
+ * @brief Waits for a thread to finish and releases it.
+ *
+ * @param thread The thread. NULL is ignored.
+ */
+void ThreadJoin(Thread* thread);
+
+/**
+ * @brief Gets the number of processors available to the process.
+ *
+ * @return The processor count, at least 1.
+ */
+unsigned ThreadProcessorCount(void);
+
+/**
+ * @brief Creates a lock.
+ *
+ * @return The lock, or NULL on allocation failure.
+ */
+ThreadLock* ThreadLockCreate(void);
+
+/**
+ * @brief Destroys a lock.
+ *
+ * @param lock The lock. NULL is ignored.
+ */
+void ThreadLockDestroy(ThreadLock* lock);
+
+/**
+ * @brief Acquires a lock, waiting for other threads to release it.
+ *
+ * @param lock The lock.
+ */
+void ThreadLockEnter(ThreadLock* lock);
+
+/**
+ * @brief Releases a lock.
+ *
+ * @param lock The lock.
+ */
+void ThreadLockLeave(ThreadLock* lock);
+
+/**
+ * @brief Creates a condition variable.
+ *
+ * @return The condition variable, or NULL on allocation failure.
+ */
+ThreadCondition* ThreadConditionCreate(void);
+
+/**
+ * @brief Destroys a condition variable.
+ *
+ * @param condition The condition variable. NULL is ignored.
+ */
+void ThreadConditionDestroy(ThreadCondition* condition);
+
+/**
+ * @brief Releases a lock and waits until the condition variable is woken.
+ *
+ * The lock is held again on return. Wake-ups may be spurious, so callers
+ * check their condition in a loop.
+ *
+ * @param condition The condition variable.
+ * @param lock The lock, held by the caller.
+ */
+void ThreadConditionWait(ThreadCondition* condition, ThreadLock* lock);
+
+/**
+ * @brief Wakes every thread waiting on a condition variable.
+ *
+ * @param condition The condition variable.
+ */
+void ThreadConditionWakeAll(ThreadCondition* condition);
+
+/**
+ * @brief Atomically adds one to a reference count.
+ *
+ * @param value The count.
+ * @return The new value.
+ */
+long ThreadAtomicIncrement(volatile long* value);
+
+/**
+ * @brief Atomically subtracts one from a reference count.
+ *
+ * Writes made by other threads before their decrement are visible to the
+ * thread that sees the count reach zero, so it may free what was counted.
+ *
+ * @param value The count.
+ * @return The new value.
+ */
+long ThreadAtomicDecrement(volatile long* value);
+
+/**
+ * @brief Atomically adds to a 64-bit counter.
+ *
+ * @param value The counter.
+ * @param delta The amount to add, which may be negative.
+ * @return The new value.
+ */
+int64_t ThreadAtomicAdd64(volatile int64_t* value, int64_t delta);
+
+/**
+ * @brief Atomically replaces a 64-bit value if it holds an expected value.
+ *
+ * @param value The value.
+ * @param expected The value it must hold.
+ * @param desired The value to store.
+ * @return true if the value was replaced, false if it held something else.
+ */
+bool ThreadAtomicCompareExchange64(volatile int64_t* value, int64_t expected, int64_t desired);
+
+#endif /* THREAD_H */
@@ -0,0 +1,118 @@
+/**
+ * @file timeindex.h
+ * @brief Timestamp index for the Professional Text Editor
+ *
+ * Contains the sparse index used to jump to a time in a time-ordered log.
+ * The timestamp format is detected from lines sampled across the document,
+ * and the time of the first stamped line of every megabyte is kept with its
+ * offset, 16 bytes per megabyte. A jump searches those pairs for the
+ * megabyte holding the time and then bisects its lines, reading about
+ * twenty of them, so it costs the same in a 10 GB file as in a small one.
+ *
+ * Times are microseconds since 1970-01-01 as written in the log: a zone
+ * after the time is not applied, and syslog stamps, which have no year,
+ * are placed in the year 2000.
+ */
+
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include "document.h"
+
+// Microseconds in one second
+#define TIME_INDEX_SECOND INT64_C(1000000)
+
+// Timestamp layouts recognized in log lines
+typedef enum {
+    TIME_FORMAT_ISO,            // 2026-10-15 08:53:20.123, also with 'T' or '/' separators
+    TIME_FORMAT_COMMON_LOG,     // 15/Oct/2026:08:53:20 of web server access logs
+    TIME_FORMAT_SYSLOG,         // Oct 15 08:53:20
+    TIME_FORMAT_EPOCH,          // 1760518400, 1760518400.123 or 1760518400123 (milliseconds)
+    TIME_FORMAT_COUNT
+} TimeFormat;
+
+typedef struct TimeIndex TimeIndex;
+
+/**
+ * @brief Detects the timestamps of a document and indexes them.
+ *
+ * The index registers itself as a document listener. Entries touched by an
+ * edit are dropped and the others move with the text, so jumps stay exact
+ * after edits and only search longer where entries were dropped.
+ *
+ * @param document The document; it must outlive the index.
+ * @return The index, or NULL if too few sampled lines carry a known timestamp or memory ran out.
+ */
+TimeIndex* TimeIndexCreate(Document* document);
+
+/**
+ * @brief Destroys a timestamp index and unregisters it from its document.
+ *
+ * @param index The index. NULL is ignored.
+ */
+void TimeIndexDestroy(TimeIndex* index);
+
+/**
+ * @brief Gets the timestamp format detected in the document.
+ *
+ * @param index The index.
+ * @return The format.
+ */
+TimeFormat TimeIndexFormat(const TimeIndex* index);
+
+/**
+ * @brief Gets the number of (time, offset) entries of the index.
+ *
+ * @param index The index.
+ * @return The number of entries.
+ */
+size_t TimeIndexEntryCount(const TimeIndex* index);
+
+/**
+ * @brief Gets the time of a line.
+ *
+ * Lines without a timestamp, such as the lines of a stack trace, take the
+ * time of the closest stamped line above them; lines above the first
+ * timestamp take the first one.
+ *
+ * @param index The index.
+ * @param line The line.
+ * @param[out] time Receives the time.
+ * @return true if a stamped line was found near the line, false otherwise.
+ */
+bool TimeIndexLineTime(const TimeIndex* index, uint64_t line, int64_t* time);
+
+/**
+ * @brief Parses a time typed by the user.
+ *
+ * Accepts a timestamp in any of the known formats, a date ("2026-10-15"),
+ * or a time of day ("14:32", "14:32:07.250") on the day of the reference.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param reference Time whose day completes a time of day, such as the time of the caret line.
+ * @param[out] time Receives the time.
+ * @return true if the text is a time, false otherwise.
+ */
+bool TimeIndexParseTime(const char* text, size_t length, int64_t reference, int64_t* time);
+
+/**
+ * @brief Finds the first line stamped at or after a time.
+ *
+ * @param index The index.
+ * @param time The time.
+ * @return The line, or the last line if every timestamp is earlier.
+ */
+uint64_t TimeIndexFindLine(const TimeIndex* index, int64_t time);
+
+/**
+ * @brief Formats a time as "2026-10-15 08:53:20", with a fraction if it has one.
+ *
+ * @param time The time.
+ * @param buffer Receives the NUL-terminated text.
+ * @param capacity Size of the buffer.
+ * @return Length of the text, or 0 if the buffer is too small.
+ */
+size_t TimeIndexFormatTime(int64_t time, char* buffer, size_t capacity);
+
+#endif /* TIMEINDEX_H */
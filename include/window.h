@@ -28,6 +28,16 @@ ATOM RegisterMainWindow(HINSTANCE hInstance);
  */
 BOOL CreateMainWindow(HINSTANCE hInstance, int nCmdShow);
 
+/**
+ * @brief Translates the keyboard shortcuts of the main window.
+ *
+ * Called by the message loop before a message is dispatched.
+ *
+ * @param msg The message taken from the queue.
+ * @return TRUE if the message was a shortcut and has been handled, FALSE otherwise.
+ */
+BOOL TranslateEditorAccelerator(MSG* msg);
+
 /**
  * @brief Window procedure for the main application window.
  *
@@ -47,6 +57,38 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
  */
 void HandleWindowResize(HWND hWnd, LPARAM lParam);
 
+/**
+ * @brief Switches between the editor view and the hex view.
+ *
+ * @param show TRUE to show the hex view, FALSE to show the editor view.
+ */
+void ShowHexView(BOOL show);
+
+/**
+ * @brief Switches between the editor view and the table view of the document.
+ *
+ * Files named .tsv are split at tabs; the delimiter of other files is
+ * guessed from their first lines.
+ *
+ * @param show TRUE to show the table view, FALSE to show the editor view.
+ * @return TRUE if the requested view is shown, FALSE otherwise.
+ */
+BOOL ShowTableView(BOOL show);
+
+/**
+ * @brief Opens the JSON outline of the document, or activates it if it is open.
+ *
+ * @param hWnd Handle to the main window.
+ */
+void OpenJsonOutline(HWND hWnd);
+
+/**
+ * @brief Closes the JSON outline if it is open.
+ *
+ * Called before the document of the editor view is replaced.
+ */
+void CloseJsonOutline(void);
+
 /**
  * @brief Updates the status bar text with the current editor state.
  *
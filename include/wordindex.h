@@ -0,0 +1,88 @@
+/**
+ * @file wordindex.h
+ * @brief Identifier index for word completion in the Professional Text Editor
+ *
+ * Contains an index of the identifiers used in a document with the number
+ * of times each occurs. Identifiers are interned once and kept in
+ * case-insensitive order with a tree of maximum counts on top, so the most
+ * frequent completions of a prefix are found without visiting every
+ * identifier that starts with it. The index follows the document through
+ * its change listener and rescans only the blocks of lines an edit touches.
+ *
+ * An identifier is a run of ASCII letters, digits, underscores and bytes of
+ * multi-byte UTF-8 characters that does not start with a digit.
+ */
+
+#ifndef WORDINDEX_H
+#define WORDINDEX_H
+
+#include "document.h"
+
+// Longest identifier that is indexed
+#define WORD_INDEX_MAX_LENGTH 64
+
+// One completion of a prefix
+typedef struct {
+    const char* text;       // Not null-terminated; valid until the document changes
+    size_t length;
+    uint32_t count;         // Occurrences in the document
+} WordCompletion;
+
+typedef struct WordIndex WordIndex;
+
+/**
+ * @brief Creates the identifier index of a document.
+ *
+ * The index registers itself as a document listener. It is built by
+ * WordIndexBuild, or the first time it is queried.
+ *
+ * @param document The document; it must outlive the index.
+ * @return The index, or NULL on allocation failure.
+ */
+WordIndex* WordIndexCreate(Document* document);
+
+/**
+ * @brief Destroys an identifier index and unregisters it from its document.
+ *
+ * @param index The index. NULL is ignored.
+ */
+void WordIndexDestroy(WordIndex* index);
+
+/**
+ * @brief Builds the index from the whole document.
+ *
+ * While the document still holds the unmodified file it was opened from,
+ * the file is split at line breaks and the parts are scanned in parallel.
+ *
+ * @param index The index.
+ * @param threadCount Maximum number of threads, or 0 for one per processor.
+ * @return true if successful, false on allocation failure.
+ */
+bool WordIndexBuild(WordIndex* index, unsigned threadCount);
+
+/**
+ * @brief Finds the most frequent identifiers starting with a prefix.
+ *
+ * The prefix is compared ignoring ASCII case. The identifier equal to the
+ * prefix itself is not offered. Results are sorted by count, most frequent
+ * first, and then alphabetically.
+ *
+ * @param index The index.
+ * @param prefix The prefix.
+ * @param prefixLength Length of the prefix.
+ * @param[out] results Receives the completions.
+ * @param maxResults Capacity of results.
+ * @return Number of completions written to results.
+ */
+size_t WordIndexComplete(WordIndex* index, const char* prefix, size_t prefixLength, WordCompletion* results,
+                         size_t maxResults);
+
+/**
+ * @brief Checks whether a byte can be part of an identifier.
+ *
+ * @param c The byte.
+ * @return true for ASCII letters, digits, underscores and bytes >= 0x80, false otherwise.
+ */
+bool WordIndexIsWordByte(char c);
+
+#endif /* WORDINDEX_H */
@@ -0,0 +1,894 @@
+/**
+ * @file boundary.c
+ * @brief Grapheme, word and line break boundary implementation for the Professional Text Editor
+ *
+ * Documents are read through a window of a kilobyte or so placed around
+ * the offsets being examined, so every query costs one piece table lookup
+ * per window whatever the length of the line. Code points are decoded from
+ * the window and looked up in the property tables; inside a run of ASCII
+ * the class of eight bytes is computed at once.
+ */
+
+#include "../include/boundary.h"
+#include "../include/bitscan.h"
+
+// Bytes of a document read into the window at a time
+#define BOUNDARY_WINDOW 1024
+
+// Bytes kept on the far side of an offset when the window moves
+#define BOUNDARY_OVERLAP 16
+
+// Code points examined backwards to pair flags and find the emoji before a ZWJ
+#define BOUNDARY_LOOKBEHIND 64
+
+// Code points per block of the property tables
+#define BOUNDARY_BLOCK_SHIFT 7
+#define BOUNDARY_BLOCK_MASK ((1u << BOUNDARY_BLOCK_SHIFT) - 1)
+
+// Fields of a property byte
+#define BOUNDARY_GRAPHEME_MASK 0x0F
+#define BOUNDARY_CLASS_SHIFT 4
+#define BOUNDARY_CLASS_MASK 0x03
+#define BOUNDARY_LINE_SHIFT 6
+
+// Grapheme cluster break properties, numbered as in tools/boundarytables.pl
+enum {
+    BOUNDARY_GRAPHEME_OTHER,
+    BOUNDARY_GRAPHEME_CR,
+    BOUNDARY_GRAPHEME_LF,
+    BOUNDARY_GRAPHEME_CONTROL,
+    BOUNDARY_GRAPHEME_EXTEND,
+    BOUNDARY_GRAPHEME_ZWJ,
+    BOUNDARY_GRAPHEME_REGIONAL,
+    BOUNDARY_GRAPHEME_PREPEND,
+    BOUNDARY_GRAPHEME_SPACING_MARK,
+    BOUNDARY_GRAPHEME_L,
+    BOUNDARY_GRAPHEME_V,
+    BOUNDARY_GRAPHEME_T,
+    BOUNDARY_GRAPHEME_LV,
+    BOUNDARY_GRAPHEME_LVT,
+    BOUNDARY_GRAPHEME_PICTOGRAPHIC
+};
+
+// Line break classes, numbered as in tools/boundarytables.pl
+enum {
+    BOUNDARY_LINE_OTHER,
+    BOUNDARY_LINE_CLOSE,        // No break before: closing brackets, '!', ',', small kana
+    BOUNDARY_LINE_OPEN,         // No break after: opening brackets
+    BOUNDARY_LINE_HYPHEN        // Break after when a word follows
+};
+
+// Tables generated into boundarytables.c
+extern const uint8_t g_boundaryBlocks[];
+extern const uint8_t g_boundaryProperties[];
+
+// Text being segmented, read through a window
+typedef struct {
+    const Document* document;       // Document read into the buffer, or NULL for a text
+    uint64_t length;
+    const unsigned char* window;    // Bytes starting at windowStart
+    uint64_t windowStart;
+    size_t windowLength;
+    bool forward;                   // Direction of the scan, which decides where the window is placed
+    unsigned char buffer[BOUNDARY_WINDOW];
+} BoundaryReader;
+
+// A decoded code point
+typedef struct {
+    uint32_t codepoint;
+    uint8_t properties;
+    uint8_t length;                 // Bytes it occupies
+} BoundaryChar;
+
+/**
+ * @brief Prepares a reader over a document.
+ *
+ * @param reader The reader.
+ * @param document The document.
+ */
+static void ReaderInitDocument(BoundaryReader* reader, const Document* document) {
+    reader->document = document;
+    reader->length = DocumentLength(document);
+    reader->window = reader->buffer;
+    reader->windowStart = 0;
+    reader->windowLength = 0;
+    reader->forward = true;
+}
+
+/**
+ * @brief Prepares a reader over a text held in memory.
+ *
+ * @param reader The reader.
+ * @param text The text.
+ * @param length Length of the text.
+ */
+static void ReaderInitText(BoundaryReader* reader, const char* text, size_t length) {
+    reader->document = NULL;
+    reader->length = length;
+    reader->window = (const unsigned char*)text;
+    reader->windowStart = 0;
+    reader->windowLength = length;
+    reader->forward = true;
+}
+
+/**
+ * @brief Reads the part of the document around an offset into the window.
+ *
+ * Moving forwards the window starts just before the offset; moving
+ * backwards it ends just after it.
+ *
+ * @param reader The reader; over a document.
+ * @param offset The offset; less than the length.
+ */
+static void ReaderLoad(BoundaryReader* reader, uint64_t offset) {
+    uint64_t start;
+    if (reader->forward) {
+        start = offset > BOUNDARY_OVERLAP ? offset - BOUNDARY_OVERLAP : 0;
+    } else {
+        uint64_t end = offset + BOUNDARY_OVERLAP < reader->length ? offset + BOUNDARY_OVERLAP : reader->length;
+        start = end > BOUNDARY_WINDOW ? end - BOUNDARY_WINDOW : 0;
+    }
+    uint64_t available = reader->length - start;
+    size_t wanted = available < BOUNDARY_WINDOW ? (size_t)available : BOUNDARY_WINDOW;
+    reader->windowStart = start;
+    reader->windowLength = DocumentRead(reader->document, start, (char*)reader->buffer, wanted);
+}
+
+/**
+ * @brief Gets the byte at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset; less than the length.
+ * @return The byte.
+ */
+static unsigned char ReaderByte(BoundaryReader* reader, uint64_t offset) {
+    if (offset - reader->windowStart >= reader->windowLength) {
+        ReaderLoad(reader, offset);
+        if (offset - reader->windowStart >= reader->windowLength) {
+            return 0;
+        }
+    }
+    return reader->window[offset - reader->windowStart];
+}
+
+/**
+ * @brief Gets the window bytes from an offset if at least eight are loaded.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @return The bytes, or NULL if fewer than eight follow the offset in the window.
+ */
+static const unsigned char* ReaderSpan(const BoundaryReader* reader, uint64_t offset) {
+    uint64_t position = offset - reader->windowStart;
+    if (offset < reader->windowStart || position + 8 > reader->windowLength) {
+        return NULL;
+    }
+    return reader->window + position;
+}
+
+/**
+ * @brief Looks up the property byte of a code point.
+ *
+ * @param codepoint The code point; at most U+10FFFF.
+ * @return The property byte.
+ */
+static uint8_t LookupProperties(uint32_t codepoint) {
+    uint32_t block = g_boundaryBlocks[codepoint >> BOUNDARY_BLOCK_SHIFT];
+    return g_boundaryProperties[(block << BOUNDARY_BLOCK_SHIFT) | (codepoint & BOUNDARY_BLOCK_MASK)];
+}
+
+/**
+ * @brief Gets the grapheme cluster break property from a property byte.
+ *
+ * @param properties The property byte.
+ * @return The BOUNDARY_GRAPHEME_* value.
+ */
+static unsigned GraphemeOf(uint8_t properties) {
+    return properties & BOUNDARY_GRAPHEME_MASK;
+}
+
+/**
+ * @brief Gets the word class from a property byte.
+ *
+ * @param properties The property byte.
+ * @return The class.
+ */
+static BoundaryClass ClassOf(uint8_t properties) {
+    return (BoundaryClass)((properties >> BOUNDARY_CLASS_SHIFT) & BOUNDARY_CLASS_MASK);
+}
+
+/**
+ * @brief Checks whether a character belongs to the character before it.
+ *
+ * Combining marks and joiners take the word class of their base.
+ *
+ * @param properties The property byte.
+ * @return true for extending characters.
+ */
+static bool IsExtending(uint8_t properties) {
+    unsigned grapheme = GraphemeOf(properties);
+    return grapheme == BOUNDARY_GRAPHEME_EXTEND || grapheme == BOUNDARY_GRAPHEME_ZWJ ||
+           grapheme == BOUNDARY_GRAPHEME_SPACING_MARK;
+}
+
+/**
+ * @brief Decodes the code point starting at an offset.
+ *
+ * A byte that does not start a valid UTF-8 sequence is one character of
+ * its own, decoded as U+FFFD.
+ *
+ * @param reader The reader.
+ * @param offset The offset; less than the length.
+ * @return The character.
+ */
+static BoundaryChar DecodeAt(BoundaryReader* reader, uint64_t offset) {
+    BoundaryChar result = { 0xFFFD, 0, 1 };
+    unsigned char lead = ReaderByte(reader, offset);
+    unsigned count;
+    uint32_t value;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (lead < 0x80) {
+        result.codepoint = lead;
+        result.properties = LookupProperties(lead);
+        return result;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        count = 1;
+        value = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        count = 2;
+        value = lead & 0x0F;
+        low = lead == 0xE0 ? 0xA0 : 0x80;
+        high = lead == 0xED ? 0x9F : 0xBF;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        count = 3;
+        value = lead & 0x07;
+        low = lead == 0xF0 ? 0x90 : 0x80;
+        high = lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        result.properties = LookupProperties(result.codepoint);
+        return result;
+    }
+
+    for (unsigned i = 1; i <= count; i++) {
+        unsigned char c = offset + i < reader->length ? ReaderByte(reader, offset + i) : 0;
+        if (c < low || c > high) {
+            result.properties = LookupProperties(result.codepoint);
+            return result;
+        }
+        value = (value << 6) | (c & 0x3F);
+        low = 0x80;
+        high = 0xBF;
+    }
+    result.codepoint = value;
+    result.properties = LookupProperties(value);
+    result.length = (uint8_t)(count + 1);
+    return result;
+}
+
+/**
+ * @brief Finds the start of the code point ending at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset; greater than 0.
+ * @return The start of the code point, or offset - 1 if the bytes before are not a valid sequence.
+ */
+static uint64_t PreviousCodePoint(BoundaryReader* reader, uint64_t offset) {
+    uint64_t start = offset - 1;
+    for (int i = 0; i < 3 && start > 0 && (ReaderByte(reader, start) & 0xC0) == 0x80; i++) {
+        start--;
+    }
+    if (start + 1 < offset && start + DecodeAt(reader, start).length == offset) {
+        return start;
+    }
+    return offset - 1;
+}
+
+/**
+ * @brief Decides whether two characters belong to the same grapheme cluster.
+ *
+ * @param before Grapheme break property of the first character.
+ * @param after Grapheme break property of the second character.
+ * @param regionalRun Regional indicators ending with the first character.
+ * @param pictographicZwj true if the first character is a ZWJ following an emoji and its modifiers.
+ * @return true if no boundary separates them.
+ */
+static bool GraphemeJoins(unsigned before, unsigned after, unsigned regionalRun, bool pictographicZwj) {
+    if (before == BOUNDARY_GRAPHEME_CR && after == BOUNDARY_GRAPHEME_LF) {
+        return true;
+    }
+    if (before == BOUNDARY_GRAPHEME_CR || before == BOUNDARY_GRAPHEME_LF || before == BOUNDARY_GRAPHEME_CONTROL ||
+        after == BOUNDARY_GRAPHEME_CR || after == BOUNDARY_GRAPHEME_LF || after == BOUNDARY_GRAPHEME_CONTROL) {
+        return false;
+    }
+
+    // Hangul syllables
+    if (before == BOUNDARY_GRAPHEME_L) {
+        return after == BOUNDARY_GRAPHEME_L || after == BOUNDARY_GRAPHEME_V || after == BOUNDARY_GRAPHEME_LV ||
+               after == BOUNDARY_GRAPHEME_LVT || after == BOUNDARY_GRAPHEME_EXTEND ||
+               after == BOUNDARY_GRAPHEME_ZWJ || after == BOUNDARY_GRAPHEME_SPACING_MARK;
+    }
+    if ((before == BOUNDARY_GRAPHEME_LV || before == BOUNDARY_GRAPHEME_V) &&
+        (after == BOUNDARY_GRAPHEME_V || after == BOUNDARY_GRAPHEME_T)) {
+        return true;
+    }
+    if ((before == BOUNDARY_GRAPHEME_LVT || before == BOUNDARY_GRAPHEME_T) && after == BOUNDARY_GRAPHEME_T) {
+        return true;
+    }
+
+    if (after == BOUNDARY_GRAPHEME_EXTEND || after == BOUNDARY_GRAPHEME_ZWJ ||
+        after == BOUNDARY_GRAPHEME_SPACING_MARK || before == BOUNDARY_GRAPHEME_PREPEND) {
+        return true;
+    }
+    if (pictographicZwj && after == BOUNDARY_GRAPHEME_PICTOGRAPHIC) {
+        return true;
+    }
+
+    // Flags are pairs of regional indicators
+    return before == BOUNDARY_GRAPHEME_REGIONAL && after == BOUNDARY_GRAPHEME_REGIONAL && regionalRun % 2 == 1;
+}
+
+/**
+ * @brief Finds the end of the grapheme cluster starting at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @return The end of the cluster.
+ */
+static uint64_t NextGrapheme(BoundaryReader* reader, uint64_t offset) {
+    if (offset >= reader->length) {
+        return reader->length;
+    }
+    reader->forward = true;
+    BoundaryChar c = DecodeAt(reader, offset);
+    unsigned before = GraphemeOf(c.properties);
+    unsigned regionalRun = before == BOUNDARY_GRAPHEME_REGIONAL ? 1 : 0;
+    bool pictographic = before == BOUNDARY_GRAPHEME_PICTOGRAPHIC;
+    bool pictographicZwj = false;
+    offset += c.length;
+
+    while (offset < reader->length) {
+        c = DecodeAt(reader, offset);
+        unsigned after = GraphemeOf(c.properties);
+        if (!GraphemeJoins(before, after, regionalRun, pictographicZwj)) {
+            break;
+        }
+
+        // Track an emoji followed by its modifiers and then a ZWJ
+        regionalRun = after == BOUNDARY_GRAPHEME_REGIONAL ? regionalRun + 1 : 0;
+        pictographicZwj = after == BOUNDARY_GRAPHEME_ZWJ && pictographic;
+        if (after != BOUNDARY_GRAPHEME_EXTEND) {
+            pictographic = after == BOUNDARY_GRAPHEME_PICTOGRAPHIC;
+        }
+        before = after;
+        offset += c.length;
+    }
+    return offset;
+}
+
+/**
+ * @brief Counts the regional indicators ending at an offset.
+ *
+ * @param reader The reader.
+ * @param offset End of the run.
+ * @return The number found, up to BOUNDARY_LOOKBEHIND.
+ */
+static unsigned RegionalRunBefore(BoundaryReader* reader, uint64_t offset) {
+    unsigned count = 0;
+    while (offset > 0 && count < BOUNDARY_LOOKBEHIND) {
+        uint64_t start = PreviousCodePoint(reader, offset);
+        if (GraphemeOf(DecodeAt(reader, start).properties) != BOUNDARY_GRAPHEME_REGIONAL) {
+            break;
+        }
+        count++;
+        offset = start;
+    }
+    return count;
+}
+
+/**
+ * @brief Checks whether an emoji and its modifiers end at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset, just before a ZWJ.
+ * @return true if an extended pictographic character precedes, with only modifiers between.
+ */
+static bool PictographicBefore(BoundaryReader* reader, uint64_t offset) {
+    for (unsigned i = 0; offset > 0 && i < BOUNDARY_LOOKBEHIND; i++) {
+        offset = PreviousCodePoint(reader, offset);
+        unsigned grapheme = GraphemeOf(DecodeAt(reader, offset).properties);
+        if (grapheme == BOUNDARY_GRAPHEME_PICTOGRAPHIC) {
+            return true;
+        }
+        if (grapheme != BOUNDARY_GRAPHEME_EXTEND) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finds the start of the grapheme cluster ending at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @return The start of the cluster.
+ */
+static uint64_t PreviousGrapheme(BoundaryReader* reader, uint64_t offset) {
+    if (offset == 0) {
+        return 0;
+    }
+    reader->forward = false;
+    uint64_t start = PreviousCodePoint(reader, offset);
+    unsigned after = GraphemeOf(DecodeAt(reader, start).properties);
+    while (start > 0) {
+        uint64_t previous = PreviousCodePoint(reader, start);
+        unsigned before = GraphemeOf(DecodeAt(reader, previous).properties);
+        unsigned regionalRun = 0;
+        bool pictographicZwj = false;
+        if (before == BOUNDARY_GRAPHEME_REGIONAL && after == BOUNDARY_GRAPHEME_REGIONAL) {
+            regionalRun = 1 + RegionalRunBefore(reader, previous);
+        } else if (before == BOUNDARY_GRAPHEME_ZWJ && after == BOUNDARY_GRAPHEME_PICTOGRAPHIC) {
+            pictographicZwj = PictographicBefore(reader, previous);
+        }
+        if (!GraphemeJoins(before, after, regionalRun, pictographicZwj)) {
+            break;
+        }
+        start = previous;
+        after = before;
+    }
+    return start;
+}
+
+/**
+ * @brief Marks the ASCII bytes of a word within a range.
+ *
+ * @param bytes Eight bytes with their high bits cleared.
+ * @param low Lowest byte of the range.
+ * @param high Highest byte of the range.
+ * @return The high bit of every byte in the range set.
+ */
+static uint64_t MarkRange(uint64_t bytes, unsigned char low, unsigned char high) {
+    uint64_t top = BITSCAN_REPEAT(0x80);
+    uint64_t atLeast = (bytes | top) - BITSCAN_REPEAT(low);
+    uint64_t atMost = (BITSCAN_REPEAT(high) | top) - bytes;
+    return atLeast & atMost & top;
+}
+
+/**
+ * @brief Marks the bytes of a word that are ASCII characters of a class.
+ *
+ * @param word Eight bytes.
+ * @param cls The class.
+ * @return Bit i set when byte i is an ASCII character of the class.
+ */
+static uint64_t MarkAsciiClass(uint64_t word, BoundaryClass cls) {
+    uint64_t top = BITSCAN_REPEAT(0x80);
+    uint64_t bytes = word & ~top;
+    uint64_t ascii = ~word & top;
+    uint64_t words = MarkRange(bytes | BITSCAN_REPEAT(0x20), 'a', 'z') | MarkRange(bytes, '0', '9') |
+                     MarkRange(bytes, '_', '_');
+    uint64_t spaces = MarkRange(bytes, '\t', '\r') | MarkRange(bytes, ' ', ' ');
+    uint64_t marks;
+    switch (cls) {
+        case BOUNDARY_CLASS_SPACE:
+            marks = spaces;
+            break;
+        case BOUNDARY_CLASS_WORD:
+            marks = words;
+            break;
+        case BOUNDARY_CLASS_PUNCTUATION:
+            marks = ~(words | spaces) & top;
+            break;
+        default:
+            marks = 0;
+            break;
+    }
+    return (((marks & ascii) >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/**
+ * @brief Checks whether a character joins the two word characters around it.
+ *
+ * @param before The word character before, or 0 if none.
+ * @param middle The character between.
+ * @param after The character after.
+ * @return true for an apostrophe between letters or '.' or ',' between ASCII digits.
+ */
+static bool JoinsWord(uint32_t before, uint32_t middle, const BoundaryChar* after) {
+    if (before == 0 || ClassOf(after->properties) != BOUNDARY_CLASS_WORD) {
+        return false;
+    }
+    if (middle == '\'' || middle == 0x2019) {
+        return !(before >= '0' && before <= '9') && !(after->codepoint >= '0' && after->codepoint <= '9');
+    }
+    return (middle == '.' || middle == ',') && before >= '0' && before <= '9' && after->codepoint >= '0' &&
+           after->codepoint <= '9';
+}
+
+/**
+ * @brief Finds the end of the run of a class starting at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @param cls The class of the run.
+ * @param previous The word character before the offset if the run continues one, or 0.
+ * @return The end of the run; the offset itself if no character of the class starts there.
+ */
+static uint64_t SkipForward(BoundaryReader* reader, uint64_t offset, BoundaryClass cls, uint32_t previous) {
+    reader->forward = true;
+    while (offset < reader->length) {
+        const unsigned char* span = ReaderSpan(reader, offset);
+        if (span) {
+            uint64_t mask = MarkAsciiClass(BitScanLoadWord(span), cls);
+            if (mask == 0xFF) {
+                offset += 8;
+                previous = span[7];
+                continue;
+            }
+            unsigned run = BitScanLowest(~mask & 0xFF);
+            if (run > 0) {
+                offset += run;
+                previous = span[run - 1];
+            }
+        }
+
+        BoundaryChar c = DecodeAt(reader, offset);
+        if (ClassOf(c.properties) == cls) {
+            previous = c.codepoint;
+        } else if (!IsExtending(c.properties)) {
+            if (cls != BOUNDARY_CLASS_WORD || offset + c.length >= reader->length) {
+                break;
+            }
+            BoundaryChar after = DecodeAt(reader, offset + c.length);
+            if (!JoinsWord(previous, c.codepoint, &after)) {
+                break;
+            }
+        }
+        offset += c.length;
+    }
+    return offset;
+}
+
+/**
+ * @brief Finds the start of the run of a class ending at an offset.
+ *
+ * Combining marks are part of the run only if their base character is.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @param cls The class of the run.
+ * @param next The word character at the offset if the run continues into it, or 0.
+ * @return The start of the run; the offset itself if no character of the class ends there.
+ */
+static uint64_t SkipBackward(BoundaryReader* reader, uint64_t offset, BoundaryClass cls, uint32_t next) {
+    reader->forward = false;
+    uint64_t start = offset;
+    while (offset > 0) {
+        const unsigned char* span = offset == start && offset >= 8 ? ReaderSpan(reader, offset - 8) : NULL;
+        if (span) {
+            uint64_t mask = MarkAsciiClass(BitScanLoadWord(span), cls);
+            unsigned run = 0;
+            while (run < 8 && (mask >> (7 - run)) & 1) {
+                run++;
+            }
+            offset -= run;
+            start = offset;
+            if (run == 8) {
+                next = span[0];
+                continue;
+            }
+            if (run > 0) {
+                next = span[8 - run];
+            }
+            if (offset == 0) {
+                break;
+            }
+        }
+
+        uint64_t position = PreviousCodePoint(reader, offset);
+        BoundaryChar c = DecodeAt(reader, position);
+        if (IsExtending(c.properties)) {
+            offset = position;
+            continue;
+        }
+        if (ClassOf(c.properties) == cls) {
+            offset = position;
+            start = position;
+            next = c.codepoint;
+            continue;
+        }
+
+        // An apostrophe or decimal point inside the word, with no marks pending
+        if (cls != BOUNDARY_CLASS_WORD || offset != start || next == 0 || position == 0) {
+            break;
+        }
+        BoundaryChar before = DecodeAt(reader, PreviousCodePoint(reader, position));
+        BoundaryChar after = { next, LookupProperties(next), 1 };
+        if (ClassOf(before.properties) != BOUNDARY_CLASS_WORD || !JoinsWord(before.codepoint, c.codepoint, &after)) {
+            break;
+        }
+        offset = position;
+        start = position;
+        next = 0;
+    }
+
+    // Marks at the start of the text have no base and join the run
+    return offset == 0 ? 0 : start;
+}
+
+/**
+ * @brief Finds the base character of the characters ending at an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset; greater than 0.
+ * @return The nearest character before the offset that is not a combining mark.
+ */
+static BoundaryChar BaseBefore(BoundaryReader* reader, uint64_t offset) {
+    reader->forward = false;
+    BoundaryChar c;
+    do {
+        offset = PreviousCodePoint(reader, offset);
+        c = DecodeAt(reader, offset);
+    } while (offset > 0 && IsExtending(c.properties));
+    return c;
+}
+
+/**
+ * @brief Finds the start of the next word.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @return The start of the next word.
+ */
+static uint64_t NextWord(BoundaryReader* reader, uint64_t offset) {
+    if (offset >= reader->length) {
+        return reader->length;
+    }
+    reader->forward = true;
+    BoundaryChar c = DecodeAt(reader, offset);
+    BoundaryClass cls = ClassOf(c.properties);
+    if (cls != BOUNDARY_CLASS_SPACE) {
+        offset = SkipForward(reader, offset, cls, 0);
+    }
+    return SkipForward(reader, offset, BOUNDARY_CLASS_SPACE, 0);
+}
+
+/**
+ * @brief Finds the start of the word before an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ * @return The start of the previous word.
+ */
+static uint64_t PreviousWord(BoundaryReader* reader, uint64_t offset) {
+    offset = SkipBackward(reader, offset, BOUNDARY_CLASS_SPACE, 0);
+    if (offset == 0) {
+        return 0;
+    }
+    BoundaryClass cls = ClassOf(BaseBefore(reader, offset).properties);
+    return SkipBackward(reader, offset, cls, 0);
+}
+
+/**
+ * @brief Gets the end of the grapheme cluster starting at an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The next grapheme boundary, or the document length at the end.
+ */
+uint64_t BoundaryNextGrapheme(const Document* document, uint64_t offset) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    return NextGrapheme(&reader, offset);
+}
+
+/**
+ * @brief Gets the start of the grapheme cluster ending at an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The previous grapheme boundary, or 0 at the start.
+ */
+uint64_t BoundaryPreviousGrapheme(const Document* document, uint64_t offset) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    return PreviousGrapheme(&reader, offset < reader.length ? offset : reader.length);
+}
+
+/**
+ * @brief Gets the start of the next word.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The start of the next word, or the document length.
+ */
+uint64_t BoundaryNextWord(const Document* document, uint64_t offset) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    return NextWord(&reader, offset);
+}
+
+/**
+ * @brief Gets the start of the word before an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The start of the previous word, or 0.
+ */
+uint64_t BoundaryPreviousWord(const Document* document, uint64_t offset) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    return PreviousWord(&reader, offset < reader.length ? offset : reader.length);
+}
+
+/**
+ * @brief Finds the word or ideograph run touching an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @param[out] start Receives the start of the word.
+ * @param[out] end Receives the end of the word.
+ * @return true if a word was found, false if the offset touches only space and punctuation.
+ */
+bool BoundaryWordAt(const Document* document, uint64_t offset, uint64_t* start, uint64_t* end) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    if (offset > reader.length) {
+        offset = reader.length;
+    }
+
+    BoundaryChar at = { 0, 0, 0 };
+    BoundaryChar before = { 0, 0, 0 };
+    if (offset < reader.length) {
+        at = DecodeAt(&reader, offset);
+    }
+    if (offset > 0) {
+        before = BaseBefore(&reader, offset);
+    }
+    BoundaryClass cls;
+    if (at.length > 0 && (ClassOf(at.properties) == BOUNDARY_CLASS_WORD ||
+                          ClassOf(at.properties) == BOUNDARY_CLASS_IDEOGRAPH)) {
+        cls = ClassOf(at.properties);
+    } else if (before.length > 0 && (ClassOf(before.properties) == BOUNDARY_CLASS_WORD ||
+                                     ClassOf(before.properties) == BOUNDARY_CLASS_IDEOGRAPH)) {
+        cls = ClassOf(before.properties);
+    } else {
+        return false;
+    }
+
+    bool continues = before.length > 0 && ClassOf(before.properties) == cls;
+    *start = SkipBackward(&reader, offset, cls, at.length > 0 && ClassOf(at.properties) == cls ? at.codepoint : 0);
+    *end = SkipForward(&reader, offset, cls, continues ? before.codepoint : 0);
+    return *start < *end;
+}
+
+/**
+ * @brief Decides whether a line may be broken between two grapheme clusters.
+ *
+ * @param before First character of the cluster before.
+ * @param after First character of the cluster after.
+ * @return true at a break opportunity.
+ */
+static bool LineBreaks(const BoundaryChar* before, const BoundaryChar* after) {
+    unsigned grapheme = GraphemeOf(before->properties);
+    if (grapheme == BOUNDARY_GRAPHEME_LF || grapheme == BOUNDARY_GRAPHEME_CR) {
+        return true;
+    }
+    BoundaryClass beforeClass = ClassOf(before->properties);
+    BoundaryClass afterClass = ClassOf(after->properties);
+    unsigned beforeLine = before->properties >> BOUNDARY_LINE_SHIFT;
+    unsigned afterLine = after->properties >> BOUNDARY_LINE_SHIFT;
+    if (afterClass == BOUNDARY_CLASS_SPACE || afterLine == BOUNDARY_LINE_CLOSE || beforeLine == BOUNDARY_LINE_OPEN) {
+        return false;
+    }
+    if (beforeClass == BOUNDARY_CLASS_SPACE || beforeClass == BOUNDARY_CLASS_IDEOGRAPH ||
+        afterClass == BOUNDARY_CLASS_IDEOGRAPH) {
+        return true;
+    }
+    return beforeLine == BOUNDARY_LINE_HYPHEN && afterClass == BOUNDARY_CLASS_WORD &&
+           !(after->codepoint >= '0' && after->codepoint <= '9');
+}
+
+/**
+ * @brief Gets the first line break opportunity after an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The offset at which a line may be broken, or the document length.
+ */
+uint64_t BoundaryNextLineBreak(const Document* document, uint64_t offset) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    while (offset < reader.length) {
+        BoundaryChar before = DecodeAt(&reader, offset);
+        offset = NextGrapheme(&reader, offset);
+        if (offset >= reader.length) {
+            break;
+        }
+        BoundaryChar after = DecodeAt(&reader, offset);
+        if (LineBreaks(&before, &after)) {
+            return offset;
+        }
+    }
+    return reader.length;
+}
+
+/**
+ * @brief Gets the last line break opportunity before an offset.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The offset at which a line may be broken, or 0.
+ */
+uint64_t BoundaryPreviousLineBreak(const Document* document, uint64_t offset) {
+    BoundaryReader reader;
+    ReaderInitDocument(&reader, document);
+    offset = PreviousGrapheme(&reader, offset < reader.length ? offset : reader.length);
+    while (offset > 0) {
+        uint64_t previous = PreviousGrapheme(&reader, offset);
+        BoundaryChar before = DecodeAt(&reader, previous);
+        BoundaryChar after = DecodeAt(&reader, offset);
+        if (LineBreaks(&before, &after)) {
+            return offset;
+        }
+        offset = previous;
+    }
+    return 0;
+}
+
+/**
+ * @brief Gets the end of the grapheme cluster starting at an offset of a text.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The next grapheme boundary, or the length at the end.
+ */
+size_t BoundaryTextNextGrapheme(const char* text, size_t length, size_t offset) {
+    BoundaryReader reader;
+    ReaderInitText(&reader, text, length);
+    return (size_t)NextGrapheme(&reader, offset);
+}
+
+/**
+ * @brief Gets the start of the grapheme cluster ending at an offset of a text.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The previous grapheme boundary, or 0 at the start.
+ */
+size_t BoundaryTextPreviousGrapheme(const char* text, size_t length, size_t offset) {
+    BoundaryReader reader;
+    ReaderInitText(&reader, text, length);
+    return (size_t)PreviousGrapheme(&reader, offset < length ? offset : length);
+}
+
+/**
+ * @brief Gets the start of the next word of a text, as BoundaryNextWord does.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The start of the next word, or the length.
+ */
+size_t BoundaryTextNextWord(const char* text, size_t length, size_t offset) {
+    BoundaryReader reader;
+    ReaderInitText(&reader, text, length);
+    return (size_t)NextWord(&reader, offset);
+}
+
+/**
+ * @brief Gets the start of the word before an offset of a text, as BoundaryPreviousWord does.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param offset The offset.
+ * @return The start of the previous word, or 0.
+ */
+size_t BoundaryTextPreviousWord(const char* text, size_t length, size_t offset) {
+    BoundaryReader reader;
+    ReaderInitText(&reader, text, length);
+    return (size_t)PreviousWord(&reader, offset < length ? offset : length);
+}
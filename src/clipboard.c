@@ -0,0 +1,332 @@
+/**
+ * @file clipboard.c
+ * @brief Clipboard implementation for the Professional Text Editor
+ *
+ * Contains the Win32 clipboard with delayed rendering and the in-process
+ * clipboard used on other platforms.
+ */
+
+#include "../include/clipboard.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Slice placed on the clipboard by this process, or NULL
+static DocumentSlice* g_clipboardSlice = NULL;
+
+#ifdef _WIN32
+
+// Window that owns the clipboard while it holds the slice
+static HWND g_clipboardOwner = NULL;
+
+/**
+ * @brief Copies a slice into a new global memory block.
+ *
+ * @param slice The slice.
+ * @return The NUL-terminated text block, or NULL on failure.
+ */
+static HGLOBAL RenderSlice(const DocumentSlice* slice) {
+    uint64_t length = DocumentSliceLength(slice);
+    if (length >= (uint64_t)SIZE_MAX) {
+        return NULL;
+    }
+
+    HGLOBAL hData = GlobalAlloc(GMEM_MOVEABLE, (SIZE_T)length + 1);
+    if (!hData) {
+        return NULL;
+    }
+    char* data = (char*)GlobalLock(hData);
+    if (!data) {
+        GlobalFree(hData);
+        return NULL;
+    }
+    size_t copied = DocumentSliceRead(slice, 0, data, (size_t)length);
+    data[copied] = '\0';
+    GlobalUnlock(hData);
+    return hData;
+}
+
+/**
+ * @brief Places a slice on the clipboard without rendering its text.
+ *
+ * @param owner Window that renders the text on request (HWND on Windows).
+ * @param slice The slice; ownership is transferred to the clipboard.
+ * @return true if successful, false otherwise (the slice is then released).
+ */
+bool ClipboardSetSlice(void* owner, DocumentSlice* slice) {
+    if (!owner || !slice || !OpenClipboard((HWND)owner)) {
+        DocumentSliceRelease(slice);
+        return false;
+    }
+
+    // Emptying sends WM_DESTROYCLIPBOARD to the previous owner, which drops the old slice
+    EmptyClipboard();
+    ClipboardRelease();
+    g_clipboardSlice = slice;
+    g_clipboardOwner = (HWND)owner;
+
+    // A NULL handle makes Windows send WM_RENDERFORMAT when the text is first requested
+    SetClipboardData(CF_TEXT, NULL);
+    CloseClipboard();
+    return true;
+}
+
+/**
+ * @brief Places a copy of a text on the clipboard.
+ *
+ * @param owner Window that owns the clipboard (HWND on Windows).
+ * @param text The text (may be NULL if length is 0).
+ * @param length Length of the text.
+ * @return true if successful, false otherwise.
+ */
+bool ClipboardSetText(void* owner, const char* text, size_t length) {
+    if (!owner || (!text && length > 0) || length == SIZE_MAX) {
+        return false;
+    }
+
+    HGLOBAL hData = GlobalAlloc(GMEM_MOVEABLE, length + 1);
+    char* data = hData ? (char*)GlobalLock(hData) : NULL;
+    if (!data) {
+        if (hData) {
+            GlobalFree(hData);
+        }
+        return false;
+    }
+    if (length > 0) {
+        memcpy(data, text, length);
+    }
+    data[length] = '\0';
+    GlobalUnlock(hData);
+
+    if (!OpenClipboard((HWND)owner)) {
+        GlobalFree(hData);
+        return false;
+    }
+    EmptyClipboard();
+    ClipboardRelease();
+    bool result = SetClipboardData(CF_TEXT, hData) != NULL;
+    if (!result) {
+        GlobalFree(hData);
+    }
+    CloseClipboard();
+    return result;
+}
+
+/**
+ * @brief Gets the slice placed on the clipboard by this process.
+ *
+ * @return The slice, owned by the clipboard, or NULL if the clipboard holds no slice.
+ */
+DocumentSlice* ClipboardGetSlice(void) {
+    if (g_clipboardSlice && GetClipboardOwner() == g_clipboardOwner) {
+        return g_clipboardSlice;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Passes the clipboard text to a callback without copying it.
+ *
+ * @param owner Window opening the clipboard (HWND on Windows).
+ * @param callback Invoked once with the text.
+ * @param context Pointer passed to the callback.
+ * @return The result of the callback, or false if the clipboard holds no text.
+ */
+bool ClipboardReadText(void* owner, ClipboardTextCallback callback, void* context) {
+    if (!callback || !IsClipboardFormatAvailable(CF_TEXT) || !OpenClipboard((HWND)owner)) {
+        return false;
+    }
+
+    bool result = false;
+    HANDLE hData = GetClipboardData(CF_TEXT);
+    const char* text = hData ? (const char*)GlobalLock(hData) : NULL;
+    if (text) {
+        // The block may be larger than the text, which ends at the first NUL
+        SIZE_T size = GlobalSize(hData);
+        const char* end = (const char*)memchr(text, '\0', size);
+        result = callback(text, end ? (size_t)(end - text) : (size_t)size, context);
+        GlobalUnlock(hData);
+    }
+    CloseClipboard();
+    return result;
+}
+
+/**
+ * @brief Renders the slice as text while the system clipboard is open (WM_RENDERFORMAT).
+ *
+ * @return true if the text was rendered, false otherwise.
+ */
+bool ClipboardRender(void) {
+    if (!g_clipboardSlice) {
+        return false;
+    }
+    HGLOBAL hData = RenderSlice(g_clipboardSlice);
+    if (!hData) {
+        return false;
+    }
+    if (!SetClipboardData(CF_TEXT, hData)) {
+        GlobalFree(hData);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Renders the slice before its owner goes away (WM_RENDERALLFORMATS).
+ *
+ * @param owner Window that owns the clipboard (HWND on Windows).
+ */
+void ClipboardRenderAll(void* owner) {
+    if (g_clipboardSlice && OpenClipboard((HWND)owner)) {
+        if (GetClipboardOwner() == (HWND)owner) {
+            ClipboardRender();
+        }
+        CloseClipboard();
+    }
+    ClipboardRelease();
+}
+
+/**
+ * @brief Releases the slice once the clipboard no longer holds it (WM_DESTROYCLIPBOARD).
+ */
+void ClipboardRelease(void) {
+    DocumentSliceRelease(g_clipboardSlice);
+    g_clipboardSlice = NULL;
+    g_clipboardOwner = NULL;
+}
+
+#else /* In-process clipboard */
+
+// Rendered text of the clipboard, produced from the slice on first read
+static char* g_clipboardText = NULL;
+static size_t g_clipboardLength = 0;
+
+/**
+ * @brief Drops the rendered text.
+ */
+static void FreeClipboardText(void) {
+    free(g_clipboardText);
+    g_clipboardText = NULL;
+    g_clipboardLength = 0;
+}
+
+/**
+ * @brief Places a slice on the clipboard without rendering its text.
+ *
+ * @param owner Unused on this platform.
+ * @param slice The slice; ownership is transferred to the clipboard.
+ * @return true if successful, false otherwise (the slice is then released).
+ */
+bool ClipboardSetSlice(void* owner, DocumentSlice* slice) {
+    (void)owner;
+    if (!slice) {
+        return false;
+    }
+    ClipboardRelease();
+    FreeClipboardText();
+    g_clipboardSlice = slice;
+    return true;
+}
+
+/**
+ * @brief Places a copy of a text on the clipboard.
+ *
+ * @param owner Unused on this platform.
+ * @param text The text (may be NULL if length is 0).
+ * @param length Length of the text.
+ * @return true if successful, false otherwise.
+ */
+bool ClipboardSetText(void* owner, const char* text, size_t length) {
+    (void)owner;
+    if ((!text && length > 0) || length == SIZE_MAX) {
+        return false;
+    }
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        return false;
+    }
+    if (length > 0) {
+        memcpy(copy, text, length);
+    }
+    copy[length] = '\0';
+
+    ClipboardRelease();
+    FreeClipboardText();
+    g_clipboardText = copy;
+    g_clipboardLength = length;
+    return true;
+}
+
+/**
+ * @brief Gets the slice placed on the clipboard by this process.
+ *
+ * @return The slice, owned by the clipboard, or NULL if the clipboard holds no slice.
+ */
+DocumentSlice* ClipboardGetSlice(void) {
+    return g_clipboardSlice;
+}
+
+/**
+ * @brief Passes the clipboard text to a callback without copying it.
+ *
+ * @param owner Unused on this platform.
+ * @param callback Invoked once with the text.
+ * @param context Pointer passed to the callback.
+ * @return The result of the callback, or false if the clipboard holds no text.
+ */
+bool ClipboardReadText(void* owner, ClipboardTextCallback callback, void* context) {
+    (void)owner;
+    if (!callback || (!g_clipboardText && !ClipboardRender())) {
+        return false;
+    }
+    return callback(g_clipboardText, g_clipboardLength, context);
+}
+
+/**
+ * @brief Renders the slice as text.
+ *
+ * @return true if the text was rendered, false otherwise.
+ */
+bool ClipboardRender(void) {
+    if (!g_clipboardSlice) {
+        return false;
+    }
+    uint64_t length = DocumentSliceLength(g_clipboardSlice);
+    char* text = length < (uint64_t)SIZE_MAX ? (char*)malloc((size_t)length + 1) : NULL;
+    if (!text) {
+        return false;
+    }
+    size_t copied = DocumentSliceRead(g_clipboardSlice, 0, text, (size_t)length);
+    text[copied] = '\0';
+
+    FreeClipboardText();
+    g_clipboardText = text;
+    g_clipboardLength = copied;
+    return true;
+}
+
+/**
+ * @brief Renders the slice and releases it.
+ *
+ * @param owner Unused on this platform.
+ */
+void ClipboardRenderAll(void* owner) {
+    (void)owner;
+    if (g_clipboardSlice && !g_clipboardText) {
+        ClipboardRender();
+    }
+    ClipboardRelease();
+}
+
+/**
+ * @brief Releases the slice; text already rendered stays on the clipboard.
+ */
+void ClipboardRelease(void) {
+    DocumentSliceRelease(g_clipboardSlice);
+    g_clipboardSlice = NULL;
+}
+
+#endif /* _WIN32 */
@@ -2,10 +2,2525 @@
  * @file control.c
  * @brief Editor control implementation for the Professional Text Editor
  *
- * Contains functions for creating and managing the text editor control.
+ * Contains the editor view window class. The stock EDIT control supports a
+ * single caret, so the view draws the document itself: it keeps a cursor
+ * set, turns each keystroke into one edit batch over all carets, and
+ * repaints once per batch from the document's change notification.
+ * Folded lines are skipped by mapping screen rows to document lines
+ * through the view's fold set. Misspelled words found by the background
+ * spell checker are underlined as they arrive. Word completion offers the
+ * most frequent identifiers of the document from its identifier index.
+ * Sort Lines and Unique Lines run on a worker thread that reports its
+ * progress to the parent window; the document is read-only until the
+ * sorted ranges come back and are applied as one edit. Typing, deleting
+ * and caret movement can be recorded as a macro and played back at the
+ * carets or over many lines, with one repaint when it ends. Bookmarked
+ * lines are markers of the document that move with the text and are drawn
+ * with a tinted background. Filtering shows only the lines containing the
+ * selected text; its rows map to lines through the view's line filter,
+ * which follows the edits, and showing every line again keeps the caret.
+ * Going to a time moves the caret to the first log line stamped at or after
+ * the selected time through the document's timestamp index.
  */
 
 #include "../include/control.h"
+#include "../include/clipboard.h"
+#include "../include/cursors.h"
+#include "../include/folds.h"
+#include "../include/layout.h"
+#include "../include/linefilter.h"
+#include "../include/linesort.h"
+#include "../include/macro.h"
+#include "../include/markers.h"
+#include "../include/search.h"
+#include "../include/spellcheck.h"
+#include "../include/structure.h"
+#include "../include/textformat.h"
+#include "../include/thread.h"
+#include "../include/timeindex.h"
+#include "../include/wordindex.h"
+#include <limits.h>
+#include <string.h>
+
+// Font used by the view
+#define EDITOR_VIEW_FONT_NAME "Consolas"
+#define EDITOR_VIEW_FONT_HEIGHT 16
+
+// Maximum number of columns drawn per row
+#define EDITOR_VIEW_MAX_COLUMNS 1024
+
+// Lines scrolled per mouse wheel notch
+#define EDITOR_VIEW_WHEEL_LINES 3
+
+// Width of a caret in pixels
+#define EDITOR_VIEW_CARET_WIDTH 2
+
+// Background of selected text
+#define EDITOR_VIEW_SELECTION_COLOR RGB(173, 214, 255)
+
+// Background of bookmarked lines
+#define EDITOR_VIEW_BOOKMARK_COLOR RGB(255, 244, 204)
+
+// Marker drawn after the header line of a fold
+#define EDITOR_VIEW_FOLD_MARKER " ..."
+#define EDITOR_VIEW_FOLD_MARKER_COLOR RGB(128, 128, 128)
+
+// Underline of misspelled words
+#define EDITOR_VIEW_SPELLING_COLOR RGB(224, 32, 32)
+#define EDITOR_VIEW_SPELLING_STEP 2     // Width and height of one zigzag step in pixels
+
+// Suggestions offered in the context menu of a misspelled word
+#define EDITOR_VIEW_MAX_SUGGESTIONS 5
+
+// Identifiers offered by word completion
+#define EDITOR_VIEW_MAX_COMPLETIONS 10
+
+// Memory for the line records of Sort Lines; larger selections are sorted through temporary files
+#define EDITOR_VIEW_SORT_BUDGET ((size_t)128 * 1024 * 1024)
+
+// Posted by the spell checker's worker thread when results are ready
+#define WM_EDITOR_SPELLING_READY (WM_USER + 1)
+
+// Posted by the sort's worker thread: wParam is the percentage done
+#define WM_EDITOR_SORT_PROGRESS (WM_USER + 2)
+
+// Posted by the sort's worker thread when it has finished
+#define WM_EDITOR_SORT_DONE (WM_USER + 3)
+
+// Sort Lines or Unique Lines running on a worker thread
+typedef struct {
+    HWND hWnd;                  // View notified of progress and completion
+    Thread* thread;
+    ThreadLock* lock;           // Guards cancel and finished
+    const Document* document;
+    uint64_t offset;            // Range being sorted
+    uint64_t length;
+    LineSortOptions options;
+    LineSortResult result;
+    bool succeeded;
+    bool cancel;                // Set by the view to stop the sort
+    bool finished;              // Set by the worker before posting WM_EDITOR_SORT_DONE
+    int percent;                // Last percentage posted to the view
+    const char* label;          // Task shown in the status bar
+    char tempPrefix[MAX_PATH];  // Temporary file naming the run files, or empty
+} SortJob;
+
+// Per-window state of the editor view
+typedef struct {
+    Document* document;
+    CursorSet cursors;
+    LayoutCache* layout;        // Segment summaries of long lines, or NULL if unavailable
+    StructureIndex* structure;  // Bracket and indentation index, or NULL if unavailable
+    WordIndex* words;           // Identifier index for completion, or NULL if unavailable
+    MarkerTree* markers;        // Bookmarks, or NULL if unavailable
+    FoldSet folds;
+    LineFilter* filter;         // Lines shown while filtering, or NULL to show every line
+    TimeIndex* times;           // Timestamps of a log, or NULL if the document has none
+    const SpellDict* dictionary;    // Dictionary of the spell checker, or NULL when spelling is off
+    SpellChecker* spelling;         // Background spell checker, or NULL when spelling is off
+    SortJob* sort;              // Sort in progress, or NULL; the document is not edited meanwhile
+    Macro macro;                // Last recorded macro
+    HFONT font;
+    int charWidth;
+    int lineHeight;
+    uint64_t firstRow;          // First visible row (lines hidden by folds or the filter take no row)
+    uint64_t firstColumn;       // First visible display column
+    int visibleLines;           // Rows that fit in the client area
+    int visibleColumns;         // Columns that fit in the client area
+    BOOL hasFocus;
+    BOOL selecting;             // Left button is down and extends the primary selection
+    BOOL editing;               // The view itself is applying an edit batch
+    BOOL readOnly;              // Typing, pasting and undo are refused
+    BOOL recording;             // Typing, deleting and caret movement are added to the macro
+    BOOL replaying;             // A macro is playing; the display is updated once it ends
+} EditorView;
+
+/**
+ * @brief Gets the state attached to an editor view window.
+ *
+ * @param hWnd Handle to the view.
+ * @return The view state, or NULL if the window has none.
+ */
+static EditorView* GetView(HWND hWnd) {
+    return hWnd ? (EditorView*)GetWindowLongPtr(hWnd, GWLP_USERDATA) : NULL;
+}
+
+/**
+ * @brief Gets the number of rows scrolled by a page movement.
+ *
+ * @param view The view.
+ * @return The number of rows, at least 1.
+ */
+static uint64_t PageLines(const EditorView* view) {
+    return view->visibleLines > 1 ? (uint64_t)(view->visibleLines - 1) : 1;
+}
+
+/**
+ * @brief Gets the number of rows of the view.
+ *
+ * @param view The view.
+ * @return The number of matching lines while filtering, otherwise the number of lines outside folds.
+ */
+static uint64_t ViewRowCount(EditorView* view) {
+    if (view->filter) {
+        return LineFilterCount(view->filter);
+    }
+    return FoldSetVisibleLineCount(&view->folds, view->document);
+}
+
+/**
+ * @brief Gets the line shown in a row of the view.
+ *
+ * @param view The view.
+ * @param row The row.
+ * @return The line.
+ */
+static uint64_t ViewLineFromRow(EditorView* view, uint64_t row) {
+    if (view->filter) {
+        return LineFilterLineFromRow(view->filter, row);
+    }
+    return FoldSetLineFromRow(&view->folds, view->document, row);
+}
+
+/**
+ * @brief Gets the row of the view showing a line.
+ *
+ * @param view The view.
+ * @param line The line; a hidden line maps to the row of the shown line above it.
+ * @return The row.
+ */
+static uint64_t ViewRowFromLine(EditorView* view, uint64_t line) {
+    if (view->filter) {
+        return LineFilterRowFromLine(view->filter, line);
+    }
+    return FoldSetRowFromLine(&view->folds, view->document, line);
+}
+
+/**
+ * @brief Checks whether a line has no row of its own.
+ *
+ * @param view The view.
+ * @param line The line.
+ * @return true if the line is folded or filtered out, false otherwise.
+ */
+static bool ViewIsHidden(EditorView* view, uint64_t line) {
+    if (view->filter) {
+        return !LineFilterIsMatch(view->filter, line);
+    }
+    return FoldSetIsHidden(&view->folds, view->document, line);
+}
+
+/**
+ * @brief Updates the scroll bars from the document size and scroll position.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void UpdateScrollBars(HWND hWnd, EditorView* view) {
+    uint64_t rowCount = ViewRowCount(view);
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+    si.nMin = 0;
+    si.nMax = (int)(rowCount - 1 > INT_MAX ? INT_MAX : rowCount - 1);
+    si.nPage = (UINT)view->visibleLines;
+    si.nPos = (int)(view->firstRow > INT_MAX ? INT_MAX : view->firstRow);
+    SetScrollInfo(hWnd, SB_VERT, &si, TRUE);
+
+    // The width of every line is unknown, so the range covers the visible lines
+    uint64_t widest = view->firstColumn + (uint64_t)view->visibleColumns;
+    for (int row = 0; row < view->visibleLines; row++) {
+        if (view->firstRow + (uint64_t)row >= rowCount) {
+            break;
+        }
+        uint64_t line = ViewLineFromRow(view, view->firstRow + (uint64_t)row);
+        uint64_t lineStart = DocumentLineStart(view->document, line);
+        uint64_t width = LayoutLineWidth(view->document, lineStart, DocumentLineEnd(view->document, line));
+        if (width + 1 > widest) {
+            widest = width + 1;
+        }
+    }
+    si.nMax = (int)(widest > INT_MAX ? INT_MAX : widest);
+    si.nPage = (UINT)view->visibleColumns;
+    si.nPos = (int)(view->firstColumn > INT_MAX ? INT_MAX : view->firstColumn);
+    SetScrollInfo(hWnd, SB_HORZ, &si, TRUE);
+}
+
+/**
+ * @brief Hands unchecked text to the spell checker, visible lines first.
+ *
+ * @param view The view.
+ */
+static void ScheduleSpelling(EditorView* view) {
+    if (!view->spelling) {
+        return;
+    }
+    uint64_t rowCount = ViewRowCount(view);
+    uint64_t lastRow = view->firstRow + (uint64_t)(view->visibleLines > 0 ? view->visibleLines : 1);
+    if (lastRow >= rowCount) {
+        lastRow = rowCount - 1;
+    }
+    uint64_t firstLine = ViewLineFromRow(view, view->firstRow);
+    uint64_t lastLine = ViewLineFromRow(view, lastRow);
+    SpellCheckerSchedule(view->spelling, view->document, DocumentLineStart(view->document, firstLine),
+                         DocumentLineEnd(view->document, lastLine));
+}
+
+/**
+ * @brief Posts the spell checker's results to the view. Runs on the worker thread.
+ *
+ * @param context Handle to the view.
+ */
+static void SpellingReady(void* context) {
+    PostMessage((HWND)context, WM_EDITOR_SPELLING_READY, 0, 0);
+}
+
+/**
+ * @brief Scrolls the view to a row and column.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param firstRow New first visible row.
+ * @param firstColumn New first visible column.
+ */
+static void ScrollViewTo(HWND hWnd, EditorView* view, uint64_t firstRow, uint64_t firstColumn) {
+    uint64_t rowCount = ViewRowCount(view);
+    if (firstRow >= rowCount) {
+        firstRow = rowCount - 1;
+    }
+    if (firstRow == view->firstRow && firstColumn == view->firstColumn) {
+        return;
+    }
+    view->firstRow = firstRow;
+    view->firstColumn = firstColumn;
+    UpdateScrollBars(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+    ScheduleSpelling(view);
+}
+
+/**
+ * @brief Scrolls the view so that the primary caret is visible.
+ *
+ * A fold hiding the caret is opened. While filtering, a caret on a line
+ * that does not match scrolls to the matching line above it.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void EnsurePrimaryVisible(HWND hWnd, EditorView* view) {
+    if (view->cursors.count == 0) {
+        return;
+    }
+    uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+    uint64_t line = DocumentLineFromOffset(view->document, caret);
+    uint64_t column = LayoutColumnFromOffset(view->document, DocumentLineStart(view->document, line), caret);
+    if (!view->filter && FoldSetRevealLine(&view->folds, view->document, line)) {
+        UpdateScrollBars(hWnd, view);
+        InvalidateRect(hWnd, NULL, FALSE);
+    }
+
+    uint64_t row = ViewRowFromLine(view, line);
+    uint64_t firstRow = view->firstRow;
+    uint64_t rows = view->visibleLines > 0 ? (uint64_t)view->visibleLines : 1;
+    if (row < firstRow) {
+        firstRow = row;
+    } else if (row >= firstRow + rows) {
+        firstRow = row - rows + 1;
+    }
+
+    uint64_t firstColumn = view->firstColumn;
+    uint64_t columns = view->visibleColumns > 0 ? (uint64_t)view->visibleColumns : 1;
+    if (column < firstColumn) {
+        firstColumn = column;
+    } else if (column >= firstColumn + columns) {
+        firstColumn = column - columns + 1;
+    }
+
+    ScrollViewTo(hWnd, view, firstRow, firstColumn);
+}
+
+/**
+ * @brief Repaints the view and scrolls the primary caret into view after a selection change.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void SelectionChanged(HWND hWnd, EditorView* view) {
+    EnsurePrimaryVisible(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Keeps the carets and the display in sync with document changes.
+ *
+ * Edits made by the view already placed the carets; changes made by anyone
+ * else move them. Either way the view is invalidated once per batch, except
+ * while a macro plays, which updates the display once at the end.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes.
+ * @param changeCount Number of changes.
+ * @param context Handle to the view.
+ */
+static void ViewDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                void* context) {
+    HWND hWnd = (HWND)context;
+    EditorView* view = GetView(hWnd);
+    if (!view) {
+        return;
+    }
+    if (!view->editing) {
+        CursorSetMapChanges(&view->cursors, changes, changeCount);
+    }
+    FoldSetMapChanges(&view->folds, changes, changeCount);
+    LineFilterMapChanges(view->filter, changes, changeCount);
+    if (view->filter && LineFilterCount(view->filter) == 0) {
+        // The last matching line was edited away
+        LineFilterDestroy(view->filter);
+        view->filter = NULL;
+    }
+    uint64_t rowCount = ViewRowCount(view);
+    if (view->firstRow >= rowCount) {
+        view->firstRow = rowCount - 1;
+    }
+    SpellCheckerMapChanges(view->spelling, document, changes, changeCount);
+    if (view->replaying) {
+        return;
+    }
+    UpdateScrollBars(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+    ScheduleSpelling(view);
+}
+
+/**
+ * @brief Reports the progress of a sort to the view. Runs on the worker thread.
+ *
+ * @param done Work done so far.
+ * @param total Total work.
+ * @param context The sort job.
+ * @return true to continue, false once the view asked to cancel.
+ */
+static bool SortProgress(uint64_t done, uint64_t total, void* context) {
+    SortJob* job = (SortJob*)context;
+    int percent = total > 0 ? (int)(done * 100 / total) : 100;
+    if (percent != job->percent) {
+        job->percent = percent;
+        PostMessage(job->hWnd, WM_EDITOR_SORT_PROGRESS, (WPARAM)percent, 0);
+    }
+    ThreadLockEnter(job->lock);
+    bool cancel = job->cancel;
+    ThreadLockLeave(job->lock);
+    return !cancel;
+}
+
+/**
+ * @brief Sorts the lines of a job and posts the result to the view. Runs on the worker thread.
+ *
+ * @param context The sort job.
+ */
+static void SortWorker(void* context) {
+    SortJob* job = (SortJob*)context;
+    job->succeeded = LineSortRun(job->document, job->offset, job->length, &job->options, &job->result);
+    ThreadLockEnter(job->lock);
+    job->finished = true;
+    ThreadLockLeave(job->lock);
+    PostMessage(job->hWnd, WM_EDITOR_SORT_DONE, 0, 0);
+}
+
+/**
+ * @brief Tells the parent window about the progress of a background task.
+ *
+ * @param hWnd Handle to the view.
+ * @param percent Percentage done, or -1 when the task has ended.
+ * @param label Name of the task.
+ */
+static void NotifyProgress(HWND hWnd, int percent, const char* label) {
+    HWND parent = GetParent(hWnd);
+    if (parent) {
+        SendMessage(parent, WM_EDITOR_PROGRESS, (WPARAM)percent, (LPARAM)label);
+    }
+}
+
+/**
+ * @brief Waits for the sort of a view to end and releases it.
+ *
+ * @param view The view.
+ * @param cancel TRUE to cancel the sort first, FALSE to wait for its result.
+ * @return The ended job, to be released with ReleaseSort, or NULL if none was running.
+ */
+static SortJob* EndSort(EditorView* view, BOOL cancel) {
+    SortJob* job = view->sort;
+    if (!job) {
+        return NULL;
+    }
+    if (cancel) {
+        ThreadLockEnter(job->lock);
+        job->cancel = true;
+        ThreadLockLeave(job->lock);
+    }
+    ThreadJoin(job->thread);
+    view->sort = NULL;
+    return job;
+}
+
+/**
+ * @brief Releases an ended sort job and its temporary file.
+ *
+ * @param job The job, or NULL.
+ */
+static void ReleaseSort(SortJob* job) {
+    if (!job) {
+        return;
+    }
+    if (job->tempPrefix[0]) {
+        DeleteFile(job->tempPrefix);
+    }
+    LineSortResultFree(&job->result);
+    ThreadLockDestroy(job->lock);
+    free(job);
+}
+
+/**
+ * @brief Replaces the document of a view and resets the carets and scroll position.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param document The new document (owned by the view from now on).
+ * @return TRUE if successful, FALSE otherwise.
+ */
+static BOOL AttachDocument(HWND hWnd, EditorView* view, Document* document) {
+    // The layout cache listens first, so the view lays out changed lines from up to date segments
+    LayoutCache* layout = LayoutCacheCreate(document);
+    if (!DocumentAddListener(document, ViewDocumentChanged, (void*)hWnd)) {
+        LayoutCacheDestroy(layout);
+        DocumentDestroy(document);
+        return FALSE;
+    }
+    if (view->document) {
+        // The sort reads the old document until it ends
+        SortJob* job = EndSort(view, TRUE);
+        if (job) {
+            NotifyProgress(hWnd, -1, job->label);
+            ReleaseSort(job);
+        }
+        DocumentRemoveListener(view->document, ViewDocumentChanged, (void*)hWnd);
+        LineFilterDestroy(view->filter);
+        view->filter = NULL;
+        TimeIndexDestroy(view->times);
+        StructureIndexDestroy(view->structure);
+        WordIndexDestroy(view->words);
+        MarkerTreeDestroy(view->markers);
+        LayoutCacheDestroy(view->layout);
+        DocumentDestroy(view->document);
+    }
+    view->document = document;
+    view->layout = layout;
+    view->markers = MarkerTreeCreate(document);
+
+    // Without a structure index the view only loses folding and bracket matching
+    view->structure = StructureIndexCreate(document);
+
+    // The identifier index is built now, while the file is still unmodified and can be split across threads
+    view->words = WordIndexCreate(document);
+    if (view->words) {
+        WordIndexBuild(view->words, 0);
+    }
+
+    // Timestamps are sampled while the pages read by the line index scan are still cached
+    view->times = TimeIndexCreate(document);
+    FoldSetClear(&view->folds);
+    view->firstRow = 0;
+    view->firstColumn = 0;
+    CursorSetReset(&view->cursors, 0, 0);
+    SpellCheckerReset(view->spelling, document);
+    UpdateScrollBars(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+    ScheduleSpelling(view);
+    return TRUE;
+}
+
+/**
+ * @brief Gets the line terminator used when Enter is pressed.
+ *
+ * @param document The document.
+ * @return "\n" if the first line ends with a bare line feed, "\r\n" otherwise.
+ */
+static const char* DocumentLineTerminator(const Document* document) {
+    if (DocumentLineCount(document) > 1) {
+        uint64_t end = DocumentLineEnd(document, 0);
+        if (DocumentCharAt(document, end) == '\n') {
+            return "\n";
+        }
+    }
+    return "\r\n";
+}
+
+/**
+ * @brief Converts a client point to a document offset.
+ *
+ * @param view The view.
+ * @param x Client x coordinate.
+ * @param y Client y coordinate.
+ * @return The offset of the character boundary nearest to the point.
+ */
+static uint64_t OffsetFromPoint(EditorView* view, int x, int y) {
+    uint64_t rowCount = ViewRowCount(view);
+    int row = y < 0 ? 0 : y / view->lineHeight;
+    uint64_t target = view->firstRow + (uint64_t)row;
+    if (y < 0 && view->firstRow > 0) {
+        target = view->firstRow - 1;
+    }
+    if (target >= rowCount) {
+        target = rowCount - 1;
+    }
+    uint64_t line = ViewLineFromRow(view, target);
+
+    int column = x < 0 ? 0 : (x + view->charWidth / 2) / view->charWidth;
+    return LayoutOffsetFromColumn(view->document, DocumentLineStart(view->document, line),
+                                  DocumentLineEnd(view->document, line), view->firstColumn + (uint64_t)column);
+}
+
+/**
+ * @brief Applies an edit operation of the cursor set and refreshes the view.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param applied Result of the cursor set operation.
+ * @return The result of the operation.
+ */
+static BOOL FinishEdit(HWND hWnd, EditorView* view, bool applied) {
+    view->editing = FALSE;
+    if (applied) {
+        SelectionChanged(hWnd, view);
+    }
+    return applied ? TRUE : FALSE;
+}
+
+/**
+ * @brief Starts an edit batch made by the view itself.
+ *
+ * @param view The view.
+ * @return TRUE if the view may edit its document, FALSE if it is read-only or being sorted.
+ */
+static BOOL BeginEdit(EditorView* view) {
+    if (view->readOnly || view->sort) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    view->editing = TRUE;
+    return TRUE;
+}
+
+/**
+ * @brief Inserts text at every caret, replacing the selections.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param text The text.
+ * @param length Length of the text.
+ * @return TRUE if the document changed, FALSE otherwise.
+ */
+static BOOL InsertText(HWND hWnd, EditorView* view, const char* text, size_t length) {
+    if (!BeginEdit(view)) {
+        return FALSE;
+    }
+    return FinishEdit(hWnd, view, CursorSetInsert(&view->cursors, view->document, text, length));
+}
+
+/**
+ * @brief Places the selected text of every selection on the clipboard.
+ *
+ * Only a slice sharing the selected pieces is stored, so copying costs the
+ * same for a word and for the whole file; the text is rendered when another
+ * application asks for it. Selections are joined with line terminators and
+ * remembered as parts, so pasting back with the same number of carets
+ * distributes one part per caret.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if something was copied, FALSE otherwise.
+ */
+static BOOL CopySelections(HWND hWnd, EditorView* view) {
+    DocumentRange* ranges = (DocumentRange*)malloc(view->cursors.count * sizeof(DocumentRange));
+    if (!ranges) {
+        return FALSE;
+    }
+
+    size_t selected = 0;
+    for (size_t i = 0; i < view->cursors.count; i++) {
+        const Selection* selection = &view->cursors.items[i];
+        uint64_t start = SelectionStart(selection);
+        uint64_t end = SelectionEnd(selection);
+        if (end > start) {
+            ranges[selected].offset = start;
+            ranges[selected].length = end - start;
+            selected++;
+        }
+    }
+
+    DocumentSlice* slice = NULL;
+    if (selected > 0) {
+        const char* terminator = DocumentLineTerminator(view->document);
+        slice = DocumentSliceCreate(view->document, ranges, selected, terminator, strlen(terminator));
+    }
+    free(ranges);
+    return slice && ClipboardSetSlice(hWnd, slice) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Inserts a slice at every caret, or one part per caret when the counts match.
+ *
+ * The caller has started the edit with BeginEdit.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param slice A slice of the view's document.
+ * @return TRUE if the document changed, FALSE otherwise.
+ */
+static BOOL PasteSlice(HWND hWnd, EditorView* view, DocumentSlice* slice) {
+    size_t count = view->cursors.count;
+    BOOL distribute = count > 1 && DocumentSlicePartCount(slice) == count;
+    DocumentSlice** slices = (DocumentSlice**)calloc(count, sizeof(DocumentSlice*));
+    bool ready = slices != NULL;
+    for (size_t i = 0; ready && i < count; i++) {
+        slices[i] = distribute ? DocumentSlicePart(slice, i) : slice;
+        ready = slices[i] != NULL;
+    }
+
+    bool applied = ready && CursorSetInsertSlices(&view->cursors, view->document,
+                                                  (const DocumentSlice* const*)slices);
+    if (distribute && slices) {
+        for (size_t i = 0; i < count; i++) {
+            DocumentSliceRelease(slices[i]);
+        }
+    }
+    free(slices);
+    return FinishEdit(hWnd, view, applied);
+}
+
+// State shared with PasteText while the clipboard is open
+typedef struct {
+    HWND hWnd;
+    EditorView* view;
+    BOOL pasted;
+} PasteContext;
+
+/**
+ * @brief Pastes text from another application at every caret.
+ *
+ * When the text holds exactly one line per caret, each caret receives its
+ * own line. Otherwise the text is streamed into the document storage once
+ * and shared by all carets.
+ *
+ * @param text The clipboard text.
+ * @param length Length of the text.
+ * @param context The paste context.
+ * @return true if the document changed, false otherwise.
+ */
+static bool PasteText(const char* text, size_t length, void* context) {
+    PasteContext* paste = (PasteContext*)context;
+    EditorView* view = paste->view;
+    size_t count = view->cursors.count;
+
+    // Split into lines only when the count matches the carets
+    const char* end = text + length;
+    size_t lineCount = 1;
+    if (count > 1) {
+        for (const char* p = memchr(text, '\n', length); p; p = memchr(p + 1, '\n', (size_t)(end - p - 1))) {
+            if (p + 1 == end) {
+                break; // A trailing terminator does not start another line
+            }
+            if (++lineCount > count) {
+                break;
+            }
+        }
+    }
+
+    if (count > 1 && lineCount == count) {
+        const char** lines = (const char**)malloc(count * sizeof(const char*));
+        size_t* lengths = (size_t*)malloc(count * sizeof(size_t));
+        bool applied = false;
+        if (lines && lengths && BeginEdit(view)) {
+            const char* lineStart = text;
+            for (size_t i = 0; i < count; i++) {
+                const char* lineFeed = memchr(lineStart, '\n', (size_t)(end - lineStart));
+                const char* lineEnd = lineFeed ? lineFeed : end;
+                lines[i] = lineStart;
+                lengths[i] = (size_t)(lineEnd - lineStart);
+                if (lengths[i] > 0 && lineStart[lengths[i] - 1] == '\r') {
+                    lengths[i]--;
+                }
+                lineStart = lineFeed ? lineFeed + 1 : end;
+            }
+            applied = CursorSetInsertEach(&view->cursors, view->document, lines, lengths);
+            paste->pasted = FinishEdit(paste->hWnd, view, applied);
+        }
+        free(lines);
+        free(lengths);
+        return applied;
+    }
+
+    DocumentSlice* slice = DocumentSliceFromText(view->document, text, length);
+    if (!slice) {
+        return false;
+    }
+    if (BeginEdit(view)) {
+        paste->pasted = PasteSlice(paste->hWnd, view, slice);
+    }
+    DocumentSliceRelease(slice);
+    return paste->pasted ? true : false;
+}
+
+/**
+ * @brief Pastes the clipboard content at every caret.
+ *
+ * Content copied inside the editor is pasted by sharing its pieces, so no
+ * bytes are copied; text from other applications is copied exactly once.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if the document changed, FALSE otherwise.
+ */
+static BOOL PasteClipboard(HWND hWnd, EditorView* view) {
+    if (view->readOnly || view->sort) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+
+    DocumentSlice* clip = ClipboardGetSlice();
+    if (clip) {
+        DocumentSlice* slice = DocumentSliceImport(view->document, clip);
+        if (!slice) {
+            return FALSE;
+        }
+        BOOL pasted = BeginEdit(view) && PasteSlice(hWnd, view, slice);
+        DocumentSliceRelease(slice);
+        return pasted;
+    }
+
+    PasteContext paste;
+    paste.hWnd = hWnd;
+    paste.view = view;
+    paste.pasted = FALSE;
+    ClipboardReadText(hWnd, PasteText, &paste);
+    return paste.pasted;
+}
+
+/**
+ * @brief Moves carets that a vertical movement left on hidden lines to the next shown line.
+ *
+ * @param view The view.
+ * @param down TRUE after moving down, FALSE after moving up.
+ */
+static void SkipHiddenLines(EditorView* view, BOOL down) {
+    uint64_t rowCount = ViewRowCount(view);
+    BOOL moved = FALSE;
+    for (size_t i = 0; i < view->cursors.count; i++) {
+        Selection* selection = &view->cursors.items[i];
+        uint64_t line = DocumentLineFromOffset(view->document, selection->caret);
+        if (!ViewIsHidden(view, line)) {
+            continue;
+        }
+
+        // A hidden line shares the row of the shown line above it; moving down takes the row below
+        uint64_t row = ViewRowFromLine(view, line);
+        if (down && ViewLineFromRow(view, row) < line && row + 1 < rowCount) {
+            row++;
+        }
+        line = ViewLineFromRow(view, row);
+        uint64_t column = selection->preferredColumn != CURSOR_NO_COLUMN ? selection->preferredColumn : 0;
+        BOOL collapsed = selection->anchor == selection->caret;
+        selection->caret = LayoutOffsetFromColumn(view->document, DocumentLineStart(view->document, line),
+                                                  DocumentLineEnd(view->document, line), column);
+        if (collapsed) {
+            selection->anchor = selection->caret;
+        }
+        moved = TRUE;
+    }
+    if (moved) {
+        CursorSetNormalize(&view->cursors);
+    }
+}
+
+/**
+ * @brief Folds the region at the primary caret, or unfolds it if the caret is on a fold header.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if the folds changed, FALSE otherwise.
+ */
+static BOOL ToggleFold(HWND hWnd, EditorView* view) {
+    uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+    uint64_t line = DocumentLineFromOffset(view->document, caret);
+
+    if (!FoldSetRemoveHeader(&view->folds, view->document, line)) {
+        uint64_t headerLine;
+        uint64_t lastLine;
+        if (!view->structure || !StructureFindFoldRange(view->structure, line, &headerLine, &lastLine) ||
+            !FoldSetAdd(&view->folds, view->document, headerLine + 1, lastLine)) {
+            return FALSE;
+        }
+        if (headerLine != line) {
+            // Folding the enclosing region moves the caret onto its header
+            uint64_t headerEnd = DocumentLineEnd(view->document, headerLine);
+            CursorSetReset(&view->cursors, headerEnd, headerEnd);
+        }
+    }
+
+    UpdateScrollBars(hWnd, view);
+    SelectionChanged(hWnd, view);
+    return TRUE;
+}
+
+/**
+ * @brief Moves the caret to the next or previous fold header.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param forward TRUE to move down, FALSE to move up.
+ * @return TRUE if the caret moved, FALSE if there is no fold in that direction.
+ */
+static BOOL JumpToFold(HWND hWnd, EditorView* view, BOOL forward) {
+    uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+    uint64_t line = DocumentLineFromOffset(view->document, caret);
+    uint64_t header;
+    if (!FoldSetFindHeader(&view->folds, view->document, line, forward ? true : false, &header)) {
+        return FALSE;
+    }
+
+    uint64_t headerStart = DocumentLineStart(view->document, header);
+    CursorSetReset(&view->cursors, headerStart, headerStart);
+    SelectionChanged(hWnd, view);
+    return TRUE;
+}
+
+/**
+ * @brief Moves the caret to the next or previous bookmarked line, wrapping around.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param forward TRUE to move down, FALSE to move up.
+ * @return TRUE if the caret moved, FALSE if there is no bookmark.
+ */
+static BOOL JumpToBookmark(HWND hWnd, EditorView* view, BOOL forward) {
+    const Document* document = view->document;
+    uint64_t line = DocumentLineFromOffset(document, view->cursors.items[view->cursors.primary].caret);
+    uint32_t kinds = 1u << MARKER_KIND_BOOKMARK;
+    Marker bookmark;
+    bool found;
+    if (forward) {
+        found = (line + 1 < DocumentLineCount(document) &&
+                 MarkerTreeNext(view->markers, DocumentLineStart(document, line + 1), kinds, &bookmark)) ||
+                MarkerTreeNext(view->markers, 0, kinds, &bookmark);
+    } else {
+        found = MarkerTreePrevious(view->markers, DocumentLineStart(document, line), kinds, &bookmark) ||
+                MarkerTreePrevious(view->markers, DocumentLength(document) + 1, kinds, &bookmark);
+    }
+    if (!found) {
+        return FALSE;
+    }
+
+    uint64_t lineStart = DocumentLineStart(document, DocumentLineFromOffset(document, bookmark.start));
+    CursorSetReset(&view->cursors, lineStart, lineStart);
+    SelectionChanged(hWnd, view);
+    return TRUE;
+}
+
+/**
+ * @brief Moves the primary caret to the bracket matching the one next to it.
+ *
+ * A bracket after the caret is preferred over one before it. Without a
+ * bracket next to the caret, it moves to the closing bracket of the
+ * enclosing pair.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if the caret moved, FALSE otherwise.
+ */
+static BOOL GoToMatchingBracket(HWND hWnd, EditorView* view) {
+    if (!view->structure) {
+        return FALSE;
+    }
+
+    uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+    uint64_t match;
+    uint64_t target;
+    uint64_t open;
+    if (StructureFindMatchingBracket(view->structure, caret, &match)) {
+        target = match;
+    } else if (caret > 0 && StructureFindMatchingBracket(view->structure, caret - 1, &match)) {
+        target = match + 1;
+    } else if (StructureFindEnclosingBrackets(view->structure, caret, &open, &match)) {
+        target = match;
+    } else {
+        return FALSE;
+    }
+
+    CursorSetReset(&view->cursors, target, target);
+    SelectionChanged(hWnd, view);
+    return TRUE;
+}
+
+/**
+ * @brief Gets the screen position of a menu opened from the keyboard: just
+ *        below the primary caret.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return The position in screen coordinates.
+ */
+static POINT CaretMenuPoint(HWND hWnd, EditorView* view) {
+    uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+    uint64_t line = DocumentLineFromOffset(view->document, caret);
+    uint64_t column = LayoutColumnFromOffset(view->document, DocumentLineStart(view->document, line), caret);
+    uint64_t row = ViewRowFromLine(view, line);
+    POINT point;
+    point.x = column > view->firstColumn ? (LONG)(column - view->firstColumn) * view->charWidth : 0;
+    point.y = row > view->firstRow ? (LONG)(row - view->firstRow + 1) * view->lineHeight : view->lineHeight;
+    ClientToScreen(hWnd, &point);
+    return point;
+}
+
+/**
+ * @brief Finds the start of the identifier that ends at an offset.
+ *
+ * The search stops one byte beyond the longest indexed identifier, since
+ * longer runs have no completions.
+ *
+ * @param document The document.
+ * @param offset The offset.
+ * @return The start, or offset if no identifier byte precedes it.
+ */
+static uint64_t WordStartBefore(const Document* document, uint64_t offset) {
+    uint64_t start = offset;
+    while (start > 0 && offset - start <= WORD_INDEX_MAX_LENGTH &&
+           WordIndexIsWordByte(DocumentCharAt(document, start - 1))) {
+        start--;
+    }
+    return start;
+}
+
+/**
+ * @brief Offers the most frequent identifiers starting with the word before the primary caret.
+ *
+ * Choosing one replaces the word before every caret without a selection,
+ * and the selected text of the others.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if an identifier was inserted, FALSE otherwise.
+ */
+static BOOL CompleteWord(HWND hWnd, EditorView* view) {
+    if (view->readOnly || view->sort || !view->words || view->cursors.count == 0) {
+        return FALSE;
+    }
+
+    const Selection* primary = &view->cursors.items[view->cursors.primary];
+    uint64_t start = WordStartBefore(view->document, primary->caret);
+    char prefix[WORD_INDEX_MAX_LENGTH];
+    size_t prefixLength = (size_t)(primary->caret - start);
+    if (primary->anchor != primary->caret || prefixLength == 0 || prefixLength > WORD_INDEX_MAX_LENGTH) {
+        return FALSE;
+    }
+    DocumentRead(view->document, start, prefix, prefixLength);
+
+    WordCompletion completions[EDITOR_VIEW_MAX_COMPLETIONS];
+    size_t completionCount = WordIndexComplete(view->words, prefix, prefixLength, completions,
+                                               EDITOR_VIEW_MAX_COMPLETIONS);
+    if (completionCount == 0) {
+        return FALSE;
+    }
+
+    // Completions point into the index, which the edit below changes
+    char words[EDITOR_VIEW_MAX_COMPLETIONS][WORD_INDEX_MAX_LENGTH + 1];
+    HMENU menu = CreatePopupMenu();
+    if (!menu) {
+        return FALSE;
+    }
+    for (size_t i = 0; i < completionCount; i++) {
+        memcpy(words[i], completions[i].text, completions[i].length);
+        words[i][completions[i].length] = '\0';
+        AppendMenu(menu, MF_STRING, i + 1, words[i]);
+    }
+
+    // Menu IDs start at 1 because 0 means the menu was dismissed
+    POINT point = CaretMenuPoint(hWnd, view);
+    UINT choice = (UINT)TrackPopupMenu(menu, TPM_RETURNCMD, point.x, point.y, 0, hWnd, NULL);
+    DestroyMenu(menu);
+    if (choice < 1 || choice > completionCount) {
+        return FALSE;
+    }
+
+    for (size_t i = 0; i < view->cursors.count; i++) {
+        Selection* selection = &view->cursors.items[i];
+        if (selection->anchor == selection->caret) {
+            selection->anchor = WordStartBefore(view->document, selection->caret);
+        }
+    }
+    CursorSetNormalize(&view->cursors);
+    return InsertText(hWnd, view, words[choice - 1], strlen(words[choice - 1]));
+}
+
+/**
+ * @brief Starts sorting the selected lines, or the whole document without a selection, on a worker thread.
+ *
+ * The primary selection is extended to whole lines; a line the selection
+ * only reaches at its start is left out.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param unique TRUE to keep only the first of equal lines.
+ * @return TRUE if the sort started, FALSE otherwise.
+ */
+static BOOL StartSort(HWND hWnd, EditorView* view, BOOL unique) {
+    if (view->readOnly || view->sort || view->cursors.count == 0) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+
+    const Selection* primary = &view->cursors.items[view->cursors.primary];
+    uint64_t start = SelectionStart(primary);
+    uint64_t end = SelectionEnd(primary);
+    if (start == end) {
+        start = 0;
+        end = DocumentLength(view->document);
+    } else {
+        start = DocumentLineStart(view->document, DocumentLineFromOffset(view->document, start));
+        uint64_t endLine = DocumentLineFromOffset(view->document, end);
+        if (end > DocumentLineStart(view->document, endLine)) {
+            end = endLine + 1 < DocumentLineCount(view->document)
+                ? DocumentLineStart(view->document, endLine + 1)
+                : DocumentLength(view->document);
+        }
+    }
+    if (end <= start) {
+        return FALSE;
+    }
+
+    SortJob* job = (SortJob*)calloc(1, sizeof(SortJob));
+    if (!job || !(job->lock = ThreadLockCreate())) {
+        free(job);
+        return FALSE;
+    }
+    job->hWnd = hWnd;
+    job->document = view->document;
+    job->offset = start;
+    job->length = end - start;
+    job->percent = -1;
+    job->label = unique ? "Removing duplicate lines" : "Sorting lines";
+    job->options.unique = unique ? true : false;
+    job->options.memoryBudget = EDITOR_VIEW_SORT_BUDGET;
+    job->options.progress = SortProgress;
+    job->options.progressContext = job;
+
+    // Run files are named after a unique temporary file; without one the sort stays in memory
+    char tempDir[MAX_PATH];
+    DWORD tempLength = GetTempPath(MAX_PATH, tempDir);
+    if (tempLength > 0 && tempLength < MAX_PATH && GetTempFileName(tempDir, "pte", 0, job->tempPrefix)) {
+        job->options.tempPrefix = job->tempPrefix;
+    } else {
+        job->tempPrefix[0] = '\0';
+    }
+
+    view->sort = job;
+    NotifyProgress(hWnd, 0, job->label);
+    job->thread = ThreadStart(SortWorker, job);
+    if (!job->thread) {
+        SortWorker(job); // The result is still delivered through WM_EDITOR_SORT_DONE
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Asks the running sort of a view to stop.
+ *
+ * @param view The view.
+ * @return TRUE if a sort was running, FALSE otherwise.
+ */
+static BOOL CancelSort(EditorView* view) {
+    if (!view->sort) {
+        return FALSE;
+    }
+    ThreadLockEnter(view->sort->lock);
+    view->sort->cancel = true;
+    ThreadLockLeave(view->sort->lock);
+    return TRUE;
+}
+
+/**
+ * @brief Applies the result of a finished sort as one edit and selects the sorted lines.
+ *
+ * The sorted text is a slice of the document's own line ranges, so no
+ * bytes are copied.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if the document changed, FALSE otherwise.
+ */
+static BOOL FinishSort(HWND hWnd, EditorView* view) {
+    if (!view->sort) {
+        return FALSE;
+    }
+    ThreadLockEnter(view->sort->lock);
+    bool finished = view->sort->finished;
+    ThreadLockLeave(view->sort->lock);
+    if (!finished) {
+        return FALSE; // Left over from a sort that was cancelled
+    }
+
+    SortJob* job = EndSort(view, FALSE);
+    NotifyProgress(hWnd, -1, job->label);
+    const LineSortResult* result = &job->result;
+    BOOL applied = FALSE;
+    if (!job->succeeded) {
+        if (!result->cancelled) {
+            MessageBeep(MB_ICONERROR);
+        }
+    } else if (result->count == 1 && result->ranges[0].offset == job->offset &&
+               result->ranges[0].length == job->length) {
+        // Already sorted: nothing to undo later
+        CursorSetReset(&view->cursors, job->offset, job->offset + job->length);
+        SelectionChanged(hWnd, view);
+    } else if (result->count > 0) {
+        DocumentSlice* slice = DocumentSliceCreate(view->document, result->ranges, result->count, NULL, 0);
+        if (slice && BeginEdit(view)) {
+            DocumentEdit edit;
+            edit.offset = job->offset;
+            edit.removeLength = job->length;
+            edit.text = NULL;
+            edit.textLength = (size_t)result->length;
+            edit.slice = slice;
+            bool changed = DocumentApplyEdits(view->document, &edit, 1);
+            if (changed) {
+                CursorSetReset(&view->cursors, job->offset, job->offset + result->length);
+            }
+            applied = FinishEdit(hWnd, view, changed);
+        }
+        DocumentSliceRelease(slice);
+    }
+    ReleaseSort(job);
+    return applied;
+}
+
+/**
+ * @brief Starts or stops recording a macro and tells the parent window.
+ *
+ * Starting a recording discards the previous macro.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param recording TRUE to start recording, FALSE to stop.
+ */
+static void SetRecording(HWND hWnd, EditorView* view, BOOL recording) {
+    if (recording) {
+        MacroClear(&view->macro);
+    }
+    view->recording = recording;
+    HWND parent = GetParent(hWnd);
+    if (parent) {
+        SendMessage(parent, WM_EDITOR_MACRO_RECORDING, (WPARAM)recording, 0);
+    }
+}
+
+/**
+ * @brief Ends the recording if a step could not be added to the macro.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param recorded Result of the MacroRecord call.
+ */
+static void RecordStep(HWND hWnd, EditorView* view, bool recorded) {
+    if (!recorded) {
+        SetRecording(hWnd, view, FALSE);
+        MessageBeep(MB_ICONERROR);
+    }
+}
+
+/**
+ * @brief Inserts typed text at every caret and adds it to the macro being recorded.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param text The text.
+ * @param length Length of the text.
+ */
+static void TypeText(HWND hWnd, EditorView* view, const char* text, size_t length) {
+    if (InsertText(hWnd, view, text, length) && view->recording) {
+        RecordStep(hWnd, view, MacroRecordInsert(&view->macro, text, length));
+    }
+}
+
+/**
+ * @brief Deletes at every caret and adds the deletion to the macro being recorded.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param forward TRUE for Delete, FALSE for Backspace.
+ * @param word TRUE to delete to the word boundary (with Ctrl), FALSE for one character.
+ */
+static void DeleteText(HWND hWnd, EditorView* view, BOOL forward, BOOL word) {
+    if (!BeginEdit(view)) {
+        return;
+    }
+    bool deleted;
+    if (word) {
+        deleted = forward ? CursorSetDeleteWordForward(&view->cursors, view->document)
+                          : CursorSetDeleteWordBackward(&view->cursors, view->document);
+    } else {
+        deleted = forward ? CursorSetDeleteForward(&view->cursors, view->document)
+                          : CursorSetDeleteBackward(&view->cursors, view->document);
+    }
+    if (FinishEdit(hWnd, view, deleted) && view->recording) {
+        RecordStep(hWnd, view, word ? MacroRecordDeleteWord(&view->macro, forward ? true : false)
+                                    : MacroRecordDelete(&view->macro, forward ? true : false));
+    }
+}
+
+/**
+ * @brief Checks that the macro of a view can be played.
+ *
+ * @param view The view.
+ * @return TRUE if there is a macro, no recording and the document may be edited.
+ */
+static BOOL CanPlayMacro(EditorView* view) {
+    if (view->recording || MacroIsEmpty(&view->macro) || view->readOnly || view->sort) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Plays the macro at the carets as one undo step.
+ *
+ * Every step is still an edit batch that moves the carets, folds and
+ * indexes, but the scroll bars, spelling and repaint are done once.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param count Number of times to play, or MACRO_UNTIL_END.
+ * @return TRUE if the macro played, FALSE otherwise.
+ */
+static BOOL PlayMacro(HWND hWnd, EditorView* view, uint64_t count) {
+    if (!CanPlayMacro(view) || !BeginEdit(view)) {
+        return FALSE;
+    }
+    view->replaying = TRUE;
+    bool played = MacroRun(&view->macro, &view->cursors, view->document, count, PageLines(view), NULL);
+    view->replaying = FALSE;
+
+    // Carets left on folded lines open their folds when they scroll into view
+    UpdateScrollBars(hWnd, view);
+    ScheduleSpelling(view);
+    FinishEdit(hWnd, view, true);
+    if (!played) {
+        MessageBeep(MB_ICONERROR);
+    }
+    return played ? TRUE : FALSE;
+}
+
+/**
+ * @brief Plays the macro once on each of a set of lines as one edit.
+ *
+ * With matches, the target lines are those containing the text of the
+ * primary selection, which must lie within one line. Otherwise they are
+ * the lines of the primary selection, or every line without a selection.
+ * Macros that move the caret up or down cannot be played this way.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param matches TRUE to play on the lines containing the selected text.
+ * @return TRUE if the document changed, FALSE otherwise.
+ */
+static BOOL PlayMacroOnLines(HWND hWnd, EditorView* view, BOOL matches) {
+    if (!CanPlayMacro(view) || view->cursors.count == 0) {
+        return FALSE;
+    }
+    if (!MacroIsLineLocal(&view->macro)) {
+        MessageBeep(MB_ICONERROR);
+        return FALSE;
+    }
+
+    const Selection* primary = &view->cursors.items[view->cursors.primary];
+    uint64_t start = SelectionStart(primary);
+    uint64_t end = SelectionEnd(primary);
+    uint64_t firstLine = 0;
+    uint64_t lastLine = DocumentLineCount(view->document) - 1;
+    char* pattern = NULL;
+    if (matches) {
+        uint64_t line = DocumentLineFromOffset(view->document, start);
+        if (end == start || end > DocumentLineEnd(view->document, line)) {
+            MessageBeep(MB_OK);
+            return FALSE;
+        }
+        pattern = DocumentCopyRange(view->document, start, end - start);
+        if (!pattern) {
+            return FALSE;
+        }
+    } else if (end > start) {
+        firstLine = DocumentLineFromOffset(view->document, start);
+        lastLine = DocumentLineFromOffset(view->document, end);
+        if (lastLine > firstLine && end == DocumentLineStart(view->document, lastLine)) {
+            lastLine--;
+        }
+    }
+
+    // The carets follow the single batch through the change notification
+    uint64_t changed = 0;
+    bool played = MacroRunOnLines(&view->macro, view->document, NULL, firstLine, lastLine, pattern,
+                                  pattern ? (size_t)(end - start) : 0, true, &changed);
+    free(pattern);
+    if (!played) {
+        MessageBeep(MB_ICONERROR);
+        return FALSE;
+    }
+    SelectionChanged(hWnd, view);
+    return changed > 0 ? TRUE : FALSE;
+}
+
+/**
+ * @brief Scrolls the view so that the line of the primary caret is in the middle.
+ *
+ * Used when the rows of the view change completely, so the caret line is
+ * shown with the lines around it. A fold hiding the caret is opened.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void CenterPrimaryLine(HWND hWnd, EditorView* view) {
+    uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+    uint64_t line = DocumentLineFromOffset(view->document, caret);
+    if (!view->filter) {
+        FoldSetRevealLine(&view->folds, view->document, line);
+    }
+    uint64_t row = ViewRowFromLine(view, line);
+    uint64_t half = view->visibleLines > 1 ? (uint64_t)view->visibleLines / 2 : 0;
+    view->firstRow = row > half ? row - half : 0;
+    UpdateScrollBars(hWnd, view);
+    ScheduleSpelling(view);
+    SelectionChanged(hWnd, view);
+}
+
+/**
+ * @brief Shows only the lines containing the text of the primary selection.
+ *
+ * The selected text must lie within one line. The lines are found by one
+ * scan of the document, split across threads while the file is unmodified,
+ * and the filter then follows every edit.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if the view is filtered, FALSE otherwise.
+ */
+static BOOL FilterLines(HWND hWnd, EditorView* view) {
+    if (view->cursors.count == 0) {
+        return FALSE;
+    }
+    const Selection* primary = &view->cursors.items[view->cursors.primary];
+    uint64_t start = SelectionStart(primary);
+    uint64_t end = SelectionEnd(primary);
+    uint64_t line = DocumentLineFromOffset(view->document, start);
+    if (end == start || end > DocumentLineEnd(view->document, line) || end - start > SEARCH_MAX_PATTERN) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    char* pattern = DocumentCopyRange(view->document, start, end - start);
+    if (!pattern) {
+        return FALSE;
+    }
+
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    LineFilter* filter = LineFilterCreate(view->document, pattern, (size_t)(end - start), true, 0);
+    SetCursor(oldCursor);
+    free(pattern);
+    if (!filter) {
+        MessageBeep(MB_ICONERROR);
+        return FALSE;
+    }
+    LineFilterDestroy(view->filter);
+    view->filter = filter;
+    CenterPrimaryLine(hWnd, view);
+    return TRUE;
+}
+
+/**
+ * @brief Moves the caret to the first line stamped at or after the selected time.
+ *
+ * The selection holds a timestamp in any format the index knows, a date,
+ * or a time of day, which is taken on the day of the caret line.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @return TRUE if the caret moved, FALSE otherwise.
+ */
+static BOOL GoToTime(HWND hWnd, EditorView* view) {
+    if (view->cursors.count == 0 || !view->times) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    const Selection* primary = &view->cursors.items[view->cursors.primary];
+    uint64_t start = SelectionStart(primary);
+    uint64_t end = SelectionEnd(primary);
+    uint64_t line = DocumentLineFromOffset(view->document, start);
+    if (end == start || end > DocumentLineEnd(view->document, line) || end - start > 64) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    char text[64];
+    size_t length = DocumentRead(view->document, start, text, (size_t)(end - start));
+
+    int64_t reference = 0;
+    int64_t time;
+    TimeIndexLineTime(view->times, line, &reference);
+    if (!TimeIndexParseTime(text, length, reference, &time)) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    uint64_t lineStart = DocumentLineStart(view->document, TimeIndexFindLine(view->times, time));
+    CursorSetReset(&view->cursors, lineStart, lineStart);
+    CenterPrimaryLine(hWnd, view);
+    return TRUE;
+}
+
+/**
+ * @brief Applies one stage of the format pass to the whole document as one undoable edit.
+ *
+ * Only the changed bytes are edited; the carets move with the text.
+ *
+ * @param view The view.
+ * @param stage The TEXT_FORMAT_ stage.
+ * @return TRUE if the document changed, FALSE otherwise.
+ */
+static BOOL FormatDocument(EditorView* view, unsigned stage) {
+    if (view->readOnly || view->sort) {
+        MessageBeep(MB_OK);
+        return FALSE;
+    }
+    TextFormatOptions options = { stage, LAYOUT_TAB_WIDTH, 0 };
+    size_t changeCount = 0;
+    if (!TextFormatDocument(view->document, &options, &changeCount)) {
+        MessageBeep(MB_ICONERROR);
+        return FALSE;
+    }
+    return changeCount > 0 ? TRUE : FALSE;
+}
+
+/**
+ * @brief Moves the carets up or down by rows of the filtered view.
+ *
+ * Vertical movement of the document would stop on the lines between the
+ * matches, so the carets move from match to match, keeping their column.
+ *
+ * @param view The view.
+ * @param movement CURSOR_MOVE_UP, CURSOR_MOVE_DOWN, CURSOR_MOVE_PAGE_UP or CURSOR_MOVE_PAGE_DOWN.
+ * @param extend TRUE to extend the selections instead of moving the anchors.
+ */
+static void MoveFilteredRows(EditorView* view, CursorMovement movement, BOOL extend) {
+    uint64_t rowCount = ViewRowCount(view);
+    uint64_t rows = movement == CURSOR_MOVE_UP || movement == CURSOR_MOVE_DOWN ? 1 : PageLines(view);
+    BOOL down = movement == CURSOR_MOVE_DOWN || movement == CURSOR_MOVE_PAGE_DOWN;
+    for (size_t i = 0; i < view->cursors.count; i++) {
+        Selection* selection = &view->cursors.items[i];
+        uint64_t line = DocumentLineFromOffset(view->document, selection->caret);
+        if (selection->preferredColumn == CURSOR_NO_COLUMN) {
+            selection->preferredColumn =
+                LayoutColumnFromOffset(view->document, DocumentLineStart(view->document, line), selection->caret);
+        }
+
+        // A caret between matches counts as being on the row above it, or before row 0
+        uint64_t row = ViewRowFromLine(view, line);
+        uint64_t shown = ViewLineFromRow(view, row);
+        uint64_t target;
+        if (down) {
+            target = shown > line ? row + rows - 1 : row + rows;
+            if (target >= rowCount) {
+                target = rowCount - 1;
+            }
+        } else if (shown < line) {
+            target = row + 1 > rows ? row + 1 - rows : 0;
+        } else {
+            target = row > rows ? row - rows : 0;
+        }
+
+        line = ViewLineFromRow(view, target);
+        selection->caret = LayoutOffsetFromColumn(view->document, DocumentLineStart(view->document, line),
+                                                  DocumentLineEnd(view->document, line), selection->preferredColumn);
+        if (!extend) {
+            selection->anchor = selection->caret;
+        }
+    }
+    CursorSetNormalize(&view->cursors);
+}
+
+/**
+ * @brief Executes an editing command on a view.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param command The command.
+ * @return TRUE if the document or the selection changed, FALSE otherwise.
+ */
+static BOOL RunCommand(HWND hWnd, EditorView* view, EditorCommand command) {
+    switch (command) {
+        case EDITOR_COMMAND_UNDO:
+        case EDITOR_COMMAND_REDO: {
+            size_t changeCount = 0;
+            if (!BeginEdit(view)) {
+                return FALSE;
+            }
+            const DocumentChange* changes = command == EDITOR_COMMAND_UNDO
+                ? DocumentUndo(view->document, &changeCount)
+                : DocumentRedo(view->document, &changeCount);
+            if (changes) {
+                CursorSetPlaceAfterChanges(&view->cursors, changes, changeCount);
+            }
+            return FinishEdit(hWnd, view, changes != NULL);
+        }
+
+        case EDITOR_COMMAND_CUT:
+            if (view->readOnly) {
+                return CopySelections(hWnd, view);
+            }
+            if (!CopySelections(hWnd, view)) {
+                return FALSE;
+            }
+            return InsertText(hWnd, view, NULL, 0);
+
+        case EDITOR_COMMAND_COPY:
+            return CopySelections(hWnd, view);
+
+        case EDITOR_COMMAND_PASTE:
+            return PasteClipboard(hWnd, view);
+
+        case EDITOR_COMMAND_SELECT_ALL:
+            CursorSetReset(&view->cursors, 0, DocumentLength(view->document));
+            SelectionChanged(hWnd, view);
+            return TRUE;
+
+        case EDITOR_COMMAND_ADD_CURSOR_ABOVE:
+        case EDITOR_COMMAND_ADD_CURSOR_BELOW:
+            if (!CursorSetAddVertical(&view->cursors, view->document, command == EDITOR_COMMAND_ADD_CURSOR_BELOW)) {
+                return FALSE;
+            }
+            SelectionChanged(hWnd, view);
+            return TRUE;
+
+        case EDITOR_COMMAND_ADD_NEXT_OCCURRENCE:
+            if (!CursorSetAddNextOccurrence(&view->cursors, view->document)) {
+                return FALSE;
+            }
+            SelectionChanged(hWnd, view);
+            return TRUE;
+
+        case EDITOR_COMMAND_SELECT_ALL_OCCURRENCES:
+            if (!CursorSetSelectAllOccurrences(&view->cursors, view->document)) {
+                return FALSE;
+            }
+            SelectionChanged(hWnd, view);
+            return TRUE;
+
+        case EDITOR_COMMAND_TOGGLE_FOLD:
+            return ToggleFold(hWnd, view);
+
+        case EDITOR_COMMAND_UNFOLD_ALL:
+            if (view->folds.count == 0) {
+                return FALSE;
+            }
+            FoldSetClear(&view->folds);
+            UpdateScrollBars(hWnd, view);
+            SelectionChanged(hWnd, view);
+            return TRUE;
+
+        case EDITOR_COMMAND_NEXT_FOLD:
+        case EDITOR_COMMAND_PREVIOUS_FOLD:
+            return JumpToFold(hWnd, view, command == EDITOR_COMMAND_NEXT_FOLD);
+
+        case EDITOR_COMMAND_MATCH_BRACKET:
+            return GoToMatchingBracket(hWnd, view);
+
+        case EDITOR_COMMAND_TOGGLE_BOOKMARK: {
+            if (!view->markers) {
+                return FALSE;
+            }
+            uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+            MarkerTreeToggleLine(view->markers, DocumentLineFromOffset(view->document, caret), MARKER_KIND_BOOKMARK);
+            InvalidateRect(hWnd, NULL, FALSE);
+            return TRUE;
+        }
+
+        case EDITOR_COMMAND_NEXT_BOOKMARK:
+        case EDITOR_COMMAND_PREVIOUS_BOOKMARK:
+            return JumpToBookmark(hWnd, view, command == EDITOR_COMMAND_NEXT_BOOKMARK);
+
+        case EDITOR_COMMAND_CLEAR_BOOKMARKS:
+            if (MarkerTreeRemoveKinds(view->markers, 1u << MARKER_KIND_BOOKMARK) == 0) {
+                return FALSE;
+            }
+            InvalidateRect(hWnd, NULL, FALSE);
+            return TRUE;
+
+        case EDITOR_COMMAND_COMPLETE_WORD:
+            return CompleteWord(hWnd, view);
+
+        case EDITOR_COMMAND_SORT_LINES:
+        case EDITOR_COMMAND_UNIQUE_LINES:
+            return StartSort(hWnd, view, command == EDITOR_COMMAND_UNIQUE_LINES);
+
+        case EDITOR_COMMAND_CANCEL_SORT:
+            return CancelSort(view);
+
+        case EDITOR_COMMAND_RECORD_MACRO:
+            SetRecording(hWnd, view, !view->recording);
+            return TRUE;
+
+        case EDITOR_COMMAND_PLAY_MACRO:
+        case EDITOR_COMMAND_PLAY_MACRO_TO_END:
+            return PlayMacro(hWnd, view, command == EDITOR_COMMAND_PLAY_MACRO ? 1 : MACRO_UNTIL_END);
+
+        case EDITOR_COMMAND_PLAY_MACRO_ON_LINES:
+        case EDITOR_COMMAND_PLAY_MACRO_ON_MATCHES:
+            return PlayMacroOnLines(hWnd, view, command == EDITOR_COMMAND_PLAY_MACRO_ON_MATCHES);
+
+        case EDITOR_COMMAND_FILTER_LINES:
+            return FilterLines(hWnd, view);
+
+        case EDITOR_COMMAND_SHOW_ALL_LINES:
+            if (!view->filter) {
+                return FALSE;
+            }
+            LineFilterDestroy(view->filter);
+            view->filter = NULL;
+            CenterPrimaryLine(hWnd, view);
+            return TRUE;
+
+        case EDITOR_COMMAND_GO_TO_TIME:
+            return GoToTime(hWnd, view);
+
+        case EDITOR_COMMAND_TRIM_TRAILING_WHITESPACE:
+            return FormatDocument(view, TEXT_FORMAT_TRIM_TRAILING);
+
+        case EDITOR_COMMAND_EXPAND_TABS:
+            return FormatDocument(view, TEXT_FORMAT_EXPAND_TABS);
+
+        case EDITOR_COMMAND_ADD_FINAL_NEWLINE:
+            return FormatDocument(view, TEXT_FORMAT_FINAL_NEWLINE);
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Handles navigation and shortcut keys.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param key The virtual key code.
+ * @return TRUE if the key was handled, FALSE otherwise.
+ */
+static BOOL HandleKeyDown(HWND hWnd, EditorView* view, WPARAM key) {
+    BOOL control = GetKeyState(VK_CONTROL) < 0;
+    BOOL shift = GetKeyState(VK_SHIFT) < 0;
+    BOOL alt = GetKeyState(VK_MENU) < 0;
+    CursorMovement movement;
+
+    switch (key) {
+        case VK_LEFT:
+            movement = control ? CURSOR_MOVE_WORD_LEFT : CURSOR_MOVE_LEFT;
+            break;
+        case VK_RIGHT:
+            movement = control ? CURSOR_MOVE_WORD_RIGHT : CURSOR_MOVE_RIGHT;
+            break;
+        case VK_UP:
+        case VK_DOWN:
+            if (control && alt) {
+                RunCommand(hWnd, view, key == VK_UP ? EDITOR_COMMAND_ADD_CURSOR_ABOVE : EDITOR_COMMAND_ADD_CURSOR_BELOW);
+                return TRUE;
+            }
+            if (control) {
+                // Ctrl+Up/Down scroll without moving the carets
+                uint64_t firstRow = view->firstRow;
+                if (key == VK_UP) {
+                    firstRow = firstRow > 0 ? firstRow - 1 : 0;
+                } else {
+                    firstRow++;
+                }
+                ScrollViewTo(hWnd, view, firstRow, view->firstColumn);
+                return TRUE;
+            }
+            if (alt) {
+                RunCommand(hWnd, view, key == VK_UP ? EDITOR_COMMAND_PREVIOUS_FOLD : EDITOR_COMMAND_NEXT_FOLD);
+                return TRUE;
+            }
+            movement = key == VK_UP ? CURSOR_MOVE_UP : CURSOR_MOVE_DOWN;
+            break;
+        case VK_HOME:
+            movement = control ? CURSOR_MOVE_DOCUMENT_START : CURSOR_MOVE_LINE_START;
+            break;
+        case VK_END:
+            movement = control ? CURSOR_MOVE_DOCUMENT_END : CURSOR_MOVE_LINE_END;
+            break;
+        case VK_PRIOR:
+            movement = CURSOR_MOVE_PAGE_UP;
+            break;
+        case VK_NEXT:
+            movement = CURSOR_MOVE_PAGE_DOWN;
+            break;
+        case VK_DELETE:
+            DeleteText(hWnd, view, TRUE, control);
+            return TRUE;
+        case VK_F2:
+            if (control) {
+                RunCommand(hWnd, view, EDITOR_COMMAND_TOGGLE_BOOKMARK);
+            } else {
+                RunCommand(hWnd, view, shift ? EDITOR_COMMAND_PREVIOUS_BOOKMARK : EDITOR_COMMAND_NEXT_BOOKMARK);
+            }
+            return TRUE;
+        case VK_ESCAPE:
+            if (RunCommand(hWnd, view, EDITOR_COMMAND_CANCEL_SORT) ||
+                RunCommand(hWnd, view, EDITOR_COMMAND_SHOW_ALL_LINES)) {
+                return TRUE;
+            }
+            if (view->cursors.count > 1) {
+                uint64_t caret = view->cursors.items[view->cursors.primary].caret;
+                CursorSetReset(&view->cursors, caret, caret);
+                SelectionChanged(hWnd, view);
+            }
+            return TRUE;
+        default:
+            if (!control) {
+                return FALSE;
+            }
+            switch (key) {
+                case VK_SPACE: RunCommand(hWnd, view, EDITOR_COMMAND_COMPLETE_WORD); return TRUE;
+                case 'A': RunCommand(hWnd, view, EDITOR_COMMAND_SELECT_ALL); return TRUE;
+                case 'C': RunCommand(hWnd, view, EDITOR_COMMAND_COPY); return TRUE;
+                case 'D': RunCommand(hWnd, view, EDITOR_COMMAND_ADD_NEXT_OCCURRENCE); return TRUE;
+                case 'V': RunCommand(hWnd, view, EDITOR_COMMAND_PASTE); return TRUE;
+                case 'X': RunCommand(hWnd, view, EDITOR_COMMAND_CUT); return TRUE;
+                case 'Y': RunCommand(hWnd, view, EDITOR_COMMAND_REDO); return TRUE;
+                case 'Z': RunCommand(hWnd, view, EDITOR_COMMAND_UNDO); return TRUE;
+                case 'L':
+                    if (shift) {
+                        RunCommand(hWnd, view, EDITOR_COMMAND_SELECT_ALL_OCCURRENCES);
+                        return TRUE;
+                    }
+                    return FALSE;
+                case 'P':
+                    if (shift) {
+                        RunCommand(hWnd, view, EDITOR_COMMAND_PLAY_MACRO);
+                        return TRUE;
+                    }
+                    return FALSE;
+                case 'R':
+                    if (shift) {
+                        RunCommand(hWnd, view, EDITOR_COMMAND_RECORD_MACRO);
+                        return TRUE;
+                    }
+                    return FALSE;
+                case VK_OEM_4: // [
+                    if (shift) {
+                        RunCommand(hWnd, view, EDITOR_COMMAND_TOGGLE_FOLD);
+                        return TRUE;
+                    }
+                    return FALSE;
+                case VK_OEM_6: // ]
+                    RunCommand(hWnd, view, shift ? EDITOR_COMMAND_UNFOLD_ALL : EDITOR_COMMAND_MATCH_BRACKET);
+                    return TRUE;
+                default:
+                    return FALSE;
+            }
+    }
+
+    BOOL vertical = movement == CURSOR_MOVE_UP || movement == CURSOR_MOVE_DOWN;
+    if (view->filter && (vertical || movement == CURSOR_MOVE_PAGE_UP || movement == CURSOR_MOVE_PAGE_DOWN)) {
+        MoveFilteredRows(view, movement, shift);
+    } else {
+        CursorSetMove(&view->cursors, view->document, movement, shift ? true : false, PageLines(view));
+        if (vertical) {
+            SkipHiddenLines(view, movement == CURSOR_MOVE_DOWN);
+        }
+    }
+    if (movement == CURSOR_MOVE_PAGE_UP || movement == CURSOR_MOVE_PAGE_DOWN) {
+        // Keep the carets at the same row of the screen
+        uint64_t page = PageLines(view);
+        uint64_t firstRow = view->firstRow;
+        if (movement == CURSOR_MOVE_PAGE_UP) {
+            firstRow = firstRow > page ? firstRow - page : 0;
+        } else {
+            firstRow += page;
+        }
+        ScrollViewTo(hWnd, view, firstRow, view->firstColumn);
+    }
+    SelectionChanged(hWnd, view);
+    if (view->recording) {
+        RecordStep(hWnd, view, MacroRecordMove(&view->macro, movement, shift ? true : false));
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Handles typed characters.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param character The character code.
+ */
+static void HandleChar(HWND hWnd, EditorView* view, WPARAM character) {
+    switch (character) {
+        case '\b':
+            DeleteText(hWnd, view, FALSE, FALSE);
+            return;
+        case 0x7F:
+            // Ctrl+Backspace
+            DeleteText(hWnd, view, FALSE, TRUE);
+            return;
+        case '\r': {
+            const char* terminator = DocumentLineTerminator(view->document);
+            TypeText(hWnd, view, terminator, strlen(terminator));
+            return;
+        }
+        case '\t':
+            TypeText(hWnd, view, "\t", 1);
+            return;
+        default:
+            // Control characters are produced by Ctrl shortcuts handled in WM_KEYDOWN
+            if (character < 0x20 || character == 0x7F) {
+                return;
+            }
+            // Ctrl+Space opens word completion
+            if (character == ' ' && GetKeyState(VK_CONTROL) < 0) {
+                return;
+            }
+            char text = (char)character;
+            TypeText(hWnd, view, &text, 1);
+            return;
+    }
+}
+
+/**
+ * @brief Offers suggestions for the misspelled word under the mouse or the primary caret.
+ *
+ * Choosing a suggestion replaces the word.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param lParam Screen position of the click, or -1 if the menu was opened from the keyboard.
+ * @return TRUE if a menu was shown, FALSE if there is no misspelled word there.
+ */
+static BOOL ShowSpellingMenu(HWND hWnd, EditorView* view, LPARAM lParam) {
+    if (!view->spelling || view->cursors.count == 0) {
+        return FALSE;
+    }
+
+    POINT point;
+    uint64_t offset;
+    if (lParam == -1) {
+        offset = view->cursors.items[view->cursors.primary].caret;
+        point = CaretMenuPoint(hWnd, view);
+    } else {
+        point.x = GET_X_LPARAM(lParam);
+        point.y = GET_Y_LPARAM(lParam);
+        POINT client = point;
+        ScreenToClient(hWnd, &client);
+        offset = OffsetFromPoint(view, client.x, client.y);
+    }
+
+    size_t count;
+    const SpellRange* ranges = SpellCheckerRanges(view->spelling, &count);
+    size_t index = SpellCheckerFindFirst(view->spelling, offset);
+    if (index == count || ranges[index].offset > offset) {
+        return FALSE;
+    }
+    SpellRange range = ranges[index];
+    char word[SPELL_MAX_WORD + 1];
+    size_t length = DocumentRead(view->document, range.offset, word, range.length);
+    word[length] = '\0';
+
+    char suggestions[EDITOR_VIEW_MAX_SUGGESTIONS][SPELL_MAX_WORD + 1];
+    size_t suggestionCount = SpellDictSuggest(view->dictionary, word, length, suggestions,
+                                              EDITOR_VIEW_MAX_SUGGESTIONS);
+    HMENU menu = CreatePopupMenu();
+    if (!menu) {
+        return FALSE;
+    }
+    for (size_t i = 0; i < suggestionCount; i++) {
+        AppendMenu(menu, MF_STRING | (view->readOnly ? MF_GRAYED : 0), i + 1, suggestions[i]);
+    }
+    if (suggestionCount == 0) {
+        AppendMenu(menu, MF_STRING | MF_GRAYED, 0, "(No Suggestions)");
+    }
+
+    // Menu IDs start at 1 because 0 means the menu was dismissed
+    UINT choice = (UINT)TrackPopupMenu(menu, TPM_RETURNCMD | TPM_RIGHTBUTTON, point.x, point.y, 0, hWnd, NULL);
+    DestroyMenu(menu);
+    if (choice >= 1 && choice <= suggestionCount) {
+        CursorSetReset(&view->cursors, range.offset, range.offset + range.length);
+        InsertText(hWnd, view, suggestions[choice - 1], strlen(suggestions[choice - 1]));
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Handles a press of the left mouse button.
+ *
+ * Click places the caret, Shift+click extends the primary selection and
+ * Alt+click adds a caret.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param lParam Mouse position.
+ */
+static void HandleMouseDown(HWND hWnd, EditorView* view, LPARAM lParam) {
+    SetFocus(hWnd);
+    SetCapture(hWnd);
+    view->selecting = TRUE;
+
+    uint64_t offset = OffsetFromPoint(view, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+    if (GetKeyState(VK_MENU) < 0) {
+        CursorSetAdd(&view->cursors, offset, offset);
+    } else if (GetKeyState(VK_SHIFT) < 0) {
+        uint64_t anchor = view->cursors.items[view->cursors.primary].anchor;
+        CursorSetReset(&view->cursors, anchor, offset);
+    } else {
+        CursorSetReset(&view->cursors, offset, offset);
+    }
+    SelectionChanged(hWnd, view);
+}
+
+/**
+ * @brief Extends the primary selection while the left mouse button is held.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param lParam Mouse position.
+ */
+static void HandleMouseDrag(HWND hWnd, EditorView* view, LPARAM lParam) {
+    uint64_t offset = OffsetFromPoint(view, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+    Selection* primary = &view->cursors.items[view->cursors.primary];
+    if (primary->caret == offset) {
+        return;
+    }
+    primary->caret = offset;
+    primary->preferredColumn = CURSOR_NO_COLUMN;
+    CursorSetNormalize(&view->cursors);
+    SelectionChanged(hWnd, view);
+}
+
+/**
+ * @brief Handles a scroll bar notification.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param bar SB_VERT or SB_HORZ.
+ * @param request The scroll request (LOWORD of wParam).
+ */
+static void HandleScroll(HWND hWnd, EditorView* view, int bar, int request) {
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_ALL;
+    GetScrollInfo(hWnd, bar, &si);
+
+    int64_t position = bar == SB_VERT ? (int64_t)view->firstRow : (int64_t)view->firstColumn;
+    int64_t page = si.nPage > 1 ? (int64_t)si.nPage - 1 : 1;
+    switch (request) {
+        case SB_LINEUP:        position -= 1; break;
+        case SB_LINEDOWN:      position += 1; break;
+        case SB_PAGEUP:        position -= page; break;
+        case SB_PAGEDOWN:      position += page; break;
+        case SB_THUMBTRACK:
+        case SB_THUMBPOSITION: position = si.nTrackPos; break;
+        case SB_TOP:           position = 0; break;
+        case SB_BOTTOM:        position = si.nMax; break;
+        default:               return;
+    }
+    if (position < 0) {
+        position = 0;
+    }
+
+    if (bar == SB_VERT) {
+        ScrollViewTo(hWnd, view, (uint64_t)position, view->firstColumn);
+    } else {
+        ScrollViewTo(hWnd, view, view->firstRow, (uint64_t)position);
+    }
+}
+
+/**
+ * @brief Draws the selection background of one row.
+ *
+ * @param hdc Device context.
+ * @param view The view.
+ * @param brush Selection brush.
+ * @param lineStart Start of the line.
+ * @param visibleEnd Offset past the last visible column of the line.
+ * @param y Top of the row.
+ */
+static void PaintRowSelections(HDC hdc, const EditorView* view, HBRUSH brush, uint64_t lineStart,
+                               uint64_t visibleEnd, int y) {
+    const CursorSet* cursors = &view->cursors;
+    for (size_t i = CursorSetFindFirst(cursors, lineStart); i < cursors->count; i++) {
+        const Selection* selection = &cursors->items[i];
+        uint64_t start = SelectionStart(selection);
+        uint64_t end = SelectionEnd(selection);
+        if (start > visibleEnd) {
+            break;
+        }
+        if (start == end || end < lineStart) {
+            continue;
+        }
+
+        // Columns right of the view are not measured
+        uint64_t from = start > lineStart ? start : lineStart;
+        uint64_t startColumn = LayoutColumnFromOffset(view->document, lineStart, from);
+        uint64_t endColumn = LayoutColumnFromOffset(view->document, lineStart, end < visibleEnd ? end : visibleEnd);
+        if (end > visibleEnd) {
+            endColumn++; // Show the selected line break, or the cut off text, as one more cell
+        }
+        if (endColumn <= view->firstColumn) {
+            continue;
+        }
+        startColumn = startColumn > view->firstColumn ? startColumn - view->firstColumn : 0;
+        endColumn -= view->firstColumn;
+
+        RECT rect;
+        rect.left = (LONG)(startColumn > EDITOR_VIEW_MAX_COLUMNS ? EDITOR_VIEW_MAX_COLUMNS : startColumn) * view->charWidth;
+        rect.right = (LONG)(endColumn > EDITOR_VIEW_MAX_COLUMNS ? EDITOR_VIEW_MAX_COLUMNS : endColumn) * view->charWidth;
+        rect.top = y;
+        rect.bottom = y + view->lineHeight;
+        FillRect(hdc, &rect, brush);
+    }
+}
+
+/**
+ * @brief Draws the carets of one row.
+ *
+ * @param hdc Device context.
+ * @param view The view.
+ * @param lineStart Start of the line.
+ * @param visibleEnd Offset past the last visible column of the line.
+ * @param y Top of the row.
+ */
+static void PaintRowCarets(HDC hdc, const EditorView* view, uint64_t lineStart, uint64_t visibleEnd, int y) {
+    const CursorSet* cursors = &view->cursors;
+    for (size_t i = CursorSetFindFirst(cursors, lineStart); i < cursors->count; i++) {
+        const Selection* selection = &cursors->items[i];
+        if (SelectionStart(selection) > visibleEnd) {
+            break;
+        }
+        if (selection->caret < lineStart || selection->caret > visibleEnd) {
+            continue;
+        }
+        uint64_t column = LayoutColumnFromOffset(view->document, lineStart, selection->caret);
+        if (column < view->firstColumn || column - view->firstColumn > EDITOR_VIEW_MAX_COLUMNS) {
+            continue;
+        }
+        int x = (int)(column - view->firstColumn) * view->charWidth;
+        PatBlt(hdc, x, y, EDITOR_VIEW_CARET_WIDTH, view->lineHeight, DSTINVERT);
+    }
+}
+
+/**
+ * @brief Draws the marker after the header line of a fold.
+ *
+ * @param hdc Device context.
+ * @param view The view.
+ * @param lineStart Start of the header line.
+ * @param lineEnd End of the header line content.
+ * @param visibleEnd Offset past the last visible column of the line.
+ * @param y Top of the row.
+ */
+static void PaintFoldMarker(HDC hdc, const EditorView* view, uint64_t lineStart, uint64_t lineEnd,
+                            uint64_t visibleEnd, int y) {
+    if (lineEnd > visibleEnd) {
+        return;
+    }
+    uint64_t column = LayoutColumnFromOffset(view->document, lineStart, lineEnd);
+    if (column < view->firstColumn || column - view->firstColumn > EDITOR_VIEW_MAX_COLUMNS) {
+        return;
+    }
+    COLORREF oldColor = SetTextColor(hdc, EDITOR_VIEW_FOLD_MARKER_COLOR);
+    TextOut(hdc, (int)(column - view->firstColumn) * view->charWidth, y, EDITOR_VIEW_FOLD_MARKER,
+            (int)strlen(EDITOR_VIEW_FOLD_MARKER));
+    SetTextColor(hdc, oldColor);
+}
+
+/**
+ * @brief Underlines the misspelled words of one row with a zigzag.
+ *
+ * @param hdc Device context with the underline pen selected.
+ * @param view The view.
+ * @param lineStart Start of the line.
+ * @param visibleEnd Offset past the last visible column of the line.
+ * @param y Top of the row.
+ */
+static void PaintRowSpelling(HDC hdc, const EditorView* view, uint64_t lineStart, uint64_t visibleEnd, int y) {
+    size_t count;
+    const SpellRange* ranges = SpellCheckerRanges(view->spelling, &count);
+    int bottom = y + view->lineHeight - 1;
+
+    // Words left or right of the view are skipped without being laid out
+    uint64_t visibleStart = view->firstColumn > 0 ? LayoutOffsetFromColumn(view->document, lineStart, visibleEnd,
+                                                                           view->firstColumn)
+                                                  : lineStart;
+    for (size_t i = SpellCheckerFindFirst(view->spelling, visibleStart); i < count && ranges[i].offset < visibleEnd;
+         i++) {
+        uint64_t end = ranges[i].offset + ranges[i].length;
+        uint64_t startColumn = LayoutColumnFromOffset(view->document, lineStart, ranges[i].offset);
+        uint64_t endColumn = LayoutColumnFromOffset(view->document, lineStart, end < visibleEnd ? end : visibleEnd);
+        if (endColumn <= view->firstColumn) {
+            continue;
+        }
+        startColumn = startColumn > view->firstColumn ? startColumn - view->firstColumn : 0;
+        endColumn -= view->firstColumn;
+        if (startColumn >= EDITOR_VIEW_MAX_COLUMNS) {
+            break;
+        }
+        if (endColumn > EDITOR_VIEW_MAX_COLUMNS) {
+            endColumn = EDITOR_VIEW_MAX_COLUMNS;
+        }
+
+        // Drawn in batches of points, each batch starting where the last one ended
+        POINT points[64];
+        int pointCount = 0;
+        int left = (int)startColumn * view->charWidth;
+        int right = (int)endColumn * view->charWidth;
+        for (int x = left; x <= right; x += EDITOR_VIEW_SPELLING_STEP) {
+            points[pointCount].x = x;
+            points[pointCount].y = bottom - ((x - left) / EDITOR_VIEW_SPELLING_STEP % 2) * EDITOR_VIEW_SPELLING_STEP;
+            pointCount++;
+            if (pointCount == (int)(sizeof(points) / sizeof(points[0]))) {
+                Polyline(hdc, points, pointCount);
+                points[0] = points[pointCount - 1];
+                pointCount = 1;
+            }
+        }
+        if (pointCount > 1) {
+            Polyline(hdc, points, pointCount);
+        }
+    }
+}
+
+/**
+ * @brief Stops a marker query at the first marker.
+ *
+ * @param marker The marker.
+ * @param context Unused.
+ * @return false.
+ */
+static bool StopAtFirst(const Marker* marker, void* context) {
+    (void)marker;
+    (void)context;
+    return false;
+}
+
+/**
+ * @brief Paints the rows of the view that intersect the update region.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void PaintView(HWND hWnd, EditorView* view) {
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hWnd, &ps);
+    if (!hdc) {
+        return;
+    }
+
+    RECT client;
+    GetClientRect(hWnd, &client);
+    HFONT oldFont = (HFONT)SelectObject(hdc, view->font);
+    HBRUSH background = GetSysColorBrush(COLOR_WINDOW);
+    HBRUSH selectionBrush = CreateSolidBrush(EDITOR_VIEW_SELECTION_COLOR);
+    HBRUSH bookmarkBrush = CreateSolidBrush(EDITOR_VIEW_BOOKMARK_COLOR);
+    HPEN spellingPen = view->spelling ? CreatePen(PS_SOLID, 1, EDITOR_VIEW_SPELLING_COLOR) : NULL;
+    HPEN oldPen = spellingPen ? (HPEN)SelectObject(hdc, spellingPen) : NULL;
+    SetTextColor(hdc, GetSysColor(COLOR_WINDOWTEXT));
+    SetBkMode(hdc, TRANSPARENT);
+
+    char cells[EDITOR_VIEW_MAX_COLUMNS];
+    size_t maxCells = (size_t)view->visibleColumns + 1;
+    if (maxCells > EDITOR_VIEW_MAX_COLUMNS) {
+        maxCells = EDITOR_VIEW_MAX_COLUMNS;
+    }
+
+    uint64_t rowCount = ViewRowCount(view);
+    int firstRow = ps.rcPaint.top / view->lineHeight;
+    int lastRow = (ps.rcPaint.bottom + view->lineHeight - 1) / view->lineHeight;
+    for (int row = firstRow; row < lastRow; row++) {
+        RECT rowRect = { client.left, row * view->lineHeight, client.right, (row + 1) * view->lineHeight };
+        FillRect(hdc, &rowRect, background);
+
+        if (view->firstRow + (uint64_t)row >= rowCount) {
+            continue;
+        }
+        uint64_t line = ViewLineFromRow(view, view->firstRow + (uint64_t)row);
+        uint64_t lineStart = DocumentLineStart(view->document, line);
+        uint64_t lineEnd = DocumentLineEnd(view->document, line);
+
+        uint64_t visibleEnd = LayoutOffsetFromColumn(view->document, lineStart, lineEnd,
+                                                     view->firstColumn + maxCells + LAYOUT_TAB_WIDTH);
+
+        if (MarkerTreeQuery(view->markers, lineStart, lineEnd, 1u << MARKER_KIND_BOOKMARK, StopAtFirst, NULL) > 0) {
+            FillRect(hdc, &rowRect, bookmarkBrush);
+        }
+
+        PaintRowSelections(hdc, view, selectionBrush, lineStart, visibleEnd, rowRect.top);
+        size_t cellCount = LayoutVisibleText(view->document, lineStart, lineEnd, view->firstColumn, cells, maxCells);
+        if (cellCount > 0) {
+            TextOut(hdc, 0, rowRect.top, cells, (int)cellCount);
+        }
+        if (spellingPen) {
+            PaintRowSpelling(hdc, view, lineStart, visibleEnd, rowRect.top);
+        }
+        if (!view->filter && FoldSetIsHeader(&view->folds, view->document, line)) {
+            PaintFoldMarker(hdc, view, lineStart, lineEnd, visibleEnd, rowRect.top);
+        }
+        if (view->hasFocus) {
+            PaintRowCarets(hdc, view, lineStart, visibleEnd, rowRect.top);
+        }
+    }
+
+    if (spellingPen) {
+        SelectObject(hdc, oldPen);
+        DeleteObject(spellingPen);
+    }
+    DeleteObject(bookmarkBrush);
+    DeleteObject(selectionBrush);
+    SelectObject(hdc, oldFont);
+    EndPaint(hWnd, &ps);
+}
+
+/**
+ * @brief Creates the view state, font and initial empty document.
+ *
+ * @param hWnd Handle to the view.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+static BOOL CreateView(HWND hWnd) {
+    EditorView* view = (EditorView*)calloc(1, sizeof(EditorView));
+    if (!view) {
+        return FALSE;
+    }
+    if (!CursorSetInit(&view->cursors)) {
+        free(view);
+        return FALSE;
+    }
+    FoldSetInit(&view->folds);
+    MacroInit(&view->macro);
+
+    view->font = CreateFont(-EDITOR_VIEW_FONT_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                            OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, FIXED_PITCH | FF_MODERN,
+                            EDITOR_VIEW_FONT_NAME);
+    if (!view->font) {
+        view->font = (HFONT)GetStockObject(ANSI_FIXED_FONT);
+    }
+
+    // Measure one cell of the fixed-pitch font
+    HDC hdc = GetDC(hWnd);
+    HFONT oldFont = (HFONT)SelectObject(hdc, view->font);
+    TEXTMETRIC tm;
+    GetTextMetrics(hdc, &tm);
+    SelectObject(hdc, oldFont);
+    ReleaseDC(hWnd, hdc);
+    view->charWidth = tm.tmAveCharWidth > 0 ? (int)tm.tmAveCharWidth : 8;
+    view->lineHeight = tm.tmHeight + tm.tmExternalLeading > 0 ? (int)(tm.tmHeight + tm.tmExternalLeading) : 16;
+
+    SetWindowLongPtr(hWnd, GWLP_USERDATA, (LONG_PTR)view);
+
+    Document* document = DocumentCreateFromText(NULL, 0);
+    if (!document || !AttachDocument(hWnd, view, document)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Releases the view state and its document.
+ *
+ * @param hWnd Handle to the view.
+ */
+static void DestroyView(HWND hWnd) {
+    EditorView* view = GetView(hWnd);
+    if (!view) {
+        return;
+    }
+    SetWindowLongPtr(hWnd, GWLP_USERDATA, 0);
+    SpellCheckerDestroy(view->spelling);
+    ReleaseSort(EndSort(view, TRUE));
+    if (view->document) {
+        DocumentRemoveListener(view->document, ViewDocumentChanged, (void*)hWnd);
+        LineFilterDestroy(view->filter);
+        view->filter = NULL;
+        TimeIndexDestroy(view->times);
+        StructureIndexDestroy(view->structure);
+        WordIndexDestroy(view->words);
+        MarkerTreeDestroy(view->markers);
+        LayoutCacheDestroy(view->layout);
+        DocumentDestroy(view->document);
+    }
+    CursorSetFree(&view->cursors);
+    FoldSetFree(&view->folds);
+    MacroFree(&view->macro);
+    if (view->font) {
+        DeleteObject(view->font);
+    }
+    free(view);
+}
+
+/**
+ * @brief Window procedure of the editor view.
+ *
+ * @param hWnd Handle to the view.
+ * @param message The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing.
+ */
+static LRESULT CALLBACK EditorViewProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    EditorView* view = GetView(hWnd);
+    if (!view && message != WM_CREATE) {
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+
+    switch (message) {
+        case WM_CREATE:
+            return CreateView(hWnd) ? 0 : -1;
+
+        case WM_DESTROY:
+            DestroyView(hWnd);
+            return 0;
+
+        case WM_SIZE: {
+            int width = LOWORD(lParam);
+            int height = HIWORD(lParam);
+            view->visibleLines = height / view->lineHeight;
+            view->visibleColumns = width / view->charWidth;
+            UpdateScrollBars(hWnd, view);
+            InvalidateRect(hWnd, NULL, FALSE);
+            return 0;
+        }
+
+        case WM_ERASEBKGND:
+            // Every row is filled by WM_PAINT
+            return 1;
+
+        case WM_PAINT:
+            PaintView(hWnd, view);
+            return 0;
+
+        case WM_SETFOCUS:
+        case WM_KILLFOCUS:
+            view->hasFocus = message == WM_SETFOCUS;
+            InvalidateRect(hWnd, NULL, FALSE);
+            return 0;
+
+        case WM_GETDLGCODE:
+            return DLGC_WANTALLKEYS | DLGC_WANTCHARS | DLGC_WANTARROWS | DLGC_WANTTAB;
+
+        case WM_KEYDOWN:
+            if (HandleKeyDown(hWnd, view, wParam)) {
+                return 0;
+            }
+            break;
+
+        case WM_SYSKEYDOWN:
+            // Alt+Up/Down jump between folds; other Alt keys belong to the menu
+            if ((wParam == VK_UP || wParam == VK_DOWN) && HandleKeyDown(hWnd, view, wParam)) {
+                return 0;
+            }
+            break;
+
+        case WM_CHAR:
+            HandleChar(hWnd, view, wParam);
+            return 0;
+
+        case WM_LBUTTONDOWN:
+            HandleMouseDown(hWnd, view, lParam);
+            return 0;
+
+        case WM_MOUSEMOVE:
+            if (view->selecting) {
+                HandleMouseDrag(hWnd, view, lParam);
+            }
+            return 0;
+
+        case WM_LBUTTONUP:
+            if (view->selecting) {
+                view->selecting = FALSE;
+                ReleaseCapture();
+            }
+            return 0;
+
+        case WM_VSCROLL:
+            HandleScroll(hWnd, view, SB_VERT, LOWORD(wParam));
+            return 0;
+
+        case WM_HSCROLL:
+            HandleScroll(hWnd, view, SB_HORZ, LOWORD(wParam));
+            return 0;
+
+        case WM_MOUSEWHEEL: {
+            int notches = GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+            int64_t firstRow = (int64_t)view->firstRow - (int64_t)notches * EDITOR_VIEW_WHEEL_LINES;
+            ScrollViewTo(hWnd, view, firstRow < 0 ? 0 : (uint64_t)firstRow, view->firstColumn);
+            return 0;
+        }
+
+        case WM_CUT:
+            RunCommand(hWnd, view, EDITOR_COMMAND_CUT);
+            return 0;
+
+        case WM_COPY:
+            RunCommand(hWnd, view, EDITOR_COMMAND_COPY);
+            return 0;
+
+        case WM_PASTE:
+            RunCommand(hWnd, view, EDITOR_COMMAND_PASTE);
+            return 0;
+
+        case WM_UNDO:
+            return RunCommand(hWnd, view, EDITOR_COMMAND_UNDO);
+
+        case WM_RENDERFORMAT:
+            // Another application asked for the text of a slice copied here
+            if (wParam == CF_TEXT) {
+                ClipboardRender();
+            }
+            return 0;
+
+        case WM_RENDERALLFORMATS:
+            ClipboardRenderAll(hWnd);
+            return 0;
+
+        case WM_DESTROYCLIPBOARD:
+            ClipboardRelease();
+            return 0;
+
+        case WM_CONTEXTMENU:
+            if (ShowSpellingMenu(hWnd, view, lParam)) {
+                return 0;
+            }
+            break;
+
+        case WM_EDITOR_SPELLING_READY:
+            if (SpellCheckerCollect(view->spelling)) {
+                InvalidateRect(hWnd, NULL, FALSE);
+            }
+            ScheduleSpelling(view);
+            return 0;
+
+        case WM_EDITOR_SORT_PROGRESS:
+            if (view->sort) {
+                NotifyProgress(hWnd, (int)wParam, view->sort->label);
+            }
+            return 0;
+
+        case WM_EDITOR_SORT_DONE:
+            FinishSort(hWnd, view);
+            return 0;
+    }
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
 
 /**
  * @brief Creates the text editor control within the parent window.
@@ -15,30 +2530,35 @@
  * @return Handle to the created edit control, or NULL if creation failed.
  */
 HWND CreateEditorControl(HWND hWnd, HINSTANCE hInstance) {
-    // Create a multiline, scrollable edit control
+    static BOOL registered = FALSE;
+    if (!registered) {
+        WNDCLASSEX wcex;
+        ZeroMemory(&wcex, sizeof(wcex));
+        wcex.cbSize = sizeof(WNDCLASSEX);
+        wcex.lpfnWndProc = EditorViewProc;
+        wcex.hInstance = hInstance;
+        wcex.hCursor = LoadCursor(NULL, IDC_IBEAM);
+        wcex.hbrBackground = NULL; // The view paints its own background
+        wcex.lpszClassName = EDITOR_VIEW_CLASS_NAME;
+        if (!RegisterClassEx(&wcex)) {
+            return NULL;
+        }
+        registered = TRUE;
+    }
+
+    // Create the scrollable multi-caret view
     HWND hEdit = CreateWindowEx(
         WS_EX_CLIENTEDGE,
-        "EDIT",
+        EDITOR_VIEW_CLASS_NAME,
         NULL,
-        WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | ES_LEFT | 
-        ES_MULTILINE | ES_AUTOVSCROLL | ES_AUTOHSCROLL,
+        WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL | WS_TABSTOP,
         0, 0, 0, 0,  // Position and size will be set by WM_SIZE handler
         hWnd,
         NULL,
         hInstance,
         NULL
     );
-    
-    if (!hEdit) {
-        return NULL;
-    }
-    
-    // Set a reasonable default font (system font)
-    HFONT hFont = (HFONT)GetStockObject(DEFAULT_GUI_FONT);
-    if (hFont) {
-        SendMessage(hEdit, WM_SETFONT, (WPARAM)hFont, MAKELPARAM(TRUE, 0));
-    }
-    
+
     return hEdit;
 }
 
@@ -50,40 +2570,11 @@ HWND CreateEditorControl(HWND hWnd, HINSTANCE hInstance) {
  *         The caller is responsible for freeing this memory.
  */
 char* GetEditorText(HWND hEdit) {
-    if (!hEdit) {
-        return NULL;
-    }
-    
-    // Get the length of the text
-    int length = GetWindowTextLength(hEdit);
-    if (length <= 0) {
-        // No text or error
-        if (GetLastError() != 0) {
-            // An error occurred
-            return NULL;
-        }
-        
-        // Empty text, return an empty string
-        char* emptyText = (char*)malloc(1);
-        if (emptyText) {
-            emptyText[0] = '\0';
-        }
-        return emptyText;
-    }
-    
-    // Allocate memory for the text (+1 for null terminator)
-    char* buffer = (char*)malloc(length + 1);
-    if (!buffer) {
-        return NULL;
-    }
-    
-    // Get the text
-    if (GetWindowText(hEdit, buffer, length + 1) == 0) {
-        free(buffer);
+    EditorView* view = GetView(hEdit);
+    if (!view) {
         return NULL;
     }
-    
-    return buffer;
+    return DocumentCopyRange(view->document, 0, DocumentLength(view->document));
 }
 
 /**
@@ -97,13 +2588,17 @@ BOOL SetEditorText(HWND hEdit, const char* text) {
     if (!hEdit) {
         return FALSE;
     }
-    
+
     // NULL text is treated as empty string
     if (text == NULL) {
         text = "";
     }
-    
-    return SetWindowText(hEdit, text);
+
+    Document* document = DocumentCreateFromText(text, strlen(text));
+    if (!document) {
+        return FALSE;
+    }
+    return SetEditorDocument(hEdit, document);
 }
 
 /**
@@ -114,3 +2609,197 @@ BOOL SetEditorText(HWND hEdit, const char* text) {
 void ClearEditorText(HWND hEdit) {
     SetEditorText(hEdit, "");
 }
+
+/**
+ * @brief Gets the selection and scroll position of the editor control.
+ *
+ * Only the primary selection is recorded.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param[out] viewState Receives the caret, anchor and first visible line.
+ */
+void GetEditorViewState(HWND hEdit, DocumentViewState* viewState) {
+    if (!viewState) {
+        return;
+    }
+    ZeroMemory(viewState, sizeof(*viewState));
+    EditorView* view = GetView(hEdit);
+    if (!view) {
+        return;
+    }
+
+    const Selection* primary = &view->cursors.items[view->cursors.primary];
+    viewState->selectionStart = primary->anchor;
+    viewState->selectionEnd = primary->caret;
+    viewState->firstVisibleLine = ViewLineFromRow(view, view->firstRow);
+}
+
+/**
+ * @brief Restores the selection and scroll position of the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param viewState The caret, anchor and first visible line to restore.
+ */
+void SetEditorViewState(HWND hEdit, const DocumentViewState* viewState) {
+    EditorView* view = GetView(hEdit);
+    if (!view || !viewState) {
+        return;
+    }
+
+    // Clamp positions that are beyond the end of the current text
+    uint64_t length = DocumentLength(view->document);
+    uint64_t anchor = viewState->selectionStart < length ? viewState->selectionStart : length;
+    uint64_t caret = viewState->selectionEnd < length ? viewState->selectionEnd : length;
+    CursorSetReset(&view->cursors, anchor, caret);
+    ScrollViewTo(hEdit, view, ViewRowFromLine(view, viewState->firstVisibleLine), 0);
+    InvalidateRect(hEdit, NULL, FALSE);
+}
+
+/**
+ * @brief Gets the folds of the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param[out] folds Receives the folds, sorted by hideStart; valid until the folds or the document change.
+ * @return The number of folds.
+ */
+size_t GetEditorFolds(HWND hEdit, const Fold** folds) {
+    EditorView* view = GetView(hEdit);
+    if (!folds) {
+        return 0;
+    }
+    *folds = view ? view->folds.items : NULL;
+    return view ? view->folds.count : 0;
+}
+
+/**
+ * @brief Replaces the folds of the editor control.
+ *
+ * Folds that do not hide whole lines of the current document are dropped.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param folds The folds, as returned by GetEditorFolds for the same content.
+ * @param count Number of folds.
+ */
+void SetEditorFolds(HWND hEdit, const Fold* folds, size_t count) {
+    EditorView* view = GetView(hEdit);
+    if (!view || (!folds && count > 0)) {
+        return;
+    }
+
+    FoldSetClear(&view->folds);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t firstLine = DocumentLineFromOffset(view->document, folds[i].hideStart);
+        uint64_t lastLine = DocumentLineFromOffset(view->document, folds[i].hideLast);
+        if (DocumentLineStart(view->document, firstLine) == folds[i].hideStart &&
+            DocumentLineStart(view->document, lastLine) == folds[i].hideLast) {
+            FoldSetAdd(&view->folds, view->document, firstLine, lastLine);
+        }
+    }
+    UpdateScrollBars(hEdit, view);
+    InvalidateRect(hEdit, NULL, FALSE);
+}
+
+/**
+ * @brief Replaces the document shown by the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param document The new document; ownership is transferred to the control.
+ * @return TRUE if successful, FALSE otherwise (the document is then destroyed).
+ */
+BOOL SetEditorDocument(HWND hEdit, Document* document) {
+    EditorView* view = GetView(hEdit);
+    if (!view || !document) {
+        DocumentDestroy(document);
+        return FALSE;
+    }
+    return AttachDocument(hEdit, view, document);
+}
+
+/**
+ * @brief Gets the document shown by the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @return The document, owned by the control, or NULL on failure.
+ */
+Document* GetEditorDocument(HWND hEdit) {
+    EditorView* view = GetView(hEdit);
+    return view ? view->document : NULL;
+}
+
+/**
+ * @brief Executes an editing command on every caret of the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param command The command to execute.
+ * @return TRUE if the command changed the document or the selection, FALSE otherwise.
+ */
+BOOL ExecuteEditorCommand(HWND hEdit, EditorCommand command) {
+    EditorView* view = GetView(hEdit);
+    if (!view) {
+        return FALSE;
+    }
+    return RunCommand(hEdit, view, command);
+}
+
+/**
+ * @brief Applies edits made outside the editor control as one undoable step.
+ *
+ * The carets move with the text, as for any change made by someone else.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param edits The edits, sorted, in the coordinates of the current content.
+ * @param editCount Number of edits.
+ * @return TRUE if the document changed, FALSE if the control is read-only, sorting, or the edits failed.
+ */
+BOOL ApplyEditorEdits(HWND hEdit, const DocumentEdit* edits, size_t editCount) {
+    EditorView* view = GetView(hEdit);
+    if (!view || view->readOnly || view->sort || editCount == 0) {
+        return FALSE;
+    }
+    return DocumentApplyEdits(view->document, edits, editCount) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Allows or refuses edits made through the editor control.
+ *
+ * A read-only control still supports selection, copying and scrolling.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param readOnly TRUE to refuse edits, FALSE to allow them.
+ */
+void SetEditorReadOnly(HWND hEdit, BOOL readOnly) {
+    EditorView* view = GetView(hEdit);
+    if (view) {
+        view->readOnly = readOnly;
+    }
+}
+
+/**
+ * @brief Starts or stops background spell checking in the editor control.
+ *
+ * @param hEdit Handle to the edit control.
+ * @param dictionary The dictionary, or NULL to stop spell checking. It must
+ *        stay open until spell checking is stopped or the control destroyed.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL SetEditorSpellChecking(HWND hEdit, const SpellDict* dictionary) {
+    EditorView* view = GetView(hEdit);
+    if (!view) {
+        return FALSE;
+    }
+
+    // Results posted by an old worker are collected from a NULL checker and ignored
+    SpellCheckerDestroy(view->spelling);
+    view->spelling = NULL;
+    view->dictionary = NULL;
+    if (dictionary) {
+        view->spelling = SpellCheckerCreate(dictionary, SpellingReady, (void*)hEdit);
+        if (view->spelling) {
+            view->dictionary = dictionary;
+            SpellCheckerReset(view->spelling, view->document);
+            ScheduleSpelling(view);
+        }
+    }
+    InvalidateRect(hEdit, NULL, FALSE);
+    return view->spelling || !dictionary ? TRUE : FALSE;
+}
@@ -0,0 +1,727 @@
+/**
+ * @file csvindex.c
+ * @brief Structural index of delimited text implementation for the Professional Text Editor
+ *
+ * Contains the word-parallel classification of quotes and line feeds, the
+ * sparse row index, field parsing, column sampling and the column sort.
+ */
+
+#include "../include/csvindex.h"
+#include "../include/bitscan.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes examined to guess the delimiter
+#define CSV_SNIFF_BYTES 65536
+
+// Lines examined to guess the delimiter
+#define CSV_SNIFF_LINES 100
+
+// Rows parsed at each sampled position when sizing the columns
+#define CSV_SAMPLE_RUN 64
+
+// Longest value compared when sorting by a text column
+#define CSV_SORT_TEXT_MAX 1024
+
+// Longest value parsed as a number
+#define CSV_NUMBER_MAX 64
+
+struct CsvIndex {
+    const Document* document;
+    char delimiter;
+    uint64_t rowCount;
+    uint64_t* rowStarts;        // Start of row k * CSV_INDEX_ROW_STRIDE at index k
+    size_t startCount;
+    size_t startCapacity;
+};
+
+// Sequential reader of document bytes
+typedef struct {
+    DocumentIterator iterator;
+    const char* data;
+    size_t length;
+    size_t position;
+    uint64_t offset;            // Offset of the next byte
+} ByteReader;
+
+// Row of the column sort
+typedef struct {
+    uint64_t key;               // Number or first eight bytes of the value, ordered like the values
+    uint64_t row;               // Start of the row
+    uint32_t fieldDelta;        // Start of the field from the start of the row
+    uint32_t fieldLength;       // Length of the field; the top bit marks a quoted field
+} SortRecord;
+
+// State of the column sort
+typedef struct {
+    const CsvIndex* index;
+    bool numeric;
+    bool descending;
+    char left[CSV_SORT_TEXT_MAX];
+    char right[CSV_SORT_TEXT_MAX];
+} SortContext;
+
+#define CSV_QUOTED_FLAG 0x80000000u
+
+/**
+ * @brief Starts reading a document at an offset.
+ *
+ * @param reader The reader.
+ * @param document The document.
+ * @param offset The offset.
+ */
+static void ReaderInit(ByteReader* reader, const Document* document, uint64_t offset) {
+    DocumentIterInit(document, offset, &reader->iterator);
+    reader->data = NULL;
+    reader->length = 0;
+    reader->position = 0;
+    reader->offset = offset;
+}
+
+/**
+ * @brief Reads the next byte.
+ *
+ * @param reader The reader.
+ * @return The byte, or -1 at the end of the document.
+ */
+static int ReaderNext(ByteReader* reader) {
+    while (reader->position == reader->length) {
+        if (!DocumentIterNext(&reader->iterator, &reader->data, &reader->length)) {
+            reader->length = 0;
+            reader->position = 0;
+            return -1;
+        }
+        reader->position = 0;
+    }
+    reader->offset++;
+    return (unsigned char)reader->data[reader->position++];
+}
+
+/**
+ * @brief Guesses the delimiter of a document from its first lines.
+ *
+ * Comma, tab, semicolon and vertical bar are tried; the one found the same
+ * number of times on the most lines wins.
+ *
+ * @param document The document.
+ * @return The delimiter; a comma when nothing fits better.
+ */
+char CsvSniffDelimiter(const Document* document) {
+    static const char candidates[] = { ',', '\t', ';', '|' };
+    enum { CANDIDATE_COUNT = sizeof(candidates) };
+    size_t firstCounts[CANDIDATE_COUNT] = { 0 };
+    size_t counts[CANDIDATE_COUNT] = { 0 };
+    size_t scores[CANDIDATE_COUNT] = { 0 };
+    size_t line = 0;
+    bool inQuotes = false;
+
+    ByteReader reader;
+    ReaderInit(&reader, document, 0);
+    for (size_t read = 0; read < CSV_SNIFF_BYTES && line < CSV_SNIFF_LINES; read++) {
+        int c = ReaderNext(&reader);
+        if (c < 0 || (c == '\n' && !inQuotes)) {
+            for (int i = 0; i < CANDIDATE_COUNT; i++) {
+                if (line == 0) {
+                    firstCounts[i] = counts[i];
+                }
+                if (counts[i] > 0 && counts[i] == firstCounts[i]) {
+                    scores[i]++;
+                }
+                counts[i] = 0;
+            }
+            line++;
+            if (c < 0) {
+                break;
+            }
+            continue;
+        }
+        if (c == '"') {
+            inQuotes = !inQuotes;
+        } else if (!inQuotes) {
+            for (int i = 0; i < CANDIDATE_COUNT; i++) {
+                counts[i] += c == candidates[i] ? 1 : 0;
+            }
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i < CANDIDATE_COUNT; i++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    return candidates[best];
+}
+
+/**
+ * @brief Records the start of a row that begins a stride.
+ *
+ * @param index The index.
+ * @param offset Start of the row.
+ * @return true if successful, false if out of memory.
+ */
+static bool AppendRowStart(CsvIndex* index, uint64_t offset) {
+    if (index->startCount == index->startCapacity) {
+        size_t newCapacity = index->startCapacity ? index->startCapacity * 2 : 1024;
+        uint64_t* newStarts = (uint64_t*)MemoryRealloc(MEMORY_TAG_TABLE, index->rowStarts,
+                                                       newCapacity * sizeof(uint64_t));
+        if (!newStarts) {
+            return false;
+        }
+        index->rowStarts = newStarts;
+        index->startCapacity = newCapacity;
+    }
+    index->rowStarts[index->startCount++] = offset;
+    return true;
+}
+
+/**
+ * @brief Indexes one block of up to 64 bytes.
+ *
+ * @param index The index.
+ * @param block The bytes, padded with zeros to 64.
+ * @param offset Document offset of the block.
+ * @param[in,out] inQuotes Whether the block starts, and then ends, inside quotes.
+ * @return true if successful, false if out of memory.
+ */
+static bool IndexBlock(CsvIndex* index, const unsigned char* block, uint64_t offset, bool* inQuotes) {
+    uint64_t quotes = 0;
+    uint64_t lineFeeds = 0;
+    for (int word = 0; word < BITSCAN_BLOCK_BYTES / 8; word++) {
+        uint64_t bytes = BitScanLoadWord(block + word * 8);
+        quotes |= BitScanMatchWord(bytes, BITSCAN_REPEAT('"')) << (word * 8);
+        lineFeeds |= BitScanMatchWord(bytes, BITSCAN_REPEAT('\n')) << (word * 8);
+    }
+
+    uint64_t quoted = BitScanPrefixXor(quotes) ^ (*inQuotes ? ~(uint64_t)0 : 0);
+    *inQuotes = (quoted >> 63) != 0;
+    uint64_t rowEnds = lineFeeds & ~quoted;
+
+    // Most blocks only add to the count; a stride boundary needs the position of its line feed
+    unsigned ends = BitScanCount(rowEnds);
+    uint64_t nextRecorded = (uint64_t)index->startCount * CSV_INDEX_ROW_STRIDE;
+    while (ends > 0 && index->rowCount + ends >= nextRecorded) {
+        for (uint64_t skip = nextRecorded - index->rowCount - 1; skip > 0; skip--) {
+            rowEnds &= rowEnds - 1;
+        }
+        if (!AppendRowStart(index, offset + BitScanLowest(rowEnds) + 1)) {
+            return false;
+        }
+        rowEnds &= rowEnds - 1;
+        ends -= (unsigned)(nextRecorded - index->rowCount);
+        index->rowCount = nextRecorded;
+        nextRecorded += CSV_INDEX_ROW_STRIDE;
+    }
+    index->rowCount += ends;
+    return true;
+}
+
+/**
+ * @brief Builds the row index of a document.
+ *
+ * Line feeds inside quoted fields do not end a row. The document must not
+ * change while the index is in use.
+ *
+ * @param document The document.
+ * @param delimiter Field delimiter, or 0 to guess it with CsvSniffDelimiter.
+ * @return The index, or NULL on failure.
+ */
+CsvIndex* CsvIndexBuild(const Document* document, char delimiter) {
+    if (!document) {
+        return NULL;
+    }
+    CsvIndex* index = (CsvIndex*)MemoryCalloc(MEMORY_TAG_TABLE, 1, sizeof(CsvIndex));
+    if (!index) {
+        return NULL;
+    }
+    index->document = document;
+    index->delimiter = delimiter ? delimiter : CsvSniffDelimiter(document);
+    if (!AppendRowStart(index, 0)) {
+        CsvIndexDestroy(index);
+        return NULL;
+    }
+
+    // Whole blocks are classified in place; a piece's tail is padded with zeros, which match nothing
+    DocumentIterator iterator;
+    DocumentIterInit(document, 0, &iterator);
+    const char* data;
+    size_t length;
+    uint64_t offset = 0;
+    bool inQuotes = false;
+    char lastByte = '\n';
+    unsigned char tail[BITSCAN_BLOCK_BYTES];
+    while (DocumentIterNext(&iterator, &data, &length)) {
+        size_t position = 0;
+        for (; position + BITSCAN_BLOCK_BYTES <= length; position += BITSCAN_BLOCK_BYTES) {
+            if (!IndexBlock(index, (const unsigned char*)data + position, offset + position, &inQuotes)) {
+                CsvIndexDestroy(index);
+                return NULL;
+            }
+        }
+        if (position < length) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + position, length - position);
+            if (!IndexBlock(index, tail, offset + position, &inQuotes)) {
+                CsvIndexDestroy(index);
+                return NULL;
+            }
+        }
+        if (length > 0) {
+            lastByte = data[length - 1];
+        }
+        offset += length;
+    }
+
+    // A last row without a line feed still counts
+    if (offset > 0 && (lastByte != '\n' || inQuotes)) {
+        index->rowCount++;
+    }
+    return index;
+}
+
+/**
+ * @brief Releases a row index.
+ *
+ * @param index The index, or NULL.
+ */
+void CsvIndexDestroy(CsvIndex* index) {
+    if (!index) {
+        return;
+    }
+    MemoryFree(index->rowStarts);
+    MemoryFree(index);
+}
+
+/**
+ * @brief Gets the field delimiter of an index.
+ *
+ * @param index The index.
+ * @return The delimiter.
+ */
+char CsvIndexDelimiter(const CsvIndex* index) {
+    return index ? index->delimiter : ',';
+}
+
+/**
+ * @brief Gets the number of rows of an index.
+ *
+ * @param index The index.
+ * @return The row count; a final line feed does not start another row.
+ */
+uint64_t CsvIndexRowCount(const CsvIndex* index) {
+    return index ? index->rowCount : 0;
+}
+
+/**
+ * @brief Splits the row starting at an offset into fields.
+ *
+ * @param index The index.
+ * @param offset Start of the row.
+ * @param[out] fields Receives the first fields of the row; may be NULL when maxFields is 0.
+ * @param maxFields Capacity of fields.
+ * @param[out] next Receives the start of the following row; may be NULL.
+ * @return Number of fields in the row, which may exceed maxFields.
+ */
+size_t CsvIndexParseRow(const CsvIndex* index, uint64_t offset, CsvField* fields, size_t maxFields,
+                        uint64_t* next) {
+    ByteReader reader;
+    ReaderInit(&reader, index->document, offset);
+    size_t count = 0;
+    uint64_t fieldStart = offset;
+    bool quoted = false;
+    bool inQuotes = false;
+    int previous = -1;
+    for (;;) {
+        uint64_t position = reader.offset;
+        int c = ReaderNext(&reader);
+        if (c < 0 || (!inQuotes && (c == '\n' || c == index->delimiter))) {
+            uint64_t end = position;
+            if (c == '\n' && previous == '\r' && end > fieldStart) {
+                end--; // The carriage return of a CR LF belongs to the line break
+            }
+            if (count < maxFields) {
+                fields[count].offset = fieldStart;
+                fields[count].length = end - fieldStart;
+                fields[count].quoted = quoted;
+            }
+            count++;
+            if (c != index->delimiter) {
+                if (next) {
+                    *next = c < 0 ? position : position + 1;
+                }
+                return count;
+            }
+            fieldStart = position + 1;
+            quoted = false;
+            previous = c;
+            continue;
+        }
+        if (c == '"') {
+            quoted = quoted || position == fieldStart;
+            inQuotes = !inQuotes;
+        }
+        previous = c;
+    }
+}
+
+/**
+ * @brief Gets the offset where a row starts.
+ *
+ * @param index The index.
+ * @param row The row; clamped to the last row.
+ * @return The offset of the row's first byte.
+ */
+uint64_t CsvIndexRowStart(const CsvIndex* index, uint64_t row) {
+    if (!index || index->rowCount == 0) {
+        return 0;
+    }
+    if (row >= index->rowCount) {
+        row = index->rowCount - 1;
+    }
+    uint64_t offset = index->rowStarts[row / CSV_INDEX_ROW_STRIDE];
+    for (uint64_t skip = row % CSV_INDEX_ROW_STRIDE; skip > 0; skip--) {
+        CsvIndexParseRow(index, offset, NULL, 0, &offset);
+    }
+    return offset;
+}
+
+/**
+ * @brief Copies the text of a field without its quotes.
+ *
+ * Doubled quotes are copied as one, and the text is cut to the buffer.
+ *
+ * @param index The index.
+ * @param field The field.
+ * @param[out] buffer Receives the text, NUL-terminated.
+ * @param size Size of the buffer; at least 1.
+ * @return Length of the copied text.
+ */
+size_t CsvIndexFieldText(const CsvIndex* index, const CsvField* field, char* buffer, size_t size) {
+    // Text after the closing quote is kept as written
+    uint64_t start = field->offset + (field->quoted ? 1 : 0);
+    uint64_t end = field->offset + field->length;
+
+    ByteReader reader;
+    ReaderInit(&reader, index->document, start);
+    size_t length = 0;
+    bool inQuotes = field->quoted;
+    while (reader.offset < end && length + 1 < size) {
+        int c = ReaderNext(&reader);
+        if (c < 0) {
+            break;
+        }
+        if (c == '"' && field->quoted) {
+            inQuotes = !inQuotes;
+            if (inQuotes) {
+                buffer[length++] = '"'; // The second of a doubled quote
+            }
+            continue; // Otherwise a closing quote, or the first of a doubled one
+        }
+        buffer[length++] = (char)c;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Calls a function for the rows sampled across the document.
+ *
+ * Runs of consecutive rows are taken at evenly spaced recorded row starts,
+ * so sampling never scans far.
+ *
+ * @param index The index.
+ * @param visit Called with each sampled row's start.
+ * @param context Passed to visit.
+ */
+static void ForEachSampledRow(const CsvIndex* index, void (*visit)(const CsvIndex*, uint64_t, void*),
+                              void* context) {
+    size_t runs = CSV_INDEX_SAMPLE_ROWS / CSV_SAMPLE_RUN;
+    size_t strides = index->rowCount > 0 ? (size_t)((index->rowCount - 1) / CSV_INDEX_ROW_STRIDE) + 1 : 0;
+    size_t step = strides > runs ? strides / runs : 1;
+    for (size_t stride = 0; stride < strides && stride / step < runs; stride += step) {
+        uint64_t row = (uint64_t)stride * CSV_INDEX_ROW_STRIDE;
+        uint64_t offset = index->rowStarts[stride];
+        for (int i = 0; i < CSV_SAMPLE_RUN && row < index->rowCount; i++, row++) {
+            visit(index, offset, context);
+            CsvIndexParseRow(index, offset, NULL, 0, &offset);
+        }
+    }
+}
+
+// Column widths collected from the sampled rows
+typedef struct {
+    uint32_t* widths;
+    size_t maxColumns;
+    size_t columns;
+} WidthSample;
+
+/**
+ * @brief Widens the columns to fit one sampled row.
+ *
+ * @param index The index.
+ * @param offset Start of the row.
+ * @param context The width sample.
+ */
+static void SampleRowWidths(const CsvIndex* index, uint64_t offset, void* context) {
+    WidthSample* sample = (WidthSample*)context;
+    CsvField fields[64];
+    size_t capacity = sample->maxColumns < 64 ? sample->maxColumns : 64;
+    size_t count = CsvIndexParseRow(index, offset, fields, capacity, NULL);
+    if (count > capacity) {
+        count = capacity;
+    }
+    char text[CSV_INDEX_MAX_WIDTH + 1];
+    for (size_t i = 0; i < count; i++) {
+        uint32_t width = (uint32_t)CsvIndexFieldText(index, &fields[i], text, sizeof(text));
+        if (i >= sample->columns) {
+            sample->widths[i] = 1;
+        }
+        if (width > sample->widths[i]) {
+            sample->widths[i] = width;
+        }
+    }
+    if (count > sample->columns) {
+        sample->columns = count;
+    }
+}
+
+/**
+ * @brief Sizes the columns from rows sampled across the document.
+ *
+ * @param index The index.
+ * @param[out] widths Receives the width of each column, at most CSV_INDEX_MAX_WIDTH.
+ * @param maxColumns Capacity of widths.
+ * @return Number of columns found, at most maxColumns.
+ */
+size_t CsvIndexSampleWidths(const CsvIndex* index, uint32_t* widths, size_t maxColumns) {
+    if (!index || !widths || maxColumns == 0) {
+        return 0;
+    }
+    WidthSample sample = { widths, maxColumns, 0 };
+    ForEachSampledRow(index, SampleRowWidths, &sample);
+    return sample.columns;
+}
+
+/**
+ * @brief Parses a whole value as a number.
+ *
+ * @param text The value.
+ * @param[out] value Receives the number.
+ * @return true if the value is a number, surrounding spaces allowed.
+ */
+static bool ParseNumber(const char* text, double* value) {
+    while (*text == ' ') {
+        text++;
+    }
+    if (*text == '\0') {
+        return false;
+    }
+    char* end;
+    *value = strtod(text, &end);
+    while (*end == ' ') {
+        end++;
+    }
+    return end != text && *end == '\0';
+}
+
+// Numeric test of one column over the sampled rows
+typedef struct {
+    size_t column;
+    uint64_t firstOffset;       // Rows starting before it are a header and not sampled
+    size_t numbers;
+    size_t others;              // Non-empty values that are not numbers
+} NumberSample;
+
+/**
+ * @brief Checks whether one sampled row holds a number in the column.
+ *
+ * @param index The index.
+ * @param offset Start of the row.
+ * @param context The number sample.
+ */
+static void SampleRowNumber(const CsvIndex* index, uint64_t offset, void* context) {
+    NumberSample* sample = (NumberSample*)context;
+    CsvField fields[64];
+    if (offset < sample->firstOffset || sample->column >= 64 ||
+        CsvIndexParseRow(index, offset, fields, sample->column + 1, NULL) <= sample->column) {
+        return;
+    }
+    char text[CSV_NUMBER_MAX];
+    double value;
+    if (CsvIndexFieldText(index, &fields[sample->column], text, sizeof(text)) == 0) {
+        return;
+    }
+    if (ParseNumber(text, &value)) {
+        sample->numbers++;
+    } else {
+        sample->others++;
+    }
+}
+
+/**
+ * @brief Builds the key that orders a value.
+ *
+ * @param index The index.
+ * @param field The field holding the value.
+ * @param numeric true to order the value as a number.
+ * @return The key; values that are not numbers order after all numbers.
+ */
+static uint64_t SortKey(const CsvIndex* index, const CsvField* field, bool numeric) {
+    char text[CSV_NUMBER_MAX];
+    size_t length = CsvIndexFieldText(index, field, text, sizeof(text));
+    if (!numeric) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8 && i < length; i++) {
+            key |= (uint64_t)(unsigned char)text[i] << (56 - 8 * i);
+        }
+        return key;
+    }
+
+    // The bits of a double order like the number once negative ones are flipped
+    double value;
+    if (!ParseNumber(text, &value) || value != value) {
+        return UINT64_MAX;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+/**
+ * @brief Compares two rows of the column sort.
+ *
+ * @param context The sort context.
+ * @param a First row.
+ * @param b Second row.
+ * @return Negative if a comes first, positive if b does; rows are never equal.
+ */
+static int CompareRecords(SortContext* context, const SortRecord* a, const SortRecord* b) {
+    int result = 0;
+    if (context->numeric && (a->key == UINT64_MAX || b->key == UINT64_MAX) && a->key != b->key) {
+        return a->key == UINT64_MAX ? 1 : -1; // Values that are not numbers come last either way
+    }
+    if (a->key != b->key) {
+        result = a->key < b->key ? -1 : 1;
+    } else if (!context->numeric) {
+        CsvField left = { a->row + a->fieldDelta, a->fieldLength & ~CSV_QUOTED_FLAG,
+                          (a->fieldLength & CSV_QUOTED_FLAG) != 0 };
+        CsvField right = { b->row + b->fieldDelta, b->fieldLength & ~CSV_QUOTED_FLAG,
+                           (b->fieldLength & CSV_QUOTED_FLAG) != 0 };
+        size_t leftLength = CsvIndexFieldText(context->index, &left, context->left, sizeof(context->left));
+        size_t rightLength = CsvIndexFieldText(context->index, &right, context->right, sizeof(context->right));
+        result = memcmp(context->left, context->right, leftLength < rightLength ? leftLength : rightLength);
+        if (result == 0 && leftLength != rightLength) {
+            result = leftLength < rightLength ? -1 : 1;
+        }
+    }
+    if (result != 0) {
+        return context->descending ? -result : result;
+    }
+    return a->row < b->row ? -1 : 1; // Equal values keep the file order
+}
+
+/**
+ * @brief Sorts rows with a merge sort.
+ *
+ * @param context The sort context.
+ * @param records The rows.
+ * @param temp Scratch space for count rows.
+ * @param count Number of rows.
+ */
+static void MergeSortRecords(SortContext* context, SortRecord* records, SortRecord* temp, size_t count) {
+    if (count < 2) {
+        return;
+    }
+    size_t half = count / 2;
+    MergeSortRecords(context, records, temp, half);
+    MergeSortRecords(context, records + half, temp, count - half);
+    if (CompareRecords(context, &records[half - 1], &records[half]) < 0) {
+        return; // Already in order
+    }
+
+    memcpy(temp, records, half * sizeof(SortRecord));
+    size_t left = 0;
+    size_t right = half;
+    size_t out = 0;
+    while (left < half && right < count) {
+        if (CompareRecords(context, &records[right], &temp[left]) < 0) {
+            records[out++] = records[right++];
+        } else {
+            records[out++] = temp[left++];
+        }
+    }
+    while (left < half) {
+        records[out++] = temp[left++];
+    }
+}
+
+/**
+ * @brief Orders the rows by one column.
+ *
+ * Columns whose sampled values are nearly all numbers are compared as
+ * numbers, with other values last; other columns by their bytes. Equal
+ * values keep the file order. The fields of the column are read now, not
+ * when the index was built.
+ *
+ * @param index The index.
+ * @param column The column.
+ * @param firstRow First row sorted; rows before it (a header) are left out.
+ * @param descending true for the largest value first.
+ * @return The starts of rows firstRow and later in sorted order, to be freed
+ *         with free(), or NULL on failure or when there are no such rows.
+ */
+uint64_t* CsvIndexSortRows(const CsvIndex* index, size_t column, uint64_t firstRow, bool descending) {
+    if (!index || firstRow >= index->rowCount || index->rowCount - firstRow > SIZE_MAX / sizeof(SortRecord)) {
+        return NULL;
+    }
+    size_t count = (size_t)(index->rowCount - firstRow);
+    SortRecord* records = (SortRecord*)MemoryAlloc(MEMORY_TAG_TABLE, count * sizeof(SortRecord));
+    SortRecord* temp = (SortRecord*)MemoryAlloc(MEMORY_TAG_TABLE, count * sizeof(SortRecord));
+    SortContext* context = (SortContext*)MemoryAlloc(MEMORY_TAG_TABLE, sizeof(SortContext));
+    uint64_t* rows = (uint64_t*)malloc(count * sizeof(uint64_t));
+    CsvField* fields = (CsvField*)MemoryAlloc(MEMORY_TAG_TABLE, (column + 1) * sizeof(CsvField));
+    if (!records || !temp || !context || !rows || !fields) {
+        MemoryFree(records);
+        MemoryFree(temp);
+        MemoryFree(context);
+        free(rows);
+        MemoryFree(fields);
+        return NULL;
+    }
+
+    uint64_t offset = CsvIndexRowStart(index, firstRow);
+    NumberSample sample = { column, offset, 0, 0 };
+    ForEachSampledRow(index, SampleRowNumber, &sample);
+    context->index = index;
+    context->numeric = sample.numbers > 0 && sample.others <= sample.numbers / 10;
+    context->descending = descending;
+
+    // Rows without the column, or with a field beyond the 32-bit limits, sort as empty values
+    for (size_t i = 0; i < count; i++) {
+        uint64_t next;
+        size_t fieldCount = CsvIndexParseRow(index, offset, fields, column + 1, &next);
+        SortRecord* record = &records[i];
+        record->row = offset;
+        record->fieldDelta = 0;
+        record->fieldLength = 0;
+        record->key = context->numeric ? UINT64_MAX : 0;
+        if (fieldCount > column && fields[column].offset - offset <= UINT32_MAX &&
+            fields[column].length < CSV_QUOTED_FLAG) {
+            record->fieldDelta = (uint32_t)(fields[column].offset - offset);
+            record->fieldLength = (uint32_t)fields[column].length | (fields[column].quoted ? CSV_QUOTED_FLAG : 0);
+            record->key = SortKey(index, &fields[column], context->numeric);
+        }
+        offset = next;
+    }
+    MemoryFree(fields);
+
+    MergeSortRecords(context, records, temp, count);
+    for (size_t i = 0; i < count; i++) {
+        rows[i] = records[i].row;
+    }
+    MemoryFree(records);
+    MemoryFree(temp);
+    MemoryFree(context);
+    return rows;
+}
@@ -0,0 +1,846 @@
+/**
+ * @file cursors.c
+ * @brief Multiple carets and selections implementation for the Professional Text Editor
+ *
+ * Every editing command builds one sorted array of edits, one per selection,
+ * applies it with a single DocumentApplyEdits call and then walks the
+ * selections once with a running offset delta to place the carets.
+ */
+
+#include "../include/cursors.h"
+#include "../include/boundary.h"
+#include "../include/layout.h"
+#include "../include/memory.h"
+#include "../include/search.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Ensures the cursor set can hold a number of selections.
+ *
+ * @param cursors The cursor set.
+ * @param required The required capacity.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ReserveSelections(CursorSet* cursors, size_t required) {
+    if (required <= cursors->capacity) {
+        return true;
+    }
+    size_t capacity = cursors->capacity ? cursors->capacity * 2 : 8;
+    while (capacity < required) {
+        capacity *= 2;
+    }
+    Selection* items = (Selection*)MemoryRealloc(MEMORY_TAG_EDITING, cursors->items, capacity * sizeof(Selection));
+    if (!items) {
+        return false;
+    }
+    cursors->items = items;
+    cursors->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Orders selections by their start offset.
+ */
+static int CompareSelections(const void* a, const void* b) {
+    uint64_t startA = SelectionStart((const Selection*)a);
+    uint64_t startB = SelectionStart((const Selection*)b);
+    if (startA != startB) {
+        return startA < startB ? -1 : 1;
+    }
+    uint64_t endA = SelectionEnd((const Selection*)a);
+    uint64_t endB = SelectionEnd((const Selection*)b);
+    return endA < endB ? -1 : (endA > endB ? 1 : 0);
+}
+
+/**
+ * @brief Initializes a cursor set with a single caret at offset 0.
+ *
+ * @param cursors The cursor set.
+ * @return true if successful, false on allocation failure.
+ */
+bool CursorSetInit(CursorSet* cursors) {
+    if (!cursors) {
+        return false;
+    }
+    memset(cursors, 0, sizeof(*cursors));
+    if (!ReserveSelections(cursors, 8)) {
+        return false;
+    }
+    CursorSetReset(cursors, 0, 0);
+    return true;
+}
+
+/**
+ * @brief Releases the memory held by a cursor set.
+ *
+ * @param cursors The cursor set.
+ */
+void CursorSetFree(CursorSet* cursors) {
+    if (!cursors) {
+        return;
+    }
+    MemoryFree(cursors->items);
+    memset(cursors, 0, sizeof(*cursors));
+}
+
+/**
+ * @brief Replaces all selections with one selection.
+ *
+ * @param cursors The cursor set.
+ * @param anchor Anchor of the selection.
+ * @param caret Caret of the selection.
+ */
+void CursorSetReset(CursorSet* cursors, uint64_t anchor, uint64_t caret) {
+    if (!cursors || !ReserveSelections(cursors, 1)) {
+        return;
+    }
+    cursors->items[0].anchor = anchor;
+    cursors->items[0].caret = caret;
+    cursors->items[0].preferredColumn = CURSOR_NO_COLUMN;
+    cursors->count = 1;
+    cursors->primary = 0;
+}
+
+/**
+ * @brief Adds a selection and makes it primary.
+ *
+ * Overlapping selections are merged.
+ *
+ * @param cursors The cursor set.
+ * @param anchor Anchor of the new selection.
+ * @param caret Caret of the new selection.
+ * @return true if successful, false on allocation failure.
+ */
+bool CursorSetAdd(CursorSet* cursors, uint64_t anchor, uint64_t caret) {
+    if (!cursors || !ReserveSelections(cursors, cursors->count + 1)) {
+        return false;
+    }
+    Selection* selection = &cursors->items[cursors->count];
+    selection->anchor = anchor;
+    selection->caret = caret;
+    selection->preferredColumn = CURSOR_NO_COLUMN;
+    cursors->primary = cursors->count;
+    cursors->count++;
+    CursorSetNormalize(cursors);
+    return true;
+}
+
+/**
+ * @brief Sorts the selections and merges the ones that overlap.
+ *
+ * @param cursors The cursor set.
+ */
+void CursorSetNormalize(CursorSet* cursors) {
+    if (!cursors || cursors->count == 0) {
+        return;
+    }
+
+    // Remember the primary caret so it can be found again after sorting
+    uint64_t primaryCaret = cursors->items[cursors->primary < cursors->count ? cursors->primary : 0].caret;
+
+    if (cursors->count > 1) {
+        qsort(cursors->items, cursors->count, sizeof(Selection), CompareSelections);
+    }
+
+    // Merge selections that overlap, or carets that touch another selection
+    size_t out = 0;
+    for (size_t i = 1; i < cursors->count; i++) {
+        Selection* last = &cursors->items[out];
+        Selection* next = &cursors->items[i];
+        uint64_t lastStart = SelectionStart(last);
+        uint64_t lastEnd = SelectionEnd(last);
+        uint64_t nextStart = SelectionStart(next);
+        uint64_t nextEnd = SelectionEnd(next);
+        bool touching = nextStart == lastEnd && (nextStart == nextEnd || lastStart == lastEnd);
+        if (nextStart < lastEnd || touching) {
+            uint64_t end = nextEnd > lastEnd ? nextEnd : lastEnd;
+            // Keep the direction of the earlier selection
+            if (last->caret < last->anchor) {
+                last->anchor = end;
+            } else {
+                last->anchor = lastStart;
+                last->caret = end;
+            }
+            continue;
+        }
+        cursors->items[++out] = *next;
+    }
+    cursors->count = out + 1;
+
+    cursors->primary = 0;
+    for (size_t i = 0; i < cursors->count; i++) {
+        if (SelectionStart(&cursors->items[i]) <= primaryCaret && primaryCaret <= SelectionEnd(&cursors->items[i])) {
+            cursors->primary = i;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Finds the first selection that ends at or after an offset.
+ *
+ * @param cursors The cursor set (normalized).
+ * @param offset The offset.
+ * @return Index of the selection, or cursors->count if none.
+ */
+size_t CursorSetFindFirst(const CursorSet* cursors, uint64_t offset) {
+    size_t low = 0;
+    size_t high = cursors->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (SelectionEnd(&cursors->items[mid]) < offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Maps an offset through a list of changes.
+ *
+ * @param changes The changes, sorted and in pre-change coordinates.
+ * @param deltas Prefix sums of the size differences (changeCount + 1 entries).
+ * @param changeCount Number of changes.
+ * @param offset The offset before the changes.
+ * @return The offset after the changes.
+ */
+static uint64_t MapOffset(const DocumentChange* changes, const int64_t* deltas, size_t changeCount,
+                          uint64_t offset) {
+    // Find the first change that does not end before the offset
+    size_t low = 0;
+    size_t high = changeCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const DocumentChange* change = &changes[mid];
+        bool before = change->offset + change->removedLength < offset ||
+                      (change->offset + change->removedLength == offset && change->offset < offset) ||
+                      (change->removedLength == 0 && change->offset == offset);
+        if (before) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low < changeCount && changes[low].offset < offset) {
+        // Inside a removed range
+        return (uint64_t)((int64_t)changes[low].offset + deltas[low]) + changes[low].insertedLength;
+    }
+    return (uint64_t)((int64_t)offset + deltas[low]);
+}
+
+/**
+ * @brief Moves the selections through changes made outside the cursor set.
+ *
+ * Offsets after a change shift by its size; offsets inside a removed range
+ * move to the end of the text that replaced it.
+ *
+ * @param cursors The cursor set.
+ * @param changes The changes, sorted and in pre-change coordinates.
+ * @param changeCount Number of changes.
+ */
+void CursorSetMapChanges(CursorSet* cursors, const DocumentChange* changes, size_t changeCount) {
+    if (!cursors || !changes || changeCount == 0) {
+        return;
+    }
+
+    int64_t* deltas = (int64_t*)MemoryAlloc(MEMORY_TAG_EDITING, (changeCount + 1) * sizeof(int64_t));
+    if (!deltas) {
+        CursorSetReset(cursors, 0, 0);
+        return;
+    }
+    deltas[0] = 0;
+    for (size_t i = 0; i < changeCount; i++) {
+        deltas[i + 1] = deltas[i] + (int64_t)changes[i].insertedLength - (int64_t)changes[i].removedLength;
+    }
+
+    for (size_t i = 0; i < cursors->count; i++) {
+        Selection* selection = &cursors->items[i];
+        selection->anchor = MapOffset(changes, deltas, changeCount, selection->anchor);
+        selection->caret = MapOffset(changes, deltas, changeCount, selection->caret);
+        selection->preferredColumn = CURSOR_NO_COLUMN;
+    }
+    MemoryFree(deltas);
+    CursorSetNormalize(cursors);
+}
+
+/**
+ * @brief Moves a caret by a number of lines, keeping its display column.
+ *
+ * @param document The document.
+ * @param selection The selection whose caret moves.
+ * @param lines Signed number of lines.
+ */
+static void MoveVertically(const Document* document, Selection* selection, int64_t lines) {
+    uint64_t line = DocumentLineFromOffset(document, selection->caret);
+    if (selection->preferredColumn == CURSOR_NO_COLUMN) {
+        selection->preferredColumn =
+            LayoutColumnFromOffset(document, DocumentLineStart(document, line), selection->caret);
+    }
+
+    uint64_t lastLine = DocumentLineCount(document) - 1;
+    if (lines < 0 && (uint64_t)(-lines) > line) {
+        selection->caret = 0;
+        return;
+    }
+    if (lines > 0 && (uint64_t)lines > lastLine - line) {
+        selection->caret = DocumentLength(document);
+        return;
+    }
+    uint64_t target = (uint64_t)((int64_t)line + lines);
+    selection->caret = LayoutOffsetFromColumn(document, DocumentLineStart(document, target),
+                                              DocumentLineEnd(document, target), selection->preferredColumn);
+}
+
+/**
+ * @brief Finds the first non-blank character of the line containing an offset.
+ *
+ * @param document The document.
+ * @param lineStart Start of the line.
+ * @param lineEnd End of the line content.
+ * @return Offset of the first non-blank character, or lineEnd.
+ */
+static uint64_t FirstNonBlank(const Document* document, uint64_t lineStart, uint64_t lineEnd) {
+    uint64_t offset = lineStart;
+    while (offset < lineEnd) {
+        char c = DocumentCharAt(document, offset);
+        if (c != ' ' && c != '\t') {
+            break;
+        }
+        offset++;
+    }
+    return offset;
+}
+
+/**
+ * @brief Moves every caret.
+ *
+ * @param cursors The cursor set.
+ * @param document The document the carets are in.
+ * @param movement The movement to apply.
+ * @param extend true to extend the selections, false to collapse them.
+ * @param pageLines Number of lines moved by page movements.
+ */
+void CursorSetMove(CursorSet* cursors, const Document* document, CursorMovement movement, bool extend,
+                   uint64_t pageLines) {
+    if (!cursors || !document) {
+        return;
+    }
+    if (pageLines == 0) {
+        pageLines = 1;
+    }
+
+    for (size_t i = 0; i < cursors->count; i++) {
+        Selection* selection = &cursors->items[i];
+        bool vertical = movement == CURSOR_MOVE_UP || movement == CURSOR_MOVE_DOWN ||
+                        movement == CURSOR_MOVE_PAGE_UP || movement == CURSOR_MOVE_PAGE_DOWN;
+        if (!vertical) {
+            selection->preferredColumn = CURSOR_NO_COLUMN;
+        }
+
+        // Without shift, left and right collapse a selection to its edge
+        if (!extend && selection->anchor != selection->caret &&
+            (movement == CURSOR_MOVE_LEFT || movement == CURSOR_MOVE_RIGHT)) {
+            selection->caret = movement == CURSOR_MOVE_LEFT ? SelectionStart(selection) : SelectionEnd(selection);
+            selection->anchor = selection->caret;
+            continue;
+        }
+
+        switch (movement) {
+            case CURSOR_MOVE_LEFT:
+                selection->caret = BoundaryPreviousGrapheme(document, selection->caret);
+                break;
+            case CURSOR_MOVE_RIGHT:
+                selection->caret = BoundaryNextGrapheme(document, selection->caret);
+                break;
+            case CURSOR_MOVE_UP:
+                MoveVertically(document, selection, -1);
+                break;
+            case CURSOR_MOVE_DOWN:
+                MoveVertically(document, selection, 1);
+                break;
+            case CURSOR_MOVE_PAGE_UP:
+                MoveVertically(document, selection, -(int64_t)pageLines);
+                break;
+            case CURSOR_MOVE_PAGE_DOWN:
+                MoveVertically(document, selection, (int64_t)pageLines);
+                break;
+            case CURSOR_MOVE_WORD_LEFT:
+                selection->caret = BoundaryPreviousWord(document, selection->caret);
+                break;
+            case CURSOR_MOVE_WORD_RIGHT:
+                selection->caret = BoundaryNextWord(document, selection->caret);
+                break;
+            case CURSOR_MOVE_LINE_START: {
+                // Smart home: first non-blank character, then column 0
+                uint64_t line = DocumentLineFromOffset(document, selection->caret);
+                uint64_t lineStart = DocumentLineStart(document, line);
+                uint64_t firstText = FirstNonBlank(document, lineStart, DocumentLineEnd(document, line));
+                selection->caret = selection->caret == firstText ? lineStart : firstText;
+                break;
+            }
+            case CURSOR_MOVE_LINE_END:
+                selection->caret = DocumentLineEnd(document, DocumentLineFromOffset(document, selection->caret));
+                break;
+            case CURSOR_MOVE_DOCUMENT_START:
+                selection->caret = 0;
+                break;
+            case CURSOR_MOVE_DOCUMENT_END:
+                selection->caret = DocumentLength(document);
+                break;
+        }
+
+        if (!extend) {
+            selection->anchor = selection->caret;
+        }
+    }
+
+    CursorSetNormalize(cursors);
+}
+
+/**
+ * @brief Applies one edit per selection and collapses each selection after its edit.
+ *
+ * The edits must be sorted and must not overlap. The running delta of the
+ * earlier edits shifts every later caret, so the carets are placed in one pass.
+ *
+ * @param cursors The cursor set; count must match editCount.
+ * @param document The document to edit.
+ * @param edits The edits, one per selection.
+ * @param editCount Number of edits.
+ * @return true if successful, false otherwise.
+ */
+static bool ApplySelectionEdits(CursorSet* cursors, Document* document, const DocumentEdit* edits,
+                                size_t editCount) {
+    if (!DocumentApplyEdits(document, edits, editCount)) {
+        return false;
+    }
+
+    int64_t delta = 0;
+    for (size_t i = 0; i < editCount; i++) {
+        uint64_t caret = (uint64_t)((int64_t)edits[i].offset + delta) + edits[i].textLength;
+        cursors->items[i].anchor = caret;
+        cursors->items[i].caret = caret;
+        cursors->items[i].preferredColumn = CURSOR_NO_COLUMN;
+        delta += (int64_t)edits[i].textLength - (int64_t)edits[i].removeLength;
+    }
+    cursors->count = editCount;
+    CursorSetNormalize(cursors);
+    return true;
+}
+
+/**
+ * @brief Replaces every selection with the same text as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param text The text to insert.
+ * @param textLength Length of the text.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetInsert(CursorSet* cursors, Document* document, const char* text, size_t textLength) {
+    if (!cursors || !document || cursors->count == 0) {
+        return false;
+    }
+
+    DocumentEdit* edits = (DocumentEdit*)MemoryAlloc(MEMORY_TAG_EDITING, cursors->count * sizeof(DocumentEdit));
+    if (!edits) {
+        return false;
+    }
+    for (size_t i = 0; i < cursors->count; i++) {
+        uint64_t start = SelectionStart(&cursors->items[i]);
+        edits[i].offset = start;
+        edits[i].removeLength = SelectionEnd(&cursors->items[i]) - start;
+        edits[i].text = text;
+        edits[i].textLength = textLength;
+        edits[i].slice = NULL;
+    }
+
+    bool result = ApplySelectionEdits(cursors, document, edits, cursors->count);
+    MemoryFree(edits);
+    return result;
+}
+
+/**
+ * @brief Replaces each selection with its own text as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param texts One text per selection, in selection order.
+ * @param textLengths Length of each text.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetInsertEach(CursorSet* cursors, Document* document, const char* const* texts,
+                         const size_t* textLengths) {
+    if (!cursors || !document || !texts || !textLengths || cursors->count == 0) {
+        return false;
+    }
+
+    DocumentEdit* edits = (DocumentEdit*)MemoryAlloc(MEMORY_TAG_EDITING, cursors->count * sizeof(DocumentEdit));
+    if (!edits) {
+        return false;
+    }
+    for (size_t i = 0; i < cursors->count; i++) {
+        uint64_t start = SelectionStart(&cursors->items[i]);
+        edits[i].offset = start;
+        edits[i].removeLength = SelectionEnd(&cursors->items[i]) - start;
+        edits[i].text = texts[i];
+        edits[i].textLength = textLengths[i];
+        edits[i].slice = NULL;
+    }
+
+    bool result = ApplySelectionEdits(cursors, document, edits, cursors->count);
+    MemoryFree(edits);
+    return result;
+}
+
+/**
+ * @brief Replaces each selection with a slice of the document as one batch.
+ *
+ * The pieces of the slices are shared, so no text is copied however large
+ * the slices are.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param slices One slice of the document per selection, in selection order.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetInsertSlices(CursorSet* cursors, Document* document, const DocumentSlice* const* slices) {
+    if (!cursors || !document || !slices || cursors->count == 0) {
+        return false;
+    }
+
+    DocumentEdit* edits = (DocumentEdit*)MemoryAlloc(MEMORY_TAG_EDITING, cursors->count * sizeof(DocumentEdit));
+    if (!edits) {
+        return false;
+    }
+    for (size_t i = 0; i < cursors->count; i++) {
+        uint64_t start = SelectionStart(&cursors->items[i]);
+        uint64_t length = DocumentSliceLength(slices[i]);
+        if (length > (uint64_t)SIZE_MAX) {
+            MemoryFree(edits);
+            return false;
+        }
+        edits[i].offset = start;
+        edits[i].removeLength = SelectionEnd(&cursors->items[i]) - start;
+        edits[i].text = NULL;
+        edits[i].textLength = (size_t)length;
+        edits[i].slice = slices[i];
+    }
+
+    bool result = ApplySelectionEdits(cursors, document, edits, cursors->count);
+    MemoryFree(edits);
+    return result;
+}
+
+/**
+ * @brief Deletes the selections, or one character or word next to each empty caret.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @param forward true to delete after empty carets, false to delete before them.
+ * @param word true to delete to the word boundary, false to delete one grapheme cluster.
+ * @return true if successful, false otherwise.
+ */
+static bool DeleteAtCursors(CursorSet* cursors, Document* document, bool forward, bool word) {
+    if (!cursors || !document || cursors->count == 0) {
+        return false;
+    }
+
+    DocumentEdit* edits = (DocumentEdit*)MemoryAlloc(MEMORY_TAG_EDITING, cursors->count * sizeof(DocumentEdit));
+    if (!edits) {
+        return false;
+    }
+
+    // Expanding empty carets can make neighbouring ranges overlap, so merge as we go
+    size_t count = 0;
+    for (size_t i = 0; i < cursors->count; i++) {
+        Selection* selection = &cursors->items[i];
+        uint64_t start = SelectionStart(selection);
+        uint64_t end = SelectionEnd(selection);
+        if (start == end) {
+            if (forward) {
+                end = word ? BoundaryNextWord(document, end) : BoundaryNextGrapheme(document, end);
+            } else {
+                start = word ? BoundaryPreviousWord(document, start) : BoundaryPreviousGrapheme(document, start);
+            }
+        }
+        if (count > 0) {
+            DocumentEdit* previous = &edits[count - 1];
+            uint64_t previousEnd = previous->offset + previous->removeLength;
+            if (start < previousEnd) {
+                previous->removeLength = (end > previousEnd ? end : previousEnd) - previous->offset;
+                continue;
+            }
+        }
+        edits[count].offset = start;
+        edits[count].removeLength = end - start;
+        edits[count].text = NULL;
+        edits[count].textLength = 0;
+        edits[count].slice = NULL;
+        count++;
+    }
+
+    bool result = ApplySelectionEdits(cursors, document, edits, count);
+    MemoryFree(edits);
+    return result;
+}
+
+/**
+ * @brief Deletes the selections, or the grapheme cluster before each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteBackward(CursorSet* cursors, Document* document) {
+    return DeleteAtCursors(cursors, document, false, false);
+}
+
+/**
+ * @brief Deletes the selections, or the grapheme cluster after each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteForward(CursorSet* cursors, Document* document) {
+    return DeleteAtCursors(cursors, document, true, false);
+}
+
+/**
+ * @brief Deletes the selections, or back to the start of the word before each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteWordBackward(CursorSet* cursors, Document* document) {
+    return DeleteAtCursors(cursors, document, false, true);
+}
+
+/**
+ * @brief Deletes the selections, or up to the start of the next word after each empty caret, as one batch.
+ *
+ * @param cursors The cursor set.
+ * @param document The document to edit.
+ * @return true if successful, false otherwise.
+ */
+bool CursorSetDeleteWordForward(CursorSet* cursors, Document* document) {
+    return DeleteAtCursors(cursors, document, true, true);
+}
+
+/**
+ * @brief Adds a caret on the line above the first caret or below the last one.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @param below true to add below the last caret, false to add above the first.
+ * @return true if a caret was added, false otherwise.
+ */
+bool CursorSetAddVertical(CursorSet* cursors, const Document* document, bool below) {
+    if (!cursors || !document || cursors->count == 0) {
+        return false;
+    }
+
+    Selection edge = cursors->items[below ? cursors->count - 1 : 0];
+    uint64_t line = DocumentLineFromOffset(document, edge.caret);
+    if ((below && line + 1 >= DocumentLineCount(document)) || (!below && line == 0)) {
+        return false;
+    }
+
+    uint64_t column = edge.preferredColumn;
+    if (column == CURSOR_NO_COLUMN) {
+        column = LayoutColumnFromOffset(document, DocumentLineStart(document, line), edge.caret);
+    }
+    uint64_t target = below ? line + 1 : line - 1;
+    uint64_t caret = LayoutOffsetFromColumn(document, DocumentLineStart(document, target),
+                                            DocumentLineEnd(document, target), column);
+    if (!CursorSetAdd(cursors, caret, caret)) {
+        return false;
+    }
+
+    // Keep the column so repeated adds stay aligned across short lines
+    cursors->items[cursors->primary].preferredColumn = column;
+    return true;
+}
+
+/**
+ * @brief Expands an empty selection to the word around its caret.
+ *
+ * @param document The document.
+ * @param selection The selection.
+ * @return true if a word was found, false otherwise.
+ */
+static bool SelectWordAt(const Document* document, Selection* selection) {
+    uint64_t start;
+    uint64_t end;
+    if (!BoundaryWordAt(document, selection->caret, &start, &end)) {
+        return false;
+    }
+    selection->anchor = start;
+    selection->caret = end;
+    selection->preferredColumn = CURSOR_NO_COLUMN;
+    return true;
+}
+
+/**
+ * @brief Copies the text of the primary selection for use as a search pattern.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @param[out] pattern Receives the text (SEARCH_MAX_PATTERN bytes).
+ * @return Length of the pattern, or 0 if the selection is empty or too long.
+ */
+static size_t PrimaryPattern(const CursorSet* cursors, const Document* document, char* pattern) {
+    const Selection* primary = &cursors->items[cursors->primary];
+    uint64_t length = SelectionEnd(primary) - SelectionStart(primary);
+    if (length == 0 || length > SEARCH_MAX_PATTERN) {
+        return 0;
+    }
+    return DocumentRead(document, SelectionStart(primary), pattern, (size_t)length);
+}
+
+/**
+ * @brief Selects the next occurrence of the primary selection.
+ *
+ * With an empty primary selection, the word around the caret is selected
+ * instead.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @return true if the selection changed, false otherwise.
+ */
+bool CursorSetAddNextOccurrence(CursorSet* cursors, const Document* document) {
+    if (!cursors || !document || cursors->count == 0) {
+        return false;
+    }
+
+    Selection* primary = &cursors->items[cursors->primary];
+    if (primary->anchor == primary->caret) {
+        bool selected = SelectWordAt(document, primary);
+        CursorSetNormalize(cursors);
+        return selected;
+    }
+
+    char pattern[SEARCH_MAX_PATTERN];
+    size_t patternLength = PrimaryPattern(cursors, document, pattern);
+    if (patternLength == 0) {
+        return false;
+    }
+
+    // Search after the last selection and wrap around to the start
+    uint64_t from = SelectionEnd(&cursors->items[cursors->count - 1]);
+    uint64_t match = 0;
+    bool found = SearchFindNext(document, pattern, patternLength, from, true, &match);
+    if (!found) {
+        found = SearchFindNext(document, pattern, patternLength, 0, true, &match);
+    }
+    if (!found) {
+        return false;
+    }
+
+    // Skip matches that are already selected
+    size_t existing = CursorSetFindFirst(cursors, match + patternLength);
+    if (existing < cursors->count && SelectionStart(&cursors->items[existing]) == match &&
+        SelectionEnd(&cursors->items[existing]) == match + patternLength) {
+        return false;
+    }
+    return CursorSetAdd(cursors, match, match + patternLength);
+}
+
+// Collects matches into a new selection array
+typedef struct {
+    CursorSet* target;
+    size_t patternLength;
+    bool failed;
+} OccurrenceCollector;
+
+/**
+ * @brief Appends a search match as a selection.
+ */
+static bool CollectOccurrence(uint64_t offset, void* context) {
+    OccurrenceCollector* collector = (OccurrenceCollector*)context;
+    CursorSet* target = collector->target;
+    if (!ReserveSelections(target, target->count + 1)) {
+        collector->failed = true;
+        return false;
+    }
+    Selection* selection = &target->items[target->count++];
+    selection->anchor = offset;
+    selection->caret = offset + collector->patternLength;
+    selection->preferredColumn = CURSOR_NO_COLUMN;
+    return true;
+}
+
+/**
+ * @brief Selects every occurrence of the primary selection.
+ *
+ * @param cursors The cursor set.
+ * @param document The document.
+ * @return true if the selection changed, false otherwise.
+ */
+bool CursorSetSelectAllOccurrences(CursorSet* cursors, const Document* document) {
+    if (!cursors || !document || cursors->count == 0) {
+        return false;
+    }
+
+    Selection* primary = &cursors->items[cursors->primary];
+    if (primary->anchor == primary->caret && !SelectWordAt(document, primary)) {
+        return false;
+    }
+
+    char pattern[SEARCH_MAX_PATTERN];
+    size_t patternLength = PrimaryPattern(cursors, document, pattern);
+    if (patternLength == 0) {
+        return false;
+    }
+    uint64_t primaryStart = SelectionStart(primary);
+
+    CursorSet matches;
+    memset(&matches, 0, sizeof(matches));
+    OccurrenceCollector collector = { &matches, patternLength, false };
+    SearchFindAll(document, pattern, patternLength, 0, DocumentLength(document), true, CollectOccurrence,
+                  &collector);
+    if (collector.failed || matches.count == 0) {
+        CursorSetFree(&matches);
+        return false;
+    }
+
+    CursorSetFree(cursors);
+    *cursors = matches;
+    cursors->primary = CursorSetFindFirst(cursors, primaryStart);
+    if (cursors->primary >= cursors->count) {
+        cursors->primary = cursors->count - 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Places a caret at the end of every change (used after undo and redo).
+ *
+ * @param cursors The cursor set.
+ * @param changes The changes that were applied.
+ * @param changeCount Number of changes.
+ */
+void CursorSetPlaceAfterChanges(CursorSet* cursors, const DocumentChange* changes, size_t changeCount) {
+    if (!cursors || !changes || changeCount == 0 || !ReserveSelections(cursors, changeCount)) {
+        return;
+    }
+
+    int64_t delta = 0;
+    for (size_t i = 0; i < changeCount; i++) {
+        uint64_t caret = (uint64_t)((int64_t)changes[i].offset + delta) + changes[i].insertedLength;
+        cursors->items[i].anchor = caret;
+        cursors->items[i].caret = caret;
+        cursors->items[i].preferredColumn = CURSOR_NO_COLUMN;
+        delta += (int64_t)changes[i].insertedLength - (int64_t)changes[i].removedLength;
+    }
+    cursors->count = changeCount;
+    cursors->primary = 0;
+    CursorSetNormalize(cursors);
+}
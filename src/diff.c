@@ -0,0 +1,921 @@
+/**
+ * @file diff.c
+ * @brief Line diff implementation for the Professional Text Editor
+ *
+ * The diff runs in three stages. Runs of the document that still reference
+ * the loaded file become anchors that are known to be equal without being
+ * read. Between anchors (or over the whole text when nothing is shared) the
+ * common prefix and suffix are trimmed with byte comparisons. What remains
+ * is hashed to one 64-bit integer per line and compared with the linear
+ * space variant of the Myers algorithm. Lines whose hashes match are also
+ * compared byte by byte, so a hash collision cannot hide a change.
+ */
+
+#include "../include/diff.h"
+#include "../include/hash.h"
+#include "../include/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Edit distance above which a block is reported as one replacement
+#define DIFF_MAX_COST 4096
+
+// Bytes compared per block when trimming the common suffix
+#define DIFF_COMPARE_BLOCK (64 * 1024)
+
+// State shared by the stages of one comparison
+typedef struct {
+    const Document* document;
+    const char* oldText;
+    uint64_t oldLength;
+    const LineIndex* oldLines;
+    uint64_t newLength;
+    DiffResult* result;
+    char* scratch;              // Holds lines that span several document pieces
+    size_t scratchCapacity;
+    uint64_t* newStarts;        // Offsets of the document lines of the block being diffed, and of its end
+    uint64_t newStartsLine;     // Line number of newStarts[0]
+    bool failed;
+} DiffContext;
+
+// A block of lines known to be equal on both sides
+typedef struct {
+    uint64_t oldLine;
+    uint64_t newLine;
+    uint64_t count;
+} DiffAnchor;
+
+// Anchors collected from the original runs of the document
+typedef struct {
+    DiffContext* context;
+    DiffAnchor* anchors;
+    size_t count;
+    size_t capacity;
+} AnchorList;
+
+// Growable output buffer for DiffFormatUnified
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} TextBuilder;
+
+/**
+ * @brief Appends a hunk, merging it with the previous one when they touch.
+ *
+ * @param context The diff context.
+ * @param oldLine First old line.
+ * @param oldCount Number of old lines.
+ * @param newLine First new line.
+ * @param newCount Number of new lines.
+ */
+static void AddHunk(DiffContext* context, uint64_t oldLine, uint64_t oldCount, uint64_t newLine,
+                    uint64_t newCount) {
+    if (oldCount == 0 && newCount == 0) {
+        return;
+    }
+
+    DiffResult* result = context->result;
+    if (result->count > 0) {
+        DiffHunk* last = &result->hunks[result->count - 1];
+        if (last->oldLine + last->oldCount == oldLine && last->newLine + last->newCount == newLine) {
+            last->oldCount += oldCount;
+            last->newCount += newCount;
+            return;
+        }
+    }
+
+    if (result->count == result->capacity) {
+        size_t capacity = result->capacity ? result->capacity * 2 : 64;
+        DiffHunk* hunks = (DiffHunk*)MemoryRealloc(MEMORY_TAG_DIFF, result->hunks, capacity * sizeof(DiffHunk));
+        if (!hunks) {
+            context->failed = true;
+            return;
+        }
+        result->hunks = hunks;
+        result->capacity = capacity;
+    }
+
+    DiffHunk* hunk = &result->hunks[result->count++];
+    hunk->oldLine = oldLine;
+    hunk->oldCount = oldCount;
+    hunk->newLine = newLine;
+    hunk->newCount = newCount;
+}
+
+/**
+ * @brief Gets the byte range of an old line, including its terminator.
+ *
+ * @param context The diff context.
+ * @param line The line.
+ * @param[out] start Receives the start offset.
+ * @param[out] end Receives the end offset.
+ */
+static void OldLineRange(const DiffContext* context, uint64_t line, uint64_t* start, uint64_t* end) {
+    const LineIndex* lines = context->oldLines;
+    *start = lines->starts[line];
+    *end = line + 1 < lines->count ? lines->starts[line + 1] : context->oldLength;
+}
+
+/**
+ * @brief Gets the byte range of a document line, including its terminator.
+ *
+ * @param context The diff context.
+ * @param line The line.
+ * @param[out] start Receives the start offset.
+ * @param[out] end Receives the end offset.
+ */
+static void NewLineRange(const DiffContext* context, uint64_t line, uint64_t* start, uint64_t* end) {
+    *start = DocumentLineStart(context->document, line);
+    *end = line + 1 < DocumentLineCount(context->document)
+        ? DocumentLineStart(context->document, line + 1)
+        : context->newLength;
+}
+
+/**
+ * @brief Hashes a range of old lines.
+ *
+ * @param context The diff context.
+ * @param first First line.
+ * @param count Number of lines.
+ * @param[out] hashes Receives one hash per line.
+ */
+static void HashOldLines(const DiffContext* context, uint64_t first, size_t count, uint64_t* hashes) {
+    for (size_t i = 0; i < count; i++) {
+        uint64_t start;
+        uint64_t end;
+        OldLineRange(context, first + i, &start, &end);
+        hashes[i] = HashBytes64(context->oldText + start, (size_t)(end - start), 0);
+    }
+}
+
+/**
+ * @brief Appends bytes to the scratch line buffer.
+ *
+ * @param context The diff context.
+ * @param used Bytes already in the scratch buffer.
+ * @param data The bytes to append.
+ * @param length Number of bytes.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AppendScratch(DiffContext* context, size_t used, const char* data, size_t length) {
+    if (used + length > context->scratchCapacity) {
+        size_t capacity = context->scratchCapacity ? context->scratchCapacity : 4096;
+        while (capacity < used + length) {
+            capacity *= 2;
+        }
+        char* scratch = (char*)MemoryRealloc(MEMORY_TAG_DIFF, context->scratch, capacity);
+        if (!scratch) {
+            context->failed = true;
+            return false;
+        }
+        context->scratch = scratch;
+        context->scratchCapacity = capacity;
+    }
+    memcpy(context->scratch + used, data, length);
+    return true;
+}
+
+/**
+ * @brief Hashes a range of document lines while streaming the document pieces.
+ *
+ * Lines that lie inside one piece are hashed in place; only lines that
+ * cross a piece boundary are copied.
+ *
+ * @param context The diff context.
+ * @param first First line.
+ * @param count Number of lines.
+ * @param[out] hashes Receives one hash per line.
+ * @param[out] starts Receives the offset of each line and, after them, the end of the last one.
+ */
+static void HashNewLines(DiffContext* context, uint64_t first, size_t count, uint64_t* hashes, uint64_t* starts) {
+    DocumentIterator iterator;
+    uint64_t offset = DocumentLineStart(context->document, first);
+    DocumentIterInit(context->document, offset, &iterator);
+
+    size_t done = 0;
+    size_t pending = 0;
+    starts[0] = offset;
+    const char* span;
+    size_t spanLength;
+    while (done < count && DocumentIterNext(&iterator, &span, &spanLength)) {
+        while (done < count && spanLength > 0) {
+            const char* lineFeed = (const char*)memchr(span, '\n', spanLength);
+            if (!lineFeed) {
+                if (!AppendScratch(context, pending, span, spanLength)) {
+                    return;
+                }
+                pending += spanLength;
+                break;
+            }
+
+            size_t take = (size_t)(lineFeed - span) + 1;
+            if (pending == 0) {
+                hashes[done++] = HashBytes64(span, take, 0);
+            } else {
+                if (!AppendScratch(context, pending, span, take)) {
+                    return;
+                }
+                hashes[done++] = HashBytes64(context->scratch, pending + take, 0);
+            }
+            offset += pending + take;
+            starts[done] = offset;
+            pending = 0;
+            span += take;
+            spanLength -= take;
+        }
+    }
+
+    // The last line of the document has no terminator
+    if (done < count) {
+        hashes[done++] = HashBytes64(context->scratch, pending, 0);
+        starts[done] = offset + pending;
+    }
+}
+
+/**
+ * @brief Checks whether an old line and a document line of the current block are equal.
+ *
+ * The hashes decide unless they match; matching lines are compared byte by
+ * byte so that a collision is not taken for an unchanged line.
+ *
+ * @param context The diff context.
+ * @param oldHash Hash of the old line.
+ * @param newHash Hash of the document line.
+ * @param oldLine The old line.
+ * @param newLine The document line, inside the block whose starts were recorded.
+ * @return true if the lines hold the same bytes, false otherwise.
+ */
+static bool LinesEqual(const DiffContext* context, uint64_t oldHash, uint64_t newHash, uint64_t oldLine,
+                       uint64_t newLine) {
+    if (oldHash != newHash) {
+        return false;
+    }
+
+    uint64_t oldStart;
+    uint64_t oldEnd;
+    OldLineRange(context, oldLine, &oldStart, &oldEnd);
+    const uint64_t* starts = context->newStarts + (newLine - context->newStartsLine);
+    if (starts[1] - starts[0] != oldEnd - oldStart) {
+        return false;
+    }
+
+    DocumentIterator iterator;
+    DocumentIterInit(context->document, starts[0], &iterator);
+    const char* old = context->oldText + oldStart;
+    uint64_t remaining = oldEnd - oldStart;
+    const char* span;
+    size_t spanLength;
+    while (remaining > 0 && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t take = spanLength < remaining ? spanLength : (size_t)remaining;
+        if (memcmp(span, old, take) != 0) {
+            return false;
+        }
+        old += take;
+        remaining -= take;
+    }
+    return remaining == 0;
+}
+
+/**
+ * @brief Finds the middle snake of two hash sequences (Myers, linear space).
+ *
+ * @param context The diff context.
+ * @param a Old hashes.
+ * @param oldLine Line number of a[0].
+ * @param n Number of old hashes.
+ * @param b New hashes.
+ * @param newLine Line number of b[0].
+ * @param m Number of new hashes.
+ * @param v1 Forward furthest-reaching array.
+ * @param v2 Backward furthest-reaching array.
+ * @param[out] splitX Receives the old split point.
+ * @param[out] splitY Receives the new split point.
+ * @return true if a split was found within DIFF_MAX_COST, false otherwise.
+ */
+static bool Bisect(const DiffContext* context, const uint64_t* a, uint64_t oldLine, int64_t n, const uint64_t* b,
+                   uint64_t newLine, int64_t m, int64_t* v1, int64_t* v2, int64_t* splitX, int64_t* splitY) {
+    int64_t maxD = (n + m + 1) / 2;
+    if (maxD > DIFF_MAX_COST) {
+        maxD = DIFF_MAX_COST;
+    }
+    int64_t vOffset = maxD + 1;
+    int64_t vLength = 2 * maxD + 3;
+    for (int64_t i = 0; i < vLength; i++) {
+        v1[i] = -1;
+        v2[i] = -1;
+    }
+    v1[vOffset + 1] = 0;
+    v2[vOffset + 1] = 0;
+
+    int64_t delta = n - m;
+    bool front = (delta % 2) != 0;
+    int64_t k1Start = 0;
+    int64_t k1End = 0;
+    int64_t k2Start = 0;
+    int64_t k2End = 0;
+    for (int64_t d = 0; d < maxD; d++) {
+        // Walk the forward path one step
+        for (int64_t k1 = -d + k1Start; k1 <= d - k1End; k1 += 2) {
+            int64_t k1Offset = vOffset + k1;
+            int64_t x1 = (k1 == -d || (k1 != d && v1[k1Offset - 1] < v1[k1Offset + 1]))
+                ? v1[k1Offset + 1]
+                : v1[k1Offset - 1] + 1;
+            int64_t y1 = x1 - k1;
+            while (x1 < n && y1 < m &&
+                   LinesEqual(context, a[x1], b[y1], oldLine + (uint64_t)x1, newLine + (uint64_t)y1)) {
+                x1++;
+                y1++;
+            }
+            v1[k1Offset] = x1;
+            if (x1 > n) {
+                k1End += 2;
+            } else if (y1 > m) {
+                k1Start += 2;
+            } else if (front) {
+                int64_t k2Offset = vOffset + delta - k1;
+                if (k2Offset >= 0 && k2Offset < vLength && v2[k2Offset] != -1 && x1 >= n - v2[k2Offset]) {
+                    *splitX = x1;
+                    *splitY = y1;
+                    return true;
+                }
+            }
+        }
+
+        // Walk the reverse path one step
+        for (int64_t k2 = -d + k2Start; k2 <= d - k2End; k2 += 2) {
+            int64_t k2Offset = vOffset + k2;
+            int64_t x2 = (k2 == -d || (k2 != d && v2[k2Offset - 1] < v2[k2Offset + 1]))
+                ? v2[k2Offset + 1]
+                : v2[k2Offset - 1] + 1;
+            int64_t y2 = x2 - k2;
+            while (x2 < n && y2 < m &&
+                   LinesEqual(context, a[n - x2 - 1], b[m - y2 - 1], oldLine + (uint64_t)(n - x2 - 1),
+                              newLine + (uint64_t)(m - y2 - 1))) {
+                x2++;
+                y2++;
+            }
+            v2[k2Offset] = x2;
+            if (x2 > n) {
+                k2End += 2;
+            } else if (y2 > m) {
+                k2Start += 2;
+            } else if (!front) {
+                int64_t k1Offset = vOffset + delta - k2;
+                if (k1Offset >= 0 && k1Offset < vLength && v1[k1Offset] != -1) {
+                    int64_t x1 = v1[k1Offset];
+                    int64_t y1 = vOffset + x1 - k1Offset;
+                    if (x1 >= n - x2) {
+                        *splitX = x1;
+                        *splitY = y1;
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Diffs two hash sequences and appends the hunks.
+ *
+ * @param context The diff context.
+ * @param a Old hashes.
+ * @param oldLine Line number of a[0].
+ * @param n Number of old hashes.
+ * @param b New hashes.
+ * @param newLine Line number of b[0].
+ * @param m Number of new hashes.
+ * @param v1 Scratch array for Bisect.
+ * @param v2 Scratch array for Bisect.
+ */
+static void DiffHashes(DiffContext* context, const uint64_t* a, uint64_t oldLine, size_t n, const uint64_t* b,
+                       uint64_t newLine, size_t m, int64_t* v1, int64_t* v2) {
+    // Trim the common prefix and suffix
+    size_t prefix = 0;
+    while (prefix < n && prefix < m && LinesEqual(context, a[prefix], b[prefix], oldLine + prefix, newLine + prefix)) {
+        prefix++;
+    }
+    a += prefix;
+    b += prefix;
+    n -= prefix;
+    m -= prefix;
+    oldLine += prefix;
+    newLine += prefix;
+    while (n > 0 && m > 0 && LinesEqual(context, a[n - 1], b[m - 1], oldLine + n - 1, newLine + m - 1)) {
+        n--;
+        m--;
+    }
+
+    if (n == 0 || m == 0) {
+        AddHunk(context, oldLine, n, newLine, m);
+        return;
+    }
+
+    int64_t x;
+    int64_t y;
+    if (!Bisect(context, a, oldLine, (int64_t)n, b, newLine, (int64_t)m, v1, v2, &x, &y)) {
+        // Too many differences to be worth an exact answer
+        AddHunk(context, oldLine, n, newLine, m);
+        return;
+    }
+    DiffHashes(context, a, oldLine, (size_t)x, b, newLine, (size_t)y, v1, v2);
+    DiffHashes(context, a + x, oldLine + (uint64_t)x, n - (size_t)x, b + y, newLine + (uint64_t)y,
+               m - (size_t)y, v1, v2);
+}
+
+/**
+ * @brief Diffs a block of old lines against a block of document lines.
+ *
+ * @param context The diff context.
+ * @param oldLine First old line.
+ * @param oldCount Number of old lines.
+ * @param newLine First document line.
+ * @param newCount Number of document lines.
+ */
+static void DiffLineBlock(DiffContext* context, uint64_t oldLine, uint64_t oldCount, uint64_t newLine,
+                          uint64_t newCount) {
+    if (oldCount == 0 || newCount == 0) {
+        AddHunk(context, oldLine, oldCount, newLine, newCount);
+        return;
+    }
+
+    uint64_t cost = (oldCount + newCount + 1) / 2;
+    if (cost > DIFF_MAX_COST) {
+        cost = DIFF_MAX_COST;
+    }
+    uint64_t* a = (uint64_t*)MemoryAlloc(MEMORY_TAG_DIFF, (size_t)oldCount * sizeof(uint64_t));
+    uint64_t* b = (uint64_t*)MemoryAlloc(MEMORY_TAG_DIFF, (size_t)newCount * sizeof(uint64_t));
+    uint64_t* starts = (uint64_t*)MemoryAlloc(MEMORY_TAG_DIFF, ((size_t)newCount + 1) * sizeof(uint64_t));
+    int64_t* v1 = (int64_t*)MemoryAlloc(MEMORY_TAG_DIFF, (size_t)(2 * cost + 3) * sizeof(int64_t));
+    int64_t* v2 = (int64_t*)MemoryAlloc(MEMORY_TAG_DIFF, (size_t)(2 * cost + 3) * sizeof(int64_t));
+    if (a && b && starts && v1 && v2) {
+        HashOldLines(context, oldLine, (size_t)oldCount, a);
+        HashNewLines(context, newLine, (size_t)newCount, b, starts);
+        context->newStarts = starts;
+        context->newStartsLine = newLine;
+        if (!context->failed) {
+            DiffHashes(context, a, oldLine, (size_t)oldCount, b, newLine, (size_t)newCount, v1, v2);
+        }
+    } else {
+        context->failed = true;
+    }
+    context->newStarts = NULL;
+    MemoryFree(a);
+    MemoryFree(b);
+    MemoryFree(starts);
+    MemoryFree(v1);
+    MemoryFree(v2);
+}
+
+/**
+ * @brief Counts the equal bytes at the start of both sides.
+ *
+ * @param context The diff context.
+ * @return Length of the common prefix in bytes.
+ */
+static uint64_t CommonPrefixBytes(const DiffContext* context) {
+    uint64_t limit = context->oldLength < context->newLength ? context->oldLength : context->newLength;
+    DocumentIterator iterator;
+    DocumentIterInit(context->document, 0, &iterator);
+
+    uint64_t position = 0;
+    const char* span;
+    size_t spanLength;
+    while (position < limit && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t length = spanLength < limit - position ? spanLength : (size_t)(limit - position);
+        const char* old = context->oldText + position;
+        if (memcmp(span, old, length) != 0) {
+            size_t i = 0;
+            while (span[i] == old[i]) {
+                i++;
+            }
+            return position + i;
+        }
+        position += length;
+    }
+    return position;
+}
+
+/**
+ * @brief Counts the equal bytes at the end of both sides.
+ *
+ * @param context The diff context.
+ * @param limit Maximum number of bytes to compare.
+ * @return Length of the common suffix in bytes.
+ */
+static uint64_t CommonSuffixBytes(DiffContext* context, uint64_t limit) {
+    if (context->scratchCapacity < DIFF_COMPARE_BLOCK) {
+        char* scratch = (char*)MemoryRealloc(MEMORY_TAG_DIFF, context->scratch, DIFF_COMPARE_BLOCK);
+        if (!scratch) {
+            // Without a buffer the suffix is simply not trimmed
+            return 0;
+        }
+        context->scratch = scratch;
+        context->scratchCapacity = DIFF_COMPARE_BLOCK;
+    }
+
+    uint64_t matched = 0;
+    while (matched < limit) {
+        size_t block = limit - matched < DIFF_COMPARE_BLOCK ? (size_t)(limit - matched) : DIFF_COMPARE_BLOCK;
+        uint64_t newStart = context->newLength - matched - block;
+        const char* old = context->oldText + (context->oldLength - matched - block);
+        if (DocumentRead(context->document, newStart, context->scratch, block) != block) {
+            return matched;
+        }
+        if (memcmp(context->scratch, old, block) != 0) {
+            size_t i = block;
+            while (context->scratch[i - 1] == old[i - 1]) {
+                i--;
+            }
+            return matched + (block - i);
+        }
+        matched += block;
+    }
+    return matched;
+}
+
+/**
+ * @brief Diffs the whole document without shared storage, trimming equal ends first.
+ *
+ * @param context The diff context.
+ */
+static void DiffUnshared(DiffContext* context) {
+    uint64_t oldLineCount = context->oldLines->count;
+    uint64_t newLineCount = DocumentLineCount(context->document);
+
+    uint64_t prefixBytes = CommonPrefixBytes(context);
+    if (prefixBytes == context->oldLength && prefixBytes == context->newLength) {
+        return;
+    }
+
+    // Lines that end before the first difference are equal on both sides
+    uint64_t prefixLines = LineIndexLineFromOffset(context->oldLines, prefixBytes);
+
+    uint64_t limit = (context->oldLength < context->newLength ? context->oldLength : context->newLength) -
+                     prefixBytes;
+    uint64_t suffixBytes = CommonSuffixBytes(context, limit);
+    uint64_t suffixLines = 0;
+    if (suffixBytes > 0) {
+        uint64_t firstSuffixLine = LineIndexLineFromOffset(context->oldLines, context->oldLength - suffixBytes) + 1;
+        suffixLines = oldLineCount - firstSuffixLine;
+    }
+    if (suffixLines > oldLineCount - prefixLines) {
+        suffixLines = oldLineCount - prefixLines;
+    }
+    if (suffixLines > newLineCount - prefixLines) {
+        suffixLines = newLineCount - prefixLines;
+    }
+
+    DiffLineBlock(context, prefixLines, oldLineCount - prefixLines - suffixLines, prefixLines,
+                  newLineCount - prefixLines - suffixLines);
+}
+
+/**
+ * @brief Turns one original run of the document into an anchor of whole equal lines.
+ *
+ * @param offset Offset of the run in the document.
+ * @param originalOffset Offset of the run in the old text.
+ * @param length Length of the run.
+ * @param context The anchor list.
+ * @return true to continue, false on allocation failure.
+ */
+static bool CollectAnchor(uint64_t offset, uint64_t originalOffset, uint64_t length, void* context) {
+    AnchorList* list = (AnchorList*)context;
+    DiffContext* diff = list->context;
+    const char* text = diff->oldText;
+
+    // The run starts a line on both sides only if both preceding bytes are line feeds
+    uint64_t start = originalOffset;
+    bool newLineStart = offset == 0 || DocumentCharAt(diff->document, offset - 1) == '\n';
+    bool oldLineStart = originalOffset == 0 || text[originalOffset - 1] == '\n';
+    if (!newLineStart || !oldLineStart) {
+        const char* lineFeed = (const char*)memchr(text + originalOffset, '\n', (size_t)length);
+        if (!lineFeed) {
+            return true;
+        }
+        start = (uint64_t)(lineFeed - text) + 1;
+    }
+
+    // Stop after the last complete line, unless the run ends both texts
+    uint64_t end = originalOffset + length;
+    uint64_t count;
+    if (end == diff->oldLength && offset + length == diff->newLength) {
+        count = LineIndexCountBreaks(diff->oldLines, start, end) + 1;
+    } else {
+        while (end > start && text[end - 1] != '\n') {
+            end--;
+        }
+        count = LineIndexCountBreaks(diff->oldLines, start, end);
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    DiffAnchor anchor;
+    anchor.oldLine = LineIndexLineFromOffset(diff->oldLines, start);
+    anchor.newLine = DocumentLineFromOffset(diff->document, offset + (start - originalOffset));
+    anchor.count = count;
+
+    // Anchors must advance on both sides; moved text is diffed instead
+    if (list->count > 0) {
+        DiffAnchor* last = &list->anchors[list->count - 1];
+        uint64_t oldEnd = last->oldLine + last->count;
+        uint64_t newEnd = last->newLine + last->count;
+        uint64_t overlap = 0;
+        if (anchor.oldLine < oldEnd) {
+            overlap = oldEnd - anchor.oldLine;
+        }
+        if (anchor.newLine < newEnd && newEnd - anchor.newLine > overlap) {
+            overlap = newEnd - anchor.newLine;
+        }
+        if (overlap >= anchor.count) {
+            return true;
+        }
+        anchor.oldLine += overlap;
+        anchor.newLine += overlap;
+        anchor.count -= overlap;
+
+        if (anchor.oldLine == oldEnd && anchor.newLine == newEnd) {
+            last->count += anchor.count;
+            return true;
+        }
+    }
+
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        DiffAnchor* anchors = (DiffAnchor*)MemoryRealloc(MEMORY_TAG_DIFF, list->anchors, capacity * sizeof(DiffAnchor));
+        if (!anchors) {
+            diff->failed = true;
+            return false;
+        }
+        list->anchors = anchors;
+        list->capacity = capacity;
+    }
+    list->anchors[list->count++] = anchor;
+    return true;
+}
+
+/**
+ * @brief Diffs a document against its own original content, skipping shared runs.
+ *
+ * @param context The diff context.
+ */
+static void DiffShared(DiffContext* context) {
+    AnchorList list;
+    memset(&list, 0, sizeof(list));
+    list.context = context;
+    DocumentForEachOriginalRun(context->document, CollectAnchor, &list);
+
+    uint64_t oldLine = 0;
+    uint64_t newLine = 0;
+    for (size_t i = 0; i < list.count && !context->failed; i++) {
+        const DiffAnchor* anchor = &list.anchors[i];
+        DiffLineBlock(context, oldLine, anchor->oldLine - oldLine, newLine, anchor->newLine - newLine);
+        oldLine = anchor->oldLine + anchor->count;
+        newLine = anchor->newLine + anchor->count;
+    }
+    if (!context->failed) {
+        DiffLineBlock(context, oldLine, context->oldLines->count - oldLine, newLine,
+                      DocumentLineCount(context->document) - newLine);
+    }
+    MemoryFree(list.anchors);
+}
+
+/**
+ * @brief Computes the line differences between a text and a document.
+ *
+ * @param document The new side of the comparison.
+ * @param oldText The old side of the comparison (may be NULL if oldLength is 0).
+ * @param oldLength Length of the old text.
+ * @param oldLines Line index of the old text, or NULL to build one.
+ * @param sharesOriginal true if oldText is the original content of the document.
+ * @param[out] result Receives the hunks; free with DiffResultFree.
+ * @return true if successful, false on allocation failure.
+ */
+bool DiffDocumentAgainstText(const Document* document, const char* oldText, uint64_t oldLength,
+                             const LineIndex* oldLines, bool sharesOriginal, DiffResult* result) {
+    if (!document || !result || (!oldText && oldLength > 0)) {
+        return false;
+    }
+    memset(result, 0, sizeof(*result));
+
+    LineIndex builtLines;
+    memset(&builtLines, 0, sizeof(builtLines));
+    if (!oldLines || oldLines->count == 0) {
+        if (!LineIndexBuild(&builtLines, oldText, oldLength)) {
+            return false;
+        }
+        oldLines = &builtLines;
+    }
+
+    DiffContext context;
+    memset(&context, 0, sizeof(context));
+    context.document = document;
+    context.oldText = oldText ? oldText : "";
+    context.oldLength = oldLength;
+    context.oldLines = oldLines;
+    context.newLength = DocumentLength(document);
+    context.result = result;
+
+    if (sharesOriginal) {
+        DiffShared(&context);
+    } else {
+        DiffUnshared(&context);
+    }
+
+    MemoryFree(context.scratch);
+    LineIndexFree(&builtLines);
+    if (context.failed) {
+        DiffResultFree(result);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Appends bytes to a text builder.
+ *
+ * @param builder The builder.
+ * @param data The bytes (may be NULL to only reserve space).
+ * @param length Number of bytes.
+ * @return Pointer to the appended bytes, or NULL on failure.
+ */
+static char* BuilderAppend(TextBuilder* builder, const char* data, size_t length) {
+    if (builder->failed) {
+        return NULL;
+    }
+    if (builder->length + length + 1 > builder->capacity) {
+        size_t capacity = builder->capacity ? builder->capacity : 4096;
+        while (capacity < builder->length + length + 1) {
+            capacity *= 2;
+        }
+        char* grown = (char*)realloc(builder->data, capacity);
+        if (!grown) {
+            builder->failed = true;
+            return NULL;
+        }
+        builder->data = grown;
+        builder->capacity = capacity;
+    }
+    char* target = builder->data + builder->length;
+    if (data) {
+        memcpy(target, data, length);
+    }
+    builder->length += length;
+    return target;
+}
+
+/**
+ * @brief Appends one diff line with its marker, adding a line feed if the line has none.
+ *
+ * @param builder The builder.
+ * @param marker ' ', '-' or '+'.
+ * @param context The diff context.
+ * @param fromOld true to take the line from the old text, false from the document.
+ * @param line The line number.
+ */
+static void AppendDiffLine(TextBuilder* builder, char marker, const DiffContext* context, bool fromOld,
+                           uint64_t line) {
+    uint64_t start;
+    uint64_t end;
+    if (fromOld) {
+        OldLineRange(context, line, &start, &end);
+    } else {
+        NewLineRange(context, line, &start, &end);
+    }
+
+    BuilderAppend(builder, &marker, 1);
+    size_t length = (size_t)(end - start);
+    char* target = BuilderAppend(builder, fromOld ? context->oldText + start : NULL, length);
+    if (!target) {
+        return;
+    }
+    if (!fromOld) {
+        DocumentRead(context->document, start, target, length);
+    }
+    if (length == 0 || target[length - 1] != '\n') {
+        BuilderAppend(builder, "\n", 1);
+    }
+}
+
+/**
+ * @brief Formats a diff result as unified diff text.
+ *
+ * @param document The new side of the comparison.
+ * @param oldText The old side of the comparison.
+ * @param oldLength Length of the old text.
+ * @param oldLines Line index of the old text, or NULL to build one.
+ * @param result The hunks computed by DiffDocumentAgainstText.
+ * @param oldName Name shown for the old side.
+ * @param newName Name shown for the new side.
+ * @param[out] textLength Receives the length of the returned text.
+ * @return A newly allocated NUL-terminated string, or NULL on failure.
+ */
+char* DiffFormatUnified(const Document* document, const char* oldText, uint64_t oldLength,
+                        const LineIndex* oldLines, const DiffResult* result, const char* oldName,
+                        const char* newName, size_t* textLength) {
+    if (!document || !result || !textLength || (!oldText && oldLength > 0)) {
+        return NULL;
+    }
+
+    LineIndex builtLines;
+    memset(&builtLines, 0, sizeof(builtLines));
+    if (!oldLines || oldLines->count == 0) {
+        if (!LineIndexBuild(&builtLines, oldText, oldLength)) {
+            return NULL;
+        }
+        oldLines = &builtLines;
+    }
+
+    DiffContext context;
+    memset(&context, 0, sizeof(context));
+    context.document = document;
+    context.oldText = oldText ? oldText : "";
+    context.oldLength = oldLength;
+    context.oldLines = oldLines;
+    context.newLength = DocumentLength(document);
+
+    TextBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    char header[512];
+    int headerLength = snprintf(header, sizeof(header), "--- %s\n+++ %s\n", oldName ? oldName : "a",
+                                newName ? newName : "b");
+    BuilderAppend(&builder, header, headerLength > 0 ? (size_t)headerLength : 0);
+
+    uint64_t oldLineCount = oldLines->count;
+    size_t i = 0;
+    while (i < result->count && !builder.failed) {
+        // Group hunks whose context would overlap
+        size_t last = i;
+        while (last + 1 < result->count) {
+            const DiffHunk* current = &result->hunks[last];
+            const DiffHunk* next = &result->hunks[last + 1];
+            if (next->oldLine - (current->oldLine + current->oldCount) > 2 * DIFF_CONTEXT_LINES) {
+                break;
+            }
+            last++;
+        }
+
+        const DiffHunk* firstHunk = &result->hunks[i];
+        const DiffHunk* lastHunk = &result->hunks[last];
+        uint64_t before = firstHunk->oldLine < DIFF_CONTEXT_LINES ? firstHunk->oldLine : DIFF_CONTEXT_LINES;
+        uint64_t oldEnd = lastHunk->oldLine + lastHunk->oldCount;
+        uint64_t after = oldLineCount - oldEnd < DIFF_CONTEXT_LINES ? oldLineCount - oldEnd : DIFF_CONTEXT_LINES;
+        uint64_t oldStart = firstHunk->oldLine - before;
+        uint64_t newStart = firstHunk->newLine - before;
+        uint64_t oldSpan = oldEnd + after - oldStart;
+        uint64_t newSpan = lastHunk->newLine + lastHunk->newCount + after - newStart;
+
+        headerLength = snprintf(header, sizeof(header), "@@ -%llu,%llu +%llu,%llu @@\n",
+                                (unsigned long long)(oldSpan ? oldStart + 1 : oldStart),
+                                (unsigned long long)oldSpan,
+                                (unsigned long long)(newSpan ? newStart + 1 : newStart),
+                                (unsigned long long)newSpan);
+        BuilderAppend(&builder, header, headerLength > 0 ? (size_t)headerLength : 0);
+
+        uint64_t oldLine = oldStart;
+        for (size_t h = i; h <= last; h++) {
+            const DiffHunk* hunk = &result->hunks[h];
+            for (; oldLine < hunk->oldLine; oldLine++) {
+                AppendDiffLine(&builder, ' ', &context, true, oldLine);
+            }
+            for (uint64_t k = 0; k < hunk->oldCount; k++) {
+                AppendDiffLine(&builder, '-', &context, true, hunk->oldLine + k);
+            }
+            for (uint64_t k = 0; k < hunk->newCount; k++) {
+                AppendDiffLine(&builder, '+', &context, false, hunk->newLine + k);
+            }
+            oldLine = hunk->oldLine + hunk->oldCount;
+        }
+        for (; oldLine < oldEnd + after; oldLine++) {
+            AppendDiffLine(&builder, ' ', &context, true, oldLine);
+        }
+        i = last + 1;
+    }
+
+    LineIndexFree(&builtLines);
+    if (builder.failed) {
+        free(builder.data);
+        return NULL;
+    }
+    builder.data[builder.length] = '\0';
+    *textLength = builder.length;
+    return builder.data;
+}
+
+/**
+ * @brief Releases the memory held by a diff result.
+ *
+ * @param result The diff result.
+ */
+void DiffResultFree(DiffResult* result) {
+    if (!result) {
+        return;
+    }
+    MemoryFree(result->hunks);
+    memset(result, 0, sizeof(*result));
+}
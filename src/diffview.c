@@ -0,0 +1,108 @@
+/**
+ * @file diffview.c
+ * @brief Diff window implementation for the Professional Text Editor
+ *
+ * The window hosts an editor view in read-only mode, so the diff text can
+ * be scrolled, searched with the usual carets and copied like any document.
+ */
+
+#include "../include/diffview.h"
+#include "../include/control.h"
+
+// Initial size of the diff window in pixels
+#define DIFF_WINDOW_WIDTH 900
+#define DIFF_WINDOW_HEIGHT 700
+
+/**
+ * @brief Window procedure of the diff window.
+ *
+ * @param hWnd Handle to the window.
+ * @param message The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing.
+ */
+static LRESULT CALLBACK DiffWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    HWND hView = (HWND)GetWindowLongPtr(hWnd, GWLP_USERDATA);
+
+    switch (message) {
+        case WM_CREATE: {
+            CREATESTRUCT* create = (CREATESTRUCT*)lParam;
+            hView = CreateEditorControl(hWnd, create->hInstance);
+            if (!hView) {
+                return -1;
+            }
+            SetEditorReadOnly(hView, TRUE);
+            SetWindowLongPtr(hWnd, GWLP_USERDATA, (LONG_PTR)hView);
+            return 0;
+        }
+
+        case WM_SIZE:
+            if (hView) {
+                MoveWindow(hView, 0, 0, LOWORD(lParam), HIWORD(lParam), TRUE);
+            }
+            return 0;
+
+        case WM_SETFOCUS:
+            if (hView) {
+                SetFocus(hView);
+            }
+            return 0;
+    }
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+/**
+ * @brief Opens a window showing a document read-only.
+ *
+ * @param hOwner Handle to the owner window.
+ * @param hInstance Handle to the application instance.
+ * @param title Caption of the window.
+ * @param document The document to show; ownership is transferred to the window.
+ * @return Handle to the window, or NULL if it could not be created (the document is then destroyed).
+ */
+HWND ShowDiffWindow(HWND hOwner, HINSTANCE hInstance, const char* title, Document* document) {
+    static BOOL registered = FALSE;
+    if (!registered) {
+        WNDCLASSEX wcex;
+        ZeroMemory(&wcex, sizeof(wcex));
+        wcex.cbSize = sizeof(WNDCLASSEX);
+        wcex.lpfnWndProc = DiffWindowProc;
+        wcex.hInstance = hInstance;
+        wcex.hCursor = LoadCursor(NULL, IDC_ARROW);
+        wcex.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
+        wcex.lpszClassName = DIFF_WINDOW_CLASS_NAME;
+        if (!RegisterClassEx(&wcex)) {
+            DocumentDestroy(document);
+            return NULL;
+        }
+        registered = TRUE;
+    }
+
+    HWND hWnd = CreateWindowEx(
+        0,
+        DIFF_WINDOW_CLASS_NAME,
+        title,
+        WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT, CW_USEDEFAULT, DIFF_WINDOW_WIDTH, DIFF_WINDOW_HEIGHT,
+        hOwner,
+        NULL,
+        hInstance,
+        NULL
+    );
+    if (!hWnd) {
+        DocumentDestroy(document);
+        return NULL;
+    }
+
+    // The view owns the document from here on and destroys it with the window
+    HWND hView = (HWND)GetWindowLongPtr(hWnd, GWLP_USERDATA);
+    if (!SetEditorDocument(hView, document)) {
+        DestroyWindow(hWnd);
+        return NULL;
+    }
+
+    ShowWindow(hWnd, SW_SHOW);
+    UpdateWindow(hWnd);
+    return hWnd;
+}
@@ -0,0 +1,2454 @@
+/**
+ * @file document.c
+ * @brief Document storage implementation for the Professional Text Editor
+ *
+ * Contains the chunked piece table, the add buffers, the line lookups and
+ * the version-based undo history.
+ */
+
+#include "../include/document.h"
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Most pieces per chunk; an edit rewrites at most the chunks it touches
+#define DOCUMENT_CHUNK_CAPACITY 128
+
+// Rebuilt chunks smaller than this absorb the following chunk instead of being flushed
+#define DOCUMENT_CHUNK_MIN_FILL 32
+
+// Size of each append-only block holding inserted text
+#define DOCUMENT_ADD_BLOCK_SIZE (1024 * 1024)
+
+// Inserted runs up to this length are merged with an inserted run right before them
+#define DOCUMENT_COALESCE_LIMIT 32
+
+// Index of the buffer holding the original content
+#define DOCUMENT_ORIGINAL_BUFFER 0
+
+// A run of bytes taken from one buffer
+typedef struct {
+    uint32_t buffer;        // Index into Document.buffers
+    uint64_t start;         // Offset of the run inside the buffer
+    uint64_t length;        // Length of the run
+    uint64_t lineBreaks;    // Line feeds inside the run
+} Piece;
+
+// Immutable, shareable group of consecutive pieces
+typedef struct PieceChunk {
+    volatile long refCount; // Changed atomically; snapshots release chunks on other threads
+    uint32_t count;
+    uint64_t length;        // Sum of piece lengths
+    uint64_t lineBreaks;    // Sum of piece line feeds
+    Piece pieces[];         // Room for DOCUMENT_CHUNK_CAPACITY while filled, then for count
+} PieceChunk;
+
+// Node of the balanced tree over the chunks of a version; versions share the subtrees an edit leaves alone
+typedef struct ChunkNode {
+    volatile long refCount; // Changed atomically, like the chunk counts
+    uint32_t height;        // Levels in the subtree, 1 for a node without children
+    struct ChunkNode* left;
+    struct ChunkNode* right;
+    PieceChunk* chunk;      // Chunk between the two subtrees
+    uint64_t length;        // Sum of chunk lengths in the subtree
+    uint64_t lineBreaks;    // Sum of chunk line feeds in the subtree
+} ChunkNode;
+
+// One immutable state of the document content
+struct DocumentVersion {
+    volatile long refCount; // Changed atomically, like the chunk counts
+    uint64_t id;
+    ChunkNode* root;        // NULL for empty content
+};
+
+// Storage that pieces point into; never moves once written
+typedef struct DocumentBuffer {
+    const char* data;
+    uint64_t length;        // Bytes in use
+    uint64_t capacity;      // Bytes allocated (add blocks only)
+    LineIndex lines;        // Line starts inside this buffer
+    bool owned;             // true if data was allocated by the document
+} DocumentBuffer;
+
+// One undoable edit batch
+typedef struct {
+    DocumentVersion* version;   // Version after the batch
+    DocumentChange* changes;    // Changes from the previous version
+    size_t changeCount;
+} HistoryEntry;
+
+// A registered change callback
+typedef struct {
+    DocumentListener callback;
+    void* context;
+} ListenerEntry;
+
+struct Document {
+    MappedFile mapping;             // Mapping backing the original buffer, if any
+    DocumentBuffer* buffers;
+    size_t bufferCount;
+    size_t bufferCapacity;
+    DocumentBuffer** retiredBuffers; // Outgrown buffer tables, still read by snapshots
+    size_t retiredCount;
+
+    DocumentVersion* base;          // Version before the oldest history entry
+    DocumentVersion* current;       // Version being displayed and edited
+    HistoryEntry* history;
+    size_t historyCount;
+    size_t historyCapacity;
+    size_t historyPosition;         // Number of history entries currently applied
+    uint64_t nextVersionId;
+    uint64_t savedVersionId;
+
+    unsigned groupDepth;            // Nesting of DocumentBeginGroup calls
+    bool groupOpen;                 // The newest history entry takes the next batches of the group
+    uint64_t groupLength;           // Length before the first batch of the group
+    uint64_t groupPrefix;           // Bytes at the start untouched by the group so far
+    uint64_t groupSuffix;           // Bytes at the end untouched by the group so far
+
+    MemoryArena scratch;            // Working arrays of DocumentApplyEdits
+    DocumentChange* scratchChanges; // Inverted changes reported by DocumentUndo
+    size_t scratchCapacity;
+
+    ListenerEntry* listeners;
+    size_t listenerCount;
+    size_t listenerCapacity;
+
+    volatile long storageRefs;      // The document itself, its slices and its snapshots
+};
+
+// Pieces captured from a document, kept as a standalone version
+struct DocumentSlice {
+    long refCount;
+    Document* document;             // Owner of the buffers the pieces point into
+    DocumentVersion* version;
+    DocumentRange* parts;           // Captured ranges, in slice coordinates
+    size_t partCount;
+};
+
+// A version pinned for reading on any thread
+struct DocumentSnapshot {
+    Document* document;             // Owner of the buffers the pieces point into
+    const DocumentBuffer* buffers;  // Buffer table at the time of the snapshot
+    DocumentVersion* version;
+};
+
+// Builds the chunk tree of a new version while pieces and shared subtrees stream in
+typedef struct {
+    ChunkNode* tree;        // Output that precedes the chunks below
+    PieceChunk** chunks;    // Finished chunks not yet added to the tree
+    size_t count;
+    size_t capacity;
+    PieceChunk* pending;    // Chunk being filled, not yet shared
+    bool failed;
+} ChunkWriter;
+
+// Progress of DocumentApplyEdits through its edits while it walks the old chunk tree
+typedef struct {
+    const DocumentChange* changes;
+    const Piece* inserted;          // Inserted text of each edit
+    const DocumentSlice** slices;   // Inserted slice of each edit, or NULL
+    const uint64_t* removeEnds;     // End of the removed range of each edit
+    size_t count;
+    size_t next;                    // First edit not emitted yet
+    uint64_t deleteUntil;           // End of the range removed by the last emitted edit
+} EditPass;
+
+/**
+ * @brief Allocates an empty chunk with room for a full set of pieces and a single reference.
+ *
+ * @return The chunk, or NULL on allocation failure.
+ */
+static PieceChunk* ChunkCreate(void) {
+    PieceChunk* chunk = (PieceChunk*)MemoryAlloc(MEMORY_TAG_DOCUMENT,
+                                                 sizeof(PieceChunk) + DOCUMENT_CHUNK_CAPACITY * sizeof(Piece));
+    if (chunk) {
+        chunk->refCount = 1;
+        chunk->count = 0;
+        chunk->length = 0;
+        chunk->lineBreaks = 0;
+    }
+    return chunk;
+}
+
+/**
+ * @brief Drops a reference to a chunk, freeing it with the last one.
+ *
+ * @param chunk The chunk.
+ */
+static void ChunkRelease(PieceChunk* chunk) {
+    if (chunk && ThreadAtomicDecrement(&chunk->refCount) == 0) {
+        MemoryFree(chunk);
+    }
+}
+
+/**
+ * @brief Gets the height of a subtree.
+ *
+ * @param node The subtree (may be NULL).
+ * @return The number of levels, 0 for an empty subtree.
+ */
+static uint32_t NodeHeight(const ChunkNode* node) {
+    return node ? node->height : 0;
+}
+
+/**
+ * @brief Drops a reference to a tree node, releasing its chunk and subtrees with the last one.
+ *
+ * @param node The node. NULL is ignored.
+ */
+static void NodeRelease(ChunkNode* node) {
+    if (node && ThreadAtomicDecrement(&node->refCount) == 0) {
+        NodeRelease(node->left);
+        NodeRelease(node->right);
+        ChunkRelease(node->chunk);
+        MemoryFree(node);
+    }
+}
+
+/**
+ * @brief Creates a tree node from two subtrees and the chunk between them.
+ *
+ * @param left Left subtree (may be NULL); its reference is transferred.
+ * @param chunk The chunk; its reference is transferred.
+ * @param right Right subtree (may be NULL); its reference is transferred.
+ * @return The node, or NULL on allocation failure (the references are then released).
+ */
+static ChunkNode* NodeCreate(ChunkNode* left, PieceChunk* chunk, ChunkNode* right) {
+    ChunkNode* node = (ChunkNode*)MemoryAlloc(MEMORY_TAG_DOCUMENT, sizeof(ChunkNode));
+    if (!node) {
+        NodeRelease(left);
+        ChunkRelease(chunk);
+        NodeRelease(right);
+        return NULL;
+    }
+
+    uint32_t leftHeight = NodeHeight(left);
+    uint32_t rightHeight = NodeHeight(right);
+    node->refCount = 1;
+    node->height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+    node->left = left;
+    node->right = right;
+    node->chunk = chunk;
+    node->length = (left ? left->length : 0) + chunk->length + (right ? right->length : 0);
+    node->lineBreaks = (left ? left->lineBreaks : 0) + chunk->lineBreaks + (right ? right->lineBreaks : 0);
+    return node;
+}
+
+/**
+ * @brief Takes over the parts of a node and drops the reference to the node itself.
+ *
+ * @param node The node; its reference is transferred.
+ * @param[out] left Receives a reference to the left subtree (may be NULL).
+ * @param[out] chunk Receives a reference to the chunk.
+ * @param[out] right Receives a reference to the right subtree (may be NULL).
+ */
+static void NodeExpose(ChunkNode* node, ChunkNode** left, PieceChunk** chunk, ChunkNode** right) {
+    *left = node->left;
+    *chunk = node->chunk;
+    *right = node->right;
+    if (*left) {
+        ThreadAtomicIncrement(&(*left)->refCount);
+    }
+    ThreadAtomicIncrement(&(*chunk)->refCount);
+    if (*right) {
+        ThreadAtomicIncrement(&(*right)->refCount);
+    }
+    NodeRelease(node);
+}
+
+/**
+ * @brief Rotates a subtree so that its right child becomes the root.
+ *
+ * @param node The subtree, which has a right child; its reference is transferred.
+ * @return The rotated subtree, or NULL on allocation failure.
+ */
+static ChunkNode* NodeRotateLeft(ChunkNode* node) {
+    ChunkNode* left;
+    PieceChunk* chunk;
+    ChunkNode* right;
+    NodeExpose(node, &left, &chunk, &right);
+
+    ChunkNode* middle;
+    PieceChunk* rightChunk;
+    ChunkNode* outer;
+    NodeExpose(right, &middle, &rightChunk, &outer);
+
+    ChunkNode* lower = NodeCreate(left, chunk, middle);
+    if (!lower) {
+        ChunkRelease(rightChunk);
+        NodeRelease(outer);
+        return NULL;
+    }
+    return NodeCreate(lower, rightChunk, outer);
+}
+
+/**
+ * @brief Rotates a subtree so that its left child becomes the root.
+ *
+ * @param node The subtree, which has a left child; its reference is transferred.
+ * @return The rotated subtree, or NULL on allocation failure.
+ */
+static ChunkNode* NodeRotateRight(ChunkNode* node) {
+    ChunkNode* left;
+    PieceChunk* chunk;
+    ChunkNode* right;
+    NodeExpose(node, &left, &chunk, &right);
+
+    ChunkNode* outer;
+    PieceChunk* leftChunk;
+    ChunkNode* middle;
+    NodeExpose(left, &outer, &leftChunk, &middle);
+
+    ChunkNode* lower = NodeCreate(middle, chunk, right);
+    if (!lower) {
+        NodeRelease(outer);
+        ChunkRelease(leftChunk);
+        return NULL;
+    }
+    return NodeCreate(outer, leftChunk, lower);
+}
+
+/**
+ * @brief Joins two subtrees around a chunk when the left one is more than one level taller.
+ *
+ * The chunk and the right subtree are hung on the right spine of the left
+ * subtree, and the nodes above are rebalanced on the way up.
+ *
+ * @param left The taller subtree; its reference is transferred.
+ * @param chunk The chunk between the subtrees; its reference is transferred.
+ * @param right The shorter subtree (may be NULL); its reference is transferred.
+ * @return The joined tree, or NULL on allocation failure.
+ */
+static ChunkNode* NodeJoinRight(ChunkNode* left, PieceChunk* chunk, ChunkNode* right) {
+    ChunkNode* outer;
+    PieceChunk* leftChunk;
+    ChunkNode* inner;
+    NodeExpose(left, &outer, &leftChunk, &inner);
+
+    bool low = NodeHeight(inner) <= NodeHeight(right) + 1;
+    ChunkNode* joined = low ? NodeCreate(inner, chunk, right) : NodeJoinRight(inner, chunk, right);
+    bool rotate = joined && NodeHeight(joined) > NodeHeight(outer) + 1;
+    if (rotate && low) {
+        joined = NodeRotateRight(joined);
+    }
+    if (!joined) {
+        NodeRelease(outer);
+        ChunkRelease(leftChunk);
+        return NULL;
+    }
+
+    ChunkNode* result = NodeCreate(outer, leftChunk, joined);
+    return rotate && result ? NodeRotateLeft(result) : result;
+}
+
+/**
+ * @brief Joins two subtrees around a chunk when the right one is more than one level taller.
+ *
+ * @param left The shorter subtree (may be NULL); its reference is transferred.
+ * @param chunk The chunk between the subtrees; its reference is transferred.
+ * @param right The taller subtree; its reference is transferred.
+ * @return The joined tree, or NULL on allocation failure.
+ */
+static ChunkNode* NodeJoinLeft(ChunkNode* left, PieceChunk* chunk, ChunkNode* right) {
+    ChunkNode* inner;
+    PieceChunk* rightChunk;
+    ChunkNode* outer;
+    NodeExpose(right, &inner, &rightChunk, &outer);
+
+    bool low = NodeHeight(inner) <= NodeHeight(left) + 1;
+    ChunkNode* joined = low ? NodeCreate(left, chunk, inner) : NodeJoinLeft(left, chunk, inner);
+    bool rotate = joined && NodeHeight(joined) > NodeHeight(outer) + 1;
+    if (rotate && low) {
+        joined = NodeRotateLeft(joined);
+    }
+    if (!joined) {
+        ChunkRelease(rightChunk);
+        NodeRelease(outer);
+        return NULL;
+    }
+
+    ChunkNode* result = NodeCreate(joined, rightChunk, outer);
+    return rotate && result ? NodeRotateRight(result) : result;
+}
+
+/**
+ * @brief Joins two balanced trees around a chunk into one balanced tree.
+ *
+ * Costs one node per level of height difference, so subtrees shared with
+ * an older version are linked in without being copied.
+ *
+ * @param left The chunks before (may be NULL); its reference is transferred.
+ * @param chunk The chunk between the trees; its reference is transferred.
+ * @param right The chunks after (may be NULL); its reference is transferred.
+ * @return The joined tree, or NULL on allocation failure.
+ */
+static ChunkNode* NodeJoin(ChunkNode* left, PieceChunk* chunk, ChunkNode* right) {
+    if (NodeHeight(left) > NodeHeight(right) + 1) {
+        return NodeJoinRight(left, chunk, right);
+    }
+    if (NodeHeight(right) > NodeHeight(left) + 1) {
+        return NodeJoinLeft(left, chunk, right);
+    }
+    return NodeCreate(left, chunk, right);
+}
+
+/**
+ * @brief Removes the last chunk of a tree.
+ *
+ * @param node The tree; its reference is transferred.
+ * @param[out] rest Receives the other chunks (NULL if there are none).
+ * @param[out] last Receives a reference to the last chunk.
+ * @return true if successful, false on allocation failure.
+ */
+static bool NodeSplitLast(ChunkNode* node, ChunkNode** rest, PieceChunk** last) {
+    ChunkNode* left;
+    PieceChunk* chunk;
+    ChunkNode* right;
+    NodeExpose(node, &left, &chunk, &right);
+    if (!right) {
+        *rest = left;
+        *last = chunk;
+        return true;
+    }
+
+    ChunkNode* remaining;
+    if (!NodeSplitLast(right, &remaining, last)) {
+        NodeRelease(left);
+        ChunkRelease(chunk);
+        return false;
+    }
+    *rest = NodeJoin(left, chunk, remaining);
+    if (!*rest) {
+        ChunkRelease(*last);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Concatenates two trees.
+ *
+ * @param left The chunks before (may be NULL); its reference is transferred.
+ * @param right The chunks after (may be NULL); its reference is transferred.
+ * @param[out] result Receives the concatenated tree.
+ * @return true if successful, false on allocation failure.
+ */
+static bool NodeConcat(ChunkNode* left, ChunkNode* right, ChunkNode** result) {
+    if (!left || !right) {
+        *result = left ? left : right;
+        return true;
+    }
+
+    ChunkNode* rest;
+    PieceChunk* last;
+    if (!NodeSplitLast(left, &rest, &last)) {
+        NodeRelease(right);
+        return false;
+    }
+    *result = NodeJoin(rest, last, right);
+    return *result != NULL;
+}
+
+/**
+ * @brief Builds a balanced tree over consecutive chunks.
+ *
+ * @param chunks The chunks; their references are transferred.
+ * @param count Number of chunks, at least 1.
+ * @return The tree, or NULL on allocation failure (the chunks are then released).
+ */
+static ChunkNode* NodeBuild(PieceChunk** chunks, size_t count) {
+    size_t middle = count / 2;
+    size_t after = count - middle - 1;
+    ChunkNode* left = middle > 0 ? NodeBuild(chunks, middle) : NULL;
+    ChunkNode* right = after > 0 ? NodeBuild(chunks + middle + 1, after) : NULL;
+    if ((middle > 0 && !left) || (after > 0 && !right)) {
+        NodeRelease(left);
+        ChunkRelease(chunks[middle]);
+        NodeRelease(right);
+        return NULL;
+    }
+    return NodeCreate(left, chunks[middle], right);
+}
+
+/**
+ * @brief Drops a reference to a version, freeing it with the last one.
+ *
+ * @param version The version.
+ */
+static void VersionRelease(DocumentVersion* version) {
+    if (!version || ThreadAtomicDecrement(&version->refCount) > 0) {
+        return;
+    }
+    NodeRelease(version->root);
+    MemoryFree(version);
+}
+
+/**
+ * @brief Creates a version from a chunk tree.
+ *
+ * @param document The document, which assigns the version id.
+ * @param root The tree (NULL for empty content); its reference is transferred.
+ * @return The version, or NULL on allocation failure (the tree is then released).
+ */
+static DocumentVersion* VersionCreate(Document* document, ChunkNode* root) {
+    DocumentVersion* version = (DocumentVersion*)MemoryAlloc(MEMORY_TAG_DOCUMENT, sizeof(DocumentVersion));
+    if (!version) {
+        NodeRelease(root);
+        return NULL;
+    }
+    version->refCount = 1;
+    version->id = document->nextVersionId++;
+    version->root = root;
+    return version;
+}
+
+/**
+ * @brief Appends a chunk reference to the writer's output.
+ *
+ * @param writer The writer.
+ * @param chunk The chunk; the writer takes over one reference.
+ */
+static void WriterPushChunk(ChunkWriter* writer, PieceChunk* chunk) {
+    if (writer->count == writer->capacity) {
+        size_t newCapacity = writer->capacity ? writer->capacity * 2 : 16;
+        PieceChunk** newChunks = (PieceChunk**)MemoryRealloc(MEMORY_TAG_DOCUMENT, writer->chunks,
+                                                             newCapacity * sizeof(PieceChunk*));
+        if (!newChunks) {
+            ChunkRelease(chunk);
+            writer->failed = true;
+            return;
+        }
+        writer->chunks = newChunks;
+        writer->capacity = newCapacity;
+    }
+    writer->chunks[writer->count++] = chunk;
+}
+
+/**
+ * @brief Moves the chunk being filled to the writer's output.
+ *
+ * @param writer The writer.
+ */
+static void WriterFlush(ChunkWriter* writer) {
+    PieceChunk* pending = writer->pending;
+    if (!pending) {
+        return;
+    }
+    writer->pending = NULL;
+    if (pending->count == 0) {
+        ChunkRelease(pending);
+        return;
+    }
+
+    // Shared chunks never grow again, so they keep room for their own pieces only
+    size_t size = sizeof(PieceChunk) + pending->count * sizeof(Piece);
+    PieceChunk* shrunk = (PieceChunk*)MemoryRealloc(MEMORY_TAG_DOCUMENT, pending, size);
+    WriterPushChunk(writer, shrunk ? shrunk : pending);
+}
+
+/**
+ * @brief Moves the finished chunks of the writer into its tree.
+ *
+ * @param writer The writer.
+ */
+static void WriterFlushChunks(ChunkWriter* writer) {
+    if (writer->count == 0 || writer->failed) {
+        return;
+    }
+    ChunkNode* built = NodeBuild(writer->chunks, writer->count);
+    writer->count = 0;
+    if (!built) {
+        NodeRelease(writer->tree);
+        writer->tree = NULL;
+        writer->failed = true;
+    } else if (!NodeConcat(writer->tree, built, &writer->tree)) {
+        writer->tree = NULL;
+        writer->failed = true;
+    }
+}
+
+/**
+ * @brief Checks whether the writer copies the pieces of the next chunk instead of sharing it.
+ *
+ * @param writer The writer.
+ * @return true while the chunk being filled is nearly empty, false otherwise.
+ */
+static bool WriterTakesPieces(const ChunkWriter* writer) {
+    return writer->pending && writer->pending->count < DOCUMENT_CHUNK_MIN_FILL;
+}
+
+/**
+ * @brief Appends a piece, merging it with the previous piece when they are adjacent.
+ *
+ * @param writer The writer.
+ * @param piece The piece to append.
+ */
+static void WriterEmitPiece(ChunkWriter* writer, const Piece* piece) {
+    if (piece->length == 0 || writer->failed) {
+        return;
+    }
+
+    PieceChunk* pending = writer->pending;
+    if (pending && pending->count > 0) {
+        // Sequential typing appends to the add buffer right after the previous piece
+        Piece* last = &pending->pieces[pending->count - 1];
+        if (last->buffer == piece->buffer && last->start + last->length == piece->start) {
+            last->length += piece->length;
+            last->lineBreaks += piece->lineBreaks;
+            pending->length += piece->length;
+            pending->lineBreaks += piece->lineBreaks;
+            return;
+        }
+    }
+
+    if (!pending || pending->count == DOCUMENT_CHUNK_CAPACITY) {
+        WriterFlush(writer);
+        pending = ChunkCreate();
+        if (!pending) {
+            writer->failed = true;
+            return;
+        }
+        writer->pending = pending;
+    }
+
+    pending->pieces[pending->count++] = *piece;
+    pending->length += piece->length;
+    pending->lineBreaks += piece->lineBreaks;
+}
+
+/**
+ * @brief Appends an unchanged chunk, sharing it with the previous version when possible.
+ *
+ * @param writer The writer.
+ * @param chunk The chunk to append.
+ */
+static void WriterEmitChunk(ChunkWriter* writer, PieceChunk* chunk) {
+    if (writer->failed) {
+        return;
+    }
+
+    // Copying into a nearly empty pending chunk keeps edits from fragmenting the table;
+    // a chunk that would overflow it is shared, so the copying never runs on into the next chunks
+    if (WriterTakesPieces(writer) && writer->pending->count + chunk->count <= DOCUMENT_CHUNK_CAPACITY) {
+        for (uint32_t i = 0; i < chunk->count; i++) {
+            WriterEmitPiece(writer, &chunk->pieces[i]);
+        }
+        return;
+    }
+
+    WriterFlush(writer);
+    ThreadAtomicIncrement(&chunk->refCount);
+    WriterPushChunk(writer, chunk);
+}
+
+/**
+ * @brief Appends an unchanged subtree, sharing it with the previous version.
+ *
+ * @param writer The writer.
+ * @param node The subtree.
+ */
+static void WriterEmitTree(ChunkWriter* writer, ChunkNode* node) {
+    WriterFlush(writer);
+    WriterFlushChunks(writer);
+    if (writer->failed) {
+        return;
+    }
+    ThreadAtomicIncrement(&node->refCount);
+    if (!NodeConcat(writer->tree, node, &writer->tree)) {
+        writer->tree = NULL;
+        writer->failed = true;
+    }
+}
+
+/**
+ * @brief Finishes the writer and creates the version it describes.
+ *
+ * @param document The document.
+ * @param writer The writer; its output is consumed.
+ * @return The new version, or NULL on failure.
+ */
+static DocumentVersion* WriterFinish(Document* document, ChunkWriter* writer) {
+    WriterFlush(writer);
+    WriterFlushChunks(writer);
+    for (size_t i = 0; i < writer->count; i++) {
+        ChunkRelease(writer->chunks[i]);
+    }
+    MemoryFree(writer->chunks);
+    if (writer->failed) {
+        NodeRelease(writer->tree);
+        return NULL;
+    }
+    return VersionCreate(document, writer->tree);
+}
+
+/**
+ * @brief Finds the chunk containing an offset.
+ *
+ * @param version The version to search.
+ * @param offset Byte offset (the document length maps to the last chunk).
+ * @param[out] chunkStart Receives the offset of the chunk.
+ * @param[out] chunkLine Receives the number of line feeds before the chunk.
+ * @return The chunk, or NULL for an empty version.
+ */
+static PieceChunk* FindChunkByOffset(const DocumentVersion* version, uint64_t offset, uint64_t* chunkStart,
+                                     uint64_t* chunkLine) {
+    const ChunkNode* node = version->root;
+    uint64_t start = 0;
+    uint64_t line = 0;
+    while (node) {
+        const ChunkNode* left = node->left;
+        if (left && offset < left->length) {
+            node = left;
+            continue;
+        }
+        if (left) {
+            offset -= left->length;
+            start += left->length;
+            line += left->lineBreaks;
+        }
+        if (offset < node->chunk->length || !node->right) {
+            *chunkStart = start;
+            *chunkLine = line;
+            return node->chunk;
+        }
+        offset -= node->chunk->length;
+        start += node->chunk->length;
+        line += node->chunk->lineBreaks;
+        node = node->right;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Finds the chunk holding a line feed.
+ *
+ * @param version The version to search.
+ * @param lineBreak One-based number of the line feed, at most the number of line feeds.
+ * @param[out] chunkStart Receives the offset of the chunk.
+ * @param[out] chunkLine Receives the number of line feeds before the chunk.
+ * @return The chunk.
+ */
+static const PieceChunk* FindChunkByLineBreak(const DocumentVersion* version, uint64_t lineBreak,
+                                              uint64_t* chunkStart, uint64_t* chunkLine) {
+    const ChunkNode* node = version->root;
+    uint64_t start = 0;
+    uint64_t line = 0;
+    while (node) {
+        const ChunkNode* left = node->left;
+        if (left && lineBreak <= left->lineBreaks) {
+            node = left;
+            continue;
+        }
+        if (left) {
+            lineBreak -= left->lineBreaks;
+            start += left->length;
+            line += left->lineBreaks;
+        }
+        if (lineBreak <= node->chunk->lineBreaks || !node->right) {
+            break;
+        }
+        lineBreak -= node->chunk->lineBreaks;
+        start += node->chunk->length;
+        line += node->chunk->lineBreaks;
+        node = node->right;
+    }
+    *chunkStart = start;
+    *chunkLine = line;
+    return node->chunk;
+}
+
+/**
+ * @brief Gets the length of a version.
+ *
+ * @param version The version.
+ * @return The length in bytes.
+ */
+static uint64_t VersionLength(const DocumentVersion* version) {
+    return version->root ? version->root->length : 0;
+}
+
+/**
+ * @brief Gets the number of line feeds of a version.
+ *
+ * @param version The version.
+ * @return The number of line feeds.
+ */
+static uint64_t VersionLineBreaks(const DocumentVersion* version) {
+    return version->root ? version->root->lineBreaks : 0;
+}
+
+/**
+ * @brief Makes a version current, adjusting references.
+ *
+ * @param document The document.
+ * @param version The version to make current.
+ */
+static void SetCurrentVersion(Document* document, DocumentVersion* version) {
+    ThreadAtomicIncrement(&version->refCount);
+    VersionRelease(document->current);
+    document->current = version;
+}
+
+/**
+ * @brief Calls every registered listener.
+ *
+ * @param document The document.
+ * @param changes The changes to report.
+ * @param changeCount Number of changes.
+ */
+static void NotifyListeners(Document* document, const DocumentChange* changes, size_t changeCount) {
+    for (size_t i = 0; i < document->listenerCount; i++) {
+        document->listeners[i].callback(document, changes, changeCount, document->listeners[i].context);
+    }
+}
+
+/**
+ * @brief Adds a buffer slot to the document.
+ *
+ * @param document The document.
+ * @return The new buffer (zeroed), or NULL on allocation failure.
+ */
+static DocumentBuffer* AddBufferSlot(Document* document) {
+    if (document->bufferCount == document->bufferCapacity) {
+        // Snapshots may be reading the old table, so it is kept until the storage is freed
+        size_t newCapacity = document->bufferCapacity ? document->bufferCapacity * 2 : 8;
+        DocumentBuffer* newBuffers = (DocumentBuffer*)MemoryAlloc(MEMORY_TAG_DOCUMENT,
+                                                                  newCapacity * sizeof(DocumentBuffer));
+        size_t retiredSize = (document->retiredCount + 1) * sizeof(DocumentBuffer*);
+        DocumentBuffer** retired =
+            (DocumentBuffer**)MemoryRealloc(MEMORY_TAG_DOCUMENT, document->retiredBuffers, retiredSize);
+        if (retired) {
+            document->retiredBuffers = retired;
+        }
+        if (!newBuffers || !retired) {
+            MemoryFree(newBuffers);
+            return NULL;
+        }
+        if (document->buffers) {
+            memcpy(newBuffers, document->buffers, document->bufferCount * sizeof(DocumentBuffer));
+            document->retiredBuffers[document->retiredCount++] = document->buffers;
+        }
+        document->buffers = newBuffers;
+        document->bufferCapacity = newCapacity;
+    }
+    DocumentBuffer* buffer = &document->buffers[document->bufferCount++];
+    memset(buffer, 0, sizeof(*buffer));
+    return buffer;
+}
+
+/**
+ * @brief Copies text into the add buffers and describes it as a piece.
+ *
+ * @param document The document.
+ * @param text The text to append.
+ * @param length Length of the text.
+ * @param[out] piece Receives the piece covering the appended text.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AppendToAddBuffer(Document* document, const char* text, size_t length, Piece* piece) {
+    DocumentBuffer* block = NULL;
+    if (document->bufferCount > 1) {
+        block = &document->buffers[document->bufferCount - 1];
+        if (block->capacity - block->length < length) {
+            block = NULL;
+        }
+    }
+
+    if (!block) {
+        size_t capacity = length > DOCUMENT_ADD_BLOCK_SIZE ? length : DOCUMENT_ADD_BLOCK_SIZE;
+        char* data = (char*)MemoryAlloc(MEMORY_TAG_DOCUMENT, capacity);
+        if (!data) {
+            return false;
+        }
+        block = AddBufferSlot(document);
+        if (!block) {
+            MemoryFree(data);
+            return false;
+        }
+        block->data = data;
+        block->capacity = capacity;
+        block->owned = true;
+        if (!LineIndexBuild(&block->lines, NULL, 0)) {
+            MemoryFree(data);
+            document->bufferCount--;
+            return false;
+        }
+    }
+
+    size_t breaksBefore = block->lines.count;
+    memcpy((char*)block->data + block->length, text, length);
+    if (!LineIndexAppend(&block->lines, text, length, block->length)) {
+        return false;
+    }
+
+    piece->buffer = (uint32_t)(block - document->buffers);
+    piece->start = block->length;
+    piece->length = length;
+    piece->lineBreaks = block->lines.count - breaksBefore;
+    block->length += length;
+    return true;
+}
+
+/**
+ * @brief Emits the part [from, to) of a piece, in document coordinates.
+ *
+ * @param document The document.
+ * @param writer The writer.
+ * @param piece The piece.
+ * @param pieceStart Document offset of the piece.
+ * @param from Start of the part.
+ * @param to End of the part.
+ */
+static void EmitPiecePart(const Document* document, ChunkWriter* writer, const Piece* piece,
+                          uint64_t pieceStart, uint64_t from, uint64_t to) {
+    if (to <= from) {
+        return;
+    }
+    if (from == pieceStart && to == pieceStart + piece->length) {
+        WriterEmitPiece(writer, piece);
+        return;
+    }
+
+    Piece part;
+    part.buffer = piece->buffer;
+    part.start = piece->start + (from - pieceStart);
+    part.length = to - from;
+    part.lineBreaks = LineIndexCountBreaks(&document->buffers[piece->buffer].lines,
+                                           part.start, part.start + part.length);
+    WriterEmitPiece(writer, &part);
+}
+
+/**
+ * @brief Emits a freshly inserted piece.
+ *
+ * Text typed at many carets is interleaved in the add buffers, so the runs
+ * typed at one caret are never contiguous and would add a piece per caret
+ * per keystroke. A short inserted run that follows another short inserted
+ * run is copied together with it into a single new run instead.
+ *
+ * @param document The document.
+ * @param writer The writer.
+ * @param piece The inserted piece.
+ */
+static void EmitInsertedPiece(Document* document, ChunkWriter* writer, const Piece* piece) {
+    PieceChunk* pending = writer->pending;
+    if (!pending || pending->count == 0 || writer->failed) {
+        WriterEmitPiece(writer, piece);
+        return;
+    }
+
+    Piece* last = &pending->pieces[pending->count - 1];
+    if (last->buffer == DOCUMENT_ORIGINAL_BUFFER || piece->buffer == DOCUMENT_ORIGINAL_BUFFER ||
+        last->length + piece->length > DOCUMENT_COALESCE_LIMIT ||
+        (last->buffer == piece->buffer && last->start + last->length == piece->start)) {
+        WriterEmitPiece(writer, piece);
+        return;
+    }
+
+    char joined[DOCUMENT_COALESCE_LIMIT];
+    size_t lastLength = (size_t)last->length;
+    memcpy(joined, document->buffers[last->buffer].data + last->start, lastLength);
+    memcpy(joined + lastLength, document->buffers[piece->buffer].data + piece->start, (size_t)piece->length);
+
+    Piece merged;
+    if (!AppendToAddBuffer(document, joined, lastLength + (size_t)piece->length, &merged)) {
+        WriterEmitPiece(writer, piece);
+        return;
+    }
+    pending->length += piece->length;
+    pending->lineBreaks += piece->lineBreaks;
+    *last = merged;
+}
+
+/**
+ * @brief Emits the pieces of a subtree that lie inside a range, sharing whole subtrees and chunks.
+ *
+ * @param document The document owning the buffers of the subtree.
+ * @param writer The writer.
+ * @param node The subtree.
+ * @param nodeStart Offset of the subtree.
+ * @param from Start of the range.
+ * @param to End of the range.
+ */
+static void EmitTreeRange(const Document* document, ChunkWriter* writer, ChunkNode* node, uint64_t nodeStart,
+                          uint64_t from, uint64_t to) {
+    if (!node || writer->failed || nodeStart >= to || nodeStart + node->length <= from) {
+        return;
+    }
+    if (from <= nodeStart && nodeStart + node->length <= to && !WriterTakesPieces(writer)) {
+        WriterEmitTree(writer, node);
+        return;
+    }
+
+    EmitTreeRange(document, writer, node->left, nodeStart, from, to);
+    PieceChunk* chunk = node->chunk;
+    uint64_t chunkStart = nodeStart + (node->left ? node->left->length : 0);
+    uint64_t chunkEnd = chunkStart + chunk->length;
+    if (from <= chunkStart && chunkEnd <= to) {
+        WriterEmitChunk(writer, chunk);
+    } else {
+        uint64_t pieceStart = chunkStart;
+        for (uint32_t pi = 0; pi < chunk->count && pieceStart < to; pi++) {
+            const Piece* piece = &chunk->pieces[pi];
+            uint64_t pieceEnd = pieceStart + piece->length;
+            if (pieceEnd > from) {
+                EmitPiecePart(document, writer, piece, pieceStart, from > pieceStart ? from : pieceStart,
+                              to < pieceEnd ? to : pieceEnd);
+            }
+            pieceStart = pieceEnd;
+        }
+    }
+    EmitTreeRange(document, writer, node->right, chunkEnd, from, to);
+}
+
+/**
+ * @brief Emits the pieces covering a range of a version, sharing whole subtrees and chunks.
+ *
+ * @param document The document owning the buffers of the version.
+ * @param writer The writer.
+ * @param version The version.
+ * @param from Start of the range.
+ * @param to End of the range.
+ */
+static void EmitVersionRange(const Document* document, ChunkWriter* writer, const DocumentVersion* version,
+                             uint64_t from, uint64_t to) {
+    if (to > from) {
+        EmitTreeRange(document, writer, version->root, 0, from, to);
+    }
+}
+
+/**
+ * @brief Copies text into the add buffers block by block and emits it.
+ *
+ * The text is split at add block boundaries, so no allocation exceeds one
+ * block and the free tail of the current block is used first.
+ *
+ * @param document The document.
+ * @param writer The writer.
+ * @param text The text.
+ * @param length Length of the text.
+ */
+static void EmitCopiedText(Document* document, ChunkWriter* writer, const char* text, uint64_t length) {
+    while (length > 0 && !writer->failed) {
+        size_t take = length < DOCUMENT_ADD_BLOCK_SIZE ? (size_t)length : DOCUMENT_ADD_BLOCK_SIZE;
+        if (document->bufferCount > 1) {
+            const DocumentBuffer* block = &document->buffers[document->bufferCount - 1];
+            uint64_t room = block->capacity - block->length;
+            if (room > 0 && room < take) {
+                take = (size_t)room;
+            }
+        }
+
+        Piece piece;
+        if (!AppendToAddBuffer(document, text, take, &piece)) {
+            writer->failed = true;
+            return;
+        }
+        WriterEmitPiece(writer, &piece);
+        text += take;
+        length -= take;
+    }
+}
+
+/**
+ * @brief Creates the initial version holding the whole original buffer.
+ *
+ * @param document The document whose buffer 0 is set up.
+ * @return true if successful, false on allocation failure.
+ */
+static bool CreateInitialVersion(Document* document) {
+    ChunkWriter writer = { 0 };
+    const DocumentBuffer* original = &document->buffers[DOCUMENT_ORIGINAL_BUFFER];
+    Piece piece;
+    piece.buffer = DOCUMENT_ORIGINAL_BUFFER;
+    piece.start = 0;
+    piece.length = original->length;
+    piece.lineBreaks = original->lines.count ? original->lines.count - 1 : 0;
+    WriterEmitPiece(&writer, &piece);
+
+    document->base = WriterFinish(document, &writer);
+    if (!document->base) {
+        return false;
+    }
+    document->current = document->base;
+    ThreadAtomicIncrement(&document->base->refCount);
+    document->savedVersionId = document->base->id;
+    return true;
+}
+
+/**
+ * @brief Allocates a document with an empty original buffer slot.
+ *
+ * @return The document, or NULL on allocation failure.
+ */
+static Document* DocumentAllocate(void) {
+    Document* document = (Document*)MemoryCalloc(MEMORY_TAG_DOCUMENT, 1, sizeof(Document));
+    if (!document) {
+        return NULL;
+    }
+    if (!AddBufferSlot(document)) {
+        MemoryFree(document->retiredBuffers);
+        MemoryFree(document);
+        return NULL;
+    }
+    MemoryArenaInit(&document->scratch, MEMORY_TAG_DOCUMENT);
+    document->storageRefs = 1;
+    return document;
+}
+
+/**
+ * @brief Creates a document holding a copy of the given text.
+ *
+ * @param text The initial text (may be NULL if length is 0).
+ * @param length Length of the text in bytes.
+ * @return The new document, or NULL on allocation failure.
+ */
+Document* DocumentCreateFromText(const char* text, size_t length) {
+    if (!text && length > 0) {
+        return NULL;
+    }
+
+    Document* document = DocumentAllocate();
+    if (!document) {
+        return NULL;
+    }
+
+    DocumentBuffer* original = &document->buffers[DOCUMENT_ORIGINAL_BUFFER];
+    char* copy = (char*)MemoryAlloc(MEMORY_TAG_DOCUMENT, length ? length : 1);
+    if (!copy) {
+        DocumentDestroy(document);
+        return NULL;
+    }
+    if (length > 0) {
+        memcpy(copy, text, length);
+    }
+    original->data = copy;
+    original->length = length;
+    original->capacity = length;
+    original->owned = true;
+
+    if (!LineIndexBuild(&original->lines, copy, length) || !CreateInitialVersion(document)) {
+        DocumentDestroy(document);
+        return NULL;
+    }
+    return document;
+}
+
+/**
+ * @brief Builds the line index of a mapping while its later windows are read.
+ *
+ * Each window is scanned after the reads of the windows behind it have been
+ * requested, so on a cold cache the scan runs while the disk works instead
+ * of waiting for one page fault at a time.
+ *
+ * @param mappedFile The mapping.
+ * @param[out] lines Receives the line index.
+ * @return true if successful, false on allocation failure.
+ */
+static bool BuildMappedLineIndex(const MappedFile* mappedFile, LineIndex* lines) {
+    uint64_t size = mappedFile->size;
+    uint64_t window = MAPFILE_READ_AHEAD_WINDOW;
+    if (!LineIndexBegin(lines, size)) {
+        return false;
+    }
+
+    MapFileReadAhead(mappedFile, 0, window * (MAPFILE_READ_AHEAD_DEPTH - 1));
+    for (uint64_t offset = 0; offset < size; offset += window) {
+        MapFileReadAhead(mappedFile, offset + (MAPFILE_READ_AHEAD_DEPTH - 1) * window, window);
+        uint64_t length = size - offset < window ? size - offset : window;
+        if (!LineIndexAppend(lines, mappedFile->data + offset, length, offset)) {
+            LineIndexFree(lines);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Creates a document backed by a memory-mapped file.
+ *
+ * @param mappedFile The mapping; ownership is transferred to the document.
+ * @param lineIndex Line index of the mapping, or NULL to build one.
+ * @return The new document, or NULL on failure (the mapping is then closed).
+ */
+Document* DocumentCreateFromMapping(MappedFile* mappedFile, LineIndex* lineIndex) {
+    if (!mappedFile || !mappedFile->data) {
+        return NULL;
+    }
+
+    Document* document = DocumentAllocate();
+    if (!document) {
+        MapFileClose(mappedFile);
+        if (lineIndex) {
+            LineIndexFree(lineIndex);
+        }
+        return NULL;
+    }
+
+    document->mapping = *mappedFile;
+    memset(mappedFile, 0, sizeof(*mappedFile));
+
+    DocumentBuffer* original = &document->buffers[DOCUMENT_ORIGINAL_BUFFER];
+    original->data = document->mapping.data;
+    original->length = document->mapping.size;
+    original->capacity = document->mapping.size;
+
+    if (lineIndex && lineIndex->count > 0) {
+        original->lines = *lineIndex;
+        memset(lineIndex, 0, sizeof(*lineIndex));
+    } else if (!BuildMappedLineIndex(&document->mapping, &original->lines)) {
+        DocumentDestroy(document);
+        return NULL;
+    }
+
+    if (!CreateInitialVersion(document)) {
+        DocumentDestroy(document);
+        return NULL;
+    }
+    return document;
+}
+
+/**
+ * @brief Releases the buffers and the mapping of a document, and the document itself.
+ *
+ * @param document The document.
+ */
+static void FreeStorage(Document* document) {
+    for (size_t i = 0; i < document->bufferCount; i++) {
+        if (document->buffers[i].owned) {
+            MemoryFree((char*)document->buffers[i].data);
+        }
+        LineIndexFree(&document->buffers[i].lines);
+    }
+    MemoryFree(document->buffers);
+    for (size_t i = 0; i < document->retiredCount; i++) {
+        MemoryFree(document->retiredBuffers[i]);
+    }
+    MemoryFree(document->retiredBuffers);
+    MapFileClose(&document->mapping);
+    MemoryFree(document);
+}
+
+/**
+ * @brief Drops a reference to the storage of a document, freeing it with the last one.
+ *
+ * @param document The document.
+ */
+static void StorageRelease(Document* document) {
+    if (ThreadAtomicDecrement(&document->storageRefs) == 0) {
+        FreeStorage(document);
+    }
+}
+
+/**
+ * @brief Destroys a document and releases all of its memory and mappings.
+ *
+ * Buffers still referenced by slices or snapshots are released with the
+ * last of them.
+ *
+ * @param document The document to destroy. NULL is ignored.
+ */
+void DocumentDestroy(Document* document) {
+    if (!document) {
+        return;
+    }
+
+    for (size_t i = 0; i < document->historyCount; i++) {
+        VersionRelease(document->history[i].version);
+        MemoryFree(document->history[i].changes);
+    }
+    MemoryFree(document->history);
+    VersionRelease(document->current);
+    VersionRelease(document->base);
+    MemoryArenaFree(&document->scratch);
+    MemoryFree(document->scratchChanges);
+    MemoryFree(document->listeners);
+
+    // Slices on the clipboard and snapshots may still point into the buffers
+    StorageRelease(document);
+}
+
+/**
+ * @brief Gets the document length in bytes.
+ *
+ * @param document The document.
+ * @return The length in bytes.
+ */
+uint64_t DocumentLength(const Document* document) {
+    return document ? VersionLength(document->current) : 0;
+}
+
+/**
+ * @brief Gets the number of lines (line feeds plus one).
+ *
+ * @param document The document.
+ * @return The line count, at least 1.
+ */
+uint64_t DocumentLineCount(const Document* document) {
+    if (!document) {
+        return 1;
+    }
+    return VersionLineBreaks(document->current) + 1;
+}
+
+/**
+ * @brief Gets the offset at which a line starts.
+ *
+ * @param document The document.
+ * @param line Zero-based line number; clamped to the last line.
+ * @return Byte offset of the first character of the line.
+ */
+uint64_t DocumentLineStart(const Document* document, uint64_t line) {
+    if (!document || line == 0) {
+        return 0;
+    }
+
+    const DocumentVersion* version = document->current;
+    uint64_t totalBreaks = VersionLineBreaks(version);
+    if (line > totalBreaks) {
+        line = totalBreaks;
+        if (line == 0) {
+            return 0;
+        }
+    }
+
+    // Find the chunk holding the line feed that ends line - 1
+    uint64_t pieceStart;
+    uint64_t chunkLine;
+    const PieceChunk* chunk = FindChunkByLineBreak(version, line, &pieceStart, &chunkLine);
+    uint64_t remaining = line - chunkLine;
+    for (uint32_t i = 0; i < chunk->count; i++) {
+        const Piece* piece = &chunk->pieces[i];
+        if (remaining <= piece->lineBreaks) {
+            // The n-th line feed after piece->start ends where buffer line (first + n) starts
+            const LineIndex* lines = &document->buffers[piece->buffer].lines;
+            size_t firstLine = LineIndexLineFromOffset(lines, piece->start);
+            uint64_t bufferOffset = lines->starts[firstLine + remaining];
+            return pieceStart + (bufferOffset - piece->start);
+        }
+        remaining -= piece->lineBreaks;
+        pieceStart += piece->length;
+    }
+    return VersionLength(version);
+}
+
+/**
+ * @brief Gets the offset at which the content of a line ends.
+ *
+ * @param document The document.
+ * @param line Zero-based line number; clamped to the last line.
+ * @return Byte offset just past the last content character of the line.
+ */
+uint64_t DocumentLineEnd(const Document* document, uint64_t line) {
+    if (!document) {
+        return 0;
+    }
+    if (line + 1 >= DocumentLineCount(document)) {
+        return DocumentLength(document);
+    }
+
+    uint64_t lineStart = DocumentLineStart(document, line);
+    uint64_t end = DocumentLineStart(document, line + 1) - 1; // Position of the line feed
+    if (end > lineStart && DocumentCharAt(document, end - 1) == '\r') {
+        end--;
+    }
+    return end;
+}
+
+/**
+ * @brief Finds the line containing a byte offset.
+ *
+ * @param document The document.
+ * @param offset Byte offset; clamped to the document length.
+ * @return Zero-based line number.
+ */
+uint64_t DocumentLineFromOffset(const Document* document, uint64_t offset) {
+    if (!document) {
+        return 0;
+    }
+
+    const DocumentVersion* version = document->current;
+    if (offset >= VersionLength(version)) {
+        return VersionLineBreaks(version);
+    }
+
+    uint64_t pieceStart;
+    uint64_t line;
+    const PieceChunk* chunk = FindChunkByOffset(version, offset, &pieceStart, &line);
+    for (uint32_t i = 0; i < chunk->count; i++) {
+        const Piece* piece = &chunk->pieces[i];
+        if (offset < pieceStart + piece->length) {
+            const LineIndex* lines = &document->buffers[piece->buffer].lines;
+            return line + LineIndexCountBreaks(lines, piece->start, piece->start + (offset - pieceStart));
+        }
+        line += piece->lineBreaks;
+        pieceStart += piece->length;
+    }
+    return line;
+}
+
+/**
+ * @brief Positions an iterator at a byte offset of a version.
+ *
+ * @param buffers Buffer table the pieces of the version point into.
+ * @param version The version to iterate.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize.
+ */
+static void IterInitVersion(const DocumentBuffer* buffers, const DocumentVersion* version, uint64_t offset,
+                            DocumentIterator* iterator) {
+    memset(iterator, 0, sizeof(*iterator));
+    iterator->buffers = buffers;
+    iterator->version = version;
+    if (offset >= VersionLength(version)) {
+        return;
+    }
+
+    uint64_t pieceStart;
+    uint64_t line;
+    const PieceChunk* chunk = FindChunkByOffset(version, offset, &pieceStart, &line);
+    iterator->chunkEnd = pieceStart + chunk->length;
+    uint32_t pieceIndex = 0;
+    while (pieceIndex < chunk->count && offset >= pieceStart + chunk->pieces[pieceIndex].length) {
+        pieceStart += chunk->pieces[pieceIndex].length;
+        pieceIndex++;
+    }
+
+    iterator->chunk = chunk;
+    iterator->piece = pieceIndex;
+    iterator->skip = offset - pieceStart;
+}
+
+/**
+ * @brief Positions an iterator at a byte offset.
+ *
+ * @param document The document.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize.
+ */
+void DocumentIterInit(const Document* document, uint64_t offset, DocumentIterator* iterator) {
+    if (!iterator) {
+        return;
+    }
+    if (!document) {
+        memset(iterator, 0, sizeof(*iterator));
+        return;
+    }
+    IterInitVersion(document->buffers, document->current, offset, iterator);
+}
+
+/**
+ * @brief Returns the next contiguous span of the document.
+ *
+ * @param iterator The iterator.
+ * @param[out] data Receives a pointer to the span.
+ * @param[out] length Receives the span length.
+ * @return true if a span was returned, false at the end of the document.
+ */
+bool DocumentIterNext(DocumentIterator* iterator, const char** data, size_t* length) {
+    if (!iterator || !iterator->version) {
+        return false;
+    }
+
+    const DocumentVersion* version = iterator->version;
+    while (iterator->chunk) {
+        const PieceChunk* chunk = iterator->chunk;
+        if (iterator->piece >= chunk->count) {
+            // Nodes have no parent links, so the next chunk is looked up from the root
+            uint64_t chunkStart;
+            uint64_t chunkLine;
+            iterator->chunk = NULL;
+            iterator->piece = 0;
+            if (iterator->chunkEnd < VersionLength(version)) {
+                iterator->chunk = FindChunkByOffset(version, iterator->chunkEnd, &chunkStart, &chunkLine);
+                iterator->chunkEnd = chunkStart + iterator->chunk->length;
+            }
+            continue;
+        }
+
+        const Piece* piece = &chunk->pieces[iterator->piece++];
+        uint64_t skip = iterator->skip;
+        iterator->skip = 0;
+        if (skip >= piece->length) {
+            continue;
+        }
+
+        *data = iterator->buffers[piece->buffer].data + piece->start + skip;
+        *length = (size_t)(piece->length - skip);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Copies a range of the document into a buffer.
+ *
+ * @param document The document.
+ * @param offset Start of the range.
+ * @param[out] buffer Receives the bytes (not NUL-terminated).
+ * @param length Number of bytes requested.
+ * @return Number of bytes copied (less than length at the end of the document).
+ */
+size_t DocumentRead(const Document* document, uint64_t offset, char* buffer, size_t length) {
+    if (!document || !buffer) {
+        return 0;
+    }
+
+    DocumentIterator iterator;
+    DocumentIterInit(document, offset, &iterator);
+
+    size_t copied = 0;
+    const char* span;
+    size_t spanLength;
+    while (copied < length && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t take = spanLength < length - copied ? spanLength : length - copied;
+        memcpy(buffer + copied, span, take);
+        copied += take;
+    }
+    return copied;
+}
+
+/**
+ * @brief Gets the byte at an offset.
+ *
+ * @param document The document.
+ * @param offset Byte offset.
+ * @return The byte, or '\0' if the offset is past the end.
+ */
+char DocumentCharAt(const Document* document, uint64_t offset) {
+    char c = '\0';
+    DocumentRead(document, offset, &c, 1);
+    return c;
+}
+
+/**
+ * @brief Copies a range of the document into a new NUL-terminated string.
+ *
+ * @param document The document.
+ * @param offset Start of the range.
+ * @param length Number of bytes to copy; clamped to the document end.
+ * @return A newly allocated string, or NULL on failure.
+ */
+char* DocumentCopyRange(const Document* document, uint64_t offset, uint64_t length) {
+    if (!document) {
+        return NULL;
+    }
+
+    uint64_t documentLength = DocumentLength(document);
+    if (offset > documentLength) {
+        offset = documentLength;
+    }
+    if (length > documentLength - offset) {
+        length = documentLength - offset;
+    }
+    if (length >= (uint64_t)SIZE_MAX) {
+        return NULL;
+    }
+
+    char* text = (char*)malloc((size_t)length + 1);
+    if (!text) {
+        return NULL;
+    }
+    size_t copied = DocumentRead(document, offset, text, (size_t)length);
+    text[copied] = '\0';
+    return text;
+}
+
+/**
+ * @brief Adds a history entry for a new version, dropping redo entries and the oldest entry if full.
+ *
+ * @param document The document.
+ * @param version The new version; the history takes over the reference.
+ * @param changes The changes; ownership is transferred.
+ * @param changeCount Number of changes.
+ * @return true if successful, false on allocation failure.
+ */
+static bool PushHistory(Document* document, DocumentVersion* version, DocumentChange* changes,
+                        size_t changeCount) {
+    // A new edit makes everything after the current position unreachable
+    while (document->historyCount > document->historyPosition) {
+        HistoryEntry* entry = &document->history[--document->historyCount];
+        VersionRelease(entry->version);
+        MemoryFree(entry->changes);
+    }
+
+    if (document->historyCount == DOCUMENT_MAX_HISTORY) {
+        VersionRelease(document->base);
+        document->base = document->history[0].version;
+        MemoryFree(document->history[0].changes);
+        memmove(document->history, document->history + 1, (document->historyCount - 1) * sizeof(HistoryEntry));
+        document->historyCount--;
+    }
+
+    if (document->historyCount == document->historyCapacity) {
+        size_t newCapacity = document->historyCapacity ? document->historyCapacity * 2 : 16;
+        HistoryEntry* newHistory = (HistoryEntry*)MemoryRealloc(MEMORY_TAG_DOCUMENT, document->history,
+                                                                newCapacity * sizeof(HistoryEntry));
+        if (!newHistory) {
+            return false;
+        }
+        document->history = newHistory;
+        document->historyCapacity = newCapacity;
+    }
+
+    HistoryEntry* entry = &document->history[document->historyCount++];
+    entry->version = version;
+    entry->changes = changes;
+    entry->changeCount = changeCount;
+    document->historyPosition = document->historyCount;
+    return true;
+}
+
+/**
+ * @brief Folds a batch into the history entry of the open group.
+ *
+ * The entry keeps the newest version and a single change covering
+ * everything the group touched, so a group of any length costs one entry.
+ *
+ * @param document The document.
+ * @param version The new version; the history takes over the reference.
+ * @param changes The changes of the batch.
+ * @param changeCount Number of changes.
+ * @param oldLength Length before the batch.
+ * @return true if successful, false on allocation failure.
+ */
+static bool MergeIntoGroup(Document* document, DocumentVersion* version, const DocumentChange* changes,
+                           size_t changeCount, uint64_t oldLength) {
+    HistoryEntry* entry = &document->history[document->historyCount - 1];
+    if (entry->changeCount != 1) {
+        DocumentChange* merged = (DocumentChange*)MemoryAlloc(MEMORY_TAG_DOCUMENT, sizeof(DocumentChange));
+        if (!merged) {
+            return false;
+        }
+        MemoryFree(entry->changes);
+        entry->changes = merged;
+        entry->changeCount = 1;
+    }
+
+    const DocumentChange* last = &changes[changeCount - 1];
+    uint64_t suffix = oldLength - (last->offset + last->removedLength);
+    if (changes[0].offset < document->groupPrefix) {
+        document->groupPrefix = changes[0].offset;
+    }
+    if (suffix < document->groupSuffix) {
+        document->groupSuffix = suffix;
+    }
+
+    uint64_t untouched = document->groupPrefix + document->groupSuffix;
+    entry->changes[0].offset = document->groupPrefix;
+    entry->changes[0].removedLength = document->groupLength - untouched;
+    entry->changes[0].insertedLength = VersionLength(version) - untouched;
+    VersionRelease(entry->version);
+    entry->version = version;
+    return true;
+}
+
+/**
+ * @brief Emits the content inserted by one edit.
+ *
+ * @param document The document.
+ * @param writer The writer.
+ * @param piece The piece of inserted text (unused for slices).
+ * @param slice The inserted slice, or NULL for text.
+ */
+static void EmitInsertion(Document* document, ChunkWriter* writer, const Piece* piece, const DocumentSlice* slice) {
+    if (slice) {
+        EmitVersionRange(document, writer, slice->version, 0, VersionLength(slice->version));
+    } else {
+        EmitInsertedPiece(document, writer, piece);
+    }
+}
+
+/**
+ * @brief Emits a subtree of the old version with the edits that fall inside it applied.
+ *
+ * Subtrees that no edit touches are shared as a whole, and subtrees that an
+ * edit removes entirely are skipped, so the walk visits only the paths to
+ * the edited chunks.
+ *
+ * @param document The document.
+ * @param writer The writer.
+ * @param pass The edits and how far they have been emitted.
+ * @param node The subtree.
+ * @param nodeStart Offset of the subtree in the old version.
+ */
+static void EmitEditedTree(Document* document, ChunkWriter* writer, EditPass* pass, ChunkNode* node,
+                           uint64_t nodeStart) {
+    if (!node || writer->failed) {
+        return;
+    }
+    uint64_t nodeEnd = nodeStart + node->length;
+    bool noEditBefore = pass->next >= pass->count || pass->changes[pass->next].offset >= nodeEnd;
+    if (pass->deleteUntil >= nodeEnd && noEditBefore) {
+        return;
+    }
+    if (pass->deleteUntil <= nodeStart && noEditBefore && !WriterTakesPieces(writer)) {
+        WriterEmitTree(writer, node);
+        return;
+    }
+
+    EmitEditedTree(document, writer, pass, node->left, nodeStart);
+    PieceChunk* chunk = node->chunk;
+    uint64_t chunkStart = nodeStart + (node->left ? node->left->length : 0);
+    uint64_t chunkEnd = chunkStart + chunk->length;
+    if (pass->deleteUntil <= chunkStart &&
+        (pass->next >= pass->count || pass->changes[pass->next].offset >= chunkEnd)) {
+        WriterEmitChunk(writer, chunk);
+    } else {
+        uint64_t pieceStart = chunkStart;
+        for (uint32_t pi = 0; pi < chunk->count; pi++) {
+            const Piece* piece = &chunk->pieces[pi];
+            uint64_t pieceEnd = pieceStart + piece->length;
+            uint64_t position = pieceStart;
+            for (;;) {
+                if (pass->deleteUntil > position) {
+                    position = pass->deleteUntil < pieceEnd ? pass->deleteUntil : pieceEnd;
+                }
+                if (pass->next < pass->count && pass->changes[pass->next].offset < pieceEnd) {
+                    size_t e = pass->next++;
+                    EmitPiecePart(document, writer, piece, pieceStart, position, pass->changes[e].offset);
+                    EmitInsertion(document, writer, &pass->inserted[e], pass->slices[e]);
+                    position = pass->changes[e].offset;
+                    pass->deleteUntil = pass->removeEnds[e];
+                    continue;
+                }
+                EmitPiecePart(document, writer, piece, pieceStart, position, pieceEnd);
+                break;
+            }
+            pieceStart = pieceEnd;
+        }
+    }
+    EmitEditedTree(document, writer, pass, node->right, chunkEnd);
+}
+
+/**
+ * @brief Applies a batch of edits as one undoable step.
+ *
+ * @param document The document.
+ * @param edits The edits, in pre-edit coordinates.
+ * @param editCount Number of edits.
+ * @return true if successful, false if the edits are invalid or memory ran out.
+ */
+bool DocumentApplyEdits(Document* document, const DocumentEdit* edits, size_t editCount) {
+    if (!document || (!edits && editCount > 0)) {
+        return false;
+    }
+
+    // Validate ordering and bounds before touching any storage
+    const DocumentVersion* old = document->current;
+    uint64_t length = VersionLength(old);
+    uint64_t previousEnd = 0;
+    size_t effectiveCount = 0;
+    for (size_t i = 0; i < editCount; i++) {
+        const DocumentEdit* edit = &edits[i];
+        if (edit->offset < previousEnd || edit->offset > length || edit->removeLength > length - edit->offset) {
+            return false;
+        }
+        if (edit->slice ? edit->slice->document != document || DocumentSliceLength(edit->slice) != edit->textLength
+                        : !edit->text && edit->textLength > 0) {
+            return false;
+        }
+        previousEnd = edit->offset + edit->removeLength;
+        if (edit->removeLength > 0 || edit->textLength > 0) {
+            effectiveCount++;
+        }
+    }
+    if (effectiveCount == 0) {
+        return true;
+    }
+
+    DocumentChange* changes = (DocumentChange*)MemoryAlloc(MEMORY_TAG_DOCUMENT,
+                                                           effectiveCount * sizeof(DocumentChange));
+    Piece* inserted = (Piece*)MemoryArenaAlloc(&document->scratch, effectiveCount * sizeof(Piece));
+    const DocumentSlice** slices =
+        (const DocumentSlice**)MemoryArenaAlloc(&document->scratch, effectiveCount * sizeof(DocumentSlice*));
+    uint64_t* removeEnds = (uint64_t*)MemoryArenaAlloc(&document->scratch, effectiveCount * sizeof(uint64_t));
+    if (!changes || !inserted || !slices || !removeEnds) {
+        MemoryFree(changes);
+        MemoryArenaReset(&document->scratch);
+        return false;
+    }
+
+    // Copy all inserted text into the add buffers first
+    size_t n = 0;
+    for (size_t i = 0; i < editCount; i++) {
+        const DocumentEdit* edit = &edits[i];
+        if (edit->removeLength == 0 && edit->textLength == 0) {
+            continue;
+        }
+        memset(&inserted[n], 0, sizeof(Piece));
+        slices[n] = edit->slice;
+        if (!edit->slice && edit->textLength > 0 &&
+            !AppendToAddBuffer(document, edit->text, edit->textLength, &inserted[n])) {
+            MemoryFree(changes);
+            MemoryArenaReset(&document->scratch);
+            return false;
+        }
+        changes[n].offset = edit->offset;
+        changes[n].removedLength = edit->removeLength;
+        changes[n].insertedLength = edit->textLength;
+        removeEnds[n] = edit->offset + edit->removeLength;
+        n++;
+    }
+
+    // One walk down the old chunk tree; subtrees no edit touches are shared with the old version
+    ChunkWriter writer = { 0 };
+    EditPass pass = { changes, inserted, slices, removeEnds, n, 0, 0 };
+    EmitEditedTree(document, &writer, &pass, old->root, 0);
+
+    // Insertions at the very end of the document
+    for (; pass.next < n; pass.next++) {
+        EmitInsertion(document, &writer, &inserted[pass.next], slices[pass.next]);
+    }
+    MemoryArenaReset(&document->scratch);
+
+    DocumentVersion* version = WriterFinish(document, &writer);
+    if (!version) {
+        MemoryFree(changes);
+        return false;
+    }
+
+    SetCurrentVersion(document, version);
+    if (document->groupOpen && document->historyPosition == document->historyCount) {
+        if (!MergeIntoGroup(document, version, changes, n, length)) {
+            VersionRelease(version);
+            document->groupOpen = false;
+        }
+        NotifyListeners(document, changes, n);
+        MemoryFree(changes);
+        return true;
+    }
+    if (!PushHistory(document, version, changes, n)) {
+        // The edit stands, it just cannot be undone
+        VersionRelease(version);
+        MemoryFree(changes);
+        NotifyListeners(document, NULL, 0);
+        return true;
+    }
+
+    if (document->groupDepth > 0) {
+        document->groupOpen = true;
+        document->groupLength = length;
+        document->groupPrefix = changes[0].offset;
+        document->groupSuffix = length - (changes[n - 1].offset + changes[n - 1].removedLength);
+    }
+    NotifyListeners(document, changes, n);
+    return true;
+}
+
+/**
+ * @brief Reverts the most recent edit batch.
+ *
+ * @param document The document.
+ * @param[out] changeCount Receives the number of changes applied.
+ * @return The changes that were applied, or NULL if there is nothing to undo.
+ */
+const DocumentChange* DocumentUndo(Document* document, size_t* changeCount) {
+    if (!document || !changeCount || document->historyPosition == 0) {
+        return NULL;
+    }
+
+    const HistoryEntry* entry = &document->history[document->historyPosition - 1];
+    if (document->scratchCapacity < entry->changeCount) {
+        DocumentChange* scratch = (DocumentChange*)MemoryRealloc(MEMORY_TAG_DOCUMENT, document->scratchChanges,
+                                                                 entry->changeCount * sizeof(DocumentChange));
+        if (!scratch) {
+            return NULL;
+        }
+        document->scratchChanges = scratch;
+        document->scratchCapacity = entry->changeCount;
+    }
+
+    // Express the inverse changes in the coordinates of the edited version
+    int64_t delta = 0;
+    for (size_t i = 0; i < entry->changeCount; i++) {
+        const DocumentChange* change = &entry->changes[i];
+        DocumentChange* inverse = &document->scratchChanges[i];
+        inverse->offset = (uint64_t)((int64_t)change->offset + delta);
+        inverse->removedLength = change->insertedLength;
+        inverse->insertedLength = change->removedLength;
+        delta += (int64_t)change->insertedLength - (int64_t)change->removedLength;
+    }
+
+    document->groupOpen = false;
+    document->historyPosition--;
+    DocumentVersion* previous = document->historyPosition > 0
+        ? document->history[document->historyPosition - 1].version
+        : document->base;
+    SetCurrentVersion(document, previous);
+
+    *changeCount = entry->changeCount;
+    NotifyListeners(document, document->scratchChanges, entry->changeCount);
+    return document->scratchChanges;
+}
+
+/**
+ * @brief Reapplies the most recently undone edit batch.
+ *
+ * @param document The document.
+ * @param[out] changeCount Receives the number of changes applied.
+ * @return The changes that were applied, or NULL if there is nothing to redo.
+ */
+const DocumentChange* DocumentRedo(Document* document, size_t* changeCount) {
+    if (!document || !changeCount || document->historyPosition >= document->historyCount) {
+        return NULL;
+    }
+
+    const HistoryEntry* entry = &document->history[document->historyPosition++];
+    document->groupOpen = false;
+    SetCurrentVersion(document, entry->version);
+
+    *changeCount = entry->changeCount;
+    NotifyListeners(document, entry->changes, entry->changeCount);
+    return entry->changes;
+}
+
+/**
+ * @brief Starts merging the following edit batches into one undo step.
+ *
+ * @param document The document.
+ */
+void DocumentBeginGroup(Document* document) {
+    if (document) {
+        document->groupDepth++;
+    }
+}
+
+/**
+ * @brief Ends a group started by DocumentBeginGroup.
+ *
+ * @param document The document.
+ */
+void DocumentEndGroup(Document* document) {
+    if (document && document->groupDepth > 0 && --document->groupDepth == 0) {
+        document->groupOpen = false;
+    }
+}
+
+/**
+ * @brief Checks whether the document changed since it was loaded or last saved.
+ *
+ * @param document The document.
+ * @return true if modified, false otherwise.
+ */
+bool DocumentIsModified(const Document* document) {
+    return document && document->current->id != document->savedVersionId;
+}
+
+/**
+ * @brief Records the current content as the saved state.
+ *
+ * @param document The document.
+ */
+void DocumentMarkSaved(Document* document) {
+    if (document) {
+        document->savedVersionId = document->current->id;
+    }
+}
+
+/**
+ * @brief Records that the content of a snapshot has been saved.
+ *
+ * @param document The document.
+ * @param snapshot A snapshot of the document.
+ */
+void DocumentMarkSnapshotSaved(Document* document, const DocumentSnapshot* snapshot) {
+    if (document && snapshot && snapshot->document == document) {
+        document->savedVersionId = snapshot->version->id;
+    }
+}
+
+/**
+ * @brief Registers a callback invoked after every content change.
+ *
+ * @param document The document.
+ * @param listener The callback.
+ * @param context Pointer passed back to the callback.
+ * @return true if successful, false on allocation failure.
+ */
+bool DocumentAddListener(Document* document, DocumentListener listener, void* context) {
+    if (!document || !listener) {
+        return false;
+    }
+    if (document->listenerCount == document->listenerCapacity) {
+        size_t newCapacity = document->listenerCapacity ? document->listenerCapacity * 2 : 4;
+        ListenerEntry* newListeners = (ListenerEntry*)MemoryRealloc(MEMORY_TAG_DOCUMENT, document->listeners,
+                                                                    newCapacity * sizeof(ListenerEntry));
+        if (!newListeners) {
+            return false;
+        }
+        document->listeners = newListeners;
+        document->listenerCapacity = newCapacity;
+    }
+    document->listeners[document->listenerCount].callback = listener;
+    document->listeners[document->listenerCount].context = context;
+    document->listenerCount++;
+    return true;
+}
+
+/**
+ * @brief Removes a callback registered with DocumentAddListener.
+ *
+ * @param document The document.
+ * @param listener The callback.
+ * @param context The context it was registered with.
+ */
+void DocumentRemoveListener(Document* document, DocumentListener listener, void* context) {
+    if (!document) {
+        return;
+    }
+    for (size_t i = 0; i < document->listenerCount; i++) {
+        if (document->listeners[i].callback == listener && document->listeners[i].context == context) {
+            memmove(&document->listeners[i], &document->listeners[i + 1],
+                    (document->listenerCount - i - 1) * sizeof(ListenerEntry));
+            document->listenerCount--;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Gets the line index of the file the document was loaded from.
+ *
+ * @param document The document.
+ * @return The line index of the original content (empty for new documents).
+ */
+const LineIndex* DocumentOriginalLineIndex(const Document* document) {
+    return document ? &document->buffers[DOCUMENT_ORIGINAL_BUFFER].lines : NULL;
+}
+
+/**
+ * @brief Gets the content the document was loaded from.
+ *
+ * @param document The document.
+ * @param[out] length Receives the length of the original content.
+ * @return Pointer to the original content (valid until the document is destroyed).
+ */
+const char* DocumentOriginalText(const Document* document, uint64_t* length) {
+    if (!document || !length) {
+        return NULL;
+    }
+    const DocumentBuffer* original = &document->buffers[DOCUMENT_ORIGINAL_BUFFER];
+    *length = original->length;
+    return original->data;
+}
+
+/**
+ * @brief Reports the runs of a subtree that reference the original content, in document order.
+ *
+ * @param node The subtree.
+ * @param offset Offset of the subtree.
+ * @param callback Invoked once per run.
+ * @param context Pointer passed to the callback.
+ * @return false if the callback stopped the walk, true otherwise.
+ */
+static bool ForEachOriginalRunInTree(const ChunkNode* node, uint64_t offset, DocumentOriginalRunCallback callback,
+                                     void* context) {
+    if (!node) {
+        return true;
+    }
+    if (!ForEachOriginalRunInTree(node->left, offset, callback, context)) {
+        return false;
+    }
+
+    offset += node->left ? node->left->length : 0;
+    const PieceChunk* chunk = node->chunk;
+    for (uint32_t pi = 0; pi < chunk->count; pi++) {
+        const Piece* piece = &chunk->pieces[pi];
+        if (piece->buffer == DOCUMENT_ORIGINAL_BUFFER && !callback(offset, piece->start, piece->length, context)) {
+            return false;
+        }
+        offset += piece->length;
+    }
+    return ForEachOriginalRunInTree(node->right, offset, callback, context);
+}
+
+/**
+ * @brief Reports, in document order, every run that still references the original content.
+ *
+ * @param document The document.
+ * @param callback Invoked once per run.
+ * @param context Pointer passed to the callback.
+ */
+void DocumentForEachOriginalRun(const Document* document, DocumentOriginalRunCallback callback, void* context) {
+    if (!document || !callback) {
+        return;
+    }
+
+    ForEachOriginalRunInTree(document->current->root, 0, callback, context);
+}
+
+/**
+ * @brief Wraps the output of a writer in a new slice.
+ *
+ * @param document The document owning the buffers.
+ * @param writer The writer; its output is consumed.
+ * @param parts Captured ranges; ownership is transferred.
+ * @param partCount Number of parts.
+ * @return The slice, or NULL on failure.
+ */
+static DocumentSlice* SliceFinish(Document* document, ChunkWriter* writer, DocumentRange* parts, size_t partCount) {
+    DocumentVersion* version = WriterFinish(document, writer);
+    DocumentSlice* slice = version ? (DocumentSlice*)MemoryAlloc(MEMORY_TAG_DOCUMENT, sizeof(DocumentSlice)) : NULL;
+    if (!slice) {
+        VersionRelease(version);
+        MemoryFree(parts);
+        return NULL;
+    }
+    slice->refCount = 1;
+    slice->document = document;
+    slice->version = version;
+    slice->parts = parts;
+    slice->partCount = partCount;
+    ThreadAtomicIncrement(&document->storageRefs);
+    return slice;
+}
+
+/**
+ * @brief Creates the part list of a slice holding a single range.
+ *
+ * @param length Length of the slice.
+ * @return The part list, or NULL on allocation failure.
+ */
+static DocumentRange* SinglePart(uint64_t length) {
+    DocumentRange* part = (DocumentRange*)MemoryAlloc(MEMORY_TAG_DOCUMENT, sizeof(DocumentRange));
+    if (part) {
+        part->offset = 0;
+        part->length = length;
+    }
+    return part;
+}
+
+/**
+ * @brief Captures ranges of the current content without copying their bytes.
+ *
+ * @param document The document.
+ * @param ranges The ranges to capture, each within the document.
+ * @param rangeCount Number of ranges (at least 1).
+ * @param separator Text placed between ranges (may be NULL if separatorLength is 0).
+ * @param separatorLength Length of the separator.
+ * @return The slice, or NULL on failure. Release with DocumentSliceRelease.
+ */
+DocumentSlice* DocumentSliceCreate(Document* document, const DocumentRange* ranges, size_t rangeCount,
+                                   const char* separator, size_t separatorLength) {
+    if (!document || !ranges || rangeCount == 0 || (!separator && separatorLength > 0)) {
+        return NULL;
+    }
+    const DocumentVersion* version = document->current;
+    uint64_t length = VersionLength(version);
+    for (size_t i = 0; i < rangeCount; i++) {
+        if (ranges[i].offset > length || ranges[i].length > length - ranges[i].offset) {
+            return NULL;
+        }
+    }
+
+    DocumentRange* parts = (DocumentRange*)MemoryAlloc(MEMORY_TAG_DOCUMENT, rangeCount * sizeof(DocumentRange));
+    if (!parts) {
+        return NULL;
+    }
+
+    // The separator is stored once and referenced between every pair of ranges
+    Piece separatorPiece;
+    memset(&separatorPiece, 0, sizeof(separatorPiece));
+    if (rangeCount > 1 && separatorLength > 0 &&
+        !AppendToAddBuffer(document, separator, separatorLength, &separatorPiece)) {
+        MemoryFree(parts);
+        return NULL;
+    }
+
+    ChunkWriter writer = { 0 };
+    uint64_t position = 0;
+    for (size_t i = 0; i < rangeCount; i++) {
+        if (i > 0) {
+            WriterEmitPiece(&writer, &separatorPiece);
+            position += separatorPiece.length;
+        }
+        EmitVersionRange(document, &writer, version, ranges[i].offset, ranges[i].offset + ranges[i].length);
+        parts[i].offset = position;
+        parts[i].length = ranges[i].length;
+        position += ranges[i].length;
+    }
+    return SliceFinish(document, &writer, parts, rangeCount);
+}
+
+/**
+ * @brief Copies text into the storage of a document and returns it as a slice.
+ *
+ * @param document The document that will receive the text.
+ * @param text The text (may be NULL if length is 0).
+ * @param length Length of the text.
+ * @return The slice, or NULL on failure. Release with DocumentSliceRelease.
+ */
+DocumentSlice* DocumentSliceFromText(Document* document, const char* text, size_t length) {
+    if (!document || (!text && length > 0)) {
+        return NULL;
+    }
+    DocumentRange* parts = SinglePart(length);
+    if (!parts) {
+        return NULL;
+    }
+
+    ChunkWriter writer = { 0 };
+    EmitCopiedText(document, &writer, text, length);
+    return SliceFinish(document, &writer, parts, 1);
+}
+
+/**
+ * @brief Makes a slice usable for edits of a document.
+ *
+ * @param document The document that will receive the slice.
+ * @param slice The slice.
+ * @return A new reference to a slice of the document, or NULL on failure.
+ */
+DocumentSlice* DocumentSliceImport(Document* document, DocumentSlice* slice) {
+    if (!document || !slice) {
+        return NULL;
+    }
+    if (slice->document == document) {
+        slice->refCount++;
+        return slice;
+    }
+
+    DocumentRange* parts = (DocumentRange*)MemoryAlloc(MEMORY_TAG_DOCUMENT, slice->partCount * sizeof(DocumentRange));
+    if (!parts) {
+        return NULL;
+    }
+    memcpy(parts, slice->parts, slice->partCount * sizeof(DocumentRange));
+
+    // Pieces point into the other document's buffers, so their bytes are streamed over
+    ChunkWriter writer = { 0 };
+    DocumentIterator iterator;
+    DocumentSliceIterInit(slice, 0, &iterator);
+    const char* span;
+    size_t spanLength;
+    while (!writer.failed && DocumentIterNext(&iterator, &span, &spanLength)) {
+        EmitCopiedText(document, &writer, span, spanLength);
+    }
+    return SliceFinish(document, &writer, parts, slice->partCount);
+}
+
+/**
+ * @brief Drops a reference to a slice.
+ *
+ * @param slice The slice. NULL is ignored.
+ */
+void DocumentSliceRelease(DocumentSlice* slice) {
+    if (!slice || --slice->refCount > 0) {
+        return;
+    }
+    Document* document = slice->document;
+    VersionRelease(slice->version);
+    MemoryFree(slice->parts);
+    MemoryFree(slice);
+    StorageRelease(document);
+}
+
+/**
+ * @brief Gets the length of a slice.
+ *
+ * @param slice The slice.
+ * @return The length in bytes.
+ */
+uint64_t DocumentSliceLength(const DocumentSlice* slice) {
+    return slice ? VersionLength(slice->version) : 0;
+}
+
+/**
+ * @brief Gets the number of ranges a slice was captured from.
+ *
+ * @param slice The slice.
+ * @return The number of parts, at least 1.
+ */
+size_t DocumentSlicePartCount(const DocumentSlice* slice) {
+    return slice ? slice->partCount : 0;
+}
+
+/**
+ * @brief Creates a slice holding one part of another slice, without the separators.
+ *
+ * @param slice The slice.
+ * @param part Index of the part.
+ * @return The slice, or NULL on failure. Release with DocumentSliceRelease.
+ */
+DocumentSlice* DocumentSlicePart(const DocumentSlice* slice, size_t part) {
+    if (!slice || part >= slice->partCount) {
+        return NULL;
+    }
+    const DocumentRange* range = &slice->parts[part];
+    DocumentRange* parts = SinglePart(range->length);
+    if (!parts) {
+        return NULL;
+    }
+
+    ChunkWriter writer = { 0 };
+    EmitVersionRange(slice->document, &writer, slice->version, range->offset, range->offset + range->length);
+    return SliceFinish(slice->document, &writer, parts, 1);
+}
+
+/**
+ * @brief Positions an iterator at a byte offset of a slice.
+ *
+ * @param slice The slice.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize; use DocumentIterNext to read.
+ */
+void DocumentSliceIterInit(const DocumentSlice* slice, uint64_t offset, DocumentIterator* iterator) {
+    if (!iterator) {
+        return;
+    }
+    if (!slice) {
+        memset(iterator, 0, sizeof(*iterator));
+        return;
+    }
+    IterInitVersion(slice->document->buffers, slice->version, offset, iterator);
+}
+
+/**
+ * @brief Copies a range of a slice into a buffer.
+ *
+ * @param slice The slice.
+ * @param offset Start of the range.
+ * @param[out] buffer Receives the bytes (not NUL-terminated).
+ * @param length Number of bytes requested.
+ * @return Number of bytes copied (less than length at the end of the slice).
+ */
+size_t DocumentSliceRead(const DocumentSlice* slice, uint64_t offset, char* buffer, size_t length) {
+    if (!slice || !buffer) {
+        return 0;
+    }
+
+    DocumentIterator iterator;
+    DocumentSliceIterInit(slice, offset, &iterator);
+
+    size_t copied = 0;
+    const char* span;
+    size_t spanLength;
+    while (copied < length && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t take = spanLength < length - copied ? spanLength : length - copied;
+        memcpy(buffer + copied, span, take);
+        copied += take;
+    }
+    return copied;
+}
+
+/**
+ * @brief Pins the current content for reading on another thread.
+ *
+ * @param document The document; used on its own thread.
+ * @return The snapshot, or NULL on allocation failure. Release with DocumentSnapshotRelease.
+ */
+DocumentSnapshot* DocumentSnapshotCreate(Document* document) {
+    if (!document) {
+        return NULL;
+    }
+    DocumentSnapshot* snapshot = (DocumentSnapshot*)MemoryAlloc(MEMORY_TAG_DOCUMENT, sizeof(DocumentSnapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+
+    // Versions never change and buffer tables are never freed before the storage
+    snapshot->document = document;
+    snapshot->buffers = document->buffers;
+    snapshot->version = document->current;
+    ThreadAtomicIncrement(&snapshot->version->refCount);
+    ThreadAtomicIncrement(&document->storageRefs);
+    return snapshot;
+}
+
+/**
+ * @brief Releases a snapshot, on any thread.
+ *
+ * @param snapshot The snapshot. NULL is ignored.
+ */
+void DocumentSnapshotRelease(DocumentSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    VersionRelease(snapshot->version);
+    StorageRelease(snapshot->document);
+    MemoryFree(snapshot);
+}
+
+/**
+ * @brief Gets the length of a snapshot.
+ *
+ * @param snapshot The snapshot.
+ * @return The length in bytes.
+ */
+uint64_t DocumentSnapshotLength(const DocumentSnapshot* snapshot) {
+    return snapshot ? VersionLength(snapshot->version) : 0;
+}
+
+/**
+ * @brief Checks whether a snapshot still holds the content of its document.
+ *
+ * Unlike the other snapshot functions this reads the document, so it must
+ * be called on the document's own thread and only while the document exists.
+ *
+ * @param snapshot The snapshot.
+ * @return true if the document is at the version the snapshot was taken from, false otherwise.
+ */
+bool DocumentSnapshotIsCurrent(const DocumentSnapshot* snapshot) {
+    return snapshot && snapshot->version == snapshot->document->current;
+}
+
+/**
+ * @brief Gets the number of lines of a snapshot (line feeds plus one).
+ *
+ * @param snapshot The snapshot.
+ * @return The line count, at least 1.
+ */
+uint64_t DocumentSnapshotLineCount(const DocumentSnapshot* snapshot) {
+    if (!snapshot) {
+        return 1;
+    }
+    return VersionLineBreaks(snapshot->version) + 1;
+}
+
+/**
+ * @brief Positions an iterator at a byte offset of a snapshot.
+ *
+ * @param snapshot The snapshot.
+ * @param offset Byte offset at which iteration starts.
+ * @param[out] iterator The iterator to initialize; use DocumentIterNext to read.
+ */
+void DocumentSnapshotIterInit(const DocumentSnapshot* snapshot, uint64_t offset, DocumentIterator* iterator) {
+    if (!iterator) {
+        return;
+    }
+    if (!snapshot) {
+        memset(iterator, 0, sizeof(*iterator));
+        return;
+    }
+    IterInitVersion(snapshot->buffers, snapshot->version, offset, iterator);
+}
+
+/**
+ * @brief Copies a range of a snapshot into a buffer.
+ *
+ * @param snapshot The snapshot.
+ * @param offset Start of the range.
+ * @param[out] buffer Receives the bytes (not NUL-terminated).
+ * @param length Number of bytes requested.
+ * @return Number of bytes copied (less than length at the end of the snapshot).
+ */
+size_t DocumentSnapshotRead(const DocumentSnapshot* snapshot, uint64_t offset, char* buffer, size_t length) {
+    if (!snapshot || !buffer) {
+        return 0;
+    }
+
+    DocumentIterator iterator;
+    DocumentSnapshotIterInit(snapshot, offset, &iterator);
+
+    size_t copied = 0;
+    const char* span;
+    size_t spanLength;
+    while (copied < length && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t take = spanLength < length - copied ? spanLength : length - copied;
+        memcpy(buffer + copied, span, take);
+        copied += take;
+    }
+    return copied;
+}
@@ -7,11 +7,46 @@
 
 #include "../include/fileops.h"
 #include "../include/control.h"
-#include "../include/window.h" // Needed for UpdateStatusBar and EditorState
+#include "../include/diff.h"
+#include "../include/diffview.h"
+#include "../include/filewriter.h"
+#include "../include/frame.h"
+#include "../include/hexview.h"
+#include "../include/layout.h"
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include "../include/window.h" // Needed for ShowTableView and EditorState
+#include <Shlwapi.h> // Required for PathFindExtension
+#include <limits.h>
+#include <string.h>
 
 // External global variables defined in window.c
 extern HWND g_hStatusBar;
+extern HWND g_hHexView;
 extern EditorState g_editorState;
+extern HINSTANCE g_hInstance;
+
+// Bytes copied per read when saving a hex view file to another file
+#define EDITOR_COPY_CHUNK (1 << 20)
+
+// A save running on a worker thread
+typedef struct {
+    HWND hWnd;                  // Window notified of progress and completion
+    Document* document;         // Document the snapshot was taken from; compared, never read
+    DocumentSnapshot* snapshot; // Content being written
+    char filePath[MAX_PATH];
+    BOOL formatting;            // The text passes through the formatter on its way to the file
+    TextFormatter formatter;    // Records the changes, so the document can be made equal to the file
+    BOOL succeeded;
+    Thread* thread;             // NULL when the save ran on the calling thread
+} SaveJob;
+
+// The running save, if any
+static SaveJob* g_saveJob = NULL;
+
+// A save requested while another was running; started when it finishes
+static BOOL g_savePending = FALSE;
+static char g_pendingSavePath[MAX_PATH];
 
 /**
  * @brief Displays an Open file dialog and loads the selected file into the editor.
@@ -53,28 +88,210 @@ BOOL EditorOpenFile(HWND hWnd, HWND hEdit) {
         return FALSE;
     }
     
-    // Read the file
-    long fileSize = 0;
-    char* fileText = ReadFileToBuffer(ofn.lpstrFile, &fileSize);
-    if (!fileText) {
+    // Load the file
+    if (!EditorLoadFile(hEdit, ofn.lpstrFile)) {
         MessageBox(hWnd, "Failed to read file.", "Error", MB_OK | MB_ICONERROR);
         return FALSE;
     }
-    
-    // Set the text in the edit control
-    BOOL result = SetEditorText(hEdit, fileText);
-    
-    // Clean up
-    free(fileText);
 
-    // Update editor state and status bar if successful
-    if (result) {
-        strcpy_s(g_editorState.currentFilePath, MAX_PATH, ofn.lpstrFile);
-        g_editorState.currentFileSize = fileSize;
-        UpdateStatusBar(g_hStatusBar, &g_editorState);
+    return TRUE;
+}
+
+/**
+ * @brief Shows a binary file in the hex view.
+ *
+ * @param file The file; ownership is transferred to the hex view.
+ * @param filePath Path to the file.
+ * @return TRUE if the file is shown, FALSE otherwise.
+ */
+static BOOL LoadHexFile(HexFile* file, const char* filePath) {
+    if (!g_hHexView) {
+        HexFileClose(file);
+        return FALSE;
     }
+    ShowTableView(FALSE);
+    CloseJsonOutline();
+    SetHexViewFile(g_hHexView, file);
+    ShowHexView(TRUE);
 
-    return result;
+    strcpy_s(g_editorState.currentFilePath, MAX_PATH, filePath);
+    g_editorState.currentFileSize = HexFileSize(file);
+    g_editorState.hasDocumentKey = FALSE;
+    FrameRequest(FRAME_WORK_STATUS);
+    return TRUE;
+}
+
+/**
+ * @brief Loads a file into the editor without showing any dialog.
+ *
+ * The file stays memory-mapped and becomes the original buffer of the
+ * document, so no copy of the content is made. The line index comes from
+ * the session cache when the file is unchanged. Files whose first bytes
+ * look binary, and files too large for the document, open in the hex view.
+ *
+ * @param hEdit Handle to the edit control where the file will be loaded.
+ * @param filePath Path to the file to load.
+ * @return TRUE if the file was loaded, FALSE otherwise.
+ */
+BOOL EditorLoadFile(HWND hEdit, const char* filePath) {
+    if (!hEdit || !filePath) {
+        return FALSE;
+    }
+
+    // Opening the hex file maps nothing but the window holding the first bytes
+    HexFile* hexFile = HexFileOpen(filePath);
+    if (hexFile && (HexFileSize(hexFile) >= (uint64_t)LONG_MAX || HexFileIsBinary(hexFile))) {
+        return LoadHexFile(hexFile, filePath);
+    }
+    HexFileClose(hexFile);
+
+    MappedFile mappedFile;
+    if (!MapFileOpen(filePath, &mappedFile)) {
+        return FALSE;
+    }
+    if (mappedFile.size >= (uint64_t)LONG_MAX) {
+        MapFileClose(&mappedFile);
+        return FALSE;
+    }
+    long fileSize = (long)mappedFile.size;
+
+    // Only a changed (or never seen) file pays for a full scan
+    DocumentKey documentKey;
+    SessionComputeDocumentKey(mappedFile.data, mappedFile.size, &mappedFile.identity, &documentKey);
+    LineIndex lineIndex;
+    ZeroMemory(&lineIndex, sizeof(lineIndex));
+    Fold* folds = NULL;
+    size_t foldCount = 0;
+    char sessionDir[MAX_PATH];
+    BOOL cached = GetSessionDirectory(sessionDir, sizeof(sessionDir)) &&
+                  SessionLoadIndexes(sessionDir, filePath, &documentKey, &lineIndex, &folds, &foldCount);
+
+    // The document takes ownership of the mapping and the index
+    Document* document = DocumentCreateFromMapping(&mappedFile, cached ? &lineIndex : NULL);
+    ShowTableView(FALSE);
+    CloseJsonOutline();
+    if (!document || !SetEditorDocument(hEdit, document)) {
+        MemoryFree(folds);
+        return FALSE;
+    }
+    SetEditorFolds(hEdit, folds, foldCount);
+    MemoryFree(folds);
+    ShowHexView(FALSE);
+    SetHexViewFile(g_hHexView, NULL);
+
+    // Update editor state and status bar
+    strcpy_s(g_editorState.currentFilePath, MAX_PATH, filePath);
+    g_editorState.currentFileSize = (uint64_t)fileSize;
+    g_editorState.documentKey = documentKey;
+    g_editorState.hasDocumentKey = TRUE;
+    FrameRequest(FRAME_WORK_STATUS);
+
+    // Delimited files open as a table; View > Table View switches back to the text
+    const char* extension = PathFindExtension(filePath);
+    if (_stricmp(extension, ".csv") == 0 || _stricmp(extension, ".tsv") == 0) {
+        ShowTableView(TRUE);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Saves the file shown in the hex view.
+ *
+ * Saving to the file itself writes only the overwritten bytes in place.
+ * Saving to another file streams a copy with the changes applied, which
+ * then becomes the file shown.
+ *
+ * @param hWnd Handle to the parent window for messages.
+ * @param filePath Path chosen in the Save As dialog.
+ * @return TRUE if the file was saved, FALSE otherwise.
+ */
+static BOOL SaveHexFile(HWND hWnd, const char* filePath) {
+    HexFile* file = GetHexViewFile(g_hHexView);
+    if (!file) {
+        return FALSE;
+    }
+
+    if (lstrcmpi(filePath, g_editorState.currentFilePath) == 0) {
+        if (!HexFileSave(file)) {
+            MessageBox(hWnd, "Failed to write file. It may have changed on disk since it was opened.", "Error",
+                       MB_OK | MB_ICONERROR);
+            return FALSE;
+        }
+        InvalidateRect(g_hHexView, NULL, FALSE);
+        return TRUE;
+    }
+
+    HexFile* copy = WriteHexFileToFile(filePath, file) ? HexFileOpen(filePath) : NULL;
+    if (!copy) {
+        MessageBox(hWnd, "Failed to write file.", "Error", MB_OK | MB_ICONERROR);
+        return FALSE;
+    }
+    SetHexViewFile(g_hHexView, copy);
+    strcpy_s(g_editorState.currentFilePath, MAX_PATH, filePath);
+    g_editorState.currentFileSize = HexFileSize(copy);
+    FrameRequest(FRAME_WORK_STATUS);
+    return TRUE;
+}
+
+/**
+ * @brief Writes the snapshot of a save job to its file. Runs on the worker thread.
+ *
+ * @param context The save job.
+ */
+static void SaveWorker(void* context) {
+    SaveJob* job = (SaveJob*)context;
+    job->succeeded = WriteSnapshotToFile(job->filePath, job->snapshot, job->formatting ? &job->formatter : NULL,
+                                         job->hWnd);
+    PostMessage(job->hWnd, WM_EDITOR_SAVE_DONE, 0, 0);
+}
+
+/**
+ * @brief Starts writing the current content of the editor to a file in the background.
+ *
+ * The content is captured by a snapshot, so editing can go on while the
+ * file is written. A save requested while another is running starts when
+ * that one finishes.
+ *
+ * @param hWnd Handle to the window notified of progress and completion.
+ * @param hEdit Handle to the edit control holding the document.
+ * @param filePath Path to the file to write.
+ * @return TRUE if the save was started or queued, FALSE otherwise.
+ */
+static BOOL StartDocumentSave(HWND hWnd, HWND hEdit, const char* filePath) {
+    Document* document = GetEditorDocument(hEdit);
+    if (!document) {
+        return FALSE;
+    }
+    if (g_saveJob) {
+        strcpy_s(g_pendingSavePath, MAX_PATH, filePath);
+        g_savePending = TRUE;
+        return TRUE;
+    }
+
+    SaveJob* job = (SaveJob*)calloc(1, sizeof(SaveJob));
+    DocumentSnapshot* snapshot = job ? DocumentSnapshotCreate(document) : NULL;
+    if (!snapshot) {
+        free(job);
+        MessageBox(hWnd, "Not enough memory to save the file.", "Error", MB_OK | MB_ICONERROR);
+        return FALSE;
+    }
+    job->hWnd = hWnd;
+    job->document = document;
+    job->snapshot = snapshot;
+    strcpy_s(job->filePath, MAX_PATH, filePath);
+    if (g_editorState.formatOnSave) {
+        TextFormatOptions options = { g_editorState.formatOnSave, LAYOUT_TAB_WIDTH, TEXT_FORMAT_SAVE_MAX_EDITS };
+        TextFormatterInit(&job->formatter, &options, NULL, NULL, true);
+        job->formatting = TRUE;
+    }
+
+    g_saveJob = job;
+    SendMessage(hWnd, WM_EDITOR_SAVE_PROGRESS, 0, 0);
+    job->thread = ThreadStart(SaveWorker, job);
+    if (!job->thread) {
+        SaveWorker(job);
+    }
+    return TRUE;
 }
 
 /**
@@ -82,9 +299,9 @@ BOOL EditorOpenFile(HWND hWnd, HWND hEdit) {
  *
  * @param hWnd Handle to the parent window for the dialog.
  * @param hEdit Handle to the edit control containing the text to save.
- * @return TRUE if a file was successfully saved, FALSE otherwise.
+ * @return TRUE if the file was saved or its save started, FALSE otherwise.
  */
-BOOL EditorSaveFile(HWND hWnd, HWND hEdit) {
+BOOL EditorSaveFileAs(HWND hWnd, HWND hEdit) {
     if (!hWnd || !hEdit) {
         return FALSE;
     }
@@ -118,28 +335,178 @@ BOOL EditorSaveFile(HWND hWnd, HWND hEdit) {
         return FALSE;
     }
     
-    // Get the text from the edit control
-    char* editorText = GetEditorText(hEdit);
-    if (!editorText) {
-        MessageBox(hWnd, "Failed to get text from editor.", "Error", MB_OK | MB_ICONERROR);
+    if (g_editorState.hexMode) {
+        return SaveHexFile(hWnd, ofn.lpstrFile);
+    }
+    return StartDocumentSave(hWnd, hEdit, ofn.lpstrFile);
+}
+
+/**
+ * @brief Saves the editor content to the file it was loaded from or last saved to.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hEdit Handle to the edit control containing the text to save.
+ * @return TRUE if the file was saved or its save started, FALSE otherwise.
+ */
+BOOL EditorSaveFile(HWND hWnd, HWND hEdit) {
+    if (!hWnd || !hEdit) {
         return FALSE;
     }
-    
-    // Write the text to the file
-    BOOL result = WriteBufferToFile(ofn.lpstrFile, editorText, strlen(editorText));
-    
-    long savedSize = strlen(editorText); // Get the size before freeing
-    free(editorText);
+    if (strcmp(g_editorState.currentFilePath, "Untitled") == 0) {
+        return EditorSaveFileAs(hWnd, hEdit);
+    }
+    if (g_editorState.hexMode) {
+        return SaveHexFile(hWnd, g_editorState.currentFilePath);
+    }
+    return StartDocumentSave(hWnd, hEdit, g_editorState.currentFilePath);
+}
+
+/**
+ * @brief Completes the background save after its worker has finished.
+ *
+ * @param hWnd Handle to the main window.
+ * @param hEdit Handle to the edit control holding the document.
+ */
+void EditorFinishSave(HWND hWnd, HWND hEdit) {
+    SaveJob* job = g_saveJob;
+    if (!job) {
+        return;
+    }
+    g_saveJob = NULL;
+    ThreadJoin(job->thread);
+
+    // The snapshot keeps the document's storage, so its address cannot be reused yet
+    Document* document = GetEditorDocument(hEdit);
+    BOOL sameDocument = document && document == job->document;
+    if (!job->succeeded) {
+        char message[MAX_PATH + 64];
+        _snprintf_s(message, sizeof(message), _TRUNCATE, "Failed to write %s.", job->filePath);
+        MessageBox(hWnd, message, "Error", MB_OK | MB_ICONERROR);
+    } else if (sameDocument) {
+        strcpy_s(g_editorState.currentFilePath, MAX_PATH, job->filePath);
+        g_editorState.currentFileSize =
+            job->formatting ? job->formatter.outputLength : DocumentSnapshotLength(job->snapshot);
+        const DocumentEdit* edits = NULL;
+        size_t editCount = 0;
+        BOOL complete = !job->formatting || TextFormatterGetEdits(&job->formatter, &edits, &editCount);
+
+        // Formatting changes are applied to the document as one undoable step, so it equals the file;
+        // if it was edited meanwhile, or the changes were too many to record, it stays modified
+        if (editCount == 0 && complete) {
+            DocumentMarkSnapshotSaved(document, job->snapshot);
+        } else if (complete && DocumentSnapshotIsCurrent(job->snapshot) &&
+                   ApplyEditorEdits(hEdit, edits, editCount)) {
+            DocumentMarkSaved(document);
+        }
+
+        // The cached indexes describe the loaded content, not the saved one
+        g_editorState.hasDocumentKey = FALSE;
+    }
+    FrameRequest(FRAME_WORK_STATUS);
+    TextFormatterFree(&job->formatter);
+    DocumentSnapshotRelease(job->snapshot);
+    free(job);
+
+    // A save requested meanwhile writes the content as it is now
+    if (g_savePending) {
+        g_savePending = FALSE;
+        if (sameDocument) {
+            StartDocumentSave(hWnd, hEdit, g_pendingSavePath);
+        }
+    }
+}
+
+/**
+ * @brief Waits for the background save, and any save queued behind it, to finish.
+ *
+ * @param hWnd Handle to the main window.
+ * @param hEdit Handle to the edit control holding the document.
+ */
+void EditorWaitForSave(HWND hWnd, HWND hEdit) {
+    while (g_saveJob) {
+        EditorFinishSave(hWnd, hEdit);
+    }
+}
 
+/**
+ * @brief Shows the changes between the editor content and the file on disk.
+ *
+ * While the file is unchanged since it was loaded, the document's own
+ * original buffer is the saved version, so the runs that still reference
+ * it are skipped without being read.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hEdit Handle to the edit control holding the document.
+ * @return TRUE if a comparison was shown, FALSE otherwise.
+ */
+BOOL EditorCompareWithSaved(HWND hWnd, HWND hEdit) {
+    if (!hWnd || !hEdit) {
+        return FALSE;
+    }
+    if (g_editorState.hexMode) {
+        MessageBox(hWnd, "Binary files cannot be compared.", "Compare", MB_OK | MB_ICONINFORMATION);
+        return FALSE;
+    }
+    Document* document = GetEditorDocument(hEdit);
+    if (!document) {
+        return FALSE;
+    }
+    const char* filePath = g_editorState.currentFilePath;
+    if (strcmp(filePath, "Untitled") == 0) {
+        MessageBox(hWnd, "The document has not been saved yet.", "Compare", MB_OK | MB_ICONINFORMATION);
+        return FALSE;
+    }
+
+    FileIdentity identity;
+    BOOL sharesOriginal = g_editorState.hasDocumentKey &&
+                          GetFileIdentity(filePath, &identity) &&
+                          identity.size == g_editorState.documentKey.identity.size &&
+                          identity.mtime == g_editorState.documentKey.identity.mtime;
+
+    MappedFile mappedFile;
+    const char* savedText;
+    uint64_t savedLength;
+    const LineIndex* savedLines;
+    if (sharesOriginal) {
+        savedText = DocumentOriginalText(document, &savedLength);
+        savedLines = DocumentOriginalLineIndex(document);
+    } else {
+        if (!MapFileOpen(filePath, &mappedFile)) {
+            MessageBox(hWnd, "Failed to read file.", "Error", MB_OK | MB_ICONERROR);
+            return FALSE;
+        }
+        savedText = mappedFile.data;
+        savedLength = mappedFile.size;
+        savedLines = NULL;
+    }
+
+    DiffResult diff;
+    BOOL result = DiffDocumentAgainstText(document, savedText, savedLength, savedLines,
+                                          sharesOriginal ? true : false, &diff);
     if (!result) {
-        MessageBox(hWnd, "Failed to write file.", "Error", MB_OK | MB_ICONERROR);
+        MessageBox(hWnd, "Not enough memory to compare the file.", "Error", MB_OK | MB_ICONERROR);
+    } else if (diff.count == 0) {
+        MessageBox(hWnd, "No differences.", "Compare", MB_OK | MB_ICONINFORMATION);
+        result = FALSE;
     } else {
-        // Update editor state and status bar on successful save
-        strcpy_s(g_editorState.currentFilePath, MAX_PATH, ofn.lpstrFile);
-        g_editorState.currentFileSize = savedSize;
-        UpdateStatusBar(g_hStatusBar, &g_editorState);
+        size_t textLength = 0;
+        char* text = DiffFormatUnified(document, savedText, savedLength, savedLines, &diff, filePath,
+                                       "(editor)", &textLength);
+        Document* diffDocument = text ? DocumentCreateFromText(text, textLength) : NULL;
+        free(text);
+
+        char title[MAX_PATH + 32];
+        _snprintf_s(title, sizeof(title), _TRUNCATE, "Changes - %s", filePath);
+        result = diffDocument && ShowDiffWindow(hWnd, g_hInstance, title, diffDocument) != NULL;
+        if (!result) {
+            MessageBox(hWnd, "Failed to show the differences.", "Error", MB_OK | MB_ICONERROR);
+        }
     }
 
+    DiffResultFree(&diff);
+    if (!sharesOriginal) {
+        MapFileClose(&mappedFile);
+    }
     return result;
 }
 
@@ -154,12 +521,18 @@ BOOL EditorNewFile(HWND hEdit) {
         return FALSE;
     }
 
+    ShowTableView(FALSE);
+    CloseJsonOutline();
     BOOL result = SetEditorText(hEdit, "");
     if (result) {
+        ShowHexView(FALSE);
+        SetHexViewFile(g_hHexView, NULL);
+
         // Update editor state and status bar for new file
         strcpy_s(g_editorState.currentFilePath, MAX_PATH, "Untitled");
         g_editorState.currentFileSize = 0;
-        UpdateStatusBar(g_hStatusBar, &g_editorState);
+        g_editorState.hasDocumentKey = FALSE;
+        FrameRequest(FRAME_WORK_STATUS);
     }
     return result;
 }
@@ -214,6 +587,40 @@ char* ReadFileToBuffer(const char* filePath, long* fileSize) {
     return buffer;
 }
 
+/**
+ * @brief Creates the sibling temporary file that replaces a file once written.
+ *
+ * The open document may map the target, so it is never written directly.
+ *
+ * @param filePath Path to the file to replace.
+ * @param[out] tempPath Receives the path of the temporary file; MAX_PATH bytes.
+ * @return A write-behind writer for the temporary file, or NULL on failure.
+ */
+static FileWriter* CreateReplacementFile(const char* filePath, char* tempPath) {
+    if (_snprintf_s(tempPath, MAX_PATH, _TRUNCATE, "%s.pte~", filePath) < 0) {
+        return NULL;
+    }
+    return FileWriterOpen(tempPath);
+}
+
+/**
+ * @brief Finishes the temporary file and swaps it in for the target, or discards it.
+ *
+ * @param file The writer from CreateReplacementFile.
+ * @param tempPath Path of the temporary file.
+ * @param filePath Path to the file to replace.
+ * @param written TRUE if every byte was written to the temporary file.
+ * @return TRUE if the target was replaced, FALSE otherwise.
+ */
+static BOOL CommitReplacementFile(FileWriter* file, const char* tempPath, const char* filePath, BOOL written) {
+    written = FileWriterClose(file) && written;
+    if (!written || !MoveFileEx(tempPath, filePath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFile(tempPath);
+        return FALSE;
+    }
+    return TRUE;
+}
+
 /**
  * @brief Writes a buffer to a file.
  *
@@ -226,15 +633,197 @@ BOOL WriteBufferToFile(const char* filePath, const char* buffer, long bufferSize
     if (!filePath || !buffer) {
         return FALSE;
     }
-    
-    FILE* file = fopen(filePath, "wb");
+
+    char tempPath[MAX_PATH];
+    FileWriter* file = CreateReplacementFile(filePath, tempPath);
     if (!file) {
         return FALSE;
     }
     
     // Write the buffer to the file
-    size_t bytesWritten = fwrite(buffer, 1, bufferSize, file);
-    fclose(file);
-    
-    return ((long)bytesWritten == bufferSize);
+    BOOL written = bufferSize >= 0 && FileWriterWrite(file, buffer, (size_t)bufferSize);
+    return CommitReplacementFile(file, tempPath, filePath, written);
+}
+
+/**
+ * @brief Passes formatted text to the file writer.
+ *
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @param context The file writer.
+ * @return true if the bytes were written, false otherwise.
+ */
+static bool WriteFormattedText(const char* data, size_t length, void* context) {
+    return FileWriterWrite((FileWriter*)context, data, length);
+}
+
+/**
+ * @brief Writes the content of a document snapshot to a file.
+ *
+ * The pieces are written as they are stored, without building the text in
+ * memory, so the file receives every byte including NULs. The writer's
+ * thread writes each buffer while the next pieces are copied. A formatter,
+ * if given, rewrites the pieces in the same pass: unchanged runs still go
+ * to the writer straight from the pieces. Safe to call on any thread.
+ *
+ * @param filePath Path to the file to write.
+ * @param snapshot The snapshot.
+ * @param formatter Formatter started without a sink, or NULL to write the text unchanged; the file becomes its sink.
+ * @param hNotify Window receiving WM_EDITOR_SAVE_PROGRESS, or NULL.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL WriteSnapshotToFile(const char* filePath, const DocumentSnapshot* snapshot, TextFormatter* formatter,
+                         HWND hNotify) {
+    if (!filePath || !snapshot) {
+        return FALSE;
+    }
+
+    char tempPath[MAX_PATH];
+    FileWriter* file = CreateReplacementFile(filePath, tempPath);
+    if (!file) {
+        return FALSE;
+    }
+
+    DocumentIterator iterator;
+    DocumentSnapshotIterInit(snapshot, 0, &iterator);
+    uint64_t total = DocumentSnapshotLength(snapshot);
+    uint64_t done = 0;
+    int reported = 0;
+    const char* data;
+    size_t length;
+    BOOL written = TRUE;
+    if (formatter) {
+        formatter->sink = WriteFormattedText;
+        formatter->context = file;
+    }
+    while (written && DocumentIterNext(&iterator, &data, &length)) {
+        written = formatter ? TextFormatterWrite(formatter, data, length) : FileWriterWrite(file, data, length);
+        done += length;
+
+        // One message per percent, whatever the piece count
+        int percent = (int)(done * 100 / total);
+        if (hNotify && percent > reported) {
+            reported = percent;
+            PostMessage(hNotify, WM_EDITOR_SAVE_PROGRESS, (WPARAM)percent, 0);
+        }
+    }
+    if (written && formatter) {
+        written = TextFormatterFinish(formatter);
+    }
+    return CommitReplacementFile(file, tempPath, filePath, written);
+}
+
+/**
+ * @brief Writes the content of a hex view file, with its overwritten bytes, to another file.
+ *
+ * @param filePath Path to the file to write.
+ * @param hexFile The file.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL WriteHexFileToFile(const char* filePath, HexFile* hexFile) {
+    if (!filePath || !hexFile) {
+        return FALSE;
+    }
+
+    char tempPath[MAX_PATH];
+    FileWriter* file = CreateReplacementFile(filePath, tempPath);
+    if (!file) {
+        return FALSE;
+    }
+
+    // Copied one mapped window at a time, so any size fits in memory
+    uint8_t* buffer = (uint8_t*)malloc(EDITOR_COPY_CHUNK);
+    uint64_t size = HexFileSize(hexFile);
+    uint64_t offset = 0;
+    BOOL written = buffer != NULL;
+    while (written && offset < size) {
+        size_t length = HexFileRead(hexFile, offset, buffer, NULL, EDITOR_COPY_CHUNK);
+        written = length > 0 && FileWriterWrite(file, buffer, length);
+        offset += length;
+    }
+    free(buffer);
+    return CommitReplacementFile(file, tempPath, filePath, written);
+}
+
+/**
+ * @brief Gets the folder holding the session manifest and index sidecars.
+ *
+ * @param[out] buffer Receives the folder path.
+ * @param bufferSize Size of the buffer in bytes.
+ * @return TRUE if the folder is available, FALSE otherwise.
+ */
+BOOL GetSessionDirectory(char* buffer, DWORD bufferSize) {
+    if (!buffer || bufferSize == 0) {
+        return FALSE;
+    }
+
+    char appData[MAX_PATH];
+    DWORD length = GetEnvironmentVariable("LOCALAPPDATA", appData, sizeof(appData));
+    if (length == 0 || length >= sizeof(appData)) {
+        return FALSE;
+    }
+
+    int written = _snprintf_s(buffer, bufferSize, _TRUNCATE, "%s\\%s", appData, EDITOR_SESSION_FOLDER);
+    if (written < 0) {
+        return FALSE;
+    }
+
+    // Succeeds if the folder was created or already exists
+    return CreateDirectory(buffer, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+/**
+ * @brief Opens the spelling dictionary installed next to the executable.
+ *
+ * A compiled dictionary is used as is. Otherwise the word list is compiled
+ * into the session folder, once per change of the list.
+ *
+ * @return The dictionary, or NULL if none is installed. Close it with SpellDictClose.
+ */
+SpellDict* EditorLoadSpellDictionary(void) {
+    char programDir[MAX_PATH];
+    DWORD length = GetModuleFileName(NULL, programDir, sizeof(programDir));
+    if (length == 0 || length >= sizeof(programDir)) {
+        return NULL;
+    }
+    char* separator = strrchr(programDir, '\\');
+    if (separator) {
+        *separator = '\0';
+    }
+
+    char path[MAX_PATH];
+    if (_snprintf_s(path, sizeof(path), _TRUNCATE, "%s\\%s", programDir, EDITOR_DICTIONARY_FILE) >= 0) {
+        SpellDict* dictionary = SpellDictOpen(path);
+        if (dictionary) {
+            return dictionary;
+        }
+    }
+
+    char sessionDir[MAX_PATH];
+    char compiledPath[MAX_PATH];
+    FileIdentity listIdentity;
+    FileIdentity compiledIdentity;
+    if (_snprintf_s(path, sizeof(path), _TRUNCATE, "%s\\%s", programDir, EDITOR_WORD_LIST_FILE) < 0 ||
+        !GetFileIdentity(path, &listIdentity) || !GetSessionDirectory(sessionDir, sizeof(sessionDir)) ||
+        _snprintf_s(compiledPath, sizeof(compiledPath), _TRUNCATE, "%s\\%s", sessionDir,
+                    EDITOR_DICTIONARY_FILE) < 0) {
+        return NULL;
+    }
+
+    // Reuse the copy compiled from this version of the list
+    if (GetFileIdentity(compiledPath, &compiledIdentity) && compiledIdentity.mtime >= listIdentity.mtime) {
+        SpellDict* dictionary = SpellDictOpen(compiledPath);
+        if (dictionary) {
+            return dictionary;
+        }
+    }
+
+    long listSize = 0;
+    char* words = ReadFileToBuffer(path, &listSize);
+    if (!words) {
+        return NULL;
+    }
+    BOOL compiled = SpellDictCompile(words, (size_t)listSize, compiledPath);
+    free(words);
+    return compiled ? SpellDictOpen(compiledPath) : NULL;
 }
@@ -0,0 +1,308 @@
+/**
+ * @file filewriter.c
+ * @brief Write-behind file output implementation for the Professional Text Editor
+ *
+ * Contains the buffer ring, the writing thread and the Win32 and POSIX
+ * file calls.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // For open flags
+#endif
+
+#include "../include/filewriter.h"
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct FileWriter {
+#ifdef _WIN32
+    HANDLE file;
+#else
+    int file;
+#endif
+    void* allocation;                               // Block holding the buffers, before alignment
+    char* buffers[FILE_WRITER_BUFFER_COUNT];
+    size_t lengths[FILE_WRITER_BUFFER_COUNT];       // Bytes of each queued buffer
+    size_t current;                                 // Buffer being filled by the caller
+    size_t filled;                                  // Bytes in the current buffer
+    size_t next;                                    // Oldest queued buffer
+    size_t queued;                                  // Buffers waiting to be written
+    bool closing;                                   // No more buffers will be queued
+    bool failed;                                    // A write failed; later buffers are dropped
+    ThreadLock* lock;
+    ThreadCondition* changed;                       // Signalled when a buffer is queued or written
+    Thread* thread;                                 // NULL when writing synchronously
+};
+
+#ifdef _WIN32
+
+/**
+ * @brief Creates or truncates a file for writing.
+ *
+ * @param writer The writer receiving the handle.
+ * @param filePath Path to the file.
+ * @return true if successful, false otherwise.
+ */
+static bool OpenOutput(FileWriter* writer, const char* filePath) {
+    writer->file = CreateFile(filePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return writer->file != INVALID_HANDLE_VALUE;
+}
+
+/**
+ * @brief Writes bytes to the file, retrying partial writes.
+ *
+ * @param writer The writer.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if every byte was written, false otherwise.
+ */
+static bool WriteOutput(FileWriter* writer, const char* data, size_t length) {
+    while (length > 0) {
+        DWORD written;
+        DWORD request = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+        if (!WriteFile(writer->file, data, request, &written, NULL) || written == 0) {
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief Closes the file.
+ *
+ * @param writer The writer.
+ * @return true if successful, false otherwise.
+ */
+static bool CloseOutput(FileWriter* writer) {
+    return CloseHandle(writer->file) != 0;
+}
+
+#else /* POSIX */
+
+/**
+ * @brief Creates or truncates a file for writing.
+ *
+ * @param writer The writer receiving the descriptor.
+ * @param filePath Path to the file.
+ * @return true if successful, false otherwise.
+ */
+static bool OpenOutput(FileWriter* writer, const char* filePath) {
+    writer->file = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    return writer->file >= 0;
+}
+
+/**
+ * @brief Writes bytes to the file, retrying partial and interrupted writes.
+ *
+ * @param writer The writer.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if every byte was written, false otherwise.
+ */
+static bool WriteOutput(FileWriter* writer, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(writer->file, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * @brief Closes the file.
+ *
+ * @param writer The writer.
+ * @return true if successful, false otherwise.
+ */
+static bool CloseOutput(FileWriter* writer) {
+    return close(writer->file) == 0;
+}
+
+#endif /* _WIN32 */
+
+/**
+ * @brief Writes queued buffers in order until the writer closes.
+ *
+ * @param context The writer.
+ */
+static void WriterThread(void* context) {
+    FileWriter* writer = (FileWriter*)context;
+    ThreadLockEnter(writer->lock);
+    for (;;) {
+        while (writer->queued == 0 && !writer->closing) {
+            ThreadConditionWait(writer->changed, writer->lock);
+        }
+        if (writer->queued == 0) {
+            break;
+        }
+
+        size_t index = writer->next;
+        bool skip = writer->failed;
+        ThreadLockLeave(writer->lock);
+        bool written = skip || WriteOutput(writer, writer->buffers[index], writer->lengths[index]);
+        ThreadLockEnter(writer->lock);
+
+        writer->failed = writer->failed || !written;
+        writer->next = (writer->next + 1) % FILE_WRITER_BUFFER_COUNT;
+        writer->queued--;
+        ThreadConditionWakeAll(writer->changed);
+    }
+    ThreadLockLeave(writer->lock);
+}
+
+/**
+ * @brief Queues the current buffer and moves on to the next free one.
+ *
+ * @param writer The writer.
+ * @return true if successful, false once any write has failed.
+ */
+static bool QueueBuffer(FileWriter* writer) {
+    size_t index = writer->current;
+    size_t length = writer->filled;
+    writer->filled = 0;
+
+    if (!writer->thread) {
+        writer->failed = writer->failed || !WriteOutput(writer, writer->buffers[index], length);
+        return !writer->failed;
+    }
+
+    ThreadLockEnter(writer->lock);
+    writer->lengths[index] = length;
+    writer->queued++;
+    ThreadConditionWakeAll(writer->changed);
+
+    // The next buffer is free once fewer than all of them are queued
+    while (writer->queued == FILE_WRITER_BUFFER_COUNT) {
+        ThreadConditionWait(writer->changed, writer->lock);
+    }
+    writer->current = (index + 1) % FILE_WRITER_BUFFER_COUNT;
+    bool failed = writer->failed;
+    ThreadLockLeave(writer->lock);
+    return !failed;
+}
+
+/**
+ * @brief Releases the memory and synchronisation objects of a writer.
+ *
+ * @param writer The writer.
+ */
+static void FreeWriter(FileWriter* writer) {
+    ThreadConditionDestroy(writer->changed);
+    ThreadLockDestroy(writer->lock);
+    MemoryFree(writer->allocation);
+    MemoryFree(writer);
+}
+
+/**
+ * @brief Creates or truncates a file and starts writing it.
+ *
+ * @param filePath Path to the file.
+ * @return The writer, or NULL on failure.
+ */
+FileWriter* FileWriterOpen(const char* filePath) {
+    if (!filePath) {
+        return NULL;
+    }
+
+    FileWriter* writer = (FileWriter*)MemoryCalloc(MEMORY_TAG_WRITER, 1, sizeof(FileWriter));
+    if (!writer) {
+        return NULL;
+    }
+    size_t bufferBytes = (size_t)FILE_WRITER_BUFFER_SIZE * FILE_WRITER_BUFFER_COUNT;
+    writer->allocation = MemoryAlloc(MEMORY_TAG_WRITER, bufferBytes + FILE_WRITER_ALIGNMENT);
+    writer->lock = ThreadLockCreate();
+    writer->changed = ThreadConditionCreate();
+    if (!writer->allocation || !writer->lock || !writer->changed) {
+        FreeWriter(writer);
+        return NULL;
+    }
+
+    uintptr_t base = ((uintptr_t)writer->allocation + FILE_WRITER_ALIGNMENT - 1) &
+                     ~(uintptr_t)(FILE_WRITER_ALIGNMENT - 1);
+    for (size_t i = 0; i < FILE_WRITER_BUFFER_COUNT; i++) {
+        writer->buffers[i] = (char*)base + i * FILE_WRITER_BUFFER_SIZE;
+    }
+
+    if (!OpenOutput(writer, filePath)) {
+        FreeWriter(writer);
+        return NULL;
+    }
+    writer->thread = ThreadStart(WriterThread, writer);
+    return writer;
+}
+
+/**
+ * @brief Appends bytes to the file.
+ *
+ * @param writer The writer.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if successful, false once any write has failed.
+ */
+bool FileWriterWrite(FileWriter* writer, const void* data, size_t length) {
+    if (!writer || (!data && length > 0)) {
+        return false;
+    }
+
+    const char* bytes = (const char*)data;
+    while (length > 0) {
+        size_t space = FILE_WRITER_BUFFER_SIZE - writer->filled;
+        size_t part = length < space ? length : space;
+        memcpy(writer->buffers[writer->current] + writer->filled, bytes, part);
+        writer->filled += part;
+        bytes += part;
+        length -= part;
+        if (writer->filled == FILE_WRITER_BUFFER_SIZE && !QueueBuffer(writer)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the remaining bytes, closes the file and releases the writer.
+ *
+ * @param writer The writer. NULL is ignored.
+ * @return true if every byte was written and the file closed, false otherwise.
+ */
+bool FileWriterClose(FileWriter* writer) {
+    if (!writer) {
+        return false;
+    }
+
+    if (writer->filled > 0) {
+        QueueBuffer(writer);
+    }
+    if (writer->thread) {
+        ThreadLockEnter(writer->lock);
+        writer->closing = true;
+        ThreadConditionWakeAll(writer->changed);
+        ThreadLockLeave(writer->lock);
+        ThreadJoin(writer->thread);
+    }
+
+    bool written = !writer->failed;
+    written = CloseOutput(writer) && written;
+    FreeWriter(writer);
+    return written;
+}
@@ -0,0 +1,399 @@
+/**
+ * @file folds.c
+ * @brief Folded line ranges implementation for the Professional Text Editor
+ *
+ * Contains the fold list, its update on document changes and the mapping
+ * between rows and lines.
+ */
+
+#include "../include/folds.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Initializes an empty fold set.
+ *
+ * @param folds The fold set.
+ */
+void FoldSetInit(FoldSet* folds) {
+    memset(folds, 0, sizeof(FoldSet));
+    folds->runsValid = true;
+}
+
+/**
+ * @brief Releases the memory held by a fold set.
+ *
+ * @param folds The fold set.
+ */
+void FoldSetFree(FoldSet* folds) {
+    MemoryFree(folds->items);
+    MemoryFree(folds->runs);
+    FoldSetInit(folds);
+}
+
+/**
+ * @brief Removes every fold.
+ *
+ * @param folds The fold set.
+ */
+void FoldSetClear(FoldSet* folds) {
+    folds->count = 0;
+    folds->runCount = 0;
+    folds->runsValid = true;
+}
+
+/**
+ * @brief Rebuilds the hidden line runs from the folds if they are stale.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ */
+static void EnsureRuns(FoldSet* folds, const Document* document) {
+    if (folds->runsValid) {
+        return;
+    }
+
+    folds->runCount = 0;
+    folds->runsValid = true;
+    if (folds->count > folds->runCapacity) {
+        FoldRun* newRuns = (FoldRun*)MemoryRealloc(MEMORY_TAG_STRUCTURE, folds->runs, folds->count * sizeof(FoldRun));
+        if (!newRuns) {
+            // Without runs nothing can be hidden
+            folds->count = 0;
+            return;
+        }
+        folds->runs = newRuns;
+        folds->runCapacity = folds->count;
+    }
+
+    // Folds are sorted by start, so nested and adjacent ones extend the current run
+    uint64_t hidden = 0;
+    for (size_t i = 0; i < folds->count; i++) {
+        uint64_t firstLine = DocumentLineFromOffset(document, folds->items[i].hideStart);
+        uint64_t lastLine = DocumentLineFromOffset(document, folds->items[i].hideLast);
+        if (firstLine == 0 || lastLine < firstLine) {
+            continue;
+        }
+
+        if (folds->runCount > 0) {
+            FoldRun* run = &folds->runs[folds->runCount - 1];
+            if (firstLine <= run->lastLine + 1) {
+                if (lastLine > run->lastLine) {
+                    hidden += lastLine - run->lastLine;
+                    run->lastLine = lastLine;
+                }
+                continue;
+            }
+        }
+
+        FoldRun* run = &folds->runs[folds->runCount++];
+        run->firstLine = firstLine;
+        run->lastLine = lastLine;
+        run->hiddenBefore = hidden;
+        hidden += lastLine - firstLine + 1;
+    }
+}
+
+/**
+ * @brief Finds the last run starting at or before a line.
+ *
+ * @param folds The fold set; its runs must be current.
+ * @param line The line.
+ * @return Number of runs whose first line is at or before the line.
+ */
+static size_t RunsUpTo(const FoldSet* folds, uint64_t line) {
+    size_t low = 0;
+    size_t high = folds->runCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (folds->runs[mid].firstLine <= line) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Hides a range of lines below a header line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param firstLine First line to hide; the line above it stays visible.
+ * @param lastLine Last line to hide.
+ * @return true if successful, false if the range is invalid or memory ran out.
+ */
+bool FoldSetAdd(FoldSet* folds, const Document* document, uint64_t firstLine, uint64_t lastLine) {
+    if (firstLine == 0 || lastLine < firstLine || lastLine >= DocumentLineCount(document)) {
+        return false;
+    }
+
+    Fold fold;
+    fold.hideStart = DocumentLineStart(document, firstLine);
+    fold.hideLast = DocumentLineStart(document, lastLine);
+
+    size_t position = 0;
+    while (position < folds->count && folds->items[position].hideStart <= fold.hideStart) {
+        if (folds->items[position].hideStart == fold.hideStart && folds->items[position].hideLast == fold.hideLast) {
+            return true;
+        }
+        position++;
+    }
+
+    if (folds->count == folds->capacity) {
+        size_t newCapacity = folds->capacity ? folds->capacity * 2 : 16;
+        Fold* newItems = (Fold*)MemoryRealloc(MEMORY_TAG_STRUCTURE, folds->items, newCapacity * sizeof(Fold));
+        if (!newItems) {
+            return false;
+        }
+        folds->items = newItems;
+        folds->capacity = newCapacity;
+    }
+
+    memmove(&folds->items[position + 1], &folds->items[position], (folds->count - position) * sizeof(Fold));
+    folds->items[position] = fold;
+    folds->count++;
+    folds->runsValid = false;
+    return true;
+}
+
+/**
+ * @brief Removes the folds whose header is a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param headerLine The header line.
+ * @return true if a fold was removed, false otherwise.
+ */
+bool FoldSetRemoveHeader(FoldSet* folds, const Document* document, uint64_t headerLine) {
+    if (headerLine + 1 >= DocumentLineCount(document)) {
+        return false;
+    }
+
+    uint64_t hideStart = DocumentLineStart(document, headerLine + 1);
+    size_t kept = 0;
+    for (size_t i = 0; i < folds->count; i++) {
+        if (folds->items[i].hideStart != hideStart) {
+            folds->items[kept++] = folds->items[i];
+        }
+    }
+
+    bool removed = kept != folds->count;
+    folds->count = kept;
+    folds->runsValid = folds->runsValid && !removed;
+    return removed;
+}
+
+/**
+ * @brief Removes the folds that hide a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line.
+ * @return true if a fold was removed, false otherwise.
+ */
+bool FoldSetRevealLine(FoldSet* folds, const Document* document, uint64_t line) {
+    if (!FoldSetIsHidden(folds, document, line)) {
+        return false;
+    }
+
+    uint64_t lineStart = DocumentLineStart(document, line);
+    size_t kept = 0;
+    for (size_t i = 0; i < folds->count; i++) {
+        if (folds->items[i].hideStart > lineStart || folds->items[i].hideLast < lineStart) {
+            folds->items[kept++] = folds->items[i];
+        }
+    }
+
+    bool removed = kept != folds->count;
+    folds->count = kept;
+    folds->runsValid = false;
+    return removed;
+}
+
+/**
+ * @brief Updates the folds after the document changed.
+ *
+ * Folds touched by a change are removed; the others move with the text.
+ *
+ * @param folds The fold set.
+ * @param changes The changes reported to the document listener, or NULL if unknown.
+ * @param changeCount Number of changes.
+ */
+void FoldSetMapChanges(FoldSet* folds, const DocumentChange* changes, size_t changeCount) {
+    if (folds->count == 0) {
+        return;
+    }
+    if (!changes || changeCount == 0) {
+        FoldSetClear(folds);
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < folds->count; i++) {
+        Fold fold = folds->items[i];
+
+        // Changes starting before the hidden text must end before its line break
+        size_t low = 0;
+        size_t high = changeCount;
+        int64_t shift = 0;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (changes[mid].offset < fold.hideStart) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low > 0 && changes[low - 1].offset + changes[low - 1].removedLength >= fold.hideStart) {
+            continue;
+        }
+        if (low < changeCount && changes[low].offset <= fold.hideLast) {
+            continue;
+        }
+        for (size_t c = 0; c < low; c++) {
+            shift += (int64_t)changes[c].insertedLength - (int64_t)changes[c].removedLength;
+        }
+
+        fold.hideStart = (uint64_t)((int64_t)fold.hideStart + shift);
+        fold.hideLast = (uint64_t)((int64_t)fold.hideLast + shift);
+        folds->items[kept++] = fold;
+    }
+
+    folds->count = kept;
+    folds->runsValid = false;
+}
+
+/**
+ * @brief Gets the number of visible lines.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @return The line count minus the hidden lines.
+ */
+uint64_t FoldSetVisibleLineCount(FoldSet* folds, const Document* document) {
+    EnsureRuns(folds, document);
+    uint64_t lineCount = DocumentLineCount(document);
+    if (folds->runCount == 0) {
+        return lineCount;
+    }
+
+    const FoldRun* last = &folds->runs[folds->runCount - 1];
+    return lineCount - (last->hiddenBefore + last->lastLine - last->firstLine + 1);
+}
+
+/**
+ * @brief Gets the document line shown in a row.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param row Zero-based row.
+ * @return The line.
+ */
+uint64_t FoldSetLineFromRow(FoldSet* folds, const Document* document, uint64_t row) {
+    EnsureRuns(folds, document);
+
+    // Runs are separated by visible lines, so the row of each run's first line increases
+    size_t low = 0;
+    size_t high = folds->runCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (folds->runs[mid].firstLine - folds->runs[mid].hiddenBefore <= row) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low == 0) {
+        return row;
+    }
+    const FoldRun* run = &folds->runs[low - 1];
+    return row + run->hiddenBefore + run->lastLine - run->firstLine + 1;
+}
+
+/**
+ * @brief Gets the row showing a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line; a hidden line maps to the row of its header.
+ * @return The row.
+ */
+uint64_t FoldSetRowFromLine(FoldSet* folds, const Document* document, uint64_t line) {
+    EnsureRuns(folds, document);
+
+    size_t count = RunsUpTo(folds, line);
+    if (count == 0) {
+        return line;
+    }
+    const FoldRun* run = &folds->runs[count - 1];
+    if (line <= run->lastLine) {
+        return run->firstLine - 1 - run->hiddenBefore;
+    }
+    return line - run->hiddenBefore - (run->lastLine - run->firstLine + 1);
+}
+
+/**
+ * @brief Checks whether a line is hidden.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line.
+ * @return true if a fold hides the line, false otherwise.
+ */
+bool FoldSetIsHidden(FoldSet* folds, const Document* document, uint64_t line) {
+    EnsureRuns(folds, document);
+
+    size_t count = RunsUpTo(folds, line);
+    return count > 0 && line <= folds->runs[count - 1].lastLine;
+}
+
+/**
+ * @brief Checks whether a visible line is the header of a fold.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line.
+ * @return true if the lines below it are folded, false otherwise.
+ */
+bool FoldSetIsHeader(FoldSet* folds, const Document* document, uint64_t line) {
+    EnsureRuns(folds, document);
+
+    size_t count = RunsUpTo(folds, line + 1);
+    return count > 0 && folds->runs[count - 1].firstLine == line + 1;
+}
+
+/**
+ * @brief Finds the nearest fold header after or before a line.
+ *
+ * @param folds The fold set.
+ * @param document The document.
+ * @param line The line to start from (not itself a candidate).
+ * @param forward true to search downwards, false to search upwards.
+ * @param[out] header Receives the header line.
+ * @return true if found, false otherwise.
+ */
+bool FoldSetFindHeader(FoldSet* folds, const Document* document, uint64_t line, bool forward,
+                       uint64_t* header) {
+    EnsureRuns(folds, document);
+
+    // Header of run i is firstLine - 1
+    size_t count = RunsUpTo(folds, line + 1);
+    if (forward) {
+        if (count == folds->runCount) {
+            return false;
+        }
+        *header = folds->runs[count].firstLine - 1;
+        return true;
+    }
+
+    count = RunsUpTo(folds, line);
+    if (count == 0) {
+        return false;
+    }
+    *header = folds->runs[count - 1].firstLine - 1;
+    return true;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file frame.c
+ * @brief Frame scheduler implementation for the Professional Text Editor
+ *
+ * Contains the message loop, the marked work and the latency measurement.
+ */
+
+#include "../include/frame.h"
+#include "../include/window.h" // For TranslateEditorAccelerator
+
+// Scheduler state; the user interface runs on one thread
+static HWND g_hFrameWindow = NULL;
+static FrameWorkProc g_frameRun = NULL;
+static unsigned g_pendingWork = 0;
+static BOOL g_timerArmed = FALSE;
+static double g_intervalMs = FRAME_DEFAULT_INTERVAL_MS;
+static double g_lastFrameMs = 0.0;      // When marked work last ran
+static LARGE_INTEGER g_frequency;
+
+// Latency measurement
+static BOOL g_inputPending = FALSE;     // An input message is waiting for its paint
+static double g_inputMs = 0.0;          // When that message was taken from the queue
+static double g_latencyTotalMs = 0.0;
+static FrameStats g_stats;
+
+/**
+ * @brief Reads the high-resolution clock.
+ *
+ * @return The time in milliseconds.
+ */
+static double FrameNow(void) {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)g_frequency.QuadPart;
+}
+
+/**
+ * @brief Runs marked work from a modal loop, which dispatches timers but not our loop.
+ *
+ * @param hWnd Handle to the window owning the timer.
+ * @param message WM_TIMER.
+ * @param id The timer id.
+ * @param time System time of the message.
+ */
+static void CALLBACK FrameTimerProc(HWND hWnd, UINT message, UINT_PTR id, DWORD time) {
+    UNREFERENCED_PARAMETER(hWnd);
+    UNREFERENCED_PARAMETER(message);
+    UNREFERENCED_PARAMETER(id);
+    UNREFERENCED_PARAMETER(time);
+    FrameFlush();
+}
+
+/**
+ * @brief Checks whether a message is input that the user expects to see answered.
+ *
+ * Mouse moves are left out: most of them change nothing on screen.
+ *
+ * @param message The message.
+ * @return TRUE for key presses, characters, button presses and wheel turns.
+ */
+static BOOL IsInputMessage(UINT message) {
+    switch (message) {
+        case WM_KEYDOWN:
+        case WM_SYSKEYDOWN:
+        case WM_CHAR:
+        case WM_LBUTTONDOWN:
+        case WM_RBUTTONDOWN:
+        case WM_MBUTTONDOWN:
+        case WM_MOUSEWHEEL:
+        case WM_MOUSEHWHEEL:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+/**
+ * @brief Records the latency of the input message waiting for a paint.
+ */
+static void RecordLatency(void) {
+    double latency = FrameNow() - g_inputMs;
+    g_inputPending = FALSE;
+    g_stats.samples++;
+    g_stats.lastLatencyMs = latency;
+    g_latencyTotalMs += latency;
+    g_stats.averageLatencyMs = g_latencyTotalMs / (double)g_stats.samples;
+    if (latency > g_stats.maxLatencyMs) {
+        g_stats.maxLatencyMs = latency;
+    }
+}
+
+/**
+ * @brief Starts scheduling frames for a window.
+ *
+ * @param hWnd Handle to the main window, which owns the frame timer.
+ * @param run Function running the marked work.
+ */
+void FrameSchedulerInit(HWND hWnd, FrameWorkProc run) {
+    QueryPerformanceFrequency(&g_frequency);
+    g_hFrameWindow = hWnd;
+    g_frameRun = run;
+
+    // One frame per refresh of the primary display
+    HDC hdc = GetDC(NULL);
+    int refresh = hdc ? GetDeviceCaps(hdc, VREFRESH) : 0;
+    if (hdc) {
+        ReleaseDC(NULL, hdc);
+    }
+    g_intervalMs = refresh > 1 ? 1000.0 / refresh : FRAME_DEFAULT_INTERVAL_MS;
+    g_lastFrameMs = FrameNow() - g_intervalMs;
+}
+
+/**
+ * @brief Stops scheduling frames; marked work is dropped.
+ */
+void FrameSchedulerShutdown(void) {
+    if (g_timerArmed) {
+        KillTimer(g_hFrameWindow, FRAME_TIMER_ID);
+        g_timerArmed = FALSE;
+    }
+    g_pendingWork = 0;
+    g_frameRun = NULL;
+    g_hFrameWindow = NULL;
+}
+
+/**
+ * @brief Marks work for the next frame.
+ *
+ * @param work FRAME_WORK_ flags.
+ */
+void FrameRequest(unsigned work) {
+    if (!g_frameRun) {
+        return;
+    }
+    g_pendingWork |= work;
+
+    // The loop runs the work on time; the timer covers modal loops
+    if (!g_timerArmed) {
+        double wait = g_lastFrameMs + g_intervalMs - FrameNow();
+        UINT delay = wait > USER_TIMER_MINIMUM ? (UINT)wait : USER_TIMER_MINIMUM;
+        g_timerArmed = SetTimer(g_hFrameWindow, FRAME_TIMER_ID, delay, FrameTimerProc) != 0;
+    }
+}
+
+/**
+ * @brief Runs marked work now instead of at the next frame.
+ */
+void FrameFlush(void) {
+    if (g_timerArmed) {
+        KillTimer(g_hFrameWindow, FRAME_TIMER_ID);
+        g_timerArmed = FALSE;
+    }
+    unsigned work = g_pendingWork;
+    g_pendingWork = 0;
+    if (work && g_frameRun) {
+        g_lastFrameMs = FrameNow();
+        g_stats.frames++;
+        g_frameRun(work);
+    }
+}
+
+/**
+ * @brief Gets the latency measured so far.
+ *
+ * @param[out] stats Receives the statistics.
+ */
+void FrameGetStats(FrameStats* stats) {
+    if (stats) {
+        *stats = g_stats;
+    }
+}
+
+/**
+ * @brief Runs the message loop until WM_QUIT.
+ *
+ * @return The exit code carried by WM_QUIT.
+ */
+int FrameRunMessageLoop(void) {
+    MSG msg;
+    for (;;) {
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                FrameSchedulerShutdown();
+                return (int)msg.wParam;
+            }
+            if (!g_inputPending && IsInputMessage(msg.message)) {
+                g_inputPending = TRUE;
+                g_inputMs = FrameNow();
+            }
+
+            if (!TranslateEditorAccelerator(&msg)) {
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+
+            // Paint messages come only once the queue holds nothing else
+            if (msg.message == WM_PAINT && g_inputPending) {
+                RecordLatency();
+            }
+
+            // A flood of messages does not hold back a frame that is due
+            if (g_pendingWork && FrameNow() - g_lastFrameMs >= g_intervalMs) {
+                FrameFlush();
+            }
+        }
+
+        // Nothing queued and nothing to paint: input that invalidated nothing has no paint to wait for
+        g_inputPending = FALSE;
+
+        DWORD timeout = INFINITE;
+        if (g_pendingWork) {
+            double wait = g_lastFrameMs + g_intervalMs - FrameNow();
+            if (wait <= 0.0) {
+                FrameFlush();
+                continue;
+            }
+            timeout = (DWORD)wait + 1;
+        }
+        MsgWaitForMultipleObjectsEx(0, NULL, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    }
+}
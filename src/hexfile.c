@@ -0,0 +1,702 @@
+/**
+ * @file hexfile.c
+ * @brief Paged binary file access implementation for the Professional Text Editor
+ *
+ * Contains the window cache over Win32 or POSIX file mappings, the overlay
+ * of overwritten bytes and the in-place write-back.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // For pwrite and fsync
+#define _FILE_OFFSET_BITS 64    // Windows beyond 2 GB on 32-bit builds
+#endif
+
+#include "../include/hexfile.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Bytes mapped per window; a multiple of the Win32 allocation granularity and of any page size
+#define HEX_FILE_WINDOW_SIZE ((size_t)1 << 20)
+
+// Windows kept mapped at the same time
+#define HEX_FILE_WINDOW_COUNT 8
+
+// Largest single write when saving a run of changed bytes
+#define HEX_FILE_WRITE_CHUNK 65536
+
+// One mapped window of the file
+typedef struct {
+    uint64_t start;         // Offset of the first byte, a multiple of HEX_FILE_WINDOW_SIZE
+    const uint8_t* data;    // Mapped bytes, or NULL if the slot is free
+    size_t length;          // Number of mapped bytes
+    uint64_t lastUse;       // Value of the use clock when the window was last read
+} HexWindow;
+
+// One overwritten byte
+typedef struct {
+    uint64_t offset;
+    uint8_t value;          // Byte shown and saved
+    uint8_t original;       // Byte on disk
+} HexPatch;
+
+// One overwrite that can be reverted
+typedef struct {
+    uint64_t offset;
+    uint8_t previous;       // Byte shown before the overwrite
+    uint8_t original;       // Byte on disk
+} HexUndo;
+
+struct HexFile {
+    char* path;
+    uint64_t size;
+    FileIdentity identity;  // Identity of the file when it was opened or last saved
+    void* fileHandle;       // Platform file handle (POSIX: descriptor + 1)
+    void* mappingHandle;    // Mapping of the whole file (Windows only; NULL for empty files)
+    HexWindow windows[HEX_FILE_WINDOW_COUNT];
+    uint64_t useClock;
+    HexPatch* patches;      // Sorted by offset
+    size_t patchCount;
+    size_t patchCapacity;
+    HexUndo* undo;
+    size_t undoCount;
+    size_t undoCapacity;
+};
+
+#ifdef _WIN32
+
+/**
+ * @brief Opens the file and its mapping object.
+ *
+ * @param file The file, with its path set.
+ * @return true if successful, false otherwise.
+ */
+static bool AcquireFile(HexFile* file) {
+    HANDLE hFile = CreateFile(file->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    if (!GetFileIdentity(file->path, &file->identity)) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // A mapping object reserves no address space; only the views do
+    HANDLE hMapping = NULL;
+    if (file->identity.size > 0) {
+        hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!hMapping) {
+            CloseHandle(hFile);
+            return false;
+        }
+    }
+    file->fileHandle = hFile;
+    file->mappingHandle = hMapping;
+    file->size = file->identity.size;
+    return true;
+}
+
+/**
+ * @brief Closes the mapping object and the file.
+ *
+ * @param file The file; its windows must be unmapped.
+ */
+static void ReleaseFile(HexFile* file) {
+    if (file->mappingHandle) {
+        CloseHandle((HANDLE)file->mappingHandle);
+    }
+    if (file->fileHandle) {
+        CloseHandle((HANDLE)file->fileHandle);
+    }
+    file->mappingHandle = NULL;
+    file->fileHandle = NULL;
+}
+
+/**
+ * @brief Maps a window of the file.
+ *
+ * @param file The file.
+ * @param start Offset of the window.
+ * @param length Number of bytes.
+ * @return The mapped bytes, or NULL on failure.
+ */
+static const uint8_t* MapWindow(HexFile* file, uint64_t start, size_t length) {
+    if (!file->mappingHandle) {
+        return NULL;
+    }
+    return (const uint8_t*)MapViewOfFile((HANDLE)file->mappingHandle, FILE_MAP_READ, (DWORD)(start >> 32),
+                                         (DWORD)start, length);
+}
+
+/**
+ * @brief Unmaps a window of the file.
+ *
+ * @param data The mapped bytes.
+ * @param length Number of bytes.
+ */
+static void UnmapWindow(const uint8_t* data, size_t length) {
+    (void)length;
+    UnmapViewOfFile(data);
+}
+
+/**
+ * @brief Opens a file for writing in place.
+ *
+ * @param path Path to the file.
+ * @return The handle, or NULL on failure.
+ */
+static void* OpenForWriting(const char* path) {
+    HANDLE hFile = CreateFile(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    return hFile == INVALID_HANDLE_VALUE ? NULL : (void*)hFile;
+}
+
+/**
+ * @brief Writes bytes at an offset.
+ *
+ * @param handle Handle from OpenForWriting.
+ * @param offset Offset of the first byte.
+ * @param data The bytes.
+ * @param length Number of bytes, at most HEX_FILE_WRITE_CHUNK.
+ * @return true if every byte was written, false otherwise.
+ */
+static bool WriteAt(void* handle, uint64_t offset, const uint8_t* data, size_t length) {
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG)offset;
+    DWORD written = 0;
+    return SetFilePointerEx((HANDLE)handle, position, NULL, FILE_BEGIN) &&
+           WriteFile((HANDLE)handle, data, (DWORD)length, &written, NULL) && written == (DWORD)length;
+}
+
+/**
+ * @brief Flushes and closes a file opened with OpenForWriting.
+ *
+ * @param handle The handle.
+ * @return true if the data reached the disk, false otherwise.
+ */
+static bool CloseForWriting(void* handle) {
+    bool flushed = FlushFileBuffers((HANDLE)handle) != 0;
+    return CloseHandle((HANDLE)handle) && flushed;
+}
+
+#else /* POSIX */
+
+/**
+ * @brief Opens the file.
+ *
+ * @param file The file, with its path set.
+ * @return true if successful, false otherwise.
+ */
+static bool AcquireFile(HexFile* file) {
+    int fd = open(file->path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if (!GetFileIdentity(file->path, &file->identity)) {
+        close(fd);
+        return false;
+    }
+    file->fileHandle = (void*)(intptr_t)(fd + 1); // +1 so that fd 0 is not NULL
+    file->size = file->identity.size;
+    return true;
+}
+
+/**
+ * @brief Closes the file.
+ *
+ * @param file The file; its windows must be unmapped.
+ */
+static void ReleaseFile(HexFile* file) {
+    if (file->fileHandle) {
+        close((int)(intptr_t)file->fileHandle - 1);
+    }
+    file->fileHandle = NULL;
+}
+
+/**
+ * @brief Maps a window of the file.
+ *
+ * @param file The file.
+ * @param start Offset of the window.
+ * @param length Number of bytes.
+ * @return The mapped bytes, or NULL on failure.
+ */
+static const uint8_t* MapWindow(HexFile* file, uint64_t start, size_t length) {
+    if (!file->fileHandle) {
+        return NULL;
+    }
+    void* view = mmap(NULL, length, PROT_READ, MAP_PRIVATE, (int)(intptr_t)file->fileHandle - 1, (off_t)start);
+    return view == MAP_FAILED ? NULL : (const uint8_t*)view;
+}
+
+/**
+ * @brief Unmaps a window of the file.
+ *
+ * @param data The mapped bytes.
+ * @param length Number of bytes.
+ */
+static void UnmapWindow(const uint8_t* data, size_t length) {
+    munmap((void*)data, length);
+}
+
+/**
+ * @brief Opens a file for writing in place.
+ *
+ * @param path Path to the file.
+ * @return The handle, or NULL on failure.
+ */
+static void* OpenForWriting(const char* path) {
+    int fd = open(path, O_WRONLY);
+    return fd < 0 ? NULL : (void*)(intptr_t)(fd + 1);
+}
+
+/**
+ * @brief Writes bytes at an offset.
+ *
+ * @param handle Handle from OpenForWriting.
+ * @param offset Offset of the first byte.
+ * @param data The bytes.
+ * @param length Number of bytes, at most HEX_FILE_WRITE_CHUNK.
+ * @return true if every byte was written, false otherwise.
+ */
+static bool WriteAt(void* handle, uint64_t offset, const uint8_t* data, size_t length) {
+    int fd = (int)(intptr_t)handle - 1;
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, (off_t)offset);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+    return true;
+}
+
+/**
+ * @brief Flushes and closes a file opened with OpenForWriting.
+ *
+ * @param handle The handle.
+ * @return true if the data reached the disk, false otherwise.
+ */
+static bool CloseForWriting(void* handle) {
+    int fd = (int)(intptr_t)handle - 1;
+    bool flushed = fsync(fd) == 0;
+    return close(fd) == 0 && flushed;
+}
+
+#endif /* _WIN32 */
+
+/**
+ * @brief Unmaps every window of a file.
+ *
+ * @param file The file.
+ */
+static void UnmapWindows(HexFile* file) {
+    for (size_t i = 0; i < HEX_FILE_WINDOW_COUNT; i++) {
+        HexWindow* window = &file->windows[i];
+        if (window->data) {
+            UnmapWindow(window->data, window->length);
+        }
+        memset(window, 0, sizeof(*window));
+    }
+}
+
+/**
+ * @brief Gets the mapped window starting at an offset, mapping it if needed.
+ *
+ * The least recently used window is unmapped when every slot is taken.
+ *
+ * @param file The file.
+ * @param start Offset of the window, a multiple of HEX_FILE_WINDOW_SIZE below the file size.
+ * @return The window, or NULL if it cannot be mapped.
+ */
+static HexWindow* AcquireWindow(HexFile* file, uint64_t start) {
+    HexWindow* victim = &file->windows[0];
+    for (size_t i = 0; i < HEX_FILE_WINDOW_COUNT; i++) {
+        HexWindow* window = &file->windows[i];
+        if (window->data && window->start == start) {
+            window->lastUse = ++file->useClock;
+            return window;
+        }
+        if (!window->data) {
+            victim = window;
+        } else if (victim->data && window->lastUse < victim->lastUse) {
+            victim = window;
+        }
+    }
+
+    if (victim->data) {
+        UnmapWindow(victim->data, victim->length);
+        memset(victim, 0, sizeof(*victim));
+    }
+    uint64_t remaining = file->size - start;
+    size_t length = remaining < HEX_FILE_WINDOW_SIZE ? (size_t)remaining : HEX_FILE_WINDOW_SIZE;
+    const uint8_t* data = MapWindow(file, start, length);
+    if (!data) {
+        return NULL;
+    }
+    victim->start = start;
+    victim->data = data;
+    victim->length = length;
+    victim->lastUse = ++file->useClock;
+    return victim;
+}
+
+/**
+ * @brief Finds the first patch at or after an offset.
+ *
+ * @param file The file.
+ * @param offset The offset.
+ * @return Index of the patch, or patchCount if there is none.
+ */
+static size_t FindPatch(const HexFile* file, uint64_t offset) {
+    size_t low = 0;
+    size_t high = file->patchCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (file->patches[middle].offset < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Sets the byte shown at an offset in the overlay.
+ *
+ * A byte equal to the one on disk is removed from the overlay.
+ *
+ * @param file The file.
+ * @param offset Offset of the byte.
+ * @param value The byte to show.
+ * @param shown The byte shown before, which is the byte on disk when it is not overwritten.
+ * @return true if successful, false on allocation failure.
+ */
+static bool StorePatch(HexFile* file, uint64_t offset, uint8_t value, uint8_t shown) {
+    size_t index = FindPatch(file, offset);
+    if (index < file->patchCount && file->patches[index].offset == offset) {
+        if (value == file->patches[index].original) {
+            memmove(&file->patches[index], &file->patches[index + 1],
+                    (file->patchCount - index - 1) * sizeof(HexPatch));
+            file->patchCount--;
+        } else {
+            file->patches[index].value = value;
+        }
+        return true;
+    }
+    if (value == shown) {
+        return true;
+    }
+
+    if (file->patchCount == file->patchCapacity) {
+        size_t newCapacity = file->patchCapacity ? file->patchCapacity * 2 : 64;
+        HexPatch* newPatches = (HexPatch*)MemoryRealloc(MEMORY_TAG_HEX, file->patches, newCapacity * sizeof(HexPatch));
+        if (!newPatches) {
+            return false;
+        }
+        file->patches = newPatches;
+        file->patchCapacity = newCapacity;
+    }
+    memmove(&file->patches[index + 1], &file->patches[index], (file->patchCount - index) * sizeof(HexPatch));
+    file->patches[index].offset = offset;
+    file->patches[index].value = value;
+    file->patches[index].original = shown;
+    file->patchCount++;
+    return true;
+}
+
+/**
+ * @brief Writes every run of adjacent patches to the file.
+ *
+ * @param file The file.
+ * @return true if successful, false otherwise.
+ */
+static bool WritePatches(const HexFile* file) {
+    void* handle = OpenForWriting(file->path);
+    if (!handle) {
+        return false;
+    }
+
+    uint8_t buffer[HEX_FILE_WRITE_CHUNK];
+    bool written = true;
+    size_t i = 0;
+    while (written && i < file->patchCount) {
+        uint64_t start = file->patches[i].offset;
+        size_t length = 0;
+        while (i < file->patchCount && file->patches[i].offset == start + length && length < sizeof(buffer)) {
+            buffer[length++] = file->patches[i++].value;
+        }
+        written = WriteAt(handle, start, buffer, length);
+    }
+    return CloseForWriting(handle) && written;
+}
+
+/**
+ * @brief Opens a file for the hex view.
+ *
+ * Only the file is opened; windows of it are mapped when they are read.
+ *
+ * @param filePath Path to the file.
+ * @return The file, or NULL on failure. Close it with HexFileClose.
+ */
+HexFile* HexFileOpen(const char* filePath) {
+    if (!filePath) {
+        return NULL;
+    }
+    HexFile* file = (HexFile*)MemoryCalloc(MEMORY_TAG_HEX, 1, sizeof(HexFile));
+    if (!file) {
+        return NULL;
+    }
+    size_t pathLength = strlen(filePath);
+    file->path = (char*)MemoryAlloc(MEMORY_TAG_HEX, pathLength + 1);
+    if (!file->path) {
+        MemoryFree(file);
+        return NULL;
+    }
+    memcpy(file->path, filePath, pathLength + 1);
+
+    if (!AcquireFile(file)) {
+        MemoryFree(file->path);
+        MemoryFree(file);
+        return NULL;
+    }
+    return file;
+}
+
+/**
+ * @brief Closes a file and discards its unsaved changes.
+ *
+ * @param file The file. NULL is ignored.
+ */
+void HexFileClose(HexFile* file) {
+    if (!file) {
+        return;
+    }
+    UnmapWindows(file);
+    ReleaseFile(file);
+    MemoryFree(file->patches);
+    MemoryFree(file->undo);
+    MemoryFree(file->path);
+    MemoryFree(file);
+}
+
+/**
+ * @brief Gets the size of a file.
+ *
+ * @param file The file.
+ * @return Size in bytes; overwriting never changes it.
+ */
+uint64_t HexFileSize(const HexFile* file) {
+    return file ? file->size : 0;
+}
+
+/**
+ * @brief Checks whether text looks like binary data.
+ *
+ * Text never contains NUL bytes and rarely control characters other than
+ * tabs, line breaks, form feeds and escapes.
+ *
+ * @param data The bytes to examine.
+ * @param length Number of bytes.
+ * @return true for binary data, false for text.
+ */
+bool HexLooksBinary(const char* data, size_t length) {
+    if (!data) {
+        return false;
+    }
+    size_t controls = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)data[i];
+        if (c == 0) {
+            return true;
+        }
+        if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != 0x1B) || c == 0x7F) {
+            controls++;
+        }
+    }
+    // More than one control character in ten
+    return controls * 10 > length;
+}
+
+/**
+ * @brief Checks whether the start of a file looks like binary data.
+ *
+ * @param file The file.
+ * @return true if the first HEX_FILE_SNIFF_BYTES bytes look binary, false otherwise.
+ */
+bool HexFileIsBinary(HexFile* file) {
+    if (!file) {
+        return false;
+    }
+    uint8_t sample[HEX_FILE_SNIFF_BYTES];
+    size_t length = HexFileRead(file, 0, sample, NULL, sizeof(sample));
+    return HexLooksBinary((const char*)sample, length);
+}
+
+/**
+ * @brief Reads bytes of a file with the overwritten bytes applied.
+ *
+ * @param file The file.
+ * @param offset Offset of the first byte.
+ * @param[out] buffer Receives the bytes.
+ * @param[out] modified Receives true for every overwritten byte, or NULL.
+ * @param length Number of bytes to read.
+ * @return Number of bytes read; less than length at the end of the file or if a window cannot be mapped.
+ */
+size_t HexFileRead(HexFile* file, uint64_t offset, uint8_t* buffer, bool* modified, size_t length) {
+    if (!file || !buffer || offset >= file->size) {
+        return 0;
+    }
+    if (length > file->size - offset) {
+        length = (size_t)(file->size - offset);
+    }
+
+    size_t done = 0;
+    while (done < length) {
+        uint64_t position = offset + done;
+        HexWindow* window = AcquireWindow(file, position - position % HEX_FILE_WINDOW_SIZE);
+        if (!window) {
+            break;
+        }
+        size_t from = (size_t)(position - window->start);
+        size_t count = window->length - from;
+        if (count > length - done) {
+            count = length - done;
+        }
+        memcpy(buffer + done, window->data + from, count);
+        done += count;
+    }
+
+    if (modified) {
+        memset(modified, 0, done * sizeof(bool));
+    }
+    for (size_t i = FindPatch(file, offset); i < file->patchCount && file->patches[i].offset < offset + done; i++) {
+        size_t index = (size_t)(file->patches[i].offset - offset);
+        buffer[index] = file->patches[i].value;
+        if (modified) {
+            modified[index] = true;
+        }
+    }
+    return done;
+}
+
+/**
+ * @brief Overwrites one byte.
+ *
+ * Writing the byte that is on disk removes the byte from the overlay.
+ *
+ * @param file The file.
+ * @param offset Offset of the byte; must be less than the file size.
+ * @param value The new value.
+ * @return true if successful, false on allocation failure or if the byte cannot be read.
+ */
+bool HexFileSetByte(HexFile* file, uint64_t offset, uint8_t value) {
+    uint8_t shown;
+    if (!file || HexFileRead(file, offset, &shown, NULL, 1) != 1) {
+        return false;
+    }
+    if (shown == value) {
+        return true;
+    }
+
+    if (file->undoCount == file->undoCapacity) {
+        size_t newCapacity = file->undoCapacity ? file->undoCapacity * 2 : 64;
+        HexUndo* newUndo = (HexUndo*)MemoryRealloc(MEMORY_TAG_HEX, file->undo, newCapacity * sizeof(HexUndo));
+        if (!newUndo) {
+            return false;
+        }
+        file->undo = newUndo;
+        file->undoCapacity = newCapacity;
+    }
+    size_t index = FindPatch(file, offset);
+    uint8_t original = index < file->patchCount && file->patches[index].offset == offset
+                           ? file->patches[index].original : shown;
+    if (!StorePatch(file, offset, value, shown)) {
+        return false;
+    }
+    file->undo[file->undoCount].offset = offset;
+    file->undo[file->undoCount].previous = shown;
+    file->undo[file->undoCount].original = original;
+    file->undoCount++;
+    return true;
+}
+
+/**
+ * @brief Reverts the most recent overwrite.
+ *
+ * @param file The file.
+ * @param[out] offset Receives the offset of the reverted byte, or NULL.
+ * @return true if an overwrite was reverted, false if there is none or on allocation failure.
+ */
+bool HexFileUndo(HexFile* file, uint64_t* offset) {
+    if (!file || file->undoCount == 0) {
+        return false;
+    }
+    const HexUndo* undo = &file->undo[file->undoCount - 1];
+
+    // A later overwrite may have put the byte on disk back and removed its patch
+    if (!StorePatch(file, undo->offset, undo->previous, undo->original)) {
+        return false;
+    }
+    file->undoCount--;
+    if (offset) {
+        *offset = undo->offset;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether a file has bytes that differ from the disk.
+ *
+ * @param file The file.
+ * @return true if there are unsaved changes, false otherwise.
+ */
+bool HexFileIsModified(const HexFile* file) {
+    return file && file->patchCount > 0;
+}
+
+/**
+ * @brief Writes the overwritten bytes back into the file in place.
+ *
+ * Every run of adjacent changed bytes is written with one write at its
+ * offset; the rest of the file is not touched. The save is refused when the
+ * file changed on disk since it was opened. The overlay and undo history
+ * are cleared afterwards.
+ *
+ * @param file The file.
+ * @return true if successful, false otherwise.
+ */
+bool HexFileSave(HexFile* file) {
+    if (!file) {
+        return false;
+    }
+    FileIdentity identity;
+    if (!GetFileIdentity(file->path, &identity) || identity.size != file->identity.size ||
+        identity.mtime != file->identity.mtime) {
+        return false;
+    }
+    if (file->patchCount == 0) {
+        return true;
+    }
+
+    // Windows refuses writers while the file is open and mapped here
+    UnmapWindows(file);
+    ReleaseFile(file);
+    bool saved = WritePatches(file);
+    if (saved) {
+        file->patchCount = 0;
+        file->undoCount = 0;
+    }
+    return AcquireFile(file) && saved;
+}
@@ -0,0 +1,660 @@
+/**
+ * @file hexview.c
+ * @brief Hex view implementation for the Professional Text Editor
+ *
+ * Every paint reads the bytes of the rows it draws, so the cost of opening
+ * and scrolling a file does not depend on its size. Overwritten bytes are
+ * drawn in a different color until they are saved.
+ */
+
+#include "../include/hexview.h"
+#include <limits.h>
+#include <string.h>
+#include <windowsx.h> // For GET_X_LPARAM and GET_Y_LPARAM
+
+// Font of the view; same as the editor view
+#define HEX_VIEW_FONT_NAME "Consolas"
+#define HEX_VIEW_FONT_HEIGHT 16
+
+// Bytes shown per row, in two groups of eight
+#define HEX_VIEW_BYTES_PER_ROW 16
+#define HEX_VIEW_GROUP_BYTES 8
+
+// Longest row: 16 offset digits, 2 spaces, 49 hex cells, 2 spaces, 16 characters
+#define HEX_VIEW_ROW_CHARS 96
+
+// Rows scrolled per mouse wheel notch
+#define HEX_VIEW_WHEEL_LINES 3
+
+// Width of the caret in pixels
+#define HEX_VIEW_CARET_WIDTH 2
+
+// Background of the byte under the caret and color of unsaved bytes
+#define HEX_VIEW_CARET_BYTE_COLOR RGB(173, 214, 255)
+#define HEX_VIEW_MODIFIED_COLOR RGB(224, 32, 32)
+
+// State of one hex view window
+typedef struct {
+    HexFile* file;              // File shown, or NULL
+    HFONT font;
+    int charWidth;
+    int lineHeight;
+    int offsetDigits;           // 8, or 16 for files larger than 4 GB
+    uint64_t firstRow;          // First visible row
+    int visibleLines;           // Rows that fit in the client area
+    int scrollShift;            // Rows per scroll bar unit as a power of two, for more than INT_MAX rows
+    uint64_t caret;             // Offset of the byte with the caret
+    BOOL lowNibble;             // The next hex digit replaces the low half of the caret byte
+    BOOL asciiColumn;           // Typing goes to the character column instead of the hex column
+    BOOL hasFocus;
+} HexView;
+
+/**
+ * @brief Gets the state attached to a hex view window.
+ *
+ * @param hWnd Handle to the view.
+ * @return The view state, or NULL if the window has none.
+ */
+static HexView* GetView(HWND hWnd) {
+    return hWnd ? (HexView*)GetWindowLongPtr(hWnd, GWLP_USERDATA) : NULL;
+}
+
+/**
+ * @brief Gets the number of rows of the file shown.
+ *
+ * @param view The view.
+ * @return The row count, at least 1.
+ */
+static uint64_t RowCount(const HexView* view) {
+    uint64_t size = HexFileSize(view->file);
+    return size > 0 ? (size - 1) / HEX_VIEW_BYTES_PER_ROW + 1 : 1;
+}
+
+/**
+ * @brief Gets the column of a byte in the hex column.
+ *
+ * @param view The view.
+ * @param index Index of the byte in its row.
+ * @return The column of its first digit.
+ */
+static int HexColumn(const HexView* view, int index) {
+    return view->offsetDigits + 2 + index * 3 + (index >= HEX_VIEW_GROUP_BYTES ? 1 : 0);
+}
+
+/**
+ * @brief Gets the column of a byte in the character column.
+ *
+ * @param view The view.
+ * @param index Index of the byte in its row.
+ * @return The column of its character.
+ */
+static int AsciiColumn(const HexView* view, int index) {
+    return HexColumn(view, HEX_VIEW_BYTES_PER_ROW) + 1 + index;
+}
+
+/**
+ * @brief Updates the vertical scroll bar from the file size and scroll position.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void UpdateScrollBars(HWND hWnd, HexView* view) {
+    uint64_t lastRow = RowCount(view) - 1;
+    view->scrollShift = 0;
+    while ((lastRow >> view->scrollShift) > INT_MAX) {
+        view->scrollShift++;
+    }
+
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+    si.nMin = 0;
+    si.nMax = (int)(lastRow >> view->scrollShift);
+    si.nPage = (UINT)(view->scrollShift == 0 ? view->visibleLines : 1);
+    si.nPos = (int)(view->firstRow >> view->scrollShift);
+    SetScrollInfo(hWnd, SB_VERT, &si, TRUE);
+}
+
+/**
+ * @brief Scrolls the view to a row.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param firstRow New first visible row.
+ */
+static void ScrollViewTo(HWND hWnd, HexView* view, uint64_t firstRow) {
+    uint64_t rowCount = RowCount(view);
+    if (firstRow >= rowCount) {
+        firstRow = rowCount - 1;
+    }
+    if (firstRow == view->firstRow) {
+        return;
+    }
+    view->firstRow = firstRow;
+    UpdateScrollBars(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Moves the caret to a byte and scrolls it into view.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param offset Offset of the byte; clamped to the last byte.
+ */
+static void SetCaret(HWND hWnd, HexView* view, uint64_t offset) {
+    uint64_t size = HexFileSize(view->file);
+    if (offset >= size) {
+        offset = size > 0 ? size - 1 : 0;
+    }
+    view->caret = offset;
+    view->lowNibble = FALSE;
+
+    uint64_t row = offset / HEX_VIEW_BYTES_PER_ROW;
+    uint64_t rows = view->visibleLines > 0 ? (uint64_t)view->visibleLines : 1;
+    if (row < view->firstRow) {
+        ScrollViewTo(hWnd, view, row);
+    } else if (row >= view->firstRow + rows) {
+        ScrollViewTo(hWnd, view, row - rows + 1);
+    }
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Overwrites the byte under the caret and moves on to the next one.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param value The new value.
+ * @param advance TRUE to move the caret to the next byte.
+ */
+static void OverwriteByte(HWND hWnd, HexView* view, uint8_t value, BOOL advance) {
+    if (!HexFileSetByte(view->file, view->caret, value)) {
+        MessageBeep(MB_ICONWARNING);
+        return;
+    }
+    if (advance && view->caret + 1 < HexFileSize(view->file)) {
+        SetCaret(hWnd, view, view->caret + 1);
+    } else {
+        view->lowNibble = !advance;
+        InvalidateRect(hWnd, NULL, FALSE);
+    }
+}
+
+/**
+ * @brief Handles navigation keys.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param key The virtual key code.
+ * @return TRUE if the key was handled, FALSE otherwise.
+ */
+static BOOL HandleKeyDown(HWND hWnd, HexView* view, WPARAM key) {
+    BOOL control = GetKeyState(VK_CONTROL) < 0;
+    uint64_t size = HexFileSize(view->file);
+    uint64_t caret = view->caret;
+    uint64_t rowStart = caret - caret % HEX_VIEW_BYTES_PER_ROW;
+    uint64_t page = (view->visibleLines > 1 ? (uint64_t)(view->visibleLines - 1) : 1) * HEX_VIEW_BYTES_PER_ROW;
+
+    switch (key) {
+        case VK_LEFT:
+            SetCaret(hWnd, view, caret > 0 ? caret - 1 : 0);
+            return TRUE;
+        case VK_RIGHT:
+            SetCaret(hWnd, view, caret + 1);
+            return TRUE;
+        case VK_UP:
+            SetCaret(hWnd, view, caret >= HEX_VIEW_BYTES_PER_ROW ? caret - HEX_VIEW_BYTES_PER_ROW : caret);
+            return TRUE;
+        case VK_DOWN:
+            if (caret + HEX_VIEW_BYTES_PER_ROW < size) {
+                SetCaret(hWnd, view, caret + HEX_VIEW_BYTES_PER_ROW);
+            }
+            return TRUE;
+        case VK_PRIOR:
+            ScrollViewTo(hWnd, view, view->firstRow > page / HEX_VIEW_BYTES_PER_ROW ?
+                                     view->firstRow - page / HEX_VIEW_BYTES_PER_ROW : 0);
+            SetCaret(hWnd, view, caret > page ? caret - page : caret % HEX_VIEW_BYTES_PER_ROW);
+            return TRUE;
+        case VK_NEXT:
+            ScrollViewTo(hWnd, view, view->firstRow + page / HEX_VIEW_BYTES_PER_ROW);
+            SetCaret(hWnd, view, size - caret > page ? caret + page : size);
+            return TRUE;
+        case VK_HOME:
+            SetCaret(hWnd, view, control ? 0 : rowStart);
+            return TRUE;
+        case VK_END:
+            SetCaret(hWnd, view, control ? size : rowStart + HEX_VIEW_BYTES_PER_ROW - 1);
+            return TRUE;
+        case 'Z':
+            if (control) {
+                uint64_t offset;
+                if (HexFileUndo(view->file, &offset)) {
+                    SetCaret(hWnd, view, offset);
+                }
+                return TRUE;
+            }
+            return FALSE;
+        default:
+            return FALSE;
+    }
+}
+
+/**
+ * @brief Handles typed characters.
+ *
+ * Tab switches between the hex and character columns.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param character The character code.
+ */
+static void HandleChar(HWND hWnd, HexView* view, WPARAM character) {
+    if (character == '\t') {
+        view->asciiColumn = !view->asciiColumn;
+        view->lowNibble = FALSE;
+        InvalidateRect(hWnd, NULL, FALSE);
+        return;
+    }
+    // Control characters are produced by Ctrl shortcuts handled in WM_KEYDOWN
+    if (character < 0x20 || character > 0xFF || HexFileSize(view->file) == 0) {
+        return;
+    }
+
+    if (view->asciiColumn) {
+        OverwriteByte(hWnd, view, (uint8_t)character, TRUE);
+        return;
+    }
+
+    int digit;
+    if (character >= '0' && character <= '9') {
+        digit = (int)(character - '0');
+    } else if (character >= 'a' && character <= 'f') {
+        digit = (int)(character - 'a') + 10;
+    } else if (character >= 'A' && character <= 'F') {
+        digit = (int)(character - 'A') + 10;
+    } else {
+        MessageBeep(MB_OK);
+        return;
+    }
+    uint8_t shown;
+    if (HexFileRead(view->file, view->caret, &shown, NULL, 1) != 1) {
+        return;
+    }
+    if (view->lowNibble) {
+        OverwriteByte(hWnd, view, (uint8_t)((shown & 0xF0) | digit), TRUE);
+    } else {
+        OverwriteByte(hWnd, view, (uint8_t)((digit << 4) | (shown & 0x0F)), FALSE);
+    }
+}
+
+/**
+ * @brief Places the caret on the byte under the mouse.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param lParam Mouse position.
+ */
+static void HandleMouseDown(HWND hWnd, HexView* view, LPARAM lParam) {
+    SetFocus(hWnd);
+    int column = GET_X_LPARAM(lParam) / view->charWidth;
+    uint64_t rowStart = (view->firstRow + (uint64_t)(GET_Y_LPARAM(lParam) / view->lineHeight)) * HEX_VIEW_BYTES_PER_ROW;
+
+    for (int i = 0; i < HEX_VIEW_BYTES_PER_ROW; i++) {
+        if (column >= HexColumn(view, i) && column < HexColumn(view, i) + 3) {
+            view->asciiColumn = FALSE;
+            SetCaret(hWnd, view, rowStart + (uint64_t)i);
+            view->lowNibble = column == HexColumn(view, i) + 1 && view->caret == rowStart + (uint64_t)i;
+            return;
+        }
+    }
+    if (column >= AsciiColumn(view, 0) && column < AsciiColumn(view, HEX_VIEW_BYTES_PER_ROW)) {
+        view->asciiColumn = TRUE;
+        SetCaret(hWnd, view, rowStart + (uint64_t)(column - AsciiColumn(view, 0)));
+    }
+}
+
+/**
+ * @brief Handles a scroll bar notification.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param request The scroll request (LOWORD of wParam).
+ */
+static void HandleScroll(HWND hWnd, HexView* view, int request) {
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_ALL;
+    GetScrollInfo(hWnd, SB_VERT, &si);
+
+    uint64_t position = view->firstRow;
+    uint64_t page = view->visibleLines > 1 ? (uint64_t)(view->visibleLines - 1) : 1;
+    switch (request) {
+        case SB_LINEUP:        position = position > 0 ? position - 1 : 0; break;
+        case SB_LINEDOWN:      position += 1; break;
+        case SB_PAGEUP:        position = position > page ? position - page : 0; break;
+        case SB_PAGEDOWN:      position += page; break;
+        case SB_THUMBTRACK:
+        case SB_THUMBPOSITION: position = (uint64_t)si.nTrackPos << view->scrollShift; break;
+        case SB_TOP:           position = 0; break;
+        case SB_BOTTOM:        position = RowCount(view) - 1; break;
+        default:               return;
+    }
+    ScrollViewTo(hWnd, view, position);
+}
+
+/**
+ * @brief Formats one row as offset, hex bytes and characters.
+ *
+ * @param view The view.
+ * @param rowStart Offset of the first byte of the row.
+ * @param bytes The bytes of the row.
+ * @param modified Overwritten flags of the bytes.
+ * @param count Number of bytes.
+ * @param showModified TRUE to format only the overwritten bytes, FALSE to format all others.
+ * @param[out] text Receives the row, padded with spaces; HEX_VIEW_ROW_CHARS long.
+ * @return Number of characters up to the last byte's character.
+ */
+static int FormatRow(const HexView* view, uint64_t rowStart, const uint8_t* bytes, const bool* modified,
+                     size_t count, BOOL showModified, char* text) {
+    static const char digits[] = "0123456789ABCDEF";
+    memset(text, ' ', HEX_VIEW_ROW_CHARS);
+    if (!showModified) {
+        for (int i = 0; i < view->offsetDigits; i++) {
+            text[i] = digits[(rowStart >> ((view->offsetDigits - 1 - i) * 4)) & 0x0F];
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if ((modified[i] ? TRUE : FALSE) != showModified) {
+            continue;
+        }
+        int hex = HexColumn(view, (int)i);
+        text[hex] = digits[bytes[i] >> 4];
+        text[hex + 1] = digits[bytes[i] & 0x0F];
+        text[AsciiColumn(view, (int)i)] = bytes[i] >= 0x20 && bytes[i] < 0x7F ? (char)bytes[i] : '.';
+    }
+    return AsciiColumn(view, (int)count);
+}
+
+/**
+ * @brief Paints the rows of the view that intersect the update region.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void PaintView(HWND hWnd, HexView* view) {
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hWnd, &ps);
+    if (!hdc) {
+        return;
+    }
+
+    RECT client;
+    GetClientRect(hWnd, &client);
+    HFONT oldFont = (HFONT)SelectObject(hdc, view->font);
+    HBRUSH background = GetSysColorBrush(COLOR_WINDOW);
+    HBRUSH caretBrush = CreateSolidBrush(HEX_VIEW_CARET_BYTE_COLOR);
+    SetBkMode(hdc, TRANSPARENT);
+
+    uint64_t size = HexFileSize(view->file);
+    uint64_t caretRow = view->caret / HEX_VIEW_BYTES_PER_ROW;
+    int caretIndex = (int)(view->caret % HEX_VIEW_BYTES_PER_ROW);
+    int firstRow = ps.rcPaint.top / view->lineHeight;
+    int lastRow = (ps.rcPaint.bottom + view->lineHeight - 1) / view->lineHeight;
+    for (int row = firstRow; row < lastRow; row++) {
+        RECT rowRect = { client.left, row * view->lineHeight, client.right, (row + 1) * view->lineHeight };
+        FillRect(hdc, &rowRect, background);
+
+        uint64_t rowIndex = view->firstRow + (uint64_t)row;
+        uint8_t bytes[HEX_VIEW_BYTES_PER_ROW];
+        bool modified[HEX_VIEW_BYTES_PER_ROW];
+        size_t count = HexFileRead(view->file, rowIndex * HEX_VIEW_BYTES_PER_ROW, bytes, modified,
+                                   HEX_VIEW_BYTES_PER_ROW);
+        if (count == 0) {
+            continue;
+        }
+
+        // The byte under the caret is highlighted in both columns
+        if (rowIndex == caretRow && view->caret < size) {
+            int hex = HexColumn(view, caretIndex);
+            int ascii = AsciiColumn(view, caretIndex);
+            RECT hexRect = { hex * view->charWidth, rowRect.top, (hex + 2) * view->charWidth, rowRect.bottom };
+            RECT asciiRect = { ascii * view->charWidth, rowRect.top, (ascii + 1) * view->charWidth, rowRect.bottom };
+            FillRect(hdc, &hexRect, caretBrush);
+            FillRect(hdc, &asciiRect, caretBrush);
+        }
+
+        char text[HEX_VIEW_ROW_CHARS];
+        int length = FormatRow(view, rowIndex * HEX_VIEW_BYTES_PER_ROW, bytes, modified, count, FALSE, text);
+        SetTextColor(hdc, GetSysColor(COLOR_WINDOWTEXT));
+        TextOut(hdc, 0, rowRect.top, text, length);
+        length = FormatRow(view, rowIndex * HEX_VIEW_BYTES_PER_ROW, bytes, modified, count, TRUE, text);
+        SetTextColor(hdc, HEX_VIEW_MODIFIED_COLOR);
+        TextOut(hdc, 0, rowRect.top, text, length);
+
+        if (view->hasFocus && rowIndex == caretRow) {
+            int column = view->asciiColumn ? AsciiColumn(view, caretIndex) :
+                                             HexColumn(view, caretIndex) + (view->lowNibble ? 1 : 0);
+            PatBlt(hdc, column * view->charWidth, rowRect.top, HEX_VIEW_CARET_WIDTH, view->lineHeight, DSTINVERT);
+        }
+    }
+
+    DeleteObject(caretBrush);
+    SelectObject(hdc, oldFont);
+    EndPaint(hWnd, &ps);
+}
+
+/**
+ * @brief Creates the view state and font.
+ *
+ * @param hWnd Handle to the view.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+static BOOL CreateView(HWND hWnd) {
+    HexView* view = (HexView*)calloc(1, sizeof(HexView));
+    if (!view) {
+        return FALSE;
+    }
+    view->offsetDigits = 8;
+
+    view->font = CreateFont(-HEX_VIEW_FONT_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                            OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, FIXED_PITCH | FF_MODERN,
+                            HEX_VIEW_FONT_NAME);
+    if (!view->font) {
+        view->font = (HFONT)GetStockObject(ANSI_FIXED_FONT);
+    }
+
+    // Measure one cell of the fixed-pitch font
+    HDC hdc = GetDC(hWnd);
+    HFONT oldFont = (HFONT)SelectObject(hdc, view->font);
+    TEXTMETRIC tm;
+    GetTextMetrics(hdc, &tm);
+    SelectObject(hdc, oldFont);
+    ReleaseDC(hWnd, hdc);
+    view->charWidth = tm.tmAveCharWidth > 0 ? (int)tm.tmAveCharWidth : 8;
+    view->lineHeight = tm.tmHeight + tm.tmExternalLeading > 0 ? (int)(tm.tmHeight + tm.tmExternalLeading) : 16;
+
+    SetWindowLongPtr(hWnd, GWLP_USERDATA, (LONG_PTR)view);
+    return TRUE;
+}
+
+/**
+ * @brief Releases the view state and its file.
+ *
+ * @param hWnd Handle to the view.
+ */
+static void DestroyView(HWND hWnd) {
+    HexView* view = GetView(hWnd);
+    if (!view) {
+        return;
+    }
+    SetWindowLongPtr(hWnd, GWLP_USERDATA, 0);
+    HexFileClose(view->file);
+    if (view->font) {
+        DeleteObject(view->font);
+    }
+    free(view);
+}
+
+/**
+ * @brief Window procedure of the hex view.
+ *
+ * @param hWnd Handle to the view.
+ * @param message The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing.
+ */
+static LRESULT CALLBACK HexViewProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    HexView* view = GetView(hWnd);
+    if (!view && message != WM_CREATE) {
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+
+    switch (message) {
+        case WM_CREATE:
+            return CreateView(hWnd) ? 0 : -1;
+
+        case WM_DESTROY:
+            DestroyView(hWnd);
+            return 0;
+
+        case WM_SIZE:
+            view->visibleLines = HIWORD(lParam) / view->lineHeight;
+            UpdateScrollBars(hWnd, view);
+            InvalidateRect(hWnd, NULL, FALSE);
+            return 0;
+
+        case WM_ERASEBKGND:
+            // Every row is filled by WM_PAINT
+            return 1;
+
+        case WM_PAINT:
+            PaintView(hWnd, view);
+            return 0;
+
+        case WM_SETFOCUS:
+        case WM_KILLFOCUS:
+            view->hasFocus = message == WM_SETFOCUS;
+            InvalidateRect(hWnd, NULL, FALSE);
+            return 0;
+
+        case WM_GETDLGCODE:
+            return DLGC_WANTALLKEYS | DLGC_WANTCHARS | DLGC_WANTARROWS | DLGC_WANTTAB;
+
+        case WM_KEYDOWN:
+            if (view->file && HandleKeyDown(hWnd, view, wParam)) {
+                return 0;
+            }
+            break;
+
+        case WM_CHAR:
+            if (view->file) {
+                HandleChar(hWnd, view, wParam);
+            }
+            return 0;
+
+        case WM_LBUTTONDOWN:
+            if (view->file) {
+                HandleMouseDown(hWnd, view, lParam);
+            }
+            return 0;
+
+        case WM_VSCROLL:
+            HandleScroll(hWnd, view, LOWORD(wParam));
+            return 0;
+
+        case WM_MOUSEWHEEL: {
+            int notches = GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+            int64_t delta = (int64_t)notches * HEX_VIEW_WHEEL_LINES;
+            uint64_t firstRow = view->firstRow;
+            if (delta > 0) {
+                firstRow = firstRow > (uint64_t)delta ? firstRow - (uint64_t)delta : 0;
+            } else {
+                firstRow += (uint64_t)-delta;
+            }
+            ScrollViewTo(hWnd, view, firstRow);
+            return 0;
+        }
+
+        case WM_UNDO: {
+            uint64_t offset;
+            if (!HexFileUndo(view->file, &offset)) {
+                return FALSE;
+            }
+            SetCaret(hWnd, view, offset);
+            return TRUE;
+        }
+    }
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+/**
+ * @brief Creates the hex view within the parent window.
+ *
+ * The view is created hidden and without a file.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hInstance Handle to the application instance.
+ * @return Handle to the view, or NULL if creation failed.
+ */
+HWND CreateHexView(HWND hWnd, HINSTANCE hInstance) {
+    static BOOL registered = FALSE;
+    if (!registered) {
+        WNDCLASSEX wcex;
+        ZeroMemory(&wcex, sizeof(wcex));
+        wcex.cbSize = sizeof(WNDCLASSEX);
+        wcex.lpfnWndProc = HexViewProc;
+        wcex.hInstance = hInstance;
+        wcex.hCursor = LoadCursor(NULL, IDC_IBEAM);
+        wcex.hbrBackground = NULL; // The view paints its own background
+        wcex.lpszClassName = HEX_VIEW_CLASS_NAME;
+        if (!RegisterClassEx(&wcex)) {
+            return NULL;
+        }
+        registered = TRUE;
+    }
+
+    return CreateWindowEx(WS_EX_CLIENTEDGE, HEX_VIEW_CLASS_NAME, NULL, WS_CHILD | WS_VSCROLL | WS_TABSTOP,
+                          0, 0, 0, 0, hWnd, NULL, hInstance, NULL);
+}
+
+/**
+ * @brief Replaces the file shown in the hex view.
+ *
+ * The previous file is closed and its unsaved changes are discarded.
+ *
+ * @param hHex Handle to the hex view.
+ * @param file The file to show; ownership is transferred to the view. NULL closes the current file.
+ */
+void SetHexViewFile(HWND hHex, HexFile* file) {
+    HexView* view = GetView(hHex);
+    if (!view) {
+        HexFileClose(file);
+        return;
+    }
+    if (view->file != file) {
+        HexFileClose(view->file);
+        view->file = file;
+    }
+    view->offsetDigits = HexFileSize(file) > 0xFFFFFFFFULL ? 16 : 8;
+    view->firstRow = 0;
+    view->caret = 0;
+    view->lowNibble = FALSE;
+    view->asciiColumn = FALSE;
+    UpdateScrollBars(hHex, view);
+    InvalidateRect(hHex, NULL, FALSE);
+}
+
+/**
+ * @brief Gets the file shown in the hex view.
+ *
+ * @param hHex Handle to the hex view.
+ * @return The file, owned by the view, or NULL if none is shown.
+ */
+HexFile* GetHexViewFile(HWND hHex) {
+    HexView* view = GetView(hHex);
+    return view ? view->file : NULL;
+}
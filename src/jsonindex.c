@@ -0,0 +1,960 @@
+/**
+ * @file jsonindex.c
+ * @brief Structural index of JSON text implementation for the Professional Text Editor
+ *
+ * Contains the word-parallel classification of structural characters, the
+ * record of large objects and arrays, lazy listing of members and the
+ * formatter of single values.
+ */
+
+#include "../include/jsonindex.h"
+#include "../include/bitscan.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes of formatted text collected before each write
+#define JSON_FORMAT_BUFFER 4096
+
+// Children listed per step when formatting a sequence
+#define JSON_FORMAT_BATCH 64
+
+// No recorded member offsets
+#define JSON_NO_CHECKPOINT UINT64_MAX
+
+// Recorded object or array
+typedef struct {
+    uint64_t start;             // Offset of the opening bracket
+    uint64_t end;               // Offset past the closing bracket
+    uint64_t childCount;
+    uint64_t firstCheckpoint;   // Position in checkpoints of the start of member JSON_INDEX_GROUP
+    uint64_t checkpointCount;   // Recorded member offsets, one per JSON_INDEX_GROUP members
+} ContainerRecord;
+
+struct JsonIndex {
+    const Document* document;
+    ContainerRecord* records;   // Sorted by start
+    size_t recordCount;
+    size_t recordCapacity;
+    uint64_t* checkpoints;      // Member offsets of the records, each record's together
+    size_t checkpointCount;
+    size_t checkpointCapacity;
+    uint64_t topLevelCount;     // Values outside any object or array
+    uint64_t topCheckpoint;     // Position in checkpoints of the start of top-level value JSON_INDEX_GROUP
+    uint64_t topCheckpointCount;
+};
+
+// Object or array open while building, or the document level at the bottom of the stack
+typedef struct {
+    size_t record;              // Position of its record
+    uint64_t start;
+    uint64_t separators;        // Commas directly inside; top-level values at the document level
+    bool content;               // Something other than white space was seen directly inside
+    uint64_t* checkpoints;      // Offsets of every JSON_INDEX_GROUP-th member; kept for reuse at this depth
+    size_t checkpointCount;
+    size_t checkpointCapacity;
+} BuildFrame;
+
+// State of the index build carried from block to block
+typedef struct {
+    JsonIndex* index;
+    BuildFrame* frames;
+    size_t frameCount;
+    size_t frameCapacity;
+    bool inString;              // The next block starts inside a string
+    bool escapeNext;            // The next block starts with an escaped byte
+    bool contentPending;        // Content was seen after the last structural character
+    bool barePending;           // The last byte seen belongs to a value without quotes or brackets
+    uint64_t firstValue;        // Offset where values may start, past a byte order mark
+} Builder;
+
+// Reader of document bytes that can jump ahead
+typedef struct {
+    const Document* document;
+    DocumentIterator iterator;
+    const char* data;
+    size_t length;
+    size_t position;
+    uint64_t offset;            // Offset of data[position]
+} Reader;
+
+// Buffered output of the formatter
+typedef struct {
+    JsonWriteCallback write;
+    void* context;
+    bool failed;
+    size_t length;
+    char buffer[JSON_FORMAT_BUFFER];
+} FormatWriter;
+
+/**
+ * @brief Appends a member offset to a frame.
+ *
+ * @param frame The frame.
+ * @param offset Start of the member.
+ * @return true if successful, false if out of memory.
+ */
+static bool AppendFrameCheckpoint(BuildFrame* frame, uint64_t offset) {
+    if (frame->checkpointCount == frame->checkpointCapacity) {
+        size_t newCapacity = frame->checkpointCapacity ? frame->checkpointCapacity * 2 : 64;
+        uint64_t* newCheckpoints = (uint64_t*)MemoryRealloc(MEMORY_TAG_JSON, frame->checkpoints,
+                                                            newCapacity * sizeof(uint64_t));
+        if (!newCheckpoints) {
+            return false;
+        }
+        frame->checkpoints = newCheckpoints;
+        frame->checkpointCapacity = newCapacity;
+    }
+    frame->checkpoints[frame->checkpointCount++] = offset;
+    return true;
+}
+
+/**
+ * @brief Moves the member offsets of a frame to the index.
+ *
+ * @param index The index.
+ * @param frame The frame.
+ * @param[out] first Receives the position of the first moved offset.
+ * @return true if successful, false if out of memory.
+ */
+static bool StoreCheckpoints(JsonIndex* index, BuildFrame* frame, uint64_t* first) {
+    if (index->checkpointCount + frame->checkpointCount > index->checkpointCapacity) {
+        size_t newCapacity = index->checkpointCapacity ? index->checkpointCapacity : 256;
+        while (newCapacity < index->checkpointCount + frame->checkpointCount) {
+            newCapacity *= 2;
+        }
+        uint64_t* newCheckpoints = (uint64_t*)MemoryRealloc(MEMORY_TAG_JSON, index->checkpoints,
+                                                            newCapacity * sizeof(uint64_t));
+        if (!newCheckpoints) {
+            return false;
+        }
+        index->checkpoints = newCheckpoints;
+        index->checkpointCapacity = newCapacity;
+    }
+    *first = index->checkpointCount;
+    memcpy(index->checkpoints + index->checkpointCount, frame->checkpoints,
+           frame->checkpointCount * sizeof(uint64_t));
+    index->checkpointCount += frame->checkpointCount;
+    return true;
+}
+
+/**
+ * @brief Counts a value at the document level.
+ *
+ * Top-level values have no commas between them, so each one is counted as
+ * it starts, and every JSON_INDEX_GROUP-th start is recorded for listing.
+ *
+ * @param builder The build state.
+ * @param offset Offset of the first byte of the value.
+ * @return true if successful, false if out of memory.
+ */
+static bool CountTopLevelValue(Builder* builder, uint64_t offset) {
+    BuildFrame* frame = &builder->frames[0];
+    if (frame->separators > 0 && frame->separators % JSON_INDEX_GROUP == 0 && !AppendFrameCheckpoint(frame, offset)) {
+        return false;
+    }
+    frame->separators++;
+    return true;
+}
+
+/**
+ * @brief Counts the top-level strings, numbers and literals starting in part of a block.
+ *
+ * @param builder The build state.
+ * @param starts Bit i set when a value other than an object or array starts at byte i.
+ * @param offset Document offset of the block.
+ * @return true if successful, false if out of memory.
+ */
+static bool CountTopLevelScalars(Builder* builder, uint64_t starts, uint64_t offset) {
+    while (starts) {
+        unsigned bit = BitScanLowest(starts);
+        starts &= starts - 1;
+        if (!CountTopLevelValue(builder, offset + bit)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Opens an object or array.
+ *
+ * @param builder The build state.
+ * @param offset Offset of the opening bracket.
+ * @return true if successful, false if out of memory.
+ */
+static bool OpenContainer(Builder* builder, uint64_t offset) {
+    JsonIndex* index = builder->index;
+    BuildFrame* parent = &builder->frames[builder->frameCount - 1];
+    parent->content = true;
+
+    if (builder->frameCount == 1 && !CountTopLevelValue(builder, offset)) {
+        return false;
+    }
+
+    if (builder->frameCount == builder->frameCapacity) {
+        size_t newCapacity = builder->frameCapacity * 2;
+        BuildFrame* newFrames = (BuildFrame*)MemoryRealloc(MEMORY_TAG_JSON, builder->frames,
+                                                           newCapacity * sizeof(BuildFrame));
+        if (!newFrames) {
+            return false;
+        }
+        memset(newFrames + builder->frameCapacity, 0, (newCapacity - builder->frameCapacity) * sizeof(BuildFrame));
+        builder->frames = newFrames;
+        builder->frameCapacity = newCapacity;
+    }
+    if (index->recordCount == index->recordCapacity) {
+        size_t newCapacity = index->recordCapacity ? index->recordCapacity * 2 : 256;
+        ContainerRecord* newRecords = (ContainerRecord*)MemoryRealloc(MEMORY_TAG_JSON, index->records,
+                                                                      newCapacity * sizeof(ContainerRecord));
+        if (!newRecords) {
+            return false;
+        }
+        index->records = newRecords;
+        index->recordCapacity = newCapacity;
+    }
+
+    // The record is taken now to keep the records in order of start, and given back if the value is small
+    BuildFrame* frame = &builder->frames[builder->frameCount++];
+    frame->record = index->recordCount++;
+    frame->start = offset;
+    frame->separators = 0;
+    frame->content = false;
+    frame->checkpointCount = 0;
+    ContainerRecord* record = &index->records[frame->record];
+    record->start = offset;
+    record->firstCheckpoint = JSON_NO_CHECKPOINT;
+    record->checkpointCount = 0;
+    return true;
+}
+
+/**
+ * @brief Closes the innermost open object or array.
+ *
+ * @param builder The build state.
+ * @param end Offset past its closing bracket.
+ * @return true if successful, false if out of memory.
+ */
+static bool CloseContainer(Builder* builder, uint64_t end) {
+    JsonIndex* index = builder->index;
+    BuildFrame* frame = &builder->frames[--builder->frameCount];
+
+    // Everything recorded inside a small value is smaller still and was given back already
+    if (end - frame->start < JSON_INDEX_MIN_SPAN && frame->record == index->recordCount - 1) {
+        index->recordCount--;
+        return true;
+    }
+    ContainerRecord* record = &index->records[frame->record];
+    record->end = end;
+    record->childCount = frame->separators + (frame->content ? 1 : 0);
+    if (frame->checkpointCount > 0) {
+        if (!StoreCheckpoints(index, frame, &record->firstCheckpoint)) {
+            return false;
+        }
+        record->checkpointCount = frame->checkpointCount;
+    }
+    return true;
+}
+
+/**
+ * @brief Indexes one block of up to 64 bytes.
+ *
+ * @param builder The build state.
+ * @param block The bytes, padded with zeros to 64.
+ * @param valid Number of bytes of the block that belong to the document.
+ * @param offset Document offset of the block.
+ * @return true if successful, false if out of memory.
+ */
+static bool IndexBlock(Builder* builder, const unsigned char* block, size_t valid, uint64_t offset) {
+    // Stage one: classify the bytes
+    uint64_t quotes = 0;
+    uint64_t backslashes = 0;
+    uint64_t opens = 0;
+    uint64_t closes = 0;
+    uint64_t commas = 0;
+    uint64_t colons = 0;
+    uint64_t content = 0;
+    for (int word = 0; word < BITSCAN_BLOCK_BYTES / 8; word++) {
+        uint64_t bytes = BitScanLoadWord(block + word * 8);
+        uint64_t folded = bytes | BITSCAN_REPEAT(0x20); // '[' becomes '{' and ']' becomes '}'
+        int shift = word * 8;
+        quotes |= BitScanMatchWord(bytes, BITSCAN_REPEAT('"')) << shift;
+        backslashes |= BitScanMatchWord(bytes, BITSCAN_REPEAT('\\')) << shift;
+        opens |= BitScanMatchWord(folded, BITSCAN_REPEAT('{')) << shift;
+        closes |= BitScanMatchWord(folded, BITSCAN_REPEAT('}')) << shift;
+        commas |= BitScanMatchWord(bytes, BITSCAN_REPEAT(',')) << shift;
+        colons |= BitScanMatchWord(bytes, BITSCAN_REPEAT(':')) << shift;
+        content |= BitScanAboveSpace(bytes) << shift;
+    }
+
+    // A backslash escapes the next byte unless it is escaped itself; backslashes are rare enough to walk
+    uint64_t escaped = builder->escapeNext ? 1 : 0;
+    builder->escapeNext = false;
+    while (backslashes) {
+        unsigned bit = BitScanLowest(backslashes);
+        backslashes &= backslashes - 1;
+        if ((escaped >> bit) & 1) {
+            continue;
+        }
+        if (bit + 1 < valid) {
+            escaped |= (uint64_t)1 << (bit + 1);
+        } else {
+            builder->escapeNext = true;
+        }
+    }
+    quotes &= ~escaped;
+
+    uint64_t inString = BitScanPrefixXor(quotes) ^ (builder->inString ? ~(uint64_t)0 : 0);
+    builder->inString = (inString >> 63) != 0;
+    uint64_t structural = (opens | closes | commas) & ~inString;
+
+    // Values start where listing finds them: at an opening quote, at a colon, and after a break in unquoted bytes
+    uint64_t bare = content & ~inString & ~quotes & ~structural;
+    if (offset < builder->firstValue) {
+        bare &= ~(((uint64_t)1 << (builder->firstValue - offset)) - 1);
+    }
+    uint64_t scalars = (quotes & inString) | (bare & colons) |
+                       (bare & ~colons & ~((bare << 1) | (builder->barePending ? 1 : 0)));
+    builder->barePending = ((bare >> (valid - 1)) & 1) != 0;
+    content &= ~structural;
+
+    // Stage two: walk the structural characters in order
+    while (structural) {
+        unsigned bit = BitScanLowest(structural);
+        structural &= structural - 1;
+        BuildFrame* top = &builder->frames[builder->frameCount - 1];
+        if (builder->contentPending || (content & (((uint64_t)1 << bit) - 1))) {
+            top->content = true;
+        }
+        builder->contentPending = false;
+        content &= ~((((uint64_t)2) << bit) - 1);
+
+        uint64_t before = scalars & ((((uint64_t)1) << bit) - 1);
+        scalars &= ~before;
+        if (builder->frameCount == 1 && !CountTopLevelScalars(builder, before, offset)) {
+            return false;
+        }
+
+        uint64_t position = offset + bit;
+        unsigned char c = block[bit];
+        if (c == '{' || c == '[') {
+            if (!OpenContainer(builder, position)) {
+                return false;
+            }
+        } else if (c == '}' || c == ']') {
+            // Closing brackets outside any value are ignored
+            if (builder->frameCount > 1 && !CloseContainer(builder, position + 1)) {
+                return false;
+            }
+        } else if (builder->frameCount > 1) {
+            top->separators++;
+            if (top->separators % JSON_INDEX_GROUP == 0 && !AppendFrameCheckpoint(top, position + 1)) {
+                return false;
+            }
+        }
+    }
+    builder->contentPending = builder->contentPending || content != 0;
+    return builder->frameCount > 1 || CountTopLevelScalars(builder, scalars, offset);
+}
+
+/**
+ * @brief Releases the build state.
+ *
+ * @param builder The build state.
+ */
+static void FreeBuilder(Builder* builder) {
+    for (size_t i = 0; i < builder->frameCapacity; i++) {
+        MemoryFree(builder->frames[i].checkpoints);
+    }
+    MemoryFree(builder->frames);
+}
+
+/**
+ * @brief Builds the structural index of a document.
+ *
+ * Malformed text is indexed as far as it goes: unclosed objects and arrays
+ * run to the end of the document and stray closing brackets are ignored.
+ * The document must not change while the index is in use.
+ *
+ * @param document The document.
+ * @return The index, or NULL on failure.
+ */
+JsonIndex* JsonIndexBuild(const Document* document) {
+    if (!document) {
+        return NULL;
+    }
+    JsonIndex* index = (JsonIndex*)MemoryCalloc(MEMORY_TAG_JSON, 1, sizeof(JsonIndex));
+    Builder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.frameCapacity = 64;
+    builder.frames = (BuildFrame*)MemoryCalloc(MEMORY_TAG_JSON, builder.frameCapacity, sizeof(BuildFrame));
+    if (!index || !builder.frames) {
+        MemoryFree(builder.frames);
+        MemoryFree(index);
+        return NULL;
+    }
+    index->document = document;
+    index->topCheckpoint = JSON_NO_CHECKPOINT;
+    builder.index = index;
+    builder.frameCount = 1; // The document level
+
+    // A byte order mark starts no value
+    unsigned char mark[3];
+    if (DocumentRead(document, 0, (char*)mark, sizeof(mark)) == sizeof(mark) &&
+        mark[0] == 0xEF && mark[1] == 0xBB && mark[2] == 0xBF) {
+        builder.firstValue = sizeof(mark);
+    }
+
+    // Whole blocks are classified in place; a piece's tail is padded with zeros, which match nothing
+    DocumentIterator iterator;
+    DocumentIterInit(document, 0, &iterator);
+    const char* data;
+    size_t length;
+    uint64_t offset = 0;
+    bool ok = true;
+    unsigned char tail[BITSCAN_BLOCK_BYTES];
+    while (ok && DocumentIterNext(&iterator, &data, &length)) {
+        size_t position = 0;
+        for (; ok && position + BITSCAN_BLOCK_BYTES <= length; position += BITSCAN_BLOCK_BYTES) {
+            ok = IndexBlock(&builder, (const unsigned char*)data + position, BITSCAN_BLOCK_BYTES, offset + position);
+        }
+        if (ok && position < length) {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + position, length - position);
+            ok = IndexBlock(&builder, tail, length - position, offset + position);
+        }
+        offset += length;
+    }
+
+    // Values left open end with the document
+    while (ok && builder.frameCount > 1) {
+        ok = CloseContainer(&builder, offset);
+    }
+    if (ok) {
+        BuildFrame* top = &builder.frames[0];
+        index->topLevelCount = top->separators;
+        if (top->checkpointCount > 0) {
+            ok = StoreCheckpoints(index, top, &index->topCheckpoint);
+            index->topCheckpointCount = top->checkpointCount;
+        }
+    }
+    FreeBuilder(&builder);
+    if (!ok) {
+        JsonIndexDestroy(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**
+ * @brief Releases a structural index.
+ *
+ * @param index The index, or NULL.
+ */
+void JsonIndexDestroy(JsonIndex* index) {
+    if (!index) {
+        return;
+    }
+    MemoryFree(index->records);
+    MemoryFree(index->checkpoints);
+    MemoryFree(index);
+}
+
+/**
+ * @brief Finds the record of the object or array starting at an offset.
+ *
+ * @param index The index.
+ * @param offset Offset of the opening bracket.
+ * @return The record, or NULL if the value was too small to record.
+ */
+static const ContainerRecord* FindRecord(const JsonIndex* index, uint64_t offset) {
+    size_t low = 0;
+    size_t high = index->recordCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (index->records[middle].start < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < index->recordCount && index->records[low].start == offset ? &index->records[low] : NULL;
+}
+
+/**
+ * @brief Moves a reader to an offset.
+ *
+ * @param reader The reader.
+ * @param offset The offset.
+ */
+static void ReaderSeek(Reader* reader, uint64_t offset) {
+    uint64_t spanStart = reader->offset - reader->position;
+    if (reader->data && offset >= spanStart && offset - spanStart < reader->length) {
+        reader->position = (size_t)(offset - spanStart);
+        reader->offset = offset;
+        return;
+    }
+    DocumentIterInit(reader->document, offset, &reader->iterator);
+    reader->data = NULL;
+    reader->length = 0;
+    reader->position = 0;
+    reader->offset = offset;
+}
+
+/**
+ * @brief Starts reading a document at an offset.
+ *
+ * @param reader The reader.
+ * @param document The document.
+ * @param offset The offset.
+ */
+static void ReaderInit(Reader* reader, const Document* document, uint64_t offset) {
+    reader->document = document;
+    reader->data = NULL;
+    reader->length = 0;
+    reader->position = 0;
+    reader->offset = offset;
+    ReaderSeek(reader, offset);
+}
+
+/**
+ * @brief Gets the next byte without consuming it.
+ *
+ * @param reader The reader.
+ * @return The byte, or -1 at the end of the document.
+ */
+static int ReaderPeek(Reader* reader) {
+    while (reader->position == reader->length) {
+        if (!DocumentIterNext(&reader->iterator, &reader->data, &reader->length)) {
+            reader->data = NULL;
+            reader->length = 0;
+            reader->position = 0;
+            return -1;
+        }
+        reader->position = 0;
+    }
+    return (unsigned char)reader->data[reader->position];
+}
+
+/**
+ * @brief Consumes the byte returned by ReaderPeek.
+ *
+ * @param reader The reader.
+ */
+static void ReaderSkip(Reader* reader) {
+    reader->position++;
+    reader->offset++;
+}
+
+/**
+ * @brief Consumes white space.
+ *
+ * @param reader The reader.
+ * @return The next byte, or -1 at the end of the document.
+ */
+static int SkipSpace(Reader* reader) {
+    int c = ReaderPeek(reader);
+    while (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        ReaderSkip(reader);
+        c = ReaderPeek(reader);
+    }
+    return c;
+}
+
+/**
+ * @brief Consumes a string, from its opening quote through its closing quote.
+ *
+ * @param reader The reader, at the opening quote.
+ */
+static void SkipString(Reader* reader) {
+    ReaderSkip(reader);
+    for (int c = ReaderPeek(reader); c != -1; c = ReaderPeek(reader)) {
+        ReaderSkip(reader);
+        if (c == '"') {
+            return;
+        }
+        if (c == '\\' && ReaderPeek(reader) != -1) {
+            ReaderSkip(reader);
+        }
+    }
+}
+
+/**
+ * @brief Consumes an object or array too small to be recorded, counting its members.
+ *
+ * @param reader The reader, at the opening bracket.
+ * @return The number of members.
+ */
+static uint64_t SkipSmallContainer(Reader* reader) {
+    uint64_t separators = 0;
+    bool content = false;
+    size_t depth = 0;
+    for (int c = ReaderPeek(reader); c != -1; c = ReaderPeek(reader)) {
+        if (c == '"') {
+            content = content || depth == 1;
+            SkipString(reader);
+            continue;
+        }
+        ReaderSkip(reader);
+        if (c == '{' || c == '[') {
+            content = content || depth == 1;
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                break;
+            }
+        } else if (c == ',') {
+            separators += depth == 1;
+        } else if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            content = content || depth == 1;
+        }
+    }
+    return separators + (content ? 1 : 0);
+}
+
+/**
+ * @brief Consumes one value.
+ *
+ * @param index The index.
+ * @param reader The reader, at the first byte of the value.
+ * @param[out] node Receives the kind, range and member count of the value.
+ * @return true if a value was consumed, false at a closing bracket or the end of the document.
+ */
+static bool ParseValue(const JsonIndex* index, Reader* reader, JsonNode* node) {
+    int c = ReaderPeek(reader);
+    if (c == -1 || c == '}' || c == ']') {
+        return false;
+    }
+    node->offset = reader->offset;
+    node->childCount = 0;
+
+    if (c == '{' || c == '[') {
+        node->kind = c == '{' ? JSON_VALUE_OBJECT : JSON_VALUE_ARRAY;
+        const ContainerRecord* record = FindRecord(index, reader->offset);
+        if (record) {
+            node->childCount = record->childCount;
+            ReaderSeek(reader, record->end);
+        } else {
+            node->childCount = SkipSmallContainer(reader);
+        }
+    } else if (c == '"') {
+        node->kind = JSON_VALUE_STRING;
+        SkipString(reader);
+    } else {
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            node->kind = JSON_VALUE_NUMBER;
+        } else if (c == 't' || c == 'f' || c == 'n') {
+            node->kind = JSON_VALUE_LITERAL;
+        } else {
+            node->kind = JSON_VALUE_INVALID;
+        }
+        // At least one byte is taken so that listing always moves on
+        ReaderSkip(reader);
+        for (c = ReaderPeek(reader); c != -1; c = ReaderPeek(reader)) {
+            if (c == ',' || c == ':' || c == '}' || c == ']' || c == '{' || c == '[' || c == '"' ||
+                c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                break;
+            }
+            ReaderSkip(reader);
+        }
+    }
+    node->length = reader->offset - node->offset;
+    return true;
+}
+
+/**
+ * @brief Gets the top-level value of the document.
+ *
+ * A document of several top-level values gives a JSON_VALUE_SEQUENCE node
+ * covering the whole document, whose children are those values.
+ *
+ * @param index The index.
+ * @param[out] root Receives the value.
+ * @return true if the document holds a value, false if it is empty or blank.
+ */
+bool JsonIndexRoot(const JsonIndex* index, JsonNode* root) {
+    if (!index || !root) {
+        return false;
+    }
+    memset(root, 0, sizeof(*root));
+
+    // A byte order mark is not part of the value
+    Reader reader;
+    unsigned char mark[3];
+    bool hasMark = DocumentRead(index->document, 0, (char*)mark, sizeof(mark)) == sizeof(mark) &&
+                   mark[0] == 0xEF && mark[1] == 0xBB && mark[2] == 0xBF;
+    ReaderInit(&reader, index->document, hasMark ? sizeof(mark) : 0);
+    if (SkipSpace(&reader) == -1) {
+        return false;
+    }
+
+    uint64_t first = reader.offset;
+    if (ParseValue(index, &reader, root) && SkipSpace(&reader) == -1) {
+        return true;
+    }
+    root->kind = JSON_VALUE_SEQUENCE;
+    root->offset = first;
+    root->length = DocumentLength(index->document) - first;
+    root->childCount = index->topLevelCount;
+    return true;
+}
+
+/**
+ * @brief Lists children of an object, array or sequence.
+ *
+ * @param index The index.
+ * @param parent The parent node.
+ * @param first Position of the first child listed.
+ * @param[out] children Receives the children.
+ * @param maxChildren Capacity of children.
+ * @return Number of children listed; fewer than maxChildren at the end of the parent.
+ */
+size_t JsonIndexChildren(const JsonIndex* index, const JsonNode* parent, uint64_t first, JsonNode* children,
+                         size_t maxChildren) {
+    if (!index || !parent || !children || maxChildren == 0) {
+        return 0;
+    }
+
+    // Start at the recorded member offset nearest before the first child wanted
+    uint64_t start;
+    uint64_t checkpoint = JSON_NO_CHECKPOINT;
+    uint64_t checkpointCount = 0;
+    bool sequence = parent->kind == JSON_VALUE_SEQUENCE;
+    if (sequence) {
+        start = parent->offset;
+        checkpoint = index->topCheckpoint;
+        checkpointCount = index->topCheckpointCount;
+    } else if (parent->kind == JSON_VALUE_OBJECT || parent->kind == JSON_VALUE_ARRAY) {
+        start = parent->offset + 1;
+        const ContainerRecord* record = FindRecord(index, parent->offset);
+        if (record) {
+            checkpoint = record->firstCheckpoint;
+            checkpointCount = record->checkpointCount;
+        }
+    } else {
+        return 0;
+    }
+    uint64_t skip = first;
+    uint64_t group = first / JSON_INDEX_GROUP;
+    if (group > checkpointCount) {
+        group = checkpointCount;
+    }
+    if (group > 0) {
+        start = index->checkpoints[checkpoint + group - 1];
+        skip -= group * JSON_INDEX_GROUP;
+    }
+
+    Reader reader;
+    ReaderInit(&reader, index->document, start);
+    uint64_t end = parent->offset + parent->length;
+    size_t listed = 0;
+    while (listed < maxChildren) {
+        int c = SkipSpace(&reader);
+        if (c == -1 || reader.offset >= end) {
+            break;
+        }
+        if (sequence && (c == ',' || c == '}' || c == ']')) {
+            ReaderSkip(&reader); // Stray between top-level values
+            continue;
+        }
+
+        JsonNode node;
+        memset(&node, 0, sizeof(node));
+        if (parent->kind == JSON_VALUE_OBJECT && c == '"') {
+            node.keyOffset = reader.offset;
+            SkipString(&reader);
+            node.keyLength = reader.offset - node.keyOffset;
+            if (SkipSpace(&reader) == ':') {
+                ReaderSkip(&reader);
+            }
+            SkipSpace(&reader);
+        }
+        if (!ParseValue(index, &reader, &node)) {
+            break;
+        }
+        if (skip > 0) {
+            skip--;
+        } else {
+            children[listed++] = node;
+        }
+        if (!sequence && SkipSpace(&reader) == ',') {
+            ReaderSkip(&reader);
+        }
+    }
+    return listed;
+}
+
+/**
+ * @brief Adds text to the formatted output.
+ *
+ * @param writer The output.
+ * @param text The text.
+ * @param length Length of the text.
+ */
+static void WriterPut(FormatWriter* writer, const char* text, size_t length) {
+    while (length > 0 && !writer->failed) {
+        if (writer->length == JSON_FORMAT_BUFFER) {
+            writer->failed = !writer->write(writer->buffer, writer->length, writer->context);
+            writer->length = 0;
+            continue;
+        }
+        size_t part = JSON_FORMAT_BUFFER - writer->length;
+        if (part > length) {
+            part = length;
+        }
+        memcpy(writer->buffer + writer->length, text, part);
+        writer->length += part;
+        text += part;
+        length -= part;
+    }
+}
+
+/**
+ * @brief Starts a new line of the formatted output.
+ *
+ * @param writer The output.
+ * @param spaces Spaces before the text of the line.
+ */
+static void WriterNewLine(FormatWriter* writer, uint64_t spaces) {
+    static const char blanks[] = "                                ";
+    WriterPut(writer, "\n", 1);
+    while (spaces > 0 && !writer->failed) {
+        size_t part = spaces < sizeof(blanks) - 1 ? (size_t)spaces : sizeof(blanks) - 1;
+        WriterPut(writer, blanks, part);
+        spaces -= part;
+    }
+}
+
+/**
+ * @brief Writes one value indented.
+ *
+ * @param document The document.
+ * @param node The value.
+ * @param indent Spaces per nesting level.
+ * @param writer The output.
+ */
+static void FormatValue(const Document* document, const JsonNode* node, unsigned indent, FormatWriter* writer) {
+    DocumentIterator iterator;
+    DocumentIterInit(document, node->offset, &iterator);
+    const char* data;
+    size_t length;
+    uint64_t remaining = node->length;
+    uint64_t level = 0;
+    bool inString = false;
+    bool escape = false;
+    bool opened = false;        // An object or array was just opened; its first member starts a line
+    while (remaining > 0 && !writer->failed && DocumentIterNext(&iterator, &data, &length)) {
+        if (length > remaining) {
+            length = (size_t)remaining;
+        }
+        remaining -= length;
+
+        // Runs of string bytes are copied at once
+        size_t position = 0;
+        while (position < length && !writer->failed) {
+            if (inString) {
+                size_t run = position;
+                while (run < length) {
+                    char c = data[run++];
+                    if (escape) {
+                        escape = false;
+                    } else if (c == '\\') {
+                        escape = true;
+                    } else if (c == '"') {
+                        inString = false;
+                        break;
+                    }
+                }
+                WriterPut(writer, data + position, run - position);
+                position = run;
+                continue;
+            }
+
+            char c = data[position++];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                continue;
+            }
+            if (c == '}' || c == ']') {
+                if (level > 0) {
+                    level--;
+                }
+                if (!opened) {
+                    WriterNewLine(writer, level * indent);
+                }
+                opened = false;
+                WriterPut(writer, &c, 1);
+                continue;
+            }
+            if (opened) {
+                WriterNewLine(writer, level * indent);
+                opened = false;
+            }
+            if (c == '{' || c == '[') {
+                WriterPut(writer, &c, 1);
+                level++;
+                opened = true;
+            } else if (c == ',') {
+                WriterPut(writer, &c, 1);
+                WriterNewLine(writer, level * indent);
+            } else if (c == ':') {
+                WriterPut(writer, ": ", 2);
+            } else {
+                inString = c == '"';
+                WriterPut(writer, &c, 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Writes a value indented, one member or element per line.
+ *
+ * Only the bytes of the value are read; strings are copied unchanged.
+ *
+ * @param index The index.
+ * @param node The value.
+ * @param indent Spaces per nesting level.
+ * @param write Receives the text in pieces.
+ * @param context Passed to write.
+ * @return true if the whole value was written, false if write stopped it.
+ */
+bool JsonIndexFormat(const JsonIndex* index, const JsonNode* node, unsigned indent, JsonWriteCallback write,
+                     void* context) {
+    if (!index || !node || !write) {
+        return false;
+    }
+    FormatWriter* writer = (FormatWriter*)MemoryAlloc(MEMORY_TAG_JSON, sizeof(FormatWriter));
+    if (!writer) {
+        return false;
+    }
+    writer->write = write;
+    writer->context = context;
+    writer->failed = false;
+    writer->length = 0;
+
+    if (node->kind == JSON_VALUE_SEQUENCE) {
+        // Each top-level value on lines of its own
+        JsonNode batch[JSON_FORMAT_BATCH];
+        uint64_t first = 0;
+        size_t count;
+        do {
+            count = JsonIndexChildren(index, node, first, batch, JSON_FORMAT_BATCH);
+            for (size_t i = 0; i < count && !writer->failed; i++) {
+                if (first + i > 0) {
+                    WriterPut(writer, "\n", 1);
+                }
+                FormatValue(index->document, &batch[i], indent, writer);
+            }
+            first += count;
+        } while (count == JSON_FORMAT_BATCH && !writer->failed);
+    } else {
+        FormatValue(index->document, node, indent, writer);
+    }
+
+    if (!writer->failed && writer->length > 0) {
+        writer->failed = !write(writer->buffer, writer->length, context);
+    }
+    bool result = !writer->failed;
+    MemoryFree(writer);
+    return result;
+}
@@ -0,0 +1,562 @@
+/**
+ * @file jsonoutline.c
+ * @brief JSON outline window implementation for the Professional Text Editor
+ *
+ * The window hosts a tree view control. Every item carries the node it
+ * stands for; children are inserted the first time an item is expanded,
+ * and items are freed as the control deletes them.
+ */
+
+#include "../include/jsonoutline.h"
+#include "../include/jsonindex.h"
+#include "../include/control.h"
+#include "../include/diffview.h"
+#include <commctrl.h> // Required for the tree view
+
+// Initial size of the outline window in pixels
+#define JSON_OUTLINE_WIDTH 420
+#define JSON_OUTLINE_HEIGHT 700
+
+// Longest member name and value shown in an item, in bytes
+#define JSON_OUTLINE_NAME_MAX 48
+#define JSON_OUTLINE_VALUE_MAX 64
+
+// Largest formatted value opened in a window
+#define JSON_OUTLINE_FORMAT_MAX ((size_t)64 << 20)
+
+// Spaces per level of a formatted value
+#define JSON_OUTLINE_INDENT 2
+
+// Lines shown above the member the caret is moved to
+#define JSON_OUTLINE_CONTEXT_LINES 3
+
+// Node behind a tree item
+typedef struct {
+    JsonNode node;              // The value, or the parent of the group
+    uint64_t position;          // Position of the value among its parent's children
+    bool group;                 // The item stands for children first..first+count-1 of node
+    uint64_t first;
+    uint64_t count;
+} OutlineItem;
+
+// State of one outline window
+typedef struct {
+    HWND hEdit;                 // Editor view whose document is outlined
+    Document* document;
+    JsonIndex* index;           // NULL once the document changed
+    HWND hTree;
+} JsonOutline;
+
+// Formatted value being collected
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+} FormatBuffer;
+
+/**
+ * @brief Copies document bytes for an item label, replacing control characters.
+ *
+ * @param document The document.
+ * @param offset Start of the bytes.
+ * @param length Number of bytes.
+ * @param limit Most bytes copied; longer text is cut and ends with "...".
+ * @param[out] buffer Receives the text, NUL-terminated; at least limit + 4 bytes.
+ */
+static void CopyLabelText(const Document* document, uint64_t offset, uint64_t length, size_t limit, char* buffer) {
+    size_t count = length < limit ? (size_t)length : limit;
+    count = DocumentRead(document, offset, buffer, count);
+    for (size_t i = 0; i < count; i++) {
+        if ((unsigned char)buffer[i] < 0x20) {
+            buffer[i] = ' ';
+        }
+    }
+    if (length > limit) {
+        memcpy(buffer + count, "...", 3);
+        count += 3;
+    }
+    buffer[count] = '\0';
+}
+
+/**
+ * @brief Writes the label of a tree item.
+ *
+ * @param outline The outline.
+ * @param item The item.
+ * @param showPosition TRUE to start elements of arrays and sequences with their position.
+ * @param[out] label Receives the label.
+ * @param size Size of label.
+ */
+static void FormatLabel(const JsonOutline* outline, const OutlineItem* item, BOOL showPosition, char* label,
+                        size_t size) {
+    const JsonNode* node = &item->node;
+    if (item->group) {
+        sprintf_s(label, size, "[%llu - %llu]", (unsigned long long)item->first,
+                  (unsigned long long)(item->first + item->count - 1));
+        return;
+    }
+
+    char name[JSON_OUTLINE_NAME_MAX + 8] = "";
+    if (node->keyLength > 0) {
+        CopyLabelText(outline->document, node->keyOffset, node->keyLength, JSON_OUTLINE_NAME_MAX, name);
+        strcat_s(name, sizeof(name), ": ");
+    } else if (showPosition) {
+        sprintf_s(name, sizeof(name), "[%llu] ", (unsigned long long)item->position);
+    }
+
+    char value[JSON_OUTLINE_VALUE_MAX + 4];
+    unsigned long long count = (unsigned long long)node->childCount;
+    switch (node->kind) {
+        case JSON_VALUE_OBJECT:
+            sprintf_s(label, size, "%s{...} %llu %s", name, count, count == 1 ? "member" : "members");
+            break;
+        case JSON_VALUE_ARRAY:
+            sprintf_s(label, size, "%s[...] %llu %s", name, count, count == 1 ? "item" : "items");
+            break;
+        case JSON_VALUE_SEQUENCE:
+            sprintf_s(label, size, "%llu %s", count, count == 1 ? "value" : "values");
+            break;
+        default:
+            CopyLabelText(outline->document, node->offset, node->length, JSON_OUTLINE_VALUE_MAX, value);
+            sprintf_s(label, size, "%s%s", name, value);
+            break;
+    }
+}
+
+/**
+ * @brief Adds an item to the tree.
+ *
+ * @param outline The outline.
+ * @param hParent Parent item, or TVI_ROOT.
+ * @param item The item; ownership is transferred to the tree.
+ * @param showPosition TRUE to start the label with the position of the value.
+ * @return Handle to the new item, or NULL on failure (the item is then freed).
+ */
+static HTREEITEM InsertItem(JsonOutline* outline, HTREEITEM hParent, OutlineItem* item, BOOL showPosition) {
+    char label[JSON_OUTLINE_NAME_MAX + JSON_OUTLINE_VALUE_MAX + 64];
+    FormatLabel(outline, item, showPosition, label, sizeof(label));
+
+    TVINSERTSTRUCT insert;
+    ZeroMemory(&insert, sizeof(insert));
+    insert.hParent = hParent;
+    insert.hInsertAfter = TVI_LAST;
+    insert.item.mask = TVIF_TEXT | TVIF_PARAM | TVIF_CHILDREN;
+    insert.item.pszText = label;
+    insert.item.lParam = (LPARAM)item;
+    insert.item.cChildren = item->group || item->node.childCount > 0 ? 1 : 0;
+    HTREEITEM hItem = TreeView_InsertItem(outline->hTree, &insert);
+    if (!hItem) {
+        free(item);
+    }
+    return hItem;
+}
+
+/**
+ * @brief Adds an item without a node, showing a message.
+ *
+ * @param outline The outline.
+ * @param message The message.
+ */
+static void InsertMessage(JsonOutline* outline, const char* message) {
+    TVINSERTSTRUCT insert;
+    ZeroMemory(&insert, sizeof(insert));
+    insert.hParent = TVI_ROOT;
+    insert.hInsertAfter = TVI_LAST;
+    insert.item.mask = TVIF_TEXT | TVIF_PARAM;
+    insert.item.pszText = (LPSTR)message;
+    insert.item.lParam = 0;
+    (void)TreeView_InsertItem(outline->hTree, &insert);
+}
+
+/**
+ * @brief Gets the node behind a tree item.
+ *
+ * @param hTree Handle to the tree view.
+ * @param hItem The item.
+ * @return The node, or NULL for message items.
+ */
+static OutlineItem* GetItem(HWND hTree, HTREEITEM hItem) {
+    if (!hItem) {
+        return NULL;
+    }
+    TVITEM tvi;
+    ZeroMemory(&tvi, sizeof(tvi));
+    tvi.mask = TVIF_PARAM;
+    tvi.hItem = hItem;
+    return TreeView_GetItem(hTree, &tvi) ? (OutlineItem*)tvi.lParam : NULL;
+}
+
+/**
+ * @brief Inserts the children of an item the first time it is expanded.
+ *
+ * More than JSON_INDEX_GROUP children are split into groups of a power of
+ * JSON_INDEX_GROUP children, so no item ever gets more than that many.
+ *
+ * @param outline The outline.
+ * @param hItem The item.
+ * @param item The node behind the item.
+ */
+static void InsertChildren(JsonOutline* outline, HTREEITEM hItem, const OutlineItem* item) {
+    if (!outline->index || TreeView_GetChild(outline->hTree, hItem)) {
+        return;
+    }
+    uint64_t first = item->group ? item->first : 0;
+    uint64_t count = item->group ? item->count : item->node.childCount;
+
+    if (count > JSON_INDEX_GROUP) {
+        uint64_t groupSize = JSON_INDEX_GROUP;
+        while ((count + groupSize - 1) / groupSize > JSON_INDEX_GROUP) {
+            groupSize *= JSON_INDEX_GROUP;
+        }
+        for (uint64_t start = 0; start < count; start += groupSize) {
+            OutlineItem* group = (OutlineItem*)calloc(1, sizeof(OutlineItem));
+            if (!group) {
+                return;
+            }
+            group->node = item->node;
+            group->group = true;
+            group->first = first + start;
+            group->count = count - start < groupSize ? count - start : groupSize;
+            if (!InsertItem(outline, hItem, group, FALSE)) {
+                return;
+            }
+        }
+        return;
+    }
+
+    JsonNode* children = (JsonNode*)malloc((size_t)(count > 0 ? count : 1) * sizeof(JsonNode));
+    if (!children) {
+        return;
+    }
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    size_t listed = JsonIndexChildren(outline->index, &item->node, first, children, (size_t)count);
+    SetCursor(oldCursor);
+    for (size_t i = 0; i < listed; i++) {
+        OutlineItem* child = (OutlineItem*)calloc(1, sizeof(OutlineItem));
+        if (!child) {
+            break;
+        }
+        child->node = children[i];
+        child->position = first + i;
+        if (!InsertItem(outline, hItem, child, TRUE)) {
+            break;
+        }
+    }
+    free(children);
+}
+
+/**
+ * @brief Moves the caret of the editor view to the start of a member.
+ *
+ * @param outline The outline.
+ * @param item The node of the member.
+ */
+static void JumpToItem(const JsonOutline* outline, const OutlineItem* item) {
+    if (!outline->index || item->group) {
+        return;
+    }
+    uint64_t offset = item->node.keyLength > 0 ? item->node.keyOffset : item->node.offset;
+    uint64_t line = DocumentLineFromOffset(outline->document, offset);
+    DocumentViewState viewState;
+    viewState.selectionStart = offset;
+    viewState.selectionEnd = offset;
+    viewState.firstVisibleLine = line > JSON_OUTLINE_CONTEXT_LINES ? line - JSON_OUTLINE_CONTEXT_LINES : 0;
+    SetEditorViewState(outline->hEdit, &viewState);
+}
+
+/**
+ * @brief Appends formatted text to the buffer, up to JSON_OUTLINE_FORMAT_MAX bytes.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param context The buffer.
+ * @return true to continue, false when the buffer is full or out of memory.
+ */
+static bool CollectFormatted(const char* text, size_t length, void* context) {
+    FormatBuffer* buffer = (FormatBuffer*)context;
+    if (length > JSON_OUTLINE_FORMAT_MAX - buffer->length) {
+        return false;
+    }
+    if (buffer->length + length > buffer->capacity) {
+        size_t newCapacity = buffer->capacity ? buffer->capacity * 2 : 65536;
+        while (newCapacity < buffer->length + length) {
+            newCapacity *= 2;
+        }
+        char* newText = (char*)realloc(buffer->text, newCapacity);
+        if (!newText) {
+            return false;
+        }
+        buffer->text = newText;
+        buffer->capacity = newCapacity;
+    }
+    memcpy(buffer->text + buffer->length, text, length);
+    buffer->length += length;
+    return true;
+}
+
+/**
+ * @brief Opens the value of an item formatted in a read-only window.
+ *
+ * @param hWnd Handle to the outline window.
+ * @param outline The outline.
+ * @param item The node of the value.
+ */
+static void OpenFormatted(HWND hWnd, JsonOutline* outline, const OutlineItem* item) {
+    if (!outline->index || item->group) {
+        return;
+    }
+    FormatBuffer buffer;
+    ZeroMemory(&buffer, sizeof(buffer));
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    BOOL formatted = JsonIndexFormat(outline->index, &item->node, JSON_OUTLINE_INDENT, CollectFormatted, &buffer);
+    SetCursor(oldCursor);
+    if (!formatted) {
+        free(buffer.text);
+        MessageBox(hWnd, "The value is too large to format.", "Outline", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    char label[JSON_OUTLINE_NAME_MAX + JSON_OUTLINE_VALUE_MAX + 64];
+    char title[sizeof(label) + 16];
+    FormatLabel(outline, item, TRUE, label, sizeof(label));
+    sprintf_s(title, sizeof(title), "Formatted - %s", label);
+    Document* document = DocumentCreateFromText(buffer.text, buffer.length);
+    free(buffer.text);
+    if (!document || !ShowDiffWindow(GetWindow(hWnd, GW_OWNER), (HINSTANCE)GetWindowLongPtr(hWnd, GWLP_HINSTANCE),
+                                      title, document)) {
+        MessageBox(hWnd, "Failed to show the formatted value.", "Error", MB_OK | MB_ICONERROR);
+    }
+}
+
+/**
+ * @brief Stops following the document after it changed.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes.
+ * @param changeCount Number of changes.
+ * @param context Handle to the outline window.
+ */
+static void OutlineDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                   void* context) {
+    (void)document;
+    (void)changes;
+    (void)changeCount;
+    JsonOutline* outline = (JsonOutline*)GetWindowLongPtr((HWND)context, GWLP_USERDATA);
+    if (!outline || !outline->index) {
+        return;
+    }
+    // Offsets of the index no longer match the text
+    JsonIndexDestroy(outline->index);
+    outline->index = NULL;
+    TreeView_DeleteAllItems(outline->hTree);
+    InsertMessage(outline, "The document changed. Press F5 to refresh the outline.");
+}
+
+/**
+ * @brief Indexes the document and shows its top-level value.
+ *
+ * @param outline The outline.
+ */
+static void RefreshOutline(JsonOutline* outline) {
+    // Without an index, deleting the selected item moves no caret
+    JsonIndexDestroy(outline->index);
+    outline->index = NULL;
+    TreeView_DeleteAllItems(outline->hTree);
+
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    outline->index = JsonIndexBuild(outline->document);
+    SetCursor(oldCursor);
+    if (!outline->index) {
+        InsertMessage(outline, "Not enough memory to index the document.");
+        return;
+    }
+
+    OutlineItem* root = (OutlineItem*)calloc(1, sizeof(OutlineItem));
+    if (!root) {
+        return;
+    }
+    if (!JsonIndexRoot(outline->index, &root->node)) {
+        free(root);
+        InsertMessage(outline, "The document holds no JSON value.");
+        return;
+    }
+    HTREEITEM hRoot = InsertItem(outline, TVI_ROOT, root, FALSE);
+    if (hRoot) {
+        TreeView_Expand(outline->hTree, hRoot, TVE_EXPAND);
+    }
+}
+
+/**
+ * @brief Handles a notification of the tree view.
+ *
+ * @param hWnd Handle to the outline window.
+ * @param outline The outline.
+ * @param header The notification.
+ * @return TRUE to prevent the default handling, FALSE otherwise.
+ */
+static LRESULT HandleTreeNotify(HWND hWnd, JsonOutline* outline, const NMHDR* header) {
+    switch (header->code) {
+        case TVN_ITEMEXPANDING: {
+            const NMTREEVIEW* notify = (const NMTREEVIEW*)header;
+            const OutlineItem* item = (const OutlineItem*)notify->itemNew.lParam;
+            if (notify->action == TVE_EXPAND && item) {
+                InsertChildren(outline, notify->itemNew.hItem, item);
+            }
+            return FALSE;
+        }
+
+        case TVN_DELETEITEM:
+            free((OutlineItem*)((const NMTREEVIEW*)header)->itemOld.lParam);
+            return FALSE;
+
+        case TVN_SELCHANGED: {
+            const OutlineItem* item = (const OutlineItem*)((const NMTREEVIEW*)header)->itemNew.lParam;
+            if (item) {
+                JumpToItem(outline, item);
+            }
+            return FALSE;
+        }
+
+        case TVN_KEYDOWN: {
+            const NMTVKEYDOWN* key = (const NMTVKEYDOWN*)header;
+            if (key->wVKey == VK_F5) {
+                RefreshOutline(outline);
+            } else if (key->wVKey == VK_RETURN) {
+                const OutlineItem* item = GetItem(outline->hTree, TreeView_GetSelection(outline->hTree));
+                if (item) {
+                    OpenFormatted(hWnd, outline, item);
+                }
+            }
+            return FALSE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Window procedure of the outline window.
+ *
+ * @param hWnd Handle to the window.
+ * @param message The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing.
+ */
+static LRESULT CALLBACK JsonOutlineProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    JsonOutline* outline = (JsonOutline*)GetWindowLongPtr(hWnd, GWLP_USERDATA);
+
+    switch (message) {
+        case WM_CREATE: {
+            CREATESTRUCT* create = (CREATESTRUCT*)lParam;
+            outline = (JsonOutline*)calloc(1, sizeof(JsonOutline));
+            if (!outline) {
+                return -1;
+            }
+            outline->hTree = CreateWindowEx(0, WC_TREEVIEW, NULL,
+                                            WS_CHILD | WS_VISIBLE | TVS_HASBUTTONS | TVS_HASLINES |
+                                            TVS_LINESATROOT | TVS_SHOWSELALWAYS,
+                                            0, 0, 0, 0, hWnd, NULL, create->hInstance, NULL);
+            if (!outline->hTree) {
+                free(outline);
+                return -1;
+            }
+            SetWindowLongPtr(hWnd, GWLP_USERDATA, (LONG_PTR)outline);
+            return 0;
+        }
+
+        case WM_DESTROY:
+            if (outline) {
+                // Items are freed as the tree deletes them, which needs the state
+                TreeView_DeleteAllItems(outline->hTree);
+                if (outline->document) {
+                    DocumentRemoveListener(outline->document, OutlineDocumentChanged, (void*)hWnd);
+                }
+                JsonIndexDestroy(outline->index);
+                SetWindowLongPtr(hWnd, GWLP_USERDATA, 0);
+                free(outline);
+            }
+            return 0;
+
+        case WM_SIZE:
+            if (outline) {
+                MoveWindow(outline->hTree, 0, 0, LOWORD(lParam), HIWORD(lParam), TRUE);
+            }
+            return 0;
+
+        case WM_SETFOCUS:
+            if (outline) {
+                SetFocus(outline->hTree);
+            }
+            return 0;
+
+        case WM_NOTIFY:
+            if (outline && ((const NMHDR*)lParam)->hwndFrom == outline->hTree) {
+                return HandleTreeNotify(hWnd, outline, (const NMHDR*)lParam);
+            }
+            break;
+    }
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+/**
+ * @brief Opens a window with the outline of the document of an editor view.
+ *
+ * The outline stops following the document when it changes; F5 builds it
+ * again. The window must be destroyed before the editor view replaces or
+ * destroys its document.
+ *
+ * @param hOwner Handle to the owner window.
+ * @param hInstance Handle to the application instance.
+ * @param hEdit Handle to the editor view.
+ * @return Handle to the window, or NULL if it could not be created.
+ */
+HWND ShowJsonOutline(HWND hOwner, HINSTANCE hInstance, HWND hEdit) {
+    Document* document = GetEditorDocument(hEdit);
+    if (!document) {
+        return NULL;
+    }
+
+    static BOOL registered = FALSE;
+    if (!registered) {
+        WNDCLASSEX wcex;
+        ZeroMemory(&wcex, sizeof(wcex));
+        wcex.cbSize = sizeof(WNDCLASSEX);
+        wcex.lpfnWndProc = JsonOutlineProc;
+        wcex.hInstance = hInstance;
+        wcex.hCursor = LoadCursor(NULL, IDC_ARROW);
+        wcex.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
+        wcex.lpszClassName = JSON_OUTLINE_CLASS_NAME;
+        if (!RegisterClassEx(&wcex)) {
+            return NULL;
+        }
+        registered = TRUE;
+    }
+
+    HWND hWnd = CreateWindowEx(
+        WS_EX_TOOLWINDOW,
+        JSON_OUTLINE_CLASS_NAME,
+        "Outline",
+        WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT, CW_USEDEFAULT, JSON_OUTLINE_WIDTH, JSON_OUTLINE_HEIGHT,
+        hOwner,
+        NULL,
+        hInstance,
+        NULL
+    );
+    if (!hWnd) {
+        return NULL;
+    }
+
+    JsonOutline* outline = (JsonOutline*)GetWindowLongPtr(hWnd, GWLP_USERDATA);
+    outline->hEdit = hEdit;
+    if (!DocumentAddListener(document, OutlineDocumentChanged, (void*)hWnd)) {
+        DestroyWindow(hWnd);
+        return NULL;
+    }
+    outline->document = document;
+    RefreshOutline(outline);
+
+    ShowWindow(hWnd, SW_SHOW);
+    UpdateWindow(hWnd);
+    return hWnd;
+}
@@ -0,0 +1,695 @@
+/**
+ * @file layout.c
+ * @brief Column layout implementation for the Professional Text Editor
+ *
+ * Contains the tab-aware column arithmetic over document lines and the
+ * segment summaries kept for long lines.
+ */
+
+#include "../include/layout.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Lines at least this long are laid out through segment summaries
+#define LAYOUT_LONG_LINE (64 * 1024)
+
+// Bytes per segment when a long line is measured
+#define LAYOUT_SEGMENT_SIZE (16 * 1024)
+
+// Bytes after which text measured again after an edit is split into
+// segments; larger than the segment size so that typing inside a segment
+// does not change the segment count
+#define LAYOUT_SEGMENT_SPLIT (4 * LAYOUT_SEGMENT_SIZE)
+
+// Long lines whose segments a cache keeps
+#define LAYOUT_CACHED_LINES 8
+
+// Columns spanned by a run of a line. Past the first tab the columns do not
+// depend on where the run starts, since that tab ends on a tab stop.
+typedef struct {
+    uint64_t offset;        // Offset of the segment from the line start
+    uint64_t column;        // Column at which the segment starts
+    uint32_t length;        // Bytes covered
+    uint32_t prefix;        // Columns before the first tab, or of the whole segment without tabs
+    uint32_t suffix;        // Columns after the first tab, counted from its tab stop
+    bool hasTab;
+} LayoutSegment;
+
+// Growable list of segments
+typedef struct {
+    LayoutSegment* items;
+    size_t count;
+    size_t capacity;
+} SegmentList;
+
+// Segments of one long line, measured from its start
+typedef struct {
+    bool used;
+    bool stale;                 // Offsets and columns of the segments need recomputing
+    uint64_t lineStart;
+    uint64_t length;            // Bytes of line content
+    uint64_t measured;          // Bytes from the line start covered by the segments
+    uint64_t lastUse;
+    SegmentList segments;
+} LayoutLine;
+
+struct LayoutCache {
+    Document* document;
+    LayoutLine lines[LAYOUT_CACHED_LINES];
+    uint64_t useClock;
+    LayoutCache* next;
+};
+
+// Caches of the open documents
+static LayoutCache* g_layoutCaches = NULL;
+
+/**
+ * @brief Gets the column reached after displaying a character.
+ *
+ * @param column Column at which the character starts.
+ * @param c The character.
+ * @return Column just past the character.
+ */
+static uint64_t AdvanceColumn(uint64_t column, char c) {
+    if (c == '\t') {
+        return column + LAYOUT_TAB_WIDTH - (column % LAYOUT_TAB_WIDTH);
+    }
+    return column + 1;
+}
+
+/**
+ * @brief Gets the column at which a segment ends.
+ *
+ * @param segment The segment.
+ * @param column Column at which the segment starts.
+ * @return Column just past the segment.
+ */
+static uint64_t SegmentEndColumn(const LayoutSegment* segment, uint64_t column) {
+    if (segment->hasTab) {
+        return AdvanceColumn(column + segment->prefix, '\t') + segment->suffix;
+    }
+    return column + segment->prefix;
+}
+
+/**
+ * @brief Adds an empty segment to a list.
+ *
+ * @param list The list.
+ * @return The segment, or NULL on allocation failure.
+ */
+static LayoutSegment* AddSegment(SegmentList* list) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        LayoutSegment* items = (LayoutSegment*)MemoryRealloc(MEMORY_TAG_LAYOUT, list->items,
+                                                             capacity * sizeof(LayoutSegment));
+        if (!items) {
+            return NULL;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    LayoutSegment* segment = &list->items[list->count++];
+    memset(segment, 0, sizeof(*segment));
+    return segment;
+}
+
+/**
+ * @brief Measures a range of line content and appends its segments to a list.
+ *
+ * Ranges up to LAYOUT_SEGMENT_SPLIT bytes become one segment, longer ones
+ * are split every LAYOUT_SEGMENT_SIZE bytes.
+ *
+ * @param document The document.
+ * @param list The list.
+ * @param start Offset of the range.
+ * @param length Length of the range.
+ * @return true if successful, false on allocation failure or if the range holds a line break.
+ */
+static bool AppendSegments(const Document* document, SegmentList* list, uint64_t start, uint64_t length) {
+    DocumentIterator iterator;
+    DocumentIterInit(document, start, &iterator);
+
+    uint64_t segmentLength = length > LAYOUT_SEGMENT_SPLIT ? LAYOUT_SEGMENT_SIZE : length;
+    LayoutSegment* segment = NULL;
+    const char* span;
+    size_t spanLength;
+    while (length > 0 && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t i = 0;
+        while (i < spanLength && length > 0) {
+            if (!segment || segment->length == segmentLength) {
+                segment = AddSegment(list);
+                if (!segment) {
+                    return false;
+                }
+            }
+            size_t take = spanLength - i;
+            if (take > length) {
+                take = (size_t)length;
+            }
+            if (take > segmentLength - segment->length) {
+                take = (size_t)(segmentLength - segment->length);
+            }
+            if (memchr(span + i, '\n', take)) {
+                return false;
+            }
+            for (size_t end = i + take; i < end; i++) {
+                if (segment->hasTab) {
+                    segment->suffix = (uint32_t)AdvanceColumn(segment->suffix, span[i]);
+                } else if (span[i] == '\t') {
+                    segment->hasTab = true;
+                } else {
+                    segment->prefix++;
+                }
+            }
+            segment->length += (uint32_t)take;
+            length -= take;
+        }
+    }
+    return length == 0;
+}
+
+/**
+ * @brief Computes the offsets and columns of segments from those of the segment before them.
+ *
+ * @param line The line.
+ * @param first First segment to compute.
+ */
+static void UpdatePositions(LayoutLine* line, size_t first) {
+    LayoutSegment* items = line->segments.items;
+    for (size_t i = first; i < line->segments.count; i++) {
+        if (i == 0) {
+            items[i].offset = 0;
+            items[i].column = 0;
+        } else {
+            items[i].offset = items[i - 1].offset + items[i - 1].length;
+            items[i].column = SegmentEndColumn(&items[i - 1], items[i - 1].column);
+        }
+    }
+}
+
+/**
+ * @brief Gets the column at which the measured part of a line ends.
+ *
+ * @param line The line, with up to date positions.
+ * @return The column.
+ */
+static uint64_t MeasuredColumn(const LayoutLine* line) {
+    if (line->segments.count == 0) {
+        return 0;
+    }
+    const LayoutSegment* last = &line->segments.items[line->segments.count - 1];
+    return SegmentEndColumn(last, last->column);
+}
+
+/**
+ * @brief Forgets the segments of a line.
+ *
+ * @param line The line.
+ */
+static void DropLine(LayoutLine* line) {
+    MemoryFree(line->segments.items);
+    memset(line, 0, sizeof(*line));
+}
+
+/**
+ * @brief Finds the layout cache of a document.
+ *
+ * @param document The document.
+ * @return The cache, or NULL if the document has none.
+ */
+static LayoutCache* FindCache(const Document* document) {
+    for (LayoutCache* cache = g_layoutCaches; cache; cache = cache->next) {
+        if (cache->document == document) {
+            return cache;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Gets the segments of a long line, starting them if the line is not cached.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @return The line, or NULL if it is short or the document has no cache.
+ */
+static LayoutLine* GetLine(const Document* document, uint64_t lineStart, uint64_t lineEnd) {
+    if (lineEnd < lineStart || lineEnd - lineStart < LAYOUT_LONG_LINE) {
+        return NULL;
+    }
+    LayoutCache* cache = FindCache(document);
+    if (!cache) {
+        return NULL;
+    }
+
+    // A cached line matching start and length is the same line; otherwise the least recently used one goes
+    LayoutLine* line = NULL;
+    LayoutLine* oldest = &cache->lines[0];
+    for (size_t i = 0; i < LAYOUT_CACHED_LINES; i++) {
+        LayoutLine* candidate = &cache->lines[i];
+        if (candidate->used && candidate->lineStart == lineStart && candidate->length == lineEnd - lineStart) {
+            line = candidate;
+            break;
+        }
+        if (!candidate->used || (oldest->used && candidate->lastUse < oldest->lastUse)) {
+            oldest = candidate;
+        }
+    }
+    if (!line) {
+        line = oldest;
+        DropLine(line);
+        line->used = true;
+        line->lineStart = lineStart;
+        line->length = lineEnd - lineStart;
+    }
+    if (line->stale) {
+        UpdatePositions(line, 0);
+        line->stale = false;
+    }
+    line->lastUse = ++cache->useClock;
+    return line;
+}
+
+/**
+ * @brief Measures a line from the end of its segments until they reach an offset or a column.
+ *
+ * @param document The document.
+ * @param line The line, with up to date positions.
+ * @param offset Offset from the line start the segments have to cover.
+ * @param column Column the segments have to pass.
+ * @return true if successful, false if the line had to be dropped.
+ */
+static bool ExtendLine(const Document* document, LayoutLine* line, uint64_t offset, uint64_t column) {
+    SegmentList* segments = &line->segments;
+    while (line->measured < line->length && line->measured <= offset && MeasuredColumn(line) <= column) {
+        // A short last segment, left by typing at the end of the line, is measured again with what follows
+        size_t first = segments->count;
+        uint64_t start = line->measured;
+        if (first > 0 && segments->items[first - 1].length < LAYOUT_SEGMENT_SIZE) {
+            first--;
+            start -= segments->items[first].length;
+            segments->count = first;
+        }
+        uint64_t length = line->length - start < LAYOUT_SEGMENT_SIZE ? line->length - start : LAYOUT_SEGMENT_SIZE;
+        if (!AppendSegments(document, segments, line->lineStart + start, length)) {
+            DropLine(line);
+            return false;
+        }
+        line->measured = start + length;
+        UpdatePositions(line, first);
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the segment holding an offset.
+ *
+ * @param line The line; its segments cover the offset or end at it.
+ * @param offset Offset from the line start.
+ * @return The last segment starting at or before the offset.
+ */
+static const LayoutSegment* SegmentAtOffset(const LayoutLine* line, uint64_t offset) {
+    const LayoutSegment* items = line->segments.items;
+    size_t low = 0;
+    size_t high = line->segments.count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (items[middle].offset <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return &items[low];
+}
+
+/**
+ * @brief Finds the segment holding a column.
+ *
+ * @param line The line; its segments pass the column or end the line.
+ * @param column The column.
+ * @return The last segment starting at or before the column.
+ */
+static const LayoutSegment* SegmentAtColumn(const LayoutLine* line, uint64_t column) {
+    const LayoutSegment* items = line->segments.items;
+    size_t low = 0;
+    size_t high = line->segments.count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (items[middle].column <= column) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return &items[low];
+}
+
+/**
+ * @brief Measures the changed segments of a line again and keeps the others.
+ *
+ * Changes reaching past the measured part cut the segments before them;
+ * changes in the unmeasured part need nothing.
+ *
+ * @param document The document, already changed.
+ * @param line The line.
+ * @param changes Changes inside the line content, in pre-change coordinates.
+ * @param changeCount Number of changes.
+ * @param lineStart Offset of the line start after the changes.
+ * @return true if successful, false if the line has to be dropped.
+ */
+static bool UpdateSegments(const Document* document, LayoutLine* line, const DocumentChange* changes,
+                           size_t changeCount, uint64_t lineStart) {
+    const SegmentList* segments = &line->segments;
+    SegmentList updated = { 0 };
+    uint64_t oldStart = line->lineStart;
+    uint64_t measured = line->measured;
+    uint64_t segmentStart = 0;
+    size_t segment = 0;
+    size_t next = 0;
+    int64_t shift = 0;
+    bool cut = false;
+
+    while (next < changeCount && !cut && changes[next].offset - oldStart < measured) {
+        uint64_t changeStart = changes[next].offset - oldStart;
+        while (segmentStart + segments->items[segment].length <= changeStart) {
+            LayoutSegment* kept = AddSegment(&updated);
+            if (!kept) {
+                MemoryFree(updated.items);
+                return false;
+            }
+            *kept = segments->items[segment];
+            segmentStart += segments->items[segment++].length;
+        }
+
+        // The region grows over the segments the changes reach
+        uint64_t regionStart = segmentStart;
+        uint64_t regionEnd = segmentStart + segments->items[segment++].length;
+        int64_t regionShift = 0;
+        while (next < changeCount && changes[next].offset - oldStart < regionEnd) {
+            uint64_t removeEnd = changes[next].offset + changes[next].removedLength - oldStart;
+            if (removeEnd > measured) {
+                cut = true;
+                break;
+            }
+            while (removeEnd > regionEnd) {
+                regionEnd += segments->items[segment++].length;
+            }
+            regionShift += (int64_t)changes[next].insertedLength - (int64_t)changes[next].removedLength;
+            next++;
+        }
+        if (cut) {
+            measured = (uint64_t)((int64_t)regionStart + shift);
+            break;
+        }
+
+        uint64_t newStart = (uint64_t)((int64_t)regionStart + shift);
+        uint64_t newLength = (uint64_t)((int64_t)(regionEnd - regionStart) + regionShift);
+        if (!AppendSegments(document, &updated, lineStart + newStart, newLength)) {
+            MemoryFree(updated.items);
+            return false;
+        }
+        shift += regionShift;
+        segmentStart = regionEnd;
+    }
+    if (!cut) {
+        for (; segment < segments->count; segment++) {
+            LayoutSegment* kept = AddSegment(&updated);
+            if (!kept) {
+                MemoryFree(updated.items);
+                return false;
+            }
+            *kept = segments->items[segment];
+        }
+        measured = (uint64_t)((int64_t)measured + shift);
+    }
+
+    MemoryFree(line->segments.items);
+    line->segments = updated;
+    line->measured = measured;
+    line->stale = true;
+    return true;
+}
+
+/**
+ * @brief Applies reported changes to the segments of a cached line.
+ *
+ * @param document The document, already changed.
+ * @param line The line.
+ * @param changes The changes in pre-change coordinates.
+ * @param changeCount Number of changes.
+ * @return true if successful, false if the line has to be dropped.
+ */
+static bool UpdateLine(const Document* document, LayoutLine* line, const DocumentChange* changes,
+                       size_t changeCount) {
+    uint64_t start = line->lineStart;
+    uint64_t end = start + line->length;
+    int64_t before = 0;
+    int64_t inside = 0;
+    size_t first = changeCount;
+    size_t last = 0;
+    for (size_t i = 0; i < changeCount && changes[i].offset <= end; i++) {
+        uint64_t removeEnd = changes[i].offset + changes[i].removedLength;
+        int64_t delta = (int64_t)changes[i].insertedLength - (int64_t)changes[i].removedLength;
+        if (changes[i].offset < start) {
+            if (removeEnd >= start) {
+                return false; // Joins the line with the one before
+            }
+            before += delta;
+            continue;
+        }
+        if (removeEnd > end) {
+            return false; // Removes the line break
+        }
+        first = first < i ? first : i;
+        last = i + 1;
+        inside += delta;
+    }
+
+    uint64_t lineStart = (uint64_t)((int64_t)start + before);
+    if (first < last && !UpdateSegments(document, line, changes + first, last - first, lineStart)) {
+        return false;
+    }
+    line->lineStart = lineStart;
+    line->length = (uint64_t)((int64_t)line->length + inside);
+    return line->length >= LAYOUT_LONG_LINE;
+}
+
+/**
+ * @brief Document listener keeping the cached lines in step with edits.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes, or NULL if unknown.
+ * @param changeCount Number of changes.
+ * @param context The cache.
+ */
+static void LayoutDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                  void* context) {
+    LayoutCache* cache = (LayoutCache*)context;
+    for (size_t i = 0; i < LAYOUT_CACHED_LINES; i++) {
+        LayoutLine* line = &cache->lines[i];
+        if (line->used && (!changes || changeCount == 0 || !UpdateLine(document, line, changes, changeCount))) {
+            DropLine(line);
+        }
+    }
+}
+
+/**
+ * @brief Creates the layout cache of a document.
+ *
+ * The cache registers itself as a document listener; it has to be created
+ * before any listener that lays out text when the document changes. The
+ * layout functions use it for the long lines of the document. Layout runs
+ * on the thread owning the views of the document.
+ *
+ * @param document The document; it must outlive the cache.
+ * @return The cache, or NULL on allocation failure.
+ */
+LayoutCache* LayoutCacheCreate(Document* document) {
+    LayoutCache* cache = (LayoutCache*)MemoryCalloc(MEMORY_TAG_LAYOUT, 1, sizeof(LayoutCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->document = document;
+    if (!DocumentAddListener(document, LayoutDocumentChanged, cache)) {
+        MemoryFree(cache);
+        return NULL;
+    }
+    cache->next = g_layoutCaches;
+    g_layoutCaches = cache;
+    return cache;
+}
+
+/**
+ * @brief Destroys a layout cache and unregisters it from its document.
+ *
+ * @param cache The cache. NULL is ignored.
+ */
+void LayoutCacheDestroy(LayoutCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    DocumentRemoveListener(cache->document, LayoutDocumentChanged, cache);
+    for (LayoutCache** link = &g_layoutCaches; *link; link = &(*link)->next) {
+        if (*link == cache) {
+            *link = cache->next;
+            break;
+        }
+    }
+    for (size_t i = 0; i < LAYOUT_CACHED_LINES; i++) {
+        DropLine(&cache->lines[i]);
+    }
+    MemoryFree(cache);
+}
+
+/**
+ * @brief Gets the column of an offset by reading from a known position.
+ *
+ * @param document The document.
+ * @param from Offset at which reading starts.
+ * @param column Column of that offset.
+ * @param offset Offset whose column is wanted, at or after from.
+ * @return The column.
+ */
+static uint64_t ScanColumn(const Document* document, uint64_t from, uint64_t column, uint64_t offset) {
+    DocumentIterator iterator;
+    DocumentIterInit(document, from, &iterator);
+
+    uint64_t remaining = offset - from;
+    const char* span;
+    size_t spanLength;
+    while (remaining > 0 && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t take = spanLength < remaining ? spanLength : (size_t)remaining;
+        for (size_t i = 0; i < take; i++) {
+            column = AdvanceColumn(column, span[i]);
+        }
+        remaining -= take;
+    }
+    return column;
+}
+
+/**
+ * @brief Gets the display column of an offset within its line.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param offset Offset within the line.
+ * @return Zero-based display column.
+ */
+uint64_t LayoutColumnFromOffset(const Document* document, uint64_t lineStart, uint64_t offset) {
+    if (offset <= lineStart) {
+        return 0;
+    }
+
+    // Offsets near the line start are read directly; the line end is only looked up further in
+    if (offset - lineStart > LAYOUT_SEGMENT_SIZE && FindCache(document)) {
+        uint64_t lineEnd = DocumentLineEnd(document, DocumentLineFromOffset(document, lineStart));
+        LayoutLine* line = offset <= lineEnd ? GetLine(document, lineStart, lineEnd) : NULL;
+        if (line && ExtendLine(document, line, offset - lineStart, UINT64_MAX)) {
+            const LayoutSegment* segment = SegmentAtOffset(line, offset - lineStart);
+            return ScanColumn(document, lineStart + segment->offset, segment->column, offset);
+        }
+    }
+    return ScanColumn(document, lineStart, 0, offset);
+}
+
+/**
+ * @brief Gets the offset displayed at or just before a column.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @param column Zero-based display column.
+ * @return Offset of the character covering the column, or lineEnd past the end.
+ */
+uint64_t LayoutOffsetFromColumn(const Document* document, uint64_t lineStart, uint64_t lineEnd, uint64_t column) {
+    uint64_t offset = lineStart;
+    uint64_t current = 0;
+    LayoutLine* line = GetLine(document, lineStart, lineEnd);
+    if (line && ExtendLine(document, line, UINT64_MAX, column)) {
+        const LayoutSegment* segment = SegmentAtColumn(line, column);
+        offset += segment->offset;
+        current = segment->column;
+    }
+
+    DocumentIterator iterator;
+    DocumentIterInit(document, offset, &iterator);
+    const char* span;
+    size_t spanLength;
+    while (offset < lineEnd && DocumentIterNext(&iterator, &span, &spanLength)) {
+        for (size_t i = 0; i < spanLength && offset < lineEnd; i++) {
+            uint64_t next = AdvanceColumn(current, span[i]);
+            // Round to the nearer edge of a wide (tab) character
+            if (next > column) {
+                return (column - current <= next - column) ? offset : offset + 1;
+            }
+            current = next;
+            offset++;
+        }
+    }
+    return offset;
+}
+
+/**
+ * @brief Renders the visible columns of a line into display cells.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @param firstColumn First display column to render.
+ * @param[out] cells Receives one character per column.
+ * @param maxCells Capacity of cells.
+ * @return Number of cells filled.
+ */
+size_t LayoutVisibleText(const Document* document, uint64_t lineStart, uint64_t lineEnd,
+                         uint64_t firstColumn, char* cells, size_t maxCells) {
+    uint64_t offset = lineStart;
+    uint64_t column = 0;
+    LayoutLine* line = GetLine(document, lineStart, lineEnd);
+    if (line && ExtendLine(document, line, UINT64_MAX, firstColumn)) {
+        const LayoutSegment* segment = SegmentAtColumn(line, firstColumn);
+        offset += segment->offset;
+        column = segment->column;
+    }
+
+    DocumentIterator iterator;
+    DocumentIterInit(document, offset, &iterator);
+    uint64_t lastColumn = firstColumn + maxCells;
+    size_t filled = 0;
+    const char* span;
+    size_t spanLength;
+    while (offset < lineEnd && column < lastColumn && DocumentIterNext(&iterator, &span, &spanLength)) {
+        for (size_t i = 0; i < spanLength && offset < lineEnd && column < lastColumn; i++, offset++) {
+            char c = span[i];
+            uint64_t next = AdvanceColumn(column, c);
+            char shown = (c == '\t') ? ' ' : ((unsigned char)c < 0x20 ? '?' : c);
+            for (uint64_t col = column; col < next && col < lastColumn; col++) {
+                if (col >= firstColumn) {
+                    cells[filled++] = shown;
+                }
+            }
+            column = next;
+        }
+    }
+    return filled;
+}
+
+/**
+ * @brief Gets the width of a line for sizing a scroll range.
+ *
+ * @param document The document.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @return The width in columns, exact unless the line is long and not measured to its end.
+ */
+uint64_t LayoutLineWidth(const Document* document, uint64_t lineStart, uint64_t lineEnd) {
+    LayoutLine* line = GetLine(document, lineStart, lineEnd);
+    if (!line) {
+        return LayoutColumnFromOffset(document, lineStart, lineEnd);
+    }
+    return MeasuredColumn(line) + (line->length - line->measured);
+}
@@ -0,0 +1,723 @@
+/**
+ * @file linefilter.c
+ * @brief Matching-line filter implementation for the Professional Text Editor
+ *
+ * Contains the chunked list of matching line starts, the parallel build
+ * over the mapped file and the update after an edit. An update copies the
+ * chunk headers into a new list, moving the chunks between the edited
+ * regions by the length difference of the changes before them; only the
+ * chunks holding touched lines are rewritten, and a chunk that would fit
+ * into the one before it is merged, so edits do not leave the list in
+ * small pieces.
+ */
+
+#include "../include/linefilter.h"
+#include "../include/memory.h"
+#include "../include/search.h"
+#include "../include/thread.h"
+#include <string.h>
+
+// Line starts kept in one chunk at most
+#define FILTER_CHUNK_CAPACITY 1024
+
+// Line starts allocated for a new chunk
+#define FILTER_CHUNK_INITIAL 16
+
+// Smallest part of the file given to a build thread
+#define FILTER_BUILD_MIN_PART (1024 * 1024)
+
+// Most threads used by a build
+#define FILTER_BUILD_MAX_THREADS 64
+
+// Run of matching line starts, stored relative to the first of them
+typedef struct {
+    uint64_t base;          // Offset the starts are relative to
+    uint64_t firstRow;      // Matching lines in the chunks before
+    uint32_t* starts;       // Line starts minus base, ascending
+    uint32_t count;
+    uint32_t capacity;
+} FilterChunk;
+
+// Growable list of chunks; no chunk is empty
+typedef struct {
+    FilterChunk* items;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} ChunkList;
+
+struct LineFilter {
+    const Document* document;
+    char pattern[SEARCH_MAX_PATTERN];
+    size_t patternLength;
+    bool matchCase;
+    unsigned threadCount;
+    ChunkList chunks;
+    uint64_t count;         // Matching lines
+};
+
+// Part of the mapped file scanned by one build thread
+typedef struct {
+    const LineFilter* filter;
+    const char* text;
+    size_t length;
+    uint64_t offset;        // Offset of the part in the document
+    ChunkList chunks;
+} BuildPart;
+
+// Lines scanned again after a run of changes that touch the same lines
+typedef struct {
+    uint64_t oldStart;      // Start of the first line, before the changes
+    uint64_t oldEnd;        // End of the last line and its line break, before the changes
+    uint64_t newStart;      // The same lines after the changes
+    uint64_t newEnd;
+    int64_t shift;          // Length difference of the changes up to the end of the region
+} FilterRegion;
+
+// Scan of document text appending the lines that match
+typedef struct {
+    const Document* document;
+    ChunkList* chunks;
+    uint64_t nextLine;      // Start of the line after the last matching one; matches before it are skipped
+} DocumentScan;
+
+// Check that the original runs of a document cover it in order
+typedef struct {
+    uint64_t next;
+    bool unmodified;
+} OriginalCheck;
+
+/**
+ * @brief Releases the chunks of a list and empties it.
+ *
+ * @param list The list.
+ */
+static void ChunkListFree(ChunkList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        MemoryFree(list->items[i].starts);
+    }
+    MemoryFree(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+/**
+ * @brief Adds an empty chunk at the end of a list.
+ *
+ * @param list The list.
+ * @param base Offset the starts of the chunk are relative to.
+ * @return The chunk, or NULL on allocation failure.
+ */
+static FilterChunk* ChunkListPush(ChunkList* list, uint64_t base) {
+    if (list->count == list->capacity) {
+        size_t newCapacity = list->capacity ? list->capacity * 2 : 16;
+        FilterChunk* newItems = (FilterChunk*)MemoryRealloc(MEMORY_TAG_FILTER, list->items,
+                                                            newCapacity * sizeof(FilterChunk));
+        if (!newItems) {
+            list->failed = true;
+            return NULL;
+        }
+        list->items = newItems;
+        list->capacity = newCapacity;
+    }
+
+    FilterChunk* chunk = &list->items[list->count++];
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->base = base;
+    return chunk;
+}
+
+/**
+ * @brief Appends a line start after the last one of a list.
+ *
+ * @param list The list.
+ * @param offset The line start.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ChunkListAppend(ChunkList* list, uint64_t offset) {
+    if (list->failed) {
+        return false;
+    }
+    FilterChunk* chunk = list->count ? &list->items[list->count - 1] : NULL;
+    if (!chunk || chunk->count == FILTER_CHUNK_CAPACITY || offset - chunk->base > UINT32_MAX) {
+        chunk = ChunkListPush(list, offset);
+        if (!chunk) {
+            return false;
+        }
+    }
+    if (chunk->count == chunk->capacity) {
+        uint32_t newCapacity = chunk->capacity ? chunk->capacity * 2 : FILTER_CHUNK_INITIAL;
+        newCapacity = newCapacity < FILTER_CHUNK_CAPACITY ? newCapacity : FILTER_CHUNK_CAPACITY;
+        uint32_t* newStarts = (uint32_t*)MemoryRealloc(MEMORY_TAG_FILTER, chunk->starts,
+                                                       newCapacity * sizeof(uint32_t));
+        if (!newStarts) {
+            list->failed = true;
+            return false;
+        }
+        chunk->starts = newStarts;
+        chunk->capacity = newCapacity;
+    }
+    chunk->starts[chunk->count++] = (uint32_t)(offset - chunk->base);
+    return true;
+}
+
+/**
+ * @brief Moves a whole chunk of another list to the end of a list.
+ *
+ * A chunk that fits into the last chunk of the list is copied into it;
+ * otherwise only its header moves. Either way the source chunk no longer
+ * owns its starts.
+ *
+ * @param list The list.
+ * @param chunk The chunk.
+ * @param shift Amount added to every start of the chunk.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ChunkListMove(ChunkList* list, FilterChunk* chunk, int64_t shift) {
+    uint64_t base = (uint64_t)((int64_t)chunk->base + shift);
+    const FilterChunk* last = list->count ? &list->items[list->count - 1] : NULL;
+    if (last && last->count + chunk->count <= FILTER_CHUNK_CAPACITY &&
+        base + chunk->starts[chunk->count - 1] - last->base <= UINT32_MAX) {
+        for (uint32_t i = 0; i < chunk->count; i++) {
+            if (!ChunkListAppend(list, base + chunk->starts[i])) {
+                return false;
+            }
+        }
+        MemoryFree(chunk->starts);
+    } else {
+        FilterChunk* moved = ChunkListPush(list, base);
+        if (!moved) {
+            return false;
+        }
+        moved->starts = chunk->starts;
+        moved->count = chunk->count;
+        moved->capacity = chunk->capacity;
+    }
+    chunk->starts = NULL;
+    return true;
+}
+
+/**
+ * @brief Numbers the rows of the chunks and counts the matching lines.
+ *
+ * @param filter The filter.
+ */
+static void CountRows(LineFilter* filter) {
+    uint64_t row = 0;
+    for (size_t i = 0; i < filter->chunks.count; i++) {
+        filter->chunks.items[i].firstRow = row;
+        row += filter->chunks.items[i].count;
+    }
+    filter->count = row;
+}
+
+/**
+ * @brief Appends the lines of a buffer that contain the pattern.
+ *
+ * @param filter The filter.
+ * @param text The buffer; it starts at a line start.
+ * @param length Length of the buffer.
+ * @param offset Offset of the buffer in the document.
+ * @param chunks The list receiving the line starts.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ScanText(const LineFilter* filter, const char* text, size_t length, uint64_t offset,
+                     ChunkList* chunks) {
+    size_t position = 0; // Always a line start
+    size_t match;
+    while (position < length && SearchFindInText(text + position, length - position, filter->pattern,
+                                                 filter->patternLength, filter->matchCase, &match)) {
+        size_t hit = position + match;
+        size_t lineStart = hit;
+        while (lineStart > position && text[lineStart - 1] != '\n') {
+            lineStart--;
+        }
+        if (!ChunkListAppend(chunks, offset + lineStart)) {
+            return false;
+        }
+
+        // The rest of a matching line is not searched
+        const char* lineFeed = (const char*)memchr(text + hit, '\n', length - hit);
+        if (!lineFeed) {
+            break;
+        }
+        position = (size_t)(lineFeed - text) + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Appends the line of a match unless the line was already added.
+ *
+ * @param offset Offset of the match.
+ * @param context The scan.
+ * @return true to continue, false on allocation failure.
+ */
+static bool AddMatchingLine(uint64_t offset, void* context) {
+    DocumentScan* scan = (DocumentScan*)context;
+    if (offset < scan->nextLine) {
+        return true;
+    }
+    uint64_t line = DocumentLineFromOffset(scan->document, offset);
+    scan->nextLine = line + 1 < DocumentLineCount(scan->document) ? DocumentLineStart(scan->document, line + 1)
+                                                                   : UINT64_MAX;
+    return ChunkListAppend(scan->chunks, DocumentLineStart(scan->document, line));
+}
+
+/**
+ * @brief Appends the lines of a range of the document that contain the pattern.
+ *
+ * @param filter The filter.
+ * @param from Start of the range, at a line start.
+ * @param to End of the range, at a line start or the end of the document.
+ * @param chunks The list receiving the line starts.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ScanDocument(const LineFilter* filter, uint64_t from, uint64_t to, ChunkList* chunks) {
+    DocumentScan scan = { filter->document, chunks, 0 };
+    SearchFindAll(filter->document, filter->pattern, filter->patternLength, from, to, filter->matchCase,
+                  AddMatchingLine, &scan);
+    return !chunks->failed;
+}
+
+/**
+ * @brief Checks that the original runs of the document cover it in order.
+ */
+static bool CheckOriginalRun(uint64_t offset, uint64_t originalOffset, uint64_t length, void* context) {
+    OriginalCheck* check = (OriginalCheck*)context;
+    check->unmodified = offset == check->next && originalOffset == offset;
+    check->next += length;
+    return check->unmodified;
+}
+
+/**
+ * @brief Gets the text of the document if it is still the file it was opened from.
+ *
+ * @param document The document.
+ * @return The mapped text, or NULL if the document was edited.
+ */
+static const char* UnmodifiedText(const Document* document) {
+    uint64_t length;
+    const char* text = DocumentOriginalText(document, &length);
+    if (!text || length == 0 || length != DocumentLength(document)) {
+        return NULL;
+    }
+
+    OriginalCheck check = { 0, true };
+    DocumentForEachOriginalRun(document, CheckOriginalRun, &check);
+    return check.unmodified && check.next == length ? text : NULL;
+}
+
+/**
+ * @brief Scans one part of the mapped file. Runs on a build thread.
+ *
+ * @param context The part.
+ */
+static void ScanPart(void* context) {
+    BuildPart* part = (BuildPart*)context;
+    ScanText(part->filter, part->text, part->length, part->offset, &part->chunks);
+}
+
+/**
+ * @brief Builds the chunks of an unmodified document from its mapped text.
+ *
+ * The text is split after line breaks into one part per thread. Every
+ * thread fills its own list; the lists are joined afterwards in file order.
+ *
+ * @param filter The filter.
+ * @param text The mapped text.
+ * @param length Length of the text.
+ * @return true if successful, false on allocation failure.
+ */
+static bool BuildFromText(LineFilter* filter, const char* text, size_t length) {
+    size_t partCount = filter->threadCount ? filter->threadCount : ThreadProcessorCount();
+    if (partCount > FILTER_BUILD_MAX_THREADS) {
+        partCount = FILTER_BUILD_MAX_THREADS;
+    }
+    if (partCount > length / FILTER_BUILD_MIN_PART) {
+        partCount = length / FILTER_BUILD_MIN_PART;
+    }
+    if (partCount == 0) {
+        partCount = 1;
+    }
+
+    BuildPart* parts = (BuildPart*)MemoryCalloc(MEMORY_TAG_FILTER, partCount, sizeof(BuildPart));
+    Thread** threads = (Thread**)MemoryCalloc(MEMORY_TAG_FILTER, partCount, sizeof(Thread*));
+    if (!parts || !threads) {
+        MemoryFree(parts);
+        MemoryFree(threads);
+        return false;
+    }
+
+    size_t start = 0;
+    for (size_t p = 0; p < partCount; p++) {
+        size_t end = length;
+        if (p + 1 < partCount) {
+            end = length / partCount * (p + 1);
+            end = end < start ? start : end;
+            const char* lineFeed = (const char*)memchr(text + end, '\n', length - end);
+            end = lineFeed ? (size_t)(lineFeed - text) + 1 : length;
+        }
+        parts[p].filter = filter;
+        parts[p].text = text + start;
+        parts[p].length = end - start;
+        parts[p].offset = start;
+        start = end;
+    }
+
+    // The calling thread scans the first part; a thread that cannot be started is replaced by the caller too
+    for (size_t p = 1; p < partCount; p++) {
+        threads[p] = ThreadStart(ScanPart, &parts[p]);
+    }
+    ScanPart(&parts[0]);
+    for (size_t p = 1; p < partCount; p++) {
+        if (threads[p]) {
+            ThreadJoin(threads[p]);
+        } else {
+            ScanPart(&parts[p]);
+        }
+    }
+    MemoryFree(threads);
+
+    size_t chunkCount = 0;
+    bool success = true;
+    for (size_t p = 0; p < partCount; p++) {
+        chunkCount += parts[p].chunks.count;
+        success = success && !parts[p].chunks.failed;
+    }
+    if (success && chunkCount > 0) {
+        filter->chunks.items = (FilterChunk*)MemoryAlloc(MEMORY_TAG_FILTER, chunkCount * sizeof(FilterChunk));
+        success = filter->chunks.items != NULL;
+    }
+    if (success) {
+        // The chunks change owner; only the part lists are released
+        for (size_t p = 0; p < partCount; p++) {
+            if (parts[p].chunks.count > 0) {
+                memcpy(filter->chunks.items + filter->chunks.count, parts[p].chunks.items,
+                       parts[p].chunks.count * sizeof(FilterChunk));
+                filter->chunks.count += parts[p].chunks.count;
+            }
+            MemoryFree(parts[p].chunks.items);
+        }
+        filter->chunks.capacity = chunkCount;
+    } else {
+        for (size_t p = 0; p < partCount; p++) {
+            ChunkListFree(&parts[p].chunks);
+        }
+    }
+    MemoryFree(parts);
+    return success;
+}
+
+/**
+ * @brief Finds the matching lines of the whole document again.
+ *
+ * @param filter The filter.
+ * @return true if successful, false on allocation failure, which leaves the filter empty.
+ */
+static bool Build(LineFilter* filter) {
+    ChunkListFree(&filter->chunks);
+    uint64_t length = DocumentLength(filter->document);
+    const char* text = UnmodifiedText(filter->document);
+    bool success = text ? BuildFromText(filter, text, (size_t)length)
+                        : ScanDocument(filter, 0, length, &filter->chunks);
+    if (!success) {
+        ChunkListFree(&filter->chunks);
+    }
+    CountRows(filter);
+    return success;
+}
+
+/**
+ * @brief Finds the lines touched by each run of changes, before and after the changes.
+ *
+ * A region covers whole lines, from the line holding the start of its first
+ * change to the line holding the end of its last one. Changes reaching the
+ * lines of the region before them join it, so regions never overlap.
+ *
+ * @param document The changed document.
+ * @param changes The changes in pre-change coordinates.
+ * @param changeCount Number of changes.
+ * @param[out] regions Receives the regions; room for changeCount of them.
+ * @return Number of regions.
+ */
+static size_t FindRegions(const Document* document, const DocumentChange* changes, size_t changeCount,
+                          FilterRegion* regions) {
+    uint64_t lineCount = DocumentLineCount(document);
+    uint64_t length = DocumentLength(document);
+    size_t regionCount = 0;
+    int64_t shift = 0;
+    size_t next = 0;
+    while (next < changeCount) {
+        FilterRegion* region = &regions[regionCount++];
+        uint64_t line = DocumentLineFromOffset(document, (uint64_t)((int64_t)changes[next].offset + shift));
+        region->newStart = DocumentLineStart(document, line);
+        region->oldStart = (uint64_t)((int64_t)region->newStart - shift);
+        do {
+            shift += (int64_t)changes[next].insertedLength - (int64_t)changes[next].removedLength;
+            uint64_t changeEnd = (uint64_t)((int64_t)(changes[next].offset + changes[next].removedLength) + shift);
+            line = DocumentLineFromOffset(document, changeEnd);
+            region->newEnd = line + 1 < lineCount ? DocumentLineStart(document, line + 1) : length;
+            next++;
+        } while (next < changeCount && (uint64_t)((int64_t)changes[next].offset + shift) < region->newEnd);
+        region->oldEnd = (uint64_t)((int64_t)region->newEnd - shift);
+        region->shift = shift;
+    }
+    return regionCount;
+}
+
+/**
+ * @brief Applies reported changes to the chunks, scanning only the lines they touch.
+ *
+ * @param filter The filter.
+ * @param changes The changes in pre-change coordinates.
+ * @param changeCount Number of changes.
+ * @return true if successful, false if the filter has to be built again.
+ */
+static bool UpdateChunks(LineFilter* filter, const DocumentChange* changes, size_t changeCount) {
+    FilterRegion* regions = (FilterRegion*)MemoryAlloc(MEMORY_TAG_FILTER, changeCount * sizeof(FilterRegion));
+    if (!regions) {
+        return false;
+    }
+    size_t regionCount = FindRegions(filter->document, changes, changeCount, regions);
+
+    ChunkList* old = &filter->chunks;
+    ChunkList updated = { 0 };
+    size_t chunk = 0;       // Next old chunk
+    uint32_t entry = 0;     // Next start of that chunk
+    int64_t shift = 0;
+    bool success = true;
+    for (size_t r = 0; r <= regionCount && success; r++) {
+        uint64_t keepBefore = r < regionCount ? regions[r].oldStart : UINT64_MAX;
+
+        // The lines before the region move by the changes before it
+        while (success && chunk < old->count) {
+            FilterChunk* item = &old->items[chunk];
+            if (entry == 0 && item->base + item->starts[item->count - 1] < keepBefore) {
+                success = ChunkListMove(&updated, item, shift);
+            } else {
+                for (; success && entry < item->count && item->base + item->starts[entry] < keepBefore; entry++) {
+                    success = ChunkListAppend(&updated, (uint64_t)((int64_t)(item->base + item->starts[entry]) +
+                                                                   shift));
+                }
+                if (entry < item->count) {
+                    break;
+                }
+                MemoryFree(item->starts);
+                item->starts = NULL;
+            }
+            chunk++;
+            entry = 0;
+        }
+        if (r == regionCount || !success) {
+            break;
+        }
+
+        // The lines of the region are replaced by those that match now
+        while (chunk < old->count) {
+            FilterChunk* item = &old->items[chunk];
+            while (entry < item->count && item->base + item->starts[entry] < regions[r].oldEnd) {
+                entry++;
+            }
+            if (entry < item->count) {
+                break;
+            }
+            MemoryFree(item->starts);
+            item->starts = NULL;
+            chunk++;
+            entry = 0;
+        }
+        success = ScanDocument(filter, regions[r].newStart, regions[r].newEnd, &updated);
+        shift = regions[r].shift;
+    }
+    MemoryFree(regions);
+
+    // Chunks that moved no longer own their starts, so releasing the old list frees only what is left of it
+    ChunkListFree(old);
+    if (!success) {
+        ChunkListFree(&updated);
+        return false;
+    }
+    *old = updated;
+    CountRows(filter);
+    return true;
+}
+
+/**
+ * @brief Counts the matching lines that start before an offset.
+ *
+ * @param filter The filter.
+ * @param offset The offset.
+ * @return The number of matching line starts below the offset.
+ */
+static uint64_t RowsBefore(const LineFilter* filter, uint64_t offset) {
+    const ChunkList* chunks = &filter->chunks;
+
+    // The last chunk starting below the offset holds the answer
+    size_t low = 0;
+    size_t high = chunks->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (chunks->items[middle].base + chunks->items[middle].starts[0] < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return 0;
+    }
+
+    const FilterChunk* chunk = &chunks->items[low - 1];
+    uint32_t first = 0;
+    uint32_t last = chunk->count;
+    while (first < last) {
+        uint32_t middle = first + (last - first) / 2;
+        if (chunk->base + chunk->starts[middle] < offset) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return chunk->firstRow + first;
+}
+
+/**
+ * @brief Finds the lines of a document that contain a pattern.
+ *
+ * While the document still holds the unmodified file it was opened from,
+ * the file is split at line breaks and the parts are scanned in parallel.
+ *
+ * @param document The document; it must outlive the filter.
+ * @param pattern The text to find, without line breaks.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param threadCount Maximum number of threads, or 0 for one per processor.
+ * @return The filter, or NULL if the pattern is invalid or memory ran out.
+ */
+LineFilter* LineFilterCreate(const Document* document, const char* pattern, size_t patternLength, bool matchCase,
+                             unsigned threadCount) {
+    if (!document || !pattern || patternLength == 0 || patternLength > SEARCH_MAX_PATTERN ||
+        memchr(pattern, '\n', patternLength)) {
+        return NULL;
+    }
+
+    LineFilter* filter = (LineFilter*)MemoryCalloc(MEMORY_TAG_FILTER, 1, sizeof(LineFilter));
+    if (!filter) {
+        return NULL;
+    }
+    filter->document = document;
+    memcpy(filter->pattern, pattern, patternLength);
+    filter->patternLength = patternLength;
+    filter->matchCase = matchCase;
+    filter->threadCount = threadCount;
+    if (!Build(filter)) {
+        MemoryFree(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+/**
+ * @brief Destroys a filter.
+ *
+ * @param filter The filter. NULL is ignored.
+ */
+void LineFilterDestroy(LineFilter* filter) {
+    if (!filter) {
+        return;
+    }
+    ChunkListFree(&filter->chunks);
+    MemoryFree(filter);
+}
+
+/**
+ * @brief Updates the filter after the document changed.
+ *
+ * Only the lines touched by the changes are scanned again; unknown changes
+ * scan the whole document.
+ *
+ * @param filter The filter. NULL is ignored.
+ * @param changes The changes reported to the document listener, or NULL if unknown.
+ * @param changeCount Number of changes.
+ */
+void LineFilterMapChanges(LineFilter* filter, const DocumentChange* changes, size_t changeCount) {
+    if (!filter || (changes && changeCount == 0)) {
+        return;
+    }
+    if (!changes || !UpdateChunks(filter, changes, changeCount)) {
+        Build(filter);
+    }
+}
+
+/**
+ * @brief Gets the number of lines that contain the pattern.
+ *
+ * @param filter The filter.
+ * @return The number of matching lines, which is the number of rows of the filtered view.
+ */
+uint64_t LineFilterCount(const LineFilter* filter) {
+    return filter ? filter->count : 0;
+}
+
+/**
+ * @brief Gets the document line shown in a row of the filtered view.
+ *
+ * @param filter The filter.
+ * @param row Zero-based row; rows past the end show the last matching line.
+ * @return The line, or 0 if no line matches.
+ */
+uint64_t LineFilterLineFromRow(const LineFilter* filter, uint64_t row) {
+    if (!filter || filter->count == 0) {
+        return 0;
+    }
+    if (row >= filter->count) {
+        row = filter->count - 1;
+    }
+
+    // The last chunk whose first row is at or above the row holds it
+    const ChunkList* chunks = &filter->chunks;
+    size_t low = 0;
+    size_t high = chunks->count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (chunks->items[middle].firstRow <= row) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    const FilterChunk* chunk = &chunks->items[low];
+    return DocumentLineFromOffset(filter->document, chunk->base + chunk->starts[row - chunk->firstRow]);
+}
+
+/**
+ * @brief Gets the row of the filtered view showing a line.
+ *
+ * @param filter The filter.
+ * @param line The line; a line that does not match maps to the row of the
+ *             matching line above it, or to row 0 before the first one.
+ * @return The row.
+ */
+uint64_t LineFilterRowFromLine(const LineFilter* filter, uint64_t line) {
+    if (!filter) {
+        return 0;
+    }
+    uint64_t lineStart = DocumentLineStart(filter->document, line);
+    uint64_t through = RowsBefore(filter, lineStart + 1);
+    return through > 0 ? through - 1 : 0;
+}
+
+/**
+ * @brief Checks whether a line contains the pattern.
+ *
+ * @param filter The filter.
+ * @param line The line.
+ * @return true if the line is shown by the filtered view, false otherwise.
+ */
+bool LineFilterIsMatch(const LineFilter* filter, uint64_t line) {
+    if (!filter) {
+        return false;
+    }
+    uint64_t lineStart = DocumentLineStart(filter->document, line);
+    return RowsBefore(filter, lineStart + 1) > RowsBefore(filter, lineStart);
+}
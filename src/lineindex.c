@@ -0,0 +1,189 @@
+/**
+ * @file lineindex.c
+ * @brief Line-start index implementation for the Professional Text Editor
+ *
+ * Contains the line-feed scanner and the offset/line lookups.
+ */
+
+#include "../include/lineindex.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Typical line length used to size the first allocation
+#define LINEINDEX_EXPECTED_LINE_LENGTH 48
+
+/**
+ * @brief Ensures the index can hold at least the requested number of lines.
+ *
+ * @param index The line index.
+ * @param required Number of entries needed.
+ * @return true if successful, false on allocation failure.
+ */
+static bool LineIndexReserve(LineIndex* index, size_t required) {
+    if (required <= index->capacity) {
+        return true;
+    }
+
+    size_t newCapacity = index->capacity ? index->capacity : 64;
+    while (newCapacity < required) {
+        newCapacity += newCapacity / 2;
+    }
+
+    uint64_t* newStarts = (uint64_t*)MemoryRealloc(MEMORY_TAG_DOCUMENT, index->starts, newCapacity * sizeof(uint64_t));
+    if (!newStarts) {
+        return false;
+    }
+
+    index->starts = newStarts;
+    index->capacity = newCapacity;
+    return true;
+}
+
+/**
+ * @brief Extends a line index with text appended after the indexed range.
+ *
+ * @param index The index to extend (must already contain at least one line).
+ * @param text The appended text.
+ * @param length Length of the appended text in bytes.
+ * @param baseOffset Offset of the first appended byte in the indexed buffer.
+ * @return true if successful, false on allocation failure.
+ */
+bool LineIndexAppend(LineIndex* index, const char* text, uint64_t length, uint64_t baseOffset) {
+    if (!index || (!text && length > 0)) {
+        return false;
+    }
+
+    const char* p = text;
+    const char* end = text + length;
+    while (p < end) {
+        // memchr is vectorised by every C runtime we build against
+        const char* lf = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!lf) {
+            break;
+        }
+        if (index->count == index->capacity && !LineIndexReserve(index, index->count + 1)) {
+            return false;
+        }
+        index->starts[index->count++] = baseOffset + (uint64_t)(lf - text) + 1;
+        p = lf + 1;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Starts an index holding the first line of a buffer yet to be scanned.
+ *
+ * @param index The index to fill; any previous contents are released.
+ * @param expectedLength Length of the whole buffer, used to size the index.
+ * @return true if successful, false on allocation failure.
+ */
+bool LineIndexBegin(LineIndex* index, uint64_t expectedLength) {
+    if (!index) {
+        return false;
+    }
+
+    LineIndexFree(index);
+    if (!LineIndexReserve(index, (size_t)(expectedLength / LINEINDEX_EXPECTED_LINE_LENGTH) + 1)) {
+        return false;
+    }
+
+    index->starts[0] = 0;
+    index->count = 1;
+    return true;
+}
+
+/**
+ * @brief Builds a line index by scanning a buffer for line feeds.
+ *
+ * @param index The index to fill; any previous contents are released.
+ * @param text The text to scan.
+ * @param length Length of the text in bytes.
+ * @return true if successful, false on allocation failure.
+ */
+bool LineIndexBuild(LineIndex* index, const char* text, uint64_t length) {
+    if (!LineIndexBegin(index, length)) {
+        return false;
+    }
+    if (!LineIndexAppend(index, text, length, 0)) {
+        LineIndexFree(index);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Adopts an existing array of line starts (e.g. loaded from a cache).
+ *
+ * @param index The index to fill; any previous contents are released.
+ * @param starts Array of line starts from MemoryAlloc; ownership is transferred.
+ * @param count Number of entries in starts.
+ */
+void LineIndexAdopt(LineIndex* index, uint64_t* starts, size_t count) {
+    if (!index) {
+        return;
+    }
+    LineIndexFree(index);
+    index->starts = starts;
+    index->count = count;
+    index->capacity = count;
+}
+
+/**
+ * @brief Finds the line containing a byte offset.
+ *
+ * @param index The line index.
+ * @param offset The byte offset.
+ * @return Zero-based line number.
+ */
+size_t LineIndexLineFromOffset(const LineIndex* index, uint64_t offset) {
+    if (!index || index->count == 0) {
+        return 0;
+    }
+
+    // Binary search for the last start <= offset
+    size_t low = 0;
+    size_t high = index->count;
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (index->starts[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Counts line feeds in a half-open byte range using the index.
+ *
+ * @param index The line index.
+ * @param start Start of the range.
+ * @param end End of the range (exclusive).
+ * @return Number of line feeds in [start, end).
+ */
+size_t LineIndexCountBreaks(const LineIndex* index, uint64_t start, uint64_t end) {
+    if (!index || end <= start) {
+        return 0;
+    }
+    // A line feed at position p starts a line at p + 1
+    return LineIndexLineFromOffset(index, end) - LineIndexLineFromOffset(index, start);
+}
+
+/**
+ * @brief Releases the memory held by a line index.
+ *
+ * @param index The index to free. Safe to call on a zeroed index.
+ */
+void LineIndexFree(LineIndex* index) {
+    if (!index) {
+        return;
+    }
+    MemoryFree(index->starts);
+    index->starts = NULL;
+    index->count = 0;
+    index->capacity = 0;
+}
@@ -0,0 +1,1013 @@
+/**
+ * @file linesort.c
+ * @brief Sorting and de-duplicating lines implementation for the Professional Text Editor
+ *
+ * Contains the line scanner, the parallel in-memory sort, the run files of
+ * the external sort, the k-way merge and the construction of the sorted
+ * ranges.
+ */
+
+#include "../include/linesort.h"
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Records the buffers start with; also the fewest sorted at once whatever the memory budget
+#define LINE_SORT_MIN_RECORDS 4096
+
+// Smallest part of the records sorted by its own thread
+#define LINE_SORT_MIN_PART 16384
+
+// Most threads used to sort the records in memory
+#define LINE_SORT_MAX_THREADS 64
+
+// Most run files merged at once; more are merged in several passes
+#define LINE_SORT_MAX_RUNS 64
+
+// Records read from or written to a run file at a time
+#define LINE_SORT_FILE_RECORDS 4096
+
+// Bytes compared at a time when the lines are read from the document
+#define LINE_SORT_COMPARE_CHUNK 256
+
+// Groups this small are sorted by insertion
+#define LINE_SORT_INSERTION_LIMIT 16
+
+// Work between two calls of the progress callback
+#define LINE_SORT_PROGRESS_STEP (1024 * 1024)
+
+// Longest run file name
+#define LINE_SORT_PATH_MAX 1024
+
+// Position and prefix of one line
+typedef struct {
+    uint64_t prefix;        // First eight bytes of the content, big-endian, padded with zeros
+    uint64_t offset;        // Start of the line in the document
+    uint32_t length;        // Length of the content without the terminator
+    uint32_t terminator;    // Length of the terminator: 0, 1 (LF) or 2 (CR LF)
+} LineRecord;
+
+// State of one sort
+typedef struct {
+    const Document* document;
+    const LineSortOptions* options;
+    const char* text;       // Text of the range, or NULL to read lines from the document
+    uint64_t base;          // Document offset of text[0]
+    char* copy;             // Copy of the range owned by the sorter, or NULL
+    uint64_t done;          // Work done, in bytes scanned plus bytes merged into the result
+    uint64_t total;
+    uint64_t reported;      // Work done at the last progress report
+    bool cancelled;
+    unsigned nextRun;       // Number of the next run file
+} LineSorter;
+
+// Records sorted by one thread
+typedef struct {
+    const LineSorter* sorter;
+    LineRecord* records;
+    LineRecord* temp;
+    size_t count;
+} SortPart;
+
+// Sorted records read by the merge
+typedef struct {
+    const LineRecord* items;    // Buffered records
+    size_t count;
+    size_t position;            // Next buffered record
+    LineRecord* buffer;         // Buffer of a run file, or NULL for records in memory
+    FILE* file;                 // Run file, or NULL
+    unsigned run;               // Number of the run file
+} MergeSource;
+
+// Destination of merged records: a run file or the result ranges
+typedef struct {
+    LineSorter* sorter;
+    FILE* file;                 // Run file being written, or NULL for the result
+    LineRecord* buffer;         // Records waiting to be written to the run file
+    size_t buffered;
+    LineSortResult* result;
+    size_t capacity;            // Capacity of the result ranges
+    LineRecord last;            // Last record written
+    bool hasLast;
+    size_t placeholder;         // Range waiting for a terminator after a line that has none
+    bool pending;               // placeholder is in use
+    bool unterminated;          // The sorted range does not end with a line break
+    bool failed;
+} MergeSink;
+
+/**
+ * @brief Counts work done and reports it to the progress callback.
+ *
+ * @param sorter The sorter.
+ * @param amount Work done since the last call.
+ * @return true to continue, false if the sort was cancelled.
+ */
+static bool AdvanceProgress(LineSorter* sorter, uint64_t amount) {
+    sorter->done += amount;
+    if (sorter->options->progress && !sorter->cancelled &&
+        (sorter->done - sorter->reported >= LINE_SORT_PROGRESS_STEP || sorter->done == sorter->total)) {
+        sorter->reported = sorter->done;
+        sorter->cancelled = !sorter->options->progress(sorter->done, sorter->total, sorter->options->progressContext);
+    }
+    return !sorter->cancelled;
+}
+
+/**
+ * @brief Compares two lines by their bytes, then by their length.
+ *
+ * @param sorter The sorter.
+ * @param a First line.
+ * @param b Second line.
+ * @return Negative, zero or positive like memcmp.
+ */
+static int CompareLines(const LineSorter* sorter, const LineRecord* a, const LineRecord* b) {
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    uint32_t common = a->length < b->length ? a->length : b->length;
+    if (common > sizeof(uint64_t)) {
+        if (sorter->text) {
+            int result = memcmp(sorter->text + (a->offset - sorter->base) + sizeof(uint64_t),
+                                sorter->text + (b->offset - sorter->base) + sizeof(uint64_t),
+                                common - sizeof(uint64_t));
+            if (result != 0) {
+                return result;
+            }
+        } else {
+            char left[LINE_SORT_COMPARE_CHUNK];
+            char right[LINE_SORT_COMPARE_CHUNK];
+            for (uint32_t position = sizeof(uint64_t); position < common;) {
+                size_t length = common - position < sizeof(left) ? common - position : sizeof(left);
+                DocumentRead(sorter->document, a->offset + position, left, length);
+                DocumentRead(sorter->document, b->offset + position, right, length);
+                int result = memcmp(left, right, length);
+                if (result != 0) {
+                    return result;
+                }
+                position += (uint32_t)length;
+            }
+        }
+    }
+    return a->length < b->length ? -1 : a->length > b->length ? 1 : 0;
+}
+
+/**
+ * @brief Sorts records by their prefix with a least significant digit radix sort.
+ *
+ * Digits shared by every record are skipped. The sort is stable.
+ *
+ * @param records The records.
+ * @param temp Scratch space for count records.
+ * @param count Number of records.
+ */
+static void RadixSort(LineRecord* records, LineRecord* temp, size_t count) {
+    LineRecord* from = records;
+    LineRecord* to = temp;
+    size_t counts[256];
+    for (int shift = 0; shift < 64; shift += 8) {
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < count; i++) {
+            counts[(from[i].prefix >> shift) & 0xFF]++;
+        }
+        if (counts[(from[0].prefix >> shift) & 0xFF] == count) {
+            continue;
+        }
+        size_t sum = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t digitCount = counts[digit];
+            counts[digit] = sum;
+            sum += digitCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            to[counts[(from[i].prefix >> shift) & 0xFF]++] = from[i];
+        }
+        LineRecord* swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != records) {
+        memcpy(records, from, count * sizeof(LineRecord));
+    }
+}
+
+/**
+ * @brief Sorts records by their full content with a stable merge sort.
+ *
+ * @param sorter The sorter.
+ * @param records The records.
+ * @param temp Scratch space for count records.
+ * @param count Number of records.
+ */
+static void MergeSort(const LineSorter* sorter, LineRecord* records, LineRecord* temp, size_t count) {
+    if (count <= LINE_SORT_INSERTION_LIMIT) {
+        for (size_t i = 1; i < count; i++) {
+            LineRecord record = records[i];
+            size_t j = i;
+            while (j > 0 && CompareLines(sorter, &records[j - 1], &record) > 0) {
+                records[j] = records[j - 1];
+                j--;
+            }
+            records[j] = record;
+        }
+        return;
+    }
+
+    size_t half = count / 2;
+    MergeSort(sorter, records, temp, half);
+    MergeSort(sorter, records + half, temp, count - half);
+    if (CompareLines(sorter, &records[half - 1], &records[half]) <= 0) {
+        return; // Already in order
+    }
+
+    memcpy(temp, records, half * sizeof(LineRecord));
+    size_t left = 0;
+    size_t right = half;
+    size_t out = 0;
+    while (left < half && right < count) {
+        if (CompareLines(sorter, &records[right], &temp[left]) < 0) {
+            records[out++] = records[right++];
+        } else {
+            records[out++] = temp[left++];
+        }
+    }
+    while (left < half) {
+        records[out++] = temp[left++];
+    }
+}
+
+/**
+ * @brief Sorts the records of one part: radix on the prefixes, then merge sort of equal prefixes.
+ *
+ * @param context The part.
+ */
+static void SortPartRecords(void* context) {
+    SortPart* part = (SortPart*)context;
+    if (part->count < 2) {
+        return;
+    }
+    RadixSort(part->records, part->temp, part->count);
+
+    size_t start = 0;
+    while (start < part->count) {
+        size_t end = start + 1;
+        while (end < part->count && part->records[end].prefix == part->records[start].prefix) {
+            end++;
+        }
+        if (end - start > 1) {
+            MergeSort(part->sorter, part->records + start, part->temp, end - start);
+        }
+        start = end;
+    }
+}
+
+/**
+ * @brief Sorts records in parallel parts.
+ *
+ * @param sorter The sorter.
+ * @param records The records.
+ * @param temp Scratch space for count records.
+ * @param count Number of records.
+ * @param[out] parts Receives the sorted parts; LINE_SORT_MAX_THREADS entries.
+ * @return Number of parts.
+ */
+static size_t SortRecords(const LineSorter* sorter, LineRecord* records, LineRecord* temp, size_t count,
+                          SortPart* parts) {
+    size_t partCount = sorter->options->threadCount ? sorter->options->threadCount : ThreadProcessorCount();
+    if (partCount > LINE_SORT_MAX_THREADS) {
+        partCount = LINE_SORT_MAX_THREADS;
+    }
+    if (partCount > count / LINE_SORT_MIN_PART) {
+        partCount = count / LINE_SORT_MIN_PART;
+    }
+    if (partCount == 0) {
+        partCount = 1;
+    }
+
+    size_t start = 0;
+    for (size_t p = 0; p < partCount; p++) {
+        size_t end = p + 1 < partCount ? count / partCount * (p + 1) : count;
+        parts[p].sorter = sorter;
+        parts[p].records = records + start;
+        parts[p].temp = temp + start;
+        parts[p].count = end - start;
+        start = end;
+    }
+
+    // The calling thread sorts the first part; a thread that cannot be started is replaced by the caller too
+    Thread* threads[LINE_SORT_MAX_THREADS] = { NULL };
+    for (size_t p = 1; p < partCount; p++) {
+        threads[p] = ThreadStart(SortPartRecords, &parts[p]);
+    }
+    SortPartRecords(&parts[0]);
+    for (size_t p = 1; p < partCount; p++) {
+        if (threads[p]) {
+            ThreadJoin(threads[p]);
+        } else {
+            SortPartRecords(&parts[p]);
+        }
+    }
+    return partCount;
+}
+
+/**
+ * @brief Builds the name of a run file.
+ *
+ * @param sorter The sorter.
+ * @param run Number of the run.
+ * @param[out] path Receives the name; LINE_SORT_PATH_MAX bytes.
+ * @return true if the name fits, false otherwise.
+ */
+static bool RunPath(const LineSorter* sorter, unsigned run, char* path) {
+    int written = snprintf(path, LINE_SORT_PATH_MAX, "%s.%u", sorter->options->tempPrefix, run);
+    return written > 0 && written < LINE_SORT_PATH_MAX;
+}
+
+/**
+ * @brief Deletes a run file.
+ *
+ * @param sorter The sorter.
+ * @param run Number of the run.
+ */
+static void RemoveRun(const LineSorter* sorter, unsigned run) {
+    char path[LINE_SORT_PATH_MAX];
+    if (RunPath(sorter, run, path)) {
+        remove(path);
+    }
+}
+
+/**
+ * @brief Gets the record a source is positioned at, reading the next block of a run file if needed.
+ *
+ * @param source The source.
+ * @return The record, or NULL when the source is exhausted or cannot be read.
+ */
+static const LineRecord* SourcePeek(MergeSource* source) {
+    if (source->position == source->count && source->file) {
+        source->count = fread(source->buffer, sizeof(LineRecord), LINE_SORT_FILE_RECORDS, source->file);
+        source->position = 0;
+    }
+    return source->position < source->count ? &source->items[source->position] : NULL;
+}
+
+/**
+ * @brief Opens a run file as a merge source.
+ *
+ * @param sorter The sorter.
+ * @param run Number of the run.
+ * @param[out] source Receives the source.
+ * @return true if successful, false otherwise.
+ */
+static bool OpenRunSource(const LineSorter* sorter, unsigned run, MergeSource* source) {
+    memset(source, 0, sizeof(*source));
+    char path[LINE_SORT_PATH_MAX];
+    source->run = run;
+    source->buffer = (LineRecord*)MemoryAlloc(MEMORY_TAG_SORT, LINE_SORT_FILE_RECORDS * sizeof(LineRecord));
+    source->file = source->buffer && RunPath(sorter, run, path) ? fopen(path, "rb") : NULL;
+    if (!source->file) {
+        MemoryFree(source->buffer);
+        source->buffer = NULL;
+        return false;
+    }
+    source->items = source->buffer;
+    return true;
+}
+
+/**
+ * @brief Closes the run files of merge sources and deletes them.
+ *
+ * @param sorter The sorter.
+ * @param sources The sources.
+ * @param count Number of sources.
+ */
+static void CloseSources(const LineSorter* sorter, MergeSource* sources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (sources[i].file) {
+            fclose(sources[i].file);
+            RemoveRun(sorter, sources[i].run);
+        }
+        MemoryFree(sources[i].buffer);
+    }
+}
+
+/**
+ * @brief Appends a range to the result, joining it with the previous one when adjacent.
+ *
+ * @param sink The sink writing the result.
+ * @param offset Start of the range.
+ * @param length Length of the range.
+ */
+static void AppendRange(MergeSink* sink, uint64_t offset, uint64_t length) {
+    LineSortResult* result = sink->result;
+    if (result->count > 0 && !(sink->pending && sink->placeholder == result->count - 1)) {
+        DocumentRange* previous = &result->ranges[result->count - 1];
+        if (previous->offset + previous->length == offset) {
+            previous->length += length;
+            return;
+        }
+    }
+    if (result->count == sink->capacity) {
+        size_t newCapacity = sink->capacity ? sink->capacity * 2 : 256;
+        DocumentRange* newRanges = (DocumentRange*)MemoryRealloc(MEMORY_TAG_SORT, result->ranges,
+                                                                 newCapacity * sizeof(DocumentRange));
+        if (!newRanges) {
+            sink->failed = true;
+            return;
+        }
+        result->ranges = newRanges;
+        sink->capacity = newCapacity;
+    }
+    result->ranges[result->count].offset = offset;
+    result->ranges[result->count].length = length;
+    result->count++;
+}
+
+/**
+ * @brief Writes the buffered records of a sink to its run file.
+ *
+ * @param sink The sink.
+ */
+static void FlushSink(MergeSink* sink) {
+    if (sink->buffered > 0 && fwrite(sink->buffer, sizeof(LineRecord), sink->buffered, sink->file) != sink->buffered) {
+        sink->failed = true;
+    }
+    sink->buffered = 0;
+}
+
+/**
+ * @brief Passes one merged record to a sink.
+ *
+ * A record equal to the previous one is dropped when unique lines are requested.
+ *
+ * @param sink The sink.
+ * @param record The record.
+ */
+static void SinkPut(MergeSink* sink, const LineRecord* record) {
+    bool duplicate = sink->sorter->options->unique && sink->hasLast &&
+                     CompareLines(sink->sorter, &sink->last, record) == 0;
+    if (!sink->file || duplicate) {
+        // Lines dropped from a run file never reach the result, so they are counted here
+        AdvanceProgress(sink->sorter, (uint64_t)record->length + record->terminator);
+    }
+    if (duplicate) {
+        return;
+    }
+    sink->last = *record;
+    sink->hasLast = true;
+
+    if (sink->file) {
+        sink->buffer[sink->buffered++] = *record;
+        if (sink->buffered == LINE_SORT_FILE_RECORDS) {
+            FlushSink(sink);
+        }
+        return;
+    }
+
+    sink->result->outputLines++;
+    sink->result->length += (uint64_t)record->length + record->terminator;
+    if (record->terminator > 0) {
+        AppendRange(sink, record->offset, (uint64_t)record->length + record->terminator);
+        return;
+    }
+
+    // The line without a terminator gets the terminator of whichever line ends the result
+    AppendRange(sink, record->offset, record->length);
+    AppendRange(sink, UINT64_MAX, 0);
+    sink->placeholder = sink->result->count - 1;
+    sink->pending = !sink->failed;
+}
+
+/**
+ * @brief Completes the result so that it ends like the sorted range.
+ *
+ * @param sink The sink writing the result.
+ */
+static void FinishRanges(MergeSink* sink) {
+    LineSortResult* result = sink->result;
+    if (!sink->hasLast || sink->failed) {
+        return;
+    }
+    const LineRecord* last = &sink->last;
+    if (last->terminator == 0) {
+        // The line without a terminator came last; its placeholder is the last range
+        result->count--;
+        sink->pending = false;
+        return;
+    }
+    if (!sink->pending) {
+        if (sink->unterminated) {
+            // The line without a terminator was a duplicate; the result still ends without one
+            result->length -= last->terminator;
+            result->ranges[result->count - 1].length -= last->terminator;
+            if (result->ranges[result->count - 1].length == 0) {
+                result->count--;
+            }
+        }
+        return;
+    }
+
+    // Move the terminator of the last line to the line that had none
+    result->ranges[result->count - 1].length -= last->terminator;
+    if (result->ranges[result->count - 1].length == 0) {
+        result->count--;
+    }
+    result->ranges[sink->placeholder].offset = last->offset + last->length;
+    result->ranges[sink->placeholder].length = last->terminator;
+    sink->pending = false;
+
+    // The moved terminator may join its neighbours
+    size_t count = 0;
+    for (size_t i = 0; i < result->count; i++) {
+        if (count > 0 && result->ranges[count - 1].offset + result->ranges[count - 1].length == result->ranges[i].offset) {
+            result->ranges[count - 1].length += result->ranges[i].length;
+        } else {
+            result->ranges[count++] = result->ranges[i];
+        }
+    }
+    result->count = count;
+}
+
+/**
+ * @brief Merges sorted sources into a sink.
+ *
+ * Sources are kept in a binary heap ordered by their current record; equal
+ * records are taken from the earlier source, so the merge is stable.
+ *
+ * @param sorter The sorter.
+ * @param sources The sources, in document order.
+ * @param count Number of sources.
+ * @param sink The sink.
+ * @return true if successful, false on failure or cancellation.
+ */
+static bool MergeSources(LineSorter* sorter, MergeSource* sources, size_t count, MergeSink* sink) {
+    size_t* heap = (size_t*)MemoryAlloc(MEMORY_TAG_SORT, (count ? count : 1) * sizeof(size_t));
+    if (!heap) {
+        return false;
+    }
+    size_t heapCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (SourcePeek(&sources[i])) {
+            heap[heapCount++] = i;
+        }
+    }
+
+#define MERGE_BEFORE(x, y) \
+    (CompareLines(sorter, SourcePeek(&sources[x]), SourcePeek(&sources[y])) < 0 || \
+     (CompareLines(sorter, SourcePeek(&sources[x]), SourcePeek(&sources[y])) == 0 && (x) < (y)))
+
+    // Build the heap, then repeatedly take its top and sift the source down
+    for (size_t start = heapCount / 2; start-- > 0;) {
+        size_t node = start;
+        for (;;) {
+            size_t child = node * 2 + 1;
+            if (child >= heapCount) {
+                break;
+            }
+            if (child + 1 < heapCount && MERGE_BEFORE(heap[child + 1], heap[child])) {
+                child++;
+            }
+            if (!MERGE_BEFORE(heap[child], heap[node])) {
+                break;
+            }
+            size_t swap = heap[node];
+            heap[node] = heap[child];
+            heap[child] = swap;
+            node = child;
+        }
+    }
+    while (heapCount > 0 && !sink->failed && !sorter->cancelled) {
+        MergeSource* source = &sources[heap[0]];
+        SinkPut(sink, SourcePeek(source));
+        source->position++;
+        if (!SourcePeek(source)) {
+            heap[0] = heap[--heapCount];
+        }
+        size_t node = 0;
+        for (;;) {
+            size_t child = node * 2 + 1;
+            if (child >= heapCount) {
+                break;
+            }
+            if (child + 1 < heapCount && MERGE_BEFORE(heap[child + 1], heap[child])) {
+                child++;
+            }
+            if (!MERGE_BEFORE(heap[child], heap[node])) {
+                break;
+            }
+            size_t swap = heap[node];
+            heap[node] = heap[child];
+            heap[child] = swap;
+            node = child;
+        }
+    }
+#undef MERGE_BEFORE
+
+    MemoryFree(heap);
+    for (size_t i = 0; i < count; i++) {
+        if (sources[i].file && ferror(sources[i].file)) {
+            sink->failed = true;
+        }
+    }
+    return !sink->failed && !sorter->cancelled;
+}
+
+/**
+ * @brief Merges sources into a new run file.
+ *
+ * @param sorter The sorter.
+ * @param sources The sources, in document order.
+ * @param count Number of sources.
+ * @param[out] run Receives the number of the new run.
+ * @return true if successful, false on failure or cancellation.
+ */
+static bool MergeToRun(LineSorter* sorter, MergeSource* sources, size_t count, unsigned* run) {
+    char path[LINE_SORT_PATH_MAX];
+    *run = sorter->nextRun++;
+    MergeSink sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.sorter = sorter;
+    sink.buffer = (LineRecord*)MemoryAlloc(MEMORY_TAG_SORT, LINE_SORT_FILE_RECORDS * sizeof(LineRecord));
+    sink.file = sink.buffer && RunPath(sorter, *run, path) ? fopen(path, "wb") : NULL;
+    if (!sink.file) {
+        MemoryFree(sink.buffer);
+        return false;
+    }
+
+    bool merged = MergeSources(sorter, sources, count, &sink);
+    FlushSink(&sink);
+    merged = fclose(sink.file) == 0 && merged && !sink.failed;
+    MemoryFree(sink.buffer);
+    if (!merged) {
+        RemoveRun(sorter, *run);
+    }
+    return merged;
+}
+
+/**
+ * @brief Sorts a full buffer of records and writes it to a new run file.
+ *
+ * @param sorter The sorter.
+ * @param records The records.
+ * @param temp Scratch space for count records.
+ * @param count Number of records.
+ * @param[out] run Receives the number of the new run.
+ * @return true if successful, false on failure or cancellation.
+ */
+static bool SpillRun(LineSorter* sorter, LineRecord* records, LineRecord* temp, size_t count, unsigned* run) {
+    SortPart parts[LINE_SORT_MAX_THREADS];
+    MergeSource sources[LINE_SORT_MAX_THREADS];
+    size_t partCount = SortRecords(sorter, records, temp, count, parts);
+    memset(sources, 0, partCount * sizeof(MergeSource));
+    for (size_t p = 0; p < partCount; p++) {
+        sources[p].items = parts[p].records;
+        sources[p].count = parts[p].count;
+    }
+    return MergeToRun(sorter, sources, partCount, run);
+}
+
+/**
+ * @brief Merges run files in groups until at most LINE_SORT_MAX_RUNS remain.
+ *
+ * @param sorter The sorter.
+ * @param runs The run numbers, in document order; replaced by the merged runs.
+ * @param[in,out] runCount Number of runs.
+ * @return true if successful, false on failure or cancellation.
+ */
+static bool ReduceRuns(LineSorter* sorter, unsigned* runs, size_t* runCount) {
+    MergeSource sources[LINE_SORT_MAX_RUNS];
+    while (*runCount > LINE_SORT_MAX_RUNS) {
+        size_t merged = 0;
+        for (size_t start = 0; start < *runCount; start += LINE_SORT_MAX_RUNS) {
+            size_t count = *runCount - start < LINE_SORT_MAX_RUNS ? *runCount - start : LINE_SORT_MAX_RUNS;
+            size_t opened = 0;
+            while (opened < count && OpenRunSource(sorter, runs[start + opened], &sources[opened])) {
+                opened++;
+            }
+            bool success = opened == count && MergeToRun(sorter, sources, count, &runs[merged]);
+            CloseSources(sorter, sources, opened);
+            if (!success) {
+                // Runs not opened yet are deleted by the caller
+                for (size_t i = start + opened; i < *runCount; i++) {
+                    runs[merged++] = runs[i];
+                }
+                *runCount = merged;
+                return false;
+            }
+            merged++;
+        }
+        *runCount = merged;
+    }
+    return true;
+}
+
+// State of the scan that cuts the range into line records
+typedef struct {
+    LineSorter* sorter;
+    LineRecord* records;
+    LineRecord* temp;
+    size_t count;
+    size_t capacity;
+    size_t limit;               // Records kept in memory before a run file is written
+    unsigned* runs;             // Numbers of the run files written so far
+    size_t runCount;
+    size_t runCapacity;
+    LineRecord line;            // Line being scanned
+    uint32_t prefixBytes;       // Bytes of the line in its prefix
+    char lastByte;              // Last content byte of the line
+    bool failed;
+} LineScanner;
+
+/**
+ * @brief Doubles the record buffers, up to the limit of the scan.
+ *
+ * @param scanner The scanner; its buffers are full and below the limit.
+ * @return true if successful, false on allocation failure.
+ */
+static bool GrowRecords(LineScanner* scanner) {
+    size_t newCapacity = scanner->capacity < scanner->limit / 2 ? scanner->capacity * 2 : scanner->limit;
+    if (newCapacity > SIZE_MAX / sizeof(LineRecord)) {
+        return false;
+    }
+    LineRecord* records = (LineRecord*)MemoryRealloc(MEMORY_TAG_SORT, scanner->records,
+                                                     newCapacity * sizeof(LineRecord));
+    if (!records) {
+        return false;
+    }
+    scanner->records = records;
+
+    // The merge buffer holds nothing between sorts, so it is replaced rather than copied
+    MemoryFree(scanner->temp);
+    scanner->temp = (LineRecord*)MemoryAlloc(MEMORY_TAG_SORT, newCapacity * sizeof(LineRecord));
+    if (!scanner->temp) {
+        return false;
+    }
+    scanner->capacity = newCapacity;
+    return true;
+}
+
+/**
+ * @brief Adds the scanned line to the records, spilling a full buffer to a run file.
+ *
+ * @param scanner The scanner.
+ * @param terminator Length of the line feed ending the line, 0 or 1.
+ */
+static void FinishLine(LineScanner* scanner, uint32_t terminator) {
+    LineRecord* line = &scanner->line;
+    line->terminator = terminator;
+    if (terminator > 0 && line->length > 0 && scanner->lastByte == '\r') {
+        line->length--;
+        line->terminator++;
+        if (line->length < sizeof(uint64_t)) {
+            line->prefix &= ~((uint64_t)0xFF << (56 - 8 * line->length)); // The carriage return is not content
+        }
+    }
+
+    if (scanner->count == scanner->capacity && scanner->capacity < scanner->limit) {
+        // The buffers grow with the lines actually found, so short ranges never take the whole budget
+        if (!GrowRecords(scanner)) {
+            scanner->failed = true;
+            return;
+        }
+    } else if (scanner->count == scanner->capacity) {
+        unsigned run;
+        if (!SpillRun(scanner->sorter, scanner->records, scanner->temp, scanner->count, &run)) {
+            scanner->failed = true;
+            return;
+        }
+        if (scanner->runCount == scanner->runCapacity) {
+            size_t newCapacity = scanner->runCapacity ? scanner->runCapacity * 2 : 16;
+            unsigned* newRuns = (unsigned*)MemoryRealloc(MEMORY_TAG_SORT, scanner->runs,
+                                                         newCapacity * sizeof(unsigned));
+            if (!newRuns) {
+                RemoveRun(scanner->sorter, run);
+                scanner->failed = true;
+                return;
+            }
+            scanner->runs = newRuns;
+            scanner->runCapacity = newCapacity;
+        }
+        scanner->runs[scanner->runCount++] = run;
+        scanner->count = 0;
+    }
+    scanner->records[scanner->count++] = *line;
+}
+
+/**
+ * @brief Cuts text of the range into line records.
+ *
+ * @param scanner The scanner.
+ * @param offset Document offset of the text.
+ * @param data The text.
+ * @param length Length of the text.
+ */
+static void ScanText(LineScanner* scanner, uint64_t offset, const char* data, size_t length) {
+    LineRecord* line = &scanner->line;
+    size_t position = 0;
+    while (position < length && !scanner->failed) {
+        const char* lineFeed = (const char*)memchr(data + position, '\n', length - position);
+        size_t end = lineFeed ? (size_t)(lineFeed - data) : length;
+        size_t count = end - position;
+        if (count > 0) {
+            if ((uint64_t)line->length + count > UINT32_MAX - 2) {
+                scanner->failed = true; // A single line of 4 GB
+                return;
+            }
+            for (size_t i = 0; i < count && scanner->prefixBytes < sizeof(uint64_t); i++) {
+                line->prefix |= (uint64_t)(unsigned char)data[position + i] << (56 - 8 * scanner->prefixBytes++);
+            }
+            line->length += (uint32_t)count;
+            scanner->lastByte = data[end - 1];
+        }
+        if (!lineFeed) {
+            return;
+        }
+        FinishLine(scanner, 1);
+        position = end + 1;
+        line->prefix = 0;
+        line->offset = offset + position;
+        line->length = 0;
+        scanner->prefixBytes = 0;
+        scanner->lastByte = '\0';
+    }
+}
+
+// Search for the original run holding the whole range
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t originalOffset;
+    bool found;
+} RangeCover;
+
+/**
+ * @brief Checks whether an original run holds the whole range.
+ *
+ * @param offset Offset of the run in the document.
+ * @param originalOffset Offset of the run in the original content.
+ * @param length Length of the run.
+ * @param context The range cover.
+ * @return false once the run at the start of the range was seen, true otherwise.
+ */
+static bool FindRangeCover(uint64_t offset, uint64_t originalOffset, uint64_t length, void* context) {
+    RangeCover* cover = (RangeCover*)context;
+    if (offset > cover->offset) {
+        return false;
+    }
+    if (offset + length > cover->offset) {
+        cover->found = offset + length >= cover->offset + cover->length;
+        cover->originalOffset = originalOffset + (cover->offset - offset);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Sorts the lines of a range of a document by their bytes.
+ *
+ * The range is extended to whole lines by the caller. Lines are compared
+ * without their terminators; equal lines keep their order. A range that
+ * ends with a line break keeps it at the end, and one that does not ends
+ * without one. The document must not change until the sort returns.
+ *
+ * @param document The document.
+ * @param offset Start of the range.
+ * @param length Length of the range.
+ * @param options Parameters of the sort.
+ * @param[out] result Receives the sorted ranges; free it with LineSortResultFree.
+ * @return true if successful, false on failure or cancellation (result->cancelled tells which).
+ */
+bool LineSortRun(const Document* document, uint64_t offset, uint64_t length, const LineSortOptions* options,
+                 LineSortResult* result) {
+    if (!result) {
+        return false;
+    }
+    memset(result, 0, sizeof(*result));
+    if (!document || !options || offset > DocumentLength(document) || length > DocumentLength(document) - offset) {
+        return false;
+    }
+
+    LineSorter sorter;
+    memset(&sorter, 0, sizeof(sorter));
+    sorter.document = document;
+    sorter.options = options;
+    sorter.total = length * 2;
+    sorter.base = offset;
+
+    // Lines are compared in place when the range is still the mapped file, or in a copy that fits the budget
+    RangeCover cover;
+    memset(&cover, 0, sizeof(cover));
+    cover.offset = offset;
+    cover.length = length;
+    DocumentForEachOriginalRun(document, FindRangeCover, &cover);
+    uint64_t originalLength = 0;
+    const char* original = DocumentOriginalText(document, &originalLength);
+    if (cover.found && original) {
+        sorter.text = original + cover.originalOffset;
+    } else if (length <= options->memoryBudget) {
+        sorter.copy = DocumentCopyRange(document, offset, length);
+        sorter.text = sorter.copy;
+    }
+
+    LineScanner scanner;
+    memset(&scanner, 0, sizeof(scanner));
+    scanner.sorter = &sorter;
+    scanner.limit = options->memoryBudget / (2 * sizeof(LineRecord));
+    if (scanner.limit < LINE_SORT_MIN_RECORDS) {
+        scanner.limit = LINE_SORT_MIN_RECORDS;
+    }
+    if (!options->tempPrefix) {
+        scanner.limit = SIZE_MAX; // Without run files every line has to fit
+    }
+    scanner.capacity = LINE_SORT_MIN_RECORDS;
+    scanner.records = (LineRecord*)MemoryAlloc(MEMORY_TAG_SORT, scanner.capacity * sizeof(LineRecord));
+    scanner.temp = (LineRecord*)MemoryAlloc(MEMORY_TAG_SORT, scanner.capacity * sizeof(LineRecord));
+    scanner.failed = !scanner.records || !scanner.temp;
+    scanner.line.offset = offset;
+
+    DocumentIterator iterator;
+    DocumentIterInit(document, offset, &iterator);
+    uint64_t position = offset;
+    const char* data;
+    size_t dataLength;
+    while (!scanner.failed && position < offset + length && DocumentIterNext(&iterator, &data, &dataLength)) {
+        if (dataLength > offset + length - position) {
+            dataLength = (size_t)(offset + length - position);
+        }
+        ScanText(&scanner, position, data, dataLength);
+        position += dataLength;
+        if (!AdvanceProgress(&sorter, dataLength)) {
+            scanner.failed = true;
+        }
+    }
+    if (!scanner.failed && scanner.line.offset < offset + length) {
+        FinishLine(&scanner, 0);
+    }
+    result->inputLines = scanner.runCount * (uint64_t)scanner.limit + scanner.count;
+
+    // The last buffer stays in memory and is merged with the run files
+    bool success = !scanner.failed && ReduceRuns(&sorter, scanner.runs, &scanner.runCount);
+    SortPart parts[LINE_SORT_MAX_THREADS];
+    size_t partCount = success ? SortRecords(&sorter, scanner.records, scanner.temp, scanner.count, parts) : 0;
+    MergeSource* sources = (MergeSource*)MemoryCalloc(MEMORY_TAG_SORT, scanner.runCount + partCount + 1,
+                                                      sizeof(MergeSource));
+    size_t sourceCount = 0;
+    success = success && sources;
+    while (success && sourceCount < scanner.runCount) {
+        success = OpenRunSource(&sorter, scanner.runs[sourceCount], &sources[sourceCount]);
+        sourceCount += success ? 1 : 0;
+    }
+    for (size_t p = 0; success && p < partCount; p++) {
+        sources[sourceCount].items = parts[p].records;
+        sources[sourceCount].count = parts[p].count;
+        sourceCount++;
+    }
+
+    if (success) {
+        MergeSink sink;
+        memset(&sink, 0, sizeof(sink));
+        sink.sorter = &sorter;
+        sink.result = result;
+        sink.unterminated = scanner.line.terminator == 0 && scanner.line.offset < offset + length;
+        success = MergeSources(&sorter, sources, sourceCount, &sink);
+        FinishRanges(&sink);
+        success = success && !sink.failed;
+    }
+
+    // Run files that were never opened as sources are deleted here
+    CloseSources(&sorter, sources, sourceCount);
+    for (size_t i = sources ? sourceCount : 0; i < scanner.runCount; i++) {
+        RemoveRun(&sorter, scanner.runs[i]);
+    }
+    if (!sources) {
+        for (size_t i = 0; i < scanner.runCount; i++) {
+            RemoveRun(&sorter, scanner.runs[i]);
+        }
+    }
+    MemoryFree(sources);
+    MemoryFree(scanner.runs);
+    MemoryFree(scanner.records);
+    MemoryFree(scanner.temp);
+    free(sorter.copy);
+
+    result->cancelled = sorter.cancelled;
+    if (!success) {
+        LineSortResultFree(result);
+        result->cancelled = sorter.cancelled;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Releases the ranges of a sort result.
+ *
+ * @param result The result. Safe to call on a zeroed result.
+ */
+void LineSortResultFree(LineSortResult* result) {
+    if (!result) {
+        return;
+    }
+    MemoryFree(result->ranges);
+    memset(result, 0, sizeof(*result));
+}
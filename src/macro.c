@@ -0,0 +1,871 @@
+/**
+ * @file macro.c
+ * @brief Keyboard macro implementation for the Professional Text Editor
+ *
+ * Playing at the carets goes through the cursor set operations inside a
+ * document group. Playing on lines streams the range once, runs the
+ * bytecode on each target line in a private buffer and collects the
+ * trimmed differences into one edit batch, so the cost per line is the
+ * interpretation of the macro on that line and nothing else.
+ */
+
+#include "../include/macro.h"
+#include "../include/boundary.h"
+#include "../include/memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Operations of the bytecode
+typedef enum {
+    MACRO_OP_MOVE = 1,              // movement byte, count
+    MACRO_OP_SELECT,                // movement byte, count; extends the selections
+    MACRO_OP_INSERT,                // length, bytes
+    MACRO_OP_DELETE_BACKWARD,       // count
+    MACRO_OP_DELETE_FORWARD,        // count
+    MACRO_OP_DELETE_WORD_BACKWARD,  // count
+    MACRO_OP_DELETE_WORD_FORWARD    // count
+} MacroOp;
+
+// One decoded instruction
+typedef struct {
+    MacroOp op;
+    CursorMovement movement;
+    uint64_t count;                 // Repetitions, or the length of the inserted text
+    const char* text;               // Inserted text
+    size_t next;                    // Offset of the following instruction
+} MacroInstruction;
+
+// Text of one line while the macro runs on it
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+    size_t anchor;
+    size_t caret;
+} LineBuffer;
+
+// Edits collected by MacroRunOnLines
+typedef struct {
+    DocumentEdit* edits;
+    size_t count;
+    size_t capacity;
+    char* text;                     // Inserted text of every edit, back to back
+    size_t textLength;
+    size_t textCapacity;
+} LineEdits;
+
+/**
+ * @brief Ensures a byte array can hold a number of bytes.
+ *
+ * @param data The array.
+ * @param capacity Capacity of the array.
+ * @param required The required capacity.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ReserveBytes(char** data, size_t* capacity, size_t required) {
+    if (required <= *capacity && *data) {
+        return true;
+    }
+    size_t newCapacity = *capacity ? *capacity * 2 : 256;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    char* newData = (char*)MemoryRealloc(MEMORY_TAG_EDITING, *data, newCapacity);
+    if (!newData) {
+        return false;
+    }
+    *data = newData;
+    *capacity = newCapacity;
+    return true;
+}
+
+/**
+ * @brief Gets the number of bytes a variable-length integer takes.
+ *
+ * @param value The value.
+ * @return The encoded size.
+ */
+static size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+/**
+ * @brief Writes a variable-length integer, seven bits per byte, low bits first.
+ *
+ * @param out Destination; must have room for VarintSize(value) bytes.
+ * @param value The value.
+ * @return Number of bytes written.
+ */
+static size_t WriteVarint(uint8_t* out, uint64_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+    return size;
+}
+
+/**
+ * @brief Reads a variable-length integer.
+ *
+ * @param code The bytecode.
+ * @param length Length of the bytecode.
+ * @param[in,out] position Offset of the integer; advanced past it.
+ * @param[out] value Receives the value.
+ * @return true if successful, false if the integer is truncated.
+ */
+static bool ReadVarint(const uint8_t* code, size_t length, size_t* position, uint64_t* value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; *position < length && shift < 64; shift += 7) {
+        uint8_t byte = code[(*position)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decodes the instruction at an offset.
+ *
+ * @param macro The macro.
+ * @param position Offset of the instruction.
+ * @param[out] instruction Receives the instruction.
+ * @return true if successful, false at the end of the code or on malformed code.
+ */
+static bool DecodeInstruction(const Macro* macro, size_t position, MacroInstruction* instruction) {
+    if (position >= macro->length) {
+        return false;
+    }
+    instruction->op = (MacroOp)macro->code[position++];
+    instruction->text = NULL;
+    switch (instruction->op) {
+        case MACRO_OP_MOVE:
+        case MACRO_OP_SELECT:
+            if (position >= macro->length) {
+                return false;
+            }
+            instruction->movement = (CursorMovement)macro->code[position++];
+            break;
+        case MACRO_OP_INSERT:
+        case MACRO_OP_DELETE_BACKWARD:
+        case MACRO_OP_DELETE_FORWARD:
+        case MACRO_OP_DELETE_WORD_BACKWARD:
+        case MACRO_OP_DELETE_WORD_FORWARD:
+            break;
+        default:
+            return false;
+    }
+    if (!ReadVarint(macro->code, macro->length, &position, &instruction->count)) {
+        return false;
+    }
+    if (instruction->op == MACRO_OP_INSERT) {
+        if (instruction->count > macro->length - position) {
+            return false;
+        }
+        instruction->text = (const char*)macro->code + position;
+        position += (size_t)instruction->count;
+    }
+    instruction->next = position;
+    return true;
+}
+
+/**
+ * @brief Appends an instruction, or adds to the last one if it is the same operation.
+ *
+ * @param macro The macro.
+ * @param op The operation.
+ * @param movement The movement (moves only).
+ * @param text Text to insert (insertions only).
+ * @param length Length of the text; for other operations the count, which is 1.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AppendInstruction(Macro* macro, MacroOp op, CursorMovement movement, const char* text, size_t length) {
+    MacroInstruction last;
+    bool merge = macro->last != SIZE_MAX && DecodeInstruction(macro, macro->last, &last) && last.op == op &&
+                 (op != MACRO_OP_MOVE && op != MACRO_OP_SELECT ? true : last.movement == movement);
+    uint64_t count = merge ? last.count + length : length;
+    size_t start = merge ? macro->last : macro->length;
+    size_t header = 1 + (op == MACRO_OP_MOVE || op == MACRO_OP_SELECT ? 1 : 0) + VarintSize(count);
+    size_t keptText = merge && op == MACRO_OP_INSERT ? (size_t)last.count : 0;
+    size_t keptOffset = keptText > 0 ? (size_t)(last.text - (const char*)macro->code) : 0;
+    size_t required = start + header + (op == MACRO_OP_INSERT ? (size_t)count : 0);
+    char* code = (char*)macro->code;
+    if (!ReserveBytes(&code, &macro->capacity, required)) {
+        return false;
+    }
+    macro->code = (uint8_t*)code;
+
+    // A longer count pushes the text already recorded further back
+    uint8_t* out = macro->code + start;
+    if (keptText > 0) {
+        memmove(out + header, macro->code + keptOffset, keptText);
+    }
+    size_t position = 0;
+    out[position++] = (uint8_t)op;
+    if (op == MACRO_OP_MOVE || op == MACRO_OP_SELECT) {
+        out[position++] = (uint8_t)movement;
+    }
+    position += WriteVarint(out + position, count);
+    if (op == MACRO_OP_INSERT) {
+        memcpy(out + position + keptText, text, length);
+    }
+    macro->last = start;
+    macro->length = required;
+    return true;
+}
+
+/**
+ * @brief Initializes an empty macro.
+ *
+ * @param macro The macro.
+ */
+void MacroInit(Macro* macro) {
+    if (macro) {
+        memset(macro, 0, sizeof(Macro));
+        macro->last = SIZE_MAX;
+    }
+}
+
+/**
+ * @brief Releases the memory held by a macro.
+ *
+ * @param macro The macro.
+ */
+void MacroFree(Macro* macro) {
+    if (macro) {
+        MemoryFree(macro->code);
+        MacroInit(macro);
+    }
+}
+
+/**
+ * @brief Removes every instruction of a macro.
+ *
+ * @param macro The macro.
+ */
+void MacroClear(Macro* macro) {
+    if (macro) {
+        macro->length = 0;
+        macro->last = SIZE_MAX;
+    }
+}
+
+/**
+ * @brief Checks whether a macro has no instructions.
+ *
+ * @param macro The macro.
+ * @return true if empty, false otherwise.
+ */
+bool MacroIsEmpty(const Macro* macro) {
+    return !macro || macro->length == 0;
+}
+
+/**
+ * @brief Records a caret movement.
+ *
+ * @param macro The macro.
+ * @param movement The movement.
+ * @param extend true if the movement extended the selections.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordMove(Macro* macro, CursorMovement movement, bool extend) {
+    return macro && AppendInstruction(macro, extend ? MACRO_OP_SELECT : MACRO_OP_MOVE, movement, NULL, 1);
+}
+
+/**
+ * @brief Records text typed or inserted at the carets.
+ *
+ * @param macro The macro.
+ * @param text The text.
+ * @param length Length of the text.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordInsert(Macro* macro, const char* text, size_t length) {
+    if (!macro || (!text && length > 0)) {
+        return false;
+    }
+    return length == 0 || AppendInstruction(macro, MACRO_OP_INSERT, CURSOR_MOVE_LEFT, text, length);
+}
+
+/**
+ * @brief Records a deletion at the carets.
+ *
+ * @param macro The macro.
+ * @param forward true for a forward delete, false for backspace.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordDelete(Macro* macro, bool forward) {
+    return macro && AppendInstruction(macro, forward ? MACRO_OP_DELETE_FORWARD : MACRO_OP_DELETE_BACKWARD,
+                                      CURSOR_MOVE_LEFT, NULL, 1);
+}
+
+/**
+ * @brief Records a deletion of words at the carets.
+ *
+ * @param macro The macro.
+ * @param forward true to delete to the next word, false to the start of the previous one.
+ * @return true if successful, false on allocation failure.
+ */
+bool MacroRecordDeleteWord(Macro* macro, bool forward) {
+    return macro && AppendInstruction(macro, forward ? MACRO_OP_DELETE_WORD_FORWARD : MACRO_OP_DELETE_WORD_BACKWARD,
+                                      CURSOR_MOVE_LEFT, NULL, 1);
+}
+
+/**
+ * @brief Checks whether a movement depends on the lines around the caret.
+ *
+ * @param movement The movement.
+ * @return true for vertical movements.
+ */
+static bool IsVertical(CursorMovement movement) {
+    return movement == CURSOR_MOVE_UP || movement == CURSOR_MOVE_DOWN || movement == CURSOR_MOVE_PAGE_UP ||
+           movement == CURSOR_MOVE_PAGE_DOWN;
+}
+
+/**
+ * @brief Checks whether a macro can run on single lines.
+ *
+ * @param macro The macro.
+ * @return true if the macro has no vertical movement, false otherwise.
+ */
+bool MacroIsLineLocal(const Macro* macro) {
+    if (!macro) {
+        return false;
+    }
+    MacroInstruction instruction;
+    for (size_t position = 0; position < macro->length; position = instruction.next) {
+        if (!DecodeInstruction(macro, position, &instruction)) {
+            return false;
+        }
+        if ((instruction.op == MACRO_OP_MOVE || instruction.op == MACRO_OP_SELECT) &&
+            IsVertical(instruction.movement)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Executes one instruction at the carets.
+ *
+ * @param instruction The instruction.
+ * @param cursors The carets.
+ * @param document The document.
+ * @param pageLines Number of lines moved by page movements.
+ * @return true if successful, false if an edit failed.
+ */
+static bool ExecuteAtCursors(const MacroInstruction* instruction, CursorSet* cursors, Document* document,
+                             uint64_t pageLines) {
+    switch (instruction->op) {
+        case MACRO_OP_MOVE:
+        case MACRO_OP_SELECT:
+            for (uint64_t i = 0; i < instruction->count; i++) {
+                CursorSetMove(cursors, document, instruction->movement, instruction->op == MACRO_OP_SELECT,
+                              pageLines);
+            }
+            return true;
+        case MACRO_OP_INSERT:
+            return CursorSetInsert(cursors, document, instruction->text, (size_t)instruction->count);
+        case MACRO_OP_DELETE_BACKWARD:
+        case MACRO_OP_DELETE_FORWARD:
+        case MACRO_OP_DELETE_WORD_BACKWARD:
+        case MACRO_OP_DELETE_WORD_FORWARD:
+            for (uint64_t i = 0; i < instruction->count; i++) {
+                bool deleted;
+                switch (instruction->op) {
+                    case MACRO_OP_DELETE_FORWARD: deleted = CursorSetDeleteForward(cursors, document); break;
+                    case MACRO_OP_DELETE_WORD_BACKWARD: deleted = CursorSetDeleteWordBackward(cursors, document); break;
+                    case MACRO_OP_DELETE_WORD_FORWARD: deleted = CursorSetDeleteWordForward(cursors, document); break;
+                    default: deleted = CursorSetDeleteBackward(cursors, document); break;
+                }
+                if (!deleted) {
+                    return false;
+                }
+            }
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Plays a macro at the carets a number of times as one undo step.
+ *
+ * @param macro The macro.
+ * @param cursors The carets to play at.
+ * @param document The document to edit.
+ * @param count Number of times to play, or MACRO_UNTIL_END.
+ * @param pageLines Number of lines moved by page movements.
+ * @param[out] runs Receives the number of complete plays; may be NULL.
+ * @return true if successful, false if an edit failed.
+ */
+bool MacroRun(const Macro* macro, CursorSet* cursors, Document* document, uint64_t count, uint64_t pageLines,
+              uint64_t* runs) {
+    if (runs) {
+        *runs = 0;
+    }
+    if (!macro || !cursors || !document || cursors->count == 0) {
+        return false;
+    }
+
+    bool success = true;
+    uint64_t completed = 0;
+    DocumentBeginGroup(document);
+    while (completed < count) {
+        const Selection* primary = &cursors->items[cursors->primary];
+        uint64_t remaining = DocumentLength(document) - primary->caret;
+        if (count == MACRO_UNTIL_END && remaining == 0) {
+            break;
+        }
+
+        MacroInstruction instruction;
+        for (size_t position = 0; success && position < macro->length; position = instruction.next) {
+            success = DecodeInstruction(macro, position, &instruction) &&
+                      ExecuteAtCursors(&instruction, cursors, document, pageLines);
+        }
+        if (!success) {
+            break;
+        }
+        completed++;
+
+        primary = &cursors->items[cursors->primary];
+        if (count == MACRO_UNTIL_END && DocumentLength(document) - primary->caret >= remaining) {
+            break;
+        }
+    }
+    DocumentEndGroup(document);
+
+    if (runs) {
+        *runs = completed;
+    }
+    return success;
+}
+
+/**
+ * @brief Moves the caret of a line buffer once.
+ *
+ * Movements behave as in CursorSetMove, with the buffer as the document.
+ *
+ * @param buffer The buffer.
+ * @param movement The movement; never vertical.
+ * @param extend true to extend the selection.
+ */
+static void BufferMove(LineBuffer* buffer, CursorMovement movement, bool extend) {
+    const char* text = buffer->text;
+    size_t caret = buffer->caret;
+    if (!extend && buffer->anchor != caret && (movement == CURSOR_MOVE_LEFT || movement == CURSOR_MOVE_RIGHT)) {
+        bool left = movement == CURSOR_MOVE_LEFT;
+        buffer->caret = (buffer->anchor < caret) == left ? buffer->anchor : caret;
+        buffer->anchor = buffer->caret;
+        return;
+    }
+
+    switch (movement) {
+        case CURSOR_MOVE_LEFT:
+            caret = BoundaryTextPreviousGrapheme(text, buffer->length, caret);
+            break;
+        case CURSOR_MOVE_RIGHT:
+            caret = BoundaryTextNextGrapheme(text, buffer->length, caret);
+            break;
+        case CURSOR_MOVE_WORD_LEFT:
+            caret = BoundaryTextPreviousWord(text, buffer->length, caret);
+            break;
+        case CURSOR_MOVE_WORD_RIGHT:
+            caret = BoundaryTextNextWord(text, buffer->length, caret);
+            break;
+        case CURSOR_MOVE_LINE_START: {
+            // Typed line breaks split the buffer, so look for the line around the caret
+            size_t lineStart = caret;
+            while (lineStart > 0 && text[lineStart - 1] != '\n') {
+                lineStart--;
+            }
+            size_t firstText = lineStart;
+            while (firstText < buffer->length && (text[firstText] == ' ' || text[firstText] == '\t')) {
+                firstText++;
+            }
+            caret = caret == firstText ? lineStart : firstText;
+            break;
+        }
+        case CURSOR_MOVE_LINE_END: {
+            const char* newline = (const char*)memchr(text + caret, '\n', buffer->length - caret);
+            caret = newline ? (size_t)(newline - text) : buffer->length;
+            if (newline && caret > 0 && text[caret - 1] == '\r') {
+                caret--;
+            }
+            break;
+        }
+        case CURSOR_MOVE_DOCUMENT_START:
+            caret = 0;
+            break;
+        case CURSOR_MOVE_DOCUMENT_END:
+            caret = buffer->length;
+            break;
+        default:
+            break;
+    }
+
+    buffer->caret = caret;
+    if (!extend) {
+        buffer->anchor = caret;
+    }
+}
+
+/**
+ * @brief Replaces a range of a line buffer and leaves the caret after the new text.
+ *
+ * @param buffer The buffer.
+ * @param start Start of the range.
+ * @param end End of the range.
+ * @param text The new text.
+ * @param length Length of the new text.
+ * @return true if successful, false on allocation failure.
+ */
+static bool BufferReplace(LineBuffer* buffer, size_t start, size_t end, const char* text, size_t length) {
+    size_t newLength = buffer->length - (end - start) + length;
+    if (!ReserveBytes(&buffer->text, &buffer->capacity, newLength)) {
+        return false;
+    }
+    memmove(buffer->text + start + length, buffer->text + end, buffer->length - end);
+    memcpy(buffer->text + start, text, length);
+    buffer->length = newLength;
+    buffer->caret = start + length;
+    buffer->anchor = buffer->caret;
+    return true;
+}
+
+/**
+ * @brief Runs a macro on a line buffer.
+ *
+ * @param macro The macro; must be line-local.
+ * @param buffer The buffer, with the caret placed.
+ * @return true if successful, false on allocation failure or malformed code.
+ */
+static bool RunOnBuffer(const Macro* macro, LineBuffer* buffer) {
+    MacroInstruction instruction;
+    for (size_t position = 0; position < macro->length; position = instruction.next) {
+        if (!DecodeInstruction(macro, position, &instruction)) {
+            return false;
+        }
+        size_t start;
+        size_t end;
+        switch (instruction.op) {
+            case MACRO_OP_MOVE:
+            case MACRO_OP_SELECT:
+                for (uint64_t i = 0; i < instruction.count; i++) {
+                    BufferMove(buffer, instruction.movement, instruction.op == MACRO_OP_SELECT);
+                }
+                break;
+            case MACRO_OP_INSERT:
+                start = buffer->anchor < buffer->caret ? buffer->anchor : buffer->caret;
+                end = buffer->anchor < buffer->caret ? buffer->caret : buffer->anchor;
+                if (!BufferReplace(buffer, start, end, instruction.text, (size_t)instruction.count)) {
+                    return false;
+                }
+                break;
+            case MACRO_OP_DELETE_BACKWARD:
+            case MACRO_OP_DELETE_FORWARD:
+            case MACRO_OP_DELETE_WORD_BACKWARD:
+            case MACRO_OP_DELETE_WORD_FORWARD:
+                for (uint64_t i = 0; i < instruction.count; i++) {
+                    start = buffer->anchor < buffer->caret ? buffer->anchor : buffer->caret;
+                    end = buffer->anchor < buffer->caret ? buffer->caret : buffer->anchor;
+                    if (start == end) {
+                        switch (instruction.op) {
+                            case MACRO_OP_DELETE_FORWARD:
+                                end = BoundaryTextNextGrapheme(buffer->text, buffer->length, end);
+                                break;
+                            case MACRO_OP_DELETE_WORD_BACKWARD:
+                                start = BoundaryTextPreviousWord(buffer->text, buffer->length, start);
+                                break;
+                            case MACRO_OP_DELETE_WORD_FORWARD:
+                                end = BoundaryTextNextWord(buffer->text, buffer->length, end);
+                                break;
+                            default:
+                                start = BoundaryTextPreviousGrapheme(buffer->text, buffer->length, start);
+                                break;
+                        }
+                    }
+                    if (!BufferReplace(buffer, start, end, "", 0)) {
+                        return false;
+                    }
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether a line contains a pattern.
+ *
+ * @param text The line.
+ * @param length Length of the line.
+ * @param pattern The pattern.
+ * @param patternLength Length of the pattern.
+ * @param matchCase false to ignore ASCII case.
+ * @return true if the pattern occurs in the line.
+ */
+static bool LineContains(const char* text, size_t length, const char* pattern, size_t patternLength,
+                         bool matchCase) {
+    if (patternLength == 0) {
+        return true;
+    }
+    for (size_t i = 0; i + patternLength <= length; i++) {
+        size_t j = 0;
+        if (matchCase) {
+            const char* first = (const char*)memchr(text + i, pattern[0], length - patternLength - i + 1);
+            if (!first) {
+                return false;
+            }
+            i = (size_t)(first - text);
+            while (j < patternLength && text[i + j] == pattern[j]) {
+                j++;
+            }
+        } else {
+            while (j < patternLength) {
+                unsigned char a = (unsigned char)text[i + j];
+                unsigned char b = (unsigned char)pattern[j];
+                if (a >= 'A' && a <= 'Z') {
+                    a = (unsigned char)(a - 'A' + 'a');
+                }
+                if (b >= 'A' && b <= 'Z') {
+                    b = (unsigned char)(b - 'A' + 'a');
+                }
+                if (a != b) {
+                    break;
+                }
+                j++;
+            }
+        }
+        if (j == patternLength) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Records the difference between a line and what the macro made of it.
+ *
+ * Only the bytes between the common prefix and the common suffix are
+ * replaced, so the edit leaves the rest of the line alone.
+ *
+ * @param output The collected edits.
+ * @param lineStart Offset of the line in the document.
+ * @param original The line before the macro.
+ * @param originalLength Length of the line before the macro.
+ * @param result The line after the macro.
+ * @param resultLength Length of the line after the macro.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AddLineEdit(LineEdits* output, uint64_t lineStart, const char* original, size_t originalLength,
+                        const char* result, size_t resultLength) {
+    size_t shorter = originalLength < resultLength ? originalLength : resultLength;
+    size_t prefix = 0;
+    while (prefix < shorter && original[prefix] == result[prefix]) {
+        prefix++;
+    }
+    if (prefix == originalLength && prefix == resultLength) {
+        return true;
+    }
+    size_t suffix = 0;
+    while (suffix < shorter - prefix &&
+           original[originalLength - 1 - suffix] == result[resultLength - 1 - suffix]) {
+        suffix++;
+    }
+
+    if (output->count == output->capacity) {
+        size_t capacity = output->capacity ? output->capacity * 2 : 64;
+        DocumentEdit* edits = (DocumentEdit*)MemoryRealloc(MEMORY_TAG_EDITING, output->edits,
+                                                           capacity * sizeof(DocumentEdit));
+        if (!edits) {
+            return false;
+        }
+        output->edits = edits;
+        output->capacity = capacity;
+    }
+    size_t inserted = resultLength - prefix - suffix;
+    if (!ReserveBytes(&output->text, &output->textCapacity, output->textLength + inserted)) {
+        return false;
+    }
+    memcpy(output->text + output->textLength, result + prefix, inserted);
+
+    // The text pointers are set once the text array stops moving
+    DocumentEdit* edit = &output->edits[output->count++];
+    edit->offset = lineStart + prefix;
+    edit->removeLength = originalLength - prefix - suffix;
+    edit->text = NULL;
+    edit->textLength = inserted;
+    edit->slice = NULL;
+    output->textLength += inserted;
+    return true;
+}
+
+/**
+ * @brief Runs the macro on one line and collects the edit if the line changed.
+ *
+ * @param macro The macro.
+ * @param output The collected edits.
+ * @param buffer Work buffer for the macro.
+ * @param lineStart Offset of the line in the document.
+ * @param text The line, including a "\r" before its line feed.
+ * @param length Length of the line.
+ * @param pattern Pattern a target line contains, or NULL.
+ * @param patternLength Length of the pattern.
+ * @param matchCase false to ignore ASCII case.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ProcessLine(const Macro* macro, LineEdits* output, LineBuffer* buffer, uint64_t lineStart,
+                        const char* text, size_t length, const char* pattern, size_t patternLength,
+                        bool matchCase) {
+    if (length > 0 && text[length - 1] == '\r') {
+        length--;
+    }
+    if (pattern && !LineContains(text, length, pattern, patternLength, matchCase)) {
+        return true;
+    }
+    if (!ReserveBytes(&buffer->text, &buffer->capacity, length)) {
+        return false;
+    }
+    memcpy(buffer->text, text, length);
+    buffer->length = length;
+    buffer->anchor = 0;
+    buffer->caret = 0;
+    return RunOnBuffer(macro, buffer) && AddLineEdit(output, lineStart, text, length, buffer->text, buffer->length);
+}
+
+/**
+ * @brief Moves carets through the edits made on the lines.
+ *
+ * @param cursors The carets.
+ * @param edits The applied edits.
+ * @param editCount Number of edits.
+ */
+static void MapCursors(CursorSet* cursors, const DocumentEdit* edits, size_t editCount) {
+    DocumentChange* changes = (DocumentChange*)MemoryAlloc(MEMORY_TAG_EDITING, editCount * sizeof(DocumentChange));
+    if (!changes) {
+        // Without memory to map them, the carets go where they are sure to be valid
+        CursorSetReset(cursors, edits[0].offset, edits[0].offset);
+        return;
+    }
+    for (size_t i = 0; i < editCount; i++) {
+        changes[i].offset = edits[i].offset;
+        changes[i].removedLength = edits[i].removeLength;
+        changes[i].insertedLength = edits[i].textLength;
+    }
+    CursorSetMapChanges(cursors, changes, editCount);
+    MemoryFree(changes);
+}
+
+/**
+ * @brief Plays a macro once on each line of a range as one edit batch.
+ *
+ * @param macro The macro; must be line-local.
+ * @param document The document to edit.
+ * @param cursors Carets moved through the edit, or NULL if a document listener moves them.
+ * @param firstLine First line of the range.
+ * @param lastLine Last line of the range.
+ * @param pattern Only lines containing this text are targets; NULL for every line.
+ * @param patternLength Length of the pattern.
+ * @param matchCase false to match the pattern ignoring ASCII case.
+ * @param[out] changedLines Receives the number of lines changed; may be NULL.
+ * @return true if successful, false if the macro is not line-local or memory ran out.
+ */
+bool MacroRunOnLines(const Macro* macro, Document* document, CursorSet* cursors, uint64_t firstLine,
+                     uint64_t lastLine, const char* pattern, size_t patternLength, bool matchCase,
+                     uint64_t* changedLines) {
+    if (changedLines) {
+        *changedLines = 0;
+    }
+    if (!macro || !document || !MacroIsLineLocal(macro)) {
+        return false;
+    }
+    uint64_t lineCount = DocumentLineCount(document);
+    if (lastLine >= lineCount) {
+        lastLine = lineCount - 1;
+    }
+    if (firstLine > lastLine) {
+        return true;
+    }
+
+    // Stream the range once; a line is gathered in the line array only when it spans chunks
+    uint64_t rangeStart = DocumentLineStart(document, firstLine);
+    uint64_t rangeEnd = DocumentLineEnd(document, lastLine);
+    LineEdits output = { 0 };
+    LineBuffer buffer = { 0 };
+    char* line = NULL;
+    size_t lineLength = 0;
+    size_t lineCapacity = 0;
+    uint64_t lineStart = rangeStart;
+    uint64_t position = rangeStart;
+    bool success = true;
+
+    DocumentIterator iterator;
+    DocumentIterInit(document, rangeStart, &iterator);
+    const char* data;
+    size_t length;
+    while (success && position < rangeEnd && DocumentIterNext(&iterator, &data, &length)) {
+        if (length > rangeEnd - position) {
+            length = (size_t)(rangeEnd - position);
+        }
+        size_t consumed = 0;
+        while (success && consumed < length) {
+            const char* newline = (const char*)memchr(data + consumed, '\n', length - consumed);
+            size_t pieceEnd = newline ? (size_t)(newline - data) : length;
+            const char* text = data + consumed;
+            size_t textLength = pieceEnd - consumed;
+            if (lineLength > 0 || !newline) {
+                success = ReserveBytes(&line, &lineCapacity, lineLength + textLength);
+                if (success) {
+                    memcpy(line + lineLength, text, textLength);
+                    lineLength += textLength;
+                    text = line;
+                    textLength = lineLength;
+                }
+            }
+            if (success && newline) {
+                success = ProcessLine(macro, &output, &buffer, lineStart, text, textLength, pattern,
+                                      patternLength, matchCase);
+                lineStart += textLength + 1;
+                lineLength = 0;
+                pieceEnd++;
+            }
+            consumed = pieceEnd;
+        }
+        position += length;
+    }
+    if (success) {
+        success = ProcessLine(macro, &output, &buffer, lineStart, line ? line : "", lineLength, pattern,
+                              patternLength, matchCase);
+    }
+
+    if (success && output.count > 0) {
+        size_t textOffset = 0;
+        for (size_t i = 0; i < output.count; i++) {
+            output.edits[i].text = output.text + textOffset;
+            textOffset += output.edits[i].textLength;
+        }
+        success = DocumentApplyEdits(document, output.edits, output.count);
+        if (success && cursors) {
+            MapCursors(cursors, output.edits, output.count);
+        }
+    }
+    if (success && changedLines) {
+        *changedLines = output.count;
+    }
+
+    MemoryFree(output.edits);
+    MemoryFree(output.text);
+    MemoryFree(buffer.text);
+    MemoryFree(line);
+    return success;
+}
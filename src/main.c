@@ -8,6 +8,7 @@
 
 #include "../include/editor.h"
 #include "../include/window.h"
+#include "../include/frame.h"
 #include <commctrl.h> // Required for InitCommonControlsEx
 
 // Global instance handle
@@ -32,7 +33,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
     // Initialize common controls (required for status bar)
     INITCOMMONCONTROLSEX icex;
     icex.dwSize = sizeof(INITCOMMONCONTROLSEX);
-    icex.dwICC = ICC_BAR_CLASSES; // Load status bar control class
+    icex.dwICC = ICC_BAR_CLASSES | ICC_TREEVIEW_CLASSES; // Load status bar and tree view control classes
     if (!InitCommonControlsEx(&icex)) {
         MessageBox(NULL, "Failed to initialize common controls!", "Error!", MB_ICONEXCLAMATION | MB_OK);
         return 0;
@@ -46,12 +47,6 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
     BOOL windowCreated = CreateMainWindow(hInstance, nCmdShow);
     EDITOR_CHECK_ERROR(windowCreated, "Window Initialization Failed!", "Error");
     
-    // Main message loop
-    MSG msg;
-    while (GetMessage(&msg, NULL, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
-    }
-    
-    return (int)msg.wParam;
+    // Main message loop; deferred layout and status work runs between messages once per frame
+    return FrameRunMessageLoop();
 }
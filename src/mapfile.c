@@ -0,0 +1,303 @@
+/**
+ * @file mapfile.c
+ * @brief Read-only memory-mapped file implementation for the Professional Text Editor
+ *
+ * Contains the Win32 and POSIX implementations of whole-file mapping.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // For st_mtim and posix_madvise
+#endif
+
+#include "../include/mapfile.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Mapping of a zero-length file; keeps data non-NULL for callers
+static const char g_emptyMapping[1] = { '\0' };
+
+#ifdef _WIN32
+
+// Range passed to PrefetchVirtualMemory; declared here because older SDK headers lack WIN32_MEMORY_RANGE_ENTRY
+typedef struct {
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+} PrefetchRange;
+
+// PrefetchVirtualMemory, which only exists from Windows 8 on
+typedef BOOL (WINAPI *PrefetchVirtualMemoryFunction)(HANDLE process, ULONG_PTR entryCount, PrefetchRange* ranges,
+                                                      ULONG flags);
+
+/**
+ * @brief Converts a FILETIME to a single 64-bit tick count.
+ *
+ * @param fileTime The FILETIME to convert.
+ * @return The tick count.
+ */
+static uint64_t FileTimeToTicks(const FILETIME* fileTime) {
+    return ((uint64_t)fileTime->dwHighDateTime << 32) | fileTime->dwLowDateTime;
+}
+
+/**
+ * @brief Maps a file read-only into memory.
+ *
+ * @param filePath Path to the file to map.
+ * @param[out] mappedFile Receives the mapping; zeroed on failure.
+ * @return true if successful, false otherwise.
+ */
+bool MapFileOpen(const char* filePath, MappedFile* mappedFile) {
+    if (!filePath || !mappedFile) {
+        return false;
+    }
+    memset(mappedFile, 0, sizeof(*mappedFile));
+
+    HANDLE hFile = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    FILETIME lastWrite;
+    if (!GetFileSizeEx(hFile, &fileSize) || !GetFileTime(hFile, NULL, NULL, &lastWrite)) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    // Refuse sizes that do not fit the address space (32-bit builds)
+    if ((uint64_t)fileSize.QuadPart > (uint64_t)SIZE_MAX) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    mappedFile->size = (uint64_t)fileSize.QuadPart;
+    mappedFile->identity.size = mappedFile->size;
+    mappedFile->identity.mtime = FileTimeToTicks(&lastWrite);
+    mappedFile->fileHandle = hFile;
+
+    // CreateFileMapping rejects empty files, so they get a static view instead
+    if (mappedFile->size == 0) {
+        mappedFile->data = g_emptyMapping;
+        return true;
+    }
+
+    HANDLE hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMapping) {
+        CloseHandle(hFile);
+        memset(mappedFile, 0, sizeof(*mappedFile));
+        return false;
+    }
+
+    const char* view = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        memset(mappedFile, 0, sizeof(*mappedFile));
+        return false;
+    }
+
+    mappedFile->data = view;
+    mappedFile->mappingHandle = hMapping;
+    return true;
+}
+
+/**
+ * @brief Asks the system to start reading part of a mapping from disk.
+ *
+ * @param mappedFile The mapping.
+ * @param offset Start of the range.
+ * @param length Length of the range; clipped to the mapping.
+ */
+void MapFileReadAhead(const MappedFile* mappedFile, uint64_t offset, uint64_t length) {
+    if (!mappedFile || !mappedFile->mappingHandle || offset >= mappedFile->size) {
+        return;
+    }
+    if (length > mappedFile->size - offset) {
+        length = mappedFile->size - offset;
+    }
+
+    // Looked up at run time so the editor still starts on systems without it, which then read on demand
+    HMODULE kernel = GetModuleHandle(TEXT("kernel32.dll"));
+    PrefetchVirtualMemoryFunction prefetch =
+        kernel ? (PrefetchVirtualMemoryFunction)(void*)GetProcAddress(kernel, "PrefetchVirtualMemory") : NULL;
+    if (!prefetch) {
+        return;
+    }
+
+    // Queues the reads and returns; a failure only loses the hint
+    PrefetchRange range;
+    range.VirtualAddress = (PVOID)(mappedFile->data + offset);
+    range.NumberOfBytes = (SIZE_T)length;
+    prefetch(GetCurrentProcess(), 1, &range, 0);
+}
+
+/**
+ * @brief Unmaps a file previously mapped with MapFileOpen.
+ *
+ * @param mappedFile The mapping to release. Safe to call on a zeroed mapping.
+ */
+void MapFileClose(MappedFile* mappedFile) {
+    if (!mappedFile) {
+        return;
+    }
+    if (mappedFile->data && mappedFile->data != g_emptyMapping) {
+        UnmapViewOfFile(mappedFile->data);
+    }
+    if (mappedFile->mappingHandle) {
+        CloseHandle((HANDLE)mappedFile->mappingHandle);
+    }
+    if (mappedFile->fileHandle) {
+        CloseHandle((HANDLE)mappedFile->fileHandle);
+    }
+    memset(mappedFile, 0, sizeof(*mappedFile));
+}
+
+/**
+ * @brief Queries the size and last write time of a file without opening it.
+ *
+ * @param filePath Path to the file.
+ * @param[out] identity Receives the file identity.
+ * @return true if successful, false otherwise.
+ */
+bool GetFileIdentity(const char* filePath, FileIdentity* identity) {
+    if (!filePath || !identity) {
+        return false;
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesEx(filePath, GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+
+    identity->size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    identity->mtime = FileTimeToTicks(&attributes.ftLastWriteTime);
+    return true;
+}
+
+#else /* POSIX */
+
+/**
+ * @brief Converts a stat modification time to a single 64-bit tick count.
+ *
+ * @param st The stat structure.
+ * @return Nanoseconds since the epoch.
+ */
+static uint64_t StatToTicks(const struct stat* st) {
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL + (uint64_t)st->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Maps a file read-only into memory.
+ *
+ * @param filePath Path to the file to map.
+ * @param[out] mappedFile Receives the mapping; zeroed on failure.
+ * @return true if successful, false otherwise.
+ */
+bool MapFileOpen(const char* filePath, MappedFile* mappedFile) {
+    if (!filePath || !mappedFile) {
+        return false;
+    }
+    memset(mappedFile, 0, sizeof(*mappedFile));
+
+    int fd = open(filePath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || (uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+        close(fd);
+        return false;
+    }
+
+    mappedFile->size = (uint64_t)st.st_size;
+    mappedFile->identity.size = mappedFile->size;
+    mappedFile->identity.mtime = StatToTicks(&st);
+    mappedFile->fileHandle = (void*)(intptr_t)(fd + 1); // +1 so that fd 0 is not NULL
+
+    if (mappedFile->size == 0) {
+        mappedFile->data = g_emptyMapping;
+        return true;
+    }
+
+    void* view = mmap(NULL, (size_t)mappedFile->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        memset(mappedFile, 0, sizeof(*mappedFile));
+        return false;
+    }
+
+    mappedFile->data = (const char*)view;
+    return true;
+}
+
+/**
+ * @brief Asks the system to start reading part of a mapping from disk.
+ *
+ * @param mappedFile The mapping.
+ * @param offset Start of the range.
+ * @param length Length of the range; clipped to the mapping.
+ */
+void MapFileReadAhead(const MappedFile* mappedFile, uint64_t offset, uint64_t length) {
+    if (!mappedFile || !mappedFile->data || mappedFile->data == g_emptyMapping || offset >= mappedFile->size) {
+        return;
+    }
+    if (length > mappedFile->size - offset) {
+        length = mappedFile->size - offset;
+    }
+
+    // The advice must start on a page boundary
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = offset - offset % page;
+    posix_madvise((void*)(mappedFile->data + start), (size_t)(offset + length - start), POSIX_MADV_WILLNEED);
+}
+
+/**
+ * @brief Unmaps a file previously mapped with MapFileOpen.
+ *
+ * @param mappedFile The mapping to release. Safe to call on a zeroed mapping.
+ */
+void MapFileClose(MappedFile* mappedFile) {
+    if (!mappedFile) {
+        return;
+    }
+    if (mappedFile->data && mappedFile->data != g_emptyMapping) {
+        munmap((void*)mappedFile->data, (size_t)mappedFile->size);
+    }
+    if (mappedFile->fileHandle) {
+        close((int)(intptr_t)mappedFile->fileHandle - 1);
+    }
+    memset(mappedFile, 0, sizeof(*mappedFile));
+}
+
+/**
+ * @brief Queries the size and last write time of a file without opening it.
+ *
+ * @param filePath Path to the file.
+ * @param[out] identity Receives the file identity.
+ * @return true if successful, false otherwise.
+ */
+bool GetFileIdentity(const char* filePath, FileIdentity* identity) {
+    if (!filePath || !identity) {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(filePath, &st) != 0) {
+        return false;
+    }
+
+    identity->size = (uint64_t)st.st_size;
+    identity->mtime = StatToTicks(&st);
+    return true;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,912 @@
+/**
+ * @file markers.c
+ * @brief Edit-stable marker implementation for the Professional Text Editor
+ *
+ * Contains the marker tree: a treap of markers ordered by start, with
+ * pending shifts kept at subtree roots, and the mapping of markers through
+ * document changes.
+ */
+
+#include "../include/markers.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Index standing for no node
+#define MARKER_NONE UINT32_MAX
+
+// Nodes allocated when the tree first grows
+#define MARKER_INITIAL_CAPACITY 64
+
+// One marker and the summary of its subtree. Positions are relative to the
+// shifts pending in the ancestors of the node: the offset of a marker is its
+// start plus the shift of every node above it.
+typedef struct {
+    int64_t start;
+    int64_t end;
+    int64_t maxEnd;         // Largest end in the subtree, relative like start
+    int64_t shift;          // Shift not yet passed down to the children
+    uint32_t left;
+    uint32_t right;
+    uint32_t parent;        // Next free node while the node is unused
+    uint32_t generation;    // Incremented when the node is freed, so old identifiers fail
+    uint32_t value;
+    uint8_t kind;
+    uint8_t stickiness;
+    uint8_t kinds;          // Kinds present in the subtree, 1 << kind for each
+    bool used;
+} MarkerNode;
+
+struct MarkerTree {
+    Document* document;
+    MarkerNode* nodes;
+    uint32_t nodeCount;     // Nodes ever handed out; unused ones are on the free list
+    uint32_t capacity;
+    uint32_t freeList;
+    uint32_t root;
+    uint32_t generationFloor;   // Generation of nodes never used before
+    size_t counts[MARKER_KIND_COUNT];
+};
+
+// One document change being applied to the tree
+typedef struct {
+    int64_t offset;
+    int64_t removed;
+    int64_t inserted;
+} MarkerEdit;
+
+/**
+ * @brief Gets the treap priority of a node.
+ *
+ * Priorities are a hash of the node index, which is as good as a random
+ * number for balancing and needs no storage.
+ *
+ * @param index The node index.
+ * @return The priority.
+ */
+static uint32_t Priority(uint32_t index) {
+    uint32_t x = index + 0x9E3779B9u;
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * @brief Shifts every position of a subtree.
+ *
+ * The root of the subtree moves now; its children move when the shift is
+ * passed down to them.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param delta The shift.
+ */
+static void ApplyShift(MarkerTree* tree, uint32_t index, int64_t delta) {
+    if (index == MARKER_NONE || delta == 0) {
+        return;
+    }
+    MarkerNode* node = &tree->nodes[index];
+    node->start += delta;
+    node->end += delta;
+    node->maxEnd += delta;
+    node->shift += delta;
+}
+
+/**
+ * @brief Passes the pending shift of a node down to its children.
+ *
+ * @param tree The tree.
+ * @param index The node.
+ */
+static void PushDown(MarkerTree* tree, uint32_t index) {
+    MarkerNode* node = &tree->nodes[index];
+    if (node->shift != 0) {
+        ApplyShift(tree, node->left, node->shift);
+        ApplyShift(tree, node->right, node->shift);
+        node->shift = 0;
+    }
+}
+
+/**
+ * @brief Recomputes the summary of a node from its children and links them to it.
+ *
+ * @param tree The tree.
+ * @param index The node.
+ */
+static void Update(MarkerTree* tree, uint32_t index) {
+    MarkerNode* node = &tree->nodes[index];
+    node->maxEnd = node->end;
+    node->kinds = (uint8_t)(1u << node->kind);
+    uint32_t children[2] = { node->left, node->right };
+    for (int i = 0; i < 2; i++) {
+        if (children[i] == MARKER_NONE) {
+            continue;
+        }
+        MarkerNode* child = &tree->nodes[children[i]];
+        child->parent = index;
+        if (child->maxEnd + node->shift > node->maxEnd) {
+            node->maxEnd = child->maxEnd + node->shift;
+        }
+        node->kinds |= child->kinds;
+    }
+}
+
+/**
+ * @brief Splits a subtree into the markers starting before a key and the others.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param key The key.
+ * @param[out] before Receives the markers starting before the key.
+ * @param[out] after Receives the markers starting at or after the key.
+ */
+static void Split(MarkerTree* tree, uint32_t index, int64_t key, uint32_t* before, uint32_t* after) {
+    if (index == MARKER_NONE) {
+        *before = MARKER_NONE;
+        *after = MARKER_NONE;
+        return;
+    }
+    PushDown(tree, index);
+    MarkerNode* node = &tree->nodes[index];
+    if (node->start < key) {
+        Split(tree, node->right, key, &node->right, after);
+        *before = index;
+    } else {
+        Split(tree, node->left, key, before, &node->left);
+        *after = index;
+    }
+    Update(tree, index);
+}
+
+/**
+ * @brief Joins two subtrees whose markers are in order.
+ *
+ * @param tree The tree.
+ * @param first Subtree of the markers starting first, or MARKER_NONE.
+ * @param second Subtree of the markers starting last, or MARKER_NONE.
+ * @return Root of the joined subtree.
+ */
+static uint32_t Merge(MarkerTree* tree, uint32_t first, uint32_t second) {
+    if (first == MARKER_NONE) {
+        return second;
+    }
+    if (second == MARKER_NONE) {
+        return first;
+    }
+    if (Priority(first) > Priority(second)) {
+        PushDown(tree, first);
+        tree->nodes[first].right = Merge(tree, tree->nodes[first].right, second);
+        Update(tree, first);
+        return first;
+    }
+    PushDown(tree, second);
+    tree->nodes[second].left = Merge(tree, first, tree->nodes[second].left);
+    Update(tree, second);
+    return second;
+}
+
+/**
+ * @brief Makes a subtree the whole tree.
+ *
+ * @param tree The tree.
+ * @param index The new root, or MARKER_NONE.
+ */
+static void SetRoot(MarkerTree* tree, uint32_t index) {
+    tree->root = index;
+    if (index != MARKER_NONE) {
+        tree->nodes[index].parent = MARKER_NONE;
+    }
+}
+
+/**
+ * @brief Passes down the pending shifts of every ancestor of a node and of the node itself.
+ *
+ * @param tree The tree.
+ * @param index The node.
+ */
+static void PushDownPath(MarkerTree* tree, uint32_t index) {
+    uint32_t parent = tree->nodes[index].parent;
+    if (parent != MARKER_NONE) {
+        PushDownPath(tree, parent);
+    }
+    PushDown(tree, index);
+}
+
+/**
+ * @brief Gets the node of a marker identifier.
+ *
+ * @param tree The tree.
+ * @param id The identifier.
+ * @return The node index, or MARKER_NONE if the marker no longer exists.
+ */
+static uint32_t NodeFromId(const MarkerTree* tree, MarkerId id) {
+    uint32_t slot = (uint32_t)id;
+    if (slot == 0 || slot > tree->nodeCount) {
+        return MARKER_NONE;
+    }
+    const MarkerNode* node = &tree->nodes[slot - 1];
+    return node->used && node->generation == (uint32_t)(id >> 32) ? slot - 1 : MARKER_NONE;
+}
+
+/**
+ * @brief Fills the public description of a node.
+ *
+ * @param tree The tree.
+ * @param index The node.
+ * @param shift Sum of the pending shifts of its ancestors.
+ * @param[out] marker Receives the marker.
+ */
+static void DescribeNode(const MarkerTree* tree, uint32_t index, int64_t shift, Marker* marker) {
+    const MarkerNode* node = &tree->nodes[index];
+    marker->id = ((MarkerId)node->generation << 32) | (index + 1);
+    marker->start = (uint64_t)(node->start + shift);
+    marker->end = (uint64_t)(node->end + shift);
+    marker->kind = (MarkerKind)node->kind;
+    marker->stickiness = (MarkerStickiness)node->stickiness;
+    marker->value = node->value;
+}
+
+/**
+ * @brief Takes a node from the free list or the end of the node array.
+ *
+ * @param tree The tree.
+ * @return The node index, or MARKER_NONE if memory ran out.
+ */
+static uint32_t AllocateNode(MarkerTree* tree) {
+    if (tree->freeList != MARKER_NONE) {
+        uint32_t index = tree->freeList;
+        tree->freeList = tree->nodes[index].parent;
+        return index;
+    }
+    if (tree->nodeCount == tree->capacity) {
+        if (tree->capacity >= MARKER_NONE / 2) {
+            return MARKER_NONE;
+        }
+        uint32_t capacity = tree->capacity ? tree->capacity * 2 : MARKER_INITIAL_CAPACITY;
+        MarkerNode* nodes = (MarkerNode*)MemoryRealloc(MEMORY_TAG_MARKERS, tree->nodes,
+                                                       (size_t)capacity * sizeof(MarkerNode));
+        if (!nodes) {
+            return MARKER_NONE;
+        }
+        tree->nodes = nodes;
+        tree->capacity = capacity;
+    }
+    tree->nodes[tree->nodeCount].generation = tree->generationFloor;
+    return tree->nodeCount++;
+}
+
+/**
+ * @brief Returns an unlinked node to the free list.
+ *
+ * @param tree The tree.
+ * @param index The node.
+ */
+static void FreeNode(MarkerTree* tree, uint32_t index) {
+    MarkerNode* node = &tree->nodes[index];
+    tree->counts[node->kind]--;
+    node->used = false;
+    node->generation++;
+    node->parent = tree->freeList;
+    tree->freeList = index;
+}
+
+/**
+ * @brief Tells whether an edge of a marker moves after text inserted exactly at it.
+ *
+ * @param stickiness The stickiness of the marker.
+ * @param end true for the end of the marker, false for its start.
+ * @return true if the edge moves after the text, false if it stays before it.
+ */
+static bool EdgeMoves(MarkerStickiness stickiness, bool end) {
+    switch (stickiness) {
+        case MARKER_GROWS_NEVER: return !end;
+        case MARKER_GROWS_ALWAYS: return end;
+        case MARKER_GROWS_AT_START: return false;
+        case MARKER_GROWS_AT_END: return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Maps a position through one change.
+ *
+ * A position inside the removed text goes to the start of the change, or
+ * after the inserted text if the edge moves with insertions.
+ *
+ * @param edit The change.
+ * @param position The position before the change.
+ * @param moves true if the edge moves after text inserted at it.
+ * @return The position after the change.
+ */
+static int64_t MapPosition(const MarkerEdit* edit, int64_t position, bool moves) {
+    if (position < edit->offset) {
+        return position;
+    }
+    int64_t removedEnd = edit->offset + edit->removed;
+    if (position > removedEnd || (position == removedEnd && edit->removed > 0)) {
+        return position + edit->inserted - edit->removed;
+    }
+    return moves ? edit->offset + edit->inserted : edit->offset;
+}
+
+/**
+ * @brief Maps the ends of the markers of a subtree that reach a change.
+ *
+ * Every marker of the subtree starts before the change, so only ends move
+ * and the order of the subtree is kept. Subtrees ending before the change
+ * are skipped.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param edit The change.
+ */
+static void MapEnds(MarkerTree* tree, uint32_t index, const MarkerEdit* edit) {
+    if (index == MARKER_NONE || tree->nodes[index].maxEnd < edit->offset) {
+        return;
+    }
+    PushDown(tree, index);
+    MarkerNode* node = &tree->nodes[index];
+    MapEnds(tree, node->left, edit);
+    if (node->end >= edit->offset) {
+        node->end = MapPosition(edit, node->end, EdgeMoves((MarkerStickiness)node->stickiness, true));
+    }
+    MapEnds(tree, node->right, edit);
+    Update(tree, index);
+}
+
+/**
+ * @brief Maps the markers of a subtree that start inside a change and sorts them into two chains.
+ *
+ * Such markers start either at the change or after its inserted text, so
+ * they are chained, in order, by where they start. The chains are linked
+ * through the parent field.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param edit The change.
+ * @param heads First node of each chain: before the inserted text, then after it.
+ * @param tails Last node of each chain.
+ */
+static void MapStarts(MarkerTree* tree, uint32_t index, const MarkerEdit* edit, uint32_t heads[2],
+                      uint32_t tails[2]) {
+    if (index == MARKER_NONE) {
+        return;
+    }
+    PushDown(tree, index);
+    MarkerNode* node = &tree->nodes[index];
+    uint32_t left = node->left;
+    uint32_t right = node->right;
+    MapStarts(tree, left, edit, heads, tails);
+
+    MarkerStickiness stickiness = (MarkerStickiness)node->stickiness;
+    node->start = MapPosition(edit, node->start, EdgeMoves(stickiness, false));
+    node->end = MapPosition(edit, node->end, EdgeMoves(stickiness, true));
+    if (node->start > node->end) {
+        node->start = node->end;
+    }
+    node->left = MARKER_NONE;
+    node->right = MARKER_NONE;
+    node->parent = MARKER_NONE;
+    int chain = node->start > edit->offset;
+    if (heads[chain] == MARKER_NONE) {
+        heads[chain] = index;
+    } else {
+        tree->nodes[tails[chain]].parent = index;
+    }
+    tails[chain] = index;
+
+    MapStarts(tree, right, edit, heads, tails);
+}
+
+/**
+ * @brief Moves the markers of the tree through one change.
+ *
+ * The tree is split into the markers starting before the change, those
+ * starting inside it and those after it. The last part moves by one shift
+ * at its root, the first has only the ends reaching the change mapped, and
+ * the markers inside are mapped one by one.
+ *
+ * @param tree The tree.
+ * @param edit The change.
+ */
+static void ApplyEdit(MarkerTree* tree, const MarkerEdit* edit) {
+    uint32_t before;
+    uint32_t rest;
+    uint32_t inside;
+    uint32_t after;
+    Split(tree, tree->root, edit->offset, &before, &rest);
+    Split(tree, rest, edit->offset + (edit->removed > 0 ? edit->removed : 1), &inside, &after);
+
+    ApplyShift(tree, after, edit->inserted - edit->removed);
+    MapEnds(tree, before, edit);
+
+    uint32_t heads[2] = { MARKER_NONE, MARKER_NONE };
+    uint32_t tails[2] = { MARKER_NONE, MARKER_NONE };
+    MapStarts(tree, inside, edit, heads, tails);
+    inside = MARKER_NONE;
+    for (int chain = 0; chain < 2; chain++) {
+        for (uint32_t index = heads[chain]; index != MARKER_NONE;) {
+            uint32_t next = tree->nodes[index].parent;
+            Update(tree, index);
+            inside = Merge(tree, inside, index);
+            index = next;
+        }
+    }
+
+    SetRoot(tree, Merge(tree, Merge(tree, before, inside), after));
+}
+
+/**
+ * @brief Limits the positions of a subtree to a document length.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param length The document length.
+ */
+static void ClampSubtree(MarkerTree* tree, uint32_t index, int64_t length) {
+    if (index == MARKER_NONE || tree->nodes[index].maxEnd <= length) {
+        return;
+    }
+    PushDown(tree, index);
+    MarkerNode* node = &tree->nodes[index];
+    ClampSubtree(tree, node->left, length);
+    ClampSubtree(tree, node->right, length);
+    node->start = node->start < length ? node->start : length;
+    node->end = node->end < length ? node->end : length;
+    Update(tree, index);
+}
+
+/**
+ * @brief Moves the markers after the document changed.
+ *
+ * Changes are applied from the last to the first, so that each one is
+ * still in the coordinates of the markers it applies to. When the changes
+ * are unknown the markers keep their offsets, limited to the new length.
+ *
+ * @param document The document.
+ * @param changes The changes, or NULL if unknown.
+ * @param changeCount Number of changes.
+ * @param context The tree.
+ */
+static void MarkersDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                   void* context) {
+    MarkerTree* tree = (MarkerTree*)context;
+    if (tree->root == MARKER_NONE) {
+        return;
+    }
+    if (!changes) {
+        ClampSubtree(tree, tree->root, (int64_t)DocumentLength(document));
+        return;
+    }
+    for (size_t i = changeCount; i-- > 0;) {
+        MarkerEdit edit = { (int64_t)changes[i].offset, (int64_t)changes[i].removedLength,
+                            (int64_t)changes[i].insertedLength };
+        ApplyEdit(tree, &edit);
+    }
+}
+
+/**
+ * @brief Creates the empty marker tree of a document.
+ *
+ * The tree registers itself as a document listener and moves its markers
+ * with every change. Text removed around a marker collapses it to the
+ * position of the removal; markers are never removed by edits.
+ *
+ * @param document The document; it must outlive the tree.
+ * @return The tree, or NULL on allocation failure.
+ */
+MarkerTree* MarkerTreeCreate(Document* document) {
+    MarkerTree* tree = (MarkerTree*)MemoryCalloc(MEMORY_TAG_MARKERS, 1, sizeof(MarkerTree));
+    if (!tree) {
+        return NULL;
+    }
+    tree->document = document;
+    tree->freeList = MARKER_NONE;
+    tree->root = MARKER_NONE;
+    if (!DocumentAddListener(document, MarkersDocumentChanged, tree)) {
+        MemoryFree(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+/**
+ * @brief Destroys a marker tree and unregisters it from its document.
+ *
+ * @param tree The tree. NULL is ignored.
+ */
+void MarkerTreeDestroy(MarkerTree* tree) {
+    if (!tree) {
+        return;
+    }
+    DocumentRemoveListener(tree->document, MarkersDocumentChanged, tree);
+    MemoryFree(tree->nodes);
+    MemoryFree(tree);
+}
+
+/**
+ * @brief Adds a marker.
+ *
+ * @param tree The tree.
+ * @param start Start of the marker.
+ * @param end End of the marker; equal to start for a point.
+ * @param kind What the marker stands for.
+ * @param stickiness How the marker takes in text inserted at its edges.
+ * @param value Data returned with the marker.
+ * @return The identifier of the marker, or 0 if the range is invalid or memory ran out.
+ */
+MarkerId MarkerTreeAdd(MarkerTree* tree, uint64_t start, uint64_t end, MarkerKind kind,
+                       MarkerStickiness stickiness, uint32_t value) {
+    if (!tree || start > end || end > DocumentLength(tree->document) || (unsigned)kind >= MARKER_KIND_COUNT ||
+        (unsigned)stickiness > MARKER_GROWS_AT_END) {
+        return 0;
+    }
+    uint32_t index = AllocateNode(tree);
+    if (index == MARKER_NONE) {
+        return 0;
+    }
+
+    MarkerNode* node = &tree->nodes[index];
+    node->start = (int64_t)start;
+    node->end = (int64_t)end;
+    node->shift = 0;
+    node->left = MARKER_NONE;
+    node->right = MARKER_NONE;
+    node->value = value;
+    node->kind = (uint8_t)kind;
+    node->stickiness = (uint8_t)stickiness;
+    node->used = true;
+    tree->counts[kind]++;
+
+    // Descend to where the priority of the node places it and split only the subtree found there
+    uint32_t parent = MARKER_NONE;
+    uint32_t* link = &tree->root;
+    while (*link != MARKER_NONE && Priority(*link) > Priority(index)) {
+        PushDown(tree, *link);
+        parent = *link;
+        link = node->start < tree->nodes[parent].start ? &tree->nodes[parent].left : &tree->nodes[parent].right;
+    }
+    Split(tree, *link, node->start, &node->left, &node->right);
+    *link = index;
+    Update(tree, index);
+    node->parent = parent;
+    for (uint32_t ancestor = parent; ancestor != MARKER_NONE; ancestor = tree->nodes[ancestor].parent) {
+        Update(tree, ancestor);
+    }
+    return ((MarkerId)node->generation << 32) | (index + 1);
+}
+
+/**
+ * @brief Removes a marker.
+ *
+ * @param tree The tree.
+ * @param id The marker.
+ * @return true if the marker was removed, false if it no longer exists.
+ */
+bool MarkerTreeRemove(MarkerTree* tree, MarkerId id) {
+    uint32_t index = tree ? NodeFromId(tree, id) : MARKER_NONE;
+    if (index == MARKER_NONE) {
+        return false;
+    }
+
+    PushDownPath(tree, index);
+    MarkerNode* node = &tree->nodes[index];
+    uint32_t parent = node->parent;
+    uint32_t children = Merge(tree, node->left, node->right);
+    if (parent == MARKER_NONE) {
+        SetRoot(tree, children);
+    } else {
+        MarkerNode* above = &tree->nodes[parent];
+        if (above->left == index) {
+            above->left = children;
+        } else {
+            above->right = children;
+        }
+        for (uint32_t ancestor = parent; ancestor != MARKER_NONE; ancestor = tree->nodes[ancestor].parent) {
+            Update(tree, ancestor);
+        }
+    }
+    FreeNode(tree, index);
+    return true;
+}
+
+/**
+ * @brief Frees the markers of some kinds in a subtree and joins the others.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param kinds Mask of the kinds to remove.
+ * @param[in,out] removed Incremented for each marker removed.
+ * @return Root of the remaining subtree.
+ */
+static uint32_t RemoveKindsFrom(MarkerTree* tree, uint32_t index, uint32_t kinds, size_t* removed) {
+    if (index == MARKER_NONE || !(tree->nodes[index].kinds & kinds)) {
+        return index;
+    }
+    PushDown(tree, index);
+    MarkerNode* node = &tree->nodes[index];
+    uint32_t left = RemoveKindsFrom(tree, node->left, kinds, removed);
+    uint32_t right = RemoveKindsFrom(tree, node->right, kinds, removed);
+    node = &tree->nodes[index];
+    if ((1u << node->kind) & kinds) {
+        FreeNode(tree, index);
+        (*removed)++;
+        return Merge(tree, left, right);
+    }
+    node->left = left;
+    node->right = right;
+    Update(tree, index);
+    return index;
+}
+
+/**
+ * @brief Removes every marker of the kinds in a mask.
+ *
+ * @param tree The tree.
+ * @param kinds Mask of kinds, 1 << kind for each.
+ * @return Number of markers removed.
+ */
+size_t MarkerTreeRemoveKinds(MarkerTree* tree, uint32_t kinds) {
+    if (!tree) {
+        return 0;
+    }
+    size_t removed = 0;
+    SetRoot(tree, RemoveKindsFrom(tree, tree->root, kinds, &removed));
+    if (tree->root == MARKER_NONE && tree->nodes) {
+        // Nothing is left, so the nodes are released. New nodes start at a
+        // generation above every old one, so old identifiers still fail.
+        for (uint32_t index = 0; index < tree->nodeCount; index++) {
+            if (tree->nodes[index].generation >= tree->generationFloor) {
+                tree->generationFloor = tree->nodes[index].generation + 1;
+            }
+        }
+        MemoryFree(tree->nodes);
+        tree->nodes = NULL;
+        tree->nodeCount = 0;
+        tree->capacity = 0;
+        tree->freeList = MARKER_NONE;
+    }
+    return removed;
+}
+
+/**
+ * @brief Gets the current position of a marker.
+ *
+ * @param tree The tree.
+ * @param id The marker.
+ * @param[out] marker Receives the marker.
+ * @return true if the marker exists, false otherwise.
+ */
+bool MarkerTreeGet(const MarkerTree* tree, MarkerId id, Marker* marker) {
+    uint32_t index = tree ? NodeFromId(tree, id) : MARKER_NONE;
+    if (index == MARKER_NONE) {
+        return false;
+    }
+    int64_t shift = 0;
+    for (uint32_t parent = tree->nodes[index].parent; parent != MARKER_NONE; parent = tree->nodes[parent].parent) {
+        shift += tree->nodes[parent].shift;
+    }
+    DescribeNode(tree, index, shift, marker);
+    return true;
+}
+
+/**
+ * @brief Gets the number of markers of the kinds in a mask.
+ *
+ * @param tree The tree.
+ * @param kinds Mask of kinds.
+ * @return The number of markers.
+ */
+size_t MarkerTreeCount(const MarkerTree* tree, uint32_t kinds) {
+    size_t count = 0;
+    for (int kind = 0; tree && kind < MARKER_KIND_COUNT; kind++) {
+        if (kinds & (1u << kind)) {
+            count += tree->counts[kind];
+        }
+    }
+    return count;
+}
+
+// Markers removed per query by MarkerTreeToggleLine
+#define MARKER_TOGGLE_BATCH 16
+
+// Identifiers collected by a query
+typedef struct {
+    MarkerId ids[MARKER_TOGGLE_BATCH];
+    size_t count;
+} MarkerIdBatch;
+
+// State of a range query
+typedef struct {
+    int64_t from;
+    int64_t to;
+    uint32_t kinds;
+    MarkerCallback callback;
+    void* context;
+    size_t reported;
+    bool stopped;
+} MarkerQuery;
+
+/**
+ * @brief Reports the markers of a subtree that overlap the range of a query.
+ *
+ * Subtrees ending before the range or holding none of the kinds are
+ * skipped, and the walk stops at the first marker starting after it.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param shift Sum of the pending shifts above the subtree.
+ * @param query The query.
+ */
+static void QuerySubtree(const MarkerTree* tree, uint32_t index, int64_t shift, MarkerQuery* query) {
+    if (index == MARKER_NONE || query->stopped) {
+        return;
+    }
+    const MarkerNode* node = &tree->nodes[index];
+    if (!(node->kinds & query->kinds) || node->maxEnd + shift < query->from) {
+        return;
+    }
+    QuerySubtree(tree, node->left, shift + node->shift, query);
+    if (query->stopped || node->start + shift > query->to) {
+        return;
+    }
+    if (((1u << node->kind) & query->kinds) && node->end + shift >= query->from) {
+        Marker marker;
+        DescribeNode(tree, index, shift, &marker);
+        query->reported++;
+        if (!query->callback(&marker, query->context)) {
+            query->stopped = true;
+            return;
+        }
+    }
+    QuerySubtree(tree, node->right, shift + node->shift, query);
+}
+
+/**
+ * @brief Reports the markers that overlap or touch a range, in order of their start.
+ *
+ * A marker is reported when it starts at or before the end of the range
+ * and ends at or after its start, so the markers of the visible rows are
+ * found with one query.
+ *
+ * @param tree The tree.
+ * @param from Start of the range.
+ * @param to End of the range.
+ * @param kinds Mask of the kinds to report.
+ * @param callback Invoked for each marker.
+ * @param context Pointer passed to the callback.
+ * @return Number of markers reported.
+ */
+size_t MarkerTreeQuery(const MarkerTree* tree, uint64_t from, uint64_t to, uint32_t kinds,
+                       MarkerCallback callback, void* context) {
+    if (!tree || !callback || from > to) {
+        return 0;
+    }
+    MarkerQuery query = { (int64_t)from, (int64_t)to, kinds, callback, context, 0, false };
+    QuerySubtree(tree, tree->root, 0, &query);
+    return query.reported;
+}
+
+/**
+ * @brief Finds the marker of some kinds nearest to an offset in one direction.
+ *
+ * @param tree The tree.
+ * @param index Root of the subtree, or MARKER_NONE.
+ * @param shift Sum of the pending shifts above the subtree.
+ * @param offset The offset.
+ * @param kinds Mask of kinds.
+ * @param forward true for the first marker starting at or after the offset, false for the last one before it.
+ * @param[out] found Receives the sum of the shifts above the node found.
+ * @return The node, or MARKER_NONE.
+ */
+static uint32_t FindNearest(const MarkerTree* tree, uint32_t index, int64_t shift, int64_t offset, uint32_t kinds,
+                            bool forward, int64_t* found) {
+    if (index == MARKER_NONE || !(tree->nodes[index].kinds & kinds)) {
+        return MARKER_NONE;
+    }
+    const MarkerNode* node = &tree->nodes[index];
+    int64_t start = node->start + shift;
+    uint32_t nearSide = forward ? node->left : node->right;
+    uint32_t farSide = forward ? node->right : node->left;
+    if (forward ? start < offset : start >= offset) {
+        return FindNearest(tree, farSide, shift + node->shift, offset, kinds, forward, found);
+    }
+    uint32_t result = FindNearest(tree, nearSide, shift + node->shift, offset, kinds, forward, found);
+    if (result != MARKER_NONE) {
+        return result;
+    }
+    if ((1u << node->kind) & kinds) {
+        *found = shift;
+        return index;
+    }
+    return FindNearest(tree, farSide, shift + node->shift, offset, kinds, forward, found);
+}
+
+/**
+ * @brief Finds the first marker of some kinds starting at or after an offset.
+ *
+ * @param tree The tree.
+ * @param offset The offset.
+ * @param kinds Mask of kinds.
+ * @param[out] marker Receives the marker.
+ * @return true if one was found, false otherwise.
+ */
+bool MarkerTreeNext(const MarkerTree* tree, uint64_t offset, uint32_t kinds, Marker* marker) {
+    int64_t shift = 0;
+    uint32_t index = tree ? FindNearest(tree, tree->root, 0, (int64_t)offset, kinds, true, &shift) : MARKER_NONE;
+    if (index == MARKER_NONE) {
+        return false;
+    }
+    DescribeNode(tree, index, shift, marker);
+    return true;
+}
+
+/**
+ * @brief Finds the last marker of some kinds starting before an offset.
+ *
+ * @param tree The tree.
+ * @param offset The offset.
+ * @param kinds Mask of kinds.
+ * @param[out] marker Receives the marker.
+ * @return true if one was found, false otherwise.
+ */
+bool MarkerTreePrevious(const MarkerTree* tree, uint64_t offset, uint32_t kinds, Marker* marker) {
+    int64_t shift = 0;
+    uint32_t index = tree ? FindNearest(tree, tree->root, 0, (int64_t)offset, kinds, false, &shift) : MARKER_NONE;
+    if (index == MARKER_NONE) {
+        return false;
+    }
+    DescribeNode(tree, index, shift, marker);
+    return true;
+}
+
+/**
+ * @brief Collects the identifier of a marker into a batch.
+ *
+ * @param marker The marker.
+ * @param context The batch.
+ * @return false once the batch is full.
+ */
+static bool CollectId(const Marker* marker, void* context) {
+    MarkerIdBatch* batch = (MarkerIdBatch*)context;
+    batch->ids[batch->count++] = marker->id;
+    return batch->count < MARKER_TOGGLE_BATCH;
+}
+
+/**
+ * @brief Marks a line, or removes the marks of a line that has some.
+ *
+ * A line is marked with a point at its start that moves after text
+ * inserted there, so a line break typed at the start of the line keeps
+ * the mark with the line's text.
+ *
+ * @param tree The tree.
+ * @param line The line.
+ * @param kind The kind of the mark, such as MARKER_KIND_BOOKMARK.
+ * @return true if the line is now marked, false if its marks were removed or memory ran out.
+ */
+bool MarkerTreeToggleLine(MarkerTree* tree, uint64_t line, MarkerKind kind) {
+    if (!tree || line >= DocumentLineCount(tree->document) || (unsigned)kind >= MARKER_KIND_COUNT) {
+        return false;
+    }
+    uint64_t start = DocumentLineStart(tree->document, line);
+    uint64_t end = DocumentLineEnd(tree->document, line);
+
+    bool removed = false;
+    MarkerIdBatch batch;
+    do {
+        batch.count = 0;
+        MarkerTreeQuery(tree, start, end, 1u << kind, CollectId, &batch);
+        for (size_t i = 0; i < batch.count; i++) {
+            MarkerTreeRemove(tree, batch.ids[i]);
+        }
+        removed |= batch.count > 0;
+    } while (batch.count == MARKER_TOGGLE_BATCH);
+    if (removed) {
+        return false;
+    }
+    return MarkerTreeAdd(tree, start, start, kind, MARKER_GROWS_AT_END, 0) != 0;
+}
@@ -0,0 +1,705 @@
+/**
+ * @file memory.c
+ * @brief Tagged memory allocation implementation for the Professional Text Editor
+ *
+ * Contains the size-class pools with their per-thread caches and shared
+ * depot, the arenas, and the per-subsystem accounting.
+ */
+
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Number of size classes served by the pools
+#define MEMORY_CLASS_COUNT 16
+
+// Largest request served by the pools
+#define MEMORY_POOL_LIMIT 512
+
+// Bytes of each slab carved into pool blocks
+#define MEMORY_SLAB_SIZE (64 * 1024)
+
+// Bytes of pool blocks moved between a thread cache and the depot at once
+#define MEMORY_BATCH_BYTES 4096
+
+// Unpublished bytes a thread may hold for one subsystem before publishing them
+#define MEMORY_PUBLISH_BYTES (32 * 1024)
+
+// Allocations a thread may make before publishing its counts
+#define MEMORY_PUBLISH_COUNT 256
+
+// Size of the first arena chunk
+#define MEMORY_ARENA_CHUNK_SIZE (64 * 1024)
+
+// Largest arena chunk kept across MemoryArenaReset
+#define MEMORY_ARENA_KEEP_LIMIT (256 * 1024)
+
+// Size class value of blocks from the system allocator
+#define MEMORY_SYSTEM_CLASS 0
+
+// Precedes every block; 16 bytes so that the memory after it keeps malloc's alignment
+typedef struct {
+    uint64_t size;              // Requested bytes
+    uint32_t tag;
+    uint32_t sizeClass;         // Pool class plus one, or MEMORY_SYSTEM_CLASS
+} BlockHeader;
+
+// A pool block on a free list, overlaying its header
+typedef struct FreeBlock {
+    struct FreeBlock* next;
+} FreeBlock;
+
+// Blocks of one class cached by a thread
+typedef struct {
+    FreeBlock* head;
+    uint32_t count;
+} FreeList;
+
+// State of one thread; zero-initialized when the thread starts
+typedef struct {
+    FreeList lists[MEMORY_CLASS_COUNT];
+    int64_t pendingBytes[MEMORY_TAG_COUNT];
+    uint32_t pendingAllocations[MEMORY_TAG_COUNT];
+    uint32_t pendingCount;      // Allocations since the last publish
+    uint32_t pendingPooled;     // Pool allocations since the last publish
+} ThreadCache;
+
+// Blocks of one class shared by all threads
+typedef struct {
+    volatile int64_t lock;      // Spin lock; held only to move a batch
+    FreeBlock* head;
+    uint64_t count;
+} Depot;
+
+// Published usage of one subsystem
+typedef struct {
+    volatile int64_t liveBytes;
+    volatile int64_t peakBytes;
+    volatile int64_t allocations;
+} TagCounters;
+
+struct MemoryArenaChunk {
+    MemoryArenaChunk* next;
+    size_t size;                // Usable bytes after this header
+};
+
+// Payload sizes of the pool classes
+static const uint32_t g_classSizes[MEMORY_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+// Pool class of each request size, indexed by (size + 15) / 16
+static const uint8_t g_classBySize[MEMORY_POOL_LIMIT / 16 + 1] = {
+    0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15
+};
+
+static const char* const g_tagNames[MEMORY_TAG_COUNT] = {
+    "Document", "Editing", "Layout", "Structure", "Words", "Spelling", "Diff", "Sort", "Table",
+    "JSON", "Screen", "Hex", "Session", "Writer", "Threads", "Markers", "Filter", "Times"
+};
+
+static THREAD_LOCAL ThreadCache g_cache;
+static Depot g_depots[MEMORY_CLASS_COUNT];
+static TagCounters g_counters[MEMORY_TAG_COUNT];
+static volatile int64_t g_poolBytes;
+static volatile int64_t g_pooledAllocations;
+
+// Slabs linked through their first bytes, kept for the life of the process
+static void* volatile g_slabs;
+static volatile int64_t g_slabLock;
+
+/**
+ * @brief Reads a counter that other threads change atomically.
+ *
+ * @param counter The counter.
+ * @return Its value.
+ */
+static int64_t LoadCounter(volatile int64_t* counter) {
+    return ThreadAtomicAdd64(counter, 0);
+}
+
+/**
+ * @brief Acquires a spin lock.
+ *
+ * @param lock The lock.
+ */
+static void SpinLockEnter(volatile int64_t* lock) {
+    while (!ThreadAtomicCompareExchange64(lock, 0, 1)) {
+        while (LoadCounter(lock)) {
+            // Holders only move a batch of pointers
+        }
+    }
+}
+
+/**
+ * @brief Releases a spin lock.
+ *
+ * @param lock The lock.
+ */
+static void SpinLockLeave(volatile int64_t* lock) {
+    ThreadAtomicAdd64(lock, -1);
+}
+
+/**
+ * @brief Raises a peak counter to a value if it is higher.
+ *
+ * @param peak The peak counter.
+ * @param value The value.
+ */
+static void RaisePeak(volatile int64_t* peak, int64_t value) {
+    int64_t current = LoadCounter(peak);
+    while (value > current && !ThreadAtomicCompareExchange64(peak, current, value)) {
+        current = LoadCounter(peak);
+    }
+}
+
+/**
+ * @brief Publishes the counts a thread has gathered to the shared counters.
+ *
+ * @param cache The calling thread's cache.
+ */
+static void Publish(ThreadCache* cache) {
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        if (cache->pendingBytes[tag] != 0) {
+            int64_t live = ThreadAtomicAdd64(&g_counters[tag].liveBytes, cache->pendingBytes[tag]);
+            RaisePeak(&g_counters[tag].peakBytes, live);
+            cache->pendingBytes[tag] = 0;
+        }
+        if (cache->pendingAllocations[tag] != 0) {
+            ThreadAtomicAdd64(&g_counters[tag].allocations, cache->pendingAllocations[tag]);
+            cache->pendingAllocations[tag] = 0;
+        }
+    }
+    if (cache->pendingPooled != 0) {
+        ThreadAtomicAdd64(&g_pooledAllocations, cache->pendingPooled);
+        cache->pendingPooled = 0;
+    }
+    cache->pendingCount = 0;
+}
+
+/**
+ * @brief Counts bytes allocated or released by a subsystem.
+ *
+ * @param cache The calling thread's cache.
+ * @param tag The subsystem.
+ * @param bytes Bytes allocated, or negative for bytes released.
+ * @param allocation true if this is a new allocation.
+ */
+static void Account(ThreadCache* cache, uint32_t tag, int64_t bytes, bool allocation) {
+    cache->pendingBytes[tag] += bytes;
+    if (allocation) {
+        cache->pendingAllocations[tag]++;
+        cache->pendingCount++;
+    }
+    if (cache->pendingBytes[tag] > MEMORY_PUBLISH_BYTES || cache->pendingBytes[tag] < -MEMORY_PUBLISH_BYTES ||
+        cache->pendingCount >= MEMORY_PUBLISH_COUNT) {
+        Publish(cache);
+    }
+}
+
+/**
+ * @brief Gets the number of blocks of a class moved at once.
+ *
+ * @param sizeClass The class index.
+ * @return The batch size.
+ */
+static uint32_t BatchCount(size_t sizeClass) {
+    uint32_t count = MEMORY_BATCH_BYTES / (g_classSizes[sizeClass] + sizeof(BlockHeader));
+    return count < 4 ? 4 : count;
+}
+
+/**
+ * @brief Carves a new slab into blocks of a class.
+ *
+ * @param sizeClass The class index.
+ * @param[out] last Receives the last block of the chain.
+ * @param[out] count Receives the number of blocks.
+ * @return The first block of the chain, or NULL on allocation failure.
+ */
+static FreeBlock* CarveSlab(size_t sizeClass, FreeBlock** last, uint32_t* count) {
+    char* slab = (char*)malloc(MEMORY_SLAB_SIZE);
+    if (!slab) {
+        return NULL;
+    }
+    SpinLockEnter(&g_slabLock);
+    *(void**)slab = g_slabs;
+    g_slabs = slab;
+    SpinLockLeave(&g_slabLock);
+    ThreadAtomicAdd64(&g_poolBytes, MEMORY_SLAB_SIZE);
+
+    size_t blockSize = g_classSizes[sizeClass] + sizeof(BlockHeader);
+    size_t blocks = (MEMORY_SLAB_SIZE - sizeof(BlockHeader)) / blockSize;
+    char* first = slab + sizeof(BlockHeader); // The link to the previous slab stays in front
+    for (size_t i = 0; i + 1 < blocks; i++) {
+        ((FreeBlock*)(first + i * blockSize))->next = (FreeBlock*)(first + (i + 1) * blockSize);
+    }
+    *last = (FreeBlock*)(first + (blocks - 1) * blockSize);
+    (*last)->next = NULL;
+    *count = (uint32_t)blocks;
+    return (FreeBlock*)first;
+}
+
+/**
+ * @brief Refills an empty thread free list from the depot or a new slab.
+ *
+ * @param list The empty list.
+ * @param sizeClass Its class index.
+ * @return true if the list now holds blocks, false on allocation failure.
+ */
+static bool Refill(FreeList* list, size_t sizeClass) {
+    Depot* depot = &g_depots[sizeClass];
+    uint32_t batch = BatchCount(sizeClass);
+
+    SpinLockEnter(&depot->lock);
+    if (depot->head) {
+        FreeBlock* head = depot->head;
+        FreeBlock* tail = head;
+        uint32_t count = 1;
+        while (count < batch && tail->next) {
+            tail = tail->next;
+            count++;
+        }
+        depot->head = tail->next;
+        depot->count -= count;
+        SpinLockLeave(&depot->lock);
+        tail->next = NULL;
+        list->head = head;
+        list->count = count;
+        return true;
+    }
+    SpinLockLeave(&depot->lock);
+
+    FreeBlock* last;
+    uint32_t count;
+    FreeBlock* head = CarveSlab(sizeClass, &last, &count);
+    if (!head) {
+        return false;
+    }
+
+    // Keep one batch and share the rest of the slab
+    if (count > batch) {
+        FreeBlock* tail = head;
+        for (uint32_t i = 1; i < batch; i++) {
+            tail = tail->next;
+        }
+        FreeBlock* rest = tail->next;
+        tail->next = NULL;
+        SpinLockEnter(&depot->lock);
+        last->next = depot->head;
+        depot->head = rest;
+        depot->count += count - batch;
+        SpinLockLeave(&depot->lock);
+        count = batch;
+    }
+    list->head = head;
+    list->count = count;
+    return true;
+}
+
+/**
+ * @brief Moves blocks from a thread free list to the depot.
+ *
+ * @param list The list.
+ * @param sizeClass Its class index.
+ * @param keep Number of blocks to leave in the list.
+ */
+static void Drain(FreeList* list, size_t sizeClass, uint32_t keep) {
+    if (list->count <= keep) {
+        return;
+    }
+    FreeBlock* moved;
+    if (keep == 0) {
+        moved = list->head;
+        list->head = NULL;
+    } else {
+        FreeBlock* tail = list->head;
+        for (uint32_t i = 1; i < keep; i++) {
+            tail = tail->next;
+        }
+        moved = tail->next;
+        tail->next = NULL;
+    }
+    uint32_t count = list->count - keep;
+    FreeBlock* last = moved;
+    while (last->next) {
+        last = last->next;
+    }
+    list->count = keep;
+
+    Depot* depot = &g_depots[sizeClass];
+    SpinLockEnter(&depot->lock);
+    last->next = depot->head;
+    depot->head = moved;
+    depot->count += count;
+    SpinLockLeave(&depot->lock);
+}
+
+/**
+ * @brief Allocates memory owned by a subsystem.
+ *
+ * @param tag The owning subsystem.
+ * @param size Number of bytes; 0 allocates a minimal block.
+ * @return The memory, aligned to 16 bytes, or NULL on failure.
+ */
+void* MemoryAlloc(MemoryTag tag, size_t size) {
+    ThreadCache* cache = &g_cache;
+    BlockHeader* header;
+    if (size <= MEMORY_POOL_LIMIT) {
+        size_t sizeClass = g_classBySize[(size + 15) / 16];
+        FreeList* list = &cache->lists[sizeClass];
+        if (!list->head && !Refill(list, sizeClass)) {
+            return NULL;
+        }
+        header = (BlockHeader*)list->head;
+        list->head = list->head->next;
+        list->count--;
+        header->sizeClass = (uint32_t)sizeClass + 1;
+        cache->pendingPooled++;
+        header->tag = (uint32_t)tag;
+        header->size = size;
+        Account(cache, tag, g_classSizes[sizeClass], true);
+    } else {
+        if (size > SIZE_MAX - sizeof(BlockHeader)) {
+            return NULL;
+        }
+        header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+        if (!header) {
+            return NULL;
+        }
+        header->sizeClass = MEMORY_SYSTEM_CLASS;
+        header->tag = (uint32_t)tag;
+        header->size = size;
+        Account(cache, tag, (int64_t)size, true);
+    }
+    return header + 1;
+}
+
+/**
+ * @brief Allocates zeroed memory owned by a subsystem.
+ *
+ * @param tag The owning subsystem.
+ * @param count Number of elements.
+ * @param size Size of each element.
+ * @return The memory, or NULL on failure or overflow.
+ */
+void* MemoryCalloc(MemoryTag tag, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* memory = MemoryAlloc(tag, count * size);
+    if (memory) {
+        memset(memory, 0, count * size);
+    }
+    return memory;
+}
+
+/**
+ * @brief Gets the bytes charged for a block.
+ *
+ * @param header The block header.
+ * @return The charged bytes.
+ */
+static int64_t ChargedBytes(const BlockHeader* header) {
+    return header->sizeClass == MEMORY_SYSTEM_CLASS ? (int64_t)header->size
+                                                    : (int64_t)g_classSizes[header->sizeClass - 1];
+}
+
+/**
+ * @brief Resizes memory, moving it if needed.
+ *
+ * @param tag The owning subsystem; the block is retagged if it differs.
+ * @param memory Memory from MemoryAlloc, or NULL to allocate.
+ * @param size The new size in bytes.
+ * @return The resized memory, or NULL on failure (the old block is then untouched).
+ */
+void* MemoryRealloc(MemoryTag tag, void* memory, size_t size) {
+    if (!memory) {
+        return MemoryAlloc(tag, size);
+    }
+    BlockHeader* header = (BlockHeader*)memory - 1;
+    ThreadCache* cache = &g_cache;
+
+    if (header->sizeClass != MEMORY_SYSTEM_CLASS && size <= g_classSizes[header->sizeClass - 1] &&
+        (header->sizeClass == 1 || size > g_classSizes[header->sizeClass - 2])) {
+        // Still the same class
+        Account(cache, header->tag, -ChargedBytes(header), false);
+        header->tag = (uint32_t)tag;
+        header->size = size;
+        Account(cache, tag, ChargedBytes(header), false);
+        return memory;
+    }
+
+    if (header->sizeClass == MEMORY_SYSTEM_CLASS && size > MEMORY_POOL_LIMIT) {
+        if (size > SIZE_MAX - sizeof(BlockHeader)) {
+            return NULL;
+        }
+        uint32_t oldTag = header->tag;
+        int64_t oldBytes = (int64_t)header->size;
+        BlockHeader* resized = (BlockHeader*)realloc(header, sizeof(BlockHeader) + size);
+        if (!resized) {
+            return NULL;
+        }
+        resized->tag = (uint32_t)tag;
+        resized->size = size;
+        Account(cache, oldTag, -oldBytes, false);
+        Account(cache, tag, (int64_t)size, false);
+        return resized + 1;
+    }
+
+    // Moving between the pools and the system allocator
+    void* moved = MemoryAlloc(tag, size);
+    if (!moved) {
+        return NULL;
+    }
+    memcpy(moved, memory, header->size < size ? (size_t)header->size : size);
+    MemoryFree(memory);
+    return moved;
+}
+
+/**
+ * @brief Releases memory from MemoryAlloc on any thread.
+ *
+ * @param memory The memory. NULL is ignored.
+ */
+void MemoryFree(void* memory) {
+    if (!memory) {
+        return;
+    }
+    BlockHeader* header = (BlockHeader*)memory - 1;
+    ThreadCache* cache = &g_cache;
+    Account(cache, header->tag, -ChargedBytes(header), false);
+    if (header->sizeClass == MEMORY_SYSTEM_CLASS) {
+        free(header);
+        return;
+    }
+
+    size_t sizeClass = header->sizeClass - 1;
+    FreeList* list = &cache->lists[sizeClass];
+    FreeBlock* block = (FreeBlock*)header;
+    block->next = list->head;
+    list->head = block;
+    list->count++;
+    uint32_t batch = BatchCount(sizeClass);
+    if (list->count > 2 * batch) {
+        Drain(list, sizeClass, batch);
+    }
+}
+
+/**
+ * @brief Returns the pool blocks cached by the calling thread to the shared depot.
+ *
+ * Called by threads started with ThreadStart before they end, so that
+ * blocks they freed can be reused by other threads.
+ */
+void MemoryReleaseThreadCache(void) {
+    ThreadCache* cache = &g_cache;
+    for (size_t i = 0; i < MEMORY_CLASS_COUNT; i++) {
+        Drain(&cache->lists[i], i, 0);
+    }
+    Publish(cache);
+}
+
+/**
+ * @brief Initializes an empty arena.
+ *
+ * @param arena The arena.
+ * @param tag The subsystem charged for its chunks.
+ */
+void MemoryArenaInit(MemoryArena* arena, MemoryTag tag) {
+    arena->chunks = NULL;
+    arena->used = 0;
+    arena->tag = tag;
+}
+
+/**
+ * @brief Allocates scratch memory from an arena.
+ *
+ * @param arena The arena.
+ * @param size Number of bytes.
+ * @return The memory, aligned to 16 bytes, or NULL on failure.
+ */
+void* MemoryArenaAlloc(MemoryArena* arena, size_t size) {
+    if (size > SIZE_MAX - 15) {
+        return NULL;
+    }
+    size = (size + 15) & ~(size_t)15;
+    MemoryArenaChunk* chunk = arena->chunks;
+    if (!chunk || chunk->size - arena->used < size) {
+        size_t chunkSize = chunk ? chunk->size * 2 : MEMORY_ARENA_CHUNK_SIZE;
+        if (chunkSize < size) {
+            chunkSize = size;
+        }
+        // The header takes 16 bytes so that the memory after it stays aligned
+        MemoryArenaChunk* added = (MemoryArenaChunk*)MemoryAlloc(arena->tag, 16 + chunkSize);
+        if (!added) {
+            return NULL;
+        }
+        added->next = chunk;
+        added->size = chunkSize;
+        arena->chunks = added;
+        arena->used = 0;
+        chunk = added;
+    }
+    void* memory = (char*)chunk + 16 + arena->used;
+    arena->used += size;
+    return memory;
+}
+
+/**
+ * @brief Releases every allocation of an arena at once.
+ *
+ * The newest chunk is kept for the next operation unless it is large.
+ *
+ * @param arena The arena.
+ */
+void MemoryArenaReset(MemoryArena* arena) {
+    MemoryArenaChunk* kept = arena->chunks;
+    if (kept && kept->size > MEMORY_ARENA_KEEP_LIMIT) {
+        kept = NULL;
+    }
+    MemoryArenaChunk* chunk = arena->chunks;
+    while (chunk) {
+        MemoryArenaChunk* next = chunk->next;
+        if (chunk != kept) {
+            MemoryFree(chunk);
+        }
+        chunk = next;
+    }
+    if (kept) {
+        kept->next = NULL;
+    }
+    arena->chunks = kept;
+    arena->used = 0;
+}
+
+/**
+ * @brief Releases an arena and all of its chunks.
+ *
+ * @param arena The arena.
+ */
+void MemoryArenaFree(MemoryArena* arena) {
+    while (arena->chunks) {
+        MemoryArenaChunk* next = arena->chunks->next;
+        MemoryFree(arena->chunks);
+        arena->chunks = next;
+    }
+    arena->used = 0;
+}
+
+/**
+ * @brief Gets the display name of a subsystem.
+ *
+ * @param tag The subsystem.
+ * @return The name.
+ */
+const char* MemoryTagName(MemoryTag tag) {
+    return (unsigned)tag < MEMORY_TAG_COUNT ? g_tagNames[tag] : "Unknown";
+}
+
+/**
+ * @brief Takes a snapshot of the memory usage.
+ *
+ * Threads publish their counts in batches, so live bytes may trail the
+ * true value by a few tens of kilobytes per thread.
+ *
+ * @param[out] stats Receives the usage.
+ */
+void MemoryGetStats(MemoryStats* stats) {
+    Publish(&g_cache);
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        int64_t live = LoadCounter(&g_counters[tag].liveBytes);
+        // Other threads may have published frees before the matching allocations
+        stats->tags[tag].liveBytes = live > 0 ? (uint64_t)live : 0;
+        stats->tags[tag].peakBytes = (uint64_t)LoadCounter(&g_counters[tag].peakBytes);
+        stats->tags[tag].allocations = (uint64_t)LoadCounter(&g_counters[tag].allocations);
+    }
+    stats->poolBytes = (uint64_t)LoadCounter(&g_poolBytes);
+    stats->pooledAllocations = (uint64_t)LoadCounter(&g_pooledAllocations);
+}
+
+/**
+ * @brief Lowers the peak of every subsystem to its live bytes.
+ *
+ * Lets the peaks of a single task be measured.
+ */
+void MemoryResetPeaks(void) {
+    Publish(&g_cache);
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        int64_t live = LoadCounter(&g_counters[tag].liveBytes);
+        int64_t peak = LoadCounter(&g_counters[tag].peakBytes);
+        ThreadAtomicCompareExchange64(&g_counters[tag].peakBytes, peak, live > 0 ? live : 0);
+    }
+}
+
+/**
+ * @brief Appends formatted text to a report, counting what does not fit.
+ *
+ * @param buffer The report buffer; may be NULL if capacity is 0.
+ * @param capacity Size of the buffer.
+ * @param length Length of the report so far, updated.
+ * @param format printf-style format.
+ */
+static void ReportAppend(char* buffer, size_t capacity, size_t* length, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    char* end = *length < capacity ? buffer + *length : NULL;
+    int written = vsnprintf(end, end ? capacity - *length : 0, format, args);
+    va_end(args);
+    if (written > 0) {
+        *length += (size_t)written;
+    }
+}
+
+/**
+ * @brief Formats the memory usage as a report.
+ *
+ * @param format The layout of the report.
+ * @param buffer Receives the NUL-terminated report; may be NULL if capacity is 0.
+ * @param capacity Size of the buffer.
+ * @return The length of the full report, which was truncated if not less than capacity.
+ */
+size_t MemoryFormatReport(MemoryReportFormat format, char* buffer, size_t capacity) {
+    MemoryStats stats;
+    MemoryGetStats(&stats);
+    size_t length = 0;
+    if (capacity > 0) {
+        buffer[0] = '\0';
+    }
+
+    uint64_t totalLive = 0;
+    uint64_t totalAllocations = 0;
+    if (format == MEMORY_REPORT_JSON) {
+        ReportAppend(buffer, capacity, &length, "{\"subsystems\": {");
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+            const MemoryTagStats* usage = &stats.tags[tag];
+            ReportAppend(buffer, capacity, &length,
+                         "%s\"%s\": {\"live_bytes\": %llu, \"peak_bytes\": %llu, \"allocations\": %llu}",
+                         tag ? ", " : "", g_tagNames[tag], (unsigned long long)usage->liveBytes,
+                         (unsigned long long)usage->peakBytes, (unsigned long long)usage->allocations);
+        }
+        ReportAppend(buffer, capacity, &length, "}, \"pool_bytes\": %llu, \"pooled_allocations\": %llu}",
+                     (unsigned long long)stats.poolBytes, (unsigned long long)stats.pooledAllocations);
+        return length;
+    }
+
+    ReportAppend(buffer, capacity, &length, "%-12s %12s %12s %14s\n", "Subsystem", "Live KB", "Peak KB",
+                 "Allocations");
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        const MemoryTagStats* usage = &stats.tags[tag];
+        ReportAppend(buffer, capacity, &length, "%-12s %12llu %12llu %14llu\n", g_tagNames[tag],
+                     (unsigned long long)((usage->liveBytes + 1023) / 1024),
+                     (unsigned long long)((usage->peakBytes + 1023) / 1024),
+                     (unsigned long long)usage->allocations);
+        totalLive += usage->liveBytes;
+        totalAllocations += usage->allocations;
+    }
+    ReportAppend(buffer, capacity, &length, "%-12s %12llu %12s %14llu\n", "Total",
+                 (unsigned long long)((totalLive + 1023) / 1024), "", (unsigned long long)totalAllocations);
+    ReportAppend(buffer, capacity, &length, "Pools: %llu KB of slabs, %llu allocations served\n",
+                 (unsigned long long)(stats.poolBytes / 1024), (unsigned long long)stats.pooledAllocations);
+    return length;
+}
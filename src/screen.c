@@ -0,0 +1,665 @@
+/**
+ * @file screen.c
+ * @brief Character cell screen implementation for the Professional Text Editor
+ *
+ * Contains the front and back grids, the detection of rows moved as a
+ * block, and the emission of VT100/xterm escape sequences for the cells
+ * that changed.
+ */
+
+#include "../include/screen.h"
+#include "../include/hash.h"
+#include "../include/memory.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Code point of an empty cell
+#define SCREEN_BLANK ' '
+
+// Escape sequences of fixed text, passed to Emit with their length taken from the literal
+#define SCREEN_RESET_AND_CLEAR "\x1b[0m\x1b[H\x1b[2J"  // Default attributes, home, erase the display
+#define SCREEN_HIDE_CURSOR "\x1b[?25l"
+#define SCREEN_SHOW_CURSOR "\x1b[?25h"
+#define SCREEN_RESET_REGION "\x1b[r"                   // Scroll region back to the whole screen
+#define SCREEN_ERASE_LINE "\x1b[K"                     // Erase to the end of the line
+#define SCREEN_LITERAL_LENGTH(literal) (sizeof(literal) - 1)
+
+struct Screen {
+    unsigned rows;
+    unsigned columns;
+    ScreenCell* front;              // What the terminal shows
+    ScreenCell* back;               // What the next flush should show
+    uint64_t* frontHashes;          // Per-row hashes, computed while flushing
+    uint64_t* backHashes;
+    unsigned regionTop;             // Rows searched for block moves
+    unsigned regionBottom;
+    bool redraw;                    // The front grid does not match the terminal
+    unsigned cursorRow;             // Where the cursor is left after a flush
+    unsigned cursorColumn;
+    bool cursorVisible;
+
+    // Terminal state while emitting
+    unsigned row;
+    unsigned column;
+    bool positionKnown;             // False after writing the last column or scrolling
+    uint8_t attributes;
+    bool cursorShown;
+
+    char* output;
+    size_t outputLength;
+    size_t outputCapacity;
+    bool outputFailed;
+    ScreenStats stats;
+};
+
+/**
+ * @brief Compares two cells.
+ *
+ * @param a First cell.
+ * @param b Second cell.
+ * @return true if they show the same thing.
+ */
+static bool CellsEqual(const ScreenCell* a, const ScreenCell* b) {
+    return a->codepoint == b->codepoint && a->attributes == b->attributes;
+}
+
+/**
+ * @brief Checks whether a cell is empty, as clearing the terminal leaves it.
+ *
+ * @param cell The cell.
+ * @return true for a space without attributes.
+ */
+static bool IsBlank(const ScreenCell* cell) {
+    return cell->codepoint == SCREEN_BLANK && cell->attributes == 0;
+}
+
+/**
+ * @brief Empties cells.
+ *
+ * @param cells The cells.
+ * @param count Number of cells.
+ */
+static void ClearCells(ScreenCell* cells, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        cells[i].codepoint = SCREEN_BLANK;
+        cells[i].attributes = 0;
+    }
+}
+
+/**
+ * @brief Hashes the cells of a row.
+ *
+ * @param cells The first cell of the row, or NULL for a blank row.
+ * @param columns Number of cells.
+ * @return The hash.
+ */
+static uint64_t HashRow(const ScreenCell* cells, unsigned columns) {
+    uint64_t hash = columns;
+    for (unsigned i = 0; i < columns; i++) {
+        uint64_t cell = cells ? ((uint64_t)cells[i].attributes << 32 | cells[i].codepoint) : SCREEN_BLANK;
+        hash = HashMix64(hash ^ cell);
+    }
+    return hash;
+}
+
+/**
+ * @brief Appends bytes to the output.
+ *
+ * @param screen The screen.
+ * @param bytes The bytes.
+ * @param length Number of bytes.
+ */
+static void Emit(Screen* screen, const char* bytes, size_t length) {
+    if (screen->outputLength + length > screen->outputCapacity) {
+        size_t capacity = screen->outputCapacity ? screen->outputCapacity * 2 : 4096;
+        while (capacity < screen->outputLength + length) {
+            capacity *= 2;
+        }
+        char* output = (char*)MemoryRealloc(MEMORY_TAG_SCREEN, screen->output, capacity);
+        if (!output) {
+            screen->outputFailed = true;
+            return;
+        }
+        screen->output = output;
+        screen->outputCapacity = capacity;
+    }
+    memcpy(screen->output + screen->outputLength, bytes, length);
+    screen->outputLength += length;
+}
+
+/**
+ * @brief Appends a formatted escape sequence to the output.
+ *
+ * @param screen The screen.
+ * @param format printf format.
+ */
+static void EmitFormat(Screen* screen, const char* format, ...) {
+    char sequence[32];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(sequence, sizeof(sequence), format, arguments);
+    va_end(arguments);
+    if (length > 0 && (size_t)length < sizeof(sequence)) {
+        Emit(screen, sequence, (size_t)length);
+    }
+}
+
+/**
+ * @brief Moves the terminal cursor unless it is already there.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column The column.
+ */
+static void MoveTo(Screen* screen, unsigned row, unsigned column) {
+    if (screen->positionKnown && screen->row == row && screen->column == column) {
+        return;
+    }
+    if (screen->positionKnown && screen->row == row && column == 0) {
+        Emit(screen, "\r", 1);
+    } else {
+        EmitFormat(screen, "\x1b[%u;%uH", row + 1, column + 1);
+    }
+    screen->row = row;
+    screen->column = column;
+    screen->positionKnown = true;
+}
+
+/**
+ * @brief Selects the attributes of the cells written next.
+ *
+ * @param screen The screen.
+ * @param attributes SCREEN_ATTRIBUTE_ flags.
+ */
+static void SetAttributes(Screen* screen, uint8_t attributes) {
+    if (screen->attributes == attributes) {
+        return;
+    }
+    char sequence[16] = "\x1b[0";
+    size_t length = 3;
+    if (attributes & SCREEN_ATTRIBUTE_BOLD) {
+        memcpy(sequence + length, ";1", 2);
+        length += 2;
+    }
+    if (attributes & SCREEN_ATTRIBUTE_UNDERLINE) {
+        memcpy(sequence + length, ";4", 2);
+        length += 2;
+    }
+    if (attributes & SCREEN_ATTRIBUTE_REVERSE) {
+        memcpy(sequence + length, ";7", 2);
+        length += 2;
+    }
+    sequence[length++] = 'm';
+    Emit(screen, sequence, length);
+    screen->attributes = attributes;
+}
+
+/**
+ * @brief Writes one cell at the terminal cursor.
+ *
+ * Control characters, which the terminal would act on, are shown as '?'.
+ *
+ * @param screen The screen.
+ * @param cell The cell.
+ */
+static void EmitCell(Screen* screen, const ScreenCell* cell) {
+    uint32_t c = cell->codepoint;
+    if (c < 0x20 || (c >= 0x7F && c < 0xA0) || c > 0x10FFFF || (c >= 0xD800 && c < 0xE000)) {
+        c = '?';
+    }
+
+    char bytes[4];
+    size_t length;
+    if (c < 0x80) {
+        bytes[0] = (char)c;
+        length = 1;
+    } else if (c < 0x800) {
+        bytes[0] = (char)(0xC0 | (c >> 6));
+        bytes[1] = (char)(0x80 | (c & 0x3F));
+        length = 2;
+    } else if (c < 0x10000) {
+        bytes[0] = (char)(0xE0 | (c >> 12));
+        bytes[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (c & 0x3F));
+        length = 3;
+    } else {
+        bytes[0] = (char)(0xF0 | (c >> 18));
+        bytes[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+        bytes[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+        bytes[3] = (char)(0x80 | (c & 0x3F));
+        length = 4;
+    }
+    SetAttributes(screen, cell->attributes);
+    Emit(screen, bytes, length);
+    screen->stats.cellsWritten++;
+
+    // After the last column the terminal waits to wrap; the position is not reliable
+    if (++screen->column == screen->columns) {
+        screen->positionKnown = false;
+    }
+}
+
+/**
+ * @brief Hides the cursor before the first change of a frame.
+ *
+ * @param screen The screen.
+ */
+static void BeginChanges(Screen* screen) {
+    if (screen->cursorShown) {
+        Emit(screen, SCREEN_HIDE_CURSOR, SCREEN_LITERAL_LENGTH(SCREEN_HIDE_CURSOR));
+        screen->cursorShown = false;
+    }
+}
+
+/**
+ * @brief Scrolls the scroll region when its rows moved as a block.
+ *
+ * The shift that lines up the most rows of the back grid with rows of the
+ * front grid is used when it lines up more rows than leaving them in place.
+ * Blank rows are not counted, since they match wherever they go.
+ *
+ * @param screen The screen.
+ */
+static void ScrollMovedRows(Screen* screen) {
+    unsigned columns = screen->columns;
+    unsigned top = screen->regionTop;
+    unsigned bottom = screen->regionBottom < screen->rows ? screen->regionBottom : screen->rows - 1;
+    if (top + 2 > bottom) {
+        return;
+    }
+
+    uint64_t blankHash = HashRow(NULL, columns);
+    unsigned unchanged = 0;
+    for (unsigned row = top; row <= bottom; row++) {
+        screen->frontHashes[row] = HashRow(screen->front + (size_t)row * columns, columns);
+        screen->backHashes[row] = HashRow(screen->back + (size_t)row * columns, columns);
+        unchanged += screen->backHashes[row] == screen->frontHashes[row] && screen->backHashes[row] != blankHash;
+    }
+
+    // Positive shifts move content up (scrolling forward), negative ones down
+    int bestShift = 0;
+    unsigned best = unchanged;
+    int height = (int)(bottom - top + 1);
+    for (int shift = 1; shift < height; shift++) {
+        unsigned up = 0;
+        unsigned down = 0;
+        for (unsigned row = top; row + (unsigned)shift <= bottom; row++) {
+            uint64_t moved = screen->backHashes[row];
+            up += moved != blankHash && moved == screen->frontHashes[row + (unsigned)shift];
+            moved = screen->backHashes[row + (unsigned)shift];
+            down += moved != blankHash && moved == screen->frontHashes[row];
+        }
+        if (up > best) {
+            best = up;
+            bestShift = shift;
+        }
+        if (down > best) {
+            best = down;
+            bestShift = -shift;
+        }
+    }
+    if (bestShift == 0) {
+        return;
+    }
+
+    // New rows take the current background, so attributes are reset first
+    BeginChanges(screen);
+    SetAttributes(screen, 0);
+    EmitFormat(screen, "\x1b[%u;%ur", top + 1, bottom + 1);
+    unsigned distance = (unsigned)(bestShift > 0 ? bestShift : -bestShift);
+    screen->positionKnown = false;
+    if (bestShift > 0) {
+        MoveTo(screen, bottom, 0);
+        for (unsigned i = 0; i < distance; i++) {
+            Emit(screen, "\n", 1);
+        }
+    } else {
+        MoveTo(screen, top, 0);
+        for (unsigned i = 0; i < distance; i++) {
+            Emit(screen, "\x1bM", 2);
+        }
+    }
+    Emit(screen, SCREEN_RESET_REGION, SCREEN_LITERAL_LENGTH(SCREEN_RESET_REGION));
+    screen->positionKnown = false;
+    screen->stats.scrolls++;
+
+    // Move the front grid the same way
+    ScreenCell* region = screen->front + (size_t)top * columns;
+    size_t kept = (size_t)(height - (int)distance) * columns;
+    size_t vacated = (size_t)distance * columns;
+    if (bestShift > 0) {
+        memmove(region, region + vacated, kept * sizeof(ScreenCell));
+        ClearCells(region + kept, vacated);
+    } else {
+        memmove(region + vacated, region, kept * sizeof(ScreenCell));
+        ClearCells(region, vacated);
+    }
+}
+
+/**
+ * @brief Emits the changes of one row.
+ *
+ * Runs of changed cells are written, including short unchanged gaps
+ * between them; a row whose rest became blank is cleared with one sequence.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ */
+static void FlushRow(Screen* screen, unsigned row) {
+    unsigned columns = screen->columns;
+    ScreenCell* front = screen->front + (size_t)row * columns;
+    const ScreenCell* back = screen->back + (size_t)row * columns;
+
+    unsigned backBlankFrom = columns;
+    while (backBlankFrom > 0 && IsBlank(&back[backBlankFrom - 1])) {
+        backBlankFrom--;
+    }
+
+    unsigned column = 0;
+    while (column < columns) {
+        if (CellsEqual(&front[column], &back[column])) {
+            column++;
+            continue;
+        }
+        BeginChanges(screen);
+
+        // Clearing to the end of the line beats writing spaces
+        if (column >= backBlankFrom && columns - column > SCREEN_MAX_REWRITE_GAP) {
+            MoveTo(screen, row, column);
+            SetAttributes(screen, 0);
+            Emit(screen, SCREEN_ERASE_LINE, SCREEN_LITERAL_LENGTH(SCREEN_ERASE_LINE));
+            ClearCells(front + column, columns - column);
+            return;
+        }
+
+        unsigned end = column + 1;
+        for (unsigned next = end; next < columns && next - end <= SCREEN_MAX_REWRITE_GAP; next++) {
+            if (!CellsEqual(&front[next], &back[next])) {
+                end = next + 1;
+            }
+        }
+        MoveTo(screen, row, column);
+        for (; column < end; column++) {
+            EmitCell(screen, &back[column]);
+            front[column] = back[column];
+        }
+    }
+}
+
+/**
+ * @brief Creates a screen; the first flush redraws every cell.
+ *
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ * @return The screen, or NULL on allocation failure.
+ */
+Screen* ScreenCreate(unsigned rows, unsigned columns) {
+    Screen* screen = (Screen*)MemoryCalloc(MEMORY_TAG_SCREEN, 1, sizeof(Screen));
+    if (!screen) {
+        return NULL;
+    }
+    screen->cursorShown = true;
+    if (!ScreenResize(screen, rows, columns)) {
+        MemoryFree(screen);
+        return NULL;
+    }
+    return screen;
+}
+
+/**
+ * @brief Destroys a screen.
+ *
+ * @param screen The screen. NULL is ignored.
+ */
+void ScreenDestroy(Screen* screen) {
+    if (!screen) {
+        return;
+    }
+    MemoryFree(screen->front);
+    MemoryFree(screen->back);
+    MemoryFree(screen->frontHashes);
+    MemoryFree(screen->backHashes);
+    MemoryFree(screen->output);
+    MemoryFree(screen);
+}
+
+/**
+ * @brief Changes the size of a screen; the next flush redraws every cell.
+ *
+ * @param screen The screen.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ * @return true if successful, false on allocation failure (the screen keeps its size).
+ */
+bool ScreenResize(Screen* screen, unsigned rows, unsigned columns) {
+    rows = rows > 0 ? rows : 1;
+    columns = columns > 0 ? columns : 1;
+    size_t cellCount = (size_t)rows * columns;
+    ScreenCell* front = (ScreenCell*)MemoryAlloc(MEMORY_TAG_SCREEN, cellCount * sizeof(ScreenCell));
+    ScreenCell* back = (ScreenCell*)MemoryAlloc(MEMORY_TAG_SCREEN, cellCount * sizeof(ScreenCell));
+    uint64_t* frontHashes = (uint64_t*)MemoryAlloc(MEMORY_TAG_SCREEN, rows * sizeof(uint64_t));
+    uint64_t* backHashes = (uint64_t*)MemoryAlloc(MEMORY_TAG_SCREEN, rows * sizeof(uint64_t));
+    if (!front || !back || !frontHashes || !backHashes) {
+        MemoryFree(front);
+        MemoryFree(back);
+        MemoryFree(frontHashes);
+        MemoryFree(backHashes);
+        return false;
+    }
+
+    MemoryFree(screen->front);
+    MemoryFree(screen->back);
+    MemoryFree(screen->frontHashes);
+    MemoryFree(screen->backHashes);
+    screen->front = front;
+    screen->back = back;
+    screen->frontHashes = frontHashes;
+    screen->backHashes = backHashes;
+    screen->rows = rows;
+    screen->columns = columns;
+    ClearCells(back, cellCount);
+    ScreenSetScrollRegion(screen, 0, rows - 1);
+    ScreenInvalidate(screen);
+    return true;
+}
+
+/**
+ * @brief Gets the number of rows of a screen.
+ *
+ * @param screen The screen.
+ * @return The number of rows.
+ */
+unsigned ScreenRows(const Screen* screen) {
+    return screen->rows;
+}
+
+/**
+ * @brief Gets the number of columns of a screen.
+ *
+ * @param screen The screen.
+ * @return The number of columns.
+ */
+unsigned ScreenColumns(const Screen* screen) {
+    return screen->columns;
+}
+
+/**
+ * @brief Sets the rows in which block moves are looked for.
+ *
+ * @param screen The screen.
+ * @param top First row of the region.
+ * @param bottom Last row of the region.
+ */
+void ScreenSetScrollRegion(Screen* screen, unsigned top, unsigned bottom) {
+    screen->regionTop = top;
+    screen->regionBottom = bottom < screen->rows ? bottom : screen->rows - 1;
+}
+
+/**
+ * @brief Makes the next flush redraw every cell, as after the terminal lost its content.
+ *
+ * @param screen The screen.
+ */
+void ScreenInvalidate(Screen* screen) {
+    screen->redraw = true;
+}
+
+/**
+ * @brief Fills a row of the back grid from a column to its end.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column First column to fill.
+ * @param codepoint Code point of every cell.
+ * @param attributes Attributes of every cell.
+ */
+void ScreenFill(Screen* screen, unsigned row, unsigned column, uint32_t codepoint, uint8_t attributes) {
+    if (row >= screen->rows) {
+        return;
+    }
+    ScreenCell* cells = screen->back + (size_t)row * screen->columns;
+    for (unsigned i = column; i < screen->columns; i++) {
+        cells[i].codepoint = codepoint;
+        cells[i].attributes = attributes;
+    }
+}
+
+/**
+ * @brief Sets one cell of the back grid; cells outside the screen are ignored.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column The column.
+ * @param codepoint Code point shown in the cell.
+ * @param attributes SCREEN_ATTRIBUTE_ flags.
+ */
+void ScreenPut(Screen* screen, unsigned row, unsigned column, uint32_t codepoint, uint8_t attributes) {
+    if (row < screen->rows && column < screen->columns) {
+        ScreenCell* cell = &screen->back[(size_t)row * screen->columns + column];
+        cell->codepoint = codepoint;
+        cell->attributes = attributes;
+    }
+}
+
+/**
+ * @brief Writes ASCII text into the back grid, one cell per byte, clipped at the row end.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column First column.
+ * @param text The text.
+ * @param length Length of the text.
+ * @param attributes Attributes of the cells.
+ * @return Column just past the text.
+ */
+unsigned ScreenPutText(Screen* screen, unsigned row, unsigned column, const char* text, size_t length,
+                       uint8_t attributes) {
+    for (size_t i = 0; i < length && column < screen->columns; i++, column++) {
+        ScreenPut(screen, row, column, (unsigned char)text[i], attributes);
+    }
+    return column;
+}
+
+/**
+ * @brief Sets the attributes of cells of the back grid, keeping their code points.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column First column.
+ * @param count Number of cells; clipped at the row end.
+ * @param attributes The attributes.
+ */
+void ScreenSetAttributes(Screen* screen, unsigned row, unsigned column, unsigned count, uint8_t attributes) {
+    if (row >= screen->rows) {
+        return;
+    }
+    ScreenCell* cells = screen->back + (size_t)row * screen->columns;
+    for (unsigned i = column; i < screen->columns && i - column < count; i++) {
+        cells[i].attributes = attributes;
+    }
+}
+
+/**
+ * @brief Sets where the terminal cursor is left after the next flush.
+ *
+ * @param screen The screen.
+ * @param row The row.
+ * @param column The column.
+ * @param visible false to hide the cursor.
+ */
+void ScreenSetCursor(Screen* screen, unsigned row, unsigned column, bool visible) {
+    screen->cursorRow = row < screen->rows ? row : screen->rows - 1;
+    screen->cursorColumn = column < screen->columns ? column : screen->columns - 1;
+    screen->cursorVisible = visible;
+}
+
+/**
+ * @brief Makes the terminal show the back grid.
+ *
+ * @param screen The screen.
+ * @param[out] length Receives the number of bytes to write to the terminal.
+ * @return The bytes, valid until the next call; NULL on allocation failure.
+ */
+const char* ScreenFlush(Screen* screen, size_t* length) {
+    screen->outputLength = 0;
+    screen->outputFailed = false;
+
+    if (screen->redraw) {
+        // Reset attributes and clear; the front grid then matches a blank terminal
+        screen->cursorShown = true;
+        BeginChanges(screen);
+        Emit(screen, SCREEN_RESET_AND_CLEAR, SCREEN_LITERAL_LENGTH(SCREEN_RESET_AND_CLEAR));
+        ClearCells(screen->front, (size_t)screen->rows * screen->columns);
+        screen->attributes = 0;
+        screen->row = 0;
+        screen->column = 0;
+        screen->positionKnown = true;
+        screen->redraw = false;
+    } else {
+        ScrollMovedRows(screen);
+    }
+
+    for (unsigned row = 0; row < screen->rows; row++) {
+        FlushRow(screen, row);
+    }
+
+    // Leave the cursor where the caret is
+    bool changed = screen->outputLength > 0;
+    if (screen->cursorVisible) {
+        if (changed || !screen->cursorShown || !screen->positionKnown || screen->row != screen->cursorRow ||
+            screen->column != screen->cursorColumn) {
+            MoveTo(screen, screen->cursorRow, screen->cursorColumn);
+        }
+        if (!screen->cursorShown) {
+            Emit(screen, SCREEN_SHOW_CURSOR, SCREEN_LITERAL_LENGTH(SCREEN_SHOW_CURSOR));
+            screen->cursorShown = true;
+        }
+    } else {
+        BeginChanges(screen);
+    }
+
+    if (screen->outputFailed) {
+        ScreenInvalidate(screen);
+        return NULL;
+    }
+    if (screen->outputLength > 0) {
+        screen->stats.frames++;
+        screen->stats.bytesWritten += screen->outputLength;
+    }
+    *length = screen->outputLength;
+    return screen->output;
+}
+
+/**
+ * @brief Gets the work done by the flushes so far.
+ *
+ * @param screen The screen.
+ * @param[out] stats Receives the statistics.
+ */
+void ScreenGetStats(const Screen* screen, ScreenStats* stats) {
+    if (stats) {
+        *stats = screen->stats;
+    }
+}
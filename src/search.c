@@ -0,0 +1,221 @@
+/**
+ * @file search.c
+ * @brief Literal text search implementation for the Professional Text Editor
+ *
+ * Contains the matcher that scans document spans in place. Candidates are
+ * located with memchr on the first pattern byte; only matches straddling a
+ * span boundary are copied into a small window.
+ */
+
+#include "../include/search.h"
+#include <string.h>
+
+// Result slot filled by the SearchFindNext callback
+typedef struct {
+    uint64_t offset;
+    bool found;
+} FirstMatch;
+
+/**
+ * @brief Folds an ASCII letter to lower case.
+ *
+ * @param c The byte.
+ * @return The folded byte.
+ */
+static unsigned char FoldCase(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+/**
+ * @brief Compares two byte ranges, optionally ignoring ASCII case.
+ *
+ * @param a First range.
+ * @param b Second range.
+ * @param length Number of bytes to compare.
+ * @param matchCase false to ignore ASCII case.
+ * @return true if the ranges are equal.
+ */
+static bool BytesEqual(const char* a, const char* b, size_t length, bool matchCase) {
+    if (matchCase) {
+        return memcmp(a, b, length) == 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (FoldCase((unsigned char)a[i]) != FoldCase((unsigned char)b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the next byte that can start a match.
+ *
+ * @param data Bytes to scan.
+ * @param length Number of bytes.
+ * @param first First byte of the pattern.
+ * @param matchCase false to accept either case of an ASCII letter.
+ * @return Pointer to the candidate, or NULL if none.
+ */
+static const char* FindCandidate(const char* data, size_t length, unsigned char first, bool matchCase) {
+    unsigned char lower = FoldCase(first);
+    unsigned char upper = (lower >= 'a' && lower <= 'z') ? (unsigned char)(lower - ('a' - 'A')) : lower;
+    if (matchCase || lower == upper) {
+        return (const char*)memchr(data, first, length);
+    }
+
+    // Two memchr passes beat a byte loop; the second is bounded by the first hit
+    const char* hitLower = (const char*)memchr(data, lower, length);
+    size_t limit = hitLower ? (size_t)(hitLower - data) : length;
+    const char* hitUpper = (const char*)memchr(data, upper, limit);
+    return hitUpper ? hitUpper : hitLower;
+}
+
+/**
+ * @brief Reports every non-overlapping occurrence of a pattern in a range.
+ *
+ * @param document The document to search.
+ * @param pattern The text to find.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param from Start of the searched range.
+ * @param to End of the searched range (matches must end at or before it).
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param callback Invoked for each match in ascending order.
+ * @param context Pointer passed to the callback.
+ * @return Number of matches reported.
+ */
+uint64_t SearchFindAll(const Document* document, const char* pattern, size_t patternLength, uint64_t from,
+                       uint64_t to, bool matchCase, SearchMatchCallback callback, void* context) {
+    if (!document || !pattern || patternLength == 0 || patternLength > SEARCH_MAX_PATTERN || !callback) {
+        return 0;
+    }
+
+    uint64_t length = DocumentLength(document);
+    if (to > length) {
+        to = length;
+    }
+    if (from >= to || to - from < patternLength) {
+        return 0;
+    }
+
+    DocumentIterator iterator;
+    DocumentIterInit(document, from, &iterator);
+
+    unsigned char first = (unsigned char)pattern[0];
+    uint64_t matches = 0;
+    uint64_t spanOffset = from;
+    uint64_t resumeAt = from; // Matches never overlap, so skip past the last one
+    const char* span;
+    size_t spanLength;
+    while (spanOffset + patternLength <= to && DocumentIterNext(&iterator, &span, &spanLength)) {
+        size_t i = resumeAt > spanOffset ? (size_t)(resumeAt - spanOffset) : 0;
+        while (i < spanLength) {
+            const char* hit = FindCandidate(span + i, spanLength - i, first, matchCase);
+            if (!hit) {
+                break;
+            }
+            i = (size_t)(hit - span);
+
+            uint64_t position = spanOffset + i;
+            if (position + patternLength > to) {
+                return matches;
+            }
+
+            bool matched;
+            if (spanLength - i >= patternLength) {
+                matched = BytesEqual(hit, pattern, patternLength, matchCase);
+            } else {
+                char window[SEARCH_MAX_PATTERN];
+                matched = DocumentRead(document, position, window, patternLength) == patternLength &&
+                          BytesEqual(window, pattern, patternLength, matchCase);
+            }
+
+            if (matched) {
+                matches++;
+                if (!callback(position, context)) {
+                    return matches;
+                }
+                resumeAt = position + patternLength;
+                i += patternLength;
+            } else {
+                i++;
+            }
+        }
+        spanOffset += spanLength;
+    }
+    return matches;
+}
+
+/**
+ * @brief Records the first match and stops the search.
+ *
+ * @param offset Offset of the match.
+ * @param context Pointer to a FirstMatch.
+ * @return Always false.
+ */
+static bool StopAtFirstMatch(uint64_t offset, void* context) {
+    FirstMatch* result = (FirstMatch*)context;
+    result->offset = offset;
+    result->found = true;
+    return false;
+}
+
+/**
+ * @brief Finds the first occurrence of a pattern at or after an offset.
+ *
+ * @param document The document to search.
+ * @param pattern The text to find.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param from Offset at which the search starts.
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param[out] matchOffset Receives the offset of the match.
+ * @return true if a match was found, false otherwise.
+ */
+bool SearchFindNext(const Document* document, const char* pattern, size_t patternLength, uint64_t from,
+                    bool matchCase, uint64_t* matchOffset) {
+    if (!matchOffset) {
+        return false;
+    }
+
+    FirstMatch result = { 0, false };
+    SearchFindAll(document, pattern, patternLength, from, UINT64_MAX, matchCase, StopAtFirstMatch, &result);
+    if (result.found) {
+        *matchOffset = result.offset;
+    }
+    return result.found;
+}
+
+/**
+ * @brief Finds the first occurrence of a pattern in a buffer.
+ *
+ * @param text The buffer, such as a part of a mapped file.
+ * @param length Length of the buffer.
+ * @param pattern The text to find.
+ * @param patternLength Length of the pattern (1..SEARCH_MAX_PATTERN).
+ * @param matchCase false to compare ASCII letters case-insensitively.
+ * @param[out] matchOffset Receives the offset of the match in the buffer.
+ * @return true if a match was found, false otherwise.
+ */
+bool SearchFindInText(const char* text, size_t length, const char* pattern, size_t patternLength, bool matchCase,
+                      size_t* matchOffset) {
+    if (!text || !pattern || patternLength == 0 || patternLength > SEARCH_MAX_PATTERN || !matchOffset ||
+        length < patternLength) {
+        return false;
+    }
+
+    unsigned char first = (unsigned char)pattern[0];
+    size_t last = length - patternLength; // Last offset at which a match fits
+    size_t i = 0;
+    while (i <= last) {
+        const char* hit = FindCandidate(text + i, last + 1 - i, first, matchCase);
+        if (!hit) {
+            return false;
+        }
+        i = (size_t)(hit - text);
+        if (BytesEqual(hit, pattern, patternLength, matchCase)) {
+            *matchOffset = i;
+            return true;
+        }
+        i++;
+    }
+    return false;
+}
@@ -0,0 +1,687 @@
+/**
+ * @file session.c
+ * @brief Session snapshot and index cache implementation for the Professional Text Editor
+ *
+ * Contains the manifest and sidecar readers and writers. All integers are
+ * stored little-endian; line starts are stored as variable-length deltas,
+ * which takes about one byte per line for typical text.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // For ftello and fseeko
+#define _FILE_OFFSET_BITS 64    // Sections beyond 2 GB on 32-bit builds
+#endif
+
+#include "../include/session.h"
+#include "../include/hash.h"
+#include "../include/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File format identifiers
+#define SESSION_MANIFEST_MAGIC "PTESESS1"
+#define SESSION_INDEX_MAGIC "PTEINDEX"
+#define SESSION_FORMAT_VERSION 1
+
+// Sidecar section tags; unknown tags are skipped by readers
+#define SESSION_SECTION_LINE_STARTS 1
+#define SESSION_SECTION_FOLDS 2
+
+// Content sampling used by SessionComputeDocumentKey
+#define SESSION_HASH_EDGE_BYTES (64 * 1024)
+#define SESSION_HASH_SAMPLE_BYTES (4 * 1024)
+#define SESSION_HASH_SAMPLE_COUNT 16
+
+// Size of the staging buffer used while encoding line starts
+#define SESSION_ENCODE_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Gets the position in a file with 64-bit offsets.
+ *
+ * @param file The file.
+ * @return The position, or -1 on failure.
+ */
+static int64_t FileTell(FILE* file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return (int64_t)ftello(file);
+#endif
+}
+
+/**
+ * @brief Moves the position in a file with 64-bit offsets.
+ *
+ * @param file The file.
+ * @param offset The offset.
+ * @param origin SEEK_SET, SEEK_CUR or SEEK_END.
+ * @return true if successful, false otherwise.
+ */
+static bool FileSeek(FILE* file, int64_t offset, int origin) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, origin) == 0;
+#else
+    return fseeko(file, (off_t)offset, origin) == 0;
+#endif
+}
+
+/**
+ * @brief Writes a little-endian 32-bit value.
+ *
+ * @param file The output file.
+ * @param value The value to write.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteU32(FILE* file, uint32_t value) {
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+}
+
+/**
+ * @brief Writes a little-endian 64-bit value.
+ *
+ * @param file The output file.
+ * @param value The value to write.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteU64(FILE* file, uint64_t value) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+}
+
+/**
+ * @brief Reads a little-endian 32-bit value.
+ *
+ * @param file The input file.
+ * @param[out] value Receives the value.
+ * @return true if successful, false otherwise.
+ */
+static bool ReadU32(FILE* file, uint32_t* value) {
+    unsigned char bytes[4];
+    if (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)) {
+        return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        *value |= (uint32_t)bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a little-endian 64-bit value.
+ *
+ * @param file The input file.
+ * @param[out] value Receives the value.
+ * @return true if successful, false otherwise.
+ */
+static bool ReadU64(FILE* file, uint64_t* value) {
+    unsigned char bytes[8];
+    if (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)) {
+        return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 8; i++) {
+        *value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a length-prefixed string.
+ *
+ * @param file The output file.
+ * @param text The string to write.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteString(FILE* file, const char* text) {
+    uint32_t length = (uint32_t)strlen(text);
+    return WriteU32(file, length) && fwrite(text, 1, length, file) == length;
+}
+
+/**
+ * @brief Reads a length-prefixed string into a fixed buffer.
+ *
+ * @param file The input file.
+ * @param[out] buffer Receives the NUL-terminated string.
+ * @param bufferSize Size of the buffer in bytes.
+ * @return true if successful and the string fit, false otherwise.
+ */
+static bool ReadString(FILE* file, char* buffer, size_t bufferSize) {
+    uint32_t length;
+    if (!ReadU32(file, &length) || length >= bufferSize) {
+        return false;
+    }
+    if (fread(buffer, 1, length, file) != length) {
+        return false;
+    }
+    buffer[length] = '\0';
+    return true;
+}
+
+/**
+ * @brief Builds a path inside the session directory.
+ *
+ * @param[out] buffer Receives the path.
+ * @param bufferSize Size of the buffer in bytes.
+ * @param sessionDir The session directory.
+ * @param fileName Name of the file inside the directory.
+ * @return true if the path fit in the buffer, false otherwise.
+ */
+static bool BuildSessionPath(char* buffer, size_t bufferSize, const char* sessionDir, const char* fileName) {
+    int written = snprintf(buffer, bufferSize, "%s/%s", sessionDir, fileName);
+    return written > 0 && (size_t)written < bufferSize;
+}
+
+/**
+ * @brief Builds the sidecar path for a document.
+ *
+ * Sidecars are named after a hash of the document path; the full path is
+ * stored inside the sidecar to reject hash collisions.
+ *
+ * @param[out] buffer Receives the path.
+ * @param bufferSize Size of the buffer in bytes.
+ * @param sessionDir The session directory.
+ * @param filePath Path of the document.
+ * @return true if the path fit in the buffer, false otherwise.
+ */
+static bool BuildIndexPath(char* buffer, size_t bufferSize, const char* sessionDir, const char* filePath) {
+    char fileName[32];
+    uint64_t pathHash = HashBytes64(filePath, strlen(filePath), 0);
+    snprintf(fileName, sizeof(fileName), "%016llx%s", (unsigned long long)pathHash, SESSION_INDEX_EXTENSION);
+    return BuildSessionPath(buffer, bufferSize, sessionDir, fileName);
+}
+
+/**
+ * @brief Replaces a file with a freshly written temporary file.
+ *
+ * @param tempPath The temporary file.
+ * @param finalPath The destination.
+ * @return true if successful, false otherwise.
+ */
+static bool CommitTempFile(const char* tempPath, const char* finalPath) {
+    remove(finalPath); // rename does not overwrite on Windows
+    if (rename(tempPath, finalPath) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the session manifest to the session directory.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param session The session to persist.
+ * @return true if successful, false otherwise.
+ */
+bool SessionSave(const char* sessionDir, const Session* session) {
+    if (!sessionDir || !session || session->documentCount > SESSION_MAX_DOCUMENTS) {
+        return false;
+    }
+
+    char finalPath[SESSION_PATH_MAX * 2];
+    char tempPath[SESSION_PATH_MAX * 2 + 8];
+    if (!BuildSessionPath(finalPath, sizeof(finalPath), sessionDir, SESSION_MANIFEST_NAME)) {
+        return false;
+    }
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", finalPath);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = fwrite(SESSION_MANIFEST_MAGIC, 1, 8, file) == 8 &&
+              WriteU32(file, SESSION_FORMAT_VERSION) &&
+              WriteU32(file, (uint32_t)session->documentCount) &&
+              WriteU32(file, (uint32_t)session->activeDocument);
+
+    for (size_t i = 0; ok && i < session->documentCount; i++) {
+        const SessionDocument* doc = &session->documents[i];
+        ok = WriteString(file, doc->filePath) &&
+             WriteU64(file, doc->view.selectionStart) &&
+             WriteU64(file, doc->view.selectionEnd) &&
+             WriteU64(file, doc->view.firstVisibleLine);
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(tempPath);
+        return false;
+    }
+    return CommitTempFile(tempPath, finalPath);
+}
+
+/**
+ * @brief Reads the session manifest from the session directory.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param[out] session Receives the session; empty if none was saved.
+ * @return true if a session was loaded, false otherwise.
+ */
+bool SessionLoad(const char* sessionDir, Session* session) {
+    if (!sessionDir || !session) {
+        return false;
+    }
+    memset(session, 0, sizeof(*session));
+
+    char path[SESSION_PATH_MAX * 2];
+    if (!BuildSessionPath(path, sizeof(path), sessionDir, SESSION_MANIFEST_NAME)) {
+        return false;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    char magic[8];
+    uint32_t version, count, active;
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              memcmp(magic, SESSION_MANIFEST_MAGIC, sizeof(magic)) == 0 &&
+              ReadU32(file, &version) && version == SESSION_FORMAT_VERSION &&
+              ReadU32(file, &count) && count <= SESSION_MAX_DOCUMENTS &&
+              ReadU32(file, &active);
+
+    for (uint32_t i = 0; ok && i < count; i++) {
+        SessionDocument* doc = &session->documents[i];
+        ok = ReadString(file, doc->filePath, sizeof(doc->filePath)) &&
+             ReadU64(file, &doc->view.selectionStart) &&
+             ReadU64(file, &doc->view.selectionEnd) &&
+             ReadU64(file, &doc->view.firstVisibleLine);
+    }
+    fclose(file);
+
+    if (!ok) {
+        memset(session, 0, sizeof(*session));
+        return false;
+    }
+
+    session->documentCount = count;
+    session->activeDocument = (active < count) ? active : 0;
+    return true;
+}
+
+/**
+ * @brief Computes the cache key for file content.
+ *
+ * @param data The file content.
+ * @param size Size of the content in bytes.
+ * @param identity Size and last write time of the file.
+ * @param[out] key Receives the key.
+ */
+void SessionComputeDocumentKey(const char* data, uint64_t size, const FileIdentity* identity, DocumentKey* key) {
+    if (!key) {
+        return;
+    }
+    memset(key, 0, sizeof(*key));
+    if (identity) {
+        key->identity = *identity;
+    }
+    if (!data) {
+        return;
+    }
+
+    uint64_t smallLimit = 2 * SESSION_HASH_EDGE_BYTES + SESSION_HASH_SAMPLE_COUNT * SESSION_HASH_SAMPLE_BYTES;
+    if (size <= smallLimit) {
+        key->contentHash = HashBytes64(data, (size_t)size, size);
+        return;
+    }
+
+    // Head, evenly spaced samples from the middle, then tail
+    uint64_t hash = HashBytes64(data, SESSION_HASH_EDGE_BYTES, size);
+    uint64_t middle = size - 2 * SESSION_HASH_EDGE_BYTES - SESSION_HASH_SAMPLE_BYTES;
+    for (uint64_t i = 0; i < SESSION_HASH_SAMPLE_COUNT; i++) {
+        uint64_t offset = SESSION_HASH_EDGE_BYTES + middle * i / (SESSION_HASH_SAMPLE_COUNT - 1);
+        hash = HashBytes64(data + offset, SESSION_HASH_SAMPLE_BYTES, hash);
+    }
+    key->contentHash = HashBytes64(data + size - SESSION_HASH_EDGE_BYTES, SESSION_HASH_EDGE_BYTES, hash);
+}
+
+/**
+ * @brief Writes the line-start section payload as variable-length deltas.
+ *
+ * @param file The output file.
+ * @param lineIndex The index to encode.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteLineStartsSection(FILE* file, const LineIndex* lineIndex) {
+    unsigned char* buffer = (unsigned char*)MemoryAlloc(MEMORY_TAG_SESSION, SESSION_ENCODE_BUFFER_SIZE);
+    if (!buffer) {
+        return false;
+    }
+
+    // The payload length is patched once the encoded size is known
+    int64_t sectionStart = FileTell(file);
+    bool ok = WriteU32(file, SESSION_SECTION_LINE_STARTS) && WriteU32(file, 0) &&
+              WriteU64(file, 0) && WriteU64(file, (uint64_t)lineIndex->count);
+
+    uint64_t payloadLength = 8;
+    size_t used = 0;
+    uint64_t previous = 0;
+    for (size_t i = 0; ok && i < lineIndex->count; i++) {
+        uint64_t delta = lineIndex->starts[i] - previous;
+        previous = lineIndex->starts[i];
+        do {
+            unsigned char byte = (unsigned char)(delta & 0x7F);
+            delta >>= 7;
+            buffer[used++] = byte | (delta ? 0x80 : 0);
+        } while (delta);
+
+        // Flush before the buffer could overflow on the next value
+        if (used > SESSION_ENCODE_BUFFER_SIZE - 10) {
+            ok = fwrite(buffer, 1, used, file) == used;
+            payloadLength += used;
+            used = 0;
+        }
+    }
+    if (ok && used > 0) {
+        ok = fwrite(buffer, 1, used, file) == used;
+        payloadLength += used;
+    }
+    MemoryFree(buffer);
+
+    int64_t sectionEnd = FileTell(file);
+    return ok && sectionStart >= 0 && sectionEnd >= 0 &&
+           FileSeek(file, sectionStart + 8, SEEK_SET) &&
+           WriteU64(file, payloadLength) &&
+           FileSeek(file, sectionEnd, SEEK_SET);
+}
+
+/**
+ * @brief Decodes a line-start section payload.
+ *
+ * @param payload The section payload.
+ * @param payloadLength Length of the payload in bytes.
+ * @param contentSize Size of the indexed content, used for validation.
+ * @param[out] lineIndex Receives the decoded index.
+ * @return true if the payload was valid, false otherwise.
+ */
+static bool DecodeLineStartsSection(const unsigned char* payload, uint64_t payloadLength,
+                                    uint64_t contentSize, LineIndex* lineIndex) {
+    if (payloadLength < 8) {
+        return false;
+    }
+
+    uint64_t count = 0;
+    for (int i = 0; i < 8; i++) {
+        count |= (uint64_t)payload[i] << (8 * i);
+    }
+    // Every line costs at least one byte, which bounds a corrupt count
+    if (count == 0 || count > payloadLength - 8 || count > contentSize + 1) {
+        return false;
+    }
+
+    uint64_t* starts = (uint64_t*)MemoryAlloc(MEMORY_TAG_DOCUMENT, (size_t)count * sizeof(uint64_t));
+    if (!starts) {
+        return false;
+    }
+
+    const unsigned char* p = payload + 8;
+    const unsigned char* end = payload + payloadLength;
+    uint64_t previous = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t delta = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            if (p >= end || shift > 63) {
+                MemoryFree(starts);
+                return false;
+            }
+            byte = *p++;
+            delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        // Starts must begin at zero and increase strictly within the content
+        previous += delta;
+        if ((i == 0 && previous != 0) || (i > 0 && delta == 0) || previous > contentSize) {
+            MemoryFree(starts);
+            return false;
+        }
+        starts[i] = previous;
+    }
+
+    LineIndexAdopt(lineIndex, starts, (size_t)count);
+    return true;
+}
+
+/**
+ * @brief Writes the fold section: the count, then the start of the first and last hidden line of each fold.
+ *
+ * @param file The output file.
+ * @param folds The folds, sorted by hideStart.
+ * @param foldCount Number of folds.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteFoldsSection(FILE* file, const Fold* folds, size_t foldCount) {
+    bool ok = WriteU32(file, SESSION_SECTION_FOLDS) && WriteU32(file, 0) &&
+              WriteU64(file, 8 + (uint64_t)foldCount * 16) && WriteU64(file, (uint64_t)foldCount);
+    for (size_t i = 0; ok && i < foldCount; i++) {
+        ok = WriteU64(file, folds[i].hideStart) && WriteU64(file, folds[i].hideLast);
+    }
+    return ok;
+}
+
+/**
+ * @brief Decodes a fold section payload.
+ *
+ * Every fold must hide whole lines of the indexed content below a header
+ * line, and the folds must be sorted, as FoldSet keeps them.
+ *
+ * @param payload The section payload.
+ * @param payloadLength Length of the payload in bytes.
+ * @param lineIndex Line-start index of the content, used for validation.
+ * @param[out] folds Receives the folds, allocated with MemoryAlloc, or NULL if there are none.
+ * @param[out] foldCount Receives the number of folds.
+ * @return true if the payload was valid, false otherwise.
+ */
+static bool DecodeFoldsSection(const unsigned char* payload, uint64_t payloadLength, const LineIndex* lineIndex,
+                               Fold** folds, size_t* foldCount) {
+    if (payloadLength < 8) {
+        return false;
+    }
+    uint64_t count = 0;
+    for (int i = 0; i < 8; i++) {
+        count |= (uint64_t)payload[i] << (8 * i);
+    }
+    if (count > (payloadLength - 8) / 16 || payloadLength != 8 + count * 16) {
+        return false;
+    }
+
+    Fold* decoded = NULL;
+    if (count > 0) {
+        decoded = (Fold*)MemoryAlloc(MEMORY_TAG_STRUCTURE, (size_t)count * sizeof(Fold));
+        if (!decoded) {
+            return false;
+        }
+    }
+    const unsigned char* p = payload + 8;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t values[2] = { 0, 0 };
+        for (int v = 0; v < 2; v++) {
+            for (int b = 0; b < 8; b++) {
+                values[v] |= (uint64_t)*p++ << (8 * b);
+            }
+        }
+
+        // Both ends are starts of lines after the first one, in order
+        uint64_t firstLine = LineIndexLineFromOffset(lineIndex, values[0]);
+        uint64_t lastLine = LineIndexLineFromOffset(lineIndex, values[1]);
+        if (firstLine == 0 || values[0] > values[1] || lineIndex->starts[firstLine] != values[0] ||
+            lineIndex->starts[lastLine] != values[1] || (i > 0 && values[0] < decoded[i - 1].hideStart)) {
+            MemoryFree(decoded);
+            return false;
+        }
+        decoded[i].hideStart = values[0];
+        decoded[i].hideLast = values[1];
+    }
+    *folds = decoded;
+    *foldCount = (size_t)count;
+    return true;
+}
+
+/**
+ * @brief Writes the derived indexes of a file to its sidecar.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param filePath Path of the document the indexes belong to.
+ * @param key Key of the document content the indexes were built from.
+ * @param lineIndex Line-start index of the content.
+ * @param folds Folds of the view over the same content, sorted by hideStart; may be NULL if foldCount is 0.
+ * @param foldCount Number of folds.
+ * @return true if successful, false otherwise.
+ */
+bool SessionStoreIndexes(const char* sessionDir, const char* filePath, const DocumentKey* key,
+                         const LineIndex* lineIndex, const Fold* folds, size_t foldCount) {
+    if (!sessionDir || !filePath || !key || !lineIndex || lineIndex->count == 0 || (!folds && foldCount > 0)) {
+        return false;
+    }
+
+    char finalPath[SESSION_PATH_MAX * 2];
+    char tempPath[SESSION_PATH_MAX * 2 + 8];
+    if (!BuildIndexPath(finalPath, sizeof(finalPath), sessionDir, filePath)) {
+        return false;
+    }
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", finalPath);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = fwrite(SESSION_INDEX_MAGIC, 1, 8, file) == 8 &&
+              WriteU32(file, SESSION_FORMAT_VERSION) &&
+              WriteString(file, filePath) &&
+              WriteU64(file, key->identity.size) &&
+              WriteU64(file, key->identity.mtime) &&
+              WriteU64(file, key->contentHash) &&
+              WriteU32(file, foldCount > 0 ? 2 : 1) && // Section count
+              WriteLineStartsSection(file, lineIndex) &&
+              (foldCount == 0 || WriteFoldsSection(file, folds, foldCount));
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(tempPath);
+        return false;
+    }
+    return CommitTempFile(tempPath, finalPath);
+}
+
+/**
+ * @brief Loads the derived indexes of a file from its sidecar.
+ *
+ * @param sessionDir Directory holding the session files.
+ * @param filePath Path of the document.
+ * @param key Key of the current file content.
+ * @param[out] lineIndex Receives the line-start index.
+ * @param[out] folds Receives the saved folds, to be released with MemoryFree, or NULL if there are none;
+ *                   may be NULL to skip them.
+ * @param[out] foldCount Receives the number of folds; may be NULL if folds is.
+ * @return true if the cached indexes match the file, false otherwise.
+ */
+bool SessionLoadIndexes(const char* sessionDir, const char* filePath, const DocumentKey* key,
+                        LineIndex* lineIndex, Fold** folds, size_t* foldCount) {
+    if (!sessionDir || !filePath || !key || !lineIndex || (folds && !foldCount)) {
+        return false;
+    }
+
+    char path[SESSION_PATH_MAX * 2];
+    if (!BuildIndexPath(path, sizeof(path), sessionDir, filePath)) {
+        return false;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    // Header: reject anything written for another path or other content
+    char magic[8];
+    char storedPath[SESSION_PATH_MAX];
+    uint32_t version, sectionCount;
+    DocumentKey storedKey;
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              memcmp(magic, SESSION_INDEX_MAGIC, sizeof(magic)) == 0 &&
+              ReadU32(file, &version) && version == SESSION_FORMAT_VERSION &&
+              ReadString(file, storedPath, sizeof(storedPath)) &&
+              strcmp(storedPath, filePath) == 0 &&
+              ReadU64(file, &storedKey.identity.size) &&
+              ReadU64(file, &storedKey.identity.mtime) &&
+              ReadU64(file, &storedKey.contentHash) &&
+              storedKey.identity.size == key->identity.size &&
+              storedKey.identity.mtime == key->identity.mtime &&
+              storedKey.contentHash == key->contentHash &&
+              ReadU32(file, &sectionCount);
+
+    // Folds are checked against the line starts, which may come later in the file
+    LineIndex decoded = { 0 };
+    bool haveLineStarts = false;
+    unsigned char* foldPayload = NULL;
+    uint64_t foldPayloadLength = 0;
+    for (uint32_t i = 0; ok && i < sectionCount; i++) {
+        uint32_t tag, reserved;
+        uint64_t payloadLength;
+        ok = ReadU32(file, &tag) && ReadU32(file, &reserved) && ReadU64(file, &payloadLength);
+        if (!ok) {
+            break;
+        }
+
+        bool wanted = (tag == SESSION_SECTION_LINE_STARTS && !haveLineStarts) ||
+                      (tag == SESSION_SECTION_FOLDS && folds && !foldPayload);
+        if (!wanted) {
+            // Skip sections written by newer versions
+            ok = payloadLength <= (uint64_t)INT64_MAX && FileSeek(file, (int64_t)payloadLength, SEEK_CUR);
+            continue;
+        }
+
+        if (payloadLength > (uint64_t)SIZE_MAX) {
+            ok = false;
+            break;
+        }
+        unsigned char* payload = (unsigned char*)MemoryAlloc(MEMORY_TAG_SESSION, (size_t)payloadLength);
+        ok = payload && fread(payload, 1, (size_t)payloadLength, file) == payloadLength;
+        if (ok && tag == SESSION_SECTION_FOLDS) {
+            foldPayload = payload;
+            foldPayloadLength = payloadLength;
+            continue;
+        }
+        if (ok) {
+            ok = DecodeLineStartsSection(payload, payloadLength, key->identity.size, &decoded);
+            haveLineStarts = ok;
+        }
+        MemoryFree(payload);
+    }
+    fclose(file);
+
+    Fold* decodedFolds = NULL;
+    size_t decodedFoldCount = 0;
+    ok = ok && haveLineStarts &&
+         (!foldPayload || DecodeFoldsSection(foldPayload, foldPayloadLength, &decoded, &decodedFolds,
+                                             &decodedFoldCount));
+    MemoryFree(foldPayload);
+    if (!ok) {
+        LineIndexFree(&decoded);
+        return false;
+    }
+    LineIndexFree(lineIndex);
+    *lineIndex = decoded;
+    if (folds) {
+        *folds = decodedFolds;
+        *foldCount = decodedFoldCount;
+    }
+    return true;
+}
@@ -0,0 +1,832 @@
+/**
+ * @file spellcheck.c
+ * @brief Background spell checker implementation for the Professional Text Editor
+ *
+ * Contains the unchecked range bookkeeping, the job hand-off to the worker
+ * thread and the tokenizer that decides which words are prose. Jobs carry a
+ * copy of their text, so the worker never reads the document while the UI
+ * thread edits it; a job whose text changed in the meantime is discarded
+ * and its range checked again.
+ */
+
+#include "../include/spellcheck.h"
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Jobs handed to the worker at a time
+#define SPELL_MAX_JOBS 2
+
+// Bytes of text per job before extending to word boundaries
+#define SPELL_CHUNK_BYTES (64 * 1024)
+
+// Furthest a job boundary is moved to reach the end of a word
+#define SPELL_EXPAND_LIMIT 256
+
+// Unchecked text, as a half-open range; an empty range marks a point where words were joined or split
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} SpellSpan;
+
+// Life cycle of a job; only the worker moves a job from queued to done
+typedef enum {
+    SPELL_JOB_FREE,
+    SPELL_JOB_QUEUED,
+    SPELL_JOB_RUNNING,
+    SPELL_JOB_DONE
+} SpellJobState;
+
+// Chunk of text checked by the worker
+typedef struct {
+    SpellJobState state;    // Guarded by the lock
+    uint64_t sequence;      // Jobs run in the order they were queued
+    uint64_t start;         // Document offset of the text; UI thread only
+    bool stale;             // The text was edited after it was copied; UI thread only
+    char* text;             // Copy of the document text
+    size_t length;
+    size_t capacity;
+    bool skipFirst;         // The text starts inside an over-long word
+    bool skipLast;          // The text ends inside an over-long word
+    SpellRange* found;      // Misspelled words, relative to the text
+    size_t foundCount;
+    size_t foundCapacity;
+} SpellJob;
+
+struct SpellChecker {
+    const SpellDict* dictionary;
+    SpellCheckerNotify notify;
+    void* context;
+    SpellSpan* dirty;       // Unchecked ranges, sorted and disjoint
+    size_t dirtyCount;
+    size_t dirtyCapacity;
+    SpellRange* ranges;     // Misspelled words, sorted
+    size_t rangeCount;
+    size_t rangeCapacity;
+    SpellJob jobs[SPELL_MAX_JOBS];
+    uint64_t nextSequence;
+    Thread* thread;
+    ThreadLock* lock;
+    ThreadCondition* wake;
+    bool quit;
+};
+
+// Changes consumed in offset order while mapping sorted ranges
+typedef struct {
+    const DocumentChange* changes;
+    size_t count;
+    size_t next;            // First change not yet passed
+    int64_t shift;          // Length difference of the passed changes
+} ChangeSweep;
+
+/**
+ * @brief Checks whether a byte belongs to a word.
+ *
+ * Bytes of multi-byte UTF-8 characters count as letters.
+ *
+ * @param c The byte.
+ * @return true for letters, digits, underscores, apostrophes and non-ASCII bytes.
+ */
+static bool IsWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+           c == '\'' || c >= 0x80;
+}
+
+/**
+ * @brief Checks whether a byte joins words into paths, addresses or file names.
+ *
+ * @param c The byte.
+ * @return true for '.', ':', '/', '\\' and '@'.
+ */
+static bool IsJoinByte(unsigned char c) {
+    return c == '.' || c == ':' || c == '/' || c == '\\' || c == '@';
+}
+
+/**
+ * @brief Checks whether a token is a prose word worth looking up.
+ *
+ * Identifiers, numbers, acronyms and camelCase names are left alone, as are
+ * words glued to paths, addresses and file names.
+ *
+ * @param text The text holding the token.
+ * @param length Length of the text.
+ * @param start Start of the token.
+ * @param end End of the token.
+ * @return true if the token should be looked up, false otherwise.
+ */
+static bool IsProseWord(const unsigned char* text, size_t length, size_t start, size_t end) {
+    unsigned char before = start > 0 ? text[start - 1] : ' ';
+    unsigned char after = end < length ? text[end] : ' ';
+    if (before == '/' || before == '\\' || before == '@' ||
+        (before == '.' && start > 1 && IsWordByte(text[start - 2]))) {
+        return false;
+    }
+    if (after == '/' || after == '\\' || after == '@' ||
+        (IsJoinByte(after) && end + 1 < length && (IsWordByte(text[end + 1]) || text[end + 1] == '/'))) {
+        return false;
+    }
+
+    size_t letters = 0;
+    size_t capitals = 0;
+    for (size_t i = start; i < end; i++) {
+        unsigned char c = text[i];
+        if ((c >= '0' && c <= '9') || c == '_') {
+            return false;
+        }
+        if (c >= 'A' && c <= 'Z') {
+            if (i > start && text[i - 1] >= 'a' && text[i - 1] <= 'z') {
+                return false;
+            }
+            capitals++;
+        }
+        if (c != '\'') {
+            letters++;
+        }
+    }
+    return !(capitals > 1 && capitals == letters);
+}
+
+/**
+ * @brief Records a misspelled word of a job.
+ *
+ * @param job The job.
+ * @param offset Start of the word in the job text.
+ * @param length Length of the word.
+ */
+static void AddFound(SpellJob* job, size_t offset, size_t length) {
+    if (job->foundCount == job->foundCapacity) {
+        size_t newCapacity = job->foundCapacity ? job->foundCapacity * 2 : 64;
+        SpellRange* newFound = (SpellRange*)MemoryRealloc(MEMORY_TAG_SPELLING, job->found,
+                                                          newCapacity * sizeof(SpellRange));
+        if (!newFound) {
+            return;
+        }
+        job->found = newFound;
+        job->foundCapacity = newCapacity;
+    }
+    job->found[job->foundCount].offset = offset;
+    job->found[job->foundCount].length = (uint32_t)length;
+    job->foundCount++;
+}
+
+/**
+ * @brief Looks up every prose word of a job's text. Runs on the worker thread.
+ *
+ * @param dictionary The dictionary.
+ * @param job The job.
+ */
+static void CheckJob(const SpellDict* dictionary, SpellJob* job) {
+    const unsigned char* text = (const unsigned char*)job->text;
+    size_t length = job->length;
+    job->foundCount = 0;
+
+    size_t i = 0;
+    while (i < length) {
+        if (!IsWordByte(text[i])) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < length && IsWordByte(text[i])) {
+            i++;
+        }
+        size_t end = i;
+        if ((start == 0 && job->skipFirst) || (end == length && job->skipLast)) {
+            continue;
+        }
+
+        // Quotes around a word are not part of it
+        while (start < end && text[start] == '\'') {
+            start++;
+        }
+        while (end > start && text[end - 1] == '\'') {
+            end--;
+        }
+        if (end - start < 2 || end - start > SPELL_MAX_WORD || !IsProseWord(text, length, start, end)) {
+            continue;
+        }
+        if (!SpellDictContains(dictionary, (const char*)text + start, end - start)) {
+            AddFound(job, start, end - start);
+        }
+    }
+}
+
+/**
+ * @brief Runs queued jobs until the checker is destroyed.
+ *
+ * @param context The checker.
+ */
+static void RunWorker(void* context) {
+    SpellChecker* checker = (SpellChecker*)context;
+    ThreadLockEnter(checker->lock);
+    for (;;) {
+        SpellJob* job = NULL;
+        for (int i = 0; i < SPELL_MAX_JOBS; i++) {
+            SpellJob* candidate = &checker->jobs[i];
+            if (candidate->state == SPELL_JOB_QUEUED && (!job || candidate->sequence < job->sequence)) {
+                job = candidate;
+            }
+        }
+        if (checker->quit) {
+            break;
+        }
+        if (!job) {
+            ThreadConditionWait(checker->wake, checker->lock);
+            continue;
+        }
+
+        job->state = SPELL_JOB_RUNNING;
+        ThreadLockLeave(checker->lock);
+        CheckJob(checker->dictionary, job);
+        ThreadLockEnter(checker->lock);
+        job->state = SPELL_JOB_DONE;
+
+        ThreadLockLeave(checker->lock);
+        checker->notify(checker->context);
+        ThreadLockEnter(checker->lock);
+    }
+    ThreadLockLeave(checker->lock);
+}
+
+/**
+ * @brief Creates a spell checker and starts its worker thread.
+ *
+ * @param dictionary The dictionary; must outlive the checker.
+ * @param notify Callback invoked when results are ready.
+ * @param context Context pointer passed to the callback.
+ * @return The checker, or NULL on failure.
+ */
+SpellChecker* SpellCheckerCreate(const SpellDict* dictionary, SpellCheckerNotify notify, void* context) {
+    if (!dictionary || !notify) {
+        return NULL;
+    }
+
+    SpellChecker* checker = (SpellChecker*)MemoryCalloc(MEMORY_TAG_SPELLING, 1, sizeof(SpellChecker));
+    if (!checker) {
+        return NULL;
+    }
+    checker->dictionary = dictionary;
+    checker->notify = notify;
+    checker->context = context;
+    checker->lock = ThreadLockCreate();
+    checker->wake = ThreadConditionCreate();
+    if (checker->lock && checker->wake) {
+        checker->thread = ThreadStart(RunWorker, checker);
+    }
+    if (!checker->thread) {
+        ThreadConditionDestroy(checker->wake);
+        ThreadLockDestroy(checker->lock);
+        MemoryFree(checker);
+        return NULL;
+    }
+    return checker;
+}
+
+/**
+ * @brief Stops the worker thread and destroys a spell checker.
+ *
+ * @param checker The checker. NULL is ignored.
+ */
+void SpellCheckerDestroy(SpellChecker* checker) {
+    if (!checker) {
+        return;
+    }
+
+    ThreadLockEnter(checker->lock);
+    checker->quit = true;
+    ThreadConditionWakeAll(checker->wake);
+    ThreadLockLeave(checker->lock);
+    ThreadJoin(checker->thread);
+
+    ThreadConditionDestroy(checker->wake);
+    ThreadLockDestroy(checker->lock);
+    for (int i = 0; i < SPELL_MAX_JOBS; i++) {
+        MemoryFree(checker->jobs[i].text);
+        MemoryFree(checker->jobs[i].found);
+    }
+    MemoryFree(checker->dirty);
+    MemoryFree(checker->ranges);
+    MemoryFree(checker);
+}
+
+/**
+ * @brief Appends an unchecked range without keeping the list sorted.
+ *
+ * @param checker The checker.
+ * @param start Start of the range.
+ * @param end End of the range.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AppendDirty(SpellChecker* checker, uint64_t start, uint64_t end) {
+    if (checker->dirtyCount == checker->dirtyCapacity) {
+        size_t newCapacity = checker->dirtyCapacity ? checker->dirtyCapacity * 2 : 16;
+        SpellSpan* newDirty = (SpellSpan*)MemoryRealloc(MEMORY_TAG_SPELLING, checker->dirty,
+                                                        newCapacity * sizeof(SpellSpan));
+        if (!newDirty) {
+            return false;
+        }
+        checker->dirty = newDirty;
+        checker->dirtyCapacity = newCapacity;
+    }
+    checker->dirty[checker->dirtyCount].start = start;
+    checker->dirty[checker->dirtyCount].end = end;
+    checker->dirtyCount++;
+    return true;
+}
+
+/**
+ * @brief Orders unchecked ranges by start.
+ *
+ * @param a The first range.
+ * @param b The second range.
+ * @return Negative, zero or positive.
+ */
+static int CompareSpans(const void* a, const void* b) {
+    const SpellSpan* left = (const SpellSpan*)a;
+    const SpellSpan* right = (const SpellSpan*)b;
+    if (left->start != right->start) {
+        return left->start < right->start ? -1 : 1;
+    }
+    return left->end < right->end ? -1 : (left->end > right->end ? 1 : 0);
+}
+
+/**
+ * @brief Sorts the unchecked ranges and merges those that overlap or touch.
+ *
+ * @param checker The checker.
+ */
+static void NormalizeDirty(SpellChecker* checker) {
+    if (checker->dirtyCount < 2) {
+        return;
+    }
+    qsort(checker->dirty, checker->dirtyCount, sizeof(SpellSpan), CompareSpans);
+    size_t kept = 0;
+    for (size_t i = 0; i < checker->dirtyCount; i++) {
+        SpellSpan span = checker->dirty[i];
+        if (kept > 0 && span.start <= checker->dirty[kept - 1].end) {
+            if (span.end > checker->dirty[kept - 1].end) {
+                checker->dirty[kept - 1].end = span.end;
+            }
+            continue;
+        }
+        checker->dirty[kept++] = span;
+    }
+    checker->dirtyCount = kept;
+}
+
+/**
+ * @brief Checks whether an unchecked range overlaps a range being checked.
+ *
+ * @param span The unchecked range.
+ * @param start Start of the checked range.
+ * @param end End of the checked range.
+ * @return true if they overlap, false otherwise.
+ */
+static bool SpanOverlaps(const SpellSpan* span, uint64_t start, uint64_t end) {
+    if (span->start == span->end) {
+        return span->start >= start && span->start <= end;
+    }
+    return span->start < end && span->end > start;
+}
+
+/**
+ * @brief Removes a range from the unchecked ranges.
+ *
+ * @param checker The checker.
+ * @param start Start of the checked range.
+ * @param end End of the checked range.
+ */
+static void RemoveDirty(SpellChecker* checker, uint64_t start, uint64_t end) {
+    size_t count = checker->dirtyCount;
+    size_t first = 0;
+    while (first < count && !SpanOverlaps(&checker->dirty[first], start, end)) {
+        if (checker->dirty[first].start > end) {
+            return;
+        }
+        first++;
+    }
+    size_t last = first;
+    while (last < count && SpanOverlaps(&checker->dirty[last], start, end)) {
+        last++;
+    }
+    if (first == last) {
+        return;
+    }
+
+    // Keep the parts of the outermost ranges that stick out
+    SpellSpan pieces[2];
+    size_t pieceCount = 0;
+    if (checker->dirty[first].start < start) {
+        pieces[pieceCount].start = checker->dirty[first].start;
+        pieces[pieceCount].end = start;
+        pieceCount++;
+    }
+    if (checker->dirty[last - 1].end > end) {
+        pieces[pieceCount].start = end;
+        pieces[pieceCount].end = checker->dirty[last - 1].end;
+        pieceCount++;
+    }
+    if (pieceCount > last - first && !AppendDirty(checker, 0, 0)) {
+        return; // Leave the range unchecked rather than lose the rest of it
+    }
+
+    memmove(&checker->dirty[first + pieceCount], &checker->dirty[last], (count - last) * sizeof(SpellSpan));
+    memcpy(&checker->dirty[first], pieces, pieceCount * sizeof(SpellSpan));
+    checker->dirtyCount = count - (last - first) + pieceCount;
+}
+
+/**
+ * @brief Forgets all results and marks the whole document as unchecked.
+ *
+ * @param checker The checker.
+ * @param document The document.
+ */
+void SpellCheckerReset(SpellChecker* checker, const Document* document) {
+    if (!checker) {
+        return;
+    }
+
+    ThreadLockEnter(checker->lock);
+    for (int i = 0; i < SPELL_MAX_JOBS; i++) {
+        if (checker->jobs[i].state != SPELL_JOB_FREE) {
+            checker->jobs[i].stale = true;
+        }
+    }
+    ThreadLockLeave(checker->lock);
+
+    checker->rangeCount = 0;
+    checker->dirtyCount = 0;
+    AppendDirty(checker, 0, DocumentLength(document));
+}
+
+/**
+ * @brief Passes the changes that end before an offset.
+ *
+ * A change ending exactly at the offset is not passed, so that text next
+ * to an edit counts as touched.
+ *
+ * @param sweep The sweep.
+ * @param offset The offset, not less than on the previous call.
+ */
+static void SweepTo(ChangeSweep* sweep, uint64_t offset) {
+    while (sweep->next < sweep->count) {
+        const DocumentChange* change = &sweep->changes[sweep->next];
+        if (change->offset + change->removedLength >= offset) {
+            break;
+        }
+        sweep->shift += (int64_t)change->insertedLength - (int64_t)change->removedLength;
+        sweep->next++;
+    }
+}
+
+/**
+ * @brief Maps an offset to the changed document.
+ *
+ * Offsets inside removed text move to the start of the replacement.
+ *
+ * @param sweep The sweep.
+ * @param offset The offset, not less than on the previous call.
+ * @return The new offset.
+ */
+static uint64_t SweepMap(ChangeSweep* sweep, uint64_t offset) {
+    while (sweep->next < sweep->count) {
+        const DocumentChange* change = &sweep->changes[sweep->next];
+        if (change->offset + change->removedLength > offset) {
+            if (change->offset < offset) {
+                return (uint64_t)((int64_t)change->offset + sweep->shift);
+            }
+            break;
+        }
+        sweep->shift += (int64_t)change->insertedLength - (int64_t)change->removedLength;
+        sweep->next++;
+    }
+    return (uint64_t)((int64_t)offset + sweep->shift);
+}
+
+/**
+ * @brief Checks whether the range after the passed changes is touched by the next change.
+ *
+ * @param sweep The sweep, passed up to the start of the range.
+ * @param end End of the range.
+ * @return true if the next change starts at or before the end.
+ */
+static bool SweepTouches(const ChangeSweep* sweep, uint64_t end) {
+    return sweep->next < sweep->count && sweep->changes[sweep->next].offset <= end;
+}
+
+/**
+ * @brief Updates the checker after the document changed.
+ *
+ * Results touched by a change are dropped and the changed text is marked
+ * as unchecked; everything else moves with the text.
+ *
+ * @param checker The checker.
+ * @param document The document after the change.
+ * @param changes The changes reported to the document listener, or NULL if unknown.
+ * @param changeCount Number of changes.
+ */
+void SpellCheckerMapChanges(SpellChecker* checker, const Document* document, const DocumentChange* changes,
+                            size_t changeCount) {
+    if (!checker || changeCount == 0) {
+        return;
+    }
+    if (!changes) {
+        SpellCheckerReset(checker, document);
+        return;
+    }
+
+    // Misspelled words next to or inside an edit are checked again
+    ChangeSweep sweep = { changes, changeCount, 0, 0 };
+    size_t kept = 0;
+    for (size_t i = 0; i < checker->rangeCount; i++) {
+        SpellRange range = checker->ranges[i];
+        SweepTo(&sweep, range.offset);
+        if (SweepTouches(&sweep, range.offset + range.length)) {
+            continue;
+        }
+        range.offset = (uint64_t)((int64_t)range.offset + sweep.shift);
+        checker->ranges[kept++] = range;
+    }
+    checker->rangeCount = kept;
+
+    // Unchecked ranges move with the text and absorb the edits inside them
+    size_t dirtyCount = checker->dirtyCount;
+    ChangeSweep dirtySweep = { changes, changeCount, 0, 0 };
+    for (size_t i = 0; i < dirtyCount; i++) {
+        checker->dirty[i].start = SweepMap(&dirtySweep, checker->dirty[i].start);
+        checker->dirty[i].end = SweepMap(&dirtySweep, checker->dirty[i].end);
+    }
+
+    // Text in flight on the worker is checked again if it was edited
+    ThreadLockEnter(checker->lock);
+    for (int i = 0; i < SPELL_MAX_JOBS; i++) {
+        SpellJob* job = &checker->jobs[i];
+        if (job->state == SPELL_JOB_FREE || job->stale) {
+            continue;
+        }
+        ChangeSweep jobSweep = { changes, changeCount, 0, 0 };
+        SweepTo(&jobSweep, job->start);
+        if (SweepTouches(&jobSweep, job->start + job->length)) {
+            ChangeSweep mapSweep = { changes, changeCount, 0, 0 };
+            uint64_t start = SweepMap(&mapSweep, job->start);
+            AppendDirty(checker, start, SweepMap(&mapSweep, job->start + job->length));
+            job->stale = true;
+        } else {
+            job->start = (uint64_t)((int64_t)job->start + jobSweep.shift);
+        }
+    }
+    ThreadLockLeave(checker->lock);
+
+    int64_t shift = 0;
+    for (size_t c = 0; c < changeCount; c++) {
+        uint64_t start = (uint64_t)((int64_t)changes[c].offset + shift);
+        AppendDirty(checker, start, start + changes[c].insertedLength);
+        shift += (int64_t)changes[c].insertedLength - (int64_t)changes[c].removedLength;
+    }
+    NormalizeDirty(checker);
+}
+
+/**
+ * @brief Moves a job boundary backwards to the start of the word it falls in.
+ *
+ * @param document The document.
+ * @param offset The boundary.
+ * @param[out] inWord Set to true if the word is too long to reach its start.
+ * @return The new boundary.
+ */
+static uint64_t WordStartBefore(const Document* document, uint64_t offset, bool* inWord) {
+    uint64_t limit = offset > SPELL_EXPAND_LIMIT ? offset - SPELL_EXPAND_LIMIT : 0;
+    while (offset > limit) {
+        unsigned char c = (unsigned char)DocumentCharAt(document, offset - 1);
+        if (!IsWordByte(c) && !IsJoinByte(c)) {
+            break;
+        }
+        offset--;
+    }
+    *inWord = offset == limit && offset > 0 && IsWordByte((unsigned char)DocumentCharAt(document, offset - 1));
+    return offset;
+}
+
+/**
+ * @brief Moves a job boundary forwards to the end of the word it falls in.
+ *
+ * @param document The document.
+ * @param offset The boundary.
+ * @param[out] inWord Set to true if the word is too long to reach its end.
+ * @return The new boundary.
+ */
+static uint64_t WordEndAfter(const Document* document, uint64_t offset, bool* inWord) {
+    uint64_t length = DocumentLength(document);
+    uint64_t limit = length - offset > SPELL_EXPAND_LIMIT ? offset + SPELL_EXPAND_LIMIT : length;
+    while (offset < limit) {
+        unsigned char c = (unsigned char)DocumentCharAt(document, offset);
+        if (!IsWordByte(c) && !IsJoinByte(c)) {
+            break;
+        }
+        offset++;
+    }
+    *inWord = offset == limit && offset < length && IsWordByte((unsigned char)DocumentCharAt(document, offset));
+    return offset;
+}
+
+/**
+ * @brief Hands unchecked text to the worker thread.
+ *
+ * Unchecked text between the visible offsets goes first.
+ *
+ * @param checker The checker.
+ * @param document The document.
+ * @param visibleStart Start of the visible text.
+ * @param visibleEnd End of the visible text.
+ */
+void SpellCheckerSchedule(SpellChecker* checker, const Document* document, uint64_t visibleStart,
+                          uint64_t visibleEnd) {
+    if (!checker) {
+        return;
+    }
+
+    // Drop anything past the end of the document
+    uint64_t length = DocumentLength(document);
+    while (checker->dirtyCount > 0 && checker->dirty[checker->dirtyCount - 1].start > length) {
+        checker->dirtyCount--;
+    }
+    if (checker->dirtyCount > 0 && checker->dirty[checker->dirtyCount - 1].end > length) {
+        checker->dirty[checker->dirtyCount - 1].end = length;
+    }
+
+    bool queued = false;
+    while (checker->dirtyCount > 0) {
+        ThreadLockEnter(checker->lock);
+        SpellJob* job = NULL;
+        for (int i = 0; i < SPELL_MAX_JOBS && !job; i++) {
+            if (checker->jobs[i].state == SPELL_JOB_FREE) {
+                job = &checker->jobs[i];
+            }
+        }
+        ThreadLockLeave(checker->lock);
+        if (!job) {
+            break;
+        }
+
+        // Prefer the first unchecked range on screen
+        const SpellSpan* span = &checker->dirty[0];
+        uint64_t start = span->start;
+        for (size_t i = 0; i < checker->dirtyCount; i++) {
+            if (SpanOverlaps(&checker->dirty[i], visibleStart, visibleEnd)) {
+                span = &checker->dirty[i];
+                start = span->start > visibleStart ? span->start : visibleStart;
+                break;
+            }
+        }
+        uint64_t end = span->end - start > SPELL_CHUNK_BYTES ? start + SPELL_CHUNK_BYTES : span->end;
+
+        bool skipFirst = false;
+        bool skipLast = false;
+        uint64_t chunkStart = WordStartBefore(document, start, &skipFirst);
+        uint64_t chunkEnd = WordEndAfter(document, end, &skipLast);
+        RemoveDirty(checker, chunkStart, chunkEnd);
+        if (chunkEnd == chunkStart) {
+            continue;
+        }
+
+        size_t chunkLength = (size_t)(chunkEnd - chunkStart);
+        if (chunkLength > job->capacity) {
+            char* newText = (char*)MemoryRealloc(MEMORY_TAG_SPELLING, job->text, chunkLength);
+            if (!newText) {
+                AppendDirty(checker, chunkStart, chunkEnd);
+                NormalizeDirty(checker);
+                break;
+            }
+            job->text = newText;
+            job->capacity = chunkLength;
+        }
+        job->length = DocumentRead(document, chunkStart, job->text, chunkLength);
+        job->start = chunkStart;
+        job->stale = false;
+        job->skipFirst = skipFirst;
+        job->skipLast = skipLast;
+        job->sequence = checker->nextSequence++;
+
+        ThreadLockEnter(checker->lock);
+        job->state = SPELL_JOB_QUEUED;
+        ThreadLockLeave(checker->lock);
+        queued = true;
+    }
+
+    if (queued) {
+        ThreadLockEnter(checker->lock);
+        ThreadConditionWakeAll(checker->wake);
+        ThreadLockLeave(checker->lock);
+    }
+}
+
+/**
+ * @brief Replaces the results inside a finished job's range with the job's findings.
+ *
+ * @param checker The checker.
+ * @param job The finished job.
+ * @return true if the results changed, false otherwise.
+ */
+static bool MergeJob(SpellChecker* checker, const SpellJob* job) {
+    uint64_t jobEnd = job->start + job->length;
+    size_t first = SpellCheckerFindFirst(checker, job->start);
+    size_t last = first;
+    while (last < checker->rangeCount && checker->ranges[last].offset < jobEnd) {
+        last++;
+    }
+    if (last == first && job->foundCount == 0) {
+        return false;
+    }
+
+    size_t newCount = checker->rangeCount - (last - first) + job->foundCount;
+    if (newCount > checker->rangeCapacity) {
+        size_t newCapacity = checker->rangeCapacity ? checker->rangeCapacity : 64;
+        while (newCapacity < newCount) {
+            newCapacity *= 2;
+        }
+        SpellRange* newRanges = (SpellRange*)MemoryRealloc(MEMORY_TAG_SPELLING, checker->ranges,
+                                                           newCapacity * sizeof(SpellRange));
+        if (!newRanges) {
+            return false;
+        }
+        checker->ranges = newRanges;
+        checker->rangeCapacity = newCapacity;
+    }
+
+    memmove(&checker->ranges[first + job->foundCount], &checker->ranges[last],
+            (checker->rangeCount - last) * sizeof(SpellRange));
+    for (size_t i = 0; i < job->foundCount; i++) {
+        checker->ranges[first + i].offset = job->start + job->found[i].offset;
+        checker->ranges[first + i].length = job->found[i].length;
+    }
+    checker->rangeCount = newCount;
+    return true;
+}
+
+/**
+ * @brief Merges the results of the chunks the worker has finished.
+ *
+ * @param checker The checker.
+ * @return true if the misspelled ranges changed, false otherwise.
+ */
+bool SpellCheckerCollect(SpellChecker* checker) {
+    if (!checker) {
+        return false;
+    }
+
+    // The worker does not touch a finished job, so it is merged without the lock
+    bool done[SPELL_MAX_JOBS];
+    ThreadLockEnter(checker->lock);
+    for (int i = 0; i < SPELL_MAX_JOBS; i++) {
+        done[i] = checker->jobs[i].state == SPELL_JOB_DONE;
+    }
+    ThreadLockLeave(checker->lock);
+
+    bool changed = false;
+    for (int i = 0; i < SPELL_MAX_JOBS; i++) {
+        if (!done[i]) {
+            continue;
+        }
+        if (!checker->jobs[i].stale && MergeJob(checker, &checker->jobs[i])) {
+            changed = true;
+        }
+        ThreadLockEnter(checker->lock);
+        checker->jobs[i].state = SPELL_JOB_FREE;
+        ThreadLockLeave(checker->lock);
+    }
+    return changed;
+}
+
+/**
+ * @brief Gets the misspelled words found so far.
+ *
+ * @param checker The checker.
+ * @param[out] count Receives the number of ranges.
+ * @return The ranges, sorted by offset.
+ */
+const SpellRange* SpellCheckerRanges(const SpellChecker* checker, size_t* count) {
+    *count = checker ? checker->rangeCount : 0;
+    return checker ? checker->ranges : NULL;
+}
+
+/**
+ * @brief Finds the first misspelled word ending after an offset.
+ *
+ * @param checker The checker.
+ * @param offset The offset.
+ * @return Index of the range, or the range count if there is none.
+ */
+size_t SpellCheckerFindFirst(const SpellChecker* checker, uint64_t offset) {
+    size_t low = 0;
+    size_t high = checker ? checker->rangeCount : 0;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (checker->ranges[mid].offset + checker->ranges[mid].length <= offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
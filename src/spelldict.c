@@ -0,0 +1,861 @@
+/**
+ * @file spelldict.c
+ * @brief Compiled spelling dictionary implementation for the Professional Text Editor
+ *
+ * Contains the incremental minimal-automaton builder for sorted word lists
+ * (each finished suffix is replaced by an equal registered node), the file
+ * writer, and the lookups and edit-distance walk over the mapped edges.
+ *
+ * File layout (little-endian): 8-byte magic, version, edge count, first
+ * edge of the root node, word count, then one 32-bit word per edge. The
+ * edges of a node are stored next to each other, sorted by label; edge 0
+ * is unused so that 0 can mean "no edges".
+ */
+
+#include "../include/spelldict.h"
+#include "../include/hash.h"
+#include "../include/mapfile.h"
+#include "../include/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File format identifiers
+#define SPELL_DICT_MAGIC "PTEDAWG1"
+#define SPELL_DICT_VERSION 1
+#define SPELL_DICT_HEADER_SIZE 24
+
+// Edge layout: label in bits 0-7, then two flags, then the first edge of the target node
+#define SPELL_EDGE_FINAL 0x100u         // The path up to and including this edge is a word
+#define SPELL_EDGE_LAST 0x200u          // Last edge of its node
+#define SPELL_EDGE_TARGET_SHIFT 10
+#define SPELL_MAX_EDGES (1u << (32 - SPELL_EDGE_TARGET_SHIFT))
+
+struct SpellDict {
+    MappedFile mapping;
+    const uint32_t* edges;
+    uint32_t edgeCount;
+    uint32_t root;          // First edge of the root node, 0 for an empty dictionary
+    uint32_t wordCount;
+};
+
+// Automaton node while compiling
+typedef struct {
+    unsigned char* labels;
+    uint32_t* targets;
+    uint32_t count;
+    uint32_t capacity;
+    bool final;
+} BuildNode;
+
+// Compiler state
+typedef struct {
+    BuildNode* nodes;           // Node 0 is the root
+    uint32_t nodeCount;
+    uint32_t nodeCapacity;
+    uint32_t* freeNodes;        // Nodes replaced by an equal registered node, ready for reuse
+    uint32_t freeCount;
+    uint32_t* table;            // Register of unique nodes; open addressing, entries are id + 1
+    size_t tableSize;
+    size_t tableCount;
+    uint32_t unchecked[SPELL_MAX_WORD];  // Nodes on the path of the previous word, by depth
+    size_t uncheckedCount;
+    bool failed;
+} Builder;
+
+// Word of the sorted input list
+typedef struct {
+    const unsigned char* text;
+    size_t length;
+} WordEntry;
+
+// One suggestion candidate
+typedef struct {
+    char text[SPELL_MAX_WORD + 1];
+    unsigned int distance;
+    size_t lengthDifference;
+} Candidate;
+
+// State of the edit-distance walk
+typedef struct {
+    const SpellDict* dictionary;
+    unsigned char word[SPELL_MAX_WORD];
+    size_t length;
+    unsigned int maxDistance;
+    unsigned char path[SPELL_MAX_WORD];
+    unsigned int rows[SPELL_MAX_WORD + 1][SPELL_MAX_WORD + 1];
+    Candidate* candidates;
+    size_t candidateCount;
+    size_t maxCandidates;
+} SuggestState;
+
+/**
+ * @brief Folds an ASCII letter to lowercase.
+ *
+ * @param c The byte.
+ * @return The lowercase letter, or the byte unchanged.
+ */
+static unsigned char FoldCase(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+/**
+ * @brief Checks whether the host stores integers little-endian.
+ *
+ * The mapped edges are used in place, which requires the file byte order.
+ *
+ * @return true on little-endian hosts, false otherwise.
+ */
+static bool IsLittleEndian(void) {
+    const uint32_t probe = 1;
+    unsigned char first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+/**
+ * @brief Allocates a node, reusing a released one if possible.
+ *
+ * @param builder The compiler state.
+ * @return The node id, or UINT32_MAX on allocation failure.
+ */
+static uint32_t NewNode(Builder* builder) {
+    if (builder->freeCount > 0) {
+        uint32_t id = builder->freeNodes[--builder->freeCount];
+        builder->nodes[id].count = 0;
+        builder->nodes[id].final = false;
+        return id;
+    }
+
+    if (builder->nodeCount == builder->nodeCapacity) {
+        uint32_t newCapacity = builder->nodeCapacity ? builder->nodeCapacity * 2 : 1024;
+        BuildNode* newNodes = (BuildNode*)MemoryRealloc(MEMORY_TAG_SPELLING, builder->nodes,
+                                                        newCapacity * sizeof(BuildNode));
+        uint32_t* newFree = (uint32_t*)MemoryRealloc(MEMORY_TAG_SPELLING, builder->freeNodes,
+                                                     newCapacity * sizeof(uint32_t));
+        if (newNodes) {
+            builder->nodes = newNodes;
+        }
+        if (newFree) {
+            builder->freeNodes = newFree;
+        }
+        if (!newNodes || !newFree) {
+            builder->failed = true;
+            return UINT32_MAX;
+        }
+        builder->nodeCapacity = newCapacity;
+    }
+
+    uint32_t id = builder->nodeCount++;
+    memset(&builder->nodes[id], 0, sizeof(BuildNode));
+    return id;
+}
+
+/**
+ * @brief Appends an edge to a node.
+ *
+ * @param builder The compiler state.
+ * @param id The node.
+ * @param label The edge label.
+ * @param target The target node.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AddEdge(Builder* builder, uint32_t id, unsigned char label, uint32_t target) {
+    BuildNode* node = &builder->nodes[id];
+    if (node->count == node->capacity) {
+        uint32_t newCapacity = node->capacity ? node->capacity * 2 : 2;
+        unsigned char* newLabels = (unsigned char*)MemoryRealloc(MEMORY_TAG_SPELLING, node->labels, newCapacity);
+        if (newLabels) {
+            node->labels = newLabels;
+        }
+        uint32_t* newTargets = (uint32_t*)MemoryRealloc(MEMORY_TAG_SPELLING, node->targets,
+                                                        newCapacity * sizeof(uint32_t));
+        if (newTargets) {
+            node->targets = newTargets;
+        }
+        if (!newLabels || !newTargets) {
+            builder->failed = true;
+            return false;
+        }
+        node->capacity = newCapacity;
+    }
+    node->labels[node->count] = label;
+    node->targets[node->count] = target;
+    node->count++;
+    return true;
+}
+
+/**
+ * @brief Hashes the finality and outgoing edges of a node.
+ *
+ * @param node The node.
+ * @return The hash.
+ */
+static uint64_t NodeHash(const BuildNode* node) {
+    uint64_t hash = HashBytes64(node->labels, node->count, node->final ? 1 : 0);
+    return HashBytes64(node->targets, node->count * sizeof(uint32_t), hash);
+}
+
+/**
+ * @brief Checks whether two nodes accept the same suffixes.
+ *
+ * Their targets are already registered, so equal edges mean equal languages.
+ *
+ * @param a The first node.
+ * @param b The second node.
+ * @return true if equal, false otherwise.
+ */
+static bool NodesEqual(const BuildNode* a, const BuildNode* b) {
+    return a->final == b->final && a->count == b->count &&
+           (a->count == 0 || (memcmp(a->labels, b->labels, a->count) == 0 &&
+                              memcmp(a->targets, b->targets, a->count * sizeof(uint32_t)) == 0));
+}
+
+/**
+ * @brief Inserts a node id into the register table without checking for equals.
+ *
+ * @param builder The compiler state.
+ * @param id The node.
+ */
+static void TableInsert(Builder* builder, uint32_t id) {
+    size_t mask = builder->tableSize - 1;
+    size_t slot = (size_t)NodeHash(&builder->nodes[id]) & mask;
+    while (builder->table[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    builder->table[slot] = id + 1;
+    builder->tableCount++;
+}
+
+/**
+ * @brief Returns the registered node equal to a node, registering it if there is none.
+ *
+ * @param builder The compiler state.
+ * @param id The node.
+ * @return The canonical node id.
+ */
+static uint32_t RegisterNode(Builder* builder, uint32_t id) {
+    if (builder->tableSize > 0) {
+        size_t mask = builder->tableSize - 1;
+        size_t slot = (size_t)NodeHash(&builder->nodes[id]) & mask;
+        while (builder->table[slot] != 0) {
+            uint32_t existing = builder->table[slot] - 1;
+            if (NodesEqual(&builder->nodes[existing], &builder->nodes[id])) {
+                return existing;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    // Keep the table at most half full
+    if ((builder->tableCount + 1) * 2 > builder->tableSize) {
+        size_t oldSize = builder->tableSize;
+        uint32_t* oldTable = builder->table;
+        size_t newSize = oldSize ? oldSize * 2 : 4096;
+        uint32_t* newTable = (uint32_t*)MemoryCalloc(MEMORY_TAG_SPELLING, newSize, sizeof(uint32_t));
+        if (!newTable) {
+            builder->failed = true;
+            return id;
+        }
+        builder->table = newTable;
+        builder->tableSize = newSize;
+        builder->tableCount = 0;
+        for (size_t i = 0; i < oldSize; i++) {
+            if (oldTable[i] != 0) {
+                TableInsert(builder, oldTable[i] - 1);
+            }
+        }
+        MemoryFree(oldTable);
+    }
+
+    TableInsert(builder, id);
+    return id;
+}
+
+/**
+ * @brief Registers the nodes of the previous word below a depth.
+ *
+ * @param builder The compiler state.
+ * @param depth Number of path nodes to keep unregistered.
+ */
+static void Minimize(Builder* builder, size_t depth) {
+    while (builder->uncheckedCount > depth && !builder->failed) {
+        uint32_t parent = builder->unchecked[--builder->uncheckedCount];
+        BuildNode* node = &builder->nodes[parent];
+        uint32_t child = node->targets[node->count - 1];
+        uint32_t canonical = RegisterNode(builder, child);
+        if (canonical != child) {
+            builder->nodes[parent].targets[builder->nodes[parent].count - 1] = canonical;
+            builder->freeNodes[builder->freeCount++] = child;
+        }
+    }
+}
+
+/**
+ * @brief Releases the memory held by the compiler state.
+ *
+ * @param builder The compiler state.
+ */
+static void BuilderFree(Builder* builder) {
+    for (uint32_t i = 0; i < builder->nodeCount; i++) {
+        MemoryFree(builder->nodes[i].labels);
+        MemoryFree(builder->nodes[i].targets);
+    }
+    MemoryFree(builder->nodes);
+    MemoryFree(builder->freeNodes);
+    MemoryFree(builder->table);
+}
+
+/**
+ * @brief Orders words byte by byte.
+ *
+ * @param a The first word entry.
+ * @param b The second word entry.
+ * @return Negative, zero or positive like memcmp.
+ */
+static int CompareWords(const void* a, const void* b) {
+    const WordEntry* left = (const WordEntry*)a;
+    const WordEntry* right = (const WordEntry*)b;
+    size_t common = left->length < right->length ? left->length : right->length;
+    int result = memcmp(left->text, right->text, common);
+    if (result != 0) {
+        return result;
+    }
+    return left->length < right->length ? -1 : (left->length > right->length ? 1 : 0);
+}
+
+/**
+ * @brief Splits a word list into sorted, unique, lowercase words.
+ *
+ * @param buffer Writable copy of the word list; words point into it.
+ * @param length Length of the list.
+ * @param[out] count Receives the number of words.
+ * @return The words, or NULL on allocation failure. The caller frees them.
+ */
+static WordEntry* ParseWordList(unsigned char* buffer, size_t length, size_t* count) {
+    size_t capacity = 1024;
+    size_t n = 0;
+    WordEntry* words = (WordEntry*)MemoryAlloc(MEMORY_TAG_SPELLING, capacity * sizeof(WordEntry));
+    if (!words) {
+        return NULL;
+    }
+
+    size_t position = 0;
+    bool firstLine = true;
+    while (position < length) {
+        unsigned char* line = buffer + position;
+        unsigned char* lineFeed = (unsigned char*)memchr(line, '\n', length - position);
+        size_t lineLength = lineFeed ? (size_t)(lineFeed - line) : length - position;
+        position += lineLength + 1;
+
+        size_t wordLength = 0;
+        bool numeric = true;
+        while (wordLength < lineLength && line[wordLength] != '/' && line[wordLength] != '\r' &&
+               line[wordLength] != ' ' && line[wordLength] != '\t') {
+            numeric = numeric && line[wordLength] >= '0' && line[wordLength] <= '9';
+            line[wordLength] = FoldCase(line[wordLength]);
+            wordLength++;
+        }
+        bool countLine = firstLine && numeric;
+        firstLine = false;
+        if (wordLength == 0 || wordLength > SPELL_MAX_WORD || countLine) {
+            continue;
+        }
+
+        if (n == capacity) {
+            capacity *= 2;
+            WordEntry* newWords = (WordEntry*)MemoryRealloc(MEMORY_TAG_SPELLING, words, capacity * sizeof(WordEntry));
+            if (!newWords) {
+                MemoryFree(words);
+                return NULL;
+            }
+            words = newWords;
+        }
+        words[n].text = line;
+        words[n].length = wordLength;
+        n++;
+    }
+
+    qsort(words, n, sizeof(WordEntry), CompareWords);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique == 0 || CompareWords(&words[unique - 1], &words[i]) != 0) {
+            words[unique++] = words[i];
+        }
+    }
+    *count = unique;
+    return words;
+}
+
+/**
+ * @brief Lays out the reachable nodes as edge runs and writes the dictionary file.
+ *
+ * @param builder The compiler state after the last word.
+ * @param wordCount Number of words.
+ * @param outputPath Path of the compiled dictionary.
+ * @return true if successful, false otherwise.
+ */
+static bool WriteAutomaton(const Builder* builder, uint32_t wordCount, const char* outputPath) {
+    uint32_t* starts = (uint32_t*)MemoryCalloc(MEMORY_TAG_SPELLING, builder->nodeCount, sizeof(uint32_t));
+    uint32_t* queue = (uint32_t*)MemoryAlloc(MEMORY_TAG_SPELLING, builder->nodeCount * sizeof(uint32_t));
+    if (!starts || !queue) {
+        MemoryFree(starts);
+        MemoryFree(queue);
+        return false;
+    }
+
+    // Breadth-first order gives every node with edges one contiguous run
+    uint64_t edgeCount = 1;
+    size_t head = 0;
+    size_t tail = 0;
+    if (builder->nodes[0].count > 0) {
+        starts[0] = (uint32_t)edgeCount;
+        edgeCount += builder->nodes[0].count;
+        queue[tail++] = 0;
+    }
+    while (head < tail && edgeCount < SPELL_MAX_EDGES) {
+        const BuildNode* node = &builder->nodes[queue[head++]];
+        for (uint32_t i = 0; i < node->count; i++) {
+            uint32_t target = node->targets[i];
+            if (builder->nodes[target].count > 0 && starts[target] == 0) {
+                starts[target] = (uint32_t)edgeCount;
+                edgeCount += builder->nodes[target].count;
+                queue[tail++] = target;
+            }
+        }
+    }
+
+    uint32_t* edges = NULL;
+    if (edgeCount < SPELL_MAX_EDGES) {
+        edges = (uint32_t*)MemoryCalloc(MEMORY_TAG_SPELLING, (size_t)edgeCount, sizeof(uint32_t));
+    }
+    if (!edges) {
+        MemoryFree(starts);
+        MemoryFree(queue);
+        return false;
+    }
+    for (size_t q = 0; q < tail; q++) {
+        const BuildNode* node = &builder->nodes[queue[q]];
+        uint32_t base = starts[queue[q]];
+        for (uint32_t i = 0; i < node->count; i++) {
+            uint32_t target = node->targets[i];
+            uint32_t edge = node->labels[i] | (starts[target] << SPELL_EDGE_TARGET_SHIFT);
+            if (builder->nodes[target].final) {
+                edge |= SPELL_EDGE_FINAL;
+            }
+            if (i + 1 == node->count) {
+                edge |= SPELL_EDGE_LAST;
+            }
+            edges[base + i] = edge;
+        }
+    }
+    MemoryFree(queue);
+    uint32_t root = starts[0];
+    MemoryFree(starts);
+
+    char tempPath[1024];
+    if (snprintf(tempPath, sizeof(tempPath), "%s.tmp", outputPath) >= (int)sizeof(tempPath)) {
+        MemoryFree(edges);
+        return false;
+    }
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        MemoryFree(edges);
+        return false;
+    }
+
+    uint32_t header[4] = { SPELL_DICT_VERSION, (uint32_t)edgeCount, root, wordCount };
+    unsigned char bytes[4096];
+    bool ok = fwrite(SPELL_DICT_MAGIC, 1, 8, file) == 8;
+    for (size_t i = 0; ok && i < 4 + (size_t)edgeCount; i += sizeof(bytes) / 4) {
+        size_t run = 4 + (size_t)edgeCount - i;
+        if (run > sizeof(bytes) / 4) {
+            run = sizeof(bytes) / 4;
+        }
+        for (size_t j = 0; j < run; j++) {
+            uint32_t value = i + j < 4 ? header[i + j] : edges[i + j - 4];
+            for (int k = 0; k < 4; k++) {
+                bytes[j * 4 + k] = (unsigned char)(value >> (8 * k));
+            }
+        }
+        ok = fwrite(bytes, 4, run, file) == run;
+    }
+    MemoryFree(edges);
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        remove(tempPath);
+        return false;
+    }
+    remove(outputPath); // rename does not overwrite on Windows
+    if (rename(tempPath, outputPath) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Compiles a word list into a dictionary file.
+ *
+ * The list holds one word per line in any order. Text after a '/' (affix
+ * flags of Hunspell word lists) is ignored, as is a leading line holding
+ * only the word count. Words are folded to lowercase.
+ *
+ * @param words The word list.
+ * @param length Length of the word list.
+ * @param outputPath Path of the compiled dictionary.
+ * @return true if successful, false otherwise.
+ */
+bool SpellDictCompile(const char* words, size_t length, const char* outputPath) {
+    if (!words || !outputPath) {
+        return false;
+    }
+
+    unsigned char* buffer = (unsigned char*)MemoryAlloc(MEMORY_TAG_SPELLING, length + 1);
+    if (!buffer) {
+        return false;
+    }
+    memcpy(buffer, words, length);
+
+    size_t wordCount = 0;
+    WordEntry* list = ParseWordList(buffer, length, &wordCount);
+    if (!list) {
+        MemoryFree(buffer);
+        return false;
+    }
+
+    Builder builder;
+    memset(&builder, 0, sizeof(builder));
+    NewNode(&builder); // Root
+
+    const WordEntry* previous = NULL;
+    for (size_t w = 0; w < wordCount && !builder.failed; w++) {
+        const WordEntry* word = &list[w];
+        size_t prefix = 0;
+        if (previous) {
+            while (prefix < previous->length && prefix < word->length && previous->text[prefix] == word->text[prefix]) {
+                prefix++;
+            }
+        }
+        Minimize(&builder, prefix);
+
+        uint32_t node = 0;
+        if (prefix > 0) {
+            const BuildNode* parent = &builder.nodes[builder.unchecked[prefix - 1]];
+            node = parent->targets[parent->count - 1];
+        }
+        for (size_t i = prefix; i < word->length && !builder.failed; i++) {
+            uint32_t child = NewNode(&builder);
+            if (child == UINT32_MAX || !AddEdge(&builder, node, word->text[i], child)) {
+                break;
+            }
+            builder.unchecked[builder.uncheckedCount++] = node;
+            node = child;
+        }
+        builder.nodes[node].final = true;
+        previous = word;
+    }
+    Minimize(&builder, 0);
+
+    bool success = !builder.failed && WriteAutomaton(&builder, (uint32_t)wordCount, outputPath);
+    BuilderFree(&builder);
+    MemoryFree(list);
+    MemoryFree(buffer);
+    return success;
+}
+
+/**
+ * @brief Opens a compiled dictionary.
+ *
+ * @param path Path of the compiled dictionary.
+ * @return The dictionary, or NULL if the file is missing or invalid.
+ */
+SpellDict* SpellDictOpen(const char* path) {
+    if (!path || !IsLittleEndian()) {
+        return NULL;
+    }
+
+    SpellDict* dictionary = (SpellDict*)MemoryCalloc(MEMORY_TAG_SPELLING, 1, sizeof(SpellDict));
+    if (!dictionary) {
+        return NULL;
+    }
+    if (!MapFileOpen(path, &dictionary->mapping)) {
+        MemoryFree(dictionary);
+        return NULL;
+    }
+
+    // Only the header is checked; edge targets are bounds-checked while walking
+    const MappedFile* mapping = &dictionary->mapping;
+    uint32_t header[4];
+    bool valid = mapping->size >= SPELL_DICT_HEADER_SIZE &&
+                 memcmp(mapping->data, SPELL_DICT_MAGIC, 8) == 0;
+    if (valid) {
+        memcpy(header, mapping->data + 8, sizeof(header));
+        valid = header[0] == SPELL_DICT_VERSION && header[1] > 0 && header[1] <= SPELL_MAX_EDGES &&
+                mapping->size == SPELL_DICT_HEADER_SIZE + (uint64_t)header[1] * 4 && header[2] < header[1];
+    }
+    if (!valid) {
+        MapFileClose(&dictionary->mapping);
+        MemoryFree(dictionary);
+        return NULL;
+    }
+
+    dictionary->edges = (const uint32_t*)(const void*)(mapping->data + SPELL_DICT_HEADER_SIZE);
+    dictionary->edgeCount = header[1];
+    dictionary->root = header[2];
+    dictionary->wordCount = header[3];
+    return dictionary;
+}
+
+/**
+ * @brief Closes a dictionary.
+ *
+ * @param dictionary The dictionary. NULL is ignored.
+ */
+void SpellDictClose(SpellDict* dictionary) {
+    if (!dictionary) {
+        return;
+    }
+    MapFileClose(&dictionary->mapping);
+    MemoryFree(dictionary);
+}
+
+/**
+ * @brief Gets the number of words in a dictionary.
+ *
+ * @param dictionary The dictionary.
+ * @return The word count.
+ */
+uint32_t SpellDictWordCount(const SpellDict* dictionary) {
+    return dictionary ? dictionary->wordCount : 0;
+}
+
+/**
+ * @brief Finds the edge of a node with a label.
+ *
+ * @param dictionary The dictionary.
+ * @param node First edge of the node, or 0 for a node without edges.
+ * @param label The label.
+ * @return The edge index, or 0 if the node has no such edge.
+ */
+static uint32_t FindEdge(const SpellDict* dictionary, uint32_t node, unsigned char label) {
+    for (uint32_t i = node; i != 0 && i < dictionary->edgeCount; i++) {
+        uint32_t edge = dictionary->edges[i];
+        unsigned char edgeLabel = (unsigned char)(edge & 0xFF);
+        if (edgeLabel == label) {
+            return i;
+        }
+        if (edgeLabel > label || (edge & SPELL_EDGE_LAST)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks whether a lowercase word is in the dictionary.
+ *
+ * @param dictionary The dictionary.
+ * @param word The folded word.
+ * @param length Length of the word (at least 1).
+ * @return true if the word is known, false otherwise.
+ */
+static bool ContainsFolded(const SpellDict* dictionary, const unsigned char* word, size_t length) {
+    uint32_t node = dictionary->root;
+    for (size_t i = 0; i < length; i++) {
+        uint32_t edge = FindEdge(dictionary, node, word[i]);
+        if (edge == 0) {
+            return false;
+        }
+        if (i + 1 == length) {
+            return (dictionary->edges[edge] & SPELL_EDGE_FINAL) != 0;
+        }
+        node = dictionary->edges[edge] >> SPELL_EDGE_TARGET_SHIFT;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether a word is in the dictionary.
+ *
+ * ASCII letters are compared without regard to case, and a possessive
+ * "'s" is accepted after a known word.
+ *
+ * @param dictionary The dictionary.
+ * @param word The word.
+ * @param length Length of the word.
+ * @return true if the word is known, false otherwise.
+ */
+bool SpellDictContains(const SpellDict* dictionary, const char* word, size_t length) {
+    if (!dictionary || !word || length == 0 || length > SPELL_MAX_WORD) {
+        return false;
+    }
+
+    unsigned char folded[SPELL_MAX_WORD];
+    for (size_t i = 0; i < length; i++) {
+        folded[i] = FoldCase((unsigned char)word[i]);
+    }
+    if (ContainsFolded(dictionary, folded, length)) {
+        return true;
+    }
+    return length > 2 && folded[length - 2] == '\'' && folded[length - 1] == 's' &&
+           ContainsFolded(dictionary, folded, length - 2);
+}
+
+/**
+ * @brief Records a word found within the distance bound.
+ *
+ * Candidates are kept sorted by distance, then by how much their length
+ * differs from the word; the walk visits words alphabetically, which
+ * breaks the remaining ties.
+ *
+ * @param state The walk state.
+ * @param length Length of the word on the current path.
+ * @param distance Its edit distance.
+ */
+static void AddCandidate(SuggestState* state, size_t length, unsigned int distance) {
+    size_t lengthDifference = length > state->length ? length - state->length : state->length - length;
+    size_t position = state->candidateCount;
+    while (position > 0) {
+        const Candidate* other = &state->candidates[position - 1];
+        if (other->distance < distance || (other->distance == distance && other->lengthDifference <= lengthDifference)) {
+            break;
+        }
+        position--;
+    }
+    if (position >= state->maxCandidates) {
+        return;
+    }
+
+    size_t moved = state->candidateCount < state->maxCandidates ? state->candidateCount : state->maxCandidates - 1;
+    memmove(&state->candidates[position + 1], &state->candidates[position], (moved - position) * sizeof(Candidate));
+    Candidate* candidate = &state->candidates[position];
+    memcpy(candidate->text, state->path, length);
+    candidate->text[length] = '\0';
+    candidate->distance = distance;
+    candidate->lengthDifference = lengthDifference;
+    if (state->candidateCount < state->maxCandidates) {
+        state->candidateCount++;
+    }
+}
+
+/**
+ * @brief Walks the edges of a node, extending one row of the distance table per edge.
+ *
+ * @param state The walk state.
+ * @param node First edge of the node.
+ * @param depth Length of the path leading to the node.
+ */
+static void Walk(SuggestState* state, uint32_t node, size_t depth) {
+    const SpellDict* dictionary = state->dictionary;
+    size_t n = state->length;
+
+    for (uint32_t i = node; i != 0 && i < dictionary->edgeCount; i++) {
+        uint32_t edge = dictionary->edges[i];
+        unsigned char c = (unsigned char)(edge & 0xFF);
+        const unsigned int* previous = state->rows[depth];
+        unsigned int* row = state->rows[depth + 1];
+
+        row[0] = (unsigned int)depth + 1;
+        unsigned int best = row[0];
+        for (size_t j = 1; j <= n; j++) {
+            unsigned int cost = state->word[j - 1] == c ? 0 : 1;
+            unsigned int value = previous[j - 1] + cost;
+            if (previous[j] + 1 < value) {
+                value = previous[j] + 1;
+            }
+            if (row[j - 1] + 1 < value) {
+                value = row[j - 1] + 1;
+            }
+            if (depth > 0 && j > 1 && state->word[j - 1] == state->path[depth - 1] && state->word[j - 2] == c &&
+                state->rows[depth - 1][j - 2] + 1 < value) {
+                value = state->rows[depth - 1][j - 2] + 1;
+            }
+            row[j] = value;
+            if (value < best) {
+                best = value;
+            }
+        }
+
+        state->path[depth] = c;
+        if ((edge & SPELL_EDGE_FINAL) && row[n] > 0 && row[n] <= state->maxDistance) {
+            AddCandidate(state, depth + 1, row[n]);
+        }
+        uint32_t target = edge >> SPELL_EDGE_TARGET_SHIFT;
+        if (best <= state->maxDistance && target != 0 && depth + 1 < SPELL_MAX_WORD) {
+            Walk(state, target, depth + 1);
+        }
+        if (edge & SPELL_EDGE_LAST) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Finds the known words closest to a word.
+ *
+ * Walks the automaton with a bounded edit distance (insertions, deletions,
+ * substitutions and transpositions), pruning every branch that cannot get
+ * within SPELL_MAX_DISTANCE. Suggestions take the capitalization of the word.
+ *
+ * @param dictionary The dictionary.
+ * @param word The word.
+ * @param length Length of the word.
+ * @param[out] suggestions Receives NUL-terminated suggestions, closest first.
+ * @param maxSuggestions Capacity of the suggestions array.
+ * @return Number of suggestions stored.
+ */
+size_t SpellDictSuggest(const SpellDict* dictionary, const char* word, size_t length,
+                        char suggestions[][SPELL_MAX_WORD + 1], size_t maxSuggestions) {
+    if (!dictionary || !word || length == 0 || length > SPELL_MAX_WORD || maxSuggestions == 0) {
+        return 0;
+    }
+
+    SuggestState* state = (SuggestState*)MemoryAlloc(MEMORY_TAG_SPELLING, sizeof(SuggestState));
+    Candidate* candidates = (Candidate*)MemoryAlloc(MEMORY_TAG_SPELLING, maxSuggestions * sizeof(Candidate));
+    if (!state || !candidates) {
+        MemoryFree(state);
+        MemoryFree(candidates);
+        return 0;
+    }
+
+    state->dictionary = dictionary;
+    state->length = length;
+    for (size_t i = 0; i < length; i++) {
+        state->word[i] = FoldCase((unsigned char)word[i]);
+    }
+    // Short words have few neighbors within distance 2 that are not noise
+    state->maxDistance = length <= 4 ? 1 : SPELL_MAX_DISTANCE;
+    for (size_t j = 0; j <= length; j++) {
+        state->rows[0][j] = (unsigned int)j;
+    }
+    state->candidates = candidates;
+    state->candidateCount = 0;
+    state->maxCandidates = maxSuggestions;
+    Walk(state, dictionary->root, 0);
+
+    // Carry over an initial capital or an all-caps spelling
+    bool capital = word[0] >= 'A' && word[0] <= 'Z';
+    bool allCaps = capital && length > 1;
+    for (size_t i = 1; allCaps && i < length; i++) {
+        allCaps = !(word[i] >= 'a' && word[i] <= 'z');
+    }
+
+    size_t count = state->candidateCount;
+    for (size_t i = 0; i < count; i++) {
+        char* text = suggestions[i];
+        memcpy(text, candidates[i].text, SPELL_MAX_WORD + 1);
+        for (size_t k = 0; text[k] && (k == 0 ? capital : allCaps); k++) {
+            if (text[k] >= 'a' && text[k] <= 'z') {
+                text[k] = (char)(text[k] - 'a' + 'A');
+            }
+        }
+    }
+
+    MemoryFree(candidates);
+    MemoryFree(state);
+    return count;
+}
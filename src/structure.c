@@ -0,0 +1,1166 @@
+/**
+ * @file structure.c
+ * @brief Bracket and indentation structure index implementation for the Professional Text Editor
+ *
+ * Contains the block scanner, the summary tree and the queries that descend
+ * it to find matching brackets and fold ranges.
+ */
+
+#include "../include/structure.h"
+#include "../include/layout.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes after which a block ends at the next line break
+#define STRUCTURE_BLOCK_TARGET (16 * 1024)
+
+// Bytes after which a rescanned block is split again; larger than the
+// target so that typing inside a block does not change the block count
+#define STRUCTURE_BLOCK_SPLIT (4 * STRUCTURE_BLOCK_TARGET)
+
+// Hard limit for blocks inside very long lines
+#define STRUCTURE_BLOCK_MAX (256 * 1024)
+
+// Indentation of a block without a non-blank line start
+#define STRUCTURE_NO_INDENT UINT32_MAX
+
+// Enclosing pairs tried before giving up on a fold region
+#define STRUCTURE_MAX_ENCLOSING 64
+
+// Bracket balance and indentation of a range of blocks
+typedef struct {
+    uint64_t length;        // Bytes covered
+    int64_t delta;          // Opening minus closing brackets
+    int64_t minDepth;       // Lowest running balance from the start (<= 0)
+    int64_t maxSuffix;      // Highest balance of any suffix (>= 0)
+    uint32_t minIndent;     // Smallest indentation of a non-blank line starting here
+} StructureSummary;
+
+struct StructureIndex {
+    Document* document;
+    bool built;
+    StructureSummary* nodes;    // Implicit tree; node 1 is the root, leaves start at leafBase
+    size_t leafBase;            // Power of two >= leafCount
+    size_t leafCount;
+};
+
+// Lexer state carried from byte to byte within a line
+typedef struct {
+    bool inString;
+    bool escaped;
+    bool inComment;
+    bool slash;             // Previous byte was '/' outside a string
+    bool atLineStart;       // Only blanks seen on the current line so far
+    uint32_t indent;        // Columns of leading blanks on the current line
+} ScanState;
+
+// Growable list of block summaries
+typedef struct {
+    StructureSummary* items;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} SummaryList;
+
+// Bracket found while scanning a block
+typedef struct {
+    uint64_t offset;
+    int delta;
+} BracketEvent;
+
+// Non-blank line start found while scanning a block
+typedef struct {
+    uint64_t offset;        // Offset of the first non-blank character
+    uint32_t indent;
+} IndentEvent;
+
+// Brackets and line starts of one block
+typedef struct {
+    BracketEvent* brackets;
+    size_t bracketCount;
+    size_t bracketCapacity;
+    IndentEvent* lines;
+    size_t lineCount;
+    size_t lineCapacity;
+} BlockEvents;
+
+/**
+ * @brief Checks whether a byte can change the lexer state beyond clearing
+ *        the escape and slash flags.
+ *
+ * @param c The byte.
+ * @return true for line breaks, blanks, quotes, slashes and brackets, false otherwise.
+ */
+static bool IsSignificant(char c) {
+    static bool table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        const char* significant = "\n\r\t \"\\/()[]{}";
+        for (const char* p = significant; *p; p++) {
+            table[(unsigned char)*p] = true;
+        }
+        initialized = true;
+    }
+    return table[(unsigned char)c];
+}
+
+/**
+ * @brief Returns the summary of an empty range.
+ *
+ * @return The summary.
+ */
+static StructureSummary EmptySummary(void) {
+    StructureSummary summary = { 0, 0, 0, 0, STRUCTURE_NO_INDENT };
+    return summary;
+}
+
+/**
+ * @brief Combines the summaries of two adjacent ranges.
+ *
+ * @param left The first range.
+ * @param right The range following it.
+ * @return The summary of both ranges together.
+ */
+static StructureSummary Combine(const StructureSummary* left, const StructureSummary* right) {
+    StructureSummary result;
+    result.length = left->length + right->length;
+    result.delta = left->delta + right->delta;
+    result.minDepth = left->minDepth;
+    if (left->delta + right->minDepth < result.minDepth) {
+        result.minDepth = left->delta + right->minDepth;
+    }
+    result.maxSuffix = right->maxSuffix;
+    if (right->delta + left->maxSuffix > result.maxSuffix) {
+        result.maxSuffix = right->delta + left->maxSuffix;
+    }
+    result.minIndent = left->minIndent < right->minIndent ? left->minIndent : right->minIndent;
+    return result;
+}
+
+/**
+ * @brief Resets the lexer to the start of a line.
+ *
+ * @param state The lexer state.
+ */
+static void ScanReset(ScanState* state) {
+    memset(state, 0, sizeof(ScanState));
+    state->atLineStart = true;
+}
+
+/**
+ * @brief Feeds one byte to the lexer.
+ *
+ * @param state The lexer state.
+ * @param c The byte.
+ * @param[out] indent Receives the indentation of the line if c is its first
+ *             non-blank character, STRUCTURE_NO_INDENT otherwise.
+ * @return 1 for an opening bracket, -1 for a closing bracket, 0 otherwise.
+ */
+static int ScanByte(ScanState* state, char c, uint32_t* indent) {
+    *indent = STRUCTURE_NO_INDENT;
+
+    if (c == '\n') {
+        ScanReset(state);
+        return 0;
+    }
+
+    if (state->atLineStart) {
+        if (c == ' ') {
+            state->indent++;
+            return 0;
+        }
+        if (c == '\t') {
+            state->indent = (state->indent / LAYOUT_TAB_WIDTH + 1) * LAYOUT_TAB_WIDTH;
+            return 0;
+        }
+        if (c == '\r') {
+            return 0;
+        }
+        state->atLineStart = false;
+        *indent = state->indent;
+    }
+
+    if (state->inComment) {
+        return 0;
+    }
+
+    if (state->inString) {
+        if (state->escaped) {
+            state->escaped = false;
+        } else if (c == '\\') {
+            state->escaped = true;
+        } else if (c == '"') {
+            state->inString = false;
+        }
+        return 0;
+    }
+
+    if (c == '/') {
+        if (state->slash) {
+            state->inComment = true;
+        }
+        state->slash = !state->slash;
+        return 0;
+    }
+    state->slash = false;
+
+    switch (c) {
+        case '"':
+            state->inString = true;
+            return 0;
+        case '(':
+        case '[':
+        case '{':
+            return 1;
+        case ')':
+        case ']':
+        case '}':
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Appends a summary to a list.
+ *
+ * @param list The list.
+ * @param summary The summary.
+ */
+static void SummaryListPush(SummaryList* list, const StructureSummary* summary) {
+    if (list->failed) {
+        return;
+    }
+    if (list->count == list->capacity) {
+        size_t newCapacity = list->capacity ? list->capacity * 2 : 64;
+        StructureSummary* newItems = (StructureSummary*)MemoryRealloc(MEMORY_TAG_STRUCTURE, list->items,
+                                                                      newCapacity * sizeof(StructureSummary));
+        if (!newItems) {
+            list->failed = true;
+            return;
+        }
+        list->items = newItems;
+        list->capacity = newCapacity;
+    }
+    list->items[list->count++] = *summary;
+}
+
+/**
+ * @brief Scans a range of the document into block summaries.
+ *
+ * The range must start at a block boundary.
+ *
+ * @param document The document.
+ * @param start Start of the range.
+ * @param end End of the range.
+ * @param splitAt Bytes after which a block ends at the next line break.
+ * @param list The list receiving the blocks.
+ */
+static void ScanRange(const Document* document, uint64_t start, uint64_t end, uint64_t splitAt,
+                      SummaryList* list) {
+    DocumentIterator iterator;
+    DocumentIterInit(document, start, &iterator);
+
+    ScanState state;
+    ScanReset(&state);
+    StructureSummary block = EmptySummary();
+    uint64_t position = start;
+    const char* data;
+    size_t length;
+
+    while (position < end && DocumentIterNext(&iterator, &data, &length)) {
+        if (length > end - position) {
+            length = (size_t)(end - position);
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            // Ordinary bytes after the indentation only clear the escape and slash flags
+            if (!state.atLineStart && !IsSignificant(data[i]) && block.length + 1 < STRUCTURE_BLOCK_MAX) {
+                state.escaped = false;
+                state.slash = false;
+                block.length++;
+                continue;
+            }
+
+            uint32_t indent;
+            int delta = ScanByte(&state, data[i], &indent);
+            if (indent < block.minIndent) {
+                block.minIndent = indent;
+            }
+            block.length++;
+            if (delta != 0) {
+                block.delta += delta;
+                if (block.delta < block.minDepth) {
+                    block.minDepth = block.delta;
+                }
+                block.maxSuffix += delta;
+                if (block.maxSuffix < 0) {
+                    block.maxSuffix = 0;
+                }
+            }
+            if ((data[i] == '\n' && block.length >= splitAt) || block.length >= STRUCTURE_BLOCK_MAX) {
+                SummaryListPush(list, &block);
+                block = EmptySummary();
+                ScanReset(&state);
+            }
+        }
+        position += length;
+    }
+
+    if (block.length > 0) {
+        SummaryListPush(list, &block);
+    }
+}
+
+/**
+ * @brief Builds the tree over a list of block summaries.
+ *
+ * @param index The index.
+ * @param blocks The blocks in document order.
+ * @param blockCount Number of blocks.
+ * @return true if successful, false on allocation failure.
+ */
+static bool BuildTree(StructureIndex* index, const StructureSummary* blocks, size_t blockCount) {
+    size_t leafBase = 1;
+    while (leafBase < blockCount) {
+        leafBase *= 2;
+    }
+
+    StructureSummary* nodes = (StructureSummary*)MemoryAlloc(MEMORY_TAG_STRUCTURE,
+                                                             2 * leafBase * sizeof(StructureSummary));
+    if (!nodes) {
+        return false;
+    }
+
+    for (size_t i = 0; i < leafBase; i++) {
+        nodes[leafBase + i] = i < blockCount ? blocks[i] : EmptySummary();
+    }
+    for (size_t node = leafBase - 1; node >= 1; node--) {
+        nodes[node] = Combine(&nodes[2 * node], &nodes[2 * node + 1]);
+    }
+
+    MemoryFree(index->nodes);
+    index->nodes = nodes;
+    index->leafBase = leafBase;
+    index->leafCount = blockCount;
+    return true;
+}
+
+/**
+ * @brief Discards the tree so that the next query rebuilds it.
+ *
+ * @param index The index.
+ */
+static void Invalidate(StructureIndex* index) {
+    MemoryFree(index->nodes);
+    index->nodes = NULL;
+    index->leafBase = 0;
+    index->leafCount = 0;
+    index->built = false;
+}
+
+/**
+ * @brief Builds the tree from the whole document if it is not current.
+ *
+ * @param index The index.
+ * @return true if the tree is available, false on allocation failure.
+ */
+static bool EnsureBuilt(StructureIndex* index) {
+    if (index->built) {
+        return true;
+    }
+
+    SummaryList list = { 0 };
+    ScanRange(index->document, 0, DocumentLength(index->document), STRUCTURE_BLOCK_TARGET, &list);
+    bool success = !list.failed && BuildTree(index, list.items, list.count);
+    MemoryFree(list.items);
+    index->built = success;
+    return success;
+}
+
+/**
+ * @brief Gets the length of a block.
+ *
+ * @param index The index.
+ * @param leaf The block number.
+ * @return The length in bytes.
+ */
+static uint64_t LeafLength(const StructureIndex* index, size_t leaf) {
+    return index->nodes[index->leafBase + leaf].length;
+}
+
+/**
+ * @brief Gets the offset at which a block starts.
+ *
+ * @param index The index.
+ * @param leaf The block number.
+ * @return The offset.
+ */
+static uint64_t LeafStart(const StructureIndex* index, size_t leaf) {
+    uint64_t start = 0;
+    for (size_t node = index->leafBase + leaf; node > 1; node /= 2) {
+        if (node & 1) {
+            start += index->nodes[node - 1].length;
+        }
+    }
+    return start;
+}
+
+/**
+ * @brief Finds the block containing an offset.
+ *
+ * Offsets at or past the end of the document map to the last block.
+ *
+ * @param index The index; it must hold at least one block.
+ * @param offset The offset.
+ * @param[out] start Receives the offset at which the block starts.
+ * @return The block number.
+ */
+static size_t FindLeaf(const StructureIndex* index, uint64_t offset, uint64_t* start) {
+    if (offset >= index->nodes[1].length) {
+        size_t last = index->leafCount - 1;
+        *start = index->nodes[1].length - LeafLength(index, last);
+        return last;
+    }
+
+    size_t node = 1;
+    uint64_t base = 0;
+    while (node < index->leafBase) {
+        uint64_t leftLength = index->nodes[2 * node].length;
+        if (offset < base + leftLength) {
+            node = 2 * node;
+        } else {
+            base += leftLength;
+            node = 2 * node + 1;
+        }
+    }
+    *start = base;
+    return node - index->leafBase;
+}
+
+/**
+ * @brief Finds the first block at or after a block where the running balance drops to a target.
+ *
+ * @param index The index.
+ * @param node The subtree being searched.
+ * @param low First block of the subtree.
+ * @param high Block after the last block of the subtree.
+ * @param from First block to consider.
+ * @param target The balance to reach (negative).
+ * @param[in,out] balance The balance accumulated before the subtree; on
+ *                success, the balance before the returned block.
+ * @param[out] leaf Receives the block number.
+ * @return true if found, false otherwise.
+ */
+static bool FindForward(const StructureIndex* index, size_t node, size_t low, size_t high, size_t from,
+                        int64_t target, int64_t* balance, size_t* leaf) {
+    if (high <= from) {
+        return false;
+    }
+
+    const StructureSummary* summary = &index->nodes[node];
+    if (low >= from && *balance + summary->minDepth > target) {
+        *balance += summary->delta;
+        return false;
+    }
+
+    if (high - low == 1) {
+        *leaf = low;
+        return true;
+    }
+
+    size_t middle = low + (high - low) / 2;
+    return FindForward(index, 2 * node, low, middle, from, target, balance, leaf) ||
+           FindForward(index, 2 * node + 1, middle, high, from, target, balance, leaf);
+}
+
+/**
+ * @brief Finds the last block at or before a block where a suffix balance rises to a target.
+ *
+ * @param index The index.
+ * @param node The subtree being searched.
+ * @param low First block of the subtree.
+ * @param high Block after the last block of the subtree.
+ * @param from Last block to consider.
+ * @param target The balance to reach (positive).
+ * @param[in,out] balance The balance accumulated after the subtree; on
+ *                success, the balance after the returned block.
+ * @param[out] leaf Receives the block number.
+ * @return true if found, false otherwise.
+ */
+static bool FindBackward(const StructureIndex* index, size_t node, size_t low, size_t high, size_t from,
+                         int64_t target, int64_t* balance, size_t* leaf) {
+    if (low > from) {
+        return false;
+    }
+
+    const StructureSummary* summary = &index->nodes[node];
+    if (high - 1 <= from && *balance + summary->maxSuffix < target) {
+        *balance += summary->delta;
+        return false;
+    }
+
+    if (high - low == 1) {
+        *leaf = low;
+        return true;
+    }
+
+    size_t middle = low + (high - low) / 2;
+    return FindBackward(index, 2 * node + 1, middle, high, from, target, balance, leaf) ||
+           FindBackward(index, 2 * node, low, middle, from, target, balance, leaf);
+}
+
+/**
+ * @brief Finds the first block at or after a block with a line indented at most a given amount.
+ *
+ * @param index The index.
+ * @param from First block to consider.
+ * @param indent The indentation.
+ * @param[out] leaf Receives the block number.
+ * @return true if found, false otherwise.
+ */
+static bool FindIndent(const StructureIndex* index, size_t from, uint32_t indent, size_t* leaf) {
+    // Walk up from the start block collecting right siblings, then descend into the first match
+    size_t node = index->leafBase + from;
+    if (from >= index->leafCount) {
+        return false;
+    }
+    if (index->nodes[node].minIndent <= indent) {
+        *leaf = from;
+        return true;
+    }
+
+    while (node > 1) {
+        if (!(node & 1) && index->nodes[node + 1].minIndent <= indent) {
+            node++;
+            while (node < index->leafBase) {
+                node = index->nodes[2 * node].minIndent <= indent ? 2 * node : 2 * node + 1;
+            }
+            *leaf = node - index->leafBase;
+            return true;
+        }
+        node /= 2;
+    }
+    return false;
+}
+
+/**
+ * @brief Releases the memory held by block events.
+ *
+ * @param events The events.
+ */
+static void BlockEventsFree(BlockEvents* events) {
+    MemoryFree(events->brackets);
+    MemoryFree(events->lines);
+    memset(events, 0, sizeof(BlockEvents));
+}
+
+/**
+ * @brief Scans one block for its brackets and non-blank line starts.
+ *
+ * @param index The index.
+ * @param leaf The block number.
+ * @param start Offset at which the block starts.
+ * @param[out] events Receives the events; free with BlockEventsFree.
+ * @return true if successful, false on allocation failure.
+ */
+static bool ScanLeaf(const StructureIndex* index, size_t leaf, uint64_t start, BlockEvents* events) {
+    memset(events, 0, sizeof(BlockEvents));
+
+    uint64_t end = start + LeafLength(index, leaf);
+    DocumentIterator iterator;
+    DocumentIterInit(index->document, start, &iterator);
+
+    ScanState state;
+    ScanReset(&state);
+    uint64_t position = start;
+    const char* data;
+    size_t length;
+
+    while (position < end && DocumentIterNext(&iterator, &data, &length)) {
+        if (length > end - position) {
+            length = (size_t)(end - position);
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            uint32_t indent;
+            int delta = ScanByte(&state, data[i], &indent);
+
+            if (indent != STRUCTURE_NO_INDENT) {
+                if (events->lineCount == events->lineCapacity) {
+                    size_t newCapacity = events->lineCapacity ? events->lineCapacity * 2 : 64;
+                    IndentEvent* newLines = (IndentEvent*)MemoryRealloc(MEMORY_TAG_STRUCTURE, events->lines,
+                                                                        newCapacity * sizeof(IndentEvent));
+                    if (!newLines) {
+                        BlockEventsFree(events);
+                        return false;
+                    }
+                    events->lines = newLines;
+                    events->lineCapacity = newCapacity;
+                }
+                events->lines[events->lineCount].offset = position + i;
+                events->lines[events->lineCount].indent = indent;
+                events->lineCount++;
+            }
+
+            if (delta != 0) {
+                if (events->bracketCount == events->bracketCapacity) {
+                    size_t newCapacity = events->bracketCapacity ? events->bracketCapacity * 2 : 64;
+                    BracketEvent* newBrackets = (BracketEvent*)MemoryRealloc(MEMORY_TAG_STRUCTURE, events->brackets,
+                                                                             newCapacity * sizeof(BracketEvent));
+                    if (!newBrackets) {
+                        BlockEventsFree(events);
+                        return false;
+                    }
+                    events->brackets = newBrackets;
+                    events->bracketCapacity = newCapacity;
+                }
+                events->brackets[events->bracketCount].offset = position + i;
+                events->brackets[events->bracketCount].delta = delta;
+                events->bracketCount++;
+            }
+        }
+        position += length;
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the unmatched opening bracket closest before an offset.
+ *
+ * @param index The index; it must be built.
+ * @param position Only brackets before this offset are considered.
+ * @param[out] open Receives the offset of the bracket.
+ * @return true if found, false otherwise.
+ */
+static bool FindOpenBefore(const StructureIndex* index, uint64_t position, uint64_t* open) {
+    if (index->leafCount == 0) {
+        return false;
+    }
+
+    uint64_t start;
+    size_t leaf = FindLeaf(index, position, &start);
+    int64_t balance = 0;
+
+    BlockEvents events;
+    if (!ScanLeaf(index, leaf, start, &events)) {
+        return false;
+    }
+    for (size_t i = events.bracketCount; i > 0; i--) {
+        const BracketEvent* event = &events.brackets[i - 1];
+        if (event->offset >= position) {
+            continue;
+        }
+        balance += event->delta;
+        if (balance == 1) {
+            *open = event->offset;
+            BlockEventsFree(&events);
+            return true;
+        }
+    }
+    BlockEventsFree(&events);
+
+    // balance <= 0 here; an earlier block has to rise by 1 - balance
+    int64_t target = 1 - balance;
+    int64_t found = 0;
+    size_t match;
+    if (leaf == 0 || !FindBackward(index, 1, 0, index->leafBase, leaf - 1, target, &found, &match)) {
+        return false;
+    }
+
+    if (!ScanLeaf(index, match, LeafStart(index, match), &events)) {
+        return false;
+    }
+    bool success = false;
+    for (size_t i = events.bracketCount; i > 0; i--) {
+        found += events.brackets[i - 1].delta;
+        if (found == target) {
+            *open = events.brackets[i - 1].offset;
+            success = true;
+            break;
+        }
+    }
+    BlockEventsFree(&events);
+    return success;
+}
+
+/**
+ * @brief Finds the unmatched closing bracket closest at or after an offset.
+ *
+ * @param index The index; it must be built.
+ * @param position Only brackets at or after this offset are considered.
+ * @param[out] close Receives the offset of the bracket.
+ * @return true if found, false otherwise.
+ */
+static bool FindCloseAfter(const StructureIndex* index, uint64_t position, uint64_t* close) {
+    if (index->leafCount == 0) {
+        return false;
+    }
+
+    uint64_t start;
+    size_t leaf = FindLeaf(index, position, &start);
+    int64_t balance = 0;
+
+    BlockEvents events;
+    if (!ScanLeaf(index, leaf, start, &events)) {
+        return false;
+    }
+    for (size_t i = 0; i < events.bracketCount; i++) {
+        const BracketEvent* event = &events.brackets[i];
+        if (event->offset < position) {
+            continue;
+        }
+        balance += event->delta;
+        if (balance == -1) {
+            *close = event->offset;
+            BlockEventsFree(&events);
+            return true;
+        }
+    }
+    BlockEventsFree(&events);
+
+    // balance >= 0 here; a later block has to drop by balance + 1
+    int64_t target = -balance - 1;
+    int64_t found = 0;
+    size_t match;
+    if (!FindForward(index, 1, 0, index->leafBase, leaf + 1, target, &found, &match)) {
+        return false;
+    }
+
+    if (!ScanLeaf(index, match, LeafStart(index, match), &events)) {
+        return false;
+    }
+    bool success = false;
+    for (size_t i = 0; i < events.bracketCount; i++) {
+        found += events.brackets[i].delta;
+        if (found == target) {
+            *close = events.brackets[i].offset;
+            success = true;
+            break;
+        }
+    }
+    BlockEventsFree(&events);
+    return success;
+}
+
+/**
+ * @brief Checks whether two bracket characters form a pair.
+ *
+ * @param open The opening character.
+ * @param close The closing character.
+ * @return true if they belong together, false otherwise.
+ */
+static bool IsPair(char open, char close) {
+    return (open == '(' && close == ')') || (open == '[' && close == ']') || (open == '{' && close == '}');
+}
+
+/**
+ * @brief Checks whether a line holds only blanks.
+ *
+ * @param document The document.
+ * @param line The line.
+ * @return true if the line is blank, false otherwise.
+ */
+static bool IsBlankLine(const Document* document, uint64_t line) {
+    uint64_t start = DocumentLineStart(document, line);
+    uint64_t end = DocumentLineEnd(document, line);
+    DocumentIterator iterator;
+    DocumentIterInit(document, start, &iterator);
+
+    const char* data;
+    size_t length;
+    while (start < end && DocumentIterNext(&iterator, &data, &length)) {
+        if (length > end - start) {
+            length = (size_t)(end - start);
+        }
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != ' ' && data[i] != '\t' && data[i] != '\r') {
+                return false;
+            }
+        }
+        start += length;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies reported changes to the tree, rescanning only the blocks they touch.
+ *
+ * @param index The index; it must be built and hold at least one block.
+ * @param changes The changes in pre-change coordinates.
+ * @param changeCount Number of changes.
+ * @return true if successful, false if the tree has to be rebuilt.
+ */
+static bool UpdateLeaves(StructureIndex* index, const DocumentChange* changes, size_t changeCount) {
+    const Document* document = index->document;
+    uint64_t oldTotal = index->nodes[1].length;
+    uint64_t newTotal = DocumentLength(document);
+
+    // Old blocks [firstLeaf, lastLeaf] are replaced by the blocks at the end of newBlocks
+    typedef struct {
+        size_t firstLeaf;
+        size_t lastLeaf;
+        size_t firstBlock;
+        size_t blockCount;
+    } Region;
+
+    Region* regions = (Region*)MemoryAlloc(MEMORY_TAG_STRUCTURE, changeCount * sizeof(Region));
+    if (!regions) {
+        return false;
+    }
+    size_t regionCount = 0;
+    SummaryList newBlocks = { 0 };
+    bool sameShape = true;
+    int64_t shift = 0;
+    size_t next = 0;
+
+    while (next < changeCount) {
+        Region* region = &regions[regionCount++];
+        uint64_t oldStart;
+        region->firstLeaf = FindLeaf(index, changes[next].offset, &oldStart);
+        region->lastLeaf = region->firstLeaf;
+        uint64_t oldEnd = oldStart + LeafLength(index, region->firstLeaf);
+        int64_t regionShift = 0;
+
+        for (;;) {
+            while (next < changeCount && (changes[next].offset < oldEnd || oldEnd == oldTotal)) {
+                uint64_t removeEnd = changes[next].offset + changes[next].removedLength;
+                while (removeEnd > oldEnd && region->lastLeaf + 1 < index->leafCount) {
+                    region->lastLeaf++;
+                    oldEnd += LeafLength(index, region->lastLeaf);
+                }
+                regionShift += (int64_t)changes[next].insertedLength - (int64_t)changes[next].removedLength;
+                next++;
+            }
+
+            // The rescanned text has to end at a line break for the next block to stay valid
+            uint64_t newStart = (uint64_t)((int64_t)oldStart + shift);
+            uint64_t newEnd = (uint64_t)((int64_t)oldEnd + shift + regionShift);
+            if (newEnd >= newTotal || newEnd == newStart || region->lastLeaf + 1 >= index->leafCount ||
+                DocumentCharAt(document, newEnd - 1) == '\n') {
+                region->firstBlock = newBlocks.count;
+                ScanRange(document, newStart, newEnd, STRUCTURE_BLOCK_SPLIT, &newBlocks);
+                region->blockCount = newBlocks.count - region->firstBlock;
+                if (region->blockCount != region->lastLeaf - region->firstLeaf + 1) {
+                    sameShape = false;
+                }
+                break;
+            }
+            region->lastLeaf++;
+            oldEnd += LeafLength(index, region->lastLeaf);
+        }
+        shift += regionShift;
+    }
+
+    bool success = !newBlocks.failed;
+    if (success && sameShape) {
+        for (size_t r = 0; r < regionCount; r++) {
+            for (size_t i = 0; i < regions[r].blockCount; i++) {
+                size_t node = index->leafBase + regions[r].firstLeaf + i;
+                index->nodes[node] = newBlocks.items[regions[r].firstBlock + i];
+                for (node /= 2; node >= 1; node /= 2) {
+                    index->nodes[node] = Combine(&index->nodes[2 * node], &index->nodes[2 * node + 1]);
+                }
+            }
+        }
+    } else if (success) {
+        SummaryList blocks = { 0 };
+        size_t leaf = 0;
+        for (size_t r = 0; r < regionCount; r++) {
+            for (; leaf < regions[r].firstLeaf; leaf++) {
+                SummaryListPush(&blocks, &index->nodes[index->leafBase + leaf]);
+            }
+            for (size_t i = 0; i < regions[r].blockCount; i++) {
+                SummaryListPush(&blocks, &newBlocks.items[regions[r].firstBlock + i]);
+            }
+            leaf = regions[r].lastLeaf + 1;
+        }
+        for (; leaf < index->leafCount; leaf++) {
+            SummaryListPush(&blocks, &index->nodes[index->leafBase + leaf]);
+        }
+        success = !blocks.failed && BuildTree(index, blocks.items, blocks.count);
+        MemoryFree(blocks.items);
+    }
+
+    MemoryFree(newBlocks.items);
+    MemoryFree(regions);
+    return success;
+}
+
+/**
+ * @brief Keeps the index in step with document changes.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes, or NULL if unknown.
+ * @param changeCount Number of changes.
+ * @param context The index.
+ */
+static void StructureDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                     void* context) {
+    (void)document;
+    StructureIndex* index = (StructureIndex*)context;
+    if (!index->built) {
+        return;
+    }
+    if (!changes || changeCount == 0 || index->leafCount == 0 || !UpdateLeaves(index, changes, changeCount)) {
+        Invalidate(index);
+    }
+}
+
+/**
+ * @brief Creates the structure index of a document.
+ *
+ * The index registers itself as a document listener and is built the first
+ * time it is queried.
+ *
+ * @param document The document; it must outlive the index.
+ * @return The index, or NULL on allocation failure.
+ */
+StructureIndex* StructureIndexCreate(Document* document) {
+    StructureIndex* index = (StructureIndex*)MemoryCalloc(MEMORY_TAG_STRUCTURE, 1, sizeof(StructureIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    index->document = document;
+    if (!DocumentAddListener(document, StructureDocumentChanged, index)) {
+        MemoryFree(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**
+ * @brief Destroys a structure index and unregisters it from its document.
+ *
+ * @param index The index. NULL is ignored.
+ */
+void StructureIndexDestroy(StructureIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    DocumentRemoveListener(index->document, StructureDocumentChanged, index);
+    MemoryFree(index->nodes);
+    MemoryFree(index);
+}
+
+/**
+ * @brief Finds the bracket matching the bracket at an offset.
+ *
+ * @param index The index.
+ * @param offset Offset of a bracket character.
+ * @param[out] match Receives the offset of the matching bracket.
+ * @return true if the offset holds a bracket with a partner of the same kind, false otherwise.
+ */
+bool StructureFindMatchingBracket(StructureIndex* index, uint64_t offset, uint64_t* match) {
+    if (!index || offset >= DocumentLength(index->document) || !EnsureBuilt(index)) {
+        return false;
+    }
+
+    // Only brackets the lexer counts (not in strings or comments) have partners
+    uint64_t start;
+    size_t leaf = FindLeaf(index, offset, &start);
+    BlockEvents events;
+    if (!ScanLeaf(index, leaf, start, &events)) {
+        return false;
+    }
+    int delta = 0;
+    for (size_t i = 0; i < events.bracketCount; i++) {
+        if (events.brackets[i].offset == offset) {
+            delta = events.brackets[i].delta;
+            break;
+        }
+    }
+    BlockEventsFree(&events);
+
+    char c = DocumentCharAt(index->document, offset);
+    uint64_t partner;
+    if (delta > 0) {
+        if (!FindCloseAfter(index, offset + 1, &partner) ||
+            !IsPair(c, DocumentCharAt(index->document, partner))) {
+            return false;
+        }
+    } else if (delta < 0) {
+        if (!FindOpenBefore(index, offset, &partner) ||
+            !IsPair(DocumentCharAt(index->document, partner), c)) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    *match = partner;
+    return true;
+}
+
+/**
+ * @brief Finds the innermost bracket pair around an offset.
+ *
+ * @param index The index.
+ * @param offset The offset.
+ * @param[out] open Receives the offset of the opening bracket (before offset).
+ * @param[out] close Receives the offset of the closing bracket (at or after offset).
+ * @return true if the offset is enclosed by a pair of the same kind, false otherwise.
+ */
+bool StructureFindEnclosingBrackets(StructureIndex* index, uint64_t offset, uint64_t* open, uint64_t* close) {
+    if (!index || !EnsureBuilt(index)) {
+        return false;
+    }
+
+    uint64_t openOffset;
+    uint64_t closeOffset;
+    if (!FindOpenBefore(index, offset, &openOffset) || !FindCloseAfter(index, offset, &closeOffset) ||
+        !IsPair(DocumentCharAt(index->document, openOffset), DocumentCharAt(index->document, closeOffset))) {
+        return false;
+    }
+
+    *open = openOffset;
+    *close = closeOffset;
+    return true;
+}
+
+/**
+ * @brief Finds the lines indented deeper than a line and following it.
+ *
+ * Trailing blank lines are not part of the block.
+ *
+ * @param index The index.
+ * @param line The header line.
+ * @param[out] lastLine Receives the last line of the block.
+ * @return true if at least one line follows with a deeper indentation, false otherwise.
+ */
+bool StructureFindIndentBlock(StructureIndex* index, uint64_t line, uint64_t* lastLine) {
+    if (!index || !EnsureBuilt(index) || index->leafCount == 0) {
+        return false;
+    }
+
+    const Document* document = index->document;
+    uint64_t lineCount = DocumentLineCount(document);
+    if (line + 1 >= lineCount) {
+        return false;
+    }
+
+    // The header's own indentation comes from its entry in the block scan
+    uint64_t lineStart = DocumentLineStart(document, line);
+    uint64_t lineEnd = DocumentLineEnd(document, line);
+    uint64_t start;
+    size_t leaf = FindLeaf(index, lineStart, &start);
+    BlockEvents events;
+    if (!ScanLeaf(index, leaf, start, &events)) {
+        return false;
+    }
+
+    bool haveHeader = false;
+    uint32_t indent = 0;
+    uint64_t stopOffset = 0;
+    bool haveStop = false;
+    for (size_t i = 0; i < events.lineCount; i++) {
+        const IndentEvent* event = &events.lines[i];
+        if (event->offset < lineStart) {
+            continue;
+        }
+        if (!haveHeader) {
+            if (event->offset >= lineEnd) {
+                break;
+            }
+            haveHeader = true;
+            indent = event->indent;
+            continue;
+        }
+        if (event->indent <= indent) {
+            stopOffset = event->offset;
+            haveStop = true;
+            break;
+        }
+    }
+    BlockEventsFree(&events);
+    if (!haveHeader) {
+        return false;
+    }
+
+    uint64_t last = lineCount - 1;
+    if (!haveStop) {
+        size_t stopLeaf;
+        if (FindIndent(index, leaf + 1, indent, &stopLeaf)) {
+            if (!ScanLeaf(index, stopLeaf, LeafStart(index, stopLeaf), &events)) {
+                return false;
+            }
+            for (size_t i = 0; i < events.lineCount; i++) {
+                if (events.lines[i].indent <= indent) {
+                    stopOffset = events.lines[i].offset;
+                    haveStop = true;
+                    break;
+                }
+            }
+            BlockEventsFree(&events);
+        }
+    }
+    if (haveStop) {
+        last = DocumentLineFromOffset(document, stopOffset) - 1;
+    }
+
+    while (last > line && IsBlankLine(document, last)) {
+        last--;
+    }
+    if (last <= line) {
+        return false;
+    }
+
+    *lastLine = last;
+    return true;
+}
+
+/**
+ * @brief Finds the region that folds at a line.
+ *
+ * A bracket pair opened on the line is preferred, then an indentation
+ * block below the line, then the innermost bracket pair around the line.
+ * The header line stays visible; for bracket pairs so does the line of the
+ * closing bracket.
+ *
+ * @param index The index.
+ * @param line The line.
+ * @param[out] headerLine Receives the line that stays visible above the region.
+ * @param[out] lastLine Receives the last line hidden by the region.
+ * @return true if a region with at least one hidden line was found, false otherwise.
+ */
+bool StructureFindFoldRange(StructureIndex* index, uint64_t line, uint64_t* headerLine, uint64_t* lastLine) {
+    if (!index || !EnsureBuilt(index)) {
+        return false;
+    }
+
+    const Document* document = index->document;
+    uint64_t lineStart = DocumentLineStart(document, line);
+    uint64_t position = DocumentLineEnd(document, line);
+    bool tryIndent = true;
+
+    for (int attempt = 0; attempt < STRUCTURE_MAX_ENCLOSING; attempt++) {
+        uint64_t open;
+        uint64_t close;
+        bool found = FindOpenBefore(index, position, &open) && FindCloseAfter(index, open + 1, &close);
+
+        // An indentation block below the line beats a pair opened on an earlier line
+        if (tryIndent && (!found || open < lineStart)) {
+            tryIndent = false;
+            if (StructureFindIndentBlock(index, line, lastLine)) {
+                *headerLine = line;
+                return true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+
+        uint64_t openLine = DocumentLineFromOffset(document, open);
+        uint64_t closeLine = DocumentLineFromOffset(document, close);
+        if (closeLine > openLine + 1) {
+            *headerLine = openLine;
+            *lastLine = closeLine - 1;
+            return true;
+        }
+        position = open;
+    }
+    return false;
+}
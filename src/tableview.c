@@ -0,0 +1,773 @@
+/**
+ * @file tableview.c
+ * @brief Table view implementation for the Professional Text Editor
+ *
+ * The first row of the document is drawn as a fixed header and the other
+ * rows below it, each column as wide as the widest value of the sampled
+ * rows. Only the rows on screen are parsed. The row index is dropped when
+ * the document changes and rebuilt the next time the view needs it.
+ */
+
+#include "../include/tableview.h"
+#include "../include/csvindex.h"
+#include <limits.h>
+#include <string.h>
+#include <windowsx.h> // For GET_X_LPARAM and GET_Y_LPARAM
+
+// Font of the view; same as the editor view
+#define TABLE_VIEW_FONT_NAME "Consolas"
+#define TABLE_VIEW_FONT_HEIGHT 16
+
+// Most columns shown
+#define TABLE_VIEW_MAX_COLUMNS 256
+
+// Width of columns found beyond the sampled ones
+#define TABLE_VIEW_DEFAULT_WIDTH 10
+
+// Rows scrolled per mouse wheel notch
+#define TABLE_VIEW_WHEEL_LINES 3
+
+// Longest row number typed to jump to a row
+#define TABLE_VIEW_GOTO_DIGITS 20
+
+// Background of the header row, the current row and the row numbers
+#define TABLE_VIEW_HEADER_COLOR RGB(230, 230, 230)
+#define TABLE_VIEW_CURRENT_COLOR RGB(173, 214, 255)
+#define TABLE_VIEW_NUMBER_COLOR RGB(128, 128, 128)
+
+// State of one table view window
+typedef struct {
+    Document* document;         // Document shown, owned by the editor view, or NULL
+    CsvIndex* index;            // Row index, or NULL until built again after a change
+    char delimiter;             // Requested delimiter, or 0 to guess it
+    uint64_t* order;            // Starts of the data rows in sorted order, or NULL for file order
+    size_t sortColumn;
+    BOOL sortDescending;
+    uint32_t widths[TABLE_VIEW_MAX_COLUMNS];
+    size_t columnCount;
+    HFONT font;
+    int charWidth;
+    int lineHeight;
+    uint64_t firstRow;          // First visible data row (the header is not a data row)
+    size_t firstColumn;         // First visible column
+    int visibleLines;           // Data rows that fit below the header
+    int scrollShift;            // Rows per scroll bar unit as a power of two, for more than INT_MAX rows
+    uint64_t currentRow;        // Highlighted data row
+    char gotoText[TABLE_VIEW_GOTO_DIGITS + 1];  // Row number being typed
+    size_t gotoLength;
+} TableView;
+
+/**
+ * @brief Gets the state attached to a table view window.
+ *
+ * @param hWnd Handle to the view.
+ * @return The view state, or NULL if the window has none.
+ */
+static TableView* GetView(HWND hWnd) {
+    return hWnd ? (TableView*)GetWindowLongPtr(hWnd, GWLP_USERDATA) : NULL;
+}
+
+/**
+ * @brief Builds the row index and sizes the columns if the document changed since the last build.
+ *
+ * @param view The view.
+ * @return TRUE if the view has an index, FALSE otherwise.
+ */
+static BOOL EnsureIndex(TableView* view) {
+    if (view->index || !view->document) {
+        return view->index != NULL;
+    }
+    view->index = CsvIndexBuild(view->document, view->delimiter);
+    if (!view->index) {
+        return FALSE;
+    }
+    memset(view->widths, 0, sizeof(view->widths));
+    view->columnCount = CsvIndexSampleWidths(view->index, view->widths, TABLE_VIEW_MAX_COLUMNS);
+    if (view->firstColumn >= view->columnCount) {
+        view->firstColumn = 0;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Gets the number of data rows, the header excluded.
+ *
+ * @param view The view.
+ * @return The row count.
+ */
+static uint64_t DataRowCount(const TableView* view) {
+    uint64_t rows = CsvIndexRowCount(view->index);
+    return rows > 1 ? rows - 1 : 0;
+}
+
+/**
+ * @brief Gets the offset where a data row starts, in the current order.
+ *
+ * @param view The view.
+ * @param row The data row.
+ * @return The offset of the row.
+ */
+static uint64_t DataRowStart(const TableView* view, uint64_t row) {
+    return view->order ? view->order[row] : CsvIndexRowStart(view->index, row + 1);
+}
+
+/**
+ * @brief Gets the width of the row number column, in characters.
+ *
+ * @param view The view.
+ * @return The width, including a space before the first column.
+ */
+static int NumberWidth(const TableView* view) {
+    int digits = 1;
+    for (uint64_t rows = DataRowCount(view); rows >= 10; rows /= 10) {
+        digits++;
+    }
+    if ((int)view->gotoLength > digits) {
+        digits = (int)view->gotoLength;
+    }
+    return digits + 1;
+}
+
+/**
+ * @brief Updates the scroll bars from the row and column counts and the scroll position.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void UpdateScrollBars(HWND hWnd, TableView* view) {
+    uint64_t rowCount = DataRowCount(view);
+    uint64_t lastRow = rowCount > 0 ? rowCount - 1 : 0;
+    view->scrollShift = 0;
+    while ((lastRow >> view->scrollShift) > INT_MAX) {
+        view->scrollShift++;
+    }
+
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_RANGE | SIF_PAGE | SIF_POS;
+    si.nMin = 0;
+    si.nMax = (int)(lastRow >> view->scrollShift);
+    si.nPage = (UINT)(view->scrollShift == 0 ? view->visibleLines : 1);
+    si.nPos = (int)(view->firstRow >> view->scrollShift);
+    SetScrollInfo(hWnd, SB_VERT, &si, TRUE);
+
+    si.nMax = view->columnCount > 0 ? (int)view->columnCount - 1 : 0;
+    si.nPage = 1;
+    si.nPos = (int)view->firstColumn;
+    SetScrollInfo(hWnd, SB_HORZ, &si, TRUE);
+}
+
+/**
+ * @brief Scrolls the view to a data row and column.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param firstRow New first visible data row.
+ * @param firstColumn New first visible column.
+ */
+static void ScrollViewTo(HWND hWnd, TableView* view, uint64_t firstRow, size_t firstColumn) {
+    uint64_t rowCount = DataRowCount(view);
+    if (firstRow >= rowCount) {
+        firstRow = rowCount > 0 ? rowCount - 1 : 0;
+    }
+    if (firstColumn >= view->columnCount) {
+        firstColumn = view->columnCount > 0 ? view->columnCount - 1 : 0;
+    }
+    if (firstRow == view->firstRow && firstColumn == view->firstColumn) {
+        return;
+    }
+    view->firstRow = firstRow;
+    view->firstColumn = firstColumn;
+    UpdateScrollBars(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Highlights a data row and scrolls it into view.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param row The data row; clamped to the last row.
+ */
+static void SetCurrentRow(HWND hWnd, TableView* view, uint64_t row) {
+    uint64_t rowCount = DataRowCount(view);
+    if (row >= rowCount) {
+        row = rowCount > 0 ? rowCount - 1 : 0;
+    }
+    view->currentRow = row;
+
+    uint64_t rows = view->visibleLines > 0 ? (uint64_t)view->visibleLines : 1;
+    if (row < view->firstRow) {
+        ScrollViewTo(hWnd, view, row, view->firstColumn);
+    } else if (row >= view->firstRow + rows) {
+        ScrollViewTo(hWnd, view, row - rows + 1, view->firstColumn);
+    }
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Sorts the data rows by a column, or reverses the order if it is already sorted by it.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param column The column.
+ */
+static void SortByColumn(HWND hWnd, TableView* view, size_t column) {
+    BOOL descending = view->order && view->sortColumn == column && !view->sortDescending;
+    HCURSOR oldCursor = SetCursor(LoadCursor(NULL, IDC_WAIT));
+    uint64_t* order = CsvIndexSortRows(view->index, column, 1, descending ? true : false);
+    SetCursor(oldCursor);
+    if (!order) {
+        MessageBeep(MB_ICONWARNING);
+        return;
+    }
+    free(view->order);
+    view->order = order;
+    view->sortColumn = column;
+    view->sortDescending = descending;
+    SetCurrentRow(hWnd, view, 0);
+}
+
+/**
+ * @brief Restores the file order of the data rows.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void ClearSort(HWND hWnd, TableView* view) {
+    if (!view->order) {
+        return;
+    }
+    free(view->order);
+    view->order = NULL;
+    SetCurrentRow(hWnd, view, 0);
+}
+
+/**
+ * @brief Drops the row index after a change of the document.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes.
+ * @param changeCount Number of changes.
+ * @param context Handle to the view.
+ */
+static void TableDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                 void* context) {
+    (void)document;
+    (void)changes;
+    (void)changeCount;
+    HWND hWnd = (HWND)context;
+    TableView* view = GetView(hWnd);
+    if (!view) {
+        return;
+    }
+    CsvIndexDestroy(view->index);
+    view->index = NULL;
+    free(view->order);
+    view->order = NULL;
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Handles navigation keys.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param key The virtual key code.
+ * @return TRUE if the key was handled, FALSE otherwise.
+ */
+static BOOL HandleKeyDown(HWND hWnd, TableView* view, WPARAM key) {
+    BOOL control = GetKeyState(VK_CONTROL) < 0;
+    uint64_t row = view->currentRow;
+    uint64_t page = view->visibleLines > 1 ? (uint64_t)(view->visibleLines - 1) : 1;
+
+    switch (key) {
+        case VK_UP:
+            SetCurrentRow(hWnd, view, row > 0 ? row - 1 : 0);
+            return TRUE;
+        case VK_DOWN:
+            SetCurrentRow(hWnd, view, row + 1);
+            return TRUE;
+        case VK_PRIOR:
+            ScrollViewTo(hWnd, view, view->firstRow > page ? view->firstRow - page : 0, view->firstColumn);
+            SetCurrentRow(hWnd, view, row > page ? row - page : 0);
+            return TRUE;
+        case VK_NEXT:
+            ScrollViewTo(hWnd, view, view->firstRow + page, view->firstColumn);
+            SetCurrentRow(hWnd, view, row + page);
+            return TRUE;
+        case VK_HOME:
+            if (control) {
+                SetCurrentRow(hWnd, view, 0);
+            } else {
+                ScrollViewTo(hWnd, view, view->firstRow, 0);
+            }
+            return TRUE;
+        case VK_END:
+            if (control) {
+                SetCurrentRow(hWnd, view, UINT64_MAX);
+            } else {
+                ScrollViewTo(hWnd, view, view->firstRow, view->columnCount);
+            }
+            return TRUE;
+        case VK_LEFT:
+            ScrollViewTo(hWnd, view, view->firstRow, view->firstColumn > 0 ? view->firstColumn - 1 : 0);
+            return TRUE;
+        case VK_RIGHT:
+            ScrollViewTo(hWnd, view, view->firstRow, view->firstColumn + 1);
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+/**
+ * @brief Handles typed characters: digits followed by Enter jump to a row.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param character The character code.
+ */
+static void HandleChar(HWND hWnd, TableView* view, WPARAM character) {
+    if (character >= '0' && character <= '9') {
+        if (view->gotoLength < TABLE_VIEW_GOTO_DIGITS) {
+            view->gotoText[view->gotoLength++] = (char)character;
+            view->gotoText[view->gotoLength] = '\0';
+        }
+    } else if (character == '\b') {
+        if (view->gotoLength > 0) {
+            view->gotoText[--view->gotoLength] = '\0';
+        }
+    } else if (character == '\r' && view->gotoLength > 0) {
+        uint64_t row = strtoull(view->gotoText, NULL, 10);
+        view->gotoLength = 0;
+        view->gotoText[0] = '\0';
+        SetCurrentRow(hWnd, view, row > 0 ? row - 1 : 0);
+
+        // Center the row when it is far away
+        uint64_t half = view->visibleLines > 0 ? (uint64_t)view->visibleLines / 2 : 0;
+        if (view->currentRow >= view->firstRow + half) {
+            ScrollViewTo(hWnd, view, view->currentRow - half, view->firstColumn);
+        }
+    } else if (character == 0x1B) { // Escape
+        view->gotoLength = 0;
+        view->gotoText[0] = '\0';
+    } else {
+        return;
+    }
+    UpdateScrollBars(hWnd, view);
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+/**
+ * @brief Gets the column under a client x coordinate.
+ *
+ * @param view The view.
+ * @param x The x coordinate.
+ * @return The column, or SIZE_MAX over the row numbers or past the last column.
+ */
+static size_t ColumnFromX(const TableView* view, int x) {
+    int column = x / view->charWidth - NumberWidth(view);
+    if (column < 0) {
+        return SIZE_MAX;
+    }
+    for (size_t c = view->firstColumn; c < view->columnCount; c++) {
+        int width = (int)view->widths[c] + 1;
+        if (column < width) {
+            return c;
+        }
+        column -= width;
+    }
+    return SIZE_MAX;
+}
+
+/**
+ * @brief Sorts by the clicked header or highlights the clicked row.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param lParam Mouse position.
+ */
+static void HandleMouseDown(HWND hWnd, TableView* view, LPARAM lParam) {
+    SetFocus(hWnd);
+    int screenRow = GET_Y_LPARAM(lParam) / view->lineHeight;
+    if (screenRow > 0) {
+        SetCurrentRow(hWnd, view, view->firstRow + (uint64_t)(screenRow - 1));
+        return;
+    }
+    size_t column = ColumnFromX(view, GET_X_LPARAM(lParam));
+    if (column == SIZE_MAX) {
+        ClearSort(hWnd, view); // The corner above the row numbers restores the file order
+    } else {
+        SortByColumn(hWnd, view, column);
+    }
+}
+
+/**
+ * @brief Handles a scroll bar notification.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ * @param bar SB_VERT or SB_HORZ.
+ * @param request The scroll request (LOWORD of wParam).
+ */
+static void HandleScroll(HWND hWnd, TableView* view, int bar, int request) {
+    SCROLLINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cbSize = sizeof(si);
+    si.fMask = SIF_ALL;
+    GetScrollInfo(hWnd, bar, &si);
+
+    uint64_t position = bar == SB_VERT ? view->firstRow : view->firstColumn;
+    uint64_t page = bar == SB_HORZ ? 1 : view->visibleLines > 1 ? (uint64_t)(view->visibleLines - 1) : 1;
+    int shift = bar == SB_VERT ? view->scrollShift : 0;
+    switch (request) {
+        case SB_LINEUP:        position = position > 0 ? position - 1 : 0; break;
+        case SB_LINEDOWN:      position += 1; break;
+        case SB_PAGEUP:        position = position > page ? position - page : 0; break;
+        case SB_PAGEDOWN:      position += page; break;
+        case SB_THUMBTRACK:
+        case SB_THUMBPOSITION: position = (uint64_t)si.nTrackPos << shift; break;
+        case SB_TOP:           position = 0; break;
+        case SB_BOTTOM:        position = UINT64_MAX; break;
+        default:               return;
+    }
+    if (bar == SB_VERT) {
+        ScrollViewTo(hWnd, view, position, view->firstColumn);
+    } else {
+        ScrollViewTo(hWnd, view, view->firstRow, position > SIZE_MAX ? SIZE_MAX : (size_t)position);
+    }
+}
+
+/**
+ * @brief Draws the cells of one row from the first visible column.
+ *
+ * @param hdc Device context.
+ * @param view The view.
+ * @param offset Start of the row.
+ * @param y Top of the row.
+ * @param right Right edge of the client area.
+ * @param header TRUE to mark the sorted column.
+ * @param[out] next Receives the start of the following row; may be NULL.
+ */
+static void PaintCells(HDC hdc, TableView* view, uint64_t offset, int y, int right, BOOL header, uint64_t* next) {
+    CsvField fields[TABLE_VIEW_MAX_COLUMNS];
+    size_t count = CsvIndexParseRow(view->index, offset, fields, TABLE_VIEW_MAX_COLUMNS, next);
+    if (count > TABLE_VIEW_MAX_COLUMNS) {
+        count = TABLE_VIEW_MAX_COLUMNS;
+    }
+    // Rows longer than the sampled ones add columns as they are seen
+    while (view->columnCount < count) {
+        view->widths[view->columnCount++] = TABLE_VIEW_DEFAULT_WIDTH;
+    }
+
+    int x = NumberWidth(view) * view->charWidth;
+    char text[CSV_INDEX_MAX_WIDTH + 3];
+    for (size_t c = view->firstColumn; c < count && x < right; c++) {
+        int width = (int)view->widths[c];
+        size_t length = CsvIndexFieldText(view->index, &fields[c], text, (size_t)width + 1);
+        for (size_t i = 0; i < length; i++) {
+            if ((unsigned char)text[i] < 0x20) {
+                text[i] = ' '; // Tabs and line breaks of quoted values
+            }
+        }
+        if (header && view->order && c == view->sortColumn) {
+            text[length++] = ' ';
+            text[length++] = view->sortDescending ? 'v' : '^';
+        }
+        TextOut(hdc, x, y, text, (int)length);
+        x += (width + 1) * view->charWidth;
+    }
+}
+
+/**
+ * @brief Paints the header and the visible data rows.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void PaintView(HWND hWnd, TableView* view) {
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hWnd, &ps);
+    if (!hdc) {
+        return;
+    }
+
+    RECT client;
+    GetClientRect(hWnd, &client);
+    HFONT oldFont = (HFONT)SelectObject(hdc, view->font);
+    HBRUSH background = GetSysColorBrush(COLOR_WINDOW);
+    HBRUSH headerBrush = CreateSolidBrush(TABLE_VIEW_HEADER_COLOR);
+    HBRUSH currentBrush = CreateSolidBrush(TABLE_VIEW_CURRENT_COLOR);
+    SetBkMode(hdc, TRANSPARENT);
+    FillRect(hdc, &client, background);
+
+    if (EnsureIndex(view)) {
+        char number[TABLE_VIEW_GOTO_DIGITS + 2];
+        int numberWidth = NumberWidth(view);
+        RECT headerRect = { client.left, 0, client.right, view->lineHeight };
+        FillRect(hdc, &headerRect, headerBrush);
+        if (CsvIndexRowCount(view->index) > 0) {
+            SetTextColor(hdc, GetSysColor(COLOR_WINDOWTEXT));
+            PaintCells(hdc, view, 0, 0, client.right, TRUE, NULL);
+        }
+        if (view->gotoLength > 0) {
+            SetTextColor(hdc, TABLE_VIEW_NUMBER_COLOR);
+            TextOut(hdc, 0, 0, view->gotoText, (int)view->gotoLength);
+        }
+
+        uint64_t rowCount = DataRowCount(view);
+        uint64_t offset = 0;
+        for (int row = 0; row <= view->visibleLines && view->firstRow + (uint64_t)row < rowCount; row++) {
+            uint64_t dataRow = view->firstRow + (uint64_t)row;
+            int y = (row + 1) * view->lineHeight;
+            if (dataRow == view->currentRow) {
+                RECT rowRect = { client.left, y, client.right, y + view->lineHeight };
+                FillRect(hdc, &rowRect, currentBrush);
+            }
+
+            // Rows in file order follow each other; sorted rows are looked up one by one
+            if (row == 0 || view->order) {
+                offset = DataRowStart(view, dataRow);
+            }
+            int length = sprintf_s(number, sizeof(number), "%*llu", numberWidth - 1,
+                                   (unsigned long long)(dataRow + 1));
+            SetTextColor(hdc, TABLE_VIEW_NUMBER_COLOR);
+            TextOut(hdc, 0, y, number, length);
+            SetTextColor(hdc, GetSysColor(COLOR_WINDOWTEXT));
+            PaintCells(hdc, view, offset, y, client.right, FALSE, &offset);
+        }
+    }
+
+    DeleteObject(headerBrush);
+    DeleteObject(currentBrush);
+    SelectObject(hdc, oldFont);
+    EndPaint(hWnd, &ps);
+}
+
+/**
+ * @brief Creates the view state and font.
+ *
+ * @param hWnd Handle to the view.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+static BOOL CreateView(HWND hWnd) {
+    TableView* view = (TableView*)calloc(1, sizeof(TableView));
+    if (!view) {
+        return FALSE;
+    }
+
+    view->font = CreateFont(-TABLE_VIEW_FONT_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                            OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, FIXED_PITCH | FF_MODERN,
+                            TABLE_VIEW_FONT_NAME);
+    if (!view->font) {
+        view->font = (HFONT)GetStockObject(ANSI_FIXED_FONT);
+    }
+
+    // Measure one cell of the fixed-pitch font
+    HDC hdc = GetDC(hWnd);
+    HFONT oldFont = (HFONT)SelectObject(hdc, view->font);
+    TEXTMETRIC tm;
+    GetTextMetrics(hdc, &tm);
+    SelectObject(hdc, oldFont);
+    ReleaseDC(hWnd, hdc);
+    view->charWidth = tm.tmAveCharWidth > 0 ? (int)tm.tmAveCharWidth : 8;
+    view->lineHeight = tm.tmHeight + tm.tmExternalLeading > 0 ? (int)(tm.tmHeight + tm.tmExternalLeading) : 16;
+
+    SetWindowLongPtr(hWnd, GWLP_USERDATA, (LONG_PTR)view);
+    return TRUE;
+}
+
+/**
+ * @brief Forgets the document shown and its index.
+ *
+ * @param hWnd Handle to the view.
+ * @param view The view.
+ */
+static void DetachDocument(HWND hWnd, TableView* view) {
+    if (view->document) {
+        DocumentRemoveListener(view->document, TableDocumentChanged, (void*)hWnd);
+    }
+    CsvIndexDestroy(view->index);
+    free(view->order);
+    view->document = NULL;
+    view->index = NULL;
+    view->order = NULL;
+    view->columnCount = 0;
+    view->firstRow = 0;
+    view->firstColumn = 0;
+    view->currentRow = 0;
+    view->gotoLength = 0;
+    view->gotoText[0] = '\0';
+}
+
+/**
+ * @brief Releases the view state.
+ *
+ * @param hWnd Handle to the view.
+ */
+static void DestroyView(HWND hWnd) {
+    TableView* view = GetView(hWnd);
+    if (!view) {
+        return;
+    }
+    DetachDocument(hWnd, view);
+    SetWindowLongPtr(hWnd, GWLP_USERDATA, 0);
+    if (view->font) {
+        DeleteObject(view->font);
+    }
+    free(view);
+}
+
+/**
+ * @brief Window procedure of the table view.
+ *
+ * @param hWnd Handle to the view.
+ * @param message The message.
+ * @param wParam Additional message information.
+ * @param lParam Additional message information.
+ * @return The result of the message processing.
+ */
+static LRESULT CALLBACK TableViewProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    TableView* view = GetView(hWnd);
+    if (!view && message != WM_CREATE) {
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+
+    switch (message) {
+        case WM_CREATE:
+            return CreateView(hWnd) ? 0 : -1;
+
+        case WM_DESTROY:
+            DestroyView(hWnd);
+            return 0;
+
+        case WM_SIZE:
+            // The header takes the first line
+            view->visibleLines = HIWORD(lParam) / view->lineHeight - 1;
+            if (view->visibleLines < 0) {
+                view->visibleLines = 0;
+            }
+            UpdateScrollBars(hWnd, view);
+            InvalidateRect(hWnd, NULL, FALSE);
+            return 0;
+
+        case WM_ERASEBKGND:
+            // The whole client area is filled by WM_PAINT
+            return 1;
+
+        case WM_PAINT:
+            PaintView(hWnd, view);
+            return 0;
+
+        case WM_GETDLGCODE:
+            return DLGC_WANTALLKEYS | DLGC_WANTCHARS | DLGC_WANTARROWS;
+
+        case WM_KEYDOWN:
+            if (EnsureIndex(view) && HandleKeyDown(hWnd, view, wParam)) {
+                return 0;
+            }
+            break;
+
+        case WM_CHAR:
+            if (EnsureIndex(view)) {
+                HandleChar(hWnd, view, wParam);
+            }
+            return 0;
+
+        case WM_LBUTTONDOWN:
+            if (EnsureIndex(view)) {
+                HandleMouseDown(hWnd, view, lParam);
+            }
+            return 0;
+
+        case WM_VSCROLL:
+        case WM_HSCROLL:
+            if (EnsureIndex(view)) {
+                HandleScroll(hWnd, view, message == WM_VSCROLL ? SB_VERT : SB_HORZ, LOWORD(wParam));
+            }
+            return 0;
+
+        case WM_MOUSEWHEEL: {
+            if (!EnsureIndex(view)) {
+                return 0;
+            }
+            int notches = GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+            int64_t delta = (int64_t)notches * TABLE_VIEW_WHEEL_LINES;
+            uint64_t firstRow = view->firstRow;
+            if (delta > 0) {
+                firstRow = firstRow > (uint64_t)delta ? firstRow - (uint64_t)delta : 0;
+            } else {
+                firstRow += (uint64_t)-delta;
+            }
+            ScrollViewTo(hWnd, view, firstRow, view->firstColumn);
+            return 0;
+        }
+    }
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+/**
+ * @brief Creates the table view within the parent window.
+ *
+ * The view is created hidden and without a document.
+ *
+ * @param hWnd Handle to the parent window.
+ * @param hInstance Handle to the application instance.
+ * @return Handle to the view, or NULL if creation failed.
+ */
+HWND CreateTableView(HWND hWnd, HINSTANCE hInstance) {
+    static BOOL registered = FALSE;
+    if (!registered) {
+        WNDCLASSEX wcex;
+        ZeroMemory(&wcex, sizeof(wcex));
+        wcex.cbSize = sizeof(WNDCLASSEX);
+        wcex.lpfnWndProc = TableViewProc;
+        wcex.hInstance = hInstance;
+        wcex.hCursor = LoadCursor(NULL, IDC_ARROW);
+        wcex.hbrBackground = NULL; // The view paints its own background
+        wcex.lpszClassName = TABLE_VIEW_CLASS_NAME;
+        if (!RegisterClassEx(&wcex)) {
+            return NULL;
+        }
+        registered = TRUE;
+    }
+
+    return CreateWindowEx(WS_EX_CLIENTEDGE, TABLE_VIEW_CLASS_NAME, NULL, WS_CHILD | WS_VSCROLL | WS_HSCROLL | WS_TABSTOP,
+                          0, 0, 0, 0, hWnd, NULL, hInstance, NULL);
+}
+
+/**
+ * @brief Shows a document in the table view.
+ *
+ * The rows are indexed now and again after every change of the document.
+ * The document stays owned by the caller and must be detached with a NULL
+ * document before it is destroyed.
+ *
+ * @param hTable Handle to the table view.
+ * @param document The document, or NULL to detach the current one.
+ * @param delimiter Field delimiter, or 0 to guess it from the first lines.
+ * @return TRUE if successful, FALSE otherwise.
+ */
+BOOL SetTableViewDocument(HWND hTable, Document* document, char delimiter) {
+    TableView* view = GetView(hTable);
+    if (!view) {
+        return FALSE;
+    }
+    DetachDocument(hTable, view);
+    if (document) {
+        if (!DocumentAddListener(document, TableDocumentChanged, (void*)hTable)) {
+            return FALSE;
+        }
+        view->document = document;
+        view->delimiter = delimiter;
+        if (!EnsureIndex(view)) {
+            DetachDocument(hTable, view);
+            return FALSE;
+        }
+    }
+    UpdateScrollBars(hTable, view);
+    InvalidateRect(hTable, NULL, FALSE);
+    return TRUE;
+}
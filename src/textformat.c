@@ -0,0 +1,561 @@
+/**
+ * @file textformat.c
+ * @brief Whitespace formatting implementation for the Professional Text Editor
+ *
+ * Contains the streaming format pass. A span is searched for the next
+ * change only: a line feed after blanks, found 64 bytes at a time, or a
+ * tab; the bytes between two changes go to the sink in one call, straight
+ * from the span. Only whitespace at the end of a span is copied, into a
+ * small hold area, until the next span tells whether a line ends after it.
+ */
+
+#include "../include/textformat.h"
+#include "../include/memory.h"
+#include <string.h>
+
+// Longest run of spaces one edit inserts
+#define TEXT_FORMAT_SPACE_RUN 256
+
+// Bytes tested at once for something to change
+#define TEXT_FORMAT_BLOCK 64
+
+// Text inserted by the edits; static, so recorded edits never point into a span
+static const char g_spaces[TEXT_FORMAT_SPACE_RUN + 1] =
+    "                                                                "
+    "                                                                "
+    "                                                                "
+    "                                                                ";
+
+/**
+ * @brief Checks whether a byte is a space or a tab.
+ *
+ * @param c The byte.
+ * @return true for ' ' and '\t', false otherwise.
+ */
+static bool IsBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief Finds a byte in a span.
+ *
+ * @param data The span.
+ * @param from Position to search from.
+ * @param length Length of the span.
+ * @param c The byte.
+ * @return Position of the byte, or length if it is not there.
+ */
+static size_t FindByte(const char* data, size_t from, size_t length, char c) {
+    if (from >= length) {
+        return length;
+    }
+    const char* found = (const char*)memchr(data + from, c, length - from);
+    return found ? (size_t)(found - data) : length;
+}
+
+/**
+ * @brief Finds the last occurrence of a byte in part of a span.
+ *
+ * @param data The span.
+ * @param from Start of the part.
+ * @param to End of the part.
+ * @param c The byte.
+ * @return Position of the byte, or to if it is not there.
+ */
+static size_t FindLastByte(const char* data, size_t from, size_t to, char c) {
+    for (size_t position = to; position > from; position--) {
+        if (data[position - 1] == c) {
+            return position - 1;
+        }
+    }
+    return to;
+}
+
+/**
+ * @brief Checks whether a byte of a span is a line feed after blanks, maybe with a carriage return between.
+ *
+ * @param data The span.
+ * @param position Position of the byte.
+ * @return true if the line ends with blanks to trim, false otherwise.
+ */
+static bool IsBlankLineEnd(const char* data, size_t position) {
+    return data[position] == '\n' && position > 0 &&
+           (IsBlank(data[position - 1]) || (data[position - 1] == '\r' && position > 1 && IsBlank(data[position - 2])));
+}
+
+/**
+ * @brief Checks whether a block of a span holds a line feed after blanks, without a branch per byte.
+ *
+ * The test of IsBlankLineEnd is written with bitwise operators over a
+ * fixed number of bytes, so compilers turn the loop into vector
+ * instructions.
+ *
+ * @param block TEXT_FORMAT_BLOCK bytes, preceded by at least two readable bytes.
+ * @return true if a line of the block ends with blanks, false otherwise.
+ */
+static bool BlockHasBlankLineEnd(const unsigned char* block) {
+    unsigned char found = 0;
+    for (int i = 0; i < TEXT_FORMAT_BLOCK; i++) {
+        unsigned char before = block[i - 1];
+        unsigned char twoBefore = block[i - 2];
+        unsigned char blankBefore = (before == ' ') | (before == '\t');
+        unsigned char blankTwoBefore = (twoBefore == ' ') | (twoBefore == '\t');
+        found |= (block[i] == '\n') & (blankBefore | ((before == '\r') & blankTwoBefore));
+    }
+    return found != 0;
+}
+
+/**
+ * @brief Finds the next change in a span: a tab to expand, or a line feed after blanks.
+ *
+ * Most lines need no change, so the span is skipped a block at a time
+ * rather than line by line; within a block that has a change, and up to
+ * the next tab, memchr finds the line feeds.
+ *
+ * @param data The span.
+ * @param from Position to search from.
+ * @param length Length of the span.
+ * @param trim Line feeds after blanks are changes.
+ * @param[in,out] nextTab Position of the next tab to expand, or length; searched again once passed.
+ * @return Position of the change, or length if there is none.
+ */
+static size_t FindChange(const char* data, size_t from, size_t length, bool trim, size_t* nextTab) {
+    if (*nextTab < from) {
+        *nextTab = FindByte(data, from, length, '\t');
+    }
+    size_t end = *nextTab;
+    if (!trim) {
+        return end;
+    }
+    size_t position = from;
+    for (;;) {
+        while (position >= 2 && end - position >= TEXT_FORMAT_BLOCK &&
+               !BlockHasBlankLineEnd((const unsigned char*)data + position)) {
+            position += TEXT_FORMAT_BLOCK;
+        }
+        size_t lineFeed = FindByte(data, position, end, '\n');
+        if (lineFeed == end || IsBlankLineEnd(data, lineFeed)) {
+            return lineFeed;
+        }
+        position = lineFeed + 1;
+    }
+}
+
+/**
+ * @brief Passes formatted bytes to the sink.
+ *
+ * @param formatter The formatter.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ */
+static void Emit(TextFormatter* formatter, const char* data, size_t length) {
+    if (length == 0 || formatter->failed) {
+        return;
+    }
+    if (formatter->sink && !formatter->sink(data, length, formatter->context)) {
+        formatter->failed = true;
+        return;
+    }
+    formatter->outputLength += length;
+    formatter->lastByte = data[length - 1];
+}
+
+/**
+ * @brief Records one change as a document edit.
+ *
+ * @param formatter The formatter.
+ * @param offset Input offset of the replaced bytes.
+ * @param removeLength Number of bytes replaced.
+ * @param text Static text inserted instead, or NULL.
+ * @param textLength Length of the text.
+ */
+static void RecordEdit(TextFormatter* formatter, uint64_t offset, uint64_t removeLength, const char* text,
+                       size_t textLength) {
+    if (!formatter->recording || formatter->editsLost) {
+        return;
+    }
+    if (formatter->editCount == formatter->editCapacity) {
+        size_t newCapacity = formatter->editCapacity ? formatter->editCapacity * 2 : 64;
+        if (formatter->options.maxEdits > 0 && newCapacity > formatter->options.maxEdits) {
+            newCapacity = formatter->options.maxEdits;
+        }
+        DocumentEdit* newEdits = newCapacity > formatter->editCount
+            ? (DocumentEdit*)MemoryRealloc(MEMORY_TAG_EDITING, formatter->edits, newCapacity * sizeof(DocumentEdit))
+            : NULL;
+        if (!newEdits) {
+            formatter->editsLost = true;
+            return;
+        }
+        formatter->edits = newEdits;
+        formatter->editCapacity = newCapacity;
+    }
+    DocumentEdit* edit = &formatter->edits[formatter->editCount++];
+    edit->offset = offset;
+    edit->removeLength = removeLength;
+    edit->text = text;
+    edit->textLength = textLength;
+    edit->slice = NULL;
+}
+
+/**
+ * @brief Writes a run of spaces and tabs with every tab expanded.
+ *
+ * @param formatter The formatter; its column is at the start of the run.
+ * @param data The run; only spaces and tabs.
+ * @param length Length of the run.
+ * @param offset Input offset of the run.
+ */
+static void ExpandBlanks(TextFormatter* formatter, const char* data, size_t length, uint64_t offset) {
+    unsigned tabWidth = formatter->options.tabWidth;
+    size_t start = 0;
+    size_t spaces = 0;
+    for (size_t i = 0; i < length; i++) {
+        size_t width = data[i] == '\t' ? tabWidth - (size_t)(formatter->column % tabWidth) : 1;
+        if (spaces + width > TEXT_FORMAT_SPACE_RUN) {
+            Emit(formatter, g_spaces, spaces);
+            RecordEdit(formatter, offset + start, i - start, g_spaces, spaces);
+            start = i;
+            spaces = 0;
+        }
+        spaces += width;
+        formatter->column += width;
+    }
+    Emit(formatter, g_spaces, spaces);
+    RecordEdit(formatter, offset + start, length - start, g_spaces, spaces);
+}
+
+/**
+ * @brief Appends whitespace to the hold area.
+ *
+ * @param formatter The formatter.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if successful, false on allocation failure.
+ */
+static bool Hold(TextFormatter* formatter, const char* data, size_t length) {
+    if (formatter->heldLength + length > formatter->heldCapacity) {
+        size_t newCapacity = formatter->heldCapacity ? formatter->heldCapacity : 64;
+        while (newCapacity < formatter->heldLength + length) {
+            newCapacity *= 2;
+        }
+        char* newHeld = (char*)MemoryRealloc(MEMORY_TAG_EDITING, formatter->held, newCapacity);
+        if (!newHeld) {
+            return false;
+        }
+        formatter->held = newHeld;
+        formatter->heldCapacity = newCapacity;
+    }
+    memcpy(formatter->held + formatter->heldLength, data, length);
+    formatter->heldLength += length;
+    return true;
+}
+
+/**
+ * @brief Writes the held whitespace, which turned out not to end a line.
+ *
+ * @param formatter The formatter.
+ */
+static void ReleaseHeld(TextFormatter* formatter) {
+    const char* held = formatter->held;
+    size_t length = formatter->heldLength;
+    uint64_t offset = formatter->inputLength - length;
+    formatter->heldLength = 0;
+    if (!(formatter->options.stages & TEXT_FORMAT_EXPAND_TABS)) {
+        Emit(formatter, held, length);
+        return;
+    }
+
+    // A carriage return can only end the held run; the blanks before it are expanded
+    size_t blanks = held[length - 1] == '\r' ? length - 1 : length;
+    size_t firstTab = FindByte(held, 0, blanks, '\t');
+    Emit(formatter, held, firstTab);
+    formatter->column += firstTab;
+    if (firstTab < blanks) {
+        ExpandBlanks(formatter, held + firstTab, blanks - firstTab, offset + firstTab);
+    }
+    if (blanks < length) {
+        Emit(formatter, "\r", 1);
+        formatter->column++;
+    }
+}
+
+/**
+ * @brief Drops the held whitespace, which ended a line, keeping a carriage return at its end.
+ *
+ * @param formatter The formatter.
+ * @param extra Bytes of the current span that belong to the same whitespace run.
+ */
+static void DropHeld(TextFormatter* formatter, size_t extra) {
+    size_t length = formatter->heldLength;
+    uint64_t offset = formatter->inputLength - length;
+    bool carriageReturn = formatter->held[length - 1] == '\r';
+    formatter->heldLength = 0;
+    if (carriageReturn) {
+        if (length > 1) {
+            RecordEdit(formatter, offset, length - 1, NULL, 0);
+        }
+        Emit(formatter, "\r", 1);
+    } else {
+        RecordEdit(formatter, offset, length + extra, NULL, 0);
+    }
+}
+
+/**
+ * @brief Starts a format pass.
+ *
+ * @param formatter The formatter.
+ * @param options The stages; copied.
+ * @param sink Receiver of the formatted text, or NULL.
+ * @param context Pointer passed to the sink.
+ * @param recordEdits true to record the changes as document edits.
+ */
+void TextFormatterInit(TextFormatter* formatter, const TextFormatOptions* options, TextFormatSink sink, void* context,
+                       bool recordEdits) {
+    memset(formatter, 0, sizeof(*formatter));
+    formatter->options = *options;
+    if (formatter->options.tabWidth < 1) {
+        formatter->options.tabWidth = 1;
+    } else if (formatter->options.tabWidth > TEXT_FORMAT_MAX_TAB_WIDTH) {
+        formatter->options.tabWidth = TEXT_FORMAT_MAX_TAB_WIDTH;
+    }
+    formatter->sink = sink;
+    formatter->context = context;
+    formatter->recording = recordEdits;
+}
+
+/**
+ * @brief Formats the next span of the text.
+ *
+ * Whitespace at the end of the span may be held back until the next span
+ * or the end of the text shows whether it ends a line.
+ *
+ * @param formatter The formatter.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @return true if successful, false once the sink has failed.
+ */
+bool TextFormatterWrite(TextFormatter* formatter, const char* data, size_t length) {
+    if (formatter->failed || length == 0) {
+        return !formatter->failed;
+    }
+    bool trim = (formatter->options.stages & TEXT_FORMAT_TRIM_TRAILING) != 0;
+    bool expand = (formatter->options.stages & TEXT_FORMAT_EXPAND_TABS) != 0;
+    uint64_t base = formatter->inputLength;
+
+    // Adding a final line break only needs to know how the last line break looks
+    if (!trim && !expand) {
+        size_t lineFeed = FindLastByte(data, 0, length, '\n');
+        if (lineFeed < length) {
+            formatter->crlf = lineFeed > 0 ? data[lineFeed - 1] == '\r' : formatter->lastInputByte == '\r';
+        }
+        Emit(formatter, data, length);
+        formatter->inputLength += length;
+        formatter->lastInputByte = data[length - 1];
+        return !formatter->failed;
+    }
+
+    size_t run = 0;         // First byte not yet written or dropped
+    size_t columnAt = 0;    // The formatter's column is the column of this byte, unless a line feed follows it
+    size_t position = 0;    // Where the search for the next change starts
+
+    // Whitespace held from the previous span is resolved by the first bytes of this one
+    if (formatter->heldLength > 0) {
+        size_t blanks = 0;
+        while (blanks < length && IsBlank(data[blanks])) {
+            blanks++;
+        }
+        if (formatter->held[formatter->heldLength - 1] == '\r') {
+            if (data[0] == '\n') {
+                DropHeld(formatter, 0);
+            } else {
+                ReleaseHeld(formatter);
+            }
+        } else if (blanks == length || (blanks + 1 == length && data[blanks] == '\r')) {
+            formatter->inputLength += length;
+            formatter->lastInputByte = data[length - 1];
+            if (!Hold(formatter, data, length)) {
+                formatter->failed = true;
+            }
+            return !formatter->failed;
+        } else if (data[blanks] == '\n' || (data[blanks] == '\r' && data[blanks + 1] == '\n')) {
+            // The line break is handled: the search goes on after it
+            DropHeld(formatter, blanks);
+            run = blanks;
+            columnAt = blanks;
+            position = blanks + (data[blanks] == '\r') + 1;
+        } else {
+            ReleaseHeld(formatter);
+        }
+    }
+
+    size_t nextTab = expand ? FindByte(data, position, length, '\t') : length;
+    for (;;) {
+        position = FindChange(data, position, length, trim, &nextTab);
+        if (position == length) {
+            break;
+        }
+
+        if (data[position] == '\t') {
+            // The run of blanks around the tab is expanded unless it ends the line
+            size_t tab = position;
+            size_t end = tab;
+            size_t lastTab = tab;
+            while (end < length && IsBlank(data[end])) {
+                lastTab = data[end] == '\t' ? end : lastTab;
+                end++;
+            }
+            if (trim && (end == length || data[end] == '\n' ||
+                         (data[end] == '\r' && (end + 1 == length || data[end + 1] == '\n')))) {
+                position = end;
+                continue;
+            }
+            Emit(formatter, data + run, tab - run);
+            size_t lineFeed = FindLastByte(data, columnAt, tab, '\n');
+            formatter->column = lineFeed < tab ? tab - lineFeed - 1 : formatter->column + (tab - columnAt);
+            ExpandBlanks(formatter, data + tab, lastTab + 1 - tab, base + tab);
+            run = lastTab + 1;
+            columnAt = run;
+            position = run;
+            continue;
+        }
+
+        // A line feed after blanks: they are dropped, and so are the blanks before a carriage return
+        size_t lineFeed = position;
+        size_t blanksEnd = data[lineFeed - 1] == '\r' ? lineFeed - 1 : lineFeed;
+        size_t start = blanksEnd;
+        while (start > run && IsBlank(data[start - 1])) {
+            start--;
+        }
+        if (start < blanksEnd) {
+            Emit(formatter, data + run, start - run);
+            RecordEdit(formatter, base + start, blanksEnd - start, NULL, 0);
+            run = blanksEnd;
+        }
+        position = lineFeed + 1;
+    }
+
+    // Blanks ending the span wait for the next span
+    size_t end = length;
+    if (trim) {
+        size_t start = end > run && data[end - 1] == '\r' ? end - 1 : end;
+        while (start > run && IsBlank(data[start - 1])) {
+            start--;
+        }
+        if (start < end) {
+            if (!Hold(formatter, data + start, end - start)) {
+                formatter->failed = true;
+                return false;
+            }
+            end = start;
+        }
+    }
+    Emit(formatter, data + run, end - run);
+
+    // Only the last line of the span matters for the column and the final line break
+    bool finalNewline = (formatter->options.stages & TEXT_FORMAT_FINAL_NEWLINE) != 0;
+    size_t lastLineFeed = expand || finalNewline ? FindLastByte(data, 0, length, '\n') : length;
+    if (expand) {
+        formatter->column = lastLineFeed < length && lastLineFeed >= columnAt ? end - lastLineFeed - 1
+                                                                             : formatter->column + (end - columnAt);
+    }
+    if (lastLineFeed < length) {
+        formatter->crlf = lastLineFeed > 0 ? data[lastLineFeed - 1] == '\r' : formatter->lastInputByte == '\r';
+    }
+    formatter->inputLength += length;
+    formatter->lastInputByte = data[length - 1];
+    return !formatter->failed;
+}
+
+/**
+ * @brief Ends the text: drops its trailing whitespace and adds the final line break.
+ *
+ * The final line break is a CR LF pair when the last line break of the
+ * text was one.
+ *
+ * @param formatter The formatter.
+ * @return true if successful, false if the sink failed.
+ */
+bool TextFormatterFinish(TextFormatter* formatter) {
+    if (formatter->heldLength > 0) {
+        DropHeld(formatter, 0);
+    }
+    if ((formatter->options.stages & TEXT_FORMAT_FINAL_NEWLINE) && formatter->outputLength > 0 &&
+        formatter->lastByte != '\n') {
+        const char* lineBreak = formatter->lastByte == '\r' ? "\n" : formatter->crlf ? "\r\n" : "\n";
+        size_t breakLength = strlen(lineBreak);
+        Emit(formatter, lineBreak, breakLength);
+        RecordEdit(formatter, formatter->inputLength, 0, lineBreak, breakLength);
+    }
+    return !formatter->failed;
+}
+
+/**
+ * @brief Gets the changes made by a finished pass.
+ *
+ * The edits are sorted, in the coordinates of the input, and insert only
+ * static text, so they stay valid until the formatter is freed.
+ *
+ * @param formatter The formatter.
+ * @param[out] edits Receives the edits.
+ * @param[out] editCount Receives the number of edits.
+ * @return true if every change was recorded, false otherwise.
+ */
+bool TextFormatterGetEdits(const TextFormatter* formatter, const DocumentEdit** edits, size_t* editCount) {
+    *edits = formatter->edits;
+    *editCount = formatter->editCount;
+    return formatter->recording && !formatter->editsLost;
+}
+
+/**
+ * @brief Releases the memory held by a formatter.
+ *
+ * @param formatter The formatter.
+ */
+void TextFormatterFree(TextFormatter* formatter) {
+    MemoryFree(formatter->edits);
+    MemoryFree(formatter->held);
+    formatter->edits = NULL;
+    formatter->held = NULL;
+    formatter->editCount = 0;
+    formatter->editCapacity = 0;
+    formatter->heldLength = 0;
+    formatter->heldCapacity = 0;
+}
+
+/**
+ * @brief Formats a document in place as one undoable edit.
+ *
+ * Only the changed bytes are edited, so the rest of the document keeps
+ * sharing the pieces of its file.
+ *
+ * @param document The document.
+ * @param options The stages.
+ * @param[out] changeCount Receives the number of edits applied; may be NULL.
+ * @return true if successful, false on allocation failure.
+ */
+bool TextFormatDocument(Document* document, const TextFormatOptions* options, size_t* changeCount) {
+    if (changeCount) {
+        *changeCount = 0;
+    }
+    if (!document || !options) {
+        return false;
+    }
+    TextFormatter formatter;
+    TextFormatterInit(&formatter, options, NULL, NULL, true);
+    DocumentIterator iterator;
+    DocumentIterInit(document, 0, &iterator);
+    const char* data;
+    size_t length;
+    while (DocumentIterNext(&iterator, &data, &length)) {
+        TextFormatterWrite(&formatter, data, length);
+    }
+    const DocumentEdit* edits;
+    size_t editCount;
+    bool succeeded = TextFormatterFinish(&formatter) && TextFormatterGetEdits(&formatter, &edits, &editCount) &&
+                     (editCount == 0 || DocumentApplyEdits(document, edits, editCount));
+    if (succeeded && changeCount) {
+        *changeCount = editCount;
+    }
+    TextFormatterFree(&formatter);
+    return succeeded;
+}
@@ -0,0 +1,438 @@
+/**
+ * @file thread.c
+ * @brief Worker threads and locks implementation for the Professional Text Editor
+ *
+ * Contains the Win32 and POSIX implementations of threads, locks and
+ * condition variables.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // For sysconf
+#endif
+
+#include "../include/thread.h"
+#include "../include/memory.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+struct Thread {
+    HANDLE handle;
+    ThreadProc proc;
+    void* context;
+};
+
+struct ThreadLock {
+    CRITICAL_SECTION section;
+};
+
+struct ThreadCondition {
+    CONDITION_VARIABLE variable;
+};
+
+/**
+ * @brief Thread entry point calling the thread's function.
+ *
+ * @param parameter The thread.
+ * @return Always 0.
+ */
+static DWORD WINAPI ThreadEntry(LPVOID parameter) {
+    Thread* thread = (Thread*)parameter;
+    thread->proc(thread->context);
+    MemoryReleaseThreadCache();
+    return 0;
+}
+
+/**
+ * @brief Starts a thread.
+ *
+ * @param proc The function to run.
+ * @param context Pointer passed to the function.
+ * @return The thread, or NULL on failure. Release it with ThreadJoin.
+ */
+Thread* ThreadStart(ThreadProc proc, void* context) {
+    Thread* thread = (Thread*)MemoryAlloc(MEMORY_TAG_THREADS, sizeof(Thread));
+    if (!thread) {
+        return NULL;
+    }
+    thread->proc = proc;
+    thread->context = context;
+    thread->handle = CreateThread(NULL, 0, ThreadEntry, thread, 0, NULL);
+    if (!thread->handle) {
+        MemoryFree(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+/**
+ * @brief Waits for a thread to finish and releases it.
+ *
+ * @param thread The thread. NULL is ignored.
+ */
+void ThreadJoin(Thread* thread) {
+    if (!thread) {
+        return;
+    }
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    MemoryFree(thread);
+}
+
+/**
+ * @brief Gets the number of processors available to the process.
+ *
+ * @return The processor count, at least 1.
+ */
+unsigned ThreadProcessorCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned)info.dwNumberOfProcessors : 1;
+}
+
+/**
+ * @brief Creates a lock.
+ *
+ * @return The lock, or NULL on allocation failure.
+ */
+ThreadLock* ThreadLockCreate(void) {
+    ThreadLock* lock = (ThreadLock*)MemoryAlloc(MEMORY_TAG_THREADS, sizeof(ThreadLock));
+    if (lock) {
+        InitializeCriticalSection(&lock->section);
+    }
+    return lock;
+}
+
+/**
+ * @brief Destroys a lock.
+ *
+ * @param lock The lock. NULL is ignored.
+ */
+void ThreadLockDestroy(ThreadLock* lock) {
+    if (lock) {
+        DeleteCriticalSection(&lock->section);
+        MemoryFree(lock);
+    }
+}
+
+/**
+ * @brief Acquires a lock, waiting for other threads to release it.
+ *
+ * @param lock The lock.
+ */
+void ThreadLockEnter(ThreadLock* lock) {
+    EnterCriticalSection(&lock->section);
+}
+
+/**
+ * @brief Releases a lock.
+ *
+ * @param lock The lock.
+ */
+void ThreadLockLeave(ThreadLock* lock) {
+    LeaveCriticalSection(&lock->section);
+}
+
+/**
+ * @brief Creates a condition variable.
+ *
+ * @return The condition variable, or NULL on allocation failure.
+ */
+ThreadCondition* ThreadConditionCreate(void) {
+    ThreadCondition* condition = (ThreadCondition*)MemoryAlloc(MEMORY_TAG_THREADS, sizeof(ThreadCondition));
+    if (condition) {
+        InitializeConditionVariable(&condition->variable);
+    }
+    return condition;
+}
+
+/**
+ * @brief Destroys a condition variable.
+ *
+ * @param condition The condition variable. NULL is ignored.
+ */
+void ThreadConditionDestroy(ThreadCondition* condition) {
+    MemoryFree(condition); // Win32 condition variables hold no resources
+}
+
+/**
+ * @brief Releases a lock and waits until the condition variable is woken.
+ *
+ * The lock is held again on return. Wake-ups may be spurious, so callers
+ * check their condition in a loop.
+ *
+ * @param condition The condition variable.
+ * @param lock The lock, held by the caller.
+ */
+void ThreadConditionWait(ThreadCondition* condition, ThreadLock* lock) {
+    SleepConditionVariableCS(&condition->variable, &lock->section, INFINITE);
+}
+
+/**
+ * @brief Wakes every thread waiting on a condition variable.
+ *
+ * @param condition The condition variable.
+ */
+void ThreadConditionWakeAll(ThreadCondition* condition) {
+    WakeAllConditionVariable(&condition->variable);
+}
+
+/**
+ * @brief Atomically adds one to a reference count.
+ *
+ * @param value The count.
+ * @return The new value.
+ */
+long ThreadAtomicIncrement(volatile long* value) {
+    return InterlockedIncrement(value);
+}
+
+/**
+ * @brief Atomically subtracts one from a reference count.
+ *
+ * @param value The count.
+ * @return The new value.
+ */
+long ThreadAtomicDecrement(volatile long* value) {
+    return InterlockedDecrement(value);
+}
+
+/**
+ * @brief Atomically adds to a 64-bit counter.
+ *
+ * @param value The counter.
+ * @param delta The amount to add, which may be negative.
+ * @return The new value.
+ */
+int64_t ThreadAtomicAdd64(volatile int64_t* value, int64_t delta) {
+    return InterlockedExchangeAdd64((volatile LONG64*)value, delta) + delta;
+}
+
+/**
+ * @brief Atomically replaces a 64-bit value if it holds an expected value.
+ *
+ * @param value The value.
+ * @param expected The value it must hold.
+ * @param desired The value to store.
+ * @return true if the value was replaced, false if it held something else.
+ */
+bool ThreadAtomicCompareExchange64(volatile int64_t* value, int64_t expected, int64_t desired) {
+    return InterlockedCompareExchange64((volatile LONG64*)value, desired, expected) == expected;
+}
+
+#else /* POSIX */
+
+struct Thread {
+    pthread_t handle;
+    ThreadProc proc;
+    void* context;
+};
+
+struct ThreadLock {
+    pthread_mutex_t mutex;
+};
+
+struct ThreadCondition {
+    pthread_cond_t variable;
+};
+
+/**
+ * @brief Thread entry point calling the thread's function.
+ *
+ * @param parameter The thread.
+ * @return Always NULL.
+ */
+static void* ThreadEntry(void* parameter) {
+    Thread* thread = (Thread*)parameter;
+    thread->proc(thread->context);
+    MemoryReleaseThreadCache();
+    return NULL;
+}
+
+/**
+ * @brief Starts a thread.
+ *
+ * @param proc The function to run.
+ * @param context Pointer passed to the function.
+ * @return The thread, or NULL on failure. Release it with ThreadJoin.
+ */
+Thread* ThreadStart(ThreadProc proc, void* context) {
+    Thread* thread = (Thread*)MemoryAlloc(MEMORY_TAG_THREADS, sizeof(Thread));
+    if (!thread) {
+        return NULL;
+    }
+    thread->proc = proc;
+    thread->context = context;
+    if (pthread_create(&thread->handle, NULL, ThreadEntry, thread) != 0) {
+        MemoryFree(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+/**
+ * @brief Waits for a thread to finish and releases it.
+ *
+ * @param thread The thread. NULL is ignored.
+ */
+void ThreadJoin(Thread* thread) {
+    if (!thread) {
+        return;
+    }
+    pthread_join(thread->handle, NULL);
+    MemoryFree(thread);
+}
+
+/**
+ * @brief Gets the number of processors available to the process.
+ *
+ * @return The processor count, at least 1.
+ */
+unsigned ThreadProcessorCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned)count : 1;
+}
+
+/**
+ * @brief Creates a lock.
+ *
+ * @return The lock, or NULL on allocation failure.
+ */
+ThreadLock* ThreadLockCreate(void) {
+    ThreadLock* lock = (ThreadLock*)MemoryAlloc(MEMORY_TAG_THREADS, sizeof(ThreadLock));
+    if (lock && pthread_mutex_init(&lock->mutex, NULL) != 0) {
+        MemoryFree(lock);
+        return NULL;
+    }
+    return lock;
+}
+
+/**
+ * @brief Destroys a lock.
+ *
+ * @param lock The lock. NULL is ignored.
+ */
+void ThreadLockDestroy(ThreadLock* lock) {
+    if (lock) {
+        pthread_mutex_destroy(&lock->mutex);
+        MemoryFree(lock);
+    }
+}
+
+/**
+ * @brief Acquires a lock, waiting for other threads to release it.
+ *
+ * @param lock The lock.
+ */
+void ThreadLockEnter(ThreadLock* lock) {
+    pthread_mutex_lock(&lock->mutex);
+}
+
+/**
+ * @brief Releases a lock.
+ *
+ * @param lock The lock.
+ */
+void ThreadLockLeave(ThreadLock* lock) {
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+/**
+ * @brief Creates a condition variable.
+ *
+ * @return The condition variable, or NULL on allocation failure.
+ */
+ThreadCondition* ThreadConditionCreate(void) {
+    ThreadCondition* condition = (ThreadCondition*)MemoryAlloc(MEMORY_TAG_THREADS, sizeof(ThreadCondition));
+    if (condition && pthread_cond_init(&condition->variable, NULL) != 0) {
+        MemoryFree(condition);
+        return NULL;
+    }
+    return condition;
+}
+
+/**
+ * @brief Destroys a condition variable.
+ *
+ * @param condition The condition variable. NULL is ignored.
+ */
+void ThreadConditionDestroy(ThreadCondition* condition) {
+    if (condition) {
+        pthread_cond_destroy(&condition->variable);
+        MemoryFree(condition);
+    }
+}
+
+/**
+ * @brief Releases a lock and waits until the condition variable is woken.
+ *
+ * The lock is held again on return. Wake-ups may be spurious, so callers
+ * check their condition in a loop.
+ *
+ * @param condition The condition variable.
+ * @param lock The lock, held by the caller.
+ */
+void ThreadConditionWait(ThreadCondition* condition, ThreadLock* lock) {
+    pthread_cond_wait(&condition->variable, &lock->mutex);
+}
+
+/**
+ * @brief Wakes every thread waiting on a condition variable.
+ *
+ * @param condition The condition variable.
+ */
+void ThreadConditionWakeAll(ThreadCondition* condition) {
+    pthread_cond_broadcast(&condition->variable);
+}
+
+/**
+ * @brief Atomically adds one to a reference count.
+ *
+ * @param value The count.
+ * @return The new value.
+ */
+long ThreadAtomicIncrement(volatile long* value) {
+    return __atomic_add_fetch(value, 1, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief Atomically subtracts one from a reference count.
+ *
+ * @param value The count.
+ * @return The new value.
+ */
+long ThreadAtomicDecrement(volatile long* value) {
+    return __atomic_sub_fetch(value, 1, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief Atomically adds to a 64-bit counter.
+ *
+ * @param value The counter.
+ * @param delta The amount to add, which may be negative.
+ * @return The new value.
+ */
+int64_t ThreadAtomicAdd64(volatile int64_t* value, int64_t delta) {
+    return __atomic_add_fetch(value, delta, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief Atomically replaces a 64-bit value if it holds an expected value.
+ *
+ * @param value The value.
+ * @param expected The value it must hold.
+ * @param desired The value to store.
+ * @return true if the value was replaced, false if it held something else.
+ */
+bool ThreadAtomicCompareExchange64(volatile int64_t* value, int64_t expected, int64_t desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,935 @@
+/**
+ * @file timeindex.c
+ * @brief Timestamp index implementation for the Professional Text Editor
+ *
+ * Contains the timestamp parsers, the format detection, the sampling of one
+ * entry per megabyte and the jump to a time. Only the first bytes of a line
+ * are read to find its timestamp, so building the index of a 10 GB file
+ * reads one page per megabyte, and a jump reads about twenty lines.
+ */
+
+#include "../include/timeindex.h"
+#include "../include/memory.h"
+#include <stdio.h>
+#include <string.h>
+
+// Bytes of document per index entry
+#define TIME_INDEX_INTERVAL (1024 * 1024)
+
+// Places across the document where lines are sampled to detect the format
+#define TIME_INDEX_SAMPLE_POINTS 16
+
+// Consecutive lines sampled at each place
+#define TIME_INDEX_SAMPLE_LINES 8
+
+// Timestamps start within this many bytes of the line start
+#define TIME_INDEX_MAX_COLUMN 64
+
+// Longest timestamp read, fraction included
+#define TIME_INDEX_MAX_STAMP 40
+
+// Bytes read from the start of a line to find its timestamp
+#define TIME_INDEX_HEAD (TIME_INDEX_MAX_COLUMN + TIME_INDEX_MAX_STAMP)
+
+// Lines without a timestamp passed over at most, such as a stack trace
+#define TIME_INDEX_MAX_UNSTAMPED 256
+
+// Range of epoch seconds taken as timestamps: the years 2000 to 2099
+#define TIME_INDEX_EPOCH_MIN INT64_C(946684800)
+#define TIME_INDEX_EPOCH_MAX INT64_C(4102444800)
+
+// Year given to syslog stamps, a leap year so that Feb 29 is valid
+#define TIME_INDEX_SYSLOG_YEAR 2000
+
+// Microseconds in one day
+#define TIME_INDEX_DAY (INT64_C(86400) * TIME_INDEX_SECOND)
+
+// Time of the first stamped line of an interval
+typedef struct {
+    int64_t time;
+    uint64_t offset;        // Start of the line
+} TimeEntry;
+
+struct TimeIndex {
+    Document* document;
+    TimeFormat format;
+    size_t column;          // Column at which the sampled timestamps started most often
+    TimeEntry* entries;     // Ascending in offset and time
+    size_t count;
+    size_t capacity;
+};
+
+// Fields of a timestamp being parsed
+typedef struct {
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    int64_t micro;
+} TimeFields;
+
+static const char g_monthNames[12][4] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/**
+ * @brief Checks whether a byte is an ASCII digit.
+ *
+ * @param c The byte.
+ * @return true for '0' to '9', false otherwise.
+ */
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * @brief Reads a number of exactly some digits.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param[in,out] position Position of the first digit; moved past the digits.
+ * @param digits Number of digits.
+ * @param[out] value Receives the number.
+ * @return true if the digits are there, false otherwise.
+ */
+static bool ReadDigits(const char* text, size_t length, size_t* position, size_t digits, int* value) {
+    if (length - *position < digits) {
+        return false;
+    }
+    int number = 0;
+    for (size_t i = 0; i < digits; i++) {
+        char c = text[*position + i];
+        if (!IsDigit(c)) {
+            return false;
+        }
+        number = number * 10 + (c - '0');
+    }
+    *position += digits;
+    *value = number;
+    return true;
+}
+
+/**
+ * @brief Reads a byte that must come next.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param[in,out] position Position of the byte; moved past it.
+ * @param expected The byte.
+ * @return true if the byte is there, false otherwise.
+ */
+static bool ReadChar(const char* text, size_t length, size_t* position, char expected) {
+    if (*position >= length || text[*position] != expected) {
+        return false;
+    }
+    (*position)++;
+    return true;
+}
+
+/**
+ * @brief Reads an English month abbreviation.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param[in,out] position Position of the name; moved past it.
+ * @param[out] month Receives the month, 1 to 12.
+ * @return true if a month name is there, false otherwise.
+ */
+static bool ReadMonthName(const char* text, size_t length, size_t* position, int* month) {
+    if (length - *position < 3) {
+        return false;
+    }
+    for (int i = 0; i < 12; i++) {
+        const char* name = g_monthNames[i];
+        bool equal = true;
+        for (size_t j = 0; j < 3 && equal; j++) {
+            equal = (text[*position + j] | 0x20) == (name[j] | 0x20);
+        }
+        if (equal) {
+            *position += 3;
+            *month = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reads an optional fraction of a second: '.' or ',' and digits.
+ *
+ * Digits past the sixth are read and ignored.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param[in,out] position Position after the seconds; moved past the fraction.
+ * @param[out] micro Receives the fraction in microseconds, or 0 without one.
+ */
+static void ReadFraction(const char* text, size_t length, size_t* position, int64_t* micro) {
+    *micro = 0;
+    size_t p = *position;
+    if (p + 1 >= length || (text[p] != '.' && text[p] != ',') || !IsDigit(text[p + 1])) {
+        return;
+    }
+    p++;
+    int64_t scale = TIME_INDEX_SECOND / 10;
+    while (p < length && IsDigit(text[p])) {
+        *micro += (text[p] - '0') * scale;
+        scale /= 10;
+        p++;
+    }
+    *position = p;
+}
+
+/**
+ * @brief Reads a time of day: "hh:mm", then ":ss" and a fraction.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param[in,out] position Position of the hours; moved past the time.
+ * @param secondsRequired false to accept a time without seconds.
+ * @param[in,out] fields Receives the hour, minute, second and fraction.
+ * @return true if a time is there, false otherwise.
+ */
+static bool ReadTimeOfDay(const char* text, size_t length, size_t* position, bool secondsRequired,
+                          TimeFields* fields) {
+    size_t p = *position;
+    fields->second = 0;
+    fields->micro = 0;
+    if (!ReadDigits(text, length, &p, 2, &fields->hour) || !ReadChar(text, length, &p, ':') ||
+        !ReadDigits(text, length, &p, 2, &fields->minute)) {
+        return false;
+    }
+    size_t minuteEnd = p;
+    if (ReadChar(text, length, &p, ':') && ReadDigits(text, length, &p, 2, &fields->second)) {
+        ReadFraction(text, length, &p, &fields->micro);
+    } else if (secondsRequired) {
+        return false;
+    } else {
+        p = minuteEnd;
+    }
+    *position = p;
+    return true;
+}
+
+/**
+ * @brief Gets the number of days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+ *
+ * @param year The year.
+ * @param month The month, 1 to 12.
+ * @param day The day of the month.
+ * @return The number of days, negative before 1970.
+ */
+static int64_t DaysFromCivil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * @brief Converts the fields of a timestamp to a time.
+ *
+ * @param fields The fields.
+ * @param[out] time Receives the time.
+ * @return true if every field is in range, false otherwise.
+ */
+static bool TimeFromFields(const TimeFields* fields, int64_t* time) {
+    static const int daysInMonth[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (fields->month < 1 || fields->month > 12 || fields->day < 1 ||
+        fields->day > daysInMonth[fields->month - 1] || fields->hour > 23 || fields->minute > 59 ||
+        fields->second > 60) {
+        return false;
+    }
+    bool leap = fields->year % 4 == 0 && (fields->year % 100 != 0 || fields->year % 400 == 0);
+    if (fields->month == 2 && fields->day == 29 && !leap) {
+        return false;
+    }
+    int64_t days = DaysFromCivil(fields->year, fields->month, fields->day);
+    int64_t seconds = ((int64_t)fields->hour * 60 + fields->minute) * 60 + fields->second;
+    *time = days * TIME_INDEX_DAY + seconds * TIME_INDEX_SECOND + fields->micro;
+    return true;
+}
+
+/**
+ * @brief Reads an ISO 8601 style date: "yyyy-mm-dd" or "yyyy/mm/dd".
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param[in,out] position Position of the year; moved past the date.
+ * @param[in,out] fields Receives the year, month and day.
+ * @return true if a date is there, false otherwise.
+ */
+static bool ReadIsoDate(const char* text, size_t length, size_t* position, TimeFields* fields) {
+    size_t p = *position;
+    if (!ReadDigits(text, length, &p, 4, &fields->year) || p >= length) {
+        return false;
+    }
+    char separator = text[p];
+    if ((separator != '-' && separator != '/') || !ReadChar(text, length, &p, separator) ||
+        !ReadDigits(text, length, &p, 2, &fields->month) || !ReadChar(text, length, &p, separator) ||
+        !ReadDigits(text, length, &p, 2, &fields->day)) {
+        return false;
+    }
+    *position = p;
+    return true;
+}
+
+/**
+ * @brief Reads a timestamp of a known format.
+ *
+ * @param format The format.
+ * @param text The text.
+ * @param length Length of the text.
+ * @param position Position of the first byte of the timestamp.
+ * @param[out] time Receives the time.
+ * @return The position after the timestamp, or 0 if there is none.
+ */
+static size_t ReadStamp(TimeFormat format, const char* text, size_t length, size_t position, int64_t* time) {
+    TimeFields fields;
+    memset(&fields, 0, sizeof(fields));
+    size_t p = position;
+    switch (format) {
+        case TIME_FORMAT_ISO:
+            if (!ReadIsoDate(text, length, &p, &fields) || p >= length || (text[p] != 'T' && text[p] != ' ')) {
+                return 0;
+            }
+            p++;
+            if (!ReadTimeOfDay(text, length, &p, true, &fields)) {
+                return 0;
+            }
+            break;
+
+        case TIME_FORMAT_COMMON_LOG:
+            if (!ReadDigits(text, length, &p, 2, &fields.day) || !ReadChar(text, length, &p, '/') ||
+                !ReadMonthName(text, length, &p, &fields.month) || !ReadChar(text, length, &p, '/') ||
+                !ReadDigits(text, length, &p, 4, &fields.year) || !ReadChar(text, length, &p, ':') ||
+                !ReadTimeOfDay(text, length, &p, true, &fields)) {
+                return 0;
+            }
+            break;
+
+        case TIME_FORMAT_SYSLOG:
+            // The day is padded to two columns with a space or a zero
+            fields.year = TIME_INDEX_SYSLOG_YEAR;
+            if (!ReadMonthName(text, length, &p, &fields.month) || !ReadChar(text, length, &p, ' ')) {
+                return 0;
+            }
+            if (p < length && text[p] == ' ') {
+                p++;
+                if (!ReadDigits(text, length, &p, 1, &fields.day)) {
+                    return 0;
+                }
+            } else if (!ReadDigits(text, length, &p, 2, &fields.day)) {
+                return 0;
+            }
+            if (!ReadChar(text, length, &p, ' ') || !ReadTimeOfDay(text, length, &p, true, &fields)) {
+                return 0;
+            }
+            break;
+
+        case TIME_FORMAT_EPOCH: {
+            // Ten digits of seconds, optionally with a fraction, or thirteen of milliseconds
+            size_t digits = 0;
+            int64_t value = 0;
+            while (p < length && IsDigit(text[p]) && digits < 14) {
+                value = value * 10 + (text[p] - '0');
+                digits++;
+                p++;
+            }
+            if (digits == 13) {
+                fields.micro = (value % 1000) * 1000;
+                value /= 1000;
+            } else if (digits == 10) {
+                ReadFraction(text, length, &p, &fields.micro);
+            } else {
+                return 0;
+            }
+            if (value < TIME_INDEX_EPOCH_MIN || value >= TIME_INDEX_EPOCH_MAX) {
+                return 0;
+            }
+            *time = value * TIME_INDEX_SECOND + fields.micro;
+            return p < length && IsDigit(text[p]) ? 0 : p;
+        }
+
+        default:
+            return 0;
+    }
+
+    // A timestamp ends where the number ends, not inside a longer one
+    if (p < length && IsDigit(text[p])) {
+        return 0;
+    }
+    return TimeFromFields(&fields, time) ? p : 0;
+}
+
+/**
+ * @brief Checks whether a timestamp may start at a position.
+ *
+ * @param text The text.
+ * @param position The position.
+ * @return true at the start of the text or after a byte that is not a letter or digit.
+ */
+static bool IsStampStart(const char* text, size_t position) {
+    if (position == 0) {
+        return true;
+    }
+    char c = text[position - 1];
+    return !IsDigit(c) && !((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+/**
+ * @brief Finds the first timestamp of a format in the head of a line.
+ *
+ * @param format The format.
+ * @param text The first bytes of the line.
+ * @param length Number of bytes.
+ * @param firstColumn Column tried first, where the timestamps of the document usually start.
+ * @param[out] time Receives the time.
+ * @param[out] column Receives the column of the timestamp; may be NULL.
+ * @return true if a timestamp was found, false otherwise.
+ */
+static bool FindStamp(TimeFormat format, const char* text, size_t length, size_t firstColumn, int64_t* time,
+                      size_t* column) {
+    if (firstColumn < length && IsStampStart(text, firstColumn) &&
+        ReadStamp(format, text, length, firstColumn, time) > 0) {
+        if (column) {
+            *column = firstColumn;
+        }
+        return true;
+    }
+    for (size_t p = 0; p <= TIME_INDEX_MAX_COLUMN && p < length; p++) {
+        if (p != firstColumn && IsStampStart(text, p) && ReadStamp(format, text, length, p, time) > 0) {
+            if (column) {
+                *column = p;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reads the first bytes of a line, where its timestamp would be.
+ *
+ * @param document The document.
+ * @param line The line.
+ * @param buffer Receives the bytes; TIME_INDEX_HEAD bytes long.
+ * @return Number of bytes read.
+ */
+static size_t ReadLineHead(const Document* document, uint64_t line, char* buffer) {
+    uint64_t start = DocumentLineStart(document, line);
+    uint64_t length = DocumentLineEnd(document, line) - start;
+    return DocumentRead(document, start, buffer, length < TIME_INDEX_HEAD ? (size_t)length : TIME_INDEX_HEAD);
+}
+
+/**
+ * @brief Gets the timestamp of a line.
+ *
+ * @param index The index.
+ * @param line The line.
+ * @param[out] time Receives the time.
+ * @return true if the line has a timestamp, false otherwise.
+ */
+static bool LineStamp(const TimeIndex* index, uint64_t line, int64_t* time) {
+    char head[TIME_INDEX_HEAD];
+    size_t length = ReadLineHead(index->document, line, head);
+    return FindStamp(index->format, head, length, index->column, time, NULL);
+}
+
+/**
+ * @brief Finds the first stamped line in a range of lines.
+ *
+ * At most TIME_INDEX_MAX_UNSTAMPED lines are read.
+ *
+ * @param index The index.
+ * @param line First line of the range.
+ * @param end Line after the range.
+ * @param[out] found Receives the stamped line.
+ * @param[out] time Receives its time.
+ * @return true if a stamped line was found, false otherwise.
+ */
+static bool NextStampedLine(const TimeIndex* index, uint64_t line, uint64_t end, uint64_t* found, int64_t* time) {
+    if (end > line && end - line > TIME_INDEX_MAX_UNSTAMPED) {
+        end = line + TIME_INDEX_MAX_UNSTAMPED;
+    }
+    for (; line < end; line++) {
+        if (LineStamp(index, line, time)) {
+            *found = line;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finds the first stamped line in a range of lines, however far it is.
+ *
+ * Unlike NextStampedLine, runs of unstamped lines longer than
+ * TIME_INDEX_MAX_UNSTAMPED are passed over, so the whole range may be read.
+ *
+ * @param index The index.
+ * @param line First line of the range.
+ * @param end Line after the range.
+ * @param[out] found Receives the stamped line.
+ * @param[out] time Receives its time.
+ * @return true if a stamped line was found, false otherwise.
+ */
+static bool FindStampedLine(const TimeIndex* index, uint64_t line, uint64_t end, uint64_t* found, int64_t* time) {
+    for (; line < end; line += TIME_INDEX_MAX_UNSTAMPED) {
+        if (NextStampedLine(index, line, end, found, time)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Detects the timestamp format of a document from sampled lines.
+ *
+ * Lines are read at the start and at evenly spaced places. The format
+ * found in the most lines wins if it is in at least a quarter of them.
+ *
+ * @param index The index; receives the format and its usual column.
+ * @return true if a format was detected, false otherwise.
+ */
+static bool DetectFormat(TimeIndex* index) {
+    const Document* document = index->document;
+    uint64_t lineCount = DocumentLineCount(document);
+    uint64_t length = DocumentLength(document);
+    size_t hits[TIME_FORMAT_COUNT] = { 0 };
+    size_t columns[TIME_FORMAT_COUNT][TIME_INDEX_MAX_COLUMN + 1];
+    memset(columns, 0, sizeof(columns));
+    size_t sampled = 0;
+    uint64_t nextLine = 0;
+
+    for (uint64_t point = 0; point < TIME_INDEX_SAMPLE_POINTS; point++) {
+        uint64_t line = DocumentLineFromOffset(document, length / TIME_INDEX_SAMPLE_POINTS * point);
+        if (line < nextLine) {
+            line = nextLine;
+        }
+        for (size_t i = 0; i < TIME_INDEX_SAMPLE_LINES && line < lineCount; i++, line++) {
+            char head[TIME_INDEX_HEAD];
+            size_t headLength = ReadLineHead(document, line, head);
+            if (headLength == 0) {
+                continue;
+            }
+            sampled++;
+            for (int format = 0; format < TIME_FORMAT_COUNT; format++) {
+                int64_t time;
+                size_t column;
+                if (FindStamp((TimeFormat)format, head, headLength, 0, &time, &column)) {
+                    hits[format]++;
+                    columns[format][column]++;
+                }
+            }
+        }
+        nextLine = line;
+    }
+
+    int best = 0;
+    for (int format = 1; format < TIME_FORMAT_COUNT; format++) {
+        if (hits[format] > hits[best]) {
+            best = format;
+        }
+    }
+    if (hits[best] == 0 || hits[best] * 4 < sampled) {
+        return false;
+    }
+    index->format = (TimeFormat)best;
+    index->column = 0;
+    for (size_t column = 1; column <= TIME_INDEX_MAX_COLUMN; column++) {
+        if (columns[best][column] > columns[best][index->column]) {
+            index->column = column;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Appends an entry to the index.
+ *
+ * @param index The index.
+ * @param time Time of the line.
+ * @param offset Start of the line.
+ * @return true if successful, false on allocation failure.
+ */
+static bool AppendEntry(TimeIndex* index, int64_t time, uint64_t offset) {
+    if (index->count == index->capacity) {
+        size_t newCapacity = index->capacity ? index->capacity * 2 : 64;
+        TimeEntry* newEntries = (TimeEntry*)MemoryRealloc(MEMORY_TAG_TIMES, index->entries,
+                                                          newCapacity * sizeof(TimeEntry));
+        if (!newEntries) {
+            return false;
+        }
+        index->entries = newEntries;
+        index->capacity = newCapacity;
+    }
+    index->entries[index->count].time = time;
+    index->entries[index->count].offset = offset;
+    index->count++;
+    return true;
+}
+
+/**
+ * @brief Samples the first stamped line of every interval of the document.
+ *
+ * A time earlier than the one before it is raised to it, so the entries
+ * stay sorted even where the log is not.
+ *
+ * @param index The index; its entries are replaced.
+ * @return true if successful, false on allocation failure.
+ */
+static bool BuildEntries(TimeIndex* index) {
+    const Document* document = index->document;
+    uint64_t length = DocumentLength(document);
+    uint64_t lineCount = DocumentLineCount(document);
+    index->count = 0;
+    for (uint64_t offset = 0; offset < length; offset += TIME_INDEX_INTERVAL) {
+        // The first line starting in the interval
+        uint64_t line = DocumentLineFromOffset(document, offset);
+        if (DocumentLineStart(document, line) < offset) {
+            line++;
+        }
+        uint64_t stamped;
+        int64_t time;
+        if (!NextStampedLine(index, line, lineCount, &stamped, &time)) {
+            continue;
+        }
+        uint64_t start = DocumentLineStart(document, stamped);
+        if (index->count > 0) {
+            const TimeEntry* last = &index->entries[index->count - 1];
+            if (start <= last->offset) {
+                continue;
+            }
+            if (time < last->time) {
+                time = last->time;
+            }
+        }
+        if (!AppendEntry(index, time, start)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Moves the entries of the index with the changes of the document.
+ *
+ * Entries whose timestamp an edit may have touched are dropped; the rest
+ * move by the length difference of the changes before them.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes, or NULL if unknown.
+ * @param changeCount Number of changes.
+ * @param context The index.
+ */
+static void TimesDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                 void* context) {
+    TimeIndex* index = (TimeIndex*)context;
+    (void)document;
+    if (!changes) {
+        BuildEntries(index);
+        return;
+    }
+
+    size_t kept = 0;
+    size_t next = 0;
+    int64_t shift = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        TimeEntry entry = index->entries[i];
+        while (next < changeCount && changes[next].offset + changes[next].removedLength < entry.offset) {
+            shift += (int64_t)changes[next].insertedLength - (int64_t)changes[next].removedLength;
+            next++;
+        }
+        if (next < changeCount && changes[next].offset < entry.offset + TIME_INDEX_HEAD) {
+            continue;
+        }
+        entry.offset = (uint64_t)((int64_t)entry.offset + shift);
+        index->entries[kept++] = entry;
+    }
+    index->count = kept;
+}
+
+/**
+ * @brief Detects the timestamps of a document and indexes them.
+ *
+ * The index registers itself as a document listener. Entries touched by an
+ * edit are dropped and the others move with the text, so jumps stay exact
+ * after edits and only search longer where entries were dropped.
+ *
+ * @param document The document; it must outlive the index.
+ * @return The index, or NULL if too few sampled lines carry a known timestamp or memory ran out.
+ */
+TimeIndex* TimeIndexCreate(Document* document) {
+    if (!document) {
+        return NULL;
+    }
+    TimeIndex* index = (TimeIndex*)MemoryCalloc(MEMORY_TAG_TIMES, 1, sizeof(TimeIndex));
+    if (!index) {
+        return NULL;
+    }
+    index->document = document;
+    if (!DetectFormat(index) || !BuildEntries(index) ||
+        !DocumentAddListener(document, TimesDocumentChanged, index)) {
+        MemoryFree(index->entries);
+        MemoryFree(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**
+ * @brief Destroys a timestamp index and unregisters it from its document.
+ *
+ * @param index The index. NULL is ignored.
+ */
+void TimeIndexDestroy(TimeIndex* index) {
+    if (!index) {
+        return;
+    }
+    DocumentRemoveListener(index->document, TimesDocumentChanged, index);
+    MemoryFree(index->entries);
+    MemoryFree(index);
+}
+
+/**
+ * @brief Gets the timestamp format detected in the document.
+ *
+ * @param index The index.
+ * @return The format.
+ */
+TimeFormat TimeIndexFormat(const TimeIndex* index) {
+    return index->format;
+}
+
+/**
+ * @brief Gets the number of (time, offset) entries of the index.
+ *
+ * @param index The index.
+ * @return The number of entries.
+ */
+size_t TimeIndexEntryCount(const TimeIndex* index) {
+    return index->count;
+}
+
+/**
+ * @brief Gets the time of a line.
+ *
+ * Lines without a timestamp, such as the lines of a stack trace, take the
+ * time of the closest stamped line above them; lines above the first
+ * timestamp take the first one.
+ *
+ * @param index The index.
+ * @param line The line.
+ * @param[out] time Receives the time.
+ * @return true if a stamped line was found near the line, false otherwise.
+ */
+bool TimeIndexLineTime(const TimeIndex* index, uint64_t line, int64_t* time) {
+    uint64_t lineCount = DocumentLineCount(index->document);
+    if (line >= lineCount) {
+        line = lineCount - 1;
+    }
+    for (uint64_t i = 0; i < TIME_INDEX_MAX_UNSTAMPED && i <= line; i++) {
+        if (LineStamp(index, line - i, time)) {
+            return true;
+        }
+    }
+    uint64_t found;
+    return NextStampedLine(index, line, lineCount, &found, time);
+}
+
+/**
+ * @brief Skips the zone that may follow a time: "Z", "UTC" or an offset such as "+02:00".
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param position Position after the time.
+ * @return The position after the zone, or position if there is none.
+ */
+static size_t SkipZone(const char* text, size_t length, size_t position) {
+    size_t p = position;
+    while (p < length && text[p] == ' ') {
+        p++;
+    }
+    if (p < length && text[p] == 'Z') {
+        return p + 1;
+    }
+    if (length - p >= 3 && memcmp(text + p, "UTC", 3) == 0) {
+        return p + 3;
+    }
+    int hours;
+    int minutes;
+    if (p < length && (text[p] == '+' || text[p] == '-')) {
+        p++;
+        if (ReadDigits(text, length, &p, 2, &hours)) {
+            size_t q = p;
+            if (!(ReadChar(text, length, &q, ':') && ReadDigits(text, length, &q, 2, &minutes))) {
+                q = p;
+                ReadDigits(text, length, &q, 2, &minutes);
+            }
+            return q;
+        }
+    }
+    return position;
+}
+
+/**
+ * @brief Parses a time typed by the user.
+ *
+ * Accepts a timestamp in any of the known formats, a date ("2026-10-15"),
+ * or a time of day ("14:32", "14:32:07.250") on the day of the reference.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param reference Time whose day completes a time of day, such as the time of the caret line.
+ * @param[out] time Receives the time.
+ * @return true if the text is a time, false otherwise.
+ */
+bool TimeIndexParseTime(const char* text, size_t length, int64_t reference, int64_t* time) {
+    while (length > 0 && (text[length - 1] == ' ' || text[length - 1] == '\t')) {
+        length--;
+    }
+    size_t start = 0;
+    while (start < length && (text[start] == ' ' || text[start] == '\t' || text[start] == '[')) {
+        start++;
+    }
+    if (start == length) {
+        return false;
+    }
+
+    // A full timestamp, as copied from the log
+    for (int format = 0; format < TIME_FORMAT_COUNT; format++) {
+        int64_t value;
+        size_t end = ReadStamp((TimeFormat)format, text, length, start, &value);
+        if (end > 0) {
+            end = SkipZone(text, length, end);
+            if (end == length || (end + 1 == length && text[end] == ']')) {
+                *time = value;
+                return true;
+            }
+        }
+    }
+
+    // A date, optionally with a time of day without seconds
+    TimeFields fields;
+    memset(&fields, 0, sizeof(fields));
+    size_t p = start;
+    if (ReadIsoDate(text, length, &p, &fields)) {
+        if (p < length && (text[p] == ' ' || text[p] == 'T')) {
+            p++;
+            if (!ReadTimeOfDay(text, length, &p, false, &fields)) {
+                return false;
+            }
+        }
+        return SkipZone(text, length, p) == length && TimeFromFields(&fields, time);
+    }
+
+    // A time of day on the day of the reference
+    p = start;
+    if (!ReadTimeOfDay(text, length, &p, false, &fields) || SkipZone(text, length, p) != length ||
+        fields.hour > 23 || fields.minute > 59 || fields.second > 60) {
+        return false;
+    }
+    int64_t day = reference >= 0 ? reference / TIME_INDEX_DAY : (reference - TIME_INDEX_DAY + 1) / TIME_INDEX_DAY;
+    int64_t seconds = ((int64_t)fields.hour * 60 + fields.minute) * 60 + fields.second;
+    *time = day * TIME_INDEX_DAY + seconds * TIME_INDEX_SECOND + fields.micro;
+    return true;
+}
+
+/**
+ * @brief Finds the first line stamped at or after a time.
+ *
+ * The entries give the lines between which the time lies; those lines are
+ * then bisected. Lines without a timestamp are passed over to the next
+ * stamped line, however long the run, so a stack trace never ends the
+ * search early.
+ *
+ * @param index The index.
+ * @param time The time.
+ * @return The line, or the last line if every timestamp is earlier.
+ */
+uint64_t TimeIndexFindLine(const TimeIndex* index, int64_t time) {
+    const Document* document = index->document;
+    uint64_t lineCount = DocumentLineCount(document);
+
+    // The first entry at or after the time
+    size_t low = 0;
+    size_t high = index->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (index->entries[mid].time < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    uint64_t first = low > 0 ? DocumentLineFromOffset(document, index->entries[low - 1].offset) + 1 : 0;
+    uint64_t end = low < index->count ? DocumentLineFromOffset(document, index->entries[low].offset) : lineCount;
+    if (first > end) {
+        first = end;
+    }
+
+    // The answer is the first stamped line at or after the time in [first, end], or end
+    uint64_t lo = first;
+    uint64_t hi = end;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        uint64_t stamped;
+        int64_t stampedTime;
+        if (FindStampedLine(index, mid, hi, &stamped, &stampedTime) && stampedTime < time) {
+            lo = stamped + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint64_t found;
+    int64_t foundTime;
+    if (FindStampedLine(index, lo, end, &found, &foundTime)) {
+        return found;
+    }
+    return end < lineCount ? end : lineCount - 1;
+}
+
+/**
+ * @brief Formats a time as "2026-10-15 08:53:20", with a fraction if it has one.
+ *
+ * @param time The time.
+ * @param buffer Receives the NUL-terminated text.
+ * @param capacity Size of the buffer.
+ * @return Length of the text, or 0 if the buffer is too small.
+ */
+size_t TimeIndexFormatTime(int64_t time, char* buffer, size_t capacity) {
+    int64_t days = time >= 0 ? time / TIME_INDEX_DAY : (time - TIME_INDEX_DAY + 1) / TIME_INDEX_DAY;
+    int64_t rest = time - days * TIME_INDEX_DAY;
+    int64_t seconds = rest / TIME_INDEX_SECOND;
+    int64_t micro = rest % TIME_INDEX_SECOND;
+
+    // Civil date of a day number
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t dayOfEra = z - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    int day = (int)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    int month = (int)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    long long year = (long long)(yearOfEra + era * 400 + (month <= 2));
+
+    int length;
+    if (micro == 0) {
+        length = snprintf(buffer, capacity, "%04lld-%02d-%02d %02d:%02d:%02d", year, month, day,
+                          (int)(seconds / 3600), (int)(seconds / 60 % 60), (int)(seconds % 60));
+    } else if (micro % 1000 == 0) {
+        length = snprintf(buffer, capacity, "%04lld-%02d-%02d %02d:%02d:%02d.%03d", year, month, day,
+                          (int)(seconds / 3600), (int)(seconds / 60 % 60), (int)(seconds % 60), (int)(micro / 1000));
+    } else {
+        length = snprintf(buffer, capacity, "%04lld-%02d-%02d %02d:%02d:%02d.%06d", year, month, day,
+                          (int)(seconds / 3600), (int)(seconds / 60 % 60), (int)(seconds % 60), (int)micro);
+    }
+    return length > 0 && (size_t)length < capacity ? (size_t)length : 0;
+}
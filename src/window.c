@@ -8,14 +8,28 @@
 #include "../include/window.h"
 #include "../include/control.h"
 #include "../include/fileops.h"
+#include "../include/hexview.h"
+#include "../include/tableview.h"
+#include "../include/jsonoutline.h"
+#include "../include/frame.h"
+#include "../include/clipboard.h"
+#include "../include/memory.h"
 #include <commctrl.h> // Required for status bar
 #include <Shlwapi.h> // Required for PathFindFileName
 
 // Global variables
 HINSTANCE g_hInstance = NULL;  // Application instance handle (made non-static)
 HWND g_hEdit = NULL;          // Global handle to the edit control (made non-static)
+HWND g_hHexView = NULL;       // Hex view shown instead of the edit control for binary files
+HWND g_hTableView = NULL;     // Table view shown instead of the edit control for CSV and TSV files
+HWND g_hJsonOutline = NULL;   // Outline window of a JSON document, or NULL while closed
 HWND g_hStatusBar = NULL;     // Global handle to the status bar control
 EditorState g_editorState;    // Global editor state (file path, size, etc.)
+SpellDict* g_spellDict = NULL; // Spelling dictionary, or NULL if none is installed
+BOOL g_spellChecking = FALSE; // Spell checking is turned on in the View menu
+static HWND g_hMainWindow = NULL;      // The main window, once created
+static HACCEL g_hAccelerators = NULL;  // Shortcuts of the File menu, active in every child window
+static char g_progressText[128] = "";  // Progress of a background task shown instead of the file, or empty
 
 /**
  * @brief Registers the main window class for the application.
@@ -76,6 +90,40 @@ BOOL CreateMainWindow(HINSTANCE hInstance, int nCmdShow) {
     return TRUE;
 }
 
+/**
+ * @brief Runs the layout and status bar work marked since the last frame.
+ *
+ * @param work The FRAME_WORK_ flags.
+ */
+static void RunFrameWork(unsigned work) {
+    if ((work & FRAME_WORK_LAYOUT) && g_hMainWindow) {
+        RECT client;
+        GetClientRect(g_hMainWindow, &client);
+        HandleWindowResize(g_hMainWindow, MAKELPARAM(client.right, client.bottom));
+    }
+    if (work & FRAME_WORK_STATUS) {
+        if (g_progressText[0] && g_hStatusBar) {
+            SendMessage(g_hStatusBar, SB_SETTEXT, 0, (LPARAM)g_progressText);
+        } else {
+            UpdateStatusBar(g_hStatusBar, &g_editorState);
+        }
+    }
+}
+
+/**
+ * @brief Translates the keyboard shortcuts of the main window.
+ *
+ * @param msg The message taken from the queue.
+ * @return TRUE if the message was a shortcut and has been handled, FALSE otherwise.
+ */
+BOOL TranslateEditorAccelerator(MSG* msg) {
+    // Tool windows such as the outline have their own keys
+    if (!g_hMainWindow || !g_hAccelerators || GetAncestor(msg->hwnd, GA_ROOT) != g_hMainWindow) {
+        return FALSE;
+    }
+    return TranslateAccelerator(g_hMainWindow, g_hAccelerators, msg) != 0;
+}
+
 /**
  * @brief Creates the menu bar for the main window.
  *
@@ -90,26 +138,142 @@ static HMENU CreateMenuBar(HWND hWnd) {
     hMenu = CreateMenu();
     AppendMenu(hMenu, MF_STRING, 1, "&New");
     AppendMenu(hMenu, MF_STRING, 2, "&Open");
-    AppendMenu(hMenu, MF_STRING, 3, "&Save");
+    AppendMenu(hMenu, MF_STRING, 3, "&Save\tCtrl+S");
+    AppendMenu(hMenu, MF_STRING, IDM_FILE_SAVE_AS, "Save &As...\tCtrl+Shift+S");
+    AppendMenu(hMenu, MF_STRING, IDM_FILE_COMPARE_SAVED, "&Compare with Saved");
+    HMENU hFormatMenu = CreateMenu();
+    AppendMenu(hFormatMenu, MF_STRING, IDM_FILE_FORMAT_TRIM_TRAILING, "&Trim Trailing Whitespace");
+    AppendMenu(hFormatMenu, MF_STRING, IDM_FILE_FORMAT_EXPAND_TABS, "&Expand Tabs");
+    AppendMenu(hFormatMenu, MF_STRING, IDM_FILE_FORMAT_FINAL_NEWLINE, "Add &Final Newline");
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hFormatMenu, "&Format on Save");
     AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
     AppendMenu(hMenu, MF_STRING, 4, "E&xit");
     AppendMenu(hMenubar, MF_POPUP, (UINT_PTR)hMenu, "&File");
     
     // Edit menu
     hMenu = CreateMenu();
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_UNDO, "&Undo\tCtrl+Z");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_REDO, "&Redo\tCtrl+Y");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
     AppendMenu(hMenu, MF_STRING, 5, "Cu&t");
     AppendMenu(hMenu, MF_STRING, 6, "&Copy");
     AppendMenu(hMenu, MF_STRING, 7, "&Paste");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_SELECT_ALL, "Select &All\tCtrl+A");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_ADD_CURSOR_ABOVE, "Add Cursor A&bove\tCtrl+Alt+Up");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_ADD_CURSOR_BELOW, "Add Cursor Be&low\tCtrl+Alt+Down");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_ADD_NEXT_OCCURRENCE, "Add &Next Occurrence\tCtrl+D");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_SELECT_ALL_OCCURRENCES, "Select All &Occurrences\tCtrl+Shift+L");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_COMPLETE_WORD, "Complete &Word\tCtrl+Space");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_SORT_LINES, "&Sort Lines");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_UNIQUE_LINES, "Uni&que Lines");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_TRIM_TRAILING_WHITESPACE, "Trim Trailing W&hitespace");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_EXPAND_TABS, "E&xpand Tabs");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_ADD_FINAL_NEWLINE, "Add &Final Newline");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_RECORD_MACRO, "&Record Macro\tCtrl+Shift+R");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_PLAY_MACRO, "&Play Macro\tCtrl+Shift+P");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_PLAY_MACRO_TO_END, "Play Macro to &End of File");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_PLAY_MACRO_ON_LINES, "Play Macro on Selected L&ines");
+    AppendMenu(hMenu, MF_STRING, IDM_EDIT_PLAY_MACRO_ON_MATCHES, "Play Macro on &Matching Lines");
     AppendMenu(hMenubar, MF_POPUP, (UINT_PTR)hMenu, "&Edit");
+
+    // View menu
+    hMenu = CreateMenu();
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_TOGGLE_FOLD, "&Toggle Fold\tCtrl+Shift+[");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_UNFOLD_ALL, "&Unfold All\tCtrl+Shift+]");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_NEXT_FOLD, "&Next Fold\tAlt+Down");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_PREVIOUS_FOLD, "&Previous Fold\tAlt+Up");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_MATCH_BRACKET, "Go to &Matching Bracket\tCtrl+]");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_TOGGLE_BOOKMARK, "Toggle &Bookmark\tCtrl+F2");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_NEXT_BOOKMARK, "Ne&xt Bookmark\tF2");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_PREVIOUS_BOOKMARK, "Pre&vious Bookmark\tShift+F2");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_CLEAR_BOOKMARKS, "&Clear Bookmarks");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_FILTER_LINES, "Show Only &Lines Containing Selection");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_SHOW_ALL_LINES, "Show All L&ines\tEsc");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_GO_TO_TIME, "&Go to Time of Selection");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_SPELL_CHECK, "Check &Spelling");
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_TABLE, "T&able View");
+    AppendMenu(hMenu, MF_STRING, IDM_VIEW_JSON_OUTLINE, "JSON &Outline");
+    AppendMenu(hMenubar, MF_POPUP, (UINT_PTR)hMenu, "&View");
     
     // Help menu
     hMenu = CreateMenu();
+    AppendMenu(hMenu, MF_STRING, IDM_HELP_FRAME_STATS, "&Frame Statistics");
+    AppendMenu(hMenu, MF_STRING, IDM_HELP_MEMORY_USAGE, "&Memory Usage");
     AppendMenu(hMenu, MF_STRING, 8, "&About");
     AppendMenu(hMenubar, MF_POPUP, (UINT_PTR)hMenu, "&Help");
     
     return hMenubar;
 }
 
+/**
+ * @brief Reopens the document recorded by the previous session.
+ *
+ * Restores the caret and scroll position when the file can still be
+ * loaded; otherwise the editor stays on the untitled document.
+ */
+static void RestoreEditorSession(void) {
+    char sessionDir[MAX_PATH];
+    Session session;
+    if (!GetSessionDirectory(sessionDir, sizeof(sessionDir)) || !SessionLoad(sessionDir, &session) ||
+        session.documentCount == 0) {
+        return;
+    }
+
+    const SessionDocument* doc = &session.documents[session.activeDocument];
+    if (EditorLoadFile(g_hEdit, doc->filePath)) {
+        SetEditorViewState(g_hEdit, &doc->view);
+    }
+}
+
+/**
+ * @brief Writes the session manifest and the index sidecar of the open document.
+ *
+ * The sidecar is skipped when the file changed on disk since its indexes
+ * were built, so a stale index is never cached under a fresh key.
+ */
+static void SaveEditorSession(void) {
+    char sessionDir[MAX_PATH];
+    if (!GetSessionDirectory(sessionDir, sizeof(sessionDir))) {
+        return;
+    }
+
+    Session session;
+    ZeroMemory(&session, sizeof(session));
+
+    // Untitled documents have nothing on disk to reopen
+    FileIdentity identity;
+    if (strcmp(g_editorState.currentFilePath, "Untitled") != 0 &&
+        GetFileIdentity(g_editorState.currentFilePath, &identity)) {
+        SessionDocument* doc = &session.documents[0];
+        strcpy_s(doc->filePath, sizeof(doc->filePath), g_editorState.currentFilePath);
+        GetEditorViewState(g_hEdit, &doc->view);
+        session.documentCount = 1;
+
+        Document* document = GetEditorDocument(g_hEdit);
+        if (g_editorState.hasDocumentKey && document &&
+            identity.size == g_editorState.documentKey.identity.size &&
+            identity.mtime == g_editorState.documentKey.identity.mtime) {
+            // Folds are offsets into the current text, so they only match the file while it is unmodified
+            const Fold* folds = NULL;
+            size_t foldCount = DocumentIsModified(document) ? 0 : GetEditorFolds(g_hEdit, &folds);
+            SessionStoreIndexes(sessionDir, g_editorState.currentFilePath, &g_editorState.documentKey,
+                                DocumentOriginalLineIndex(document), folds, foldCount);
+        }
+    }
+
+    SessionSave(sessionDir, &session);
+}
+
 /**
  * @brief Window procedure for the main application window.
  *
@@ -125,6 +289,17 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
             // Create and set the menu bar
             HMENU hMenubar = CreateMenuBar(hWnd);
             SetMenu(hWnd, hMenubar);
+
+            // Saving is a keystroke wherever the focus is, so it is an accelerator, not a view key
+            ACCEL accelerators[] = {
+                { FVIRTKEY | FCONTROL, 'S', 3 },
+                { FVIRTKEY | FCONTROL | FSHIFT, 'S', IDM_FILE_SAVE_AS }
+            };
+            g_hAccelerators = CreateAcceleratorTable(accelerators, (int)(sizeof(accelerators) / sizeof(accelerators[0])));
+            g_hMainWindow = hWnd;
+
+            // Layout and status bar updates are marked and run once per frame
+            FrameSchedulerInit(hWnd, RunFrameWork);
             
             // Create the editor control
             g_hEdit = CreateEditorControl(hWnd, g_hInstance);
@@ -133,6 +308,18 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
                 return -1;
             }
 
+            // The hex view stays hidden until a binary file is opened
+            g_hHexView = CreateHexView(hWnd, g_hInstance);
+
+            // So does the table view until a CSV or TSV file is opened
+            g_hTableView = CreateTableView(hWnd, g_hInstance);
+
+            // Spell checking starts on whenever a dictionary is installed
+            g_spellDict = EditorLoadSpellDictionary();
+            g_spellChecking = g_spellDict && SetEditorSpellChecking(g_hEdit, g_spellDict);
+            CheckMenuItem(hMenubar, IDM_VIEW_SPELL_CHECK, MF_BYCOMMAND | (g_spellChecking ? MF_CHECKED : MF_UNCHECKED));
+            EnableMenuItem(hMenubar, IDM_VIEW_SPELL_CHECK, MF_BYCOMMAND | (g_spellDict ? MF_ENABLED : MF_GRAYED));
+
             // Initialize editor state
             ZeroMemory(&g_editorState, sizeof(EditorState));
             strcpy_s(g_editorState.currentFilePath, MAX_PATH, "Untitled");
@@ -156,14 +343,70 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
             }
 
             // Initial status bar update
-            UpdateStatusBar(g_hStatusBar, &g_editorState);
+            FrameRequest(FRAME_WORK_STATUS);
+
+            // Reopen the previous session once the window has its final size
+            PostMessage(hWnd, WM_EDITOR_RESTORE_SESSION, 0, 0);
 
             break;
         }
 
         case WM_SIZE:
-            HandleWindowResize(hWnd, lParam);
+            // Live resizing sends one per mouse move; the views are placed once per frame
+            FrameRequest(FRAME_WORK_LAYOUT);
+            break;
+
+        case WM_SETFOCUS:
+            // Keyboard input belongs to the view that is shown
+            if (g_editorState.hexMode && g_hHexView) {
+                SetFocus(g_hHexView);
+            } else if (g_editorState.tableMode && g_hTableView) {
+                SetFocus(g_hTableView);
+            } else if (g_hEdit) {
+                SetFocus(g_hEdit);
+            }
             break;
+
+        case WM_EDITOR_RESTORE_SESSION:
+            // The restored view scrolls to its saved line, so it needs its final size first
+            FrameFlush();
+            RestoreEditorSession();
+            break;
+
+        case WM_EDITOR_PROGRESS:
+            if ((int)wParam < 0) {
+                g_progressText[0] = '\0';
+            } else {
+                sprintf_s(g_progressText, sizeof(g_progressText), "%s: %d%% - press Esc or click here to cancel",
+                          lParam ? (const char*)lParam : "Working", (int)wParam);
+            }
+            FrameRequest(FRAME_WORK_STATUS);
+            break;
+
+        case WM_EDITOR_MACRO_RECORDING:
+            CheckMenuItem(GetMenu(hWnd), IDM_EDIT_RECORD_MACRO, MF_BYCOMMAND | (wParam ? MF_CHECKED : MF_UNCHECKED));
+            strcpy_s(g_progressText, sizeof(g_progressText), wParam ? "Recording macro - press Ctrl+Shift+R to stop" : "");
+            FrameRequest(FRAME_WORK_STATUS);
+            break;
+
+        case WM_EDITOR_SAVE_PROGRESS:
+            sprintf_s(g_progressText, sizeof(g_progressText), "Saving: %d%%", (int)wParam);
+            FrameRequest(FRAME_WORK_STATUS);
+            break;
+
+        case WM_EDITOR_SAVE_DONE:
+            g_progressText[0] = '\0';
+            EditorFinishSave(hWnd, g_hEdit);
+            break;
+
+        case WM_NOTIFY: {
+            // A click on the status bar cancels the task it shows
+            const NMHDR* header = (const NMHDR*)lParam;
+            if (header->idFrom == ID_STATUSBAR && header->code == NM_CLICK) {
+                ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_CANCEL_SORT);
+            }
+            break;
+        }
             
         case WM_COMMAND: {
             int wmId = LOWORD(wParam);
@@ -181,7 +424,27 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
                 case 3: // File -> Save
                     EditorSaveFile(hWnd, g_hEdit);
                     break;
+
+                case IDM_FILE_SAVE_AS:
+                    EditorSaveFileAs(hWnd, g_hEdit);
+                    break;
                     
+                case IDM_FILE_COMPARE_SAVED:
+                    EditorCompareWithSaved(hWnd, g_hEdit);
+                    break;
+
+                case IDM_FILE_FORMAT_TRIM_TRAILING:
+                case IDM_FILE_FORMAT_EXPAND_TABS:
+                case IDM_FILE_FORMAT_FINAL_NEWLINE: {
+                    unsigned stage = wmId == IDM_FILE_FORMAT_TRIM_TRAILING ? TEXT_FORMAT_TRIM_TRAILING
+                                   : wmId == IDM_FILE_FORMAT_EXPAND_TABS ? TEXT_FORMAT_EXPAND_TABS
+                                   : TEXT_FORMAT_FINAL_NEWLINE;
+                    g_editorState.formatOnSave ^= stage;
+                    CheckMenuItem(GetMenu(hWnd), wmId,
+                                  MF_BYCOMMAND | ((g_editorState.formatOnSave & stage) ? MF_CHECKED : MF_UNCHECKED));
+                    break;
+                }
+
                 case 4: // File -> Exit
                     DestroyWindow(hWnd);
                     break;
@@ -204,6 +467,180 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
                     }
                     break;
                     
+                case IDM_EDIT_UNDO:
+                    if (g_editorState.hexMode) {
+                        SendMessage(g_hHexView, WM_UNDO, 0, 0);
+                    } else {
+                        ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_UNDO);
+                    }
+                    break;
+
+                case IDM_EDIT_REDO:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_REDO);
+                    break;
+
+                case IDM_EDIT_SELECT_ALL:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_SELECT_ALL);
+                    break;
+
+                case IDM_EDIT_ADD_CURSOR_ABOVE:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_ADD_CURSOR_ABOVE);
+                    break;
+
+                case IDM_EDIT_ADD_CURSOR_BELOW:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_ADD_CURSOR_BELOW);
+                    break;
+
+                case IDM_EDIT_ADD_NEXT_OCCURRENCE:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_ADD_NEXT_OCCURRENCE);
+                    break;
+
+                case IDM_EDIT_SELECT_ALL_OCCURRENCES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_SELECT_ALL_OCCURRENCES);
+                    break;
+
+                case IDM_EDIT_COMPLETE_WORD:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_COMPLETE_WORD);
+                    break;
+
+                case IDM_EDIT_SORT_LINES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_SORT_LINES);
+                    break;
+
+                case IDM_EDIT_UNIQUE_LINES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_UNIQUE_LINES);
+                    break;
+
+                case IDM_EDIT_TRIM_TRAILING_WHITESPACE:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_TRIM_TRAILING_WHITESPACE);
+                    break;
+
+                case IDM_EDIT_EXPAND_TABS:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_EXPAND_TABS);
+                    break;
+
+                case IDM_EDIT_ADD_FINAL_NEWLINE:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_ADD_FINAL_NEWLINE);
+                    break;
+
+                case IDM_EDIT_RECORD_MACRO:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_RECORD_MACRO);
+                    break;
+
+                case IDM_EDIT_PLAY_MACRO:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_PLAY_MACRO);
+                    break;
+
+                case IDM_EDIT_PLAY_MACRO_TO_END:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_PLAY_MACRO_TO_END);
+                    break;
+
+                case IDM_EDIT_PLAY_MACRO_ON_LINES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_PLAY_MACRO_ON_LINES);
+                    break;
+
+                case IDM_EDIT_PLAY_MACRO_ON_MATCHES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_PLAY_MACRO_ON_MATCHES);
+                    break;
+
+                case IDM_VIEW_TOGGLE_FOLD:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_TOGGLE_FOLD);
+                    break;
+
+                case IDM_VIEW_UNFOLD_ALL:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_UNFOLD_ALL);
+                    break;
+
+                case IDM_VIEW_NEXT_FOLD:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_NEXT_FOLD);
+                    break;
+
+                case IDM_VIEW_PREVIOUS_FOLD:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_PREVIOUS_FOLD);
+                    break;
+
+                case IDM_VIEW_MATCH_BRACKET:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_MATCH_BRACKET);
+                    break;
+
+                case IDM_VIEW_TOGGLE_BOOKMARK:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_TOGGLE_BOOKMARK);
+                    break;
+
+                case IDM_VIEW_NEXT_BOOKMARK:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_NEXT_BOOKMARK);
+                    break;
+
+                case IDM_VIEW_PREVIOUS_BOOKMARK:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_PREVIOUS_BOOKMARK);
+                    break;
+
+                case IDM_VIEW_CLEAR_BOOKMARKS:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_CLEAR_BOOKMARKS);
+                    break;
+
+                case IDM_VIEW_FILTER_LINES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_FILTER_LINES);
+                    break;
+
+                case IDM_VIEW_SHOW_ALL_LINES:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_SHOW_ALL_LINES);
+                    break;
+
+                case IDM_VIEW_GO_TO_TIME:
+                    ExecuteEditorCommand(g_hEdit, EDITOR_COMMAND_GO_TO_TIME);
+                    break;
+
+                case IDM_VIEW_SPELL_CHECK:
+                    if (g_spellDict && SetEditorSpellChecking(g_hEdit, g_spellChecking ? NULL : g_spellDict)) {
+                        g_spellChecking = !g_spellChecking;
+                        CheckMenuItem(GetMenu(hWnd), IDM_VIEW_SPELL_CHECK,
+                                      MF_BYCOMMAND | (g_spellChecking ? MF_CHECKED : MF_UNCHECKED));
+                    }
+                    break;
+
+                case IDM_VIEW_TABLE:
+                    // Binary files have no document to show as a table
+                    if (!g_editorState.hexMode && !ShowTableView(!g_editorState.tableMode)) {
+                        MessageBeep(MB_ICONWARNING);
+                    }
+                    break;
+
+                case IDM_VIEW_JSON_OUTLINE:
+                    if (!g_editorState.hexMode) {
+                        OpenJsonOutline(hWnd);
+                    }
+                    break;
+
+                case IDM_HELP_FRAME_STATS: {
+                    FrameStats stats;
+                    FrameGetStats(&stats);
+                    char statsMsg[256];
+                    sprintf_s(statsMsg, sizeof(statsMsg),
+                              "Frames: %llu\nInput messages followed by a paint: %llu\n\n"
+                              "Input-to-paint latency\nLast: %.2f ms\nAverage: %.2f ms\nMaximum: %.2f ms",
+                              stats.frames, stats.samples, stats.lastLatencyMs, stats.averageLatencyMs,
+                              stats.maxLatencyMs);
+                    MessageBox(hWnd, statsMsg, "Frame Statistics", MB_OK | MB_ICONINFORMATION);
+                    break;
+                }
+
+                case IDM_HELP_MEMORY_USAGE: {
+                    char usageMsg[2048];
+                    size_t length = MemoryFormatReport(MEMORY_REPORT_TEXT, usageMsg, sizeof(usageMsg));
+                    if (length < sizeof(usageMsg)) {
+                        strcat_s(usageMsg, sizeof(usageMsg), "\nCopy the report to the clipboard as JSON?");
+                    }
+                    if (MessageBox(hWnd, usageMsg, "Memory Usage", MB_YESNO | MB_ICONINFORMATION) == IDYES) {
+                        char report[2048];
+                        length = MemoryFormatReport(MEMORY_REPORT_JSON, report, sizeof(report));
+                        if (length >= sizeof(report) || !ClipboardSetText(hWnd, report, length)) {
+                            MessageBox(hWnd, "The report could not be copied.", "Memory Usage", MB_OK | MB_ICONERROR);
+                        }
+                    }
+                    break;
+                }
+
                 case 8: // Help -> About
                     {
                         char aboutMsg[256];
@@ -220,6 +657,21 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPara
         }
         
         case WM_DESTROY:
+            // A save in progress is finished before the document goes away
+            EditorWaitForSave(hWnd, g_hEdit);
+            DestroyAcceleratorTable(g_hAccelerators);
+            g_hAccelerators = NULL;
+            FrameSchedulerShutdown();
+            g_hMainWindow = NULL;
+            // Child controls still exist here, so the caret can be captured
+            SaveEditorSession();
+            // The view's checker reads the dictionary until it is stopped
+            SetEditorSpellChecking(g_hEdit, NULL);
+            SpellDictClose(g_spellDict);
+            g_spellDict = NULL;
+            // The table view and the outline read the document the editor view destroys
+            ShowTableView(FALSE);
+            CloseJsonOutline();
             PostQuitMessage(0);
             break;
             
@@ -249,15 +701,98 @@ void HandleWindowResize(HWND hWnd, LPARAM lParam) {
         statusBarHeight = statusBarRect.bottom - statusBarRect.top;
     }
 
-    // Resize the edit control to fill the remaining client area
-    if (g_hEdit) {
-        int clientWidth = LOWORD(lParam);
-        int clientHeight = HIWORD(lParam);
-        int editHeight = clientHeight - statusBarHeight;
-        if (editHeight < 0) editHeight = 0; // Prevent negative height
+    // Resize the edit control and the other views to fill the remaining client area
+    int clientWidth = LOWORD(lParam);
+    int clientHeight = HIWORD(lParam);
+    int editHeight = clientHeight - statusBarHeight;
+    if (editHeight < 0) editHeight = 0; // Prevent negative height
 
+    if (g_hEdit) {
         SetWindowPos(g_hEdit, NULL, 0, 0, clientWidth, editHeight, SWP_NOZORDER);
     }
+    if (g_hHexView) {
+        SetWindowPos(g_hHexView, NULL, 0, 0, clientWidth, editHeight, SWP_NOZORDER);
+    }
+    if (g_hTableView) {
+        SetWindowPos(g_hTableView, NULL, 0, 0, clientWidth, editHeight, SWP_NOZORDER);
+    }
+}
+
+/**
+ * @brief Switches between the editor view and the hex view.
+ *
+ * @param show TRUE to show the hex view, FALSE to show the editor view.
+ */
+void ShowHexView(BOOL show) {
+    if (!g_hHexView || !g_hEdit) {
+        return;
+    }
+    g_editorState.hexMode = show;
+    ShowWindow(show ? g_hHexView : g_hEdit, SW_SHOW);
+    ShowWindow(show ? g_hEdit : g_hHexView, SW_HIDE);
+    SetFocus(show ? g_hHexView : g_hEdit);
+}
+
+/**
+ * @brief Switches between the editor view and the table view of the document.
+ *
+ * Files named .tsv are split at tabs; the delimiter of other files is
+ * guessed from their first lines.
+ *
+ * @param show TRUE to show the table view, FALSE to show the editor view.
+ * @return TRUE if the requested view is shown, FALSE otherwise.
+ */
+BOOL ShowTableView(BOOL show) {
+    if (!g_hTableView || !g_hEdit) {
+        return FALSE;
+    }
+    if (show) {
+        const char* extension = PathFindExtension(g_editorState.currentFilePath);
+        char delimiter = _stricmp(extension, ".tsv") == 0 ? '\t' : 0;
+        if (!SetTableViewDocument(g_hTableView, GetEditorDocument(g_hEdit), delimiter)) {
+            return FALSE;
+        }
+    } else if (!g_editorState.tableMode) {
+        return TRUE;
+    } else {
+        SetTableViewDocument(g_hTableView, NULL, 0);
+    }
+
+    g_editorState.tableMode = show;
+    ShowWindow(show ? g_hTableView : g_hEdit, SW_SHOW);
+    ShowWindow(show ? g_hEdit : g_hTableView, SW_HIDE);
+    SetFocus(show ? g_hTableView : g_hEdit);
+    CheckMenuItem(GetMenu(GetParent(g_hTableView)), IDM_VIEW_TABLE, MF_BYCOMMAND | (show ? MF_CHECKED : MF_UNCHECKED));
+    FrameRequest(FRAME_WORK_STATUS);
+    return TRUE;
+}
+
+/**
+ * @brief Opens the JSON outline of the document, or activates it if it is open.
+ *
+ * @param hWnd Handle to the main window.
+ */
+void OpenJsonOutline(HWND hWnd) {
+    if (g_hJsonOutline && IsWindow(g_hJsonOutline)) {
+        SetActiveWindow(g_hJsonOutline);
+        return;
+    }
+    g_hJsonOutline = ShowJsonOutline(hWnd, g_hInstance, g_hEdit);
+    if (!g_hJsonOutline) {
+        MessageBox(hWnd, "Failed to open the outline.", "Error", MB_OK | MB_ICONERROR);
+    }
+}
+
+/**
+ * @brief Closes the JSON outline if it is open.
+ *
+ * Called before the document of the editor view is replaced.
+ */
+void CloseJsonOutline(void) {
+    if (g_hJsonOutline && IsWindow(g_hJsonOutline)) {
+        DestroyWindow(g_hJsonOutline);
+    }
+    g_hJsonOutline = NULL;
 }
 
 /**
@@ -275,9 +810,10 @@ void UpdateStatusBar(HWND hStatusBar, const EditorState* state) {
     char* fileName = PathFindFileName(state->currentFilePath); // Extract just the filename
 
     // Format the status text
-    sprintf_s(statusText, sizeof(statusText), "File: %s | Size: %ld bytes",
+    sprintf_s(statusText, sizeof(statusText), "File: %s | Size: %llu bytes%s",
               fileName ? fileName : "Untitled", // Show "Untitled" if path is empty or invalid
-              state->currentFileSize);
+              (unsigned long long)state->currentFileSize,
+              state->hexMode ? " | Hex" : state->tableMode ? " | Table" : "");
 
     // Set the text in the first part of the status bar
     SendMessage(hStatusBar, SB_SETTEXT, 0, (LPARAM)statusText);
@@ -0,0 +1,1359 @@
+/**
+ * @file wordindex.c
+ * @brief Identifier index implementation for the Professional Text Editor
+ *
+ * Contains the intern table, the per-block identifier counts, the sorted
+ * order with its tree of maximum counts and the parallel build. Every block
+ * remembers how often each identifier occurs in it, so an edit subtracts
+ * the counts of the blocks it touches and adds the counts of their rescan
+ * without reading any text outside them.
+ */
+
+#include "../include/wordindex.h"
+#include "../include/hash.h"
+#include "../include/memory.h"
+#include "../include/thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes after which a block ends at the next line break
+#define WORD_BLOCK_TARGET (16 * 1024)
+
+// Bytes after which a rescanned block is split again; larger than the
+// target so that typing inside a block does not change the block count
+#define WORD_BLOCK_SPLIT (4 * WORD_BLOCK_TARGET)
+
+// Bytes after which a block inside a very long line ends at the next byte outside an identifier
+#define WORD_BLOCK_MAX (256 * 1024)
+
+// Smallest part of the file given to a build thread
+#define WORD_BUILD_MIN_PART (1024 * 1024)
+
+// Most threads used by a build
+#define WORD_BUILD_MAX_THREADS 64
+
+// New identifiers kept outside the sorted order before it is merged again:
+// at least WORD_PENDING_MIN, or one per WORD_PENDING_RATIO sorted identifiers
+#define WORD_PENDING_MIN 256
+#define WORD_PENDING_RATIO 64
+
+// Rank of an identifier waiting in the pending list
+#define WORD_PENDING UINT32_MAX
+
+// Rank of an identifier in neither the sorted order nor the pending list
+#define WORD_UNLISTED (UINT32_MAX - 1)
+
+// Identifier returned when interning fails
+#define WORD_NONE UINT32_MAX
+
+#define WORD_HASH_SEED 0x776f7264u
+
+// Interned identifier
+typedef struct {
+    size_t text;            // Offset in the pool
+    uint32_t length;
+    uint32_t hash;
+    uint32_t count;         // Occurrences in the document
+    uint32_t rank;          // Position in the sorted order, WORD_PENDING or WORD_UNLISTED
+    uint32_t mark;          // Block in which blockCount was last reset
+    uint32_t blockCount;    // Occurrences in the block being scanned
+} WordEntry;
+
+// Intern table mapping identifier text to dense numbers
+typedef struct {
+    WordEntry* entries;
+    size_t count;
+    size_t capacity;
+    char* pool;             // Text of all identifiers, back to back
+    size_t poolSize;
+    size_t poolCapacity;
+    uint32_t* slots;        // Open addressing table of entry index + 1; 0 is empty
+    size_t slotCount;       // Power of two
+    uint32_t mark;          // Number of the block being scanned
+} WordTable;
+
+// Occurrences of one identifier in a block
+typedef struct {
+    uint32_t word;
+    uint32_t count;
+} WordCount;
+
+// Run of lines with the identifiers that occur in it
+typedef struct {
+    uint64_t length;
+    WordCount* counts;
+    uint32_t countCount;
+} WordBlock;
+
+// Growable list of blocks
+typedef struct {
+    WordBlock* items;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} BlockList;
+
+// Tokenizer state carried from byte to byte and across iterator pieces
+typedef struct {
+    WordTable* table;
+    BlockList* blocks;
+    uint64_t splitAt;       // Bytes after which a block ends at the next line break
+    uint64_t blockLength;
+    uint32_t* words;        // Distinct identifiers of the current block
+    size_t wordCount;
+    size_t wordCapacity;
+    char text[WORD_INDEX_MAX_LENGTH];
+    size_t textLength;      // Length of the current run; may exceed the buffer
+    bool failed;
+} WordScanner;
+
+struct WordIndex {
+    Document* document;
+    bool built;
+    WordTable table;
+    BlockList blocks;
+    uint64_t length;        // Bytes covered by the blocks
+    uint32_t* sorted;       // Listed identifiers in case-insensitive order
+    size_t sortedCount;
+    uint32_t* tree;         // Maximum count per node; node 1 is the root, leaves start at treeBase
+    size_t treeBase;        // Power of two >= sortedCount
+    uint32_t* pending;      // Identifiers added since the last merge, unordered
+    size_t pendingCount;
+    size_t pendingCapacity;
+};
+
+// Identifier with its text, sorted with qsort
+typedef struct {
+    const char* text;
+    uint32_t length;
+    uint32_t word;
+} WordKey;
+
+// Node of the tree waiting to be visited by a completion query
+typedef struct {
+    uint32_t max;
+    size_t node;
+    size_t width;           // Leaves below the node
+} CompletionNode;
+
+// Nodes waiting to be visited, as a binary heap
+typedef struct {
+    CompletionNode* items;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} CompletionHeap;
+
+// Part of the mapped file scanned by one build thread
+typedef struct {
+    const char* text;
+    size_t length;
+    WordTable table;
+    BlockList blocks;
+    bool failed;
+} BuildPart;
+
+// Walk over the original runs deciding whether the document is still the mapped file
+typedef struct {
+    uint64_t next;          // Offset the next run must start at
+    bool unmodified;
+} OriginalCheck;
+
+/**
+ * @brief Checks whether a byte can be part of an identifier.
+ *
+ * @param c The byte.
+ * @return true for ASCII letters, digits, underscores and bytes >= 0x80, false otherwise.
+ */
+static inline bool IsWordByte(char c) {
+    unsigned char u = (unsigned char)c;
+    return u >= 0x80 || (unsigned)((u | 0x20) - 'a') < 26 || (unsigned)(u - '0') < 10 || u == '_';
+}
+
+/**
+ * @brief Folds an ASCII letter to lower case.
+ *
+ * @param c The byte.
+ * @return The folded byte.
+ */
+static inline unsigned char FoldByte(char c) {
+    unsigned char u = (unsigned char)c;
+    return (u >= 'A' && u <= 'Z') ? (unsigned char)(u | 0x20) : u;
+}
+
+/**
+ * @brief Compares two identifiers ignoring ASCII case, then by their bytes.
+ *
+ * @param a First identifier.
+ * @param aLength Length of the first identifier.
+ * @param b Second identifier.
+ * @param bLength Length of the second identifier.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int CompareText(const char* a, size_t aLength, const char* b, size_t bLength) {
+    size_t common = aLength < bLength ? aLength : bLength;
+    for (size_t i = 0; i < common; i++) {
+        unsigned char fa = FoldByte(a[i]);
+        unsigned char fb = FoldByte(b[i]);
+        if (fa != fb) {
+            return fa < fb ? -1 : 1;
+        }
+    }
+    if (aLength != bLength) {
+        return aLength < bLength ? -1 : 1;
+    }
+    return memcmp(a, b, common);
+}
+
+/**
+ * @brief Compares the start of an identifier with a prefix ignoring ASCII case.
+ *
+ * @param text The identifier.
+ * @param length Length of the identifier.
+ * @param prefix The prefix.
+ * @param prefixLength Length of the prefix.
+ * @return Negative if the identifier sorts before every match, zero if it
+ *         starts with the prefix, positive if it sorts after every match.
+ */
+static int ComparePrefix(const char* text, size_t length, const char* prefix, size_t prefixLength) {
+    size_t common = length < prefixLength ? length : prefixLength;
+    for (size_t i = 0; i < common; i++) {
+        unsigned char a = FoldByte(text[i]);
+        unsigned char b = FoldByte(prefix[i]);
+        if (a != b) {
+            return a < b ? -1 : 1;
+        }
+    }
+    return length < prefixLength ? -1 : 0;
+}
+
+/**
+ * @brief qsort comparator for identifier keys.
+ */
+static int CompareKeys(const void* a, const void* b) {
+    const WordKey* ka = (const WordKey*)a;
+    const WordKey* kb = (const WordKey*)b;
+    return CompareText(ka->text, ka->length, kb->text, kb->length);
+}
+
+/**
+ * @brief qsort comparator ordering completions by count, then alphabetically.
+ */
+static int CompareCompletions(const void* a, const void* b) {
+    const WordCompletion* ca = (const WordCompletion*)a;
+    const WordCompletion* cb = (const WordCompletion*)b;
+    if (ca->count != cb->count) {
+        return ca->count > cb->count ? -1 : 1;
+    }
+    return CompareText(ca->text, ca->length, cb->text, cb->length);
+}
+
+/**
+ * @brief Releases the memory of an intern table.
+ *
+ * @param table The table.
+ */
+static void TableFree(WordTable* table) {
+    MemoryFree(table->entries);
+    MemoryFree(table->pool);
+    MemoryFree(table->slots);
+    memset(table, 0, sizeof(WordTable));
+}
+
+/**
+ * @brief Doubles the slot array of an intern table.
+ *
+ * @param table The table.
+ * @return true if successful, false on allocation failure.
+ */
+static bool TableGrowSlots(WordTable* table) {
+    size_t slotCount = table->slotCount ? table->slotCount * 2 : 1024;
+    uint32_t* slots = (uint32_t*)MemoryCalloc(MEMORY_TAG_WORDS, slotCount, sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    for (size_t i = 0; i < table->count; i++) {
+        size_t slot = table->entries[i].hash & (slotCount - 1);
+        while (slots[slot]) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = (uint32_t)i + 1;
+    }
+    MemoryFree(table->slots);
+    table->slots = slots;
+    table->slotCount = slotCount;
+    return true;
+}
+
+/**
+ * @brief Finds an identifier in an intern table, adding it if it is new.
+ *
+ * New identifiers start with a count of 0 and are unlisted.
+ *
+ * @param table The table.
+ * @param text The identifier.
+ * @param length Length of the identifier.
+ * @param hash Hash of the identifier.
+ * @return The identifier's number, or WORD_NONE on allocation failure.
+ */
+static uint32_t TableIntern(WordTable* table, const char* text, size_t length, uint32_t hash) {
+    if ((table->count + 1) * 2 > table->slotCount && !TableGrowSlots(table)) {
+        return WORD_NONE;
+    }
+
+    size_t mask = table->slotCount - 1;
+    size_t slot = hash & mask;
+    for (; table->slots[slot]; slot = (slot + 1) & mask) {
+        const WordEntry* entry = &table->entries[table->slots[slot] - 1];
+        if (entry->hash == hash && entry->length == length && memcmp(table->pool + entry->text, text, length) == 0) {
+            return table->slots[slot] - 1;
+        }
+    }
+
+    if (table->count >= WORD_UNLISTED - 1) {
+        return WORD_NONE;
+    }
+    if (table->count == table->capacity) {
+        size_t newCapacity = table->capacity ? table->capacity * 2 : 1024;
+        WordEntry* newEntries = (WordEntry*)MemoryRealloc(MEMORY_TAG_WORDS, table->entries,
+                                                          newCapacity * sizeof(WordEntry));
+        if (!newEntries) {
+            return WORD_NONE;
+        }
+        table->entries = newEntries;
+        table->capacity = newCapacity;
+    }
+    if (table->poolSize + length > table->poolCapacity) {
+        size_t newCapacity = table->poolCapacity ? table->poolCapacity * 2 : 16 * 1024;
+        while (newCapacity < table->poolSize + length) {
+            newCapacity *= 2;
+        }
+        char* newPool = (char*)MemoryRealloc(MEMORY_TAG_WORDS, table->pool, newCapacity);
+        if (!newPool) {
+            return WORD_NONE;
+        }
+        table->pool = newPool;
+        table->poolCapacity = newCapacity;
+    }
+
+    uint32_t word = (uint32_t)table->count++;
+    WordEntry* entry = &table->entries[word];
+    memset(entry, 0, sizeof(WordEntry));
+    entry->text = table->poolSize;
+    entry->length = (uint32_t)length;
+    entry->hash = hash;
+    entry->rank = WORD_UNLISTED;
+    memcpy(table->pool + table->poolSize, text, length);
+    table->poolSize += length;
+    table->slots[slot] = word + 1;
+    return word;
+}
+
+/**
+ * @brief Releases the blocks of a list and the list itself.
+ *
+ * @param list The list.
+ */
+static void BlockListFree(BlockList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        MemoryFree(list->items[i].counts);
+    }
+    MemoryFree(list->items);
+    memset(list, 0, sizeof(BlockList));
+}
+
+/**
+ * @brief Appends a block to a list, taking ownership of its counts.
+ *
+ * @param list The list.
+ * @param block The block.
+ */
+static void BlockListPush(BlockList* list, const WordBlock* block) {
+    if (list->failed) {
+        MemoryFree(block->counts);
+        return;
+    }
+    if (list->count == list->capacity) {
+        size_t newCapacity = list->capacity ? list->capacity * 2 : 64;
+        WordBlock* newItems = (WordBlock*)MemoryRealloc(MEMORY_TAG_WORDS, list->items, newCapacity * sizeof(WordBlock));
+        if (!newItems) {
+            MemoryFree(block->counts);
+            list->failed = true;
+            return;
+        }
+        list->items = newItems;
+        list->capacity = newCapacity;
+    }
+    list->items[list->count++] = *block;
+}
+
+/**
+ * @brief Prepares a scanner that adds blocks to a list.
+ *
+ * @param scanner The scanner.
+ * @param table The table the identifiers are interned in.
+ * @param blocks The list receiving the blocks.
+ * @param splitAt Bytes after which a block ends at the next line break.
+ */
+static void ScannerInit(WordScanner* scanner, WordTable* table, BlockList* blocks, uint64_t splitAt) {
+    memset(scanner, 0, sizeof(WordScanner));
+    scanner->table = table;
+    scanner->blocks = blocks;
+    scanner->splitAt = splitAt;
+    if (table->mark == 0) {
+        table->mark = 1;    // New entries carry mark 0
+    }
+}
+
+/**
+ * @brief Counts the run of identifier bytes that just ended.
+ *
+ * Runs that start with a digit, are a single byte or are too long to be
+ * completed are not counted.
+ *
+ * @param scanner The scanner.
+ */
+static void ScannerFinishWord(WordScanner* scanner) {
+    size_t length = scanner->textLength;
+    scanner->textLength = 0;
+    if (length < 2 || length > WORD_INDEX_MAX_LENGTH || (scanner->text[0] >= '0' && scanner->text[0] <= '9')) {
+        return;
+    }
+
+    WordTable* table = scanner->table;
+    uint32_t hash = (uint32_t)HashBytes64(scanner->text, length, WORD_HASH_SEED);
+    uint32_t word = TableIntern(table, scanner->text, length, hash);
+    if (word == WORD_NONE) {
+        scanner->failed = true;
+        return;
+    }
+
+    WordEntry* entry = &table->entries[word];
+    if (entry->mark != table->mark) {
+        if (scanner->wordCount == scanner->wordCapacity) {
+            size_t newCapacity = scanner->wordCapacity ? scanner->wordCapacity * 2 : 256;
+            uint32_t* newWords = (uint32_t*)MemoryRealloc(MEMORY_TAG_WORDS, scanner->words,
+                                                          newCapacity * sizeof(uint32_t));
+            if (!newWords) {
+                scanner->failed = true;
+                return;
+            }
+            scanner->words = newWords;
+            scanner->wordCapacity = newCapacity;
+        }
+        scanner->words[scanner->wordCount++] = word;
+        entry->mark = table->mark;
+        entry->blockCount = 0;
+    }
+    entry->blockCount++;
+}
+
+/**
+ * @brief Ends the current block and appends it with its identifier counts.
+ *
+ * @param scanner The scanner.
+ */
+static void ScannerFinishBlock(WordScanner* scanner) {
+    WordBlock block = { scanner->blockLength, NULL, 0 };
+    if (scanner->wordCount > 0) {
+        block.counts = (WordCount*)MemoryAlloc(MEMORY_TAG_WORDS, scanner->wordCount * sizeof(WordCount));
+        if (!block.counts) {
+            scanner->failed = true;
+        } else {
+            for (size_t i = 0; i < scanner->wordCount; i++) {
+                block.counts[i].word = scanner->words[i];
+                block.counts[i].count = scanner->table->entries[scanner->words[i]].blockCount;
+            }
+            block.countCount = (uint32_t)scanner->wordCount;
+        }
+    }
+    BlockListPush(scanner->blocks, &block);
+
+    scanner->table->mark++;
+    scanner->blockLength = 0;
+    scanner->wordCount = 0;
+}
+
+/**
+ * @brief Scans bytes into blocks.
+ *
+ * Blocks only end after a byte outside identifiers, so a block can be
+ * rescanned without looking at its neighbors.
+ *
+ * @param scanner The scanner.
+ * @param data The bytes.
+ * @param length Number of bytes.
+ */
+static void ScannerFeed(WordScanner* scanner, const char* data, size_t length) {
+    uint64_t blockBase = scanner->blockLength;  // Bytes of the current block before data[blockOrigin]
+    size_t blockOrigin = 0;
+    size_t i = 0;
+
+    while (i < length) {
+        size_t runStart = i;
+        while (i < length && IsWordByte(data[i])) {
+            i++;
+        }
+        if (i > runStart) {
+            if (scanner->textLength < WORD_INDEX_MAX_LENGTH) {
+                size_t room = WORD_INDEX_MAX_LENGTH - scanner->textLength;
+                size_t copy = i - runStart < room ? i - runStart : room;
+                memcpy(scanner->text + scanner->textLength, data + runStart, copy);
+            }
+            scanner->textLength += i - runStart;
+            if (i == length) {
+                break;  // The run may continue in the next piece
+            }
+        }
+        if (scanner->textLength > 0) {
+            ScannerFinishWord(scanner);
+        }
+
+        char c = data[i++];
+        uint64_t blockLength = blockBase + (i - blockOrigin);
+        if ((c == '\n' && blockLength >= scanner->splitAt) || blockLength >= WORD_BLOCK_MAX) {
+            scanner->blockLength = blockLength;
+            ScannerFinishBlock(scanner);
+            blockBase = 0;
+            blockOrigin = i;
+        }
+    }
+    scanner->blockLength = blockBase + (length - blockOrigin);
+}
+
+/**
+ * @brief Ends the scanned text, appending the last block if it is not empty.
+ *
+ * @param scanner The scanner.
+ */
+static void ScannerFlush(WordScanner* scanner) {
+    if (scanner->textLength > 0) {
+        ScannerFinishWord(scanner);
+    }
+    if (scanner->blockLength > 0) {
+        ScannerFinishBlock(scanner);
+    }
+}
+
+/**
+ * @brief Scans a range of the document into blocks.
+ *
+ * The range must start at a block boundary.
+ *
+ * @param document The document.
+ * @param start Start of the range.
+ * @param end End of the range.
+ * @param scanner The scanner.
+ */
+static void ScanDocument(const Document* document, uint64_t start, uint64_t end, WordScanner* scanner) {
+    DocumentIterator iterator;
+    DocumentIterInit(document, start, &iterator);
+    uint64_t position = start;
+    const char* data;
+    size_t length;
+
+    while (position < end && DocumentIterNext(&iterator, &data, &length)) {
+        if (length > end - position) {
+            length = (size_t)(end - position);
+        }
+        ScannerFeed(scanner, data, length);
+        position += length;
+    }
+    ScannerFlush(scanner);
+}
+
+/**
+ * @brief Adds or subtracts the identifier counts of a block.
+ *
+ * The tree is not updated; see SyncCounts.
+ *
+ * @param index The index.
+ * @param block The block.
+ * @param add true to add the counts, false to subtract them.
+ */
+static void AddCounts(WordIndex* index, const WordBlock* block, bool add) {
+    WordEntry* entries = index->table.entries;
+    for (uint32_t i = 0; i < block->countCount; i++) {
+        if (add) {
+            entries[block->counts[i].word].count += block->counts[i].count;
+        } else {
+            entries[block->counts[i].word].count -= block->counts[i].count;
+        }
+    }
+}
+
+/**
+ * @brief Brings the tree and the pending list in line with the counts of
+ *        the identifiers in a block.
+ *
+ * @param index The index.
+ * @param block The block.
+ * @return true if successful, false on allocation failure.
+ */
+static bool SyncCounts(WordIndex* index, const WordBlock* block) {
+    for (uint32_t i = 0; i < block->countCount; i++) {
+        uint32_t word = block->counts[i].word;
+        WordEntry* entry = &index->table.entries[word];
+        if (entry->rank == WORD_PENDING) {
+            continue;
+        }
+        if (entry->rank == WORD_UNLISTED) {
+            if (entry->count == 0) {
+                continue;
+            }
+            if (index->pendingCount == index->pendingCapacity) {
+                size_t newCapacity = index->pendingCapacity ? index->pendingCapacity * 2 : WORD_PENDING_MIN;
+                uint32_t* newPending = (uint32_t*)MemoryRealloc(MEMORY_TAG_WORDS, index->pending,
+                                                                newCapacity * sizeof(uint32_t));
+                if (!newPending) {
+                    return false;
+                }
+                index->pending = newPending;
+                index->pendingCapacity = newCapacity;
+            }
+            index->pending[index->pendingCount++] = word;
+            entry->rank = WORD_PENDING;
+            continue;
+        }
+
+        size_t node = index->treeBase + entry->rank;
+        if (index->tree[node] == entry->count) {
+            continue;
+        }
+        index->tree[node] = entry->count;
+        for (node /= 2; node >= 1; node /= 2) {
+            uint32_t left = index->tree[2 * node];
+            uint32_t right = index->tree[2 * node + 1];
+            uint32_t max = left > right ? left : right;
+            if (index->tree[node] == max) {
+                break;
+            }
+            index->tree[node] = max;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Merges the pending identifiers into the sorted order and rebuilds the tree.
+ *
+ * Identifiers that no longer occur in the document are dropped from both.
+ *
+ * @param index The index.
+ * @return true if successful, false on allocation failure.
+ */
+static bool MergePending(WordIndex* index) {
+    WordEntry* entries = index->table.entries;
+    const char* pool = index->table.pool;
+
+    WordKey* keys = (WordKey*)MemoryAlloc(MEMORY_TAG_WORDS,
+                                          (index->pendingCount ? index->pendingCount : 1) * sizeof(WordKey));
+    uint32_t* sorted = (uint32_t*)MemoryAlloc(MEMORY_TAG_WORDS,
+                                              (index->sortedCount + index->pendingCount + 1) * sizeof(uint32_t));
+    if (!keys || !sorted) {
+        MemoryFree(keys);
+        MemoryFree(sorted);
+        return false;
+    }
+
+    size_t keyCount = 0;
+    for (size_t i = 0; i < index->pendingCount; i++) {
+        WordEntry* entry = &entries[index->pending[i]];
+        if (entry->count == 0) {
+            entry->rank = WORD_UNLISTED;
+            continue;
+        }
+        keys[keyCount].text = pool + entry->text;
+        keys[keyCount].length = entry->length;
+        keys[keyCount].word = index->pending[i];
+        keyCount++;
+    }
+    qsort(keys, keyCount, sizeof(WordKey), CompareKeys);
+
+    size_t count = 0;
+    size_t next = 0;
+    for (size_t i = 0; i < index->sortedCount; i++) {
+        uint32_t word = index->sorted[i];
+        WordEntry* entry = &entries[word];
+        if (entry->count == 0) {
+            entry->rank = WORD_UNLISTED;
+            continue;
+        }
+        while (next < keyCount &&
+               CompareText(keys[next].text, keys[next].length, pool + entry->text, entry->length) < 0) {
+            sorted[count++] = keys[next++].word;
+        }
+        sorted[count++] = word;
+    }
+    while (next < keyCount) {
+        sorted[count++] = keys[next++].word;
+    }
+    MemoryFree(keys);
+
+    size_t treeBase = 1;
+    while (treeBase < count) {
+        treeBase *= 2;
+    }
+    uint32_t* tree = (uint32_t*)MemoryCalloc(MEMORY_TAG_WORDS, 2 * treeBase, sizeof(uint32_t));
+    if (!tree) {
+        MemoryFree(sorted);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        entries[sorted[i]].rank = (uint32_t)i;
+        tree[treeBase + i] = entries[sorted[i]].count;
+    }
+    for (size_t node = treeBase - 1; node >= 1; node--) {
+        tree[node] = tree[2 * node] > tree[2 * node + 1] ? tree[2 * node] : tree[2 * node + 1];
+    }
+
+    MemoryFree(index->sorted);
+    MemoryFree(index->tree);
+    index->sorted = sorted;
+    index->sortedCount = count;
+    index->tree = tree;
+    index->treeBase = treeBase;
+    index->pendingCount = 0;
+    return true;
+}
+
+/**
+ * @brief Discards the index; it is rebuilt on the next query.
+ *
+ * @param index The index.
+ */
+static void Invalidate(WordIndex* index) {
+    TableFree(&index->table);
+    BlockListFree(&index->blocks);
+    MemoryFree(index->sorted);
+    MemoryFree(index->tree);
+    MemoryFree(index->pending);
+    index->sorted = NULL;
+    index->tree = NULL;
+    index->pending = NULL;
+    index->sortedCount = 0;
+    index->treeBase = 0;
+    index->pendingCount = 0;
+    index->pendingCapacity = 0;
+    index->length = 0;
+    index->built = false;
+}
+
+/**
+ * @brief Checks that the original runs of the document cover it in order.
+ */
+static bool CheckOriginalRun(uint64_t offset, uint64_t originalOffset, uint64_t length, void* context) {
+    OriginalCheck* check = (OriginalCheck*)context;
+    check->unmodified = offset == check->next && originalOffset == offset;
+    check->next += length;
+    return check->unmodified;
+}
+
+/**
+ * @brief Gets the text of the document if it is still the file it was opened from.
+ *
+ * @param document The document.
+ * @return The mapped text, or NULL if the document was edited.
+ */
+static const char* UnmodifiedText(const Document* document) {
+    uint64_t length;
+    const char* text = DocumentOriginalText(document, &length);
+    if (!text || length == 0 || length != DocumentLength(document)) {
+        return NULL;
+    }
+
+    OriginalCheck check = { 0, true };
+    DocumentForEachOriginalRun(document, CheckOriginalRun, &check);
+    return check.unmodified && check.next == length ? text : NULL;
+}
+
+/**
+ * @brief Scans one part of the mapped file. Runs on a build thread.
+ *
+ * @param context The part.
+ */
+static void ScanPart(void* context) {
+    BuildPart* part = (BuildPart*)context;
+    WordScanner scanner;
+    ScannerInit(&scanner, &part->table, &part->blocks, WORD_BLOCK_TARGET);
+    ScannerFeed(&scanner, part->text, part->length);
+    ScannerFlush(&scanner);
+    part->failed = scanner.failed || part->blocks.failed;
+    MemoryFree(scanner.words);
+}
+
+/**
+ * @brief Builds the blocks of an unmodified document from its mapped text.
+ *
+ * The text is split after line breaks into one part per thread. Every
+ * thread interns into its own table; the tables are merged afterwards in
+ * file order and the block counts renumbered.
+ *
+ * @param index The index.
+ * @param text The mapped text.
+ * @param length Length of the text.
+ * @param threadCount Maximum number of threads, or 0 for one per processor.
+ * @return true if successful, false on allocation failure.
+ */
+static bool BuildFromText(WordIndex* index, const char* text, size_t length, unsigned threadCount) {
+    size_t partCount = threadCount ? threadCount : ThreadProcessorCount();
+    if (partCount > WORD_BUILD_MAX_THREADS) {
+        partCount = WORD_BUILD_MAX_THREADS;
+    }
+    if (partCount > length / WORD_BUILD_MIN_PART) {
+        partCount = length / WORD_BUILD_MIN_PART;
+    }
+    if (partCount == 0) {
+        partCount = 1;
+    }
+
+    BuildPart* parts = (BuildPart*)MemoryCalloc(MEMORY_TAG_WORDS, partCount, sizeof(BuildPart));
+    Thread** threads = (Thread**)MemoryCalloc(MEMORY_TAG_WORDS, partCount, sizeof(Thread*));
+    if (!parts || !threads) {
+        MemoryFree(parts);
+        MemoryFree(threads);
+        return false;
+    }
+
+    size_t start = 0;
+    for (size_t p = 0; p < partCount; p++) {
+        size_t end = length;
+        if (p + 1 < partCount) {
+            end = length / partCount * (p + 1);
+            end = end < start ? start : end;
+            const char* lineFeed = (const char*)memchr(text + end, '\n', length - end);
+            end = lineFeed ? (size_t)(lineFeed - text) + 1 : length;
+        }
+        parts[p].text = text + start;
+        parts[p].length = end - start;
+        start = end;
+    }
+
+    // The calling thread scans the first part; a thread that cannot be started is replaced by the caller too
+    for (size_t p = 1; p < partCount; p++) {
+        threads[p] = ThreadStart(ScanPart, &parts[p]);
+    }
+    ScanPart(&parts[0]);
+    for (size_t p = 1; p < partCount; p++) {
+        if (threads[p]) {
+            ThreadJoin(threads[p]);
+        } else {
+            ScanPart(&parts[p]);
+        }
+    }
+    MemoryFree(threads);
+
+    bool success = true;
+    for (size_t p = 0; p < partCount && success; p++) {
+        BuildPart* part = &parts[p];
+        uint32_t* map = (uint32_t*)MemoryAlloc(MEMORY_TAG_WORDS,
+                                               (part->table.count ? part->table.count : 1) * sizeof(uint32_t));
+        success = !part->failed && map;
+        for (size_t i = 0; success && i < part->table.count; i++) {
+            const WordEntry* entry = &part->table.entries[i];
+            map[i] = TableIntern(&index->table, part->table.pool + entry->text, entry->length, entry->hash);
+            success = map[i] != WORD_NONE;
+        }
+        for (size_t b = 0; success && b < part->blocks.count; b++) {
+            WordBlock* block = &part->blocks.items[b];
+            for (uint32_t i = 0; i < block->countCount; i++) {
+                block->counts[i].word = map[block->counts[i].word];
+            }
+            BlockListPush(&index->blocks, block);
+            block->counts = NULL;
+            success = !index->blocks.failed;
+        }
+        MemoryFree(map);
+    }
+
+    for (size_t p = 0; p < partCount; p++) {
+        TableFree(&parts[p].table);
+        BlockListFree(&parts[p].blocks);
+    }
+    MemoryFree(parts);
+    return success;
+}
+
+/**
+ * @brief Checks whether a node is visited before another.
+ *
+ * Larger maximums go first; ties go to the node further left, so equal
+ * counts come out in alphabetical order.
+ *
+ * @param a First node.
+ * @param b Second node.
+ * @return true if a is visited first, false otherwise.
+ */
+static bool NodeBefore(const CompletionNode* a, const CompletionNode* b) {
+    if (a->max != b->max) {
+        return a->max > b->max;
+    }
+    return a->node * a->width < b->node * b->width;
+}
+
+/**
+ * @brief Adds a node to the heap unless its subtree holds no occurrences.
+ *
+ * @param heap The heap.
+ * @param max Maximum count below the node.
+ * @param node The node.
+ * @param width Leaves below the node.
+ */
+static void HeapPush(CompletionHeap* heap, uint32_t max, size_t node, size_t width) {
+    if (heap->failed || max == 0) {
+        return;
+    }
+    if (heap->count == heap->capacity) {
+        size_t newCapacity = heap->capacity ? heap->capacity * 2 : 64;
+        CompletionNode* newItems = (CompletionNode*)MemoryRealloc(MEMORY_TAG_WORDS, heap->items,
+                                                                  newCapacity * sizeof(CompletionNode));
+        if (!newItems) {
+            heap->failed = true;
+            return;
+        }
+        heap->items = newItems;
+        heap->capacity = newCapacity;
+    }
+
+    size_t child = heap->count++;
+    heap->items[child].max = max;
+    heap->items[child].node = node;
+    heap->items[child].width = width;
+    while (child > 0 && NodeBefore(&heap->items[child], &heap->items[(child - 1) / 2])) {
+        CompletionNode swap = heap->items[child];
+        heap->items[child] = heap->items[(child - 1) / 2];
+        heap->items[(child - 1) / 2] = swap;
+        child = (child - 1) / 2;
+    }
+}
+
+/**
+ * @brief Removes the first node from a non-empty heap.
+ *
+ * @param heap The heap.
+ * @return The node.
+ */
+static CompletionNode HeapPop(CompletionHeap* heap) {
+    CompletionNode top = heap->items[0];
+    heap->items[0] = heap->items[--heap->count];
+    for (size_t parent = 0;;) {
+        size_t child = 2 * parent + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && NodeBefore(&heap->items[child + 1], &heap->items[child])) {
+            child++;
+        }
+        if (!NodeBefore(&heap->items[child], &heap->items[parent])) {
+            break;
+        }
+        CompletionNode swap = heap->items[parent];
+        heap->items[parent] = heap->items[child];
+        heap->items[child] = swap;
+        parent = child;
+    }
+    return top;
+}
+
+/**
+ * @brief Builds the index if it has not been built yet.
+ *
+ * @param index The index.
+ * @return true if the index is usable, false otherwise.
+ */
+static bool EnsureBuilt(WordIndex* index) {
+    return index->built || WordIndexBuild(index, 0);
+}
+
+/**
+ * @brief Applies reported changes to the blocks, rescanning only the blocks they touch.
+ *
+ * @param index The index; it must be built and hold at least one block.
+ * @param changes The changes in pre-change coordinates.
+ * @param changeCount Number of changes.
+ * @return true if successful, false if the index has to be rebuilt.
+ */
+static bool UpdateBlocks(WordIndex* index, const DocumentChange* changes, size_t changeCount) {
+    const Document* document = index->document;
+    BlockList* blocks = &index->blocks;
+    uint64_t oldTotal = index->length;
+    uint64_t newTotal = DocumentLength(document);
+
+    // Old blocks [firstBlock, lastBlock] are replaced by newCount blocks of newBlocks
+    typedef struct {
+        size_t firstBlock;
+        size_t lastBlock;
+        size_t firstNew;
+        size_t newCount;
+    } Region;
+
+    Region* regions = (Region*)MemoryAlloc(MEMORY_TAG_WORDS, changeCount * sizeof(Region));
+    if (!regions) {
+        return false;
+    }
+    size_t regionCount = 0;
+    BlockList newBlocks = { 0 };
+    WordScanner scanner;
+    ScannerInit(&scanner, &index->table, &newBlocks, WORD_BLOCK_SPLIT);
+    bool sameShape = true;
+    size_t replacedCount = 0;
+    int64_t shift = 0;
+    size_t next = 0;
+    size_t block = 0;
+    uint64_t blockStart = 0;
+
+    while (next < changeCount) {
+        // The last block also takes changes at the end of the document
+        while (block + 1 < blocks->count && blockStart + blocks->items[block].length <= changes[next].offset) {
+            blockStart += blocks->items[block].length;
+            block++;
+        }
+
+        Region* region = &regions[regionCount++];
+        region->firstBlock = block;
+        region->lastBlock = block;
+        uint64_t oldStart = blockStart;
+        uint64_t oldEnd = oldStart + blocks->items[block].length;
+        int64_t regionShift = 0;
+
+        for (;;) {
+            while (next < changeCount && (changes[next].offset < oldEnd || oldEnd == oldTotal)) {
+                uint64_t removeEnd = changes[next].offset + changes[next].removedLength;
+                while (removeEnd > oldEnd && region->lastBlock + 1 < blocks->count) {
+                    region->lastBlock++;
+                    oldEnd += blocks->items[region->lastBlock].length;
+                }
+                regionShift += (int64_t)changes[next].insertedLength - (int64_t)changes[next].removedLength;
+                next++;
+            }
+
+            // The rescanned text has to end outside an identifier for the next block to stay valid
+            uint64_t newStart = (uint64_t)((int64_t)oldStart + shift);
+            uint64_t newEnd = (uint64_t)((int64_t)oldEnd + shift + regionShift);
+            if (newEnd >= newTotal || newEnd == newStart || region->lastBlock + 1 >= blocks->count ||
+                !IsWordByte(DocumentCharAt(document, newEnd - 1))) {
+                region->firstNew = newBlocks.count;
+                ScanDocument(document, newStart, newEnd, &scanner);
+                region->newCount = newBlocks.count - region->firstNew;
+                if (region->newCount != region->lastBlock - region->firstBlock + 1) {
+                    sameShape = false;
+                }
+                replacedCount += region->lastBlock - region->firstBlock + 1;
+                break;
+            }
+            region->lastBlock++;
+            oldEnd += blocks->items[region->lastBlock].length;
+        }
+        shift += regionShift;
+        block = region->lastBlock + 1;
+        blockStart = oldEnd;
+    }
+    MemoryFree(scanner.words);
+
+    bool success = !scanner.failed && !newBlocks.failed;
+    WordBlock* spliced = NULL;
+    size_t splicedCount = blocks->count - replacedCount + newBlocks.count;
+    if (success && !sameShape) {
+        spliced = (WordBlock*)MemoryAlloc(MEMORY_TAG_WORDS, (splicedCount ? splicedCount : 1) * sizeof(WordBlock));
+        success = spliced != NULL;
+    }
+    if (!success) {
+        BlockListFree(&newBlocks);
+        MemoryFree(regions);
+        return false;
+    }
+
+    for (size_t r = 0; r < regionCount; r++) {
+        for (size_t b = regions[r].firstBlock; b <= regions[r].lastBlock; b++) {
+            AddCounts(index, &blocks->items[b], false);
+        }
+        for (size_t i = 0; i < regions[r].newCount; i++) {
+            AddCounts(index, &newBlocks.items[regions[r].firstNew + i], true);
+        }
+    }
+    for (size_t r = 0; r < regionCount && success; r++) {
+        for (size_t b = regions[r].firstBlock; b <= regions[r].lastBlock && success; b++) {
+            success = SyncCounts(index, &blocks->items[b]);
+        }
+        for (size_t i = 0; i < regions[r].newCount && success; i++) {
+            success = SyncCounts(index, &newBlocks.items[regions[r].firstNew + i]);
+        }
+    }
+
+    // The new blocks take the place of the old ones; their counts change owner
+    if (sameShape) {
+        for (size_t r = 0; r < regionCount; r++) {
+            for (size_t i = 0; i < regions[r].newCount; i++) {
+                MemoryFree(blocks->items[regions[r].firstBlock + i].counts);
+                blocks->items[regions[r].firstBlock + i] = newBlocks.items[regions[r].firstNew + i];
+            }
+        }
+    } else {
+        size_t count = 0;
+        size_t b = 0;
+        for (size_t r = 0; r < regionCount; r++) {
+            for (; b < regions[r].firstBlock; b++) {
+                spliced[count++] = blocks->items[b];
+            }
+            for (size_t i = 0; i < regions[r].newCount; i++) {
+                spliced[count++] = newBlocks.items[regions[r].firstNew + i];
+            }
+            for (; b <= regions[r].lastBlock; b++) {
+                MemoryFree(blocks->items[b].counts);
+            }
+        }
+        for (; b < blocks->count; b++) {
+            spliced[count++] = blocks->items[b];
+        }
+        MemoryFree(blocks->items);
+        blocks->items = spliced;
+        blocks->count = splicedCount;
+        blocks->capacity = splicedCount ? splicedCount : 1;
+    }
+    MemoryFree(newBlocks.items);
+    MemoryFree(regions);
+    index->length = newTotal;
+
+    size_t pendingLimit = index->sortedCount / WORD_PENDING_RATIO;
+    if (success && index->pendingCount > (pendingLimit > WORD_PENDING_MIN ? pendingLimit : WORD_PENDING_MIN)) {
+        success = MergePending(index);
+    }
+    return success;
+}
+
+/**
+ * @brief Keeps the index in step with document changes.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes, or NULL if unknown.
+ * @param changeCount Number of changes.
+ * @param context The index.
+ */
+static void WordDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                void* context) {
+    (void)document;
+    WordIndex* index = (WordIndex*)context;
+    if (!index->built) {
+        return;
+    }
+    if (!changes || changeCount == 0 || index->blocks.count == 0 || !UpdateBlocks(index, changes, changeCount)) {
+        Invalidate(index);
+    }
+}
+
+/**
+ * @brief Creates the identifier index of a document.
+ *
+ * The index registers itself as a document listener. It is built by
+ * WordIndexBuild, or the first time it is queried.
+ *
+ * @param document The document; it must outlive the index.
+ * @return The index, or NULL on allocation failure.
+ */
+WordIndex* WordIndexCreate(Document* document) {
+    WordIndex* index = (WordIndex*)MemoryCalloc(MEMORY_TAG_WORDS, 1, sizeof(WordIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    index->document = document;
+    if (!DocumentAddListener(document, WordDocumentChanged, index)) {
+        MemoryFree(index);
+        return NULL;
+    }
+    return index;
+}
+
+/**
+ * @brief Destroys an identifier index and unregisters it from its document.
+ *
+ * @param index The index. NULL is ignored.
+ */
+void WordIndexDestroy(WordIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    DocumentRemoveListener(index->document, WordDocumentChanged, index);
+    Invalidate(index);
+    MemoryFree(index);
+}
+
+/**
+ * @brief Builds the index from the whole document.
+ *
+ * While the document still holds the unmodified file it was opened from,
+ * the file is split at line breaks and the parts are scanned in parallel.
+ *
+ * @param index The index.
+ * @param threadCount Maximum number of threads, or 0 for one per processor.
+ * @return true if successful, false on allocation failure.
+ */
+bool WordIndexBuild(WordIndex* index, unsigned threadCount) {
+    if (!index) {
+        return false;
+    }
+
+    Invalidate(index);
+    uint64_t length = DocumentLength(index->document);
+    const char* text = UnmodifiedText(index->document);
+    bool success;
+    if (text) {
+        success = BuildFromText(index, text, (size_t)length, threadCount);
+    } else {
+        WordScanner scanner;
+        ScannerInit(&scanner, &index->table, &index->blocks, WORD_BLOCK_TARGET);
+        ScanDocument(index->document, 0, length, &scanner);
+        MemoryFree(scanner.words);
+        success = !scanner.failed && !index->blocks.failed;
+    }
+
+    for (size_t b = 0; success && b < index->blocks.count; b++) {
+        AddCounts(index, &index->blocks.items[b], true);
+    }
+    if (success) {
+        index->pending = (uint32_t*)MemoryAlloc(MEMORY_TAG_WORDS,
+                                                (index->table.count ? index->table.count : 1) * sizeof(uint32_t));
+        success = index->pending != NULL;
+    }
+    if (success) {
+        for (size_t i = 0; i < index->table.count; i++) {
+            index->pending[i] = (uint32_t)i;
+            index->table.entries[i].rank = WORD_PENDING;
+        }
+        index->pendingCount = index->table.count;
+        index->pendingCapacity = index->pendingCount ? index->pendingCount : 1;
+        success = MergePending(index);
+    }
+
+    if (!success) {
+        Invalidate(index);
+        return false;
+    }
+    index->length = length;
+    index->built = true;
+    return true;
+}
+
+/**
+ * @brief Finds the most frequent identifiers starting with a prefix.
+ *
+ * The prefix is compared ignoring ASCII case. The identifier equal to the
+ * prefix itself is not offered. Results are sorted by count, most frequent
+ * first, and then alphabetically.
+ *
+ * @param index The index.
+ * @param prefix The prefix.
+ * @param prefixLength Length of the prefix.
+ * @param[out] results Receives the completions.
+ * @param maxResults Capacity of results.
+ * @return Number of completions written to results.
+ */
+size_t WordIndexComplete(WordIndex* index, const char* prefix, size_t prefixLength, WordCompletion* results,
+                         size_t maxResults) {
+    if (!index || (!prefix && prefixLength > 0) || !results || maxResults == 0 || !EnsureBuilt(index)) {
+        return 0;
+    }
+
+    const WordEntry* entries = index->table.entries;
+    const char* pool = index->table.pool;
+
+    // Matches form one range of the sorted order
+    size_t low = 0;
+    size_t high = index->sortedCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const WordEntry* entry = &entries[index->sorted[middle]];
+        if (ComparePrefix(pool + entry->text, entry->length, prefix, prefixLength) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    size_t first = low;
+    high = index->sortedCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const WordEntry* entry = &entries[index->sorted[middle]];
+        if (ComparePrefix(pool + entry->text, entry->length, prefix, prefixLength) == 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    size_t last = low;
+
+    WordCompletion* found = (WordCompletion*)MemoryAlloc(MEMORY_TAG_WORDS,
+                                                         (maxResults + index->pendingCount) * sizeof(WordCompletion));
+    CompletionHeap heap = { 0 };
+    size_t foundCount = 0;
+
+    // The range splits into whole subtrees; visit them largest maximum first
+    size_t left = first + index->treeBase;
+    size_t right = last + index->treeBase;
+    for (size_t width = 1; left < right; left /= 2, right /= 2, width *= 2) {
+        if (left & 1) {
+            HeapPush(&heap, index->tree[left], left, width);
+            left++;
+        }
+        if (right & 1) {
+            right--;
+            HeapPush(&heap, index->tree[right], right, width);
+        }
+    }
+
+    while (found && !heap.failed && heap.count > 0 && heap.items[0].max > 0 && foundCount < maxResults) {
+        CompletionNode top = HeapPop(&heap);
+        if (top.width > 1) {
+            HeapPush(&heap, index->tree[2 * top.node], 2 * top.node, top.width / 2);
+            HeapPush(&heap, index->tree[2 * top.node + 1], 2 * top.node + 1, top.width / 2);
+            continue;
+        }
+
+        const WordEntry* entry = &entries[index->sorted[top.node - index->treeBase]];
+        const char* text = pool + entry->text;
+        if (entry->length != prefixLength || memcmp(text, prefix, prefixLength) != 0) {
+            found[foundCount].text = text;
+            found[foundCount].length = entry->length;
+            found[foundCount].count = entry->count;
+            foundCount++;
+        }
+    }
+    bool failed = !found || heap.failed;
+    MemoryFree(heap.items);
+
+    // Identifiers added since the last merge are not in the tree yet
+    for (size_t i = 0; i < index->pendingCount && !failed; i++) {
+        const WordEntry* entry = &entries[index->pending[i]];
+        const char* text = pool + entry->text;
+        if (entry->count > 0 && ComparePrefix(text, entry->length, prefix, prefixLength) == 0 &&
+            (entry->length != prefixLength || memcmp(text, prefix, prefixLength) != 0)) {
+            found[foundCount].text = text;
+            found[foundCount].length = entry->length;
+            found[foundCount].count = entry->count;
+            foundCount++;
+        }
+    }
+
+    if (failed) {
+        MemoryFree(found);
+        return 0;
+    }
+    qsort(found, foundCount, sizeof(WordCompletion), CompareCompletions);
+    if (foundCount > maxResults) {
+        foundCount = maxResults;
+    }
+    memcpy(results, found, foundCount * sizeof(WordCompletion));
+    MemoryFree(found);
+    return foundCount;
+}
+
+/**
+ * @brief Checks whether a byte can be part of an identifier.
+ *
+ * @param c The byte.
+ * @return true for ASCII letters, digits, underscores and bytes >= 0x80, false otherwise.
+ */
+bool WordIndexIsWordByte(char c) {
+    return IsWordByte(c);
+}
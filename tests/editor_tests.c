@@ -0,0 +1,1283 @@
+/**
+ * @file editor_tests.c
+ * @brief Randomized tests of the editor core for the Professional Text Editor
+ *
+ * Checks the core modules against simple reference implementations on
+ * pseudo-random inputs, without any user interface:
+ *
+ *   diff      Hunks against a naive longest common subsequence of the lines
+ *   markers   Marker positions against a list mapped through every change
+ *   sort      Sort Lines and Unique Lines against qsort, in memory and in run files
+ *   format    Formatted text against a line-by-line formatter, and the recorded edits against the text
+ *   folds     Hidden lines against a list of line ranges, and fold ranges of an edited index against a new one
+ *
+ * Every test starts from a fixed seed, so a failure is reproduced by
+ * running the same test again. Run files of the sort test are created in
+ * the working directory.
+ */
+
+#include "../include/diff.h"
+#include "../include/document.h"
+#include "../include/folds.h"
+#include "../include/lineindex.h"
+#include "../include/linesort.h"
+#include "../include/markers.h"
+#include "../include/structure.h"
+#include "../include/textformat.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TESTS_MARKER_COUNT 200          // Markers placed by the marker test
+#define TESTS_MAX_FOLDS 64              // Folds tracked by the fold test
+#define TESTS_SORT_RUN_PREFIX "editor_tests_sort"   // Run files of the sort test, in the working directory
+
+// State of the pseudo-random generator; reset by each test
+static uint64_t g_random;
+
+// Name of the test running, for failure messages
+static const char* g_testName;
+
+/**
+ * @brief Gets the next pseudo-random number (xorshift64).
+ *
+ * @return The number.
+ */
+static uint64_t NextRandom(void) {
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 7;
+    g_random ^= g_random << 17;
+    return g_random;
+}
+
+/**
+ * @brief Gets a pseudo-random number below a bound.
+ *
+ * @param bound The bound; 0 is treated as 1.
+ * @return A number from 0 to bound - 1.
+ */
+static uint64_t RandomBelow(uint64_t bound) {
+    return bound > 1 ? NextRandom() % bound : 0;
+}
+
+/**
+ * @brief Reports a failure of the running test.
+ *
+ * @param round The round that failed.
+ * @param format printf format of the message.
+ * @return false, so a check can return the call.
+ */
+static bool Fail(unsigned round, const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    fprintf(stderr, "editor_tests: %s: round %u: ", g_testName, round);
+    vfprintf(stderr, format, arguments);
+    fprintf(stderr, "\n");
+    va_end(arguments);
+    return false;
+}
+
+/**
+ * @brief Checks that a document holds a text.
+ *
+ * @param document The document.
+ * @param text The expected text.
+ * @param length Length of the expected text.
+ * @return true if they are equal, false otherwise.
+ */
+static bool DocumentEquals(const Document* document, const char* text, size_t length) {
+    if (DocumentLength(document) != length) {
+        return false;
+    }
+    char* content = DocumentCopyRange(document, 0, length);
+    bool equal = content && memcmp(content, text, length) == 0;
+    free(content);
+    return equal;
+}
+
+/**
+ * @brief Counts the line feeds of a text.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @return The number of line feeds.
+ */
+static uint64_t CountLineFeeds(const char* text, size_t length) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        count += text[i] == '\n';
+    }
+    return count;
+}
+
+// Lines the diff test builds its texts from; some share long prefixes
+static const char* const g_diffLines[] = {
+    "a\n", "b\n", "cc\n", "dd\n", "e\n", "\n",
+    "if (value != NULL) {\n", "if (value != NULL) {}\n", "    return false;\n", "    return true;\n"
+};
+
+/**
+ * @brief Checks hunks against the lines they compare.
+ *
+ * Both sides include the empty line after their last line break, as the
+ * line index counts it. Lines outside the hunks must be equal, and the
+ * number of lines the hunks remove and insert must lie in a range.
+ *
+ * @param round The round, for failure messages.
+ * @param result The hunks.
+ * @param oldLines The old lines.
+ * @param oldCount Number of old lines.
+ * @param newLines The new lines.
+ * @param newCount Number of new lines.
+ * @param leastChanged Fewest lines the hunks may change.
+ * @param mostChanged Most lines the hunks may change.
+ * @return true if the hunks are correct, false otherwise.
+ */
+static bool CheckHunks(unsigned round, const DiffResult* result, const char* const* oldLines, size_t oldCount,
+                       const char* const* newLines, size_t newCount, uint64_t leastChanged, uint64_t mostChanged) {
+    uint64_t oldLine = 0;
+    uint64_t newLine = 0;
+    uint64_t changed = 0;
+    for (size_t h = 0; h <= result->count; h++) {
+        const DiffHunk* hunk = h < result->count ? &result->hunks[h] : NULL;
+        uint64_t keptEnd = hunk ? hunk->oldLine : oldCount;
+        if (keptEnd < oldLine || (hunk && hunk->newLine != newLine + (keptEnd - oldLine))) {
+            return Fail(round, "hunk %zu is out of order", h);
+        }
+        for (; oldLine < keptEnd; oldLine++, newLine++) {
+            if (newLine >= newCount || strcmp(oldLines[oldLine], newLines[newLine]) != 0) {
+                return Fail(round, "old line %llu is kept but differs", (unsigned long long)oldLine);
+            }
+        }
+        if (hunk) {
+            if (hunk->oldCount == 0 && hunk->newCount == 0) {
+                return Fail(round, "hunk %zu is empty", h);
+            }
+            oldLine += hunk->oldCount;
+            newLine += hunk->newCount;
+            changed += hunk->oldCount + hunk->newCount;
+        }
+    }
+    if (oldLine != oldCount || newLine != newCount) {
+        return Fail(round, "hunks end at lines %llu and %llu instead of %zu and %zu", (unsigned long long)oldLine,
+                    (unsigned long long)newLine, oldCount, newCount);
+    }
+    if (changed < leastChanged || changed > mostChanged) {
+        return Fail(round, "hunks change %llu lines instead of %llu to %llu", (unsigned long long)changed,
+                    (unsigned long long)leastChanged, (unsigned long long)mostChanged);
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the length of the longest common subsequence of two line lists.
+ *
+ * @param oldLines The old lines.
+ * @param oldCount Number of old lines.
+ * @param newLines The new lines.
+ * @param newCount Number of new lines.
+ * @return The length, or SIZE_MAX on allocation failure.
+ */
+static size_t LongestCommonLines(const char* const* oldLines, size_t oldCount, const char* const* newLines,
+                                 size_t newCount) {
+    size_t* lengths = (size_t*)calloc((oldCount + 1) * (newCount + 1), sizeof(size_t));
+    if (!lengths) {
+        return SIZE_MAX;
+    }
+    size_t width = newCount + 1;
+    for (size_t i = oldCount; i-- > 0;) {
+        for (size_t j = newCount; j-- > 0;) {
+            size_t skipOld = lengths[(i + 1) * width + j];
+            size_t skipNew = lengths[i * width + j + 1];
+            lengths[i * width + j] = strcmp(oldLines[i], newLines[j]) == 0 ? lengths[(i + 1) * width + j + 1] + 1
+                                     : skipOld > skipNew ? skipOld : skipNew;
+        }
+    }
+    size_t common = lengths[0];
+    free(lengths);
+    return common;
+}
+
+/**
+ * @brief Compares line diffs with a naive longest common subsequence.
+ *
+ * Each round edits a document created from the old text, so most of it
+ * still references the original, and diffs it both ways. As a separate
+ * document with no line index given, the hunks must be minimal. Sharing
+ * the original, runs that still reference it are kept as they are, so the
+ * hunks may change more lines than the minimum, but never more than the
+ * edits did.
+ *
+ * @return true if every round passed, false otherwise.
+ */
+static bool TestDiff(void) {
+    enum { ROUNDS = 1500, MAX_LINES = 300 };
+    size_t vocabulary = sizeof(g_diffLines) / sizeof(g_diffLines[0]);
+    const char* oldLines[MAX_LINES + 1];
+    const char* newLines[3 * MAX_LINES + 2];
+    DocumentEdit edits[MAX_LINES + 1];
+    char* oldText = (char*)malloc(MAX_LINES * 32);
+    char* insertions = (char*)malloc((MAX_LINES + 1) * 2 * 32);
+    bool passed = oldText && insertions;
+
+    for (unsigned round = 0; passed && round < ROUNDS; round++) {
+        // Small texts exercise the edges, a few larger ones the trimming and the search
+        size_t oldCount = round % 10 == 0 ? (size_t)RandomBelow(MAX_LINES) : (size_t)RandomBelow(30);
+        size_t oldLength = 0;
+        for (size_t i = 0; i < oldCount; i++) {
+            oldLines[i] = g_diffLines[RandomBelow(vocabulary)];
+            size_t lineLength = strlen(oldLines[i]);
+            memcpy(oldText + oldLength, oldLines[i], lineLength);
+            oldLength += lineLength;
+        }
+        oldLines[oldCount] = "";
+
+        // One edit per old line at most: lines inserted before it, and the line itself maybe removed
+        size_t editCount = 0;
+        size_t newCount = 0;
+        size_t editedLines = 0;
+        size_t insertedLength = 0;
+        size_t lineStart = 0;
+        unsigned changeRate = 2 + (unsigned)RandomBelow(10);
+        for (size_t i = 0; i <= oldCount; i++) {
+            size_t lineLength = i < oldCount ? strlen(oldLines[i]) : 0;
+            const char* text = insertions + insertedLength;
+            size_t textLength = 0;
+            if (RandomBelow(changeRate) == 0) {
+                for (uint64_t count = 1 + RandomBelow(2); count > 0; count--) {
+                    const char* line = g_diffLines[RandomBelow(vocabulary)];
+                    memcpy(insertions + insertedLength, line, strlen(line));
+                    insertedLength += strlen(line);
+                    textLength += strlen(line);
+                    newLines[newCount++] = line;
+                    editedLines++;
+                }
+            }
+            bool removed = i < oldCount && RandomBelow(changeRate) == 0;
+            if (i < oldCount && !removed) {
+                newLines[newCount++] = oldLines[i];
+            }
+            editedLines += removed;
+            if (textLength > 0 || removed) {
+                DocumentEdit* edit = &edits[editCount++];
+                edit->offset = lineStart;
+                edit->removeLength = removed ? lineLength : 0;
+                edit->text = text;
+                edit->textLength = textLength;
+                edit->slice = NULL;
+            }
+            lineStart += lineLength;
+        }
+        newLines[newCount] = "";
+
+        size_t common = LongestCommonLines(oldLines, oldCount + 1, newLines, newCount + 1);
+        Document* edited = DocumentCreateFromText(oldText, oldLength);
+        if (common == SIZE_MAX || !edited || (editCount > 0 && !DocumentApplyEdits(edited, edits, editCount))) {
+            DocumentDestroy(edited);
+            passed = Fail(round, "out of memory");
+            break;
+        }
+
+        // The same content, once sharing the original text and once standing alone
+        uint64_t originalLength;
+        const char* original = DocumentOriginalText(edited, &originalLength);
+        char* newText = DocumentCopyRange(edited, 0, DocumentLength(edited));
+        Document* separate = newText ? DocumentCreateFromText(newText, (size_t)DocumentLength(edited)) : NULL;
+        LineIndex oldIndex = { 0 };
+        DiffResult shared = { 0 };
+        DiffResult alone = { 0 };
+        if (!separate || !LineIndexBuild(&oldIndex, original, originalLength) ||
+            !DiffDocumentAgainstText(edited, original, originalLength, &oldIndex, true, &shared) ||
+            !DiffDocumentAgainstText(separate, oldText, oldLength, NULL, false, &alone)) {
+            passed = Fail(round, "diff failed");
+        } else {
+            uint64_t minimal = oldCount + newCount + 2 - 2 * common;
+            passed = CheckHunks(round, &shared, oldLines, oldCount + 1, newLines, newCount + 1, minimal, editedLines) &&
+                     CheckHunks(round, &alone, oldLines, oldCount + 1, newLines, newCount + 1, minimal, minimal);
+        }
+        DiffResultFree(&shared);
+        DiffResultFree(&alone);
+        LineIndexFree(&oldIndex);
+        DocumentDestroy(separate);
+        DocumentDestroy(edited);
+        free(newText);
+    }
+
+    free(oldText);
+    free(insertions);
+    return passed;
+}
+
+// A marker as the marker test expects it
+typedef struct {
+    MarkerId id;
+    uint64_t start;
+    uint64_t end;
+    MarkerKind kind;
+    MarkerStickiness stickiness;
+} ModelMarker;
+
+// Markers of the marker test, moved by a document listener of their own
+typedef struct {
+    ModelMarker items[TESTS_MARKER_COUNT];
+    size_t count;
+    bool lostChanges;       // A change was reported without its ranges
+} MarkerModel;
+
+/**
+ * @brief Maps a marker edge through one change, as documented for markers.
+ *
+ * @param change The change.
+ * @param position The edge before the change.
+ * @param moves true if the edge goes after text inserted at it.
+ * @return The edge after the change.
+ */
+static uint64_t MapModelEdge(const DocumentChange* change, uint64_t position, bool moves) {
+    uint64_t removedEnd = change->offset + change->removedLength;
+    if (position < change->offset) {
+        return position;
+    }
+    if (position > removedEnd || (position == removedEnd && change->removedLength > 0)) {
+        return position + change->insertedLength - change->removedLength;
+    }
+    return moves ? change->offset + change->insertedLength : change->offset;
+}
+
+/**
+ * @brief Moves the model markers with a document change.
+ *
+ * @param document The document.
+ * @param changes The changes, in the coordinates before the batch.
+ * @param changeCount Number of changes.
+ * @param context The marker model.
+ */
+static void MarkerModelChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                               void* context) {
+    (void)document;
+    MarkerModel* model = (MarkerModel*)context;
+    if (!changes) {
+        model->lostChanges = true;
+        return;
+    }
+
+    // From the last change back, so the offsets of the earlier ones still hold
+    for (size_t c = changeCount; c-- > 0;) {
+        for (size_t m = 0; m < model->count; m++) {
+            ModelMarker* marker = &model->items[m];
+            bool startMoves = marker->stickiness == MARKER_GROWS_NEVER || marker->stickiness == MARKER_GROWS_AT_END;
+            bool endMoves = marker->stickiness == MARKER_GROWS_ALWAYS || marker->stickiness == MARKER_GROWS_AT_END;
+            marker->start = MapModelEdge(&changes[c], marker->start, startMoves);
+            marker->end = MapModelEdge(&changes[c], marker->end, endMoves);
+            if (marker->start > marker->end) {
+                marker->start = marker->end;
+            }
+        }
+    }
+}
+
+// What a marker query collects
+typedef struct {
+    size_t count;
+    uint64_t lastStart;
+    bool ordered;
+} MarkerQueryCheck;
+
+/**
+ * @brief Counts a marker found by a query and checks the order of the starts.
+ *
+ * @param marker The marker.
+ * @param context The query check.
+ * @return true to continue.
+ */
+static bool CollectMarker(const Marker* marker, void* context) {
+    MarkerQueryCheck* check = (MarkerQueryCheck*)context;
+    if (check->count > 0 && marker->start < check->lastStart) {
+        check->ordered = false;
+    }
+    check->lastStart = marker->start;
+    check->count++;
+    return true;
+}
+
+/**
+ * @brief Checks every marker of the tree against the model.
+ *
+ * @param round The round, for failure messages.
+ * @param tree The tree.
+ * @param model The model.
+ * @param length Length of the document.
+ * @return true if they agree, false otherwise.
+ */
+static bool CheckMarkers(unsigned round, const MarkerTree* tree, const MarkerModel* model, uint64_t length) {
+    for (size_t m = 0; m < model->count; m++) {
+        const ModelMarker* expected = &model->items[m];
+        Marker marker;
+        if (!MarkerTreeGet(tree, expected->id, &marker)) {
+            return Fail(round, "marker %llu is missing", (unsigned long long)expected->id);
+        }
+        if (marker.start != expected->start || marker.end != expected->end) {
+            return Fail(round, "marker %llu (stickiness %d) is at %llu-%llu instead of %llu-%llu",
+                        (unsigned long long)expected->id, (int)expected->stickiness,
+                        (unsigned long long)marker.start, (unsigned long long)marker.end,
+                        (unsigned long long)expected->start, (unsigned long long)expected->end);
+        }
+    }
+    if (MarkerTreeCount(tree, MARKER_ALL_KINDS) != model->count) {
+        return Fail(round, "the tree counts %zu markers instead of %zu", MarkerTreeCount(tree, MARKER_ALL_KINDS),
+                    model->count);
+    }
+
+    MarkerQueryCheck check = { 0, 0, true };
+    MarkerTreeQuery(tree, 0, length, MARKER_ALL_KINDS, CollectMarker, &check);
+    if (check.count != model->count || !check.ordered) {
+        return Fail(round, "a query of the document found %zu markers%s", check.count,
+                    check.ordered ? "" : " out of order");
+    }
+
+    // The next bookmark from a few offsets
+    for (int probe = 0; probe < 8; probe++) {
+        uint64_t offset = RandomBelow(length + 1);
+        bool found = false;
+        uint64_t nearest = 0;
+        for (size_t m = 0; m < model->count; m++) {
+            const ModelMarker* marker = &model->items[m];
+            if (marker->kind == MARKER_KIND_BOOKMARK && marker->start >= offset &&
+                (!found || marker->start < nearest)) {
+                found = true;
+                nearest = marker->start;
+            }
+        }
+        Marker next;
+        bool treeFound = MarkerTreeNext(tree, offset, 1u << MARKER_KIND_BOOKMARK, &next);
+        if (treeFound != found || (found && next.start != nearest)) {
+            return Fail(round, "the next bookmark from %llu is wrong", (unsigned long long)offset);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Compares marker positions with a list mapped through every change.
+ *
+ * Edit batches of up to three changes, undo and redo move the markers;
+ * markers are added and removed between them.
+ *
+ * @return true if every round passed, false otherwise.
+ */
+static bool TestMarkers(void) {
+    enum { ROUNDS = 3000, TEXT_LENGTH = 4000 };
+    static const char* const insertions[] = { "x", "\n", "abc", "line\nline\n", "" };
+    char* text = (char*)malloc(TEXT_LENGTH);
+    MarkerModel* model = (MarkerModel*)calloc(1, sizeof(MarkerModel));
+    if (!text || !model) {
+        free(text);
+        free(model);
+        return Fail(0, "out of memory");
+    }
+    for (size_t i = 0; i < TEXT_LENGTH; i++) {
+        text[i] = RandomBelow(20) == 0 ? '\n' : (char)('a' + RandomBelow(26));
+    }
+
+    Document* document = DocumentCreateFromText(text, TEXT_LENGTH);
+    MarkerTree* tree = document ? MarkerTreeCreate(document) : NULL;
+    bool passed = tree && DocumentAddListener(document, MarkerModelChanged, model);
+    if (!passed) {
+        Fail(0, "out of memory");
+    }
+
+    for (unsigned round = 0; passed && round < ROUNDS; round++) {
+        uint64_t length = DocumentLength(document);
+        uint64_t action = RandomBelow(20);
+        if (action == 0 && model->count > 0) {
+            size_t m = (size_t)RandomBelow(model->count);
+            if (!MarkerTreeRemove(tree, model->items[m].id)) {
+                passed = Fail(round, "marker %llu could not be removed", (unsigned long long)model->items[m].id);
+                break;
+            }
+            model->items[m] = model->items[--model->count];
+        } else if (action < 4 && model->count < TESTS_MARKER_COUNT) {
+            ModelMarker* marker = &model->items[model->count];
+            marker->start = RandomBelow(length + 1);
+            marker->end = RandomBelow(3) == 0 ? marker->start : marker->start + RandomBelow(length - marker->start + 1);
+            marker->kind = (MarkerKind)RandomBelow(MARKER_KIND_COUNT);
+            marker->stickiness = (MarkerStickiness)RandomBelow(MARKER_GROWS_AT_END + 1);
+            marker->id = MarkerTreeAdd(tree, marker->start, marker->end, marker->kind, marker->stickiness, 0);
+            if (marker->id == 0) {
+                passed = Fail(round, "a marker could not be added");
+                break;
+            }
+            model->count++;
+        } else if (action == 4) {
+            size_t changeCount;
+            DocumentUndo(document, &changeCount);
+        } else if (action == 5) {
+            size_t changeCount;
+            DocumentRedo(document, &changeCount);
+        } else {
+            // Sorted changes that may touch each other and the markers' edges
+            DocumentEdit edits[3];
+            size_t editCount = 0;
+            uint64_t from = 0;
+            for (uint64_t count = 1 + RandomBelow(3); count > 0 && from <= length; count--) {
+                DocumentEdit* edit = &edits[editCount++];
+                edit->offset = from + RandomBelow(RandomBelow(2) == 0 ? 4 : length - from + 1);
+                if (edit->offset > length) {
+                    edit->offset = length;
+                }
+                edit->removeLength = RandomBelow(2) == 0 ? 0 : RandomBelow(length - edit->offset < 40
+                                                                             ? length - edit->offset + 1 : 40);
+                edit->text = insertions[RandomBelow(sizeof(insertions) / sizeof(insertions[0]))];
+                edit->textLength = strlen(edit->text);
+                edit->slice = NULL;
+                from = edit->offset + edit->removeLength + 1;
+                if (edit->removeLength == 0 && edit->textLength == 0) {
+                    editCount--;
+                }
+            }
+            if (editCount > 0 && !DocumentApplyEdits(document, edits, editCount)) {
+                passed = Fail(round, "an edit failed");
+                break;
+            }
+        }
+        if (model->lostChanges) {
+            passed = Fail(round, "a change was reported without its ranges");
+            break;
+        }
+        passed = CheckMarkers(round, tree, model, DocumentLength(document));
+    }
+
+    MarkerTreeDestroy(tree);
+    DocumentDestroy(document);
+    free(model);
+    free(text);
+    return passed;
+}
+
+// Lines the sort test builds its texts from; several share their first eight bytes
+static const char* const g_sortLines[] = {
+    "", "a", "b", "ab", "abcdefgh", "abcdefghi", "abcdefghij", "abcdefgh\t", "abcdefgg", "zzzzzzzzzzzzzzzz",
+    "zzzzzzzzzzzzzzzy", "line 10", "line 9", "Line 9", "\xC3\xA9t\xC3\xA9", "~"
+};
+
+/**
+ * @brief Orders two lines by their bytes up to the line feed, a prefix first.
+ *
+ * Equal lines are ordered by their position, which makes qsort stable.
+ *
+ * @param left Pointer to the start of a line.
+ * @param right Pointer to the start of another line of the same text.
+ * @return Negative, zero or positive like strcmp.
+ */
+static int CompareLines(const void* left, const void* right) {
+    const char* a = *(const char* const*)left;
+    const char* b = *(const char* const*)right;
+    size_t lengthA = strcspn(a, "\n");
+    size_t lengthB = strcspn(b, "\n");
+    int order = memcmp(a, b, lengthA < lengthB ? lengthA : lengthB);
+    if (order != 0) {
+        return order;
+    }
+    if (lengthA != lengthB) {
+        return lengthA < lengthB ? -1 : 1;
+    }
+    return a < b ? -1 : a > b;
+}
+
+/**
+ * @brief Sorts the lines of a text with qsort.
+ *
+ * @param text The text; NUL-terminated, with no NUL bytes inside.
+ * @param length Length of the text.
+ * @param unique true to keep only the first of equal lines.
+ * @param[out] sortedLength Receives the length of the result.
+ * @param[out] lineCount Receives the number of lines in the result.
+ * @return The sorted text, or NULL on allocation failure. Free it with free.
+ */
+static char* SortReference(const char* text, size_t length, bool unique, size_t* sortedLength, size_t* lineCount) {
+    size_t count = length == 0 ? 0 : CountLineFeeds(text, length) + (text[length - 1] != '\n');
+    const char** lines = (const char**)malloc((count + 1) * sizeof(char*));
+    char* sorted = (char*)malloc(length + 2);
+    if (!lines || !sorted) {
+        free(lines);
+        free(sorted);
+        return NULL;
+    }
+    size_t line = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (i == 0 || text[i - 1] == '\n') {
+            lines[line++] = text + i;
+        }
+    }
+    qsort(lines, count, sizeof(char*), CompareLines);
+
+    size_t position = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t lineLength = strcspn(lines[i], "\n");
+        if (unique && kept > 0 && lineLength == strcspn(lines[i - 1], "\n") &&
+            memcmp(lines[i], lines[i - 1], lineLength) == 0) {
+            continue;
+        }
+        memcpy(sorted + position, lines[i], lineLength);
+        position += lineLength;
+        sorted[position++] = '\n';
+        kept++;
+    }
+    if (length > 0 && text[length - 1] != '\n' && position > 0) {
+        position--;
+    }
+    free(lines);
+    *sortedLength = position;
+    *lineCount = kept;
+    return sorted;
+}
+
+/**
+ * @brief Compares Sort Lines and Unique Lines with qsort.
+ *
+ * Small texts are sorted in memory; large ones with the smallest memory
+ * budget spill run files that are merged back. Some rounds sort only whole
+ * lines in the middle of the document.
+ *
+ * @return true if every round passed, false otherwise.
+ */
+static bool TestSort(void) {
+    enum { ROUNDS = 60 };
+    size_t vocabulary = sizeof(g_sortLines) / sizeof(g_sortLines[0]);
+    bool passed = true;
+    for (unsigned round = 0; passed && round < ROUNDS; round++) {
+        size_t lineCount = round % 4 == 3 ? 10000 + (size_t)RandomBelow(20000) : (size_t)RandomBelow(200);
+        size_t capacity = lineCount * 20 + 1;
+        char* text = (char*)malloc(capacity);
+        if (!text) {
+            return Fail(round, "out of memory");
+        }
+        size_t length = 0;
+        for (size_t i = 0; i < lineCount; i++) {
+            const char* line = g_sortLines[RandomBelow(vocabulary)];
+            memcpy(text + length, line, strlen(line));
+            length += strlen(line);
+            text[length++] = '\n';
+        }
+        if (length > 0 && RandomBelow(2) == 0) {
+            length--; // The last line has no line feed
+        }
+        text[length] = '\0';
+
+        // A range of whole lines: the whole text, or from a line start to a line end
+        size_t from = 0;
+        size_t to = length;
+        if (RandomBelow(3) == 0 && length > 0) {
+            from = (size_t)RandomBelow(length);
+            while (from > 0 && text[from - 1] != '\n') {
+                from--;
+            }
+            to = from + (size_t)RandomBelow(length - from + 1);
+            while (to < length && text[to - 1] != '\n') {
+                to++;
+            }
+        }
+
+        LineSortOptions options = { 0 };
+        options.unique = RandomBelow(2) == 0;
+        options.threadCount = 1 + (unsigned)RandomBelow(4);
+        options.tempPrefix = lineCount > 4096 ? TESTS_SORT_RUN_PREFIX : NULL;
+        options.memoryBudget = 0;
+        Document* document = DocumentCreateFromText(text, length);
+        LineSortResult result = { 0 };
+        size_t expectedLength;
+        size_t expectedLines;
+        char* saved = text[to] == '\0' ? NULL : text + to;
+        char savedByte = saved ? *saved : '\0';
+        if (saved) {
+            *saved = '\0';
+        }
+        char* expected = SortReference(text + from, to - from, options.unique, &expectedLength, &expectedLines);
+        if (saved) {
+            *saved = savedByte;
+        }
+        if (!document || !expected || !LineSortRun(document, from, to - from, &options, &result)) {
+            passed = Fail(round, "sorting %zu bytes failed", to - from);
+        } else {
+            char* sorted = (char*)malloc(result.length + 1);
+            size_t position = 0;
+            for (size_t r = 0; sorted && r < result.count; r++) {
+                position += DocumentRead(document, result.ranges[r].offset, sorted + position,
+                                         (size_t)result.ranges[r].length);
+            }
+            if (!sorted || position != expectedLength || memcmp(sorted, expected, expectedLength) != 0) {
+                passed = Fail(round, "%s of %zu lines differs from qsort", options.unique ? "unique" : "sort",
+                              lineCount);
+            } else if (result.outputLines != expectedLines) {
+                passed = Fail(round, "the result counts %llu lines instead of %zu",
+                              (unsigned long long)result.outputLines, expectedLines);
+            }
+            free(sorted);
+        }
+        LineSortResultFree(&result);
+        DocumentDestroy(document);
+        free(expected);
+        free(text);
+    }
+    return passed;
+}
+
+/**
+ * @brief Formats a text line by line, as the format stages are documented.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param stages TEXT_FORMAT_ stages.
+ * @param tabWidth Columns between tab stops.
+ * @param output Receives the formatted text; needs length * tabWidth + 2 bytes.
+ * @return Length of the formatted text.
+ */
+static size_t FormatReference(const char* text, size_t length, unsigned stages, unsigned tabWidth, char* output) {
+    bool trim = (stages & TEXT_FORMAT_TRIM_TRAILING) != 0;
+    bool expand = (stages & TEXT_FORMAT_EXPAND_TABS) != 0;
+    size_t position = 0;
+    bool crlf = false;
+    for (size_t start = 0; start < length;) {
+        size_t end = start;
+        while (end < length && text[end] != '\n') {
+            end++;
+        }
+        bool lineFeed = end < length;
+
+        // A carriage return ending the line stays; the blanks before it go
+        size_t contentEnd = end;
+        bool carriageReturn = trim && contentEnd > start && text[contentEnd - 1] == '\r';
+        if (carriageReturn) {
+            contentEnd--;
+        }
+        while (trim && contentEnd > start && (text[contentEnd - 1] == ' ' || text[contentEnd - 1] == '\t')) {
+            contentEnd--;
+        }
+
+        size_t column = 0;
+        for (size_t i = start; i < contentEnd; i++) {
+            if (expand && text[i] == '\t') {
+                for (size_t spaces = tabWidth - column % tabWidth; spaces > 0; spaces--) {
+                    output[position++] = ' ';
+                    column++;
+                }
+            } else {
+                output[position++] = text[i];
+                column++;
+            }
+        }
+        if (carriageReturn) {
+            output[position++] = '\r';
+        }
+        if (lineFeed) {
+            crlf = end > 0 && text[end - 1] == '\r';
+            output[position++] = '\n';
+        }
+        start = end + 1;
+    }
+
+    if ((stages & TEXT_FORMAT_FINAL_NEWLINE) && position > 0 && output[position - 1] != '\n') {
+        if (crlf && output[position - 1] != '\r') {
+            output[position++] = '\r';
+        }
+        output[position++] = '\n';
+    }
+    return position;
+}
+
+// Formatted text collected from a format pass
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} FormatOutput;
+
+/**
+ * @brief Appends formatted text to the collected output.
+ *
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @param context The output.
+ * @return true, or false if the output is full.
+ */
+static bool CollectFormatted(const char* data, size_t length, void* context) {
+    FormatOutput* output = (FormatOutput*)context;
+    if (length > output->capacity - output->length) {
+        return false;
+    }
+    memcpy(output->data + output->length, data, length);
+    output->length += length;
+    return true;
+}
+
+/**
+ * @brief Compares format passes with a line-by-line formatter.
+ *
+ * The text reaches the formatter in random spans, as the pieces of a
+ * document reach it on save. The recorded edits, applied to a document of
+ * the input, must give the saved text, and formatting the document in
+ * place must too, as one undoable step.
+ *
+ * @return true if every round passed, false otherwise.
+ */
+static bool TestFormat(void) {
+    enum { ROUNDS = 20000, MAX_LENGTH = 300 };
+    static const char alphabet[] = { 'a', 'b', ' ', ' ', '\t', '\t', '\r', '\n', '\n' };
+    static const unsigned tabWidths[] = { 1, 3, 4, 8, TEXT_FORMAT_MAX_TAB_WIDTH };
+    char text[MAX_LENGTH];
+    size_t capacity = MAX_LENGTH * TEXT_FORMAT_MAX_TAB_WIDTH + 2;
+    char* expected = (char*)malloc(capacity);
+    FormatOutput output = { (char*)malloc(capacity), 0, capacity };
+    bool passed = expected && output.data;
+    if (!passed) {
+        Fail(0, "out of memory");
+    }
+
+    for (unsigned round = 0; passed && round < ROUNDS; round++) {
+        size_t length = (size_t)RandomBelow(round % 16 == 0 ? MAX_LENGTH : 24);
+        bool tabRuns = RandomBelow(8) == 0;
+        for (size_t i = 0; i < length; i++) {
+            text[i] = tabRuns ? (RandomBelow(4) == 0 ? 'a' : '\t') : alphabet[RandomBelow(sizeof(alphabet))];
+        }
+        TextFormatOptions options = { 0 };
+        options.stages = (unsigned)RandomBelow(TEXT_FORMAT_ALL_STAGES + 1);
+        options.tabWidth = tabWidths[RandomBelow(sizeof(tabWidths) / sizeof(tabWidths[0]))];
+        size_t expectedLength = FormatReference(text, length, options.stages, options.tabWidth, expected);
+
+        TextFormatter formatter;
+        output.length = 0;
+        TextFormatterInit(&formatter, &options, CollectFormatted, &output, true);
+        for (size_t position = 0; position < length;) {
+            size_t span = 1 + (size_t)RandomBelow(RandomBelow(2) == 0 ? 4 : length - position);
+            if (span > length - position) {
+                span = length - position;
+            }
+            TextFormatterWrite(&formatter, text + position, span);
+            position += span;
+        }
+        const DocumentEdit* edits;
+        size_t editCount;
+        if (!TextFormatterFinish(&formatter) || !TextFormatterGetEdits(&formatter, &edits, &editCount)) {
+            TextFormatterFree(&formatter);
+            passed = Fail(round, "the format pass failed");
+            break;
+        }
+        if (output.length != expectedLength || memcmp(output.data, expected, expectedLength) != 0) {
+            TextFormatterFree(&formatter);
+            passed = Fail(round, "stages %u, tab width %u: the formatted text differs", options.stages,
+                          options.tabWidth);
+            break;
+        }
+
+        // The recorded edits turn the input into the saved text
+        Document* saved = DocumentCreateFromText(text, length);
+        Document* formatted = DocumentCreateFromText(text, length);
+        if (!saved || (editCount > 0 && !DocumentApplyEdits(saved, edits, editCount)) ||
+            !DocumentEquals(saved, expected, expectedLength)) {
+            passed = Fail(round, "stages %u, tab width %u: the %zu recorded edits do not give the saved text",
+                          options.stages, options.tabWidth, editCount);
+        } else if (!formatted || !TextFormatDocument(formatted, &options, NULL) ||
+                   !DocumentEquals(formatted, expected, expectedLength)) {
+            passed = Fail(round, "formatting the document in place differs");
+        } else if (editCount > 0) {
+            size_t changeCount;
+            DocumentUndo(formatted, &changeCount);
+            if (!DocumentEquals(formatted, text, length)) {
+                passed = Fail(round, "undoing the format does not restore the text");
+            }
+        }
+        DocumentDestroy(saved);
+        DocumentDestroy(formatted);
+        TextFormatterFree(&formatter);
+    }
+
+    free(expected);
+    free(output.data);
+    return passed;
+}
+
+// A fold as the fold test expects it, in lines
+typedef struct {
+    uint64_t firstLine;
+    uint64_t lastLine;
+} ModelFold;
+
+// Folds of the fold test, moved by a document listener of their own
+typedef struct {
+    FoldSet* folds;             // The fold set under test, mapped by the same listener
+    const char* before;         // Text of the document before the change
+    ModelFold items[TESTS_MAX_FOLDS];
+    size_t count;
+    bool failed;                // A change was reported without its ranges, or memory ran out
+} FoldModel;
+
+/**
+ * @brief Finds the start of a line of a text.
+ *
+ * @param text The text.
+ * @param line The line; it must exist.
+ * @return Offset of the line start.
+ */
+static uint64_t TextLineStart(const char* text, uint64_t line) {
+    uint64_t offset = 0;
+    for (; line > 0; line--) {
+        offset += strcspn(text + offset, "\n") + 1;
+    }
+    return offset;
+}
+
+
+/**
+ * @brief Maps the fold set and the model folds through a document change.
+ *
+ * A model fold goes when a change reaches from the line break above its
+ * hidden lines to the start of its last hidden line; the others move by
+ * the line breaks added and removed above them.
+ *
+ * @param document The document, already changed.
+ * @param changes The changes, in the coordinates before the batch.
+ * @param changeCount Number of changes.
+ * @param context The fold model.
+ */
+static void FoldModelChanged(Document* document, const DocumentChange* changes, size_t changeCount, void* context) {
+    FoldModel* model = (FoldModel*)context;
+    FoldSetMapChanges(model->folds, changes, changeCount);
+    char* after = changes ? DocumentCopyRange(document, 0, DocumentLength(document)) : NULL;
+    int64_t* lineShifts = changes ? (int64_t*)malloc(changeCount * sizeof(int64_t)) : NULL;
+    if (!after || !lineShifts) {
+        model->failed = true;
+        free(after);
+        free(lineShifts);
+        return;
+    }
+
+    // Line breaks each change adds: inserted ones are found in the text after the batch
+    int64_t lengthShift = 0;
+    for (size_t c = 0; c < changeCount; c++) {
+        const DocumentChange* change = &changes[c];
+        uint64_t insertedAt = (uint64_t)((int64_t)change->offset + lengthShift);
+        lineShifts[c] = (int64_t)CountLineFeeds(after + insertedAt, (size_t)change->insertedLength) -
+                        (int64_t)CountLineFeeds(model->before + change->offset, (size_t)change->removedLength);
+        lengthShift += (int64_t)change->insertedLength - (int64_t)change->removedLength;
+    }
+
+    size_t kept = 0;
+    for (size_t f = 0; f < model->count; f++) {
+        ModelFold fold = model->items[f];
+        uint64_t hideStart = TextLineStart(model->before, fold.firstLine);
+        uint64_t hideLast = TextLineStart(model->before, fold.lastLine);
+        bool touched = false;
+        int64_t shift = 0;
+        for (size_t c = 0; c < changeCount; c++) {
+            if (changes[c].offset <= hideLast && changes[c].offset + changes[c].removedLength >= hideStart) {
+                touched = true;
+            } else if (changes[c].offset < hideStart) {
+                shift += lineShifts[c];
+            }
+        }
+        if (!touched) {
+            fold.firstLine = (uint64_t)((int64_t)fold.firstLine + shift);
+            fold.lastLine = (uint64_t)((int64_t)fold.lastLine + shift);
+            model->items[kept++] = fold;
+        }
+    }
+    model->count = kept;
+    free(after);
+    free(lineShifts);
+}
+
+/**
+ * @brief Checks the hidden lines and the row mapping of a fold set against the model.
+ *
+ * @param round The round, for failure messages.
+ * @param model The model, holding the fold set.
+ * @param document The document.
+ * @return true if they agree, false otherwise.
+ */
+static bool CheckFolds(unsigned round, FoldModel* model, const Document* document) {
+    uint64_t lineCount = DocumentLineCount(document);
+    bool* hidden = (bool*)calloc((size_t)lineCount + 1, sizeof(bool));
+    if (!hidden) {
+        return Fail(round, "out of memory");
+    }
+    uint64_t hiddenCount = 0;
+    for (size_t f = 0; f < model->count; f++) {
+        for (uint64_t line = model->items[f].firstLine; line <= model->items[f].lastLine; line++) {
+            hiddenCount += !hidden[line];
+            hidden[line] = true;
+        }
+    }
+
+    bool passed = true;
+    if (FoldSetVisibleLineCount(model->folds, document) != lineCount - hiddenCount) {
+        passed = Fail(round, "%llu lines are visible instead of %llu",
+                      (unsigned long long)FoldSetVisibleLineCount(model->folds, document),
+                      (unsigned long long)(lineCount - hiddenCount));
+    }
+    uint64_t row = 0;
+    for (uint64_t line = 0; passed && line < lineCount; line++) {
+        bool header = !hidden[line] && line + 1 < lineCount && hidden[line + 1];
+        if (FoldSetIsHidden(model->folds, document, line) != hidden[line]) {
+            passed = Fail(round, "line %llu should be %s", (unsigned long long)line, hidden[line] ? "hidden" : "shown");
+        } else if (FoldSetIsHeader(model->folds, document, line) != header) {
+            passed = Fail(round, "line %llu should %sbe a fold header", (unsigned long long)line, header ? "" : "not ");
+        } else if (hidden[line] ? FoldSetRowFromLine(model->folds, document, line) != row - 1
+                                : FoldSetRowFromLine(model->folds, document, line) != row ||
+                                  FoldSetLineFromRow(model->folds, document, row) != line) {
+            passed = Fail(round, "line %llu and row %llu do not map to each other", (unsigned long long)line,
+                          (unsigned long long)row);
+        }
+        row += !hidden[line];
+    }
+    free(hidden);
+    return passed;
+}
+
+/**
+ * @brief Compares folds moved through edits, undo and redo with line ranges moved by the line breaks.
+ *
+ * @return true if every round passed, false otherwise.
+ */
+static bool TestFoldSetEdits(void) {
+    enum { ROUNDS = 2000, LINES = 150 };
+    static const char* const insertions[] = { "x", "\n", "a\nb\n", "\n\n\n", "" };
+    char text[LINES * 8];
+    size_t length = 0;
+    for (int line = 0; line < LINES; line++) {
+        length += (size_t)sprintf(text + length, "line%d\n", line % 100);
+    }
+
+    FoldSet folds;
+    FoldSetInit(&folds);
+    FoldModel* model = (FoldModel*)calloc(1, sizeof(FoldModel));
+    Document* document = DocumentCreateFromText(text, length);
+    bool passed = model && document && DocumentAddListener(document, FoldModelChanged, model);
+    if (!passed) {
+        Fail(0, "out of memory");
+    } else {
+        model->folds = &folds;
+    }
+
+    for (unsigned round = 0; passed && round < ROUNDS; round++) {
+        uint64_t lineCount = DocumentLineCount(document);
+        uint64_t documentLength = DocumentLength(document);
+        char* before = DocumentCopyRange(document, 0, documentLength);
+        if (!before) {
+            passed = Fail(round, "out of memory");
+            break;
+        }
+        model->before = before;
+
+        uint64_t action = RandomBelow(10);
+        if (action < 3 && model->count < TESTS_MAX_FOLDS && lineCount > 1) {
+            ModelFold* fold = &model->items[model->count];
+            fold->firstLine = 1 + RandomBelow(lineCount - 1);
+            fold->lastLine = fold->firstLine + RandomBelow(lineCount - fold->firstLine < 12
+                                                           ? lineCount - fold->firstLine : 12);
+            if (!FoldSetAdd(&folds, document, fold->firstLine, fold->lastLine)) {
+                passed = Fail(round, "lines %llu-%llu could not be folded", (unsigned long long)fold->firstLine,
+                              (unsigned long long)fold->lastLine);
+            }
+            model->count++;
+        } else if (action == 3) {
+            size_t changeCount;
+            DocumentUndo(document, &changeCount);
+        } else if (action == 4) {
+            size_t changeCount;
+            DocumentRedo(document, &changeCount);
+        } else {
+            DocumentEdit edits[2];
+            size_t editCount = 0;
+            uint64_t from = 0;
+            for (uint64_t count = 1 + RandomBelow(2); count > 0 && from <= documentLength; count--) {
+                DocumentEdit* edit = &edits[editCount++];
+                edit->offset = from + RandomBelow(documentLength - from + 1);
+                uint64_t room = documentLength - edit->offset;
+                edit->removeLength = RandomBelow(2) == 0 ? 0 : RandomBelow(room < 30 ? room + 1 : 30);
+                edit->text = insertions[RandomBelow(sizeof(insertions) / sizeof(insertions[0]))];
+                edit->textLength = strlen(edit->text);
+                edit->slice = NULL;
+                from = edit->offset + edit->removeLength + 1;
+                if (edit->removeLength == 0 && edit->textLength == 0) {
+                    editCount--;
+                }
+            }
+            if (editCount > 0 && !DocumentApplyEdits(document, edits, editCount)) {
+                passed = Fail(round, "an edit failed");
+            }
+        }
+        model->before = NULL;
+        free(before);
+
+        if (passed && model->failed) {
+            passed = Fail(round, "a change was reported without its ranges");
+        }
+        passed = passed && CheckFolds(round, model, document);
+    }
+
+    DocumentDestroy(document);
+    FoldSetFree(&folds);
+    free(model);
+    return passed;
+}
+
+// Lines the structure test builds its text from, before indentation
+static const char* const g_codeLines[] = {
+    "if (ready) {", "}", "call(a, [1, 2]);", "text = \"{ [ (\";", "// closes } later", "table = {a: (1)};",
+    "", "value += 1;", "while (x) {", "} else {", "list = [", "];", "args(", ")"
+};
+
+// Snippets the structure test inserts
+static const char* const g_codeSnippets[] = {
+    "{", "}", "(", ")", "[", "]", "\n", "\"", "//", "    ", "\n    {\n", "x", "\n}\n"
+};
+
+/**
+ * @brief Compares the fold ranges and bracket matches of an edited structure index with a new index.
+ *
+ * The text spans many blocks of the index; edits, large deletions, undo
+ * and redo rescan only the blocks they touch in the edited index.
+ *
+ * @return true if every round passed, false otherwise.
+ */
+static bool TestStructureEdits(void) {
+    enum { ROUNDS = 300, LINES = 4000, PROBES = 40 };
+    size_t lineVocabulary = sizeof(g_codeLines) / sizeof(g_codeLines[0]);
+    size_t snippetVocabulary = sizeof(g_codeSnippets) / sizeof(g_codeSnippets[0]);
+    char* text = (char*)malloc(LINES * 64);
+    if (!text) {
+        return Fail(0, "out of memory");
+    }
+    size_t length = 0;
+    uint64_t depth = 0;
+    for (int line = 0; line < LINES; line++) {
+        const char* code = g_codeLines[RandomBelow(lineVocabulary)];
+        depth = code[0] == '}' || code[0] == ']' || code[0] == ')' ? (depth > 0 ? depth - 1 : 0) : depth;
+        length += (size_t)sprintf(text + length, "%*s%s\n", (int)(4 * (depth % 8)), "", code);
+        char last = code[0] ? code[strlen(code) - 1] : '\0';
+        depth += last == '{' || last == '[' || last == '(';
+    }
+
+    Document* document = DocumentCreateFromText(text, length);
+    StructureIndex* edited = document ? StructureIndexCreate(document) : NULL;
+    uint64_t header;
+    uint64_t last;
+    bool passed = edited != NULL;
+    if (!passed) {
+        Fail(0, "out of memory");
+    } else {
+        StructureFindFoldRange(edited, 0, &header, &last); // Builds the index before the first edit
+    }
+
+    for (unsigned round = 0; passed && round < ROUNDS; round++) {
+        uint64_t documentLength = DocumentLength(document);
+        uint64_t action = RandomBelow(10);
+        if (action == 0) {
+            size_t changeCount;
+            DocumentUndo(document, &changeCount);
+        } else if (action == 1) {
+            size_t changeCount;
+            DocumentRedo(document, &changeCount);
+        } else {
+            DocumentEdit edit;
+            edit.offset = RandomBelow(documentLength + 1);
+            uint64_t room = documentLength - edit.offset;
+            uint64_t removeLimit = action == 2 ? 40000 : 20;
+            edit.removeLength = RandomBelow(2) == 0 ? 0 : RandomBelow(room < removeLimit ? room + 1 : removeLimit);
+            edit.text = g_codeSnippets[RandomBelow(snippetVocabulary)];
+            edit.textLength = strlen(edit.text);
+            edit.slice = NULL;
+            if (!DocumentApplyEdits(document, &edit, 1)) {
+                passed = Fail(round, "an edit failed");
+                break;
+            }
+        }
+
+        StructureIndex* fresh = StructureIndexCreate(document);
+        if (!fresh) {
+            passed = Fail(round, "out of memory");
+            break;
+        }
+        uint64_t lineCount = DocumentLineCount(document);
+        documentLength = DocumentLength(document);
+        for (int probe = 0; passed && probe < PROBES; probe++) {
+            uint64_t line = RandomBelow(lineCount);
+            uint64_t freshHeader = 0;
+            uint64_t freshLast = 0;
+            header = 0;
+            last = 0;
+            bool found = StructureFindFoldRange(edited, line, &header, &last);
+            if (found != StructureFindFoldRange(fresh, line, &freshHeader, &freshLast) ||
+                (found && (header != freshHeader || last != freshLast))) {
+                passed = Fail(round, "the fold range at line %llu differs from a new index", (unsigned long long)line);
+                break;
+            }
+
+            uint64_t offset = RandomBelow(documentLength);
+            uint64_t match = 0;
+            uint64_t freshMatch = 0;
+            found = StructureFindMatchingBracket(edited, offset, &match);
+            if (found != StructureFindMatchingBracket(fresh, offset, &freshMatch) || (found && match != freshMatch)) {
+                passed = Fail(round, "the bracket match at %llu differs from a new index", (unsigned long long)offset);
+            }
+        }
+        StructureIndexDestroy(fresh);
+    }
+
+    StructureIndexDestroy(edited);
+    DocumentDestroy(document);
+    free(text);
+    return passed;
+}
+
+/**
+ * @brief Checks folds and fold ranges after edits.
+ *
+ * @return true if both parts passed, false otherwise.
+ */
+static bool TestFolds(void) {
+    bool foldSetPassed = TestFoldSetEdits();
+    return TestStructureEdits() && foldSetPassed;
+}
+
+// Tests by name, in the order they run when no name is given
+static const struct {
+    const char* name;
+    bool (*run)(void);
+} g_tests[] = {
+    { "diff", TestDiff },
+    { "markers", TestMarkers },
+    { "sort", TestSort },
+    { "format", TestFormat },
+    { "folds", TestFolds }
+};
+
+/**
+ * @brief Runs one test, or all of them.
+ *
+ * @param argc Number of arguments.
+ * @param argv The arguments: the name of a test, or none.
+ * @return 0 if every test that ran passed, 1 otherwise.
+ */
+int main(int argc, char** argv) {
+    size_t testCount = sizeof(g_tests) / sizeof(g_tests[0]);
+    bool found = argc < 2;
+    bool passed = true;
+    for (size_t t = 0; t < testCount; t++) {
+        if (argc >= 2 && strcmp(argv[1], g_tests[t].name) != 0) {
+            continue;
+        }
+        found = true;
+        g_testName = g_tests[t].name;
+        g_random = 0x9E3779B97F4A7C15ull;
+        bool testPassed = g_tests[t].run();
+        printf("editor_tests: %s %s\n", g_tests[t].name, testPassed ? "passed" : "FAILED");
+        passed = passed && testPassed;
+    }
+    if (!found) {
+        fprintf(stderr, "editor_tests: unknown test '%s'\n", argv[1]);
+        return 1;
+    }
+    return passed ? 0 : 1;
+}
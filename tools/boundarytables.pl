@@ -0,0 +1,136 @@
+#!/usr/bin/env perl
+#
+# Generates src/boundarytables.c, the Unicode property tables used by
+# boundary.c, from the Unicode Character Database shipped with Perl.
+#
+# Every code point gets one property byte:
+#   bits 0-3  grapheme cluster break property
+#   bits 4-5  word class used by word movement and selection
+#   bits 6-7  line break class
+# The bytes are stored as a two-level table: the code point divided by the
+# block size indexes a table of block numbers, and identical blocks are
+# stored once.
+#
+# Usage: perl tools/boundarytables.pl > src/boundarytables.c
+
+use strict;
+use warnings;
+use Unicode::UCD qw(prop_invmap prop_invlist);
+
+my $BLOCK_SHIFT = 7;
+my $BLOCK_SIZE = 1 << $BLOCK_SHIFT;
+my $CODE_POINTS = 0x110000;
+
+# Values must match the BOUNDARY_GRAPHEME_* constants of boundary.c
+my %GRAPHEME = (
+    Other => 0, CR => 1, LF => 2, Control => 3, Extend => 4, ZWJ => 5, Regional_Indicator => 6, Prepend => 7,
+    SpacingMark => 8, L => 9, V => 10, T => 11, LV => 12, LVT => 13, ExtPict_XX => 14,
+);
+
+# Values must match BoundaryClass in boundary.h
+my ($SPACE, $WORD, $IDEOGRAPH, $PUNCTUATION) = (0, 1, 2, 3);
+
+# Values must match the BOUNDARY_LINE_* constants of boundary.c
+my ($LINE_OTHER, $LINE_CLOSE, $LINE_OPEN, $LINE_HYPHEN) = (0, 1, 2, 3);
+my %LINE = (
+    CL => $LINE_CLOSE, CP => $LINE_CLOSE, EX => $LINE_CLOSE, IS => $LINE_CLOSE, NS => $LINE_CLOSE,
+    CJ => $LINE_CLOSE, OP => $LINE_OPEN, HY => $LINE_HYPHEN, BA => $LINE_HYPHEN,
+);
+
+# Expands an enumerated property into one value per code point
+sub expand_map {
+    my ($property) = @_;
+    my ($ranges, $values) = prop_invmap($property);
+    die "Unknown property $property\n" unless $ranges;
+    my @result;
+    for my $i (0 .. $#$ranges) {
+        my $end = $i < $#$ranges ? $ranges->[$i + 1] : $CODE_POINTS;
+        $result[$_] = $values->[$i] for $ranges->[$i] .. $end - 1;
+    }
+    return \@result;
+}
+
+# Expands a binary property into one flag per code point
+sub expand_list {
+    my ($property) = @_;
+    my @ranges = prop_invlist($property);
+    my @result = (0) x $CODE_POINTS;
+    for (my $i = 0; $i < @ranges; $i += 2) {
+        my $end = $i + 1 < @ranges ? $ranges[$i + 1] : $CODE_POINTS;
+        $result[$_] = 1 for $ranges[$i] .. $end - 1;
+    }
+    return \@result;
+}
+
+my $grapheme = expand_map('Grapheme_Cluster_Break');
+my $wordBreak = expand_map('Word_Break');
+my $lineBreak = expand_map('Line_Break');
+my $category = expand_map('General_Category');
+my $space = expand_list('White_Space');
+my $ideographic = expand_list('Ideographic');
+my $hiragana = expand_list('Script=Hiragana');
+
+my @properties;
+for my $c (0 .. $CODE_POINTS - 1) {
+    my $g = $GRAPHEME{$grapheme->[$c]};
+    die sprintf("Unexpected grapheme break value %s at U+%04X\n", $grapheme->[$c], $c) unless defined $g;
+
+    my $class = $PUNCTUATION;
+    if ($space->[$c]) {
+        $class = $SPACE;
+    } elsif ($ideographic->[$c] || $hiragana->[$c] || $wordBreak->[$c] eq 'Katakana') {
+        $class = $IDEOGRAPH;
+    } elsif ($wordBreak->[$c] =~ /^(ALetter|Hebrew_Letter|Numeric|ExtendNumLet)$/ ||
+             $category->[$c] =~ /^(L|M|N)/ || $category->[$c] eq 'Pc') {
+        $class = $WORD;
+    }
+
+    my $line = $LINE{$lineBreak->[$c]} // $LINE_OTHER;
+    push @properties, $g | ($class << 4) | ($line << 6);
+}
+
+# Store each distinct block once
+my (@blocks, @data, %seen);
+for (my $start = 0; $start < $CODE_POINTS; $start += $BLOCK_SIZE) {
+    my $key = pack('C*', @properties[$start .. $start + $BLOCK_SIZE - 1]);
+    unless (exists $seen{$key}) {
+        $seen{$key} = scalar(keys %seen);
+        push @data, @properties[$start .. $start + $BLOCK_SIZE - 1];
+    }
+    push @blocks, $seen{$key};
+}
+die "Too many distinct blocks for one-byte block numbers\n" if keys(%seen) > 256;
+
+# Prints numbers as C initializer rows
+sub print_rows {
+    my ($values, $perRow) = @_;
+    for (my $i = 0; $i < @$values; $i += $perRow) {
+        my $last = $i + $perRow - 1 < $#$values ? $i + $perRow - 1 : $#$values;
+        print '    ', join(', ', @$values[$i .. $last]), ($last < $#$values ? ',' : ''), "\n";
+    }
+}
+
+my $version = Unicode::UCD::UnicodeVersion();
+print <<"END";
+/**
+ * \@file boundarytables.c
+ * \@brief Unicode property tables for text boundaries in the Professional Text Editor
+ *
+ * Generated by tools/boundarytables.pl from the Unicode Character Database
+ * $version. Do not edit; run the script again instead.
+ */
+
+#include <stdint.h>
+
+// Block number of every $BLOCK_SIZE code points
+const uint8_t g_boundaryBlocks[${\ scalar(@blocks)}] = {
+END
+print_rows(\@blocks, 24);
+print <<"END";
+};
+
+// Property bytes of the distinct blocks
+const uint8_t g_boundaryProperties[${\ scalar(@data)}] = {
+END
+print_rows(\@data, 24);
+print "};\n";
@@ -0,0 +1,1877 @@
+/**
+ * @file editor_tty.c
+ * @brief Terminal frontend of the Professional Text Editor
+ *
+ * Contains a text-mode editor for POSIX terminals, for use over SSH. It
+ * edits the same piece table document as the Win32 editor, with the same
+ * cursor, search and layout code, and draws through the cell screen, which
+ * sends the terminal only what changed since the previous frame.
+ *
+ * Input is read without blocking. Every byte already available is handled
+ * before the next frame is drawn, so a burst of keys (typing ahead, key
+ * repeat, a slow link delivering input in clumps) costs one frame, and
+ * consecutive printable characters are inserted as one edit. Pastes from
+ * the terminal arrive in bracketed paste mode and are inserted at once.
+ *
+ * Keys: arrows, Home, End, Page Up/Down (with Shift to select, Ctrl for
+ * words and document ends); Ctrl+S save, Ctrl+Q quit, Ctrl+F find, F3 find
+ * next, Ctrl+G go to line, Ctrl+Z undo, Ctrl+Y redo, Ctrl+A select all,
+ * Ctrl+C copy, Ctrl+X cut, Ctrl+V paste, Ctrl+D add next occurrence,
+ * Ctrl+R record a macro, Ctrl+P play it, Ctrl+B toggle a bookmark, F2 next
+ * bookmark (Shift+F2 previous), Ctrl+K show only the lines containing some
+ * text, Ctrl+T go to a time in a log, Ctrl+E format the whitespace, Ctrl+L
+ * redraw, Esc show every line again, or single caret and no search
+ * highlights.
+ *
+ * Every match of the search text is underlined. Matches and bookmarks are
+ * markers of the document, which move with the text as it is edited. While
+ * filtering, the rows show the matching lines of the line filter, which is
+ * updated from the document's change notification. Going to a time
+ * searches the timestamp index of a log for the first line at that time.
+ *
+ * With --format-on-save, a save trims trailing whitespace, expands tabs
+ * and adds the final line break in the same pass that writes the file,
+ * and then applies the same changes to the document as one undo step.
+ */
+
+#define _POSIX_C_SOURCE 200809L // For sigaction and pipe2-free non-blocking pipes
+
+#include "../include/clipboard.h"
+#include "../include/cursors.h"
+#include "../include/document.h"
+#include "../include/filewriter.h"
+#include "../include/layout.h"
+#include "../include/linefilter.h"
+#include "../include/macro.h"
+#include "../include/markers.h"
+#include "../include/memory.h"
+#include "../include/screen.h"
+#include "../include/search.h"
+#include "../include/textformat.h"
+#include "../include/thread.h"
+#include "../include/timeindex.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define TTY_INPUT_SIZE 65536            // Bytes of input handled per frame at most
+#define TTY_ESCAPE_TIMEOUT_MS 25        // Wait for the rest of an escape sequence before taking Esc
+#define TTY_MAX_PROMPT 256
+#define TTY_MAX_PATH 4096
+#define TTY_MAX_SEARCH_HITS 1000000     // Matches highlighted at most
+
+// Bytes sent through the wake-up pipe; progress is sent as 0..100
+#define TTY_WAKE_RESIZE 0xFE
+#define TTY_WAKE_SAVE_DONE 0xFF
+
+// Bracketed paste markers
+#define TTY_PASTE_START "\x1b[200~"
+#define TTY_PASTE_END "\x1b[201~"
+#define TTY_PASTE_MARKER_LENGTH 6
+
+// Decoded keys other than text
+typedef enum {
+    KEY_NONE,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_HOME,
+    KEY_END,
+    KEY_PAGE_UP,
+    KEY_PAGE_DOWN,
+    KEY_DELETE,
+    KEY_BACKSPACE,
+    KEY_ENTER,
+    KEY_ESCAPE,
+    KEY_F2,
+    KEY_F3,
+    KEY_CONTROL,        // Ctrl with a letter
+    KEY_PASTE_START
+} KeyCode;
+
+typedef struct {
+    KeyCode code;
+    bool shift;
+    bool control;
+    char letter;        // Lower-case letter of a KEY_CONTROL key
+} Key;
+
+// What the status line is asking for
+typedef enum {
+    PROMPT_NONE,
+    PROMPT_FIND,
+    PROMPT_GOTO,
+    PROMPT_SAVE_AS,
+    PROMPT_MACRO,
+    PROMPT_FILTER,
+    PROMPT_TIME,
+    PROMPT_FORMAT
+} PromptKind;
+
+// Save running on a worker thread from a snapshot
+typedef struct {
+    DocumentSnapshot* snapshot;
+    char filePath[TTY_MAX_PATH];
+    bool formatting;                    // The text passes through the formatter on its way to the file
+    TextFormatter formatter;            // Records the changes, so the document can be made equal to the file
+    bool succeeded;
+    Thread* thread;
+} SaveJob;
+
+typedef struct {
+    Document* document;
+    LayoutCache* layout;                // Segment summaries of long lines, or NULL
+    MarkerTree* markers;                // Bookmarks and search hits, or NULL
+    LineFilter* filter;                 // Lines shown while filtering, or NULL to show every line
+    TimeIndex* times;                   // Timestamps of a log, or NULL if the document has none
+    CursorSet cursors;
+    char filePath[TTY_MAX_PATH];        // Empty for a new document
+    Screen* screen;
+    unsigned textRows;                  // Rows above the status line
+    uint64_t topLine;
+    uint64_t filterTop;                 // First row shown while filtering
+    uint64_t leftColumn;
+    char* cells;                        // One line of laid out text
+    char message[256];
+    PromptKind prompt;
+    char promptText[TTY_MAX_PROMPT];
+    size_t promptLength;
+    char search[TTY_MAX_PROMPT];
+    Macro macro;
+    bool recording;                     // Typing, deleting and caret movement go into the macro
+    bool quitArmed;                     // Ctrl+Q pressed once with unsaved changes
+    bool quit;
+    SaveJob save;
+    int savePercent;                    // -1 when no save is running
+    unsigned formatOnSave;              // TEXT_FORMAT_ stages applied to the text as it is saved
+    bool formatting;                    // Edits of a format pass are being applied; the carets move with them
+    bool pasting;                       // Between bracketed paste markers
+    char* paste;
+    size_t pasteLength;
+    size_t pasteCapacity;
+} TtyEditor;
+
+static int g_wakePipe[2] = { -1, -1 };
+static struct termios g_savedTerminal;
+
+/**
+ * @brief Writes every byte to the terminal.
+ *
+ * @param data The bytes.
+ * @param length Number of bytes.
+ */
+static void WriteTerminal(const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+/**
+ * @brief Wakes the main loop from a signal handler or the save thread.
+ *
+ * @param code TTY_WAKE_ code or save progress.
+ */
+static void Wake(unsigned char code) {
+    ssize_t written = write(g_wakePipe[1], &code, 1);
+    (void)written; // A full pipe already holds a wake-up
+}
+
+/**
+ * @brief Notes a change of the terminal size.
+ *
+ * @param signal SIGWINCH.
+ */
+static void HandleResize(int signal) {
+    (void)signal;
+    int saved = errno;
+    Wake(TTY_WAKE_RESIZE);
+    errno = saved;
+}
+
+/**
+ * @brief Switches the terminal to raw input and the alternate screen.
+ *
+ * Reads return at once with whatever is available (VMIN and VTIME 0),
+ * which leaves stdin in blocking mode for other programs sharing it.
+ *
+ * @return true if successful, false if stdin is not a terminal.
+ */
+static bool EnterRawMode(void) {
+    if (tcgetattr(STDIN_FILENO, &g_savedTerminal) != 0) {
+        return false;
+    }
+    struct termios raw = g_savedTerminal;
+    raw.c_iflag &= ~(tcflag_t)(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_oflag &= ~(tcflag_t)OPOST;
+    raw.c_cflag |= CS8;
+    raw.c_lflag &= ~(tcflag_t)(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0) {
+        return false;
+    }
+
+    // Alternate screen, bracketed paste
+    static const char enter[] = "\x1b[?1049h\x1b[?2004h";
+    WriteTerminal(enter, sizeof(enter) - 1);
+    return true;
+}
+
+/**
+ * @brief Restores the terminal as it was before EnterRawMode.
+ */
+static void LeaveRawMode(void) {
+    static const char leave[] = "\x1b[0m\x1b[?2004l\x1b[?25h\x1b[?1049l";
+    WriteTerminal(leave, sizeof(leave) - 1);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_savedTerminal);
+}
+
+/**
+ * @brief Gets the line terminator inserted by Enter.
+ *
+ * @param document The document.
+ * @return "\r\n" if the first line ends with one, "\n" otherwise.
+ */
+static const char* LineTerminator(const Document* document) {
+    if (DocumentLineCount(document) > 1) {
+        uint64_t end = DocumentLineEnd(document, 0);
+        if (DocumentCharAt(document, end) == '\r') {
+            return "\r\n";
+        }
+    }
+    return "\n";
+}
+
+/**
+ * @brief Sets the message shown in the status line until the next key.
+ *
+ * @param editor The editor.
+ * @param message The message.
+ */
+static void SetMessage(TtyEditor* editor, const char* message) {
+    snprintf(editor->message, sizeof(editor->message), "%s", message);
+}
+
+/**
+ * @brief Sizes the screen after the terminal.
+ *
+ * @param editor The editor.
+ * @return true if successful, false on allocation failure.
+ */
+static bool UpdateTerminalSize(TtyEditor* editor) {
+    struct winsize size;
+    unsigned rows = 24;
+    unsigned columns = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        rows = size.ws_row;
+        columns = size.ws_col;
+    }
+    rows = rows > 1 ? rows : 2;
+
+    char* cells = (char*)realloc(editor->cells, columns);
+    if (!cells) {
+        return false;
+    }
+    editor->cells = cells;
+    if (!editor->screen) {
+        editor->screen = ScreenCreate(rows, columns);
+    } else if (!ScreenResize(editor->screen, rows, columns)) {
+        return false;
+    }
+    if (!editor->screen) {
+        return false;
+    }
+    editor->textRows = rows - 1;
+    ScreenSetScrollRegion(editor->screen, 0, editor->textRows - 1);
+    return true;
+}
+
+/**
+ * @brief Gets the selection that scrolls into view.
+ *
+ * @param editor The editor.
+ * @return The primary selection.
+ */
+static Selection* PrimarySelection(TtyEditor* editor) {
+    return &editor->cursors.items[editor->cursors.primary];
+}
+
+/**
+ * @brief Scrolls so that the primary caret is visible.
+ *
+ * @param editor The editor.
+ * @param caretRow Row of the caret: its line, or its row of the filter while filtering.
+ * @param caretColumn Display column of the caret.
+ */
+static void ScrollToCaret(TtyEditor* editor, uint64_t caretRow, uint64_t caretColumn) {
+    unsigned columns = ScreenColumns(editor->screen);
+    uint64_t* top = editor->filter ? &editor->filterTop : &editor->topLine;
+    if (caretRow < *top) {
+        *top = caretRow;
+    } else if (caretRow >= *top + editor->textRows) {
+        *top = caretRow - editor->textRows + 1;
+    }
+    if (caretColumn < editor->leftColumn) {
+        editor->leftColumn = caretColumn;
+    } else if (caretColumn >= editor->leftColumn + columns) {
+        editor->leftColumn = caretColumn - columns + 1;
+    }
+}
+
+/**
+ * @brief Gets the code point shown for a byte of laid out text.
+ *
+ * Like the Win32 view, the terminal shows one column per byte. Bytes above
+ * 0x9F are shown as the Latin-1 characters they encode.
+ *
+ * @param c The byte.
+ * @return The code point.
+ */
+static uint32_t CellCodepoint(char c) {
+    unsigned char byte = (unsigned char)c;
+    return (byte >= 0x80 && byte < 0xA0) ? '?' : byte;
+}
+
+/**
+ * @brief Stops a marker query at the first marker.
+ *
+ * @param marker The marker.
+ * @param context Unused.
+ * @return false.
+ */
+static bool StopAtFirst(const Marker* marker, void* context) {
+    (void)marker;
+    (void)context;
+    return false;
+}
+
+// Row whose search hits are being underlined
+typedef struct {
+    TtyEditor* editor;
+    unsigned row;
+    uint64_t lineStart;
+    uint64_t visibleEnd;    // Offset past the last column measured
+    uint8_t attributes;     // Attributes of the text of the row
+} HitRow;
+
+/**
+ * @brief Underlines one search hit of a row.
+ *
+ * @param marker The hit.
+ * @param context The row.
+ * @return true to continue with the next hit.
+ */
+static bool DrawSearchHit(const Marker* marker, void* context) {
+    HitRow* hitRow = (HitRow*)context;
+    TtyEditor* editor = hitRow->editor;
+    if (marker->start == marker->end) {
+        return true; // The matched text was edited away
+    }
+    uint64_t right = editor->leftColumn + ScreenColumns(editor->screen);
+    uint64_t end = marker->end < hitRow->visibleEnd ? marker->end : hitRow->visibleEnd;
+    uint64_t first = marker->start <= hitRow->lineStart
+                         ? 0 : LayoutColumnFromOffset(editor->document, hitRow->lineStart, marker->start);
+    uint64_t last = LayoutColumnFromOffset(editor->document, hitRow->lineStart, end);
+    first = first > editor->leftColumn ? first : editor->leftColumn;
+    last = last < right ? last : right;
+    if (first < last) {
+        ScreenSetAttributes(editor->screen, hitRow->row, (unsigned)(first - editor->leftColumn),
+                            (unsigned)(last - first), hitRow->attributes | SCREEN_ATTRIBUTE_UNDERLINE);
+    }
+    return true;
+}
+
+/**
+ * @brief Underlines the search hits that cross the visible part of a line.
+ *
+ * @param editor The editor.
+ * @param row Screen row of the line.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ * @param attributes Attributes of the text of the row.
+ */
+static void DrawSearchHits(TtyEditor* editor, unsigned row, uint64_t lineStart, uint64_t lineEnd,
+                           uint8_t attributes) {
+    const Document* document = editor->document;
+    uint64_t right = editor->leftColumn + ScreenColumns(editor->screen);
+
+    // Hits left or right of the screen are not laid out
+    HitRow hitRow = { editor, row, lineStart, 0, attributes };
+    hitRow.visibleEnd = LayoutOffsetFromColumn(document, lineStart, lineEnd, right + LAYOUT_TAB_WIDTH);
+    uint64_t visibleStart = editor->leftColumn > 0
+                                ? LayoutOffsetFromColumn(document, lineStart, lineEnd, editor->leftColumn)
+                                : lineStart;
+    MarkerTreeQuery(editor->markers, visibleStart, hitRow.visibleEnd, 1u << MARKER_KIND_SEARCH_HIT, DrawSearchHit,
+                    &hitRow);
+}
+
+/**
+ * @brief Shows the selections and secondary carets that cross a line.
+ *
+ * @param editor The editor.
+ * @param row Screen row of the line.
+ * @param lineStart Offset of the start of the line.
+ * @param lineEnd Offset of the end of the line content.
+ */
+static void DrawSelections(TtyEditor* editor, unsigned row, uint64_t lineStart, uint64_t lineEnd) {
+    const Document* document = editor->document;
+    uint64_t right = editor->leftColumn + ScreenColumns(editor->screen);
+
+    // Columns right of the screen are not measured
+    uint64_t visibleEnd = LayoutOffsetFromColumn(document, lineStart, lineEnd, right + LAYOUT_TAB_WIDTH);
+    for (size_t i = CursorSetFindFirst(&editor->cursors, lineStart); i < editor->cursors.count; i++) {
+        const Selection* selection = &editor->cursors.items[i];
+        uint64_t start = SelectionStart(selection);
+        uint64_t end = SelectionEnd(selection);
+        if (start > visibleEnd) {
+            break;
+        }
+        if (start == end && i == editor->cursors.primary) {
+            continue; // The terminal cursor shows it
+        }
+
+        uint64_t first = start <= lineStart ? 0 : LayoutColumnFromOffset(document, lineStart, start);
+        uint64_t last;
+        if (start == end) {
+            last = first + 1;
+        } else if (end > visibleEnd) {
+            last = LayoutColumnFromOffset(document, lineStart, visibleEnd) + 1; // The line break or what is cut off
+        } else {
+            last = LayoutColumnFromOffset(document, lineStart, end);
+        }
+        first = first > editor->leftColumn ? first : editor->leftColumn;
+        last = last < right ? last : right;
+        if (first < last) {
+            ScreenSetAttributes(editor->screen, row, (unsigned)(first - editor->leftColumn),
+                                (unsigned)(last - first), SCREEN_ATTRIBUTE_REVERSE);
+        }
+    }
+}
+
+/**
+ * @brief Draws the status line: file, position and message, or the prompt.
+ *
+ * @param editor The editor.
+ * @param caretLine Line of the primary caret.
+ * @param caretColumn Display column of the primary caret.
+ */
+static void DrawStatusLine(TtyEditor* editor, uint64_t caretLine, uint64_t caretColumn) {
+    static const char* const prompts[] = {
+        "", "Find: ", "Go to line: ", "Save as: ", "Play macro (count, end, lines or /text): ",
+        "Show lines containing: ", "Go to time: ", "Format (trim, tabs, newline): "
+    };
+    Screen* screen = editor->screen;
+    unsigned row = editor->textRows;
+    ScreenFill(screen, row, 0, ' ', SCREEN_ATTRIBUTE_REVERSE);
+
+    if (editor->prompt != PROMPT_NONE) {
+        const char* label = prompts[editor->prompt];
+        unsigned column = ScreenPutText(screen, row, 0, label, strlen(label), SCREEN_ATTRIBUTE_REVERSE);
+        column = ScreenPutText(screen, row, column, editor->promptText, editor->promptLength,
+                               SCREEN_ATTRIBUTE_REVERSE);
+        ScreenSetCursor(screen, row, column, true);
+        return;
+    }
+
+    const char* name = editor->filePath[0] ? strrchr(editor->filePath, '/') : NULL;
+    name = name ? name + 1 : (editor->filePath[0] ? editor->filePath : "Untitled");
+    char filter[64] = "";
+    if (editor->filter) {
+        snprintf(filter, sizeof(filter), "  [Filter: %llu lines]",
+                 (unsigned long long)LineFilterCount(editor->filter));
+    }
+    char left[TTY_MAX_PATH + 128];
+    int leftLength = snprintf(left, sizeof(left), " %s%s%s%s  %s", name,
+                              DocumentIsModified(editor->document) ? " *" : "",
+                              editor->recording ? "  [Recording]" : "", filter, editor->message);
+    char right[128];
+    int rightLength;
+    if (editor->savePercent >= 0) {
+        rightLength = snprintf(right, sizeof(right), "Saving %d%%  Ln %llu/%llu, Col %llu ", editor->savePercent,
+                               (unsigned long long)caretLine + 1,
+                               (unsigned long long)DocumentLineCount(editor->document),
+                               (unsigned long long)caretColumn + 1);
+    } else {
+        rightLength = snprintf(right, sizeof(right), "Ln %llu/%llu, Col %llu ", (unsigned long long)caretLine + 1,
+                               (unsigned long long)DocumentLineCount(editor->document),
+                               (unsigned long long)caretColumn + 1);
+    }
+
+    unsigned columns = ScreenColumns(screen);
+    ScreenPutText(screen, row, 0, left, (size_t)leftLength, SCREEN_ATTRIBUTE_REVERSE | SCREEN_ATTRIBUTE_BOLD);
+    if ((unsigned)rightLength < columns) {
+        ScreenPutText(screen, row, columns - (unsigned)rightLength, right, (size_t)rightLength,
+                      SCREEN_ATTRIBUTE_REVERSE);
+    }
+}
+
+/**
+ * @brief Draws a frame and sends the changes to the terminal.
+ *
+ * Only the visible lines are read, so the cost of a frame does not depend
+ * on the length of the document. While filtering, each row shows the next
+ * matching line, and the cursor is hidden when the caret is on a line that
+ * does not match.
+ *
+ * @param editor The editor.
+ */
+static void Render(TtyEditor* editor) {
+    Document* document = editor->document;
+    Screen* screen = editor->screen;
+    unsigned columns = ScreenColumns(screen);
+
+    uint64_t caret = PrimarySelection(editor)->caret;
+    uint64_t caretLine = DocumentLineFromOffset(document, caret);
+    uint64_t caretColumn = LayoutColumnFromOffset(document, DocumentLineStart(document, caretLine), caret);
+    uint64_t caretRow = editor->filter ? LineFilterRowFromLine(editor->filter, caretLine) : caretLine;
+    ScrollToCaret(editor, caretRow, caretColumn);
+
+    uint64_t top = editor->filter ? editor->filterTop : editor->topLine;
+    uint64_t rowCount = editor->filter ? LineFilterCount(editor->filter) : DocumentLineCount(document);
+    for (unsigned row = 0; row < editor->textRows; row++) {
+        if (top + row >= rowCount) {
+            ScreenFill(screen, row, 0, ' ', 0);
+            continue;
+        }
+        uint64_t line = editor->filter ? LineFilterLineFromRow(editor->filter, top + row) : top + row;
+        uint64_t start = DocumentLineStart(document, line);
+        uint64_t end = DocumentLineEnd(document, line);
+        size_t filled = LayoutVisibleText(document, start, end, editor->leftColumn, editor->cells, columns);
+
+        // Bookmarked lines are drawn in bold
+        uint8_t attributes =
+            MarkerTreeQuery(editor->markers, start, end, 1u << MARKER_KIND_BOOKMARK, StopAtFirst, NULL) > 0
+                ? SCREEN_ATTRIBUTE_BOLD : 0;
+        for (size_t i = 0; i < filled; i++) {
+            ScreenPut(screen, row, (unsigned)i, CellCodepoint(editor->cells[i]), attributes);
+        }
+        ScreenFill(screen, row, (unsigned)filled, ' ', 0);
+        DrawSearchHits(editor, row, start, end, attributes);
+        DrawSelections(editor, row, start, end);
+    }
+
+    bool caretShown = !editor->filter || LineFilterIsMatch(editor->filter, caretLine);
+    ScreenSetCursor(screen, (unsigned)(caretRow - top), (unsigned)(caretColumn - editor->leftColumn), caretShown);
+    DrawStatusLine(editor, caretLine, caretColumn);
+
+    size_t length;
+    const char* output = ScreenFlush(screen, &length);
+    if (output) {
+        WriteTerminal(output, length);
+    }
+}
+
+/**
+ * @brief Passes formatted text to the file writer.
+ *
+ * @param data The bytes.
+ * @param length Number of bytes.
+ * @param context The file writer.
+ * @return true if the bytes were written, false otherwise.
+ */
+static bool WriteFormattedText(const char* data, size_t length, void* context) {
+    return FileWriterWrite((FileWriter*)context, data, length);
+}
+
+/**
+ * @brief Writes a snapshot to the file of a save job.
+ *
+ * The snapshot is written next to the target and renamed over it, so a
+ * file still mapped by the document is never overwritten in place. When
+ * formatting, the pieces go through the formatter in the same pass.
+ *
+ * @param context The save job.
+ */
+static void SaveWorker(void* context) {
+    SaveJob* job = (SaveJob*)context;
+    char tempPath[TTY_MAX_PATH + 8];
+    snprintf(tempPath, sizeof(tempPath), "%s.pte~", job->filePath);
+
+    FileWriter* writer = FileWriterOpen(tempPath);
+    bool written = writer != NULL;
+    DocumentIterator iterator;
+    DocumentSnapshotIterInit(job->snapshot, 0, &iterator);
+    uint64_t total = DocumentSnapshotLength(job->snapshot);
+    uint64_t done = 0;
+    int reported = 0;
+    const char* data;
+    size_t length;
+    job->formatter.sink = WriteFormattedText;
+    job->formatter.context = writer;
+    while (written && DocumentIterNext(&iterator, &data, &length)) {
+        written = job->formatting ? TextFormatterWrite(&job->formatter, data, length)
+                                  : FileWriterWrite(writer, data, length);
+        done += length;
+        int percent = (int)(done * 100 / total);
+        if (percent > reported) {
+            reported = percent;
+            Wake((unsigned char)percent);
+        }
+    }
+    if (written && job->formatting) {
+        written = TextFormatterFinish(&job->formatter);
+    }
+    written = writer && FileWriterClose(writer) && written && rename(tempPath, job->filePath) == 0;
+    if (!written) {
+        remove(tempPath);
+    }
+    job->succeeded = written;
+    Wake(TTY_WAKE_SAVE_DONE);
+}
+
+/**
+ * @brief Starts saving the document in the background.
+ *
+ * @param editor The editor.
+ * @param filePath Path to save to.
+ */
+static void StartSave(TtyEditor* editor, const char* filePath) {
+    if (editor->save.thread) {
+        SetMessage(editor, "A save is already running");
+        return;
+    }
+    SaveJob* job = &editor->save;
+    snprintf(job->filePath, sizeof(job->filePath), "%s", filePath);
+    job->snapshot = DocumentSnapshotCreate(editor->document);
+    job->succeeded = false;
+    TextFormatOptions options = { editor->formatOnSave, LAYOUT_TAB_WIDTH, TEXT_FORMAT_SAVE_MAX_EDITS };
+    TextFormatterInit(&job->formatter, &options, NULL, NULL, true);
+    job->formatting = editor->formatOnSave != 0;
+    job->thread = job->snapshot ? ThreadStart(SaveWorker, job) : NULL;
+    if (!job->thread) {
+        DocumentSnapshotRelease(job->snapshot);
+        job->snapshot = NULL;
+        TextFormatterFree(&job->formatter);
+        SetMessage(editor, "Cannot start saving");
+        return;
+    }
+    snprintf(editor->filePath, sizeof(editor->filePath), "%s", filePath);
+    editor->savePercent = 0;
+}
+
+/**
+ * @brief Collects a finished background save.
+ *
+ * @param editor The editor.
+ */
+static void FinishSave(TtyEditor* editor) {
+    SaveJob* job = &editor->save;
+    if (!job->thread) {
+        return;
+    }
+    ThreadJoin(job->thread);
+    job->thread = NULL;
+    const DocumentEdit* edits;
+    size_t editCount;
+    bool complete = TextFormatterGetEdits(&job->formatter, &edits, &editCount);
+    if (!job->succeeded) {
+        SetMessage(editor, "Save failed");
+    } else if (editCount == 0 && complete) {
+        DocumentMarkSnapshotSaved(editor->document, job->snapshot);
+        SetMessage(editor, "Saved");
+    } else if (complete && DocumentSnapshotIsCurrent(job->snapshot)) {
+        // The document takes the formatted text too, as one undo step
+        editor->formatting = true;
+        bool applied = DocumentApplyEdits(editor->document, edits, editCount);
+        editor->formatting = false;
+        if (applied) {
+            DocumentMarkSaved(editor->document);
+        }
+        SetMessage(editor, applied ? "Saved and formatted" : "Saved; formatted in the file only");
+    } else {
+        // Edited while saving, or too many changes to record
+        SetMessage(editor, "Saved; formatted in the file only");
+    }
+    TextFormatterFree(&job->formatter);
+    DocumentSnapshotRelease(job->snapshot);
+    job->snapshot = NULL;
+    editor->savePercent = -1;
+}
+
+/**
+ * @brief Copies the selections to the clipboard without copying their bytes.
+ *
+ * @param editor The editor.
+ * @return true if something was copied.
+ */
+static bool CopySelections(TtyEditor* editor) {
+    DocumentRange* ranges = (DocumentRange*)malloc(editor->cursors.count * sizeof(DocumentRange));
+    if (!ranges) {
+        return false;
+    }
+    size_t selected = 0;
+    for (size_t i = 0; i < editor->cursors.count; i++) {
+        const Selection* selection = &editor->cursors.items[i];
+        if (selection->anchor != selection->caret) {
+            ranges[selected].offset = SelectionStart(selection);
+            ranges[selected].length = SelectionEnd(selection) - ranges[selected].offset;
+            selected++;
+        }
+    }
+    DocumentSlice* slice = NULL;
+    if (selected > 0) {
+        const char* terminator = LineTerminator(editor->document);
+        slice = DocumentSliceCreate(editor->document, ranges, selected, terminator, strlen(terminator));
+    }
+    free(ranges);
+    return slice && ClipboardSetSlice(NULL, slice);
+}
+
+/**
+ * @brief Inserts a slice of the document at every caret, one part per caret when the counts match.
+ *
+ * @param editor The editor.
+ * @param slice A slice of the editor's document.
+ */
+static void InsertSlice(TtyEditor* editor, DocumentSlice* slice) {
+    size_t count = editor->cursors.count;
+    bool distribute = count > 1 && DocumentSlicePartCount(slice) == count;
+    DocumentSlice** slices = (DocumentSlice**)calloc(count, sizeof(DocumentSlice*));
+    bool ready = slices != NULL;
+    for (size_t i = 0; ready && i < count; i++) {
+        slices[i] = distribute ? DocumentSlicePart(slice, i) : slice;
+        ready = slices[i] != NULL;
+    }
+    if (ready) {
+        CursorSetInsertSlices(&editor->cursors, editor->document, (const DocumentSlice* const*)slices);
+    }
+    if (distribute && slices) {
+        for (size_t i = 0; i < count; i++) {
+            DocumentSliceRelease(slices[i]);
+        }
+    }
+    free(slices);
+}
+
+/**
+ * @brief Inserts the text of the clipboard at every caret.
+ *
+ * @param text The text.
+ * @param length Length of the text.
+ * @param context The editor.
+ * @return true if the text was inserted.
+ */
+static bool InsertClipboardText(const char* text, size_t length, void* context) {
+    TtyEditor* editor = (TtyEditor*)context;
+    DocumentSlice* slice = DocumentSliceFromText(editor->document, text, length);
+    if (!slice) {
+        return false;
+    }
+    InsertSlice(editor, slice);
+    DocumentSliceRelease(slice);
+    return true;
+}
+
+/**
+ * @brief Inserts text pasted from the terminal as one edit.
+ *
+ * Terminals send line breaks as carriage returns; they become the
+ * document's line terminator.
+ *
+ * @param editor The editor.
+ */
+static void FinishPaste(TtyEditor* editor) {
+    const char* terminator = LineTerminator(editor->document);
+    size_t terminatorLength = strlen(terminator);
+    size_t length = 0;
+    for (size_t i = 0; i < editor->pasteLength; i++) {
+        length += editor->paste[i] == '\r' ? terminatorLength : 1;
+    }
+    char* text = (char*)malloc(length ? length : 1);
+    if (text) {
+        size_t filled = 0;
+        for (size_t i = 0; i < editor->pasteLength; i++) {
+            if (editor->paste[i] == '\r') {
+                memcpy(text + filled, terminator, terminatorLength);
+                filled += terminatorLength;
+            } else {
+                text[filled++] = editor->paste[i];
+            }
+        }
+        DocumentSlice* slice = DocumentSliceFromText(editor->document, text, length);
+        if (slice) {
+            InsertSlice(editor, slice);
+            DocumentSliceRelease(slice);
+        }
+        free(text);
+    }
+    editor->pasting = false;
+    editor->pasteLength = 0;
+}
+
+/**
+ * @brief Selects the next occurrence of the search text after the primary caret, wrapping around.
+ *
+ * @param editor The editor.
+ */
+static void FindNext(TtyEditor* editor) {
+    size_t length = strlen(editor->search);
+    if (length == 0) {
+        return;
+    }
+    const Selection* selection = PrimarySelection(editor);
+    uint64_t from = SelectionEnd(selection);
+    uint64_t match;
+    if (SearchFindNext(editor->document, editor->search, length, from, true, &match) ||
+        (from > 0 && SearchFindNext(editor->document, editor->search, length, 0, true, &match))) {
+        CursorSetReset(&editor->cursors, match, match + length);
+        uint64_t line = DocumentLineFromOffset(editor->document, match);
+        if (line < editor->topLine || line >= editor->topLine + editor->textRows) {
+            editor->topLine = line > editor->textRows / 2 ? line - editor->textRows / 2 : 0;
+        }
+    } else {
+        SetMessage(editor, "Not found");
+    }
+}
+
+/**
+ * @brief Adds one search hit to the markers.
+ *
+ * @param offset Offset of the match.
+ * @param context The editor.
+ * @return false once TTY_MAX_SEARCH_HITS matches are marked.
+ */
+static bool AddSearchHit(uint64_t offset, void* context) {
+    TtyEditor* editor = (TtyEditor*)context;
+    return MarkerTreeAdd(editor->markers, offset, offset + strlen(editor->search), MARKER_KIND_SEARCH_HIT,
+                         MARKER_GROWS_NEVER, 0) != 0 &&
+           MarkerTreeCount(editor->markers, 1u << MARKER_KIND_SEARCH_HIT) < TTY_MAX_SEARCH_HITS;
+}
+
+/**
+ * @brief Replaces the search hits by every match of the search text.
+ *
+ * @param editor The editor.
+ */
+static void MarkSearchHits(TtyEditor* editor) {
+    MarkerTreeRemoveKinds(editor->markers, 1u << MARKER_KIND_SEARCH_HIT);
+    size_t length = strlen(editor->search);
+    if (length == 0 || !editor->markers) {
+        return;
+    }
+    uint64_t count = SearchFindAll(editor->document, editor->search, length, 0, DocumentLength(editor->document),
+                                   true, AddSearchHit, editor);
+    char message[64];
+    snprintf(message, sizeof(message), count >= TTY_MAX_SEARCH_HITS ? "%llu+ matches" : "%llu matches",
+             (unsigned long long)count);
+    SetMessage(editor, message);
+}
+
+/**
+ * @brief Marks or unmarks the line of the primary caret as a bookmark.
+ *
+ * @param editor The editor.
+ */
+static void ToggleBookmark(TtyEditor* editor) {
+    uint64_t line = DocumentLineFromOffset(editor->document, PrimarySelection(editor)->caret);
+    SetMessage(editor, MarkerTreeToggleLine(editor->markers, line, MARKER_KIND_BOOKMARK) ? "Bookmark set"
+                                                                                         : "Bookmark removed");
+}
+
+/**
+ * @brief Moves the caret to the next or previous bookmarked line, wrapping around.
+ *
+ * @param editor The editor.
+ * @param forward true for the next bookmark, false for the previous one.
+ */
+static void JumpToBookmark(TtyEditor* editor, bool forward) {
+    const Document* document = editor->document;
+    uint64_t line = DocumentLineFromOffset(document, PrimarySelection(editor)->caret);
+    uint32_t kinds = 1u << MARKER_KIND_BOOKMARK;
+    Marker bookmark;
+    bool found;
+    if (forward) {
+        found = (line + 1 < DocumentLineCount(document) &&
+                 MarkerTreeNext(editor->markers, DocumentLineStart(document, line + 1), kinds, &bookmark)) ||
+                MarkerTreeNext(editor->markers, 0, kinds, &bookmark);
+    } else {
+        found = MarkerTreePrevious(editor->markers, DocumentLineStart(document, line), kinds, &bookmark) ||
+                MarkerTreePrevious(editor->markers, DocumentLength(document) + 1, kinds, &bookmark);
+    }
+    if (!found) {
+        SetMessage(editor, "No bookmarks");
+        return;
+    }
+    line = DocumentLineFromOffset(document, bookmark.start);
+    uint64_t start = DocumentLineStart(document, line);
+    CursorSetReset(&editor->cursors, start, start);
+    if (line < editor->topLine || line >= editor->topLine + editor->textRows) {
+        editor->topLine = line > editor->textRows / 2 ? line - editor->textRows / 2 : 0;
+    }
+}
+
+/**
+ * @brief Moves the caret to the start of a line and centres it.
+ *
+ * @param editor The editor.
+ * @param text The one-based line number.
+ */
+static void GoToLine(TtyEditor* editor, const char* text) {
+    char* end;
+    unsigned long long line = strtoull(text, &end, 10);
+    uint64_t lineCount = DocumentLineCount(editor->document);
+    if (end == text || line == 0) {
+        SetMessage(editor, "Not a line number");
+        return;
+    }
+    line = line > lineCount ? lineCount - 1 : line - 1;
+    uint64_t offset = DocumentLineStart(editor->document, line);
+    CursorSetReset(&editor->cursors, offset, offset);
+    editor->topLine = line > editor->textRows / 2 ? line - editor->textRows / 2 : 0;
+}
+
+/**
+ * @brief Moves the caret to the first log line stamped at or after a time.
+ *
+ * @param editor The editor.
+ * @param text A timestamp, a date, or a time of day on the day of the caret line.
+ */
+static void GoToTime(TtyEditor* editor, const char* text) {
+    if (!editor->times) {
+        SetMessage(editor, "No timestamps found");
+        return;
+    }
+    uint64_t caretLine = DocumentLineFromOffset(editor->document, PrimarySelection(editor)->caret);
+    int64_t reference = 0;
+    int64_t time;
+    TimeIndexLineTime(editor->times, caretLine, &reference);
+    if (!TimeIndexParseTime(text, strlen(text), reference, &time)) {
+        SetMessage(editor, "Not a time");
+        return;
+    }
+    uint64_t line = TimeIndexFindLine(editor->times, time);
+    uint64_t offset = DocumentLineStart(editor->document, line);
+    CursorSetReset(&editor->cursors, offset, offset);
+    if (editor->filter) {
+        uint64_t row = LineFilterRowFromLine(editor->filter, line);
+        editor->filterTop = row > editor->textRows / 2 ? row - editor->textRows / 2 : 0;
+    } else {
+        editor->topLine = line > editor->textRows / 2 ? line - editor->textRows / 2 : 0;
+    }
+
+    char message[64] = "At ";
+    int64_t lineTime;
+    if (TimeIndexLineTime(editor->times, line, &lineTime)) {
+        TimeIndexFormatTime(lineTime, message + 3, sizeof(message) - 3);
+        SetMessage(editor, message);
+    }
+}
+
+/**
+ * @brief Reads format stage names: trim, tabs and newline, or all.
+ *
+ * @param text The names, separated by spaces or commas.
+ * @param[out] stages Receives the TEXT_FORMAT_ stages.
+ * @return true if every name is known and there is at least one, false otherwise.
+ */
+static bool ParseFormatStages(const char* text, unsigned* stages) {
+    static const char* const names[] = { "trim", "tabs", "newline", "all" };
+    static const unsigned values[] = {
+        TEXT_FORMAT_TRIM_TRAILING, TEXT_FORMAT_EXPAND_TABS, TEXT_FORMAT_FINAL_NEWLINE, TEXT_FORMAT_ALL_STAGES
+    };
+    size_t count = sizeof(names) / sizeof(names[0]);
+    *stages = 0;
+    while (*text) {
+        size_t length = strcspn(text, " ,");
+        size_t i = 0;
+        while (length > 0 && i < count && !(strlen(names[i]) == length && strncmp(text, names[i], length) == 0)) {
+            i++;
+        }
+        if (i == count) {
+            return false;
+        }
+        *stages |= length > 0 ? values[i] : 0;
+        text += length + (text[length] != '\0');
+    }
+    return *stages != 0;
+}
+
+/**
+ * @brief Formats the whitespace of the whole document as one undo step.
+ *
+ * @param editor The editor.
+ * @param text Names of the stages, as read by ParseFormatStages.
+ */
+static void FormatText(TtyEditor* editor, const char* text) {
+    TextFormatOptions options = { 0, LAYOUT_TAB_WIDTH, 0 };
+    if (!ParseFormatStages(text, &options.stages)) {
+        SetMessage(editor, "Format with trim, tabs, newline or all");
+        return;
+    }
+    size_t changeCount;
+    editor->formatting = true;
+    bool formatted = TextFormatDocument(editor->document, &options, &changeCount);
+    editor->formatting = false;
+    char message[64];
+    if (!formatted) {
+        snprintf(message, sizeof(message), "Out of memory");
+    } else if (changeCount == 0) {
+        snprintf(message, sizeof(message), "Nothing to format");
+    } else {
+        snprintf(message, sizeof(message), "Formatted: %zu changes", changeCount);
+    }
+    SetMessage(editor, message);
+}
+
+/**
+ * @brief Stops recording if a step could not be added to the macro.
+ *
+ * @param editor The editor.
+ * @param recorded Result of the MacroRecord call.
+ */
+static void RecordStep(TtyEditor* editor, bool recorded) {
+    if (!recorded) {
+        editor->recording = false;
+        SetMessage(editor, "Out of memory; macro recording stopped");
+    }
+}
+
+/**
+ * @brief Plays the macro as the prompt asked.
+ *
+ * A number plays it that many times at the carets and "end" until the
+ * carets reach the end of the document, each as one undo step. "lines"
+ * plays it once on every line of the selection, or of the document, and
+ * "/text" on every line containing the text, each as one edit.
+ *
+ * @param editor The editor.
+ * @param text The answer to the prompt; empty plays once.
+ */
+static void PlayMacro(TtyEditor* editor, const char* text) {
+    char message[64];
+    uint64_t count = 0;
+    bool played;
+    if (text[0] == '/' || strcmp(text, "lines") == 0) {
+        const Selection* primary = PrimarySelection(editor);
+        uint64_t firstLine = 0;
+        uint64_t lastLine = DocumentLineCount(editor->document) - 1;
+        if (text[0] != '/' && primary->anchor != primary->caret) {
+            uint64_t end = SelectionEnd(primary);
+            firstLine = DocumentLineFromOffset(editor->document, SelectionStart(primary));
+            lastLine = DocumentLineFromOffset(editor->document, end);
+            if (lastLine > firstLine && end == DocumentLineStart(editor->document, lastLine)) {
+                lastLine--;
+            }
+        }
+        if (!MacroIsLineLocal(&editor->macro)) {
+            SetMessage(editor, "Macros moving up or down cannot run on lines");
+            return;
+        }
+        const char* pattern = text[0] == '/' ? text + 1 : NULL;
+        played = MacroRunOnLines(&editor->macro, editor->document, &editor->cursors, firstLine, lastLine, pattern,
+                                 pattern ? strlen(pattern) : 0, true, &count);
+        snprintf(message, sizeof(message), "Changed %llu lines", (unsigned long long)count);
+    } else {
+        char* end;
+        unsigned long long times = strtoull(text, &end, 10);
+        if (strcmp(text, "end") == 0) {
+            times = MACRO_UNTIL_END;
+        } else if (text[0] == '\0') {
+            times = 1;
+        } else if (end == text || *end != '\0') {
+            SetMessage(editor, "Not a count");
+            return;
+        }
+        played = MacroRun(&editor->macro, &editor->cursors, editor->document, times, editor->textRows, &count);
+        snprintf(message, sizeof(message), "Played %llu times", (unsigned long long)count);
+    }
+    SetMessage(editor, played ? message : "Macro failed");
+}
+
+/**
+ * @brief Keeps the line filter in sync with document changes.
+ *
+ * The editor's own edits place the carets, except the edits of a format
+ * pass, which move them with the text.
+ *
+ * @param document The document that changed.
+ * @param changes The applied changes.
+ * @param changeCount Number of changes.
+ * @param context The editor.
+ */
+static void FilterDocumentChanged(Document* document, const DocumentChange* changes, size_t changeCount,
+                                  void* context) {
+    TtyEditor* editor = (TtyEditor*)context;
+    (void)document;
+    if (editor->formatting) {
+        CursorSetMapChanges(&editor->cursors, changes, changeCount);
+    }
+    LineFilterMapChanges(editor->filter, changes, changeCount);
+    if (editor->filter && LineFilterCount(editor->filter) == 0) {
+        // The last matching line was edited away
+        LineFilterDestroy(editor->filter);
+        editor->filter = NULL;
+        SetMessage(editor, "No lines match any more");
+    }
+}
+
+/**
+ * @brief Shows every line again, with the line of the caret in the middle.
+ *
+ * @param editor The editor.
+ * @return true if the editor was filtering, false otherwise.
+ */
+static bool ShowAllLines(TtyEditor* editor) {
+    if (!editor->filter) {
+        return false;
+    }
+    LineFilterDestroy(editor->filter);
+    editor->filter = NULL;
+    uint64_t line = DocumentLineFromOffset(editor->document, PrimarySelection(editor)->caret);
+    editor->topLine = line > editor->textRows / 2 ? line - editor->textRows / 2 : 0;
+    return true;
+}
+
+/**
+ * @brief Shows only the lines containing a text.
+ *
+ * A caret outside the matching lines moves to the matching line above it,
+ * or to the first one.
+ *
+ * @param editor The editor.
+ * @param text The text; empty shows every line again.
+ */
+static void FilterLines(TtyEditor* editor, const char* text) {
+    if (text[0] == '\0') {
+        ShowAllLines(editor);
+        return;
+    }
+    LineFilter* filter = LineFilterCreate(editor->document, text, strlen(text), true, 0);
+    if (!filter) {
+        SetMessage(editor, "Cannot filter on that text");
+        return;
+    }
+    if (LineFilterCount(filter) == 0) {
+        LineFilterDestroy(filter);
+        SetMessage(editor, "No lines match");
+        return;
+    }
+    LineFilterDestroy(editor->filter);
+    editor->filter = filter;
+
+    uint64_t line = DocumentLineFromOffset(editor->document, PrimarySelection(editor)->caret);
+    uint64_t row = LineFilterRowFromLine(filter, line);
+    if (!LineFilterIsMatch(filter, line)) {
+        uint64_t start = DocumentLineStart(editor->document, LineFilterLineFromRow(filter, row));
+        CursorSetReset(&editor->cursors, start, start);
+    }
+    editor->filterTop = row > editor->textRows / 2 ? row - editor->textRows / 2 : 0;
+    char message[64];
+    snprintf(message, sizeof(message), "%llu lines match", (unsigned long long)LineFilterCount(filter));
+    SetMessage(editor, message);
+}
+
+/**
+ * @brief Moves the carets between the lines shown by the filter.
+ *
+ * Up and down go to the matching line above or below, keeping the column,
+ * and the document ends to the first and last matching lines. A caret
+ * between matches counts as being on the row above it.
+ *
+ * @param editor The editor.
+ * @param movement A vertical, page or document movement.
+ * @param extend true to extend the selections instead of moving the anchors.
+ */
+static void MoveFilteredRows(TtyEditor* editor, CursorMovement movement, bool extend) {
+    const Document* document = editor->document;
+    uint64_t rowCount = LineFilterCount(editor->filter);
+    uint64_t rows = movement == CURSOR_MOVE_PAGE_UP || movement == CURSOR_MOVE_PAGE_DOWN ? editor->textRows : 1;
+    bool down = movement == CURSOR_MOVE_DOWN || movement == CURSOR_MOVE_PAGE_DOWN;
+    for (size_t i = 0; i < editor->cursors.count; i++) {
+        Selection* selection = &editor->cursors.items[i];
+        uint64_t line = DocumentLineFromOffset(document, selection->caret);
+        if (movement == CURSOR_MOVE_DOCUMENT_START || movement == CURSOR_MOVE_DOCUMENT_END) {
+            bool start = movement == CURSOR_MOVE_DOCUMENT_START;
+            line = LineFilterLineFromRow(editor->filter, start ? 0 : rowCount - 1);
+            selection->caret = start ? DocumentLineStart(document, line) : DocumentLineEnd(document, line);
+            selection->preferredColumn = CURSOR_NO_COLUMN;
+        } else {
+            if (selection->preferredColumn == CURSOR_NO_COLUMN) {
+                selection->preferredColumn =
+                    LayoutColumnFromOffset(document, DocumentLineStart(document, line), selection->caret);
+            }
+            uint64_t row = LineFilterRowFromLine(editor->filter, line);
+            uint64_t shown = LineFilterLineFromRow(editor->filter, row);
+            uint64_t target;
+            if (down) {
+                target = shown > line ? row + rows - 1 : row + rows;
+                if (target >= rowCount) {
+                    target = rowCount - 1;
+                }
+            } else if (shown < line) {
+                target = row + 1 > rows ? row + 1 - rows : 0;
+            } else {
+                target = row > rows ? row - rows : 0;
+            }
+            line = LineFilterLineFromRow(editor->filter, target);
+            selection->caret = LayoutOffsetFromColumn(document, DocumentLineStart(document, line),
+                                                      DocumentLineEnd(document, line), selection->preferredColumn);
+        }
+        if (!extend) {
+            selection->anchor = selection->caret;
+        }
+    }
+    CursorSetNormalize(&editor->cursors);
+}
+
+/**
+ * @brief Handles a key while the status line asks for text.
+ *
+ * @param editor The editor.
+ * @param key The key, or NULL for a typed byte.
+ * @param c The typed byte when key is NULL.
+ */
+static void PromptKey(TtyEditor* editor, const Key* key, char c) {
+    if (!key) {
+        if (editor->promptLength + 1 < sizeof(editor->promptText)) {
+            editor->promptText[editor->promptLength++] = c;
+        }
+        return;
+    }
+    if (key->code == KEY_BACKSPACE) {
+        editor->promptLength -= editor->promptLength > 0;
+        return;
+    }
+    if (key->code != KEY_ENTER) {
+        if (key->code == KEY_ESCAPE || key->code == KEY_CONTROL) {
+            editor->prompt = PROMPT_NONE;
+        }
+        return;
+    }
+
+    PromptKind prompt = editor->prompt;
+    editor->prompt = PROMPT_NONE;
+    editor->promptText[editor->promptLength] = '\0';
+    if (prompt == PROMPT_FIND) {
+        snprintf(editor->search, sizeof(editor->search), "%s", editor->promptText);
+        MarkSearchHits(editor);
+        FindNext(editor);
+    } else if (prompt == PROMPT_GOTO) {
+        GoToLine(editor, editor->promptText);
+    } else if (prompt == PROMPT_SAVE_AS && editor->promptLength > 0) {
+        StartSave(editor, editor->promptText);
+    } else if (prompt == PROMPT_MACRO) {
+        PlayMacro(editor, editor->promptText);
+    } else if (prompt == PROMPT_FILTER) {
+        FilterLines(editor, editor->promptText);
+    } else if (prompt == PROMPT_TIME) {
+        GoToTime(editor, editor->promptText);
+    } else if (prompt == PROMPT_FORMAT) {
+        FormatText(editor, editor->promptText);
+    }
+}
+
+/**
+ * @brief Opens the status line prompt.
+ *
+ * @param editor The editor.
+ * @param prompt What to ask for.
+ */
+static void BeginPrompt(TtyEditor* editor, PromptKind prompt) {
+    editor->prompt = prompt;
+    editor->promptLength = 0;
+    if (prompt == PROMPT_FIND || prompt == PROMPT_FILTER) {
+        editor->promptLength = strlen(editor->search);
+        memcpy(editor->promptText, editor->search, editor->promptLength);
+    }
+
+    // The time of the caret line, to be edited into the time to go to
+    int64_t time;
+    if (prompt == PROMPT_TIME && editor->times &&
+        TimeIndexLineTime(editor->times, DocumentLineFromOffset(editor->document, PrimarySelection(editor)->caret),
+                          &time)) {
+        editor->promptLength = TimeIndexFormatTime(time, editor->promptText, sizeof(editor->promptText));
+    }
+}
+
+/**
+ * @brief Runs a Ctrl+letter command.
+ *
+ * @param editor The editor.
+ * @param letter The letter.
+ */
+static void ControlCommand(TtyEditor* editor, char letter) {
+    size_t changeCount;
+    const DocumentChange* changes;
+    switch (letter) {
+        case 'a':
+            CursorSetReset(&editor->cursors, 0, DocumentLength(editor->document));
+            break;
+        case 'b':
+            ToggleBookmark(editor);
+            break;
+        case 'c':
+            CopySelections(editor);
+            break;
+        case 'x':
+            if (CopySelections(editor)) {
+                CursorSetInsert(&editor->cursors, editor->document, NULL, 0);
+            }
+            break;
+        case 'v':
+            // The clipboard holds a slice of this document unless text was placed on it
+            if (ClipboardGetSlice()) {
+                InsertSlice(editor, ClipboardGetSlice());
+            } else {
+                ClipboardReadText(NULL, InsertClipboardText, editor);
+            }
+            break;
+        case 'z':
+        case 'y':
+            changes = letter == 'z' ? DocumentUndo(editor->document, &changeCount)
+                                    : DocumentRedo(editor->document, &changeCount);
+            if (changes) {
+                CursorSetPlaceAfterChanges(&editor->cursors, changes, changeCount);
+            }
+            break;
+        case 'd':
+            CursorSetAddNextOccurrence(&editor->cursors, editor->document);
+            break;
+        case 'f':
+            BeginPrompt(editor, PROMPT_FIND);
+            break;
+        case 'g':
+            BeginPrompt(editor, PROMPT_GOTO);
+            break;
+        case 'k':
+            BeginPrompt(editor, PROMPT_FILTER);
+            break;
+        case 't':
+            BeginPrompt(editor, PROMPT_TIME);
+            break;
+        case 'e':
+            BeginPrompt(editor, PROMPT_FORMAT);
+            break;
+        case 'l':
+            ScreenInvalidate(editor->screen);
+            break;
+        case 'r':
+            if (!editor->recording) {
+                MacroClear(&editor->macro);
+            }
+            editor->recording = !editor->recording;
+            break;
+        case 'p':
+            if (editor->recording || MacroIsEmpty(&editor->macro)) {
+                SetMessage(editor, editor->recording ? "Stop recording first (Ctrl+R)" : "No macro recorded");
+            } else {
+                BeginPrompt(editor, PROMPT_MACRO);
+            }
+            break;
+        case 's':
+            if (editor->filePath[0]) {
+                StartSave(editor, editor->filePath);
+            } else {
+                BeginPrompt(editor, PROMPT_SAVE_AS);
+            }
+            break;
+        case 'q':
+            if (DocumentIsModified(editor->document) && !editor->quitArmed) {
+                SetMessage(editor, "Unsaved changes; press Ctrl+Q again to quit");
+                editor->quitArmed = true;
+                return;
+            }
+            editor->quit = true;
+            break;
+        default:
+            break;
+    }
+    editor->quitArmed = false;
+}
+
+/**
+ * @brief Handles a decoded key.
+ *
+ * @param editor The editor.
+ * @param key The key.
+ */
+static void HandleKey(TtyEditor* editor, const Key* key) {
+    if (editor->prompt != PROMPT_NONE) {
+        PromptKey(editor, key, 0);
+        return;
+    }
+
+    CursorMovement movement;
+    switch (key->code) {
+        case KEY_UP: movement = CURSOR_MOVE_UP; break;
+        case KEY_DOWN: movement = CURSOR_MOVE_DOWN; break;
+        case KEY_LEFT: movement = key->control ? CURSOR_MOVE_WORD_LEFT : CURSOR_MOVE_LEFT; break;
+        case KEY_RIGHT: movement = key->control ? CURSOR_MOVE_WORD_RIGHT : CURSOR_MOVE_RIGHT; break;
+        case KEY_HOME: movement = key->control ? CURSOR_MOVE_DOCUMENT_START : CURSOR_MOVE_LINE_START; break;
+        case KEY_END: movement = key->control ? CURSOR_MOVE_DOCUMENT_END : CURSOR_MOVE_LINE_END; break;
+        case KEY_PAGE_UP: movement = CURSOR_MOVE_PAGE_UP; break;
+        case KEY_PAGE_DOWN: movement = CURSOR_MOVE_PAGE_DOWN; break;
+
+        case KEY_BACKSPACE:
+        case KEY_DELETE: {
+            bool forward = key->code == KEY_DELETE;
+            bool deleted;
+            if (key->control) {
+                deleted = forward ? CursorSetDeleteWordForward(&editor->cursors, editor->document)
+                                  : CursorSetDeleteWordBackward(&editor->cursors, editor->document);
+            } else {
+                deleted = forward ? CursorSetDeleteForward(&editor->cursors, editor->document)
+                                  : CursorSetDeleteBackward(&editor->cursors, editor->document);
+            }
+            if (deleted && editor->recording) {
+                RecordStep(editor, key->control ? MacroRecordDeleteWord(&editor->macro, forward)
+                                                : MacroRecordDelete(&editor->macro, forward));
+            }
+            return;
+        }
+        case KEY_ENTER: {
+            const char* terminator = LineTerminator(editor->document);
+            if (CursorSetInsert(&editor->cursors, editor->document, terminator, strlen(terminator)) &&
+                editor->recording) {
+                RecordStep(editor, MacroRecordInsert(&editor->macro, terminator, strlen(terminator)));
+            }
+            return;
+        }
+        case KEY_ESCAPE: {
+            if (ShowAllLines(editor)) {
+                return;
+            }
+            Selection primary = *PrimarySelection(editor);
+            CursorSetReset(&editor->cursors, primary.caret, primary.caret);
+            MarkerTreeRemoveKinds(editor->markers, 1u << MARKER_KIND_SEARCH_HIT);
+            return;
+        }
+        case KEY_F2:
+            JumpToBookmark(editor, !key->shift);
+            return;
+        case KEY_F3:
+            FindNext(editor);
+            return;
+        case KEY_CONTROL:
+            ControlCommand(editor, key->letter);
+            return;
+        default:
+            return;
+    }
+
+    // Paging moves the view with the caret, so the caret keeps its row
+    bool horizontal = movement == CURSOR_MOVE_LEFT || movement == CURSOR_MOVE_RIGHT ||
+                      movement == CURSOR_MOVE_WORD_LEFT || movement == CURSOR_MOVE_WORD_RIGHT ||
+                      movement == CURSOR_MOVE_LINE_START || movement == CURSOR_MOVE_LINE_END;
+    if (editor->filter && !horizontal) {
+        MoveFilteredRows(editor, movement, key->shift);
+    } else {
+        CursorSetMove(&editor->cursors, editor->document, movement, key->shift, editor->textRows);
+    }
+    if (editor->recording) {
+        RecordStep(editor, MacroRecordMove(&editor->macro, movement, key->shift));
+    }
+    if (editor->filter) {
+        uint64_t rowCount = LineFilterCount(editor->filter);
+        uint64_t last = rowCount > editor->textRows ? rowCount - editor->textRows : 0;
+        if (movement == CURSOR_MOVE_PAGE_DOWN) {
+            editor->filterTop = editor->filterTop + editor->textRows < last ? editor->filterTop + editor->textRows
+                                                                            : last;
+        } else if (movement == CURSOR_MOVE_PAGE_UP) {
+            editor->filterTop = editor->filterTop > editor->textRows ? editor->filterTop - editor->textRows : 0;
+        }
+    } else if (movement == CURSOR_MOVE_PAGE_DOWN) {
+        uint64_t lineCount = DocumentLineCount(editor->document);
+        uint64_t last = lineCount > editor->textRows ? lineCount - editor->textRows : 0;
+        editor->topLine = editor->topLine + editor->textRows < last ? editor->topLine + editor->textRows : last;
+    } else if (movement == CURSOR_MOVE_PAGE_UP) {
+        editor->topLine = editor->topLine > editor->textRows ? editor->topLine - editor->textRows : 0;
+    }
+}
+
+/**
+ * @brief Decodes the modifier parameter of a CSI sequence ("1;5A").
+ *
+ * @param modifier The parameter: 1 plus 1 for Shift, 2 for Alt, 4 for Ctrl.
+ * @param key The key receiving the modifiers.
+ */
+static void ApplyModifier(int modifier, Key* key) {
+    if (modifier > 1) {
+        key->shift = ((modifier - 1) & 1) != 0;
+        key->control = ((modifier - 1) & 4) != 0;
+    }
+}
+
+/**
+ * @brief Decodes one key other than a printable character.
+ *
+ * @param data The input.
+ * @param length Bytes of input available.
+ * @param final true when no more input is coming soon, so a lone Esc is the Esc key.
+ * @param[out] key Receives the key (KEY_NONE for sequences that are ignored).
+ * @return Bytes consumed, or 0 if the sequence is not complete yet.
+ */
+static size_t DecodeKey(const unsigned char* data, size_t length, bool final, Key* key) {
+    memset(key, 0, sizeof(*key));
+    unsigned char c = data[0];
+    if (c == '\r' || c == '\n') {
+        key->code = KEY_ENTER;
+        return 1;
+    }
+    if (c == 0x7F || c == 0x08) {
+        // Terminals that send DEL for Backspace send BS for Ctrl+Backspace
+        key->code = KEY_BACKSPACE;
+        key->control = c == 0x08;
+        return 1;
+    }
+    if (c != 0x1B) {
+        if (c >= 1 && c <= 26) {
+            key->code = KEY_CONTROL;
+            key->letter = (char)('a' + c - 1);
+        }
+        return 1;
+    }
+
+    if (length < 2) {
+        if (final) {
+            key->code = KEY_ESCAPE;
+            return 1;
+        }
+        return 0;
+    }
+    if (data[1] != '[' && data[1] != 'O') {
+        key->code = KEY_ESCAPE; // Alt+key is not used; the key follows on its own
+        return 1;
+    }
+
+    // Find the final byte of the sequence: parameters are digits and ';'
+    size_t end = 2;
+    while (end < length && ((data[end] >= '0' && data[end] <= '9') || data[end] == ';')) {
+        end++;
+    }
+    if (end == length) {
+        return final ? length : 0;
+    }
+
+    int parameters[2] = { 0, 0 };
+    int count = 0;
+    for (size_t i = 2; i < end && count < 2; i++) {
+        if (data[i] == ';') {
+            count++;
+        } else {
+            parameters[count] = parameters[count] * 10 + (data[i] - '0');
+        }
+    }
+
+    switch (data[end]) {
+        case 'A': key->code = KEY_UP; break;
+        case 'B': key->code = KEY_DOWN; break;
+        case 'C': key->code = KEY_RIGHT; break;
+        case 'D': key->code = KEY_LEFT; break;
+        case 'H': key->code = KEY_HOME; break;
+        case 'F': key->code = KEY_END; break;
+        case 'Q': key->code = KEY_F2; break;
+        case 'R': key->code = data[1] == 'O' ? KEY_F3 : KEY_NONE; break;
+        case '~':
+            switch (parameters[0]) {
+                case 1: case 7: key->code = KEY_HOME; break;
+                case 4: case 8: key->code = KEY_END; break;
+                case 3: key->code = KEY_DELETE; break;
+                case 5: key->code = KEY_PAGE_UP; break;
+                case 6: key->code = KEY_PAGE_DOWN; break;
+                case 12: key->code = KEY_F2; break;
+                case 13: key->code = KEY_F3; break;
+                case 200: key->code = KEY_PASTE_START; break;
+                default: break;
+            }
+            break;
+        default:
+            break;
+    }
+    ApplyModifier(parameters[1], key);
+    return end + 1;
+}
+
+/**
+ * @brief Checks whether a byte is typed as text.
+ *
+ * @param c The byte.
+ * @return true for printable characters, tabs and bytes of multi-byte characters.
+ */
+static bool IsTextByte(unsigned char c) {
+    return c == '\t' || (c >= 0x20 && c != 0x7F);
+}
+
+/**
+ * @brief Handles the bytes of input read so far.
+ *
+ * Runs of printable characters are inserted as one edit. Bytes of an
+ * incomplete escape sequence are left for the next read.
+ *
+ * @param editor The editor.
+ * @param input The input.
+ * @param length Bytes of input.
+ * @param final true when no more input is coming soon.
+ * @return Bytes consumed.
+ */
+static size_t HandleInput(TtyEditor* editor, const unsigned char* input, size_t length, bool final) {
+    size_t position = 0;
+    while (position < length && !editor->quit) {
+        if (editor->pasting) {
+            // Everything up to the end marker is text, escape bytes included
+            const unsigned char* rest = input + position;
+            size_t available = length - position;
+            size_t text = 0;
+            while (text < available &&
+                   !(rest[text] == 0x1B && available - text >= TTY_PASTE_MARKER_LENGTH &&
+                     memcmp(rest + text, TTY_PASTE_END, TTY_PASTE_MARKER_LENGTH) == 0)) {
+                text++;
+            }
+            bool ended = text < available;
+            if (!ended && !final) {
+                // The marker may be split across reads; keep a possible start of it
+                text = available > TTY_PASTE_MARKER_LENGTH ? available - TTY_PASTE_MARKER_LENGTH + 1 : 0;
+            }
+            if (editor->pasteLength + text > editor->pasteCapacity) {
+                size_t capacity = (editor->pasteLength + text) * 2;
+                char* paste = (char*)realloc(editor->paste, capacity);
+                if (!paste) {
+                    editor->pasting = false;
+                    editor->pasteLength = 0;
+                    return length;
+                }
+                editor->paste = paste;
+                editor->pasteCapacity = capacity;
+            }
+            memcpy(editor->paste + editor->pasteLength, rest, text);
+            editor->pasteLength += text;
+            position += text;
+            if (ended) {
+                position += TTY_PASTE_MARKER_LENGTH;
+                FinishPaste(editor);
+            } else if (text == 0) {
+                return position;
+            }
+            continue;
+        }
+
+        if (IsTextByte(input[position])) {
+            size_t start = position;
+            while (position < length && IsTextByte(input[position])) {
+                position++;
+            }
+            editor->message[0] = '\0';
+            if (editor->prompt != PROMPT_NONE) {
+                for (size_t i = start; i < position; i++) {
+                    PromptKey(editor, NULL, (char)input[i]);
+                }
+            } else if (CursorSetInsert(&editor->cursors, editor->document, (const char*)input + start,
+                                       position - start) && editor->recording) {
+                RecordStep(editor, MacroRecordInsert(&editor->macro, (const char*)input + start, position - start));
+            }
+            continue;
+        }
+
+        Key key;
+        size_t used = DecodeKey(input + position, length - position, final, &key);
+        if (used == 0) {
+            break;
+        }
+        position += used;
+        if (key.code == KEY_PASTE_START) {
+            editor->pasting = true;
+            editor->pasteLength = 0;
+            continue;
+        }
+        if (!(key.code == KEY_CONTROL && key.letter == 'q')) {
+            editor->quitArmed = false;
+        }
+        editor->message[0] = '\0';
+        HandleKey(editor, &key);
+    }
+    return position;
+}
+
+/**
+ * @brief Handles the wake-up bytes: resizes and save progress.
+ *
+ * @param editor The editor.
+ */
+static void HandleWakeUps(TtyEditor* editor) {
+    unsigned char codes[256];
+    ssize_t count;
+    while ((count = read(g_wakePipe[0], codes, sizeof(codes))) > 0) {
+        for (ssize_t i = 0; i < count; i++) {
+            if (codes[i] == TTY_WAKE_RESIZE) {
+                UpdateTerminalSize(editor);
+            } else if (codes[i] == TTY_WAKE_SAVE_DONE) {
+                FinishSave(editor);
+            } else if (editor->savePercent >= 0) {
+                editor->savePercent = codes[i];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Opens the file to edit, or starts a new document.
+ *
+ * @param editor The editor.
+ * @param filePath Path to the file, or NULL for a new document.
+ * @return true if successful, false otherwise.
+ */
+static bool OpenDocument(TtyEditor* editor, const char* filePath) {
+    if (filePath) {
+        snprintf(editor->filePath, sizeof(editor->filePath), "%s", filePath);
+        MappedFile mappedFile;
+        if (MapFileOpen(filePath, &mappedFile)) {
+            editor->document = DocumentCreateFromMapping(&mappedFile, NULL);
+            return editor->document != NULL;
+        }
+        if (access(filePath, F_OK) == 0) {
+            return false; // Exists but cannot be read
+        }
+    }
+    editor->document = DocumentCreateFromText(NULL, 0);
+    return editor->document != NULL;
+}
+
+/**
+ * @brief Runs the terminal editor.
+ *
+ * @param argc Number of arguments.
+ * @param argv The arguments: --format-on-save with its stages, and an optional file to edit.
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, char** argv) {
+    unsigned formatOnSave = 0;
+    const char* filePath = NULL;
+    bool usage = false;
+    bool help = false;
+    for (int i = 1; i < argc && !usage; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            usage = help = true;
+        } else if (strcmp(argv[i], "--format-on-save") == 0) {
+            formatOnSave = TEXT_FORMAT_ALL_STAGES;
+        } else if (strncmp(argv[i], "--format-on-save=", 17) == 0) {
+            usage = !ParseFormatStages(argv[i] + 17, &formatOnSave);
+        } else {
+            usage = argv[i][0] == '-' || filePath != NULL;
+            filePath = argv[i];
+        }
+    }
+    if (usage) {
+        fprintf(stderr, "Usage: editor_tty [--format-on-save[=trim,tabs,newline]] [file]\n");
+        return help ? 0 : 1;
+    }
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        fprintf(stderr, "editor_tty: standard input and output must be a terminal\n");
+        return 1;
+    }
+
+    TtyEditor editor;
+    memset(&editor, 0, sizeof(editor));
+    editor.savePercent = -1;
+    editor.formatOnSave = formatOnSave;
+    MacroInit(&editor.macro);
+    if (!OpenDocument(&editor, filePath) || !CursorSetInit(&editor.cursors)) {
+        fprintf(stderr, "editor_tty: cannot open %s\n", filePath ? filePath : "a new document");
+        DocumentDestroy(editor.document);
+        return 1;
+    }
+
+    // The wake-up pipe never blocks its writers: a signal handler and the save thread
+    if (pipe(g_wakePipe) != 0 || fcntl(g_wakePipe[0], F_SETFL, O_NONBLOCK) != 0 ||
+        fcntl(g_wakePipe[1], F_SETFL, O_NONBLOCK) != 0) {
+        fprintf(stderr, "editor_tty: cannot create a pipe\n");
+        DocumentDestroy(editor.document);
+        return 1;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = HandleResize;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGWINCH, &action, NULL);
+
+    if (!EnterRawMode()) {
+        fprintf(stderr, "editor_tty: cannot configure the terminal\n");
+        DocumentDestroy(editor.document);
+        return 1;
+    }
+    bool running = UpdateTerminalSize(&editor);
+    editor.layout = LayoutCacheCreate(editor.document);
+    editor.markers = MarkerTreeCreate(editor.document);
+    editor.times = TimeIndexCreate(editor.document);
+    if (!DocumentAddListener(editor.document, FilterDocumentChanged, &editor)) {
+        running = false;
+    }
+
+    static unsigned char input[TTY_INPUT_SIZE];
+    size_t inputLength = 0;
+    while (running && !editor.quit) {
+        Render(&editor);
+
+        // Wait for input; a pending Esc only waits for the rest of its sequence
+        struct pollfd sources[2] = {
+            { STDIN_FILENO, POLLIN, 0 },
+            { g_wakePipe[0], POLLIN, 0 },
+        };
+        int timeout = inputLength > 0 ? TTY_ESCAPE_TIMEOUT_MS : -1;
+        int ready = poll(sources, 2, timeout);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready > 0 && (sources[1].revents & POLLIN)) {
+            HandleWakeUps(&editor);
+        }
+
+        // Take everything already typed before drawing again
+        bool final = ready == 0;
+        ssize_t count;
+        while (inputLength < sizeof(input) &&
+               (count = read(STDIN_FILENO, input + inputLength, sizeof(input) - inputLength)) > 0) {
+            inputLength += (size_t)count;
+            final = false;
+        }
+        size_t used = HandleInput(&editor, input, inputLength, final);
+        memmove(input, input + used, inputLength - used);
+        inputLength -= used;
+    }
+
+    if (editor.save.thread) {
+        FinishSave(&editor);
+    }
+    LeaveRawMode();
+
+    ScreenStats stats;
+    ScreenGetStats(editor.screen, &stats);
+    char memoryReport[2048];
+    MemoryFormatReport(MEMORY_REPORT_TEXT, memoryReport, sizeof(memoryReport));
+    ScreenDestroy(editor.screen);
+    ClipboardRelease();
+    CursorSetFree(&editor.cursors);
+    MacroFree(&editor.macro);
+    DocumentRemoveListener(editor.document, FilterDocumentChanged, &editor);
+    LineFilterDestroy(editor.filter);
+    TimeIndexDestroy(editor.times);
+    MarkerTreeDestroy(editor.markers);
+    LayoutCacheDestroy(editor.layout);
+    DocumentDestroy(editor.document);
+    free(editor.cells);
+    free(editor.paste);
+    close(g_wakePipe[0]);
+    close(g_wakePipe[1]);
+    if (getenv("EDITOR_TTY_STATS")) {
+        fprintf(stderr, "editor_tty: %llu frames, %llu cells, %llu bytes, %llu scrolls\n", stats.frames,
+                stats.cellsWritten, stats.bytesWritten, stats.scrolls);
+        fputs(memoryReport, stderr);
+    }
+    return running ? 0 : 1;
+}